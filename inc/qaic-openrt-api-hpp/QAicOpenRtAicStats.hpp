@@ -0,0 +1,356 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_AIC_STATS_HPP
+#define QAIC_OPENRT_AIC_STATS_HPP
+
+#include "QAicOpenRtLogger.hpp"
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtProgram.hpp"
+#include "QAicRuntimeTypes.h"
+#include "AICNetworkDesc.pb.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief Per op record decoded from an aic-stats buffer
+struct AicOpStat {
+  uint32_t iteration = 0; /// Stats snapshot index within the buffer
+  uint32_t core = 0;      /// NSP core the op ran on
+  uint32_t opIndex = 0;   /// Op index within the core
+  std::string name;       /// Op name from the network descriptor
+  std::string kind;       /// Op kind from the network descriptor
+  uint64_t startCycle = 0;
+  uint64_t endCycle = 0;
+  std::vector<uint64_t> pmuCounts; /// One counter per selected PMU event
+  uint64_t cycles() const {
+    return (endCycle > startCycle) ? (endCycle - startCycle) : 0;
+  }
+};
+
+/// \brief Decodes the aic-stats buffer of a program compiled with op stats
+/// (-aic-op-stats) and exports the per op time breakdown.
+///
+/// The stats buffer is exposed to the host as the output buffer named
+/// "aiccyclecounts". It holds one or more snapshots, each laid out core
+/// after core following Stats.ops_per_core. Every op record is a sequence
+/// of little endian uint64_t: start cycle, end cycle, followed by one
+/// counter per entry of Stats.pmu_events. Op names and kinds are taken
+/// from Stats.core_op_name_kinds, flattened over thread groups.
+class AicStats : public Logger {
+public:
+  /// Name of the output buffer carrying the stats
+  static constexpr const char *statsBufferName = "aiccyclecounts";
+
+  /// \brief Create a decoder from the stats descriptor of a program
+  /// \param[in] program A previously created program
+  /// \return Shared pointer AicStats
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When the program was not compiled with AIC stats
+  static shAicStats Factory(shProgram program) {
+    if (!program || !program->getProgram()) {
+      throw CoreExceptionInit("Invalid program");
+    }
+    const aicnwdesc::networkDescriptor *networkDesc =
+        program->getProgram()->getNetworkDesc();
+    if (networkDesc == nullptr || !networkDesc->has_stats()) {
+      throw CoreExceptionInit("Program not compiled with AIC stats");
+    }
+    return Factory(networkDesc->stats());
+  }
+
+  /// \brief Create a decoder from a stats descriptor
+  /// \param[in] stats Stats message of the network descriptor
+  /// \return Shared pointer AicStats
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When the descriptor does not describe any op
+  static shAicStats Factory(const aicnwdesc::Stats &stats) {
+    shAicStats obj = shAicStats(new (std::nothrow) AicStats(stats));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create AicStats Object");
+    }
+    obj->init();
+    return obj;
+  }
+
+  /// \brief Set the device cycle rate used to convert cycles to time.
+  /// Defaults to 1 cycle per microsecond, i.e. raw cycles are reported.
+  void setCyclesPerUs(double cyclesPerUs) {
+    if (cyclesPerUs > 0) {
+      cyclesPerUs_ = cyclesPerUs;
+    }
+  }
+
+  /// \brief Size of one stats snapshot in bytes
+  size_t getSnapshotSize() const {
+    return numOps_ * recordWords() * sizeof(uint64_t);
+  }
+
+  /// \brief Locate the stats buffer within an inference vector
+  /// \param[in] bufferMappings Buffer mappings of the program
+  /// \param[in] buffers Inference buffers, as returned by ExecObj::getData
+  /// \param[out] statsBuffer Stats buffer
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Program has no stats output buffer
+  static QStatus findStatsBuffer(const BufferMappings &bufferMappings,
+                                 const std::vector<QBuffer> &buffers,
+                                 QBuffer &statsBuffer) {
+    for (const auto &mapping : bufferMappings) {
+      if (mapping.ioType == QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT &&
+          mapping.bufferName == statsBufferName &&
+          mapping.index < buffers.size()) {
+        statsBuffer = buffers.at(mapping.index);
+        return QS_SUCCESS;
+      }
+    }
+    return QS_INVAL;
+  }
+
+  /// \brief Decode a stats buffer into per op records
+  /// \param[in] statsBuffer Buffer holding one or more stats snapshots
+  /// \param[out] ops Decoded op records, ordered by snapshot, core and op
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Buffer is null or smaller than one snapshot
+  QStatus decode(const QBuffer &statsBuffer, std::vector<AicOpStat> &ops) {
+    const size_t snapshotSize = getSnapshotSize();
+    if (statsBuffer.buf == nullptr || statsBuffer.size < snapshotSize) {
+      logError("Invalid stats buffer size " +
+               std::to_string(statsBuffer.size) + ", expected at least " +
+               std::to_string(snapshotSize));
+      return QS_INVAL;
+    }
+    const size_t numSnapshots = statsBuffer.size / snapshotSize;
+    const size_t numPmu = pmuEvents_.size();
+    ops.clear();
+    ops.reserve(numSnapshots * numOps_);
+
+    const uint8_t *src = statsBuffer.buf;
+    for (size_t it = 0; it < numSnapshots; it++) {
+      for (uint32_t core = 0; core < opsPerCore_.size(); core++) {
+        for (uint32_t op = 0; op < opsPerCore_.at(core); op++) {
+          AicOpStat stat;
+          stat.iteration = static_cast<uint32_t>(it);
+          stat.core = core;
+          stat.opIndex = op;
+          opName(core, op, stat.name, stat.kind);
+          stat.startCycle = readWord(src);
+          stat.endCycle = readWord(src);
+          stat.pmuCounts.resize(numPmu);
+          for (size_t p = 0; p < numPmu; p++) {
+            stat.pmuCounts[p] = readWord(src);
+          }
+          ops.emplace_back(std::move(stat));
+        }
+      }
+    }
+    return QS_SUCCESS;
+  }
+
+  /// \brief Write decoded records as a Chrome trace (chrome://tracing,
+  /// Perfetto). Each snapshot is a process and each core a thread,
+  /// timestamps are relative to the earliest op of the snapshot.
+  /// \param[in] ops Decoded op records
+  /// \param[in] path Output file path
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_ERROR Failed to write the file
+  QStatus writeChromeTrace(const std::vector<AicOpStat> &ops,
+                           const std::string &path) {
+    std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+    if (!ofs) {
+      logError("Failed to open " + path);
+      return QS_ERROR;
+    }
+    std::vector<uint64_t> baseCycle = snapshotBaseCycles(ops);
+    ofs << std::fixed << std::setprecision(3);
+    ofs << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto &op : ops) {
+      ofs << (first ? "\n" : ",\n");
+      first = false;
+      ofs << "{\"name\":\"" << escape(op.name) << "\",\"cat\":\""
+          << escape(op.kind) << "\",\"ph\":\"X\",\"pid\":" << op.iteration
+          << ",\"tid\":" << op.core << ",\"ts\":"
+          << toUs(op.startCycle - baseCycle.at(op.iteration))
+          << ",\"dur\":" << toUs(op.cycles()) << ",\"args\":{\"op\":"
+          << op.opIndex << ",\"cycles\":" << op.cycles();
+      for (size_t p = 0; p < op.pmuCounts.size(); p++) {
+        ofs << ",\"pmu_" << pmuEvents_.at(p) << "\":" << op.pmuCounts.at(p);
+      }
+      ofs << "}}";
+    }
+    ofs << "\n]}\n";
+    return ofs.good() ? QS_SUCCESS : QS_ERROR;
+  }
+
+  /// \brief Write decoded records as CSV, one row per op
+  /// \param[in] ops Decoded op records
+  /// \param[in] path Output file path
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_ERROR Failed to write the file
+  QStatus writeCsv(const std::vector<AicOpStat> &ops,
+                   const std::string &path) {
+    std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+    if (!ofs) {
+      logError("Failed to open " + path);
+      return QS_ERROR;
+    }
+    std::vector<uint64_t> totalCycles = snapshotCoreCycles(ops);
+    ofs << "iteration,core,op,name,kind,start_cycle,end_cycle,cycles,"
+           "duration_us,core_percent";
+    for (auto event : pmuEvents_) {
+      ofs << ",pmu_" << event;
+    }
+    ofs << "\n" << std::fixed << std::setprecision(3);
+    for (const auto &op : ops) {
+      const uint64_t total =
+          totalCycles.at(op.iteration * opsPerCore_.size() + op.core);
+      const double percent =
+          total ? (100.0 * static_cast<double>(op.cycles()) / total) : 0.0;
+      ofs << op.iteration << "," << op.core << "," << op.opIndex << ","
+          << csvField(op.name) << "," << csvField(op.kind) << ","
+          << op.startCycle << "," << op.endCycle << "," << op.cycles() << ","
+          << toUs(op.cycles()) << "," << percent;
+      for (auto count : op.pmuCounts) {
+        ofs << "," << count;
+      }
+      ofs << "\n";
+    }
+    return ofs.good() ? QS_SUCCESS : QS_ERROR;
+  }
+
+  AicStats(const AicStats &) = delete;            // Disable Copy Constructor
+  AicStats &operator=(const AicStats &) = delete; // Disable Assignment Operator
+
+private:
+  AicStats(const aicnwdesc::Stats &stats) : stats_(stats) {}
+
+  void init() {
+    numOps_ = 0;
+    for (int core = 0; core < stats_.ops_per_core_size(); core++) {
+      const int32_t numOps = stats_.ops_per_core(core);
+      if (numOps < 0) {
+        throw CoreExceptionInit("Invalid ops_per_core entry");
+      }
+      opsPerCore_.push_back(static_cast<uint32_t>(numOps));
+      numOps_ += numOps;
+    }
+    if (numOps_ == 0) {
+      throw CoreExceptionInit("Stats descriptor has no op");
+    }
+    pmuEvents_.assign(stats_.pmu_events().begin(), stats_.pmu_events().end());
+  }
+
+  size_t recordWords() const { return 2 + pmuEvents_.size(); }
+
+  static uint64_t readWord(const uint8_t *&src) {
+    uint64_t word;
+    std::memcpy(&word, src, sizeof(word));
+    src += sizeof(word);
+    return word;
+  }
+
+  void opName(uint32_t core, uint32_t op, std::string &name,
+              std::string &kind) const {
+    if (static_cast<int>(core) < stats_.core_op_name_kinds_size()) {
+      uint32_t idx = op;
+      for (const auto &tg :
+           stats_.core_op_name_kinds(core).tg_op_name_kinds()) {
+        if (idx < static_cast<uint32_t>(tg.op_name_kinds_size())) {
+          name = tg.op_name_kinds(idx).name();
+          kind = tg.op_name_kinds(idx).kind();
+          return;
+        }
+        idx -= tg.op_name_kinds_size();
+      }
+    }
+    name = "op" + std::to_string(op);
+    kind = "unknown";
+  }
+
+  std::vector<uint64_t>
+  snapshotBaseCycles(const std::vector<AicOpStat> &ops) const {
+    std::vector<uint64_t> base;
+    for (const auto &op : ops) {
+      if (op.iteration >= base.size()) {
+        base.resize(op.iteration + 1, std::numeric_limits<uint64_t>::max());
+      }
+      base[op.iteration] = std::min(base[op.iteration], op.startCycle);
+    }
+    return base;
+  }
+
+  std::vector<uint64_t>
+  snapshotCoreCycles(const std::vector<AicOpStat> &ops) const {
+    std::vector<uint64_t> total;
+    for (const auto &op : ops) {
+      const size_t idx = op.iteration * opsPerCore_.size() + op.core;
+      if (idx >= total.size()) {
+        total.resize(idx + 1, 0);
+      }
+      total[idx] += op.cycles();
+    }
+    return total;
+  }
+
+  double toUs(uint64_t cycles) const {
+    return static_cast<double>(cycles) / cyclesPerUs_;
+  }
+
+  static std::string escape(const std::string &str) {
+    std::ostringstream oss;
+    for (char c : str) {
+      switch (c) {
+      case '"':
+        oss << "\\\"";
+        break;
+      case '\\':
+        oss << "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          oss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+              << static_cast<int>(c);
+        } else {
+          oss << c;
+        }
+      }
+    }
+    return oss.str();
+  }
+
+  static std::string csvField(const std::string &str) {
+    if (str.find_first_of(",\"\n") == std::string::npos) {
+      return str;
+    }
+    std::string quoted = "\"";
+    for (char c : str) {
+      quoted += (c == '"') ? std::string("\"\"") : std::string(1, c);
+    }
+    return quoted + "\"";
+  }
+
+  const aicnwdesc::Stats stats_;
+  std::vector<uint32_t> opsPerCore_;
+  std::vector<int32_t> pmuEvents_;
+  size_t numOps_ = 0;
+  double cyclesPerUs_ = 1.0;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_AIC_STATS_HPP
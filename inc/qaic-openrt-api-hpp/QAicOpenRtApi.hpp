@@ -12,4 +12,14 @@
 #include "QAicOpenRtExecObj.hpp"
 #include "QAicOpenRtInferenceVector.hpp"
 #include "QAicOpenRtFileWriter.hpp"
+#include "QAicOpenRtBatcher.hpp"
+#include "QAicOpenRtAicStats.hpp"
+#include "QAicOpenRtLoadGen.hpp"
+#include "QAicOpenRtTrafficRecorder.hpp"
+#include "QAicOpenRtTrafficReplay.hpp"
+#include "QAicOpenRtDataset.hpp"
+#include "QAicOpenRtOutputValidator.hpp"
+#include "QAicOpenRtInputFill.hpp"
+#include "QAicOpenRtProgramSwap.hpp"
+#include "QAicOpenRtDeviceRecovery.hpp"
 #endif // QAIC_OPENRT_API_HPP
@@ -45,6 +45,36 @@ using shInferenceVector = std::shared_ptr<InferenceVector>;
 
 class FileWriter;
 
+class Batcher;
+using shBatcher = std::shared_ptr<Batcher>;
+
+class ProgramSwap;
+using shProgramSwap = std::shared_ptr<ProgramSwap>;
+
+class DeviceRecovery;
+using shDeviceRecovery = std::shared_ptr<DeviceRecovery>;
+
+class AicStats;
+using shAicStats = std::shared_ptr<AicStats>;
+
+class LoadGen;
+using shLoadGen = std::shared_ptr<LoadGen>;
+
+class TrafficRecorder;
+using shTrafficRecorder = std::shared_ptr<TrafficRecorder>;
+
+class TrafficReplay;
+using shTrafficReplay = std::shared_ptr<TrafficReplay>;
+
+class DatasetStreamer;
+using shDatasetStreamer = std::shared_ptr<DatasetStreamer>;
+
+class OutputValidator;
+using shOutputValidator = std::shared_ptr<OutputValidator>;
+
+class InputFill;
+using shInputFill = std::shared_ptr<InputFill>;
+
 } // namespace openrt
 } // namespace qaic
 #endif
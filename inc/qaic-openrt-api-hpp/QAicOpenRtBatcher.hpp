@@ -0,0 +1,475 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_BATCHER_HPP
+#define QAIC_OPENRT_BATCHER_HPP
+
+#include "QAicOpenRtLogger.hpp"
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtExecObj.hpp"
+#include "QAicRuntimeTypes.h"
+#include "AICNetworkDesc.pb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief Properties used to configure a Batcher
+struct BatcherProperties {
+  /// Number of samples the program was compiled for. Every buffer in the
+  /// program buffer mappings holds batchSize samples back to back.
+  /// 0 takes the batch size of the program's network descriptor.
+  uint32_t batchSize = 0;
+  /// Maximum time the oldest queued sample waits for the batch to fill
+  /// before a partial batch is dispatched.
+  std::chrono::microseconds maxWait = std::chrono::microseconds(1000);
+  /// When true, partial batches are zero padded up to batchSize.
+  /// When false, inputs that allow partial buffers are shrunk to the
+  /// number of valid samples and only the remaining ones are padded.
+  bool padPartialBatch = true;
+  /// Maximum number of samples allowed to wait in the queue, 0 is unbounded.
+  uint32_t maxQueueDepth = 0;
+};
+
+/// \brief Result delivered to the submitter of a single sample
+struct BatchSampleResult {
+  QStatus status = QS_ERROR;
+  /// One entry per output buffer, holding only this sample's slice
+  std::vector<std::vector<uint8_t>> outputs;
+};
+
+/// \brief Executes one batch. The buffer vector is laid out following the
+/// program buffer mappings, \a numValid samples hold real data.
+using BatchExecFunction =
+    std::function<QStatus(std::vector<QBuffer> &buffers, uint32_t numValid)>;
+
+/// \brief A Batcher coalesces single sample requests, submitted from any
+/// number of threads, into full batches for a program compiled with
+/// batch size greater than one. A batch is dispatched once all slots are
+/// filled or once the oldest queued sample has waited for maxWait.
+/// Outputs are scattered back to the per sample futures.
+/// Each execution backend (typically one ExecObj) is driven by its own
+/// dispatch thread so several batches may be in flight at once.
+/// Samples still queued past their deadline, or canceled, are dropped
+/// instead of taking a batch slot.
+class Batcher : public Logger {
+public:
+  using Clock = std::chrono::steady_clock;
+  using RequestID = uint64_t;
+
+  /// \brief Create a Batcher driving a set of ExecObjs, batching as many
+  /// samples as the program was compiled for
+  /// \param[in] context A previously created context
+  /// \param[in] program A previously created program shared object
+  /// \param[in] properties Batcher properties, a batchSize other than 0
+  /// must match the program's
+  /// \param[in] numExecObjs Number of ExecObjs, i.e. batches in flight
+  /// \return Shared pointer Batcher
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  /// - When batchSize differs from the batch size of the program
+  /// - When execObj creation fails
+  static shBatcher
+  Factory(shContext context, shProgram program,
+          const BatcherProperties &properties = BatcherProperties(),
+          uint32_t numExecObjs = 1) {
+    if (!context || !program || !program->getProgram() || numExecObjs == 0) {
+      throw CoreExceptionInit("Invalid Batcher parameters");
+    }
+    BatcherProperties batcherProperties = properties;
+    const aicnwdesc::networkDescriptor *networkDesc =
+        program->getProgram()->getNetworkDesc();
+    const int32_t compiledBatchSize =
+        (networkDesc != nullptr) ? networkDesc->batch_size() : 0;
+    if (compiledBatchSize > 0) {
+      if (batcherProperties.batchSize == 0) {
+        batcherProperties.batchSize = static_cast<uint32_t>(compiledBatchSize);
+      } else if (batcherProperties.batchSize !=
+                 static_cast<uint32_t>(compiledBatchSize)) {
+        throw CoreExceptionInit(
+            "Batch size " + std::to_string(batcherProperties.batchSize) +
+            " differs from the program batch size " +
+            std::to_string(compiledBatchSize));
+      }
+    } else if (batcherProperties.batchSize == 0) {
+      throw CoreExceptionInit("Program has no batch size, set batchSize");
+    }
+    std::vector<shExecObj> execObjs;
+    std::vector<BatchExecFunction> backends;
+    for (uint32_t i = 0; i < numExecObjs; i++) {
+      shExecObj execObj = ExecObj::Factory(context, program);
+      backends.emplace_back(
+          [execObj](std::vector<QBuffer> &buffers, uint32_t) -> QStatus {
+            QStatus status = execObj->setData(buffers);
+            if (status != QS_SUCCESS) {
+              return status;
+            }
+            return execObj->run();
+          });
+      execObjs.emplace_back(execObj);
+    }
+    shBatcher obj = Factory(program->getBufferMappings(), batcherProperties,
+                            std::move(backends));
+    obj->setContext(context);
+    obj->execObjs_ = std::move(execObjs);
+    return obj;
+  }
+
+  /// \brief Create a Batcher on top of user provided execution backends
+  /// \param[in] bufferMappings Buffer mappings of the batched program
+  /// \param[in] properties Batcher properties, batchSize is required
+  /// \param[in] backends One execution function per batch in flight
+  /// \return Shared pointer Batcher
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  static shBatcher Factory(const BufferMappings &bufferMappings,
+                           const BatcherProperties &properties,
+                           std::vector<BatchExecFunction> backends) {
+    shBatcher obj = shBatcher(new (std::nothrow) Batcher(
+        bufferMappings, properties, std::move(backends)));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create Batcher Object");
+    }
+    obj->init();
+    return obj;
+  }
+
+  /// \brief Destructor dispatches every queued sample and joins the
+  /// dispatch threads
+  ~Batcher() { stop(); }
+
+  /// \brief Queue a single sample for execution
+  /// \param[in] inputs One buffer per program input holding exactly one
+  /// sample, i.e. mapping size / batchSize bytes. The data is copied before
+  /// the call returns.
+  /// \param[in] deadline The sample is dropped if not dispatched by then
+  /// \param[out] id Optional, identifies the sample to cancel()
+  /// \return Future resolved once the batch holding the sample completed.
+  /// The result status is QS_INVAL for malformed inputs, QS_BUSY when
+  /// the queue is full or the batcher is stopped, QS_DEADLINE_EXCEEDED when
+  /// the deadline passed before dispatch and QS_CANCELED once canceled.
+  std::future<BatchSampleResult>
+  submit(const std::vector<QBuffer> &inputs,
+         Clock::time_point deadline = Clock::time_point::max(),
+         RequestID *id = nullptr) {
+    Request request;
+    std::future<BatchSampleResult> future = request.promise.get_future();
+
+    if (inputs.size() != inputIndexes_.size()) {
+      logError("Invalid number of input buffers");
+      failRequest(request, QS_INVAL);
+      return future;
+    }
+    request.data.reserve(inputs.size());
+    for (uint32_t i = 0; i < inputs.size(); i++) {
+      const uint32_t sampleSize = sampleSizes_.at(inputIndexes_.at(i));
+      if (inputs.at(i).buf == nullptr || inputs.at(i).size != sampleSize) {
+        logError("Invalid input buffer " + std::to_string(i));
+        failRequest(request, QS_INVAL);
+        return future;
+      }
+      request.data.emplace_back(inputs.at(i).buf,
+                                inputs.at(i).buf + sampleSize);
+    }
+    request.arrival = Clock::now();
+    request.deadline = deadline;
+    if (request.arrival >= deadline) {
+      failRequest(request, QS_DEADLINE_EXCEEDED);
+      return future;
+    }
+
+    {
+      std::unique_lock<std::mutex> lk(queueMutex_);
+      if (stopping_ || (properties_.maxQueueDepth != 0 &&
+                        queue_.size() >= properties_.maxQueueDepth)) {
+        lk.unlock();
+        failRequest(request, QS_BUSY);
+        return future;
+      }
+      request.id = nextRequestId_++;
+      if (id != nullptr) {
+        *id = request.id;
+      }
+      queue_.emplace_back(std::move(request));
+    }
+    queueCv_.notify_one();
+    return future;
+  }
+
+  /// \brief Drop a sample that was not dispatched yet, its future resolves
+  /// with QS_CANCELED
+  /// \param[in] id Identifier returned by submit()
+  /// \return false if the sample is already dispatched or unknown
+  bool cancel(RequestID id) {
+    Request request;
+    {
+      std::lock_guard<std::mutex> lk(queueMutex_);
+      auto it = std::find_if(queue_.begin(), queue_.end(),
+                             [id](const Request &r) { return r.id == id; });
+      if (it == queue_.end()) {
+        return false;
+      }
+      request = std::move(*it);
+      queue_.erase(it);
+      numCanceled_++;
+    }
+    failRequest(request, QS_CANCELED);
+    return true;
+  }
+
+  /// \brief Dispatch all queued samples and stop the dispatch threads.
+  /// Samples submitted afterwards are rejected with QS_BUSY.
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lk(queueMutex_);
+      if (stopping_) {
+        return;
+      }
+      stopping_ = true;
+    }
+    queueCv_.notify_all();
+    for (auto &t : workers_) {
+      if (t.joinable()) {
+        t.join();
+      }
+    }
+  }
+
+  /// \brief Get the number of samples per batch
+  uint32_t getBatchSize() const { return properties_.batchSize; }
+
+  /// \brief Get the number of samples currently waiting for a slot
+  size_t getQueueDepth() {
+    std::lock_guard<std::mutex> lk(queueMutex_);
+    return queue_.size();
+  }
+
+  /// \brief Get batch statistics
+  /// \param[out] batches Number of batches dispatched
+  /// \param[out] samples Number of valid samples dispatched
+  void getStats(uint64_t &batches, uint64_t &samples) {
+    std::lock_guard<std::mutex> lk(queueMutex_);
+    batches = numBatches_;
+    samples = numSamples_;
+  }
+
+  /// \brief Get the number of samples dropped before dispatch
+  /// \param[out] expired Samples whose deadline passed in the queue
+  /// \param[out] canceled Samples canceled in the queue
+  void getDropStats(uint64_t &expired, uint64_t &canceled) {
+    std::lock_guard<std::mutex> lk(queueMutex_);
+    expired = numExpired_;
+    canceled = numCanceled_;
+  }
+
+  Batcher(const Batcher &) = delete;            // Disable Copy Constructor
+  Batcher &operator=(const Batcher &) = delete; // Disable Assignment Operator
+
+private:
+  struct Request {
+    std::vector<std::vector<uint8_t>> data;
+    std::promise<BatchSampleResult> promise;
+    Clock::time_point arrival;
+    Clock::time_point deadline;
+    RequestID id = 0;
+  };
+
+  Batcher(const BufferMappings &bufferMappings,
+          const BatcherProperties &properties,
+          std::vector<BatchExecFunction> backends)
+      : bufferMappings_(bufferMappings), properties_(properties),
+        backends_(std::move(backends)) {}
+
+  void init() {
+    if (properties_.batchSize == 0) {
+      throw CoreExceptionInit("Invalid batch size");
+    }
+    if (backends_.empty()) {
+      throw CoreExceptionInit("No execution backend");
+    }
+    for (uint32_t i = 0; i < bufferMappings_.size(); i++) {
+      const BufferMapping &mapping = bufferMappings_.at(i);
+      if (mapping.size % properties_.batchSize != 0) {
+        throw CoreExceptionInit("Buffer " + mapping.bufferName +
+                                " size is not a multiple of batch size");
+      }
+      sampleSizes_.push_back(mapping.size / properties_.batchSize);
+      if (mapping.ioType == QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT) {
+        inputIndexes_.push_back(i);
+      } else if (mapping.ioType ==
+                 QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT) {
+        outputIndexes_.push_back(i);
+      }
+    }
+    if (inputIndexes_.empty()) {
+      throw CoreExceptionInit("Program has no input buffer");
+    }
+    for (uint32_t i = 0; i < backends_.size(); i++) {
+      workers_.emplace_back(&Batcher::dispatchLoop, this, i);
+    }
+  }
+
+  static void failRequest(Request &request, QStatus status) {
+    BatchSampleResult result;
+    result.status = status;
+    request.promise.set_value(std::move(result));
+  }
+
+  // Wait for a full batch, the deadline of the oldest sample or stop.
+  // Samples past their deadline are moved to \a expired instead. Returns an
+  // empty vector with nothing expired only when stopping with nothing
+  // queued.
+  std::vector<Request> collectBatch(std::vector<Request> &expired) {
+    std::vector<Request> batch;
+    std::unique_lock<std::mutex> lk(queueMutex_);
+    queueCv_.wait(lk, [this] { return stopping_ || !queue_.empty(); });
+    while (!stopping_ && queue_.size() < properties_.batchSize) {
+      if (queue_.empty()) {
+        // Another dispatcher took the samples we were waiting on
+        queueCv_.wait(lk, [this] { return stopping_ || !queue_.empty(); });
+        continue;
+      }
+      const Clock::time_point deadline =
+          queue_.front().arrival + properties_.maxWait;
+      if (queueCv_.wait_until(lk, deadline) == std::cv_status::timeout) {
+        break;
+      }
+    }
+    const Clock::time_point now = Clock::now();
+    batch.reserve(std::min<size_t>(queue_.size(), properties_.batchSize));
+    while (!queue_.empty() && batch.size() < properties_.batchSize) {
+      if (queue_.front().deadline <= now) {
+        expired.emplace_back(std::move(queue_.front()));
+      } else {
+        batch.emplace_back(std::move(queue_.front()));
+      }
+      queue_.pop_front();
+    }
+    numExpired_ += expired.size();
+    if (!batch.empty()) {
+      numBatches_++;
+      numSamples_ += batch.size();
+    }
+    return batch;
+  }
+
+  void dispatchLoop(uint32_t backendIndex) {
+    // Each dispatcher owns its batch sized storage
+    std::vector<std::vector<uint8_t>> storage(bufferMappings_.size());
+    std::vector<QBuffer> buffers(bufferMappings_.size());
+    for (uint32_t i = 0; i < bufferMappings_.size(); i++) {
+      storage.at(i).resize(bufferMappings_.at(i).size);
+    }
+
+    while (true) {
+      std::vector<Request> expired;
+      std::vector<Request> batch = collectBatch(expired);
+      for (auto &request : expired) {
+        failRequest(request, QS_DEADLINE_EXCEEDED);
+      }
+      if (batch.empty()) {
+        if (!expired.empty()) {
+          continue;
+        }
+        return;
+      }
+      // Wake up a peer, the queue may still hold samples past this batch
+      queueCv_.notify_one();
+      executeBatch(backendIndex, batch, storage, buffers);
+    }
+  }
+
+  void executeBatch(uint32_t backendIndex, std::vector<Request> &batch,
+                    std::vector<std::vector<uint8_t>> &storage,
+                    std::vector<QBuffer> &buffers) {
+    const uint32_t numValid = static_cast<uint32_t>(batch.size());
+
+    // Gather inputs into their slots, zero pad the unused slots
+    for (uint32_t in = 0; in < inputIndexes_.size(); in++) {
+      const uint32_t idx = inputIndexes_.at(in);
+      const uint32_t sampleSize = sampleSizes_.at(idx);
+      uint8_t *base = storage.at(idx).data();
+      for (uint32_t slot = 0; slot < numValid; slot++) {
+        std::memcpy(base + slot * sampleSize, batch.at(slot).data.at(in).data(),
+                    sampleSize);
+      }
+      std::memset(base + numValid * sampleSize, 0,
+                  (properties_.batchSize - numValid) * sampleSize);
+    }
+
+    for (uint32_t i = 0; i < bufferMappings_.size(); i++) {
+      const BufferMapping &mapping = bufferMappings_.at(i);
+      QBuffer &qbuf = buffers.at(i);
+      qbuf.buf = storage.at(i).data();
+      qbuf.size = mapping.size;
+      qbuf.handle = 0;
+      qbuf.offset = 0;
+      qbuf.type = QBufferType::QBUFFER_TYPE_HEAP;
+      if (!properties_.padPartialBatch && mapping.isPartialBufferAllowed &&
+          mapping.ioType == QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT) {
+        qbuf.size = numValid * sampleSizes_.at(i);
+      }
+    }
+
+    QStatus status = QS_ERROR;
+    try {
+      status = backends_.at(backendIndex)(buffers, numValid);
+    } catch (const std::exception &e) {
+      logError(std::string("Batch execution failed: ") + e.what());
+      status = QS_ERROR;
+    }
+
+    // Scatter outputs back to the submitters
+    for (uint32_t slot = 0; slot < numValid; slot++) {
+      BatchSampleResult result;
+      result.status = status;
+      if (status == QS_SUCCESS) {
+        result.outputs.reserve(outputIndexes_.size());
+        for (uint32_t idx : outputIndexes_) {
+          const uint32_t sampleSize = sampleSizes_.at(idx);
+          const uint8_t *src = storage.at(idx).data() + slot * sampleSize;
+          result.outputs.emplace_back(src, src + sampleSize);
+        }
+      }
+      batch.at(slot).promise.set_value(std::move(result));
+    }
+  }
+
+  const BufferMappings bufferMappings_;
+  const BatcherProperties properties_;
+  std::vector<BatchExecFunction> backends_;
+  std::vector<shExecObj> execObjs_;
+  std::vector<uint32_t> sampleSizes_;
+  std::vector<uint32_t> inputIndexes_;
+  std::vector<uint32_t> outputIndexes_;
+  std::vector<std::thread> workers_;
+  std::deque<Request> queue_;
+  std::mutex queueMutex_;
+  std::condition_variable queueCv_;
+  bool stopping_ = false;
+  RequestID nextRequestId_ = 1;
+  uint64_t numBatches_ = 0;
+  uint64_t numSamples_ = 0;
+  uint64_t numExpired_ = 0;
+  uint64_t numCanceled_ = 0;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_BATCHER_HPP
@@ -0,0 +1,646 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_DATASET_HPP
+#define QAIC_OPENRT_DATASET_HPP
+
+#include "QAicOpenRtLogger.hpp"
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtUtil.hpp"
+#include "QAicOpenRtInferenceVector.hpp"
+#include "QAicRuntimeTypes.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief Source of input samples, each sample holds one blob per program
+/// input. Reads may be issued from several threads at once.
+class DatasetSource {
+public:
+  virtual ~DatasetSource() = default;
+
+  /// \brief Get the number of samples
+  virtual size_t getNumSamples() const = 0;
+
+  /// \brief Get the number of inputs of every sample
+  virtual uint32_t getNumInputs() const = 0;
+
+  /// \brief Copy one input of a sample
+  /// \param[in] index Sample index
+  /// \param[in] input Input index
+  /// \param[out] dest Destination of destSize bytes
+  /// \param[out] size Number of bytes copied
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Out of range indexes or input larger than destSize
+  /// \retval QS_ERROR Failed to read the input
+  virtual QStatus readInput(size_t index, uint32_t input, uint8_t *dest,
+                            size_t destSize, size_t &size) = 0;
+};
+using shDatasetSource = std::shared_ptr<DatasetSource>;
+
+/// \brief Dataset packed in a single file and memory mapped. The file holds
+/// a header, an index of one (offset, size) entry per sample input, then
+/// the inputs, in host byte order.
+class PackedDataset : public DatasetSource, public Logger {
+public:
+  static constexpr uint32_t magic = 0x50534451; // "QDSP"
+  static constexpr uint32_t formatVersion = 1;
+  static constexpr uint64_t dataAlignment = 64;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint64_t numSamples;
+    uint32_t numInputs;
+    uint32_t reserved;
+    uint64_t dataOffset;
+  };
+
+  struct IndexEntry {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  /// \brief Map a packed dataset file
+  /// \param[in] path Packed dataset file
+  /// \return Shared pointer PackedDataset
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When the file cannot be mapped or is malformed
+  static std::shared_ptr<PackedDataset> Factory(const std::string &path) {
+    std::shared_ptr<PackedDataset> obj =
+        std::shared_ptr<PackedDataset>(new (std::nothrow) PackedDataset());
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create PackedDataset Object");
+    }
+    obj->init(path);
+    return obj;
+  }
+
+  /// \brief Pack files into a dataset file
+  /// \param[in] path Packed dataset file to write
+  /// \param[in] fileSets One set of input files per sample, every set
+  /// holding the same number of files
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Empty or inconsistent file sets
+  /// \retval QS_ERROR Failed to read an input or write the dataset
+  static QStatus write(const std::string &path,
+                       const std::vector<std::vector<std::string>> &fileSets) {
+    if (fileSets.empty() || fileSets.front().empty()) {
+      return QS_INVAL;
+    }
+    const uint32_t numInputs = static_cast<uint32_t>(fileSets.front().size());
+    std::vector<IndexEntry> index;
+    index.reserve(fileSets.size() * numInputs);
+    uint64_t offset = alignUp(sizeof(Header) +
+                              fileSets.size() * numInputs * sizeof(IndexEntry));
+    const uint64_t dataOffset = offset;
+    for (const auto &fileSet : fileSets) {
+      if (fileSet.size() != numInputs) {
+        return QS_INVAL;
+      }
+      for (const auto &file : fileSet) {
+        std::error_code ec;
+        const uint64_t size = std::filesystem::file_size(file, ec);
+        if (ec) {
+          return QS_ERROR;
+        }
+        index.push_back({offset, size});
+        offset = alignUp(offset + size);
+      }
+    }
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs.is_open()) {
+      return QS_ERROR;
+    }
+    Header header{magic, formatVersion, fileSets.size(), numInputs, 0,
+                  dataOffset};
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char *>(index.data()),
+              index.size() * sizeof(IndexEntry));
+    std::vector<char> data;
+    size_t entry = 0;
+    for (const auto &fileSet : fileSets) {
+      for (const auto &file : fileSet) {
+        const IndexEntry &e = index.at(entry++);
+        padTo(ofs, e.offset);
+        std::ifstream ifs(file, std::ios::binary);
+        data.resize(e.size);
+        if (!ifs.read(data.data(), data.size())) {
+          std::remove(path.c_str());
+          return QS_ERROR;
+        }
+        ofs.write(data.data(), data.size());
+      }
+    }
+    ofs.close();
+    if (!ofs) {
+      std::remove(path.c_str());
+      return QS_ERROR;
+    }
+    return QS_SUCCESS;
+  }
+
+  ~PackedDataset() {
+    if (base_ != nullptr) {
+      munmap(base_, mapSize_);
+    }
+  }
+
+  size_t getNumSamples() const override { return header_.numSamples; }
+
+  uint32_t getNumInputs() const override { return header_.numInputs; }
+
+  /// \brief Get one input of a sample without copying it
+  /// \retval QS_SUCCESS Successful completion, \a data points into the
+  /// mapping and stays valid as long as the dataset
+  /// \retval QS_INVAL Out of range indexes
+  QStatus getInput(size_t index, uint32_t input, QData &data) const {
+    if (index >= header_.numSamples || input >= header_.numInputs) {
+      return QS_INVAL;
+    }
+    const IndexEntry &e = index_[index * header_.numInputs + input];
+    data.data = base_ + e.offset;
+    data.size = e.size;
+    return QS_SUCCESS;
+  }
+
+  QStatus readInput(size_t index, uint32_t input, uint8_t *dest,
+                    size_t destSize, size_t &size) override {
+    QData data;
+    if (getInput(index, input, data) != QS_SUCCESS || data.size > destSize) {
+      return QS_INVAL;
+    }
+    std::memcpy(dest, data.data, data.size);
+    size = data.size;
+    return QS_SUCCESS;
+  }
+
+  PackedDataset(const PackedDataset &) = delete; // Disable Copy Constructor
+  PackedDataset &
+  operator=(const PackedDataset &) = delete; // Disable Assignment Operator
+
+private:
+  PackedDataset() {}
+
+  static uint64_t alignUp(uint64_t value) {
+    return (value + dataAlignment - 1) & ~(dataAlignment - 1);
+  }
+
+  static void padTo(std::ofstream &ofs, uint64_t offset) {
+    static const char zeros[dataAlignment] = {};
+    const uint64_t pos = static_cast<uint64_t>(ofs.tellp());
+    if (offset > pos) {
+      ofs.write(zeros, offset - pos);
+    }
+  }
+
+  void init(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      throw CoreExceptionInit("Failed to open dataset " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        st.st_size < static_cast<off_t>(sizeof(Header))) {
+      close(fd);
+      throw CoreExceptionInit("Invalid dataset " + path);
+    }
+    mapSize_ = static_cast<size_t>(st.st_size);
+    void *base = mmap(nullptr, mapSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      throw CoreExceptionInit("Failed to map dataset " + path);
+    }
+    base_ = static_cast<uint8_t *>(base);
+    // Samples are consumed in order, let the kernel read ahead
+    (void)madvise(base_, mapSize_, MADV_SEQUENTIAL);
+
+    std::memcpy(&header_, base_, sizeof(header_));
+    if (header_.magic != magic || header_.formatVersion != formatVersion ||
+        header_.numSamples == 0 || header_.numInputs == 0) {
+      throw CoreExceptionInit("Invalid dataset header " + path);
+    }
+    // Every bound is checked against the file size, so a corrupt index can
+    // not point outside the mapping
+    const uint64_t maxEntries =
+        (mapSize_ - sizeof(Header)) / sizeof(IndexEntry);
+    if (header_.numSamples > maxEntries / header_.numInputs) {
+      throw CoreExceptionInit("Invalid dataset index " + path);
+    }
+    index_ = reinterpret_cast<const IndexEntry *>(base_ + sizeof(Header));
+    const uint64_t numEntries = header_.numSamples * header_.numInputs;
+    for (uint64_t i = 0; i < numEntries; i++) {
+      const IndexEntry &e = index_[i];
+      if (e.offset < header_.dataOffset || e.offset > mapSize_ ||
+          e.size > mapSize_ - e.offset) {
+        throw CoreExceptionInit("Invalid dataset entry " + std::to_string(i) +
+                                " in " + path);
+      }
+    }
+  }
+
+  Header header_{};
+  uint8_t *base_ = nullptr;
+  size_t mapSize_ = 0;
+  const IndexEntry *index_ = nullptr;
+};
+
+/// \brief Dataset of one file per sample input
+class FileSetDataset : public DatasetSource, public Logger {
+public:
+  /// \brief Create a dataset from explicit file sets
+  /// \param[in] fileSets One set of input files per sample, every set
+  /// holding the same number of files
+  /// \return Shared pointer FileSetDataset
+  /// \exception CoreExceptionInit
+  /// - When the file sets are empty or inconsistent
+  static std::shared_ptr<FileSetDataset>
+  Factory(std::vector<std::vector<std::string>> fileSets) {
+    if (fileSets.empty() || fileSets.front().empty()) {
+      throw CoreExceptionInit("Empty dataset");
+    }
+    for (const auto &fileSet : fileSets) {
+      if (fileSet.size() != fileSets.front().size()) {
+        throw CoreExceptionInit("Inconsistent dataset file sets");
+      }
+    }
+    std::shared_ptr<FileSetDataset> obj = std::shared_ptr<FileSetDataset>(
+        new (std::nothrow) FileSetDataset(std::move(fileSets)));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create FileSetDataset Object");
+    }
+    return obj;
+  }
+
+  /// \brief Create a dataset from the regular files of a directory. Files
+  /// are sorted by name and taken numInputs at a time, so that e.g.
+  /// 0000-a.raw, 0000-b.raw, 0001-a.raw, 0001-b.raw make two samples.
+  /// \param[in] dir Dataset directory
+  /// \param[in] numInputs Number of inputs of every sample
+  /// \return Shared pointer FileSetDataset
+  /// \exception CoreExceptionInit
+  /// - When the directory cannot be read or its files do not make whole
+  /// samples
+  static std::shared_ptr<FileSetDataset> Factory(const std::string &dir,
+                                                 uint32_t numInputs) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+      if (entry.is_regular_file()) {
+        files.push_back(entry.path().string());
+      }
+    }
+    if (ec) {
+      throw CoreExceptionInit("Failed to read dataset directory " + dir);
+    }
+    if (numInputs == 0 || files.empty() || files.size() % numInputs != 0) {
+      throw CoreExceptionInit("Dataset directory " + dir +
+                              " does not hold whole samples");
+    }
+    std::sort(files.begin(), files.end());
+    std::vector<std::vector<std::string>> fileSets;
+    for (size_t i = 0; i < files.size(); i += numInputs) {
+      fileSets.emplace_back(files.begin() + i, files.begin() + i + numInputs);
+    }
+    return Factory(std::move(fileSets));
+  }
+
+  size_t getNumSamples() const override { return fileSets_.size(); }
+
+  uint32_t getNumInputs() const override {
+    return static_cast<uint32_t>(fileSets_.front().size());
+  }
+
+  /// \brief Get the file sets, one per sample
+  const std::vector<std::vector<std::string>> &getFileSets() const {
+    return fileSets_;
+  }
+
+  QStatus readInput(size_t index, uint32_t input, uint8_t *dest,
+                    size_t destSize, size_t &size) override {
+    if (index >= fileSets_.size() || input >= getNumInputs()) {
+      return QS_INVAL;
+    }
+    const std::string &path = fileSets_.at(index).at(input);
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      logError("Failed to open dataset file " + path);
+      return QS_ERROR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      return QS_ERROR;
+    }
+    if (static_cast<uint64_t>(st.st_size) > destSize) {
+      close(fd);
+      logError("Dataset file " + path + " larger than the input buffer");
+      return QS_INVAL;
+    }
+    size_t done = 0;
+    const size_t fileSize = static_cast<size_t>(st.st_size);
+    while (done < fileSize) {
+      ssize_t n = read(fd, dest + done, fileSize - done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        close(fd);
+        logError("Failed to read dataset file " + path);
+        return QS_ERROR;
+      }
+      done += static_cast<size_t>(n);
+    }
+    close(fd);
+    size = fileSize;
+    return QS_SUCCESS;
+  }
+
+  FileSetDataset(const FileSetDataset &) = delete; // Disable Copy Constructor
+  FileSetDataset &
+  operator=(const FileSetDataset &) = delete; // Disable Assignment Operator
+
+private:
+  explicit FileSetDataset(std::vector<std::vector<std::string>> fileSets)
+      : fileSets_(std::move(fileSets)) {}
+
+  const std::vector<std::vector<std::string>> fileSets_;
+};
+
+/// \brief Properties used to configure a DatasetStreamer
+struct DatasetStreamerProperties {
+  /// Number of inference vectors in the ring. Bounds the samples loaded
+  /// ahead plus the samples held by the consumer.
+  uint32_t numSlots = 4;
+  /// Number of threads loading samples into free slots
+  uint32_t numThreads = 2;
+  /// Restart from the first sample once the dataset is exhausted
+  bool loop = true;
+  /// Device the samples are submitted to. With NUMA placement enabled the
+  /// slot buffers live on its node and the prefetch threads run on its
+  /// local CPUs, -1 leaves placement to the OS.
+  QID device = -1;
+};
+
+/// \brief A sample handed out by DatasetStreamer::acquire
+struct DatasetSlot {
+  /// Inference vector holding the sample, owned by the streamer
+  shInferenceVector inferenceVector;
+  /// Index of the sample in the dataset
+  size_t sampleIndex = 0;
+  uint32_t slotIndex = 0;
+};
+
+/// \brief A DatasetStreamer feeds inference vectors from a ring of slots
+/// that prefetch threads fill ahead of the consumer. Samples are handed out
+/// in dataset order. A slot is refilled once the consumer released it, so
+/// its buffers may stay bound to an ExecObj while in use.
+class DatasetStreamer : public Logger {
+public:
+  /// \brief Create a DatasetStreamer
+  /// \param[in] bufferMappings Buffer mappings of the program to feed
+  /// \param[in] source Dataset with one blob per program input
+  /// \param[in] properties DatasetStreamer properties
+  /// \return Shared pointer DatasetStreamer
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  static shDatasetStreamer
+  Factory(const BufferMappings &bufferMappings, shDatasetSource source,
+          const DatasetStreamerProperties &properties) {
+    shDatasetStreamer obj = shDatasetStreamer(new (std::nothrow)
+        DatasetStreamer(bufferMappings, std::move(source), properties));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create DatasetStreamer Object");
+    }
+    obj->init();
+    return obj;
+  }
+
+  /// \brief Destructor stops and joins the prefetch threads
+  ~DatasetStreamer() { stop(); }
+
+  /// \brief Wait for the next sample
+  /// \param[out] slot Slot holding the sample, to be released once the
+  /// inference using it completed
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_ERROR The sample failed to load, \a slot.sampleIndex tells
+  /// which one. Nothing has to be released.
+  /// \retval QS_BUSY The dataset is exhausted or the streamer stopped
+  QStatus acquire(DatasetSlot &slot) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (stopping_ || nextDeliver_ >= numSequences_) {
+      return QS_BUSY;
+    }
+    const uint64_t seq = nextDeliver_;
+    Slot &s = slots_.at(seq % slots_.size());
+    auto ready = [&] {
+      return stopping_ || (s.state == SlotState::Ready && s.seq == seq);
+    };
+    if (!ready()) {
+      numStalls_++;
+      cv_.wait(lk, ready);
+    }
+    if (stopping_) {
+      return QS_BUSY;
+    }
+    nextDeliver_++;
+    slot.inferenceVector = s.inferenceVector;
+    slot.sampleIndex = seq % source_->getNumSamples();
+    slot.slotIndex = static_cast<uint32_t>(seq % slots_.size());
+    if (s.status != QS_SUCCESS) {
+      s.state = SlotState::Free;
+      lk.unlock();
+      cv_.notify_all();
+      slot.inferenceVector = nullptr;
+      return QS_ERROR;
+    }
+    s.state = SlotState::InUse;
+    return QS_SUCCESS;
+  }
+
+  /// \brief Hand a slot back for refilling
+  void release(const DatasetSlot &slot) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      Slot &s = slots_.at(slot.slotIndex);
+      if (s.state != SlotState::InUse) {
+        return;
+      }
+      s.state = SlotState::Free;
+    }
+    cv_.notify_all();
+  }
+
+  /// \brief Stop the prefetch threads, pending acquire calls return QS_BUSY
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (stopping_) {
+        return;
+      }
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto &t : workers_) {
+      if (t.joinable()) {
+        t.join();
+      }
+    }
+  }
+
+  /// \brief Get streaming statistics
+  /// \param[out] loaded Number of samples loaded
+  /// \param[out] stalls Number of acquire calls that had to wait for a
+  /// sample, i.e. the consumer outran the prefetch threads
+  void getStats(uint64_t &loaded, uint64_t &stalls) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    loaded = numLoaded_;
+    stalls = numStalls_;
+  }
+
+  DatasetStreamer(const DatasetStreamer &) =
+      delete; // Disable Copy Constructor
+  DatasetStreamer &
+  operator=(const DatasetStreamer &) = delete; // Disable Assignment Operator
+
+private:
+  enum class SlotState { Free, Loading, Ready, InUse };
+
+  struct Slot {
+    shInferenceVector inferenceVector;
+    SlotState state = SlotState::Free;
+    uint64_t seq = 0;
+    QStatus status = QS_SUCCESS;
+  };
+
+  DatasetStreamer(const BufferMappings &bufferMappings, shDatasetSource source,
+                  const DatasetStreamerProperties &properties)
+      : bufferMappings_(bufferMappings), source_(std::move(source)),
+        properties_(properties) {}
+
+  void init() {
+    if (!source_ || source_->getNumSamples() == 0) {
+      throw CoreExceptionInit("Empty dataset");
+    }
+    if (properties_.numSlots == 0 || properties_.numThreads == 0) {
+      throw CoreExceptionInit("Invalid DatasetStreamer properties");
+    }
+    for (uint32_t i = 0; i < bufferMappings_.size(); i++) {
+      if (bufferMappings_.at(i).ioType ==
+          QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT) {
+        inputIndexes_.push_back(i);
+      }
+    }
+    if (inputIndexes_.size() != source_->getNumInputs()) {
+      throw CoreExceptionInit("Dataset has " +
+                              std::to_string(source_->getNumInputs()) +
+                              " inputs, program has " +
+                              std::to_string(inputIndexes_.size()));
+    }
+    numSequences_ = properties_.loop ? std::numeric_limits<uint64_t>::max()
+                                     : source_->getNumSamples();
+    slots_.resize(properties_.numSlots);
+    for (auto &s : slots_) {
+      s.inferenceVector = InferenceVector::Factory(
+          bufferMappings_, InferenceVector::DataSourceType::ZERO_FILL,
+          properties_.device);
+    }
+    for (uint32_t i = 0; i < properties_.numThreads; i++) {
+      workers_.emplace_back(&DatasetStreamer::prefetchLoop, this);
+    }
+  }
+
+  void prefetchLoop() {
+    if (properties_.device >= 0) {
+      QNumaPlacementManager::bindThreadToDevice(properties_.device);
+    }
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+      cv_.wait(lk, [this] {
+        return stopping_ || nextFill_ >= numSequences_ ||
+               slots_.at(nextFill_ % slots_.size()).state == SlotState::Free;
+      });
+      if (stopping_ || nextFill_ >= numSequences_) {
+        return;
+      }
+      const uint64_t seq = nextFill_++;
+      Slot &s = slots_.at(seq % slots_.size());
+      s.state = SlotState::Loading;
+      s.seq = seq;
+      lk.unlock();
+      QStatus status =
+          fillSlot(s.inferenceVector, seq % source_->getNumSamples());
+      lk.lock();
+      s.status = status;
+      s.state = SlotState::Ready;
+      numLoaded_++;
+      cv_.notify_all();
+    }
+  }
+
+  QStatus fillSlot(const shInferenceVector &inferenceVector,
+                   size_t sampleIndex) {
+    std::vector<QBuffer> buffers = inferenceVector->getVector();
+    for (uint32_t in = 0; in < inputIndexes_.size(); in++) {
+      const uint32_t idx = inputIndexes_.at(in);
+      const BufferMapping &mapping = bufferMappings_.at(idx);
+      size_t size = 0;
+      QStatus status = source_->readInput(sampleIndex, in, buffers.at(idx).buf,
+                                          mapping.size, size);
+      if (status != QS_SUCCESS) {
+        return status;
+      }
+      if (size != mapping.size && !mapping.isPartialBufferAllowed) {
+        logError("Sample " + std::to_string(sampleIndex) + " input " +
+                 mapping.bufferName + " has " + std::to_string(size) +
+                 " bytes, expected " + std::to_string(mapping.size));
+        return QS_INVAL;
+      }
+      buffers.at(idx).size = size;
+    }
+    return inferenceVector->setBuffers(buffers);
+  }
+
+  const BufferMappings bufferMappings_;
+  const shDatasetSource source_;
+  const DatasetStreamerProperties properties_;
+  std::vector<uint32_t> inputIndexes_;
+  std::vector<Slot> slots_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+  uint64_t numSequences_ = 0;
+  uint64_t nextFill_ = 0;
+  uint64_t nextDeliver_ = 0;
+  uint64_t numLoaded_ = 0;
+  uint64_t numStalls_ = 0;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_DATASET_HPP
@@ -0,0 +1,680 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_DEVICE_RECOVERY_HPP
+#define QAIC_OPENRT_DEVICE_RECOVERY_HPP
+
+#include "QAicOpenRtLogger.hpp"
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtProgram.hpp"
+#include "QAicRuntimeTypes.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief Properties used to configure a DeviceRecovery
+struct DeviceRecoveryProperties {
+  /// Maximum time acquire() waits for a program being recovered, 0 returns
+  /// QS_DEVICE_RECOVERING at once
+  std::chrono::milliseconds acquireTimeout = std::chrono::milliseconds(0);
+  /// Maximum time the recovery waits for the leases taken before the reset
+  /// to be returned before tearing the program down
+  std::chrono::milliseconds drainTimeout = std::chrono::milliseconds(10000);
+  /// Delay between two attempts to re-establish a program
+  std::chrono::milliseconds retryInterval = std::chrono::milliseconds(1000);
+  /// Attempts to re-establish a program before giving up until the next
+  /// reset of its device
+  uint32_t maxAttempts = 5;
+};
+
+/// \brief Re-establishes one program after a reset of its device. All but
+/// reestablish are required.
+struct DeviceRecoveryOps {
+  /// Drop what the reset left of the program, failures are logged only
+  std::function<QStatus()> teardown;
+  /// Load images and constants on device
+  std::function<QStatus()> load;
+  /// Make the program ready for execution
+  std::function<QStatus()> activate;
+  /// Rebuild the objects created from the program, e.g. ExecObjs
+  std::function<QStatus()> reestablish;
+};
+
+/// \brief Service state of a program
+enum class DeviceRecoveryState {
+  /// Leases are handed out
+  Serving,
+  /// The device was reset, waiting for it to come back
+  Down,
+  /// Being re-established in the background
+  Recovering,
+  /// Could not be re-established, waits for the next reset
+  Failed,
+};
+
+/// \brief Counters of a DeviceRecovery
+struct DeviceRecoveryStats {
+  /// Programs made unavailable by a reset of their device, or by the exit of
+  /// the process that loaded their images
+  uint64_t numResets = 0;
+  /// Programs re-established
+  uint64_t numRecovered = 0;
+  /// Programs given up after maxAttempts
+  uint64_t numFailed = 0;
+  /// Leases refused while a program was unavailable
+  uint64_t numRejected = 0;
+  /// Time from the reset to serving again of the last program recovered
+  std::chrono::microseconds lastRecoveryTime = std::chrono::microseconds(0);
+};
+
+/// \brief A DeviceRecovery keeps programs in service across resets of their
+/// device. Requests take a Lease on a program for as long as they use it.
+/// When a device goes down:
+/// - its programs stop handing out leases, acquire() returns
+///   QS_DEVICE_RECOVERING,
+/// - leases taken before are stale, Lease::check() turns the errors of
+///   work that ran on them into QS_DEVICE_RECOVERING so callers can tell a
+///   reset from a failed request and retry.
+///
+/// Once the device is back, a background thread waits for the stale leases
+/// to be returned, tears the programs down and loads, activates and
+/// re-establishes them, then hands out leases again.
+///
+/// Device events come from the device state monitor of the context, or
+/// from notifyDeviceEvent(). Creating a DeviceRecovery is the opt in,
+/// without one a reset leaves the programs in error.
+///
+/// A program attached to images another process loaded loses them when
+/// that process exits. It is recovered alone the same way, from
+/// notifyProgramLost() which programs added as such call themselves.
+///
+/// ExecObjs created from the program of a lease must be released with the
+/// lease, a program with ExecObjs cannot be deactivated.
+class DeviceRecovery : public Logger {
+  struct Entry;
+
+public:
+  using Clock = std::chrono::steady_clock;
+  using ProgramID = uint64_t;
+
+  /// \brief Holds one program in service. Returned on destruction or
+  /// reset(), an empty lease holds nothing.
+  class Lease {
+  public:
+    Lease() = default;
+    Lease(Lease &&other) noexcept = default;
+    Lease &operator=(Lease &&other) noexcept {
+      if (this != &other) {
+        reset();
+        entry_ = std::move(other.entry_);
+        generation_ = other.generation_;
+      }
+      return *this;
+    }
+    ~Lease() { reset(); }
+
+    explicit operator bool() const { return entry_ != nullptr; }
+
+    /// \brief Get the program held, null for an empty lease or a program
+    /// added with user provided operations only
+    shProgram getProgram() const { return entry_ ? entry_->program : nullptr; }
+
+    /// \brief Returns false once the device of the program was reset
+    bool isValid() const {
+      return entry_ && (entry_->generation == generation_);
+    }
+
+    /// \brief Map the status of work run on the lease. Work failing before
+    /// the reset is reported keeps its status.
+    /// \return QS_DEVICE_RECOVERING for a failure after the device was
+    /// reset, \p status otherwise
+    QStatus check(QStatus status) const {
+      if ((status != QS_SUCCESS) && entry_ && !isValid()) {
+        return QS_DEVICE_RECOVERING;
+      }
+      return status;
+    }
+
+    /// \brief Return the program, the lease becomes empty
+    void reset() {
+      if (!entry_) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lk(entry_->mutex);
+        entry_->numLeases--;
+      }
+      entry_->drainCv.notify_all();
+      entry_.reset();
+    }
+
+    Lease(const Lease &) = delete;            // Disable Copy Constructor
+    Lease &operator=(const Lease &) = delete; // Disable Assignment Operator
+
+  private:
+    friend class DeviceRecovery;
+    Lease(std::shared_ptr<Entry> entry, uint64_t generation)
+        : entry_(std::move(entry)), generation_(generation) {}
+
+    std::shared_ptr<Entry> entry_;
+    uint64_t generation_ = 0;
+  };
+
+  /// \brief Create a DeviceRecovery following the devices of a context
+  /// \param[in] context A previously created context
+  /// \param[in] properties DeviceRecovery properties
+  /// \return Shared pointer DeviceRecovery
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  static shDeviceRecovery Factory(
+      shContext context,
+      const DeviceRecoveryProperties &properties = DeviceRecoveryProperties()) {
+    if (!context || !context->getContext()) {
+      throw CoreExceptionInit("Invalid DeviceRecovery parameters");
+    }
+    shDeviceRecovery obj = Factory(properties);
+    obj->setContext(context);
+    obj->coreContext_ = context->getContext();
+    // Leases are stale before the ExecObjs report the device in error, and
+    // the programs are back out of error before they are loaded again
+    DeviceRecovery *self = obj.get();
+    obj->coreContext_->registerNotifyDeviceStateInfo(
+        downPriority, self, [self](std::shared_ptr<QDeviceStateInfo> event) {
+          if (event->deviceEvent() == DEVICE_DOWN) {
+            self->notifyDeviceEvent(event->qid(), DEVICE_DOWN);
+          }
+        });
+    obj->coreContext_->registerNotifyDeviceStateInfo(
+        upPriority, self, [self](std::shared_ptr<QDeviceStateInfo> event) {
+          if (event->deviceEvent() == DEVICE_UP) {
+            self->notifyDeviceEvent(event->qid(), DEVICE_UP);
+          }
+        });
+    return obj;
+  }
+
+  /// \brief Create a DeviceRecovery fed by notifyDeviceEvent() only
+  /// \param[in] properties DeviceRecovery properties
+  /// \return Shared pointer DeviceRecovery
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  static shDeviceRecovery Factory(
+      const DeviceRecoveryProperties &properties = DeviceRecoveryProperties()) {
+    shDeviceRecovery obj = shDeviceRecovery(new (std::nothrow)
+                                                DeviceRecovery(properties));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create DeviceRecovery Object");
+    }
+    obj->worker_ = std::thread(&DeviceRecovery::recoveryThread, obj.get());
+    return obj;
+  }
+
+  /// \brief Operations re-establishing a Program
+  static DeviceRecoveryOps programOps(shProgram program) {
+    DeviceRecoveryOps ops;
+    ops.teardown = [program]() {
+      QStatus status = program->deactivate();
+      QStatus unloadStatus = program->unload();
+      return (status != QS_SUCCESS) ? status : unloadStatus;
+    };
+    ops.load = [program]() { return program->load(); };
+    ops.activate = [program]() { return program->activate(); };
+    return ops;
+  }
+
+  /// \brief Destructor stops the recovery, programs are left as they are
+  ~DeviceRecovery() {
+    if (coreContext_) {
+      coreContext_->unRegisterNotifyDeviceStateInfo(this);
+    }
+    std::vector<std::shared_ptr<Entry>> entries;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      for (auto &it : entries_) {
+        entries.push_back(it.second);
+      }
+    }
+    for (auto &entry : entries) {
+      unwatch(*entry);
+    }
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      stopping_ = true;
+    }
+    workCv_.notify_all();
+    stateCv_.notify_all();
+    if (worker_.joinable()) {
+      worker_.join();
+    }
+  }
+
+  /// \brief Keep \p program in service on device \p dev, activated if
+  /// needed
+  /// \param[out] id Identifies the program in acquire()
+  /// \retval QS_SUCCESS Program serving
+  /// \retval QS_INVAL Invalid program
+  /// \retval Other The program failed to load or activate
+  QStatus add(QID dev, shProgram program, ProgramID &id) {
+    if (!program) {
+      return QS_INVAL;
+    }
+    return add(dev, programOps(program), id, program);
+  }
+
+  /// \brief Keep a program driven by \p ops in service on device \p dev
+  /// \param[in] program Optional program returned by the leases
+  /// \return See add(QID, shProgram, ProgramID &)
+  QStatus add(QID dev, DeviceRecoveryOps ops, ProgramID &id,
+              shProgram program = nullptr) {
+    if (!ops.teardown || !ops.load || !ops.activate) {
+      logError("Missing device recovery operations");
+      return QS_INVAL;
+    }
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->dev = dev;
+    entry->ops = std::move(ops);
+    entry->program = std::move(program);
+
+    std::lock_guard<std::mutex> opsLk(opsMutex_);
+    QStatus status = establish(*entry);
+    if (status != QS_SUCCESS) {
+      return status;
+    }
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      entry->id = nextId_++;
+      // A device down now is recovered with the programs it already holds
+      entry->state = devicesDown_.count(dev) ? DeviceRecoveryState::Down
+                                             : DeviceRecoveryState::Serving;
+      entries_[entry->id] = entry;
+      id = entry->id;
+    }
+    // Not under mutex_, the program holds its callback while calling it
+    if (entry->program && entry->program->getProgram()) {
+      DeviceRecovery *self = this;
+      const ProgramID programId = entry->id;
+      entry->program->getProgram()->setSharedImageLostCallback(
+          [self, programId]() { self->notifyProgramLost(programId); });
+    }
+    return QS_SUCCESS;
+  }
+
+  /// \brief Stop keeping a program in service, waits up to drainTimeout
+  /// for its leases and tears it down
+  /// \retval QS_SUCCESS Program removed
+  /// \retval QS_INVAL Unknown program
+  /// \retval QS_TIMEDOUT Leases outstanding, the program is removed but not
+  /// torn down
+  QStatus remove(ProgramID id) {
+    std::lock_guard<std::mutex> opsLk(opsMutex_);
+    std::shared_ptr<Entry> entry;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      auto it = entries_.find(id);
+      if (it == entries_.end()) {
+        return QS_INVAL;
+      }
+      entry = it->second;
+      entries_.erase(it);
+    }
+    stateCv_.notify_all();
+    unwatch(*entry);
+    if (!drain(*entry, properties_.drainTimeout)) {
+      logError("Removing program " + std::to_string(id) +
+               " with leases outstanding");
+      return QS_TIMEDOUT;
+    }
+    teardown(*entry);
+    return QS_SUCCESS;
+  }
+
+  /// \brief Take a lease on a program. While the program is recovered,
+  /// waits up to acquireTimeout.
+  /// \param[out] status
+  /// - QS_SUCCESS The lease holds the program
+  /// - QS_DEVICE_RECOVERING The device was reset and the program is not
+  ///   back yet, retry later
+  /// - QS_DEV_ERROR The program could not be re-established
+  /// - QS_INVAL Unknown program, or the DeviceRecovery is being destroyed
+  /// \return Lease, empty unless status is QS_SUCCESS
+  Lease acquire(ProgramID id, QStatus &status) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    std::shared_ptr<Entry> entry;
+    stateCv_.wait_for(lk, properties_.acquireTimeout, [&] {
+      auto it = entries_.find(id);
+      entry = (it == entries_.end() || stopping_) ? nullptr : it->second;
+      return !entry || (entry->state == DeviceRecoveryState::Serving) ||
+             (entry->state == DeviceRecoveryState::Failed);
+    });
+    if (!entry) {
+      status = QS_INVAL;
+      return Lease();
+    }
+    if (entry->state != DeviceRecoveryState::Serving) {
+      stats_.numRejected++;
+      status = (entry->state == DeviceRecoveryState::Failed)
+                   ? QS_DEV_ERROR
+                   : QS_DEVICE_RECOVERING;
+      return Lease();
+    }
+    {
+      std::lock_guard<std::mutex> entryLk(entry->mutex);
+      entry->numLeases++;
+    }
+    status = QS_SUCCESS;
+    return Lease(entry, entry->generation);
+  }
+
+  /// \brief Handle a state change of device \p dev. DEVICE_DOWN makes its
+  /// programs unavailable, DEVICE_UP starts their recovery, other events
+  /// are ignored.
+  void notifyDeviceEvent(QID dev, QDeviceStateInfoEvent event) {
+    if (event == DEVICE_DOWN) {
+      deviceDown(dev);
+    } else if (event == DEVICE_UP) {
+      deviceUp(dev);
+    }
+  }
+
+  /// \brief Handle the loss of images program \p id was attached to, with
+  /// the process that loaded them. Its leases are stale and it is recovered
+  /// in the background, loading the images again.
+  void notifyProgramLost(ProgramID id) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      auto it = entries_.find(id);
+      // Recovered anyway when not serving
+      if ((it == entries_.end()) ||
+          (it->second->state != DeviceRecoveryState::Serving)) {
+        return;
+      }
+      Entry &entry = *it->second;
+      entry.downTime = Clock::now();
+      entry.state = DeviceRecoveryState::Down;
+      entry.generation++;
+      stats_.numResets++;
+      pendingPrograms_.push_back(id);
+    }
+    logWarn("Program " + std::to_string(id) +
+            " lost images of an exited process, recovering it");
+    stateCv_.notify_all();
+    workCv_.notify_all();
+  }
+
+  /// \brief Get the state of a program
+  /// \retval QS_INVAL Unknown program
+  QStatus getState(ProgramID id, DeviceRecoveryState &state) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+      return QS_INVAL;
+    }
+    state = it->second->state;
+    return QS_SUCCESS;
+  }
+
+  /// \brief Get the recovery counters
+  DeviceRecoveryStats getStats() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return stats_;
+  }
+
+  DeviceRecovery(const DeviceRecovery &) = delete; // Disable Copy Constructor
+  DeviceRecovery &
+  operator=(const DeviceRecovery &) = delete; // Disable Assignment Operator
+
+private:
+  struct Entry {
+    ProgramID id = 0;
+    QID dev = 0;
+    DeviceRecoveryOps ops;
+    shProgram program;
+    // Guarded by mutex_ of the DeviceRecovery
+    DeviceRecoveryState state = DeviceRecoveryState::Serving;
+    Clock::time_point downTime;
+    // Bumped by every reset, leases of older generations are stale
+    std::atomic<uint64_t> generation{0};
+    std::mutex mutex;
+    std::condition_variable drainCv;
+    uint32_t numLeases = 0;
+  };
+
+  // Around the priority of the programs, notified from the highest
+  static constexpr NotifyDeviceStateInfoPriority downPriority = 5;
+  static constexpr NotifyDeviceStateInfoPriority upPriority = 1;
+
+  explicit DeviceRecovery(const DeviceRecoveryProperties &properties)
+      : properties_(properties) {}
+
+  void deviceDown(QID dev) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (!devicesDown_.insert(dev).second) {
+        return;
+      }
+      const Clock::time_point now = Clock::now();
+      for (auto &it : entries_) {
+        Entry &entry = *it.second;
+        if (entry.dev != dev) {
+          continue;
+        }
+        if (entry.state != DeviceRecoveryState::Down) {
+          entry.downTime = now;
+        }
+        entry.state = DeviceRecoveryState::Down;
+        entry.generation++;
+        stats_.numResets++;
+      }
+    }
+    logWarn("Device " + std::to_string(dev) +
+            " is down, its programs are unavailable");
+    stateCv_.notify_all();
+  }
+
+  void deviceUp(QID dev) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      devicesDown_.erase(dev);
+      pending_.push_back(dev);
+    }
+    workCv_.notify_all();
+  }
+
+  void recoveryThread() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+      workCv_.wait(lk, [this] {
+        return stopping_ || !pending_.empty() || !pendingPrograms_.empty();
+      });
+      if (stopping_) {
+        return;
+      }
+      if (!pending_.empty()) {
+        QID dev = pending_.front();
+        pending_.pop_front();
+        lk.unlock();
+        recoverDevice(dev);
+      } else {
+        ProgramID id = pendingPrograms_.front();
+        pendingPrograms_.pop_front();
+        lk.unlock();
+        recoverProgram(id);
+      }
+      lk.lock();
+    }
+  }
+
+  void recoverProgram(ProgramID id) {
+    std::lock_guard<std::mutex> opsLk(opsMutex_);
+    std::shared_ptr<Entry> entry;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      auto it = entries_.find(id);
+      // A device down meanwhile recovers it once back up
+      if ((it == entries_.end()) ||
+          (it->second->state != DeviceRecoveryState::Down) ||
+          devicesDown_.count(it->second->dev)) {
+        return;
+      }
+      entry = it->second;
+      entry->state = DeviceRecoveryState::Recovering;
+    }
+    recover(entry);
+  }
+
+  void recoverDevice(QID dev) {
+    std::lock_guard<std::mutex> opsLk(opsMutex_);
+    std::vector<std::shared_ptr<Entry>> entries;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      for (auto &it : entries_) {
+        if ((it.second->dev == dev) &&
+            ((it.second->state == DeviceRecoveryState::Down) ||
+             (it.second->state == DeviceRecoveryState::Failed))) {
+          it.second->state = DeviceRecoveryState::Recovering;
+          entries.push_back(it.second);
+        }
+      }
+    }
+    logInfo("Device " + std::to_string(dev) + " is up, recovering " +
+            std::to_string(entries.size()) + " programs");
+    for (auto &entry : entries) {
+      recover(entry);
+    }
+  }
+
+  // Called with opsMutex_ held
+  void recover(const std::shared_ptr<Entry> &entry) {
+    // Work on the stale leases fails without the device, so they are
+    // expected back soon
+    if (!drain(*entry, properties_.drainTimeout)) {
+      logWarn("Program " + std::to_string(entry->id) +
+              " recovered with stale leases outstanding");
+    }
+    teardown(*entry);
+
+    QStatus status = QS_ERROR;
+    for (uint32_t attempt = 0; attempt < properties_.maxAttempts; attempt++) {
+      if (attempt != 0) {
+        std::unique_lock<std::mutex> lk(mutex_);
+        stateCv_.wait_for(lk, properties_.retryInterval,
+                          [this] { return stopping_; });
+      }
+      if (isInterrupted(*entry)) {
+        return;
+      }
+      status = establish(*entry);
+      if (status == QS_SUCCESS) {
+        break;
+      }
+      logWarn("Attempt " + std::to_string(attempt + 1) +
+              " to recover program " + std::to_string(entry->id) +
+              " failed");
+      teardown(*entry);
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (entry->state != DeviceRecoveryState::Recovering) {
+        // Reset again or removed while establishing
+        return;
+      }
+      if (status == QS_SUCCESS) {
+        entry->state = DeviceRecoveryState::Serving;
+        stats_.numRecovered++;
+        stats_.lastRecoveryTime =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - entry->downTime);
+      } else {
+        entry->state = DeviceRecoveryState::Failed;
+        stats_.numFailed++;
+      }
+    }
+    if (status == QS_SUCCESS) {
+      logInfo("Program " + std::to_string(entry->id) + " recovered");
+    } else {
+      logError("Failed to recover program " + std::to_string(entry->id));
+    }
+    stateCv_.notify_all();
+  }
+
+  // The device went down again, the program was removed or the
+  // DeviceRecovery is being destroyed
+  bool isInterrupted(const Entry &entry) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return stopping_ || (entry.state != DeviceRecoveryState::Recovering);
+  }
+
+  QStatus establish(Entry &entry) {
+    QStatus status = entry.ops.load();
+    if (status == QS_SUCCESS) {
+      status = entry.ops.activate();
+    }
+    if ((status == QS_SUCCESS) && entry.ops.reestablish) {
+      status = entry.ops.reestablish();
+    }
+    if (status != QS_SUCCESS) {
+      logError("Failed to establish program on device " +
+               std::to_string(entry.dev));
+    }
+    return status;
+  }
+
+  static void unwatch(Entry &entry) {
+    if (entry.program && entry.program->getProgram()) {
+      entry.program->getProgram()->setSharedImageLostCallback(nullptr);
+    }
+  }
+
+  void teardown(Entry &entry) {
+    if (entry.ops.teardown() != QS_SUCCESS) {
+      // Expected for what the reset already dropped
+      logInfo("Program " + std::to_string(entry.id) +
+              " was not fully torn down");
+    }
+  }
+
+  static bool drain(Entry &entry, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lk(entry.mutex);
+    return entry.drainCv.wait_for(lk, timeout,
+                                  [&entry] { return entry.numLeases == 0; });
+  }
+
+  const DeviceRecoveryProperties properties_;
+  shQContext coreContext_;
+  // Serializes add(), remove() and the recovery of programs
+  std::mutex opsMutex_;
+  // Guards entries_, the state of the entries, devicesDown_, pending_,
+  // pendingPrograms_, stats_ and stopping_
+  std::mutex mutex_;
+  std::condition_variable stateCv_;
+  std::condition_variable workCv_;
+  std::map<ProgramID, std::shared_ptr<Entry>> entries_;
+  std::set<QID> devicesDown_;
+  std::deque<QID> pending_;
+  std::deque<ProgramID> pendingPrograms_;
+  DeviceRecoveryStats stats_;
+  bool stopping_ = false;
+  ProgramID nextId_ = 1;
+  std::thread worker_;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_DEVICE_RECOVERY_HPP
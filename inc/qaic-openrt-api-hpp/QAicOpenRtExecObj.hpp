@@ -10,6 +10,7 @@
 #include "QAicOpenRtInferenceVector.hpp"
 #include "QAicRuntimeTypes.h"
 #include "QAicOpenRtProgram.hpp"
+#include "QAicOpenRtTrafficRecorder.hpp"
 #include "QExecObj.h"
 
 namespace qaic {
@@ -146,8 +147,89 @@ public:
   /// - Invalid qBufferVect size
   /// - Invalid qBufferVect buffers
   /// - Invalid associated internal execObj
+  /// \retval QS_DEADLINE_EXCEEDED The deadline passed before submission or
+  /// while waiting for the inference
+  /// \retval QS_CANCELED Canceled before submission
+  /// \retval QS_BUSY The ExecObj is already running
   /// \retval QS_ERROR Failed to run the ExecObj
-  QStatus run() const { return execobj_->run(); }
+  QStatus run() const {
+    if (!trafficRecorder_) {
+      return execobj_->run();
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    const QStatus status = execobj_->run();
+    trafficRecorder_->record(id_, begin, std::chrono::steady_clock::now(),
+                             status, userBuffers_, trafficInputIndices_);
+    return status;
+  }
+
+  /// \brief Submit an inference without waiting for its completion
+  /// \param[in] done Called from a runtime completion thread with the status
+  /// of the inference, once outputs are available. The ExecObj must not be
+  /// released or run again before \a done is called.
+  /// \retval QS_SUCCESS The inference was submitted
+  /// \retval QS_INVAL Invalid callback or program state
+  /// \retval QS_ERROR Failed to submit the inference
+  QStatus runAsync(std::function<void(QStatus)> done) const {
+    if (!trafficRecorder_ || !done) {
+      return execobj_->runAsync(std::move(done));
+    }
+    // Recorded by the submitting thread with the inputs as submitted,
+    // setData may replace them before done is called on a completion
+    // thread
+    auto request = std::make_shared<TrafficRequest>(
+        trafficRecorder_->beginRequest(id_, userBuffers_,
+                                       trafficInputIndices_));
+    const QStatus status = execobj_->runAsync(
+        [done = std::move(done), recorder = trafficRecorder_,
+         request](QStatus waitStatus) {
+          recorder->endRequest(std::move(*request), waitStatus);
+          done(waitStatus);
+        });
+    // done is not called for a run that was not submitted
+    if (status != QS_SUCCESS) {
+      trafficRecorder_->endRequest(std::move(*request), status);
+    }
+    return status;
+  }
+
+  /// \brief Set the deadline of the following runs. A run is dropped with
+  /// QS_DEADLINE_EXCEEDED if the deadline passed before its pre-processing
+  /// or its submission, and run() stops waiting for the inference at the
+  /// deadline. The inference then still completes on the device, the next
+  /// run waits for it first.
+  /// \param[in] deadline Deadline, time_point::max() for none
+  void setDeadline(std::chrono::steady_clock::time_point deadline) {
+    execobj_->setDeadline(deadline);
+  }
+
+  /// \brief Remove the deadline of the following runs
+  void clearDeadline() {
+    execobj_->setDeadline(std::chrono::steady_clock::time_point::max());
+  }
+
+  /// \brief Record the following runs of this ExecObj, see TrafficRecorder.
+  /// Set while the ExecObj is not running.
+  /// \param[in] recorder Recorder shared by any number of ExecObjs, null to
+  /// stop recording
+  void setTrafficRecorder(shTrafficRecorder recorder) {
+    trafficInputIndices_.clear();
+    if (recorder) {
+      for (const auto &mapping : program_->getBufferMappings()) {
+        if (mapping.ioType == QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT) {
+          trafficInputIndices_.push_back(mapping.index);
+        }
+      }
+    }
+    trafficRecorder_ = std::move(recorder);
+  }
+
+  /// \brief Cancel a run, from another thread, as long as its inference was
+  /// not submitted. The run returns QS_CANCELED.
+  /// \retval QS_SUCCESS The run will not submit
+  /// \retval QS_BUSY The inference is on the device already
+  /// \retval QS_INVAL The ExecObj is not running
+  QStatus cancel() const { return execobj_->cancel(); }
 
   ExecObj(const ExecObj &) = delete;            // Disable Copy Constructor
   ExecObj &operator=(const ExecObj &) = delete; // Disable Assignment Operator
@@ -195,6 +277,9 @@ private:
   std::vector<QBuffer> userBuffers_;
   BufferType bufferType_;
   uint32_t id_;
+  shTrafficRecorder trafficRecorder_;
+  // Buffers recorded as program inputs
+  std::vector<uint32_t> trafficInputIndices_;
 };
 ///\}
 } // namespace rt
@@ -5,33 +5,123 @@
 #define QAIC_OPENRT_FILE_WRITER_HPP
 
 #include "QLogger.h"
+#include "QAicOpenRtLogger.hpp"
 #include "QAicOpenRtExceptions.hpp"
 #include "QAicOpenRtApiFwdDecl.hpp"
 #include "QAicRuntimeTypes.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 namespace qaic {
 namespace openrt {
 
+/// \brief Layout of the outputs written by FileWriter
+enum class FileWriterFormat {
+  /// One file per output buffer and inference
+  FilePerOutput,
+  /// All outputs appended to a single file followed by an index
+  Packed,
+};
+
+/// \brief FileWriter configuration
+struct FileWriterProperties {
+  /// Copy outputs to a queue and write them from a background thread
+  bool async = false;
+  /// Bytes of outputs queued before writeExecObjData blocks
+  size_t maxQueuedBytes = 256 * 1024 * 1024;
+  FileWriterFormat format = FileWriterFormat::FilePerOutput;
+  /// Name of the packed file, in the output path
+  std::string packedFileName = "outputs.qout";
+  /// Write the packed file with O_DIRECT, falling back to buffered writes
+  /// on file systems that do not support it
+  bool directIo = false;
+};
+
 /// \brief File Writing utility provides capabilites to dump contents
 /// of ExecObj buffer to file
+///
+/// Packed files hold a header block, the outputs in write order each
+/// aligned to 64 bytes, then an index of one entry per output and the
+/// table of the output names. The header and the index are written by
+/// close(), in host byte order.
 class FileWriter : public Logger {
 public:
+  static constexpr uint32_t packedMagic = 0x54554F51; // "QOUT"
+  static constexpr uint32_t packedFormatVersion = 1;
+  static constexpr uint64_t packedAlignment = 64;
+  /// Header block size, also the O_DIRECT write granularity
+  static constexpr uint64_t packedBlockSize = 4096;
+
+  struct PackedHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint64_t numEntries;
+    uint32_t numNames;
+    uint32_t reserved;
+    uint64_t indexOffset;
+  };
+
+  struct PackedEntry {
+    uint64_t infNumber;
+    uint32_t nameIndex;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+  };
+
   FileWriter(const std::string outputBasePath = ".")
       : outputBasePath_(outputBasePath) {}
-  ~FileWriter() = default;
+  ~FileWriter() { (void)close(); }
 
-  /// \brief Set the base path for files being written
+  /// \brief Set the base path for files being written. A packed file in
+  /// progress is closed first.
   /// \param[in] path Output path
   /// \retval QS_SUCCESS Successful completion
   /// \retval QS_ERROR Inaccessible outputBasePath
   QStatus setOutputPath(const std::string &outputBasePath) {
-    std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
     if (access(outputBasePath.c_str(), W_OK) != 0) {
       logError("Unable to set path to " + outputBasePath + " Not accessible");
       return QS_ERROR;
     }
+    QStatus status = close();
+    std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
     outputBasePath_ = outputBasePath;
-    return QS_SUCCESS;
+    return status;
+  }
+
+  /// \brief Configure how outputs are written. Outputs queued or packed
+  /// with the previous properties are written out first.
+  /// \param[in] properties Writer properties
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Zero maxQueuedBytes or empty packedFileName
+  /// \retval QS_ERROR Writing out the previous outputs failed
+  QStatus setProperties(const FileWriterProperties &properties) {
+    if (properties.maxQueuedBytes == 0 ||
+        (properties.format == FileWriterFormat::Packed &&
+         properties.packedFileName.empty())) {
+      logError("Invalid FileWriter properties");
+      return QS_INVAL;
+    }
+    QStatus status = close();
+    std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
+    properties_ = properties;
+    return status;
   }
 
   /// \brief Write contents of Qbuffers with inference output data to file
@@ -48,14 +138,28 @@ public:
   /// \retval QS_ERROR Due to either of the below
   /// - QBuffers vector provided does not meet network requirements
   /// - Failed to open file to write output data
+  /// - In async mode, an earlier queued write failed
   QStatus writeExecObjData(const qaic::openrt::shExecObj &execObj,
                            const BufferMappings &bufferMappings,
                            const uint32_t &infNumber,
                            const bool &verbose = true,
                            const std::string &fileNameAppendString = "") {
-    std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
     std::vector<QBuffer> buffers;
     execObj->getData(buffers);
+    return writeBuffers(buffers, bufferMappings, infNumber, verbose,
+                        fileNameAppendString);
+  }
+
+  /// \brief Write the output buffers of an inference, see writeExecObjData.
+  /// In async mode the outputs are copied, so the buffers can be reused as
+  /// soon as this returns. It blocks only while the queue is full.
+  QStatus writeBuffers(const std::vector<QBuffer> &buffers,
+                       const BufferMappings &bufferMappings,
+                       const uint32_t &infNumber, const bool &verbose = true,
+                       const std::string &fileNameAppendString = "") {
+    std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
+    std::vector<Job> jobs;
+    size_t jobBytes = 0;
     for (uint32_t idx = 0; idx < bufferMappings.size(); idx++) {
       if (bufferMappings.at(idx).ioType ==
           QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT) {
@@ -73,32 +177,484 @@ public:
           logError("User Buffer is not updated");
           return QS_ERROR;
         }
-        std::string filename = outputName + fileNameAppendString + "-inf-" +
-                               std::to_string(infNumber) + ".bin";
-        std::string filepath = outputBasePath_ + "/" + filename;
-        std::ofstream outfile;
-        outfile.open(filepath, std::ios::binary | std::ios::out);
-        if (verbose) {
-          std::cout << "Writing file:" << filepath << std::endl;
-        }
-        if (!outfile.is_open()) {
-          logError("Failed to open file: " + filepath);
-          return QS_ERROR;
+        Job job;
+        job.name = outputName + fileNameAppendString;
+        job.infNumber = infNumber;
+        job.verbose = verbose;
+        job.src = buffers.at(buffIndex).buf;
+        job.size = buffers.at(buffIndex).size;
+        jobBytes += job.size;
+        jobs.push_back(std::move(job));
+      }
+    }
+
+    if (!properties_.async) {
+      for (auto &job : jobs) {
+        QStatus status = writeJob(job);
+        if (status != QS_SUCCESS) {
+          return status;
         }
-        outfile.write((char *)buffers.at(buffIndex).buf,
-                      buffers.at(buffIndex).size);
-        outfile.flush();
-        outfile.close();
       }
+      return QS_SUCCESS;
     }
+
+    if (asyncStatus_ != QS_SUCCESS) {
+      return asyncStatus_;
+    }
+    // Back-pressure, an inference larger than the whole queue is still
+    // accepted once the queue drained
+    if (queuedBytes_ > 0 &&
+        queuedBytes_ + jobBytes > properties_.maxQueuedBytes) {
+      numStalls_++;
+      spaceCv_.wait(lock, [&] {
+        return queuedBytes_ == 0 ||
+               queuedBytes_ + jobBytes <= properties_.maxQueuedBytes;
+      });
+    }
+    for (auto &job : jobs) {
+      job.data = takeBuffer();
+      job.data.assign(job.src, job.src + job.size);
+      job.src = nullptr;
+      queue_.push_back(std::move(job));
+    }
+    queuedBytes_ += jobBytes;
+    if (!writer_.joinable()) {
+      stop_ = false;
+      writer_ = std::thread(&FileWriter::writerLoop, this);
+    }
+    workCv_.notify_one();
     return QS_SUCCESS;
   }
+
+  /// \brief Wait until every queued output has been handed to the file
+  /// system. The tail of a packed file stays buffered until close().
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_ERROR A queued write failed
+  QStatus flush() {
+    std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
+    spaceCv_.wait(lock, [&] { return queue_.empty() && !writing_; });
+    return asyncStatus_;
+  }
+
+  /// \brief Flush, stop the background writer and complete the packed file.
+  /// The next write starts a new packed file.
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_ERROR A write failed
+  QStatus close() {
+    QStatus status = flush();
+    std::thread writer;
+    {
+      std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
+      stop_ = true;
+      writer = std::move(writer_);
+    }
+    workCv_.notify_all();
+    if (writer.joinable()) {
+      writer.join();
+    }
+    std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
+    if (packedFd_ >= 0) {
+      QStatus packedStatus = closePacked();
+      if (status == QS_SUCCESS) {
+        status = packedStatus;
+      }
+    }
+    asyncStatus_ = QS_SUCCESS;
+    return status;
+  }
+
+  /// \brief Get the bytes written and the number of writes that waited
+  /// on a full queue
+  void getStats(uint64_t &bytesWritten, uint64_t &stalls) {
+    std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
+    bytesWritten = bytesWritten_;
+    stalls = numStalls_;
+  }
+
+  /// \brief Read the index of a packed file. The output of an entry is
+  /// entry.size bytes at entry.offset.
+  /// \param[in] path Packed file
+  /// \param[out] names Output names, indexed by PackedEntry::nameIndex
+  /// \param[out] entries One entry per output, in write order
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_ERROR The file cannot be read or is malformed
+  static QStatus readPackedIndex(const std::string &path,
+                                 std::vector<std::string> &names,
+                                 std::vector<PackedEntry> &entries) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return QS_ERROR;
+    }
+    QStatus status = readPackedTail(fd, names, entries);
+    ::close(fd);
+    return status;
+  }
+
   FileWriter(const FileWriter &) = delete; // Disable Copy Constructor
   FileWriter &
   operator=(const FileWriter &) = delete; // Disable Assignment Operator
 private:
+  struct Job {
+    std::string name;
+    uint32_t infNumber = 0;
+    bool verbose = false;
+    // Caller buffer when writing synchronously, otherwise data holds a copy
+    const uint8_t *src = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> data;
+  };
+
+  static constexpr size_t stagingSize = 1024 * 1024;
+  static constexpr size_t maxFreeBuffers = 16;
+
+  // Called with the lock held
+  std::vector<uint8_t> takeBuffer() {
+    if (freeBuffers_.empty()) {
+      return std::vector<uint8_t>();
+    }
+    std::vector<uint8_t> buffer = std::move(freeBuffers_.back());
+    freeBuffers_.pop_back();
+    return buffer;
+  }
+
+  // Writes run outside the lock, the writer thread is the only one touching
+  // the packed file state until close() joins it
+  void writerLoop() {
+    std::unique_lock<std::mutex> lock(writeExecObjDataMutex_);
+    while (true) {
+      workCv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      // Take every queued output at once, so that small outputs are
+      // coalesced in the packed staging buffer
+      std::deque<Job> batch;
+      batch.swap(queue_);
+      writing_ = true;
+      // Outputs queued after a failed write are dropped
+      QStatus status = asyncStatus_;
+      lock.unlock();
+      for (auto &job : batch) {
+        if (status == QS_SUCCESS) {
+          status = writeJob(job);
+        }
+      }
+      lock.lock();
+      for (auto &job : batch) {
+        queuedBytes_ -= job.size;
+        if (freeBuffers_.size() < maxFreeBuffers) {
+          freeBuffers_.push_back(std::move(job.data));
+        }
+      }
+      if (status != QS_SUCCESS && asyncStatus_ == QS_SUCCESS) {
+        asyncStatus_ = status;
+      }
+      writing_ = false;
+      spaceCv_.notify_all();
+    }
+  }
+
+  QStatus writeJob(const Job &job) {
+    const uint8_t *data = job.src ? job.src : job.data.data();
+    if (properties_.format == FileWriterFormat::Packed) {
+      return appendPacked(job, data);
+    }
+    std::string filename =
+        job.name + "-inf-" + std::to_string(job.infNumber) + ".bin";
+    std::string filepath = outputBasePath_ + "/" + filename;
+    if (job.verbose) {
+      std::cout << "Writing file:" << filepath << std::endl;
+    }
+    int fd = open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+    if (fd < 0) {
+      logError("Failed to open file: " + filepath);
+      return QS_ERROR;
+    }
+    bool ok = writeAll(fd, data, job.size, -1);
+    ok = (::close(fd) == 0) && ok;
+    if (!ok) {
+      logError("Failed to write file: " + filepath);
+      return QS_ERROR;
+    }
+    bytesWritten_ += job.size;
+    return QS_SUCCESS;
+  }
+
+  // Writes at offset, or at the file position when offset is negative
+  static bool writeAll(int fd, const uint8_t *data, size_t size,
+                       off_t offset) {
+    while (size > 0) {
+      ssize_t n = (offset < 0) ? ::write(fd, data, size)
+                               : pwrite(fd, data, size, offset);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      data += n;
+      size -= static_cast<size_t>(n);
+      if (offset >= 0) {
+        offset += n;
+      }
+    }
+    return true;
+  }
+
+  QStatus openPacked(bool verbose) {
+    packedPath_ = outputBasePath_ + "/" + properties_.packedFileName;
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    packedDirect_ = false;
+    if (properties_.directIo) {
+      packedFd_ = open(packedPath_.c_str(), flags | O_DIRECT, 0644);
+      if (packedFd_ >= 0) {
+        packedDirect_ = true;
+      } else {
+        logWarn("O_DIRECT not supported for " + packedPath_ +
+                ", using buffered writes");
+      }
+    }
+    if (packedFd_ < 0) {
+      packedFd_ = open(packedPath_.c_str(), flags, 0644);
+    }
+    if (packedFd_ < 0) {
+      logError("Failed to open file: " + packedPath_);
+      return QS_ERROR;
+    }
+    if (staging_ == nullptr &&
+        posix_memalign(reinterpret_cast<void **>(&staging_), packedBlockSize,
+                       stagingSize) != 0) {
+      staging_ = nullptr;
+      ::close(packedFd_);
+      packedFd_ = -1;
+      logError("Failed to allocate staging buffer");
+      return QS_ERROR;
+    }
+    // The header block is reserved here and written by closePacked()
+    std::memset(staging_, 0, packedBlockSize);
+    stagingUsed_ = packedBlockSize;
+    stagingOffset_ = 0;
+    packedSize_ = packedBlockSize;
+    packedEntries_.clear();
+    packedNames_.clear();
+    packedNameIndex_.clear();
+    if (verbose) {
+      std::cout << "Writing file:" << packedPath_ << std::endl;
+    }
+    return QS_SUCCESS;
+  }
+
+  // Staging flushes are whole blocks, keeping O_DIRECT writes aligned
+  bool flushStaging(bool final) {
+    size_t size = stagingUsed_;
+    if (!final) {
+      size -= size % packedBlockSize;
+    } else if (packedDirect_) {
+      size = (size + packedBlockSize - 1) & ~(packedBlockSize - 1);
+      std::memset(staging_ + stagingUsed_, 0, size - stagingUsed_);
+    }
+    if (size == 0) {
+      return true;
+    }
+    if (!writeAll(packedFd_, staging_, size,
+                  static_cast<off_t>(stagingOffset_))) {
+      return false;
+    }
+    stagingOffset_ += size;
+    const size_t rest = (size < stagingUsed_) ? stagingUsed_ - size : 0;
+    std::memmove(staging_, staging_ + size, rest);
+    stagingUsed_ = rest;
+    return true;
+  }
+
+  QStatus appendPacked(const Job &job, const uint8_t *data) {
+    if (packedFd_ < 0) {
+      QStatus status = openPacked(job.verbose);
+      if (status != QS_SUCCESS) {
+        return status;
+      }
+    }
+    auto it = packedNameIndex_.find(job.name);
+    if (it == packedNameIndex_.end()) {
+      it = packedNameIndex_
+               .emplace(job.name, static_cast<uint32_t>(packedNames_.size()))
+               .first;
+      packedNames_.push_back(job.name);
+    }
+
+    const uint64_t offset =
+        (packedSize_ + packedAlignment - 1) & ~(packedAlignment - 1);
+    size_t pad = static_cast<size_t>(offset - packedSize_);
+    size_t size = job.size;
+    // Large outputs bypass the staging buffer when not writing O_DIRECT
+    if (!packedDirect_ && size >= stagingSize) {
+      if (!flushStaging(true)) {
+        return failPacked();
+      }
+      stagingOffset_ = offset;
+      if (!writeAll(packedFd_, data, size, static_cast<off_t>(offset))) {
+        return failPacked();
+      }
+      stagingOffset_ += size;
+      pad = 0;
+      size = 0;
+    }
+    while (pad > 0 || size > 0) {
+      if (stagingUsed_ == stagingSize && !flushStaging(false)) {
+        return failPacked();
+      }
+      const size_t room = stagingSize - stagingUsed_;
+      const size_t n = std::min(room, pad > 0 ? pad : size);
+      if (pad > 0) {
+        std::memset(staging_ + stagingUsed_, 0, n);
+        pad -= n;
+      } else {
+        std::memcpy(staging_ + stagingUsed_, data, n);
+        data += n;
+        size -= n;
+      }
+      stagingUsed_ += n;
+    }
+    packedEntries_.push_back({job.infNumber, it->second, 0, offset, job.size});
+    packedSize_ = offset + job.size;
+    bytesWritten_ += job.size;
+    return QS_SUCCESS;
+  }
+
+  QStatus failPacked() {
+    logError("Failed to write file: " + packedPath_);
+    return QS_ERROR;
+  }
+
+  // Called once the writer thread is stopped
+  QStatus closePacked() {
+    bool ok = flushStaging(true);
+    ::close(packedFd_);
+    packedFd_ = -1;
+    free(staging_);
+    staging_ = nullptr;
+    // The index is written with buffered I/O, after the padding of the last
+    // O_DIRECT block is cut off
+    int fd = ok ? open(packedPath_.c_str(), O_WRONLY | O_CLOEXEC) : -1;
+    ok = (fd >= 0) && (ftruncate(fd, static_cast<off_t>(packedSize_)) == 0);
+    const uint64_t indexOffset =
+        (packedSize_ + packedAlignment - 1) & ~(packedAlignment - 1);
+    std::vector<uint8_t> tail;
+    auto append = [&tail](const void *p, size_t n) {
+      const uint8_t *b = static_cast<const uint8_t *>(p);
+      tail.insert(tail.end(), b, b + n);
+    };
+    tail.resize(indexOffset - packedSize_);
+    append(packedEntries_.data(), packedEntries_.size() * sizeof(PackedEntry));
+    for (const auto &name : packedNames_) {
+      const uint32_t length = static_cast<uint32_t>(name.size());
+      append(&length, sizeof(length));
+      append(name.data(), name.size());
+    }
+    PackedHeader header{packedMagic,
+                        packedFormatVersion,
+                        packedEntries_.size(),
+                        static_cast<uint32_t>(packedNames_.size()),
+                        0,
+                        indexOffset};
+    ok = ok &&
+         writeAll(fd, tail.data(), tail.size(),
+                  static_cast<off_t>(packedSize_)) &&
+         writeAll(fd, reinterpret_cast<const uint8_t *>(&header),
+                  sizeof(header), 0);
+    if (fd >= 0) {
+      ok = (::close(fd) == 0) && ok;
+    }
+    if (!ok) {
+      return failPacked();
+    }
+    return QS_SUCCESS;
+  }
+
+  static QStatus readPackedTail(int fd, std::vector<std::string> &names,
+                                std::vector<PackedEntry> &entries) {
+    struct stat st;
+    PackedHeader header;
+    if (fstat(fd, &st) != 0 ||
+        pread(fd, &header, sizeof(header), 0) !=
+            static_cast<ssize_t>(sizeof(header)) ||
+        header.magic != packedMagic ||
+        header.formatVersion != packedFormatVersion) {
+      return QS_ERROR;
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+    if (header.indexOffset < packedBlockSize ||
+        header.indexOffset > fileSize ||
+        header.numEntries >
+            (fileSize - header.indexOffset) / sizeof(PackedEntry)) {
+      return QS_ERROR;
+    }
+    std::vector<uint8_t> tail(fileSize - header.indexOffset);
+    if (pread(fd, tail.data(), tail.size(),
+              static_cast<off_t>(header.indexOffset)) !=
+        static_cast<ssize_t>(tail.size())) {
+      return QS_ERROR;
+    }
+    std::vector<PackedEntry> readEntries(header.numEntries);
+    const size_t indexSize = readEntries.size() * sizeof(PackedEntry);
+    std::memcpy(readEntries.data(), tail.data(), indexSize);
+    std::vector<std::string> readNames;
+    size_t pos = indexSize;
+    for (uint32_t i = 0; i < header.numNames; i++) {
+      uint32_t length;
+      if (tail.size() - pos < sizeof(length)) {
+        return QS_ERROR;
+      }
+      std::memcpy(&length, tail.data() + pos, sizeof(length));
+      pos += sizeof(length);
+      if (tail.size() - pos < length) {
+        return QS_ERROR;
+      }
+      readNames.emplace_back(
+          reinterpret_cast<const char *>(tail.data() + pos), length);
+      pos += length;
+    }
+    for (const auto &e : readEntries) {
+      if (e.nameIndex >= header.numNames || e.offset < packedBlockSize ||
+          e.offset > header.indexOffset ||
+          e.size > header.indexOffset - e.offset) {
+        return QS_ERROR;
+      }
+    }
+    names = std::move(readNames);
+    entries = std::move(readEntries);
+    return QS_SUCCESS;
+  }
+
   std::string outputBasePath_;
   std::mutex writeExecObjDataMutex_;
+  FileWriterProperties properties_;
+
+  // Async queue
+  std::deque<Job> queue_;
+  std::vector<std::vector<uint8_t>> freeBuffers_;
+  size_t queuedBytes_ = 0;
+  bool writing_ = false;
+  bool stop_ = false;
+  QStatus asyncStatus_ = QS_SUCCESS;
+  std::condition_variable workCv_;
+  std::condition_variable spaceCv_;
+  std::thread writer_;
+  std::atomic<uint64_t> bytesWritten_{0};
+  uint64_t numStalls_ = 0;
+
+  // Packed file
+  std::string packedPath_;
+  int packedFd_ = -1;
+  bool packedDirect_ = false;
+  uint8_t *staging_ = nullptr;
+  size_t stagingUsed_ = 0;
+  uint64_t stagingOffset_ = 0;
+  uint64_t packedSize_ = 0;
+  std::vector<PackedEntry> packedEntries_;
+  std::vector<std::string> packedNames_;
+  std::unordered_map<std::string, uint32_t> packedNameIndex_;
 };
 
 } // namespace openrt
@@ -7,8 +7,9 @@
 #include "QLogger.h"
 #include "QAicOpenRtExceptions.hpp"
 #include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtInputFill.hpp"
 #include "QAicRuntimeTypes.h"
-#include <random>
+#include "QNumaTopology.h"
 
 namespace qaic {
 namespace openrt {
@@ -19,36 +20,42 @@ public:
   /// \brief Generate an inference Vector compatible with the given program
   /// As default, will populate the input buffers with random data
   /// \param bufferMappings Buffer Mappings created from QPC
+  /// \param device Device the buffers are submitted to, see bindToDevice.
+  /// -1 leaves the buffers where the heap puts them.
   /// \return Shared pointer of InferenceVector type
   /// \exception CoreExceptionNullPtr
   /// - When memory allocation for object fails
   /// \exception CoreExceptionInit
   /// - When input Parameters are invalid
   static shInferenceVector Factory(const BufferMappings &bufferMappings,
-                                   DataSourceType source = RANDOM) {
+                                   DataSourceType source = RANDOM,
+                                   QID device = -1) {
     shInferenceVector obj = shInferenceVector(
         new (std::nothrow) InferenceVector(bufferMappings, source));
     if (!obj) {
       throw CoreExceptionNullPtr(objType_);
     }
-    obj->init();
+    obj->init(device);
     return obj;
   }
 
   /// \brief Generate an inference Vector compatible with the given program
   /// As default, will populate the input buffers with random data
   /// \param bufferMappings Buffer Mappings created from QPC
+  /// \param device Device the buffers are submitted to, see bindToDevice.
+  /// -1 leaves the buffers where the heap puts them.
   /// \return Shared pointer of InferenceVector type
   /// \exception CoreExceptionNullPtr
   /// - When memory allocation for object fails
   /// \exception CoreExceptionInit
   /// - When input Parameters are invalid
   static shInferenceVector Factory(const shQpc &qpc,
-                                   DataSourceType source = RANDOM) {
+                                   DataSourceType source = RANDOM,
+                                   QID device = -1) {
     if (!qpc) {
       return nullptr;
     }
-    return Factory(qpc->getBufferMappings(), source);
+    return Factory(qpc->getBufferMappings(), source, device);
   }
 
   /// \brief Generate an inference Vector compatible with the given program
@@ -103,6 +110,19 @@ public:
   /// return QBufferVector
   const std::vector<QBuffer> &getVector() const { return qBufferVector_; }
 
+  /// \brief Place the buffers owned by this inferenceVector on the NUMA
+  /// node of a device. Pages already touched elsewhere are moved. Does
+  /// nothing unless NUMA placement is enabled (QAIC_NUMA_PLACEMENT=device).
+  /// \param device Device the buffers are submitted to
+  void bindToDevice(QID device) {
+    for (auto &b : dataBufferVector_) {
+      if (b.size() != 0) {
+        QNumaPlacementManager::bindMemoryToDevice(b.dataPtr(), b.size(),
+                                                  device);
+      }
+    }
+  }
+
   /// \brief Loads the input files associated with this inference vector.
   /// If network supports partialBuffer, then the size of input file can be
   /// smaller than that of expected input buffer size.
@@ -217,12 +237,16 @@ private:
       : bufferMappings_(bufferMappings), sourceType_(FILESET),
         fileSet_(fileSet) {}
 
-  void init() {
+  void init(QID device = -1) {
     // Allocate from Heap
     dataBufferVector_.resize(bufferMappings_.size());
     for (uint32_t i = 0; i < bufferMappings_.size(); i++) {
       dataBufferVector_.at(i).allocate(bufferMappings_.at(i).size);
     }
+    // Before the content is written, so that filling runs on local pages
+    if (device >= 0) {
+      bindToDevice(device);
+    }
 
     qBufferVector_.resize(bufferMappings_.size());
     for (uint32_t i = 0;
@@ -232,7 +256,7 @@ private:
 
     switch (sourceType_) {
     case RANDOM: {
-      fillRandomUnBounded();
+      fillRandom(device);
     } break;
     case ZERO_FILL:
       for (auto &b : dataBufferVector_) {
@@ -249,19 +273,14 @@ private:
     }
   }
 
-  void fillRandomUnBounded() {
-    std::default_random_engine engine;
-    std::uniform_int_distribution<int> uintDistribution(0, 255);
-    for (uint32_t i = 0; i < bufferMappings_.size(); i++) {
-      if (bufferMappings_.at(i).ioType ==
-          QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT) {
-        continue;
-      }
-      uint8_t *dataPtr;
-      dataPtr = reinterpret_cast<uint8_t *>(dataBufferVector_.at(i).dataPtr());
-      for (size_t j = 0; j < dataBufferVector_.at(i).size(); j++) {
-        dataPtr[j] = uintDistribution(engine);
-      }
+  // Values valid for the data type of every input, generated in parallel
+  // from a fixed seed so that runs are reproducible
+  void fillRandom(QID device) {
+    InputFillProperties properties;
+    properties.device = device;
+    shInputFill inputFill = InputFill::Factory(bufferMappings_, properties);
+    if (inputFill->fill(qBufferVector_) != QS_SUCCESS) {
+      throw CoreExceptionInit("Inferencevector: Failed to fill inputs");
     }
   }
 
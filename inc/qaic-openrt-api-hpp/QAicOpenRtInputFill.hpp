@@ -0,0 +1,486 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_INPUT_FILL_HPP
+#define QAIC_OPENRT_INPUT_FILL_HPP
+
+#include "QAicOpenRtLogger.hpp"
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtProgram.hpp"
+#include "QAicRuntimeTypes.h"
+#include "QNumaTopology.h"
+#include "AICNetworkDesc.pb.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief Content generated for the inputs
+enum class InputFillPattern {
+  /// Random values valid for the data type and quantization of every input
+  Random,
+  /// Uniformly random bytes, whatever the data type
+  RandomBytes,
+  /// Element i holds (i mod 256) / 256 of the value range
+  Ramp,
+  /// All bytes zero
+  Zero
+};
+
+struct InputFillProperties {
+  InputFillPattern pattern = InputFillPattern::Random;
+  /// The same seed gives the same inputs, whatever the number of threads
+  uint64_t seed = 0;
+  /// Threads filling the inputs, 0 for one per hardware thread
+  uint32_t numThreads = 0;
+  /// Range of float and fp16 values, and of the real values of quantized
+  /// inputs before quantization
+  float minValue = -1.0f;
+  float maxValue = 1.0f;
+  /// Index inputs, e.g. token ids, are drawn from [0, indexLimit)
+  uint32_t indexLimit = 256;
+  /// Device the inputs are submitted to. With NUMA placement enabled the
+  /// fill threads run on its local CPUs, -1 leaves them to the scheduler.
+  QID device = -1;
+};
+
+/// \brief Fills generated input buffers.
+///
+/// Random values come from Philox4x32-10, a counter based generator: the
+/// value at an element is a function of the seed, the buffer and the
+/// element index only. Buffers are split in chunks filled by a pool of
+/// threads, in any order, and the result does not depend on the number of
+/// threads. Counters are processed in blocks through branch free loops over
+/// arrays that the compiler vectorizes.
+///
+/// Float and fp16 inputs are uniform over a finite range. Quantized inputs
+/// are uniform real values quantized with the scale and offset of the
+/// input, or uniform over the whole integer range when the input has no
+/// quantization. Index inputs stay below a limit.
+class InputFill : public Logger {
+public:
+  /// \brief Create a filler for the inputs of buffer mappings. Quantized
+  /// inputs cover their whole integer range until setQuantization is called.
+  /// \param[in] bufferMappings Mappings of the program inputs
+  /// \param[in] properties Pattern, seed and ranges of the values
+  /// \return Shared pointer InputFill
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When the properties are invalid
+  static shInputFill
+  Factory(const BufferMappings &bufferMappings,
+          const InputFillProperties &properties = InputFillProperties()) {
+    shInputFill obj = shInputFill(new (std::nothrow) InputFill());
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create InputFill Object");
+    }
+    obj->init(bufferMappings, properties);
+    return obj;
+  }
+
+  /// \brief Create a filler for the inputs of a program, with the
+  /// quantization of its network descriptor
+  /// \param[in] program A previously created program
+  /// \param[in] properties Pattern, seed and ranges of the values
+  /// \return Shared pointer InputFill
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When the program or the properties are invalid
+  static shInputFill
+  Factory(shProgram program,
+          const InputFillProperties &properties = InputFillProperties()) {
+    if (!program || !program->getProgram()) {
+      throw CoreExceptionInit("Invalid program");
+    }
+    shInputFill obj = Factory(program->getBufferMappings(), properties);
+    const aicnwdesc::networkDescriptor *networkDesc =
+        program->getProgram()->getNetworkDesc();
+    if (networkDesc == nullptr) {
+      obj->logWarn("No network descriptor, quantized inputs cover their "
+                   "integer range");
+      return obj;
+    }
+    for (const auto &input : networkDesc->inputs()) {
+      (void)obj->setQuantization(input.name(), input.io_initial().qscale(),
+                                 input.io_initial().qoffset());
+    }
+    return obj;
+  }
+
+  /// \brief Set the quantization of an input, real = scale * (q - offset).
+  /// A scale of 0 removes the quantization.
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Unknown input or invalid scale
+  QStatus setQuantization(const std::string &bufferName, float scale,
+                          int32_t offset) {
+    auto it = inputs_.find(bufferName);
+    if (it == inputs_.end() || !std::isfinite(scale) || scale < 0.0f) {
+      return QS_INVAL;
+    }
+    it->second.scale = scale;
+    it->second.offset = offset;
+    return QS_SUCCESS;
+  }
+
+  /// \brief Fill the input buffers of an inference vector. Buffers are
+  /// indexed as the buffer mappings, output buffers are left untouched.
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Missing or null input buffer
+  QStatus fill(const std::vector<QBuffer> &buffers) {
+    std::vector<Task> tasks;
+    for (const auto &entry : inputs_) {
+      const Input &in = entry.second;
+      if (in.index >= buffers.size()) {
+        logError("No buffer for input " + entry.first);
+        return QS_INVAL;
+      }
+      const QBuffer &buffer = buffers.at(in.index);
+      if (buffer.size == 0) {
+        continue;
+      }
+      if (buffer.buf == nullptr) {
+        logError("Null buffer for input " + entry.first);
+        return QS_INVAL;
+      }
+      addTasks(in, buffer, tasks);
+    }
+    run(tasks);
+    return QS_SUCCESS;
+  }
+
+  /// \brief Philox4x32-10 of the counters {first + i, stream, 0} for
+  /// i in [0, count), count at most blockCounters. Counter i gives the
+  /// words out[4 * i] to out[4 * i + 3].
+  static void philox(uint64_t first, size_t count, uint32_t stream,
+                     uint64_t key, uint32_t *out) {
+    uint32_t c0[blockCounters], c1[blockCounters];
+    uint32_t c2[blockCounters], c3[blockCounters];
+    for (size_t i = 0; i < count; i++) {
+      c0[i] = static_cast<uint32_t>(first + i);
+      c1[i] = static_cast<uint32_t>((first + i) >> 32);
+      c2[i] = stream;
+      c3[i] = 0;
+    }
+    uint32_t k0 = static_cast<uint32_t>(key);
+    uint32_t k1 = static_cast<uint32_t>(key >> 32);
+    for (int round = 0; round < 10; round++) {
+      for (size_t i = 0; i < count; i++) {
+        const uint64_t p0 = static_cast<uint64_t>(0xD2511F53) * c0[i];
+        const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57) * c2[i];
+        const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1[i] ^ k0;
+        const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3[i] ^ k1;
+        c0[i] = n0;
+        c1[i] = static_cast<uint32_t>(p1);
+        c2[i] = n2;
+        c3[i] = static_cast<uint32_t>(p0);
+      }
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+    for (size_t i = 0; i < count; i++) {
+      out[4 * i] = c0[i];
+      out[4 * i + 1] = c1[i];
+      out[4 * i + 2] = c2[i];
+      out[4 * i + 3] = c3[i];
+    }
+  }
+
+  /// \brief Convert to fp16, rounding to nearest even
+  static uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t magnitude = bits & 0x7fffffff;
+    // Below the smallest normal half, adding 0.5 aligns the mantissa on the
+    // half subnormal step and the FPU rounds
+    float subnormal;
+    std::memcpy(&subnormal, &magnitude, sizeof(subnormal));
+    subnormal += 0.5f;
+    uint32_t subnormalBits;
+    std::memcpy(&subnormalBits, &subnormal, sizeof(subnormalBits));
+    subnormalBits -= 0x3f000000;
+    // Rebias the exponent, the carry of the rounding may give infinity
+    const uint32_t normalBits =
+        (magnitude + 0xc8000fff + ((magnitude >> 13) & 1)) >> 13;
+    uint32_t half = (magnitude < 0x38800000) ? subnormalBits : normalBits;
+    half = (magnitude >= 0x47800000)
+               ? ((magnitude > 0x7f800000) ? 0x7e00 : 0x7c00)
+               : half;
+    return static_cast<uint16_t>(sign | half);
+  }
+
+  // Counters generated per block, 4 words each
+  static constexpr size_t blockCounters = 64;
+
+  InputFill(const InputFill &) = delete;            // Disable Copy Constructor
+  InputFill &operator=(const InputFill &) = delete; // Disable Assignment
+
+private:
+  InputFill() = default;
+
+  struct Input {
+    uint32_t index;
+    QAicBufferDataTypeEnum dataType;
+    float scale;
+    int32_t offset;
+  };
+
+  // A range of elements, or of bytes for byte fills, of one input
+  struct Task {
+    const Input *input;
+    uint8_t *data;
+    bool bytes;
+    size_t begin;
+    size_t end;
+  };
+
+  static constexpr size_t blockWords = 4 * blockCounters;
+  // Bytes filled by a task, small enough to balance the threads
+  static constexpr size_t chunkBytes = 1 << 20;
+
+  void init(const BufferMappings &bufferMappings,
+            const InputFillProperties &properties) {
+    if (!std::isfinite(properties.minValue) ||
+        !std::isfinite(properties.maxValue) ||
+        !(properties.minValue < properties.maxValue)) {
+      throw CoreExceptionInit("Invalid input fill value range");
+    }
+    if (properties.indexLimit == 0) {
+      throw CoreExceptionInit("Input fill index limit must be positive");
+    }
+    properties_ = properties;
+    for (uint32_t i = 0; i < bufferMappings.size(); i++) {
+      const BufferMapping &mapping = bufferMappings.at(i);
+      if (mapping.ioType != QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT) {
+        inputs_[mapping.bufferName] = {i, mapping.dataType, 0.0f, 0};
+      }
+    }
+  }
+
+  static size_t elementSize(QAicBufferDataTypeEnum dataType) {
+    switch (dataType) {
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT:
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT32Q:
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT32I:
+      return 4;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT16:
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT16Q:
+      return 2;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT64I:
+      return 8;
+    default:
+      return 1;
+    }
+  }
+
+  // Random bytes are already uniform over the range of integer inputs
+  // without quantization, the bytes of the generator are copied as is
+  bool isByteFill(const Input &in) const {
+    switch (properties_.pattern) {
+    case InputFillPattern::Random:
+      break;
+    case InputFillPattern::Ramp:
+      return false;
+    default:
+      return true;
+    }
+    switch (in.dataType) {
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8Q:
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_UINT8Q:
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT16Q:
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT32Q:
+      return in.scale == 0.0f;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT:
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT16:
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT32I:
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT64I:
+      return false;
+    default:
+      return true;
+    }
+  }
+
+  void addTasks(const Input &in, const QBuffer &buffer,
+                std::vector<Task> &tasks) const {
+    const bool bytes = isByteFill(in);
+    const size_t unit = bytes ? 1 : elementSize(in.dataType);
+    const size_t numUnits = buffer.size / unit;
+    // Chunks start on a block, so that counters do not depend on the split
+    const size_t chunkUnits =
+        std::max(chunkBytes / unit / blockWords, size_t(1)) * blockWords;
+    for (size_t begin = 0; begin < numUnits; begin += chunkUnits) {
+      tasks.push_back({&in, buffer.buf, bytes, begin,
+                       std::min(begin + chunkUnits, numUnits)});
+    }
+    // A partial trailing element is not a value of the data type
+    std::memset(buffer.buf + numUnits * unit, 0, buffer.size % unit);
+  }
+
+  void run(const std::vector<Task> &tasks) const {
+    size_t numThreads = properties_.numThreads;
+    if (numThreads == 0) {
+      numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    numThreads = std::min(numThreads, tasks.size());
+    std::atomic<size_t> next{0};
+    auto worker = [this, &tasks, &next]() {
+      for (size_t i = next++; i < tasks.size(); i = next++) {
+        runTask(tasks.at(i));
+      }
+    };
+    if (numThreads <= 1) {
+      worker();
+      return;
+    }
+    // The calling thread keeps its own affinity
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; i++) {
+      threads.emplace_back([this, &worker]() {
+        if (properties_.device >= 0) {
+          QNumaPlacementManager::bindThreadToDevice(properties_.device);
+        }
+        worker();
+      });
+    }
+    worker();
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  // Words for the elements [base, base + blockWords), base is a multiple of
+  // blockWords
+  void makeWords(const Input &in, size_t base, uint32_t *words) const {
+    if (properties_.pattern == InputFillPattern::Ramp) {
+      for (size_t i = 0; i < blockWords; i++) {
+        words[i] = static_cast<uint32_t>((base + i) & 0xff) << 24;
+      }
+      return;
+    }
+    philox(base / 4, blockCounters, in.index, properties_.seed, words);
+  }
+
+  void runTask(const Task &t) const {
+    const Input &in = *t.input;
+    if (properties_.pattern == InputFillPattern::Zero) {
+      const size_t unit = t.bytes ? 1 : elementSize(in.dataType);
+      std::memset(t.data + t.begin * unit, 0, (t.end - t.begin) * unit);
+      return;
+    }
+    if (t.bytes) {
+      fillBytes(in, t);
+      return;
+    }
+    // Uniform reals in [minValue, maxValue) from the 24 high bits
+    const float low = properties_.minValue;
+    const float step =
+        (properties_.maxValue - properties_.minValue) * 0x1p-24f;
+    const uint64_t limit = properties_.indexLimit;
+    switch (in.dataType) {
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT:
+      fillElements<float>(in, t, [low, step](uint32_t w) {
+        return low + static_cast<float>(w >> 8) * step;
+      });
+      break;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT16:
+      fillElements<uint16_t>(in, t, [low, step](uint32_t w) {
+        return floatToHalf(low + static_cast<float>(w >> 8) * step);
+      });
+      break;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8Q:
+      fillQuantized<int8_t>(in, t, low, step);
+      break;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_UINT8Q:
+      fillQuantized<uint8_t>(in, t, low, step);
+      break;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT16Q:
+      fillQuantized<int16_t>(in, t, low, step);
+      break;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT32Q:
+      fillQuantized<int32_t>(in, t, low, step);
+      break;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT32I:
+      fillElements<int32_t>(in, t, [limit](uint32_t w) {
+        return static_cast<int32_t>((w * limit) >> 32);
+      });
+      break;
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT64I:
+      fillElements<int64_t>(in, t, [limit](uint32_t w) {
+        return static_cast<int64_t>((w * limit) >> 32);
+      });
+      break;
+    default:
+      fillElements<uint8_t>(in, t, [](uint32_t w) {
+        return static_cast<uint8_t>(w >> 24);
+      });
+      break;
+    }
+  }
+
+  void fillBytes(const Input &in, const Task &t) const {
+    uint32_t words[blockWords];
+    const size_t blockBytes = sizeof(words);
+    for (size_t base = t.begin; base < t.end; base += blockBytes) {
+      philox(base / 16, blockCounters, in.index, properties_.seed, words);
+      std::memcpy(t.data + base, words, std::min(blockBytes, t.end - base));
+    }
+  }
+
+  template <typename T, typename Convert>
+  void fillElements(const Input &in, const Task &t, Convert convert) const {
+    uint32_t words[blockWords];
+    T values[blockWords];
+    for (size_t base = t.begin; base < t.end; base += blockWords) {
+      const size_t count = std::min(blockWords, t.end - base);
+      makeWords(in, base, words);
+      for (size_t i = 0; i < blockWords; i++) {
+        values[i] = convert(words[i]);
+      }
+      std::memcpy(t.data + base * sizeof(T), values, count * sizeof(T));
+    }
+  }
+
+  template <typename T>
+  void fillQuantized(const Input &in, const Task &t, float low,
+                     float step) const {
+    if (in.scale == 0.0f) {
+      // Ramps over the whole integer range
+      fillElements<T>(in, t, [](uint32_t w) {
+        return static_cast<T>(w >> (32 - 8 * sizeof(T)));
+      });
+      return;
+    }
+    // Clamped as floats, the largest float below 2^31 for int32
+    const float qMin = static_cast<float>(std::numeric_limits<T>::min());
+    const float qMax = (sizeof(T) < 4)
+                           ? static_cast<float>(std::numeric_limits<T>::max())
+                           : 2147483520.0f;
+    const float invScale = 1.0f / in.scale;
+    const float offset = static_cast<float>(in.offset);
+    fillElements<T>(in, t, [=](uint32_t w) {
+      const float real = low + static_cast<float>(w >> 8) * step;
+      const float q = std::floor(real * invScale + 0.5f) + offset;
+      return static_cast<T>(std::min(std::max(q, qMin), qMax));
+    });
+  }
+
+  InputFillProperties properties_;
+  std::unordered_map<std::string, Input> inputs_;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_INPUT_FILL_HPP
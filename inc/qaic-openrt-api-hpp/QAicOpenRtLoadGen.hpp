@@ -0,0 +1,463 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_LOADGEN_HPP
+#define QAIC_OPENRT_LOADGEN_HPP
+
+#include "QAicOpenRtLogger.hpp"
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtExecObj.hpp"
+#include "QAicOpenRtInferenceVector.hpp"
+#include "QAicRuntimeTypes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief How the send times of a LoadGen run are generated
+enum class LoadGenArrival {
+  /// One request every 1/rate seconds
+  FixedRate,
+  /// Exponentially distributed gaps of mean 1/rate seconds
+  Poisson,
+  /// Send times replayed from LoadGenProperties::trace
+  Trace,
+};
+
+/// \brief Properties used to configure a LoadGen
+struct LoadGenProperties {
+  LoadGenArrival arrival = LoadGenArrival::FixedRate;
+  /// Offered rate in requests per second, FixedRate and Poisson only
+  double rate = 100.0;
+  /// Sorted send times relative to the start of the run, Trace only
+  std::vector<std::chrono::microseconds> trace;
+  /// Requests sent during the warm-up are executed but not reported
+  std::chrono::microseconds warmup = std::chrono::microseconds(0);
+  /// Length of the measurement window following the warm-up. A Trace run
+  /// with a zero duration lasts until the trace is exhausted.
+  std::chrono::microseconds duration = std::chrono::seconds(10);
+  /// Seed of the Poisson arrival process, runs with equal seeds send at
+  /// equal times
+  uint64_t seed = 1;
+};
+
+/// \brief Latency distribution in microseconds
+struct LoadGenLatency {
+  double meanUs = 0;
+  double p50Us = 0;
+  double p90Us = 0;
+  double p99Us = 0;
+  double p999Us = 0;
+  double maxUs = 0;
+};
+
+/// \brief Outcome of the requests whose send time falls in the measurement
+/// window
+struct LoadGenReport {
+  /// Requests due in the window, i.e. completed + failed + missed
+  uint64_t numOffered = 0;
+  uint64_t numCompleted = 0;
+  uint64_t numFailed = 0;
+  /// Requests still waiting for a backend when the window closed
+  uint64_t numMissed = 0;
+  double windowSec = 0;
+  double offeredRate = 0;
+  /// Successful completions within the window per second
+  double achievedRate = 0;
+  /// From the intended send time to completion. Time spent waiting for a
+  /// busy backend is included, so an overloaded target cannot hide behind
+  /// a slowed down sender.
+  LoadGenLatency latency;
+  /// From the actual start of the request to completion
+  LoadGenLatency serviceTime;
+};
+
+/// \brief Executes one request synchronously
+using LoadGenExecFunction = std::function<QStatus()>;
+
+/// \brief Send times of a LoadGen run
+class LoadGenSchedule {
+public:
+  explicit LoadGenSchedule(const LoadGenProperties &properties)
+      : properties_(properties), rng_(properties.seed),
+        end_(properties.warmup + properties.duration) {}
+
+  /// \brief Get the next send time relative to the start of the run
+  /// \return false once the schedule is exhausted
+  bool next(std::chrono::nanoseconds &offset) {
+    switch (properties_.arrival) {
+    case LoadGenArrival::FixedRate:
+      // Derived from the index so that rounding does not accumulate
+      offset = std::chrono::nanoseconds(static_cast<int64_t>(
+          static_cast<double>(index_) * 1e9 / properties_.rate));
+      break;
+    case LoadGenArrival::Poisson: {
+      std::exponential_distribution<double> gap(properties_.rate);
+      offset = std::chrono::nanoseconds(static_cast<int64_t>(timeSec_ * 1e9));
+      timeSec_ += gap(rng_);
+      break;
+    }
+    case LoadGenArrival::Trace:
+      if (index_ >= properties_.trace.size()) {
+        return false;
+      }
+      offset = properties_.trace.at(index_);
+      if (properties_.duration.count() == 0) {
+        index_++;
+        return true;
+      }
+      break;
+    }
+    if (offset >= end_) {
+      return false;
+    }
+    index_++;
+    return true;
+  }
+
+private:
+  const LoadGenProperties properties_;
+  std::mt19937_64 rng_;
+  const std::chrono::nanoseconds end_;
+  uint64_t index_ = 0;
+  double timeSec_ = 0;
+};
+
+/// \brief A LoadGen sends requests to a set of execution backends at times
+/// fixed in advance by an arrival process, independent of how fast earlier
+/// requests complete. Each backend (typically one ExecObj) is driven by its
+/// own thread, a request due while every backend is busy waits for the
+/// first free one and the wait counts towards its latency.
+class LoadGen : public Logger {
+public:
+  /// \brief Create a LoadGen driving one ExecObj per inference vector
+  /// \param[in] context A previously created context
+  /// \param[in] program A previously created program shared object
+  /// \param[in] properties LoadGen properties
+  /// \param[in] inferenceVectors Buffers of each ExecObj, the number of
+  /// vectors is the number of requests in flight
+  /// \return Shared pointer LoadGen
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  /// - When execObj creation fails
+  static shLoadGen Factory(shContext context, shProgram program,
+                           const LoadGenProperties &properties,
+                           const std::vector<shInferenceVector> &
+                               inferenceVectors) {
+    if (!context || !program || inferenceVectors.empty()) {
+      throw CoreExceptionInit("Invalid LoadGen parameters");
+    }
+    std::vector<shExecObj> execObjs;
+    std::vector<LoadGenExecFunction> backends;
+    for (const auto &inferenceVector : inferenceVectors) {
+      shExecObj execObj = ExecObj::Factory(context, program);
+      if (execObj->setData(inferenceVector) != QS_SUCCESS) {
+        throw CoreExceptionInit("Failed to set LoadGen ExecObj data");
+      }
+      backends.emplace_back([execObj]() -> QStatus { return execObj->run(); });
+      execObjs.emplace_back(execObj);
+    }
+    shLoadGen obj = Factory(properties, std::move(backends));
+    obj->setContext(context);
+    obj->execObjs_ = std::move(execObjs);
+    return obj;
+  }
+
+  /// \brief Create a LoadGen on top of user provided execution backends
+  /// \param[in] properties LoadGen properties
+  /// \param[in] backends One execution function per request in flight
+  /// \return Shared pointer LoadGen
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  static shLoadGen Factory(const LoadGenProperties &properties,
+                           std::vector<LoadGenExecFunction> backends) {
+    shLoadGen obj =
+        shLoadGen(new (std::nothrow) LoadGen(properties, std::move(backends)));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create LoadGen Object");
+    }
+    obj->init();
+    return obj;
+  }
+
+  /// \brief Read a trace of send times, one integer per line in
+  /// microseconds. Times are made relative to the first one, empty lines
+  /// and lines starting with '#' are skipped.
+  /// \param[in] is Stream holding the trace
+  /// \param[out] trace Send times relative to the first one
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Malformed, unsorted or empty trace
+  static QStatus parseTrace(std::istream &is,
+                            std::vector<std::chrono::microseconds> &trace) {
+    trace.clear();
+    std::vector<std::chrono::microseconds> parsed;
+    std::string line;
+    int64_t first = 0;
+    int64_t last = 0;
+    while (std::getline(is, line)) {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (line.empty() || line.front() == '#') {
+        continue;
+      }
+      size_t pos = 0;
+      int64_t value = 0;
+      try {
+        value = std::stoll(line, &pos);
+      } catch (const std::exception &) {
+        return QS_INVAL;
+      }
+      if (pos != line.size() || value < 0) {
+        return QS_INVAL;
+      }
+      if (parsed.empty()) {
+        first = value;
+      } else if (value < last) {
+        return QS_INVAL;
+      }
+      last = value;
+      parsed.emplace_back(value - first);
+    }
+    if (is.bad() || parsed.empty()) {
+      return QS_INVAL;
+    }
+    trace = std::move(parsed);
+    return QS_SUCCESS;
+  }
+
+  /// \brief Send the whole schedule and wait for the requests in flight
+  /// \param[out] report Outcome of the measurement window
+  /// \retval QS_SUCCESS Successful completion, failed requests are
+  /// reported in \a report
+  /// \retval QS_BUSY Another run is in progress
+  QStatus run(LoadGenReport &report) {
+    std::unique_lock<std::mutex> runLock(runMutex_, std::try_to_lock);
+    if (!runLock.owns_lock()) {
+      return QS_BUSY;
+    }
+
+    LoadGenSchedule schedule(properties_);
+    schedule_ = &schedule;
+    std::vector<WorkerSamples> samples(backends_.size());
+    start_ = Clock::now();
+    measureStart_ = start_ + properties_.warmup;
+    end_ = (properties_.arrival == LoadGenArrival::Trace &&
+            properties_.duration.count() == 0)
+               ? Clock::time_point::max()
+               : measureStart_ + properties_.duration;
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < backends_.size(); i++) {
+      workers.emplace_back(&LoadGen::workerLoop, this, i,
+                           std::ref(samples.at(i)));
+    }
+    for (auto &t : workers) {
+      t.join();
+    }
+    const Clock::time_point finish = Clock::now();
+    schedule_ = nullptr;
+
+    Clock::time_point windowEnd = end_;
+    if (windowEnd == Clock::time_point::max()) {
+      windowEnd = std::max(finish, measureStart_);
+    }
+    buildReport(samples, windowEnd - measureStart_, report);
+    return QS_SUCCESS;
+  }
+
+  /// \brief Get the number of requests in flight at most
+  uint32_t getNumBackends() const {
+    return static_cast<uint32_t>(backends_.size());
+  }
+
+  /// \brief Record the requests of the ExecObjs created by the Factory,
+  /// see ExecObj::setTrafficRecorder. Set while no run is in progress.
+  /// \param[in] recorder Recorder, null to stop recording
+  void setTrafficRecorder(shTrafficRecorder recorder) {
+    for (auto &execObj : execObjs_) {
+      execObj->setTrafficRecorder(recorder);
+    }
+  }
+
+  /// \brief Get the distribution of a set of samples
+  /// \param[in,out] ns Samples in nanoseconds, sorted on return
+  /// \return Distribution in microseconds
+  static LoadGenLatency summarize(std::vector<int64_t> &ns) {
+    LoadGenLatency latency;
+    if (ns.empty()) {
+      return latency;
+    }
+    std::sort(ns.begin(), ns.end());
+    // Nearest rank percentile
+    auto percentile = [&ns](double p) {
+      size_t rank = static_cast<size_t>(std::ceil(p * ns.size()));
+      return static_cast<double>(ns.at(std::max<size_t>(rank, 1) - 1)) / 1e3;
+    };
+    double sum = 0;
+    for (int64_t v : ns) {
+      sum += static_cast<double>(v);
+    }
+    latency.meanUs = sum / ns.size() / 1e3;
+    latency.p50Us = percentile(0.50);
+    latency.p90Us = percentile(0.90);
+    latency.p99Us = percentile(0.99);
+    latency.p999Us = percentile(0.999);
+    latency.maxUs = static_cast<double>(ns.back()) / 1e3;
+    return latency;
+  }
+
+  LoadGen(const LoadGen &) = delete;            // Disable Copy Constructor
+  LoadGen &operator=(const LoadGen &) = delete; // Disable Assignment Operator
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // Owned by one worker thread during a run
+  struct WorkerSamples {
+    uint64_t numOffered = 0;
+    uint64_t numCompleted = 0;
+    uint64_t numFailed = 0;
+    uint64_t numMissed = 0;
+    uint64_t numCompletedInWindow = 0;
+    std::vector<int64_t> latencyNs;
+    std::vector<int64_t> serviceNs;
+  };
+
+  LoadGen(const LoadGenProperties &properties,
+          std::vector<LoadGenExecFunction> backends)
+      : properties_(properties), backends_(std::move(backends)) {}
+
+  void init() {
+    if (backends_.empty()) {
+      throw CoreExceptionInit("No execution backend");
+    }
+    if (properties_.warmup.count() < 0 || properties_.duration.count() < 0) {
+      throw CoreExceptionInit("Invalid LoadGen window");
+    }
+    if (properties_.arrival == LoadGenArrival::Trace) {
+      if (properties_.trace.empty() ||
+          !std::is_sorted(properties_.trace.begin(),
+                          properties_.trace.end()) ||
+          properties_.trace.front().count() < 0) {
+        throw CoreExceptionInit("Invalid LoadGen trace");
+      }
+      return;
+    }
+    if (!std::isfinite(properties_.rate) || properties_.rate <= 0) {
+      throw CoreExceptionInit("Invalid LoadGen rate");
+    }
+    if (properties_.duration.count() == 0) {
+      throw CoreExceptionInit("Invalid LoadGen duration");
+    }
+  }
+
+  void workerLoop(uint32_t backendIndex, WorkerSamples &samples) {
+    while (true) {
+      std::chrono::nanoseconds offset;
+      {
+        std::lock_guard<std::mutex> lk(scheduleMutex_);
+        if (!schedule_->next(offset)) {
+          return;
+        }
+      }
+      const Clock::time_point intended = start_ + offset;
+      const bool measured = intended >= measureStart_;
+      std::this_thread::sleep_until(intended);
+
+      const Clock::time_point begin = Clock::now();
+      if (begin >= end_) {
+        // The backlog left at the end of the window is only counted
+        if (measured) {
+          samples.numOffered++;
+          samples.numMissed++;
+        }
+        continue;
+      }
+
+      QStatus status = QS_ERROR;
+      try {
+        status = backends_.at(backendIndex)();
+      } catch (const std::exception &e) {
+        logError(std::string("Request execution failed: ") + e.what());
+        status = QS_ERROR;
+      }
+      const Clock::time_point done = Clock::now();
+      if (!measured) {
+        continue;
+      }
+
+      samples.numOffered++;
+      if (status != QS_SUCCESS) {
+        samples.numFailed++;
+        continue;
+      }
+      samples.numCompleted++;
+      if (done < end_) {
+        samples.numCompletedInWindow++;
+      }
+      samples.latencyNs.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(done - intended)
+              .count());
+      samples.serviceNs.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(done - begin)
+              .count());
+    }
+  }
+
+  static void buildReport(std::vector<WorkerSamples> &samples,
+                          Clock::duration window, LoadGenReport &report) {
+    report = LoadGenReport();
+    uint64_t numCompletedInWindow = 0;
+    std::vector<int64_t> latencyNs;
+    std::vector<int64_t> serviceNs;
+    for (auto &s : samples) {
+      report.numOffered += s.numOffered;
+      report.numCompleted += s.numCompleted;
+      report.numFailed += s.numFailed;
+      report.numMissed += s.numMissed;
+      numCompletedInWindow += s.numCompletedInWindow;
+      latencyNs.insert(latencyNs.end(), s.latencyNs.begin(),
+                       s.latencyNs.end());
+      serviceNs.insert(serviceNs.end(), s.serviceNs.begin(),
+                       s.serviceNs.end());
+    }
+    report.windowSec = std::chrono::duration<double>(window).count();
+    if (report.windowSec > 0) {
+      report.offeredRate = report.numOffered / report.windowSec;
+      report.achievedRate = numCompletedInWindow / report.windowSec;
+    }
+    report.latency = summarize(latencyNs);
+    report.serviceTime = summarize(serviceNs);
+  }
+
+  const LoadGenProperties properties_;
+  std::vector<LoadGenExecFunction> backends_;
+  std::vector<shExecObj> execObjs_;
+  std::mutex runMutex_;
+  std::mutex scheduleMutex_;
+  LoadGenSchedule *schedule_ = nullptr;
+  Clock::time_point start_;
+  Clock::time_point measureStart_;
+  Clock::time_point end_;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_LOADGEN_HPP
@@ -0,0 +1,385 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_OUTPUT_VALIDATOR_HPP
+#define QAIC_OPENRT_OUTPUT_VALIDATOR_HPP
+
+#include "QAicOpenRtLogger.hpp"
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtProgram.hpp"
+#include "QAicRuntimeTypes.h"
+#include "AICNetworkDesc.pb.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief Tolerances of an output comparison. An element matches when any
+/// one of the tolerances holds, all zero requires equal values.
+struct ValidationProperties {
+  /// |output - reference| <= absTolerance
+  double absTolerance = 0.0;
+  /// |output - reference| <= relTolerance * |reference|
+  double relTolerance = 0.0;
+  /// Output and reference at most ulpTolerance representable values apart.
+  /// For quantized and integer outputs this is the integer difference.
+  uint32_t ulpTolerance = 0;
+  /// Number of mismatching element indexes kept in the report
+  uint32_t maxReportedMismatches = 8;
+};
+
+/// \brief Quantization of an output, real = scale * (quantized - offset)
+struct OutputQuantization {
+  float scale = 1.0f;
+  int32_t offset = 0;
+};
+
+/// \brief Result of the comparison of one output buffer
+struct ValidationReport {
+  std::string bufferName;
+  QAicBufferDataTypeEnum dataType =
+      QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INVAL;
+  bool passed = false;
+  /// Output and reference differ in size, no element was compared
+  bool sizeMismatch = false;
+  size_t numElements = 0;
+  size_t numMismatches = 0;
+  /// Largest errors over all elements, after dequantization
+  double maxAbsError = 0.0;
+  uint64_t maxUlpError = 0;
+  /// Indexes of the first mismatching elements
+  std::vector<size_t> firstMismatches;
+};
+
+/// \brief Compares output buffers with reference outputs, element by
+/// element in the data type of every output. Quantized outputs are
+/// dequantized before the absolute and relative tolerances apply.
+///
+/// Outputs are compared in blocks. Blocks that are byte for byte equal are
+/// skipped with memcmp, the others go through branch free loops over
+/// arrays that the compiler vectorizes.
+class OutputValidator : public Logger {
+public:
+  /// \brief Create a validator for the outputs of buffer mappings. Quantized
+  /// outputs use scale 1 and offset 0 until setQuantization is called.
+  /// \param[in] bufferMappings Mappings of the program outputs
+  /// \param[in] properties Tolerances of every output
+  /// \return Shared pointer OutputValidator
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When the mappings hold no output
+  static shOutputValidator
+  Factory(const BufferMappings &bufferMappings,
+          const ValidationProperties &properties = ValidationProperties()) {
+    shOutputValidator obj = shOutputValidator(new (std::nothrow)
+                                                  OutputValidator());
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create OutputValidator Object");
+    }
+    obj->init(bufferMappings, properties);
+    return obj;
+  }
+
+  /// \brief Create a validator for the outputs of a program, with the
+  /// quantization of its network descriptor
+  /// \param[in] program A previously created program
+  /// \param[in] properties Tolerances of every output
+  /// \return Shared pointer OutputValidator
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When the program is invalid or has no output
+  static shOutputValidator
+  Factory(shProgram program,
+          const ValidationProperties &properties = ValidationProperties()) {
+    if (!program || !program->getProgram()) {
+      throw CoreExceptionInit("Invalid program");
+    }
+    shOutputValidator obj = Factory(program->getBufferMappings(), properties);
+    const aicnwdesc::networkDescriptor *networkDesc =
+        program->getProgram()->getNetworkDesc();
+    if (networkDesc == nullptr) {
+      obj->logWarn("No network descriptor, quantized outputs are compared "
+                   "as integers");
+      return obj;
+    }
+    for (const auto &output : networkDesc->outputs()) {
+      (void)obj->setQuantization(output.name(), output.io_initial().qscale(),
+                                 output.io_initial().qoffset());
+    }
+    return obj;
+  }
+
+  /// \brief Set the quantization of an output
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Unknown output
+  QStatus setQuantization(const std::string &bufferName, float scale,
+                          int32_t offset) {
+    auto it = outputs_.find(bufferName);
+    if (it == outputs_.end()) {
+      return QS_INVAL;
+    }
+    it->second.quantization = {scale, offset};
+    return QS_SUCCESS;
+  }
+
+  /// \brief Set the tolerances of a single output
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Unknown output or negative tolerance
+  QStatus setProperties(const std::string &bufferName,
+                        const ValidationProperties &properties) {
+    auto it = outputs_.find(bufferName);
+    if (it == outputs_.end() || !isValid(properties)) {
+      return QS_INVAL;
+    }
+    it->second.properties = properties;
+    return QS_SUCCESS;
+  }
+
+  /// \brief Compare an output with its reference
+  /// \param[in] bufferName Name of the output in the buffer mappings
+  /// \param[in] output Output of an inference
+  /// \param[in] reference Expected output
+  /// \param[out] report Comparison result
+  /// \retval QS_SUCCESS Every element matches
+  /// \retval QS_ERROR Sizes differ or some elements do not match
+  /// \retval QS_INVAL Unknown output
+  QStatus validate(const std::string &bufferName, const QBuffer &output,
+                   const QBuffer &reference, ValidationReport &report) const {
+    report = ValidationReport();
+    report.bufferName = bufferName;
+    auto it = outputs_.find(bufferName);
+    if (it == outputs_.end()) {
+      return QS_INVAL;
+    }
+    const Output &o = it->second;
+    report.dataType = o.dataType;
+    if (output.size != reference.size) {
+      report.sizeMismatch = true;
+      return QS_ERROR;
+    }
+    compare(o, output.buf, reference.buf, output.size, report);
+    report.passed = (report.numMismatches == 0);
+    return report.passed ? QS_SUCCESS : QS_ERROR;
+  }
+
+  OutputValidator(const OutputValidator &) = delete; // Disable Copy Constructor
+  OutputValidator &
+  operator=(const OutputValidator &) = delete; // Disable Assignment Operator
+
+private:
+  OutputValidator() {}
+
+  struct Output {
+    QAicBufferDataTypeEnum dataType;
+    OutputQuantization quantization;
+    ValidationProperties properties;
+  };
+
+  // Elements compared per block, the scratch arrays stay on the stack
+  static constexpr size_t blockElements = 256;
+
+  static bool isValid(const ValidationProperties &properties) {
+    return properties.absTolerance >= 0.0 && properties.relTolerance >= 0.0;
+  }
+
+  void init(const BufferMappings &bufferMappings,
+            const ValidationProperties &properties) {
+    if (!isValid(properties)) {
+      throw CoreExceptionInit("Negative validation tolerance");
+    }
+    for (const auto &mapping : bufferMappings) {
+      if (mapping.ioType == QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT) {
+        outputs_[mapping.bufferName] = {mapping.dataType, OutputQuantization(),
+                                        properties};
+      }
+    }
+    if (outputs_.empty()) {
+      throw CoreExceptionInit("No output to validate");
+    }
+  }
+
+  // Sign and magnitude bits are mapped to integers whose distance is the
+  // number of representable values in between, -0 and +0 being equal
+  static int64_t orderedKey(uint32_t bits, uint32_t signBit) {
+    const int64_t magnitude = bits & (signBit - 1);
+    return (bits & signBit) ? -magnitude : magnitude;
+  }
+
+  static float halfToFloat(uint16_t h) {
+    const uint32_t magnitude = h & 0x7fff;
+    // Shifted into a float, scaling by 2^112 rebiases the exponent,
+    // subnormals included
+    uint32_t bits = magnitude << 13;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    value *= 0x1p112f;
+    std::memcpy(&bits, &value, sizeof(bits));
+    // Infinity and NaN keep an all ones exponent
+    bits = (magnitude >= 0x7c00) ? (0x7f800000 | (magnitude << 13)) : bits;
+    bits |= static_cast<uint32_t>(h & 0x8000) << 16;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  struct FloatElement {
+    using Type = float;
+    static double value(float x, const OutputQuantization &) { return x; }
+    static int64_t key(float x) {
+      uint32_t bits;
+      std::memcpy(&bits, &x, sizeof(bits));
+      return orderedKey(bits, 0x80000000);
+    }
+  };
+
+  struct HalfElement {
+    using Type = uint16_t;
+    static double value(uint16_t x, const OutputQuantization &) {
+      return halfToFloat(x);
+    }
+    static int64_t key(uint16_t x) { return orderedKey(x, 0x8000); }
+  };
+
+  template <typename T> struct QuantizedElement {
+    using Type = T;
+    static double value(T x, const OutputQuantization &q) {
+      return static_cast<double>(q.scale) *
+             (static_cast<double>(x) - static_cast<double>(q.offset));
+    }
+    static int64_t key(T x) { return static_cast<int64_t>(x); }
+  };
+
+  template <typename T> struct IntegerElement {
+    using Type = T;
+    static double value(T x, const OutputQuantization &) {
+      return static_cast<double>(x);
+    }
+    static int64_t key(T x) { return static_cast<int64_t>(x); }
+  };
+
+  static void compare(const Output &o, const uint8_t *out, const uint8_t *ref,
+                      size_t size, ValidationReport &report) {
+    switch (o.dataType) {
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT:
+      return compareElements<FloatElement>(o, out, ref, size, report);
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT16:
+      return compareElements<HalfElement>(o, out, ref, size, report);
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8Q:
+      return compareElements<QuantizedElement<int8_t>>(o, out, ref, size,
+                                                       report);
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_UINT8Q:
+      return compareElements<QuantizedElement<uint8_t>>(o, out, ref, size,
+                                                        report);
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT16Q:
+      return compareElements<QuantizedElement<int16_t>>(o, out, ref, size,
+                                                        report);
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT32Q:
+      return compareElements<QuantizedElement<int32_t>>(o, out, ref, size,
+                                                        report);
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT32I:
+      return compareElements<IntegerElement<int32_t>>(o, out, ref, size,
+                                                      report);
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT64I:
+      return compareElements<IntegerElement<int64_t>>(o, out, ref, size,
+                                                      report);
+    case QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8:
+      return compareElements<IntegerElement<int8_t>>(o, out, ref, size,
+                                                     report);
+    default:
+      break;
+    }
+    // Unknown layouts are compared byte for byte without tolerance
+    Output bytes = o;
+    bytes.properties = ValidationProperties();
+    bytes.properties.maxReportedMismatches = o.properties.maxReportedMismatches;
+    compareElements<IntegerElement<uint8_t>>(bytes, out, ref, size, report);
+  }
+
+  template <typename Element>
+  static void compareElements(const Output &o, const uint8_t *out,
+                              const uint8_t *ref, size_t size,
+                              ValidationReport &report) {
+    using T = typename Element::Type;
+    if (size % sizeof(T) != 0) {
+      // A truncated element, fall back to the bytes
+      Output bytes = o;
+      bytes.dataType = QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INVAL;
+      compare(bytes, out, ref, size, report);
+      return;
+    }
+    const ValidationProperties &p = o.properties;
+    const size_t numElements = size / sizeof(T);
+    report.numElements = numElements;
+
+    T a[blockElements];
+    T b[blockElements];
+    double error[blockElements];
+    uint64_t ulp[blockElements];
+    uint8_t mismatch[blockElements];
+    for (size_t base = 0; base < numElements; base += blockElements) {
+      const size_t count = std::min(blockElements, numElements - base);
+      const size_t offset = base * sizeof(T);
+      // Equal bits have no error, most blocks of a passing output stop here
+      if (std::memcmp(out + offset, ref + offset, count * sizeof(T)) == 0) {
+        continue;
+      }
+      std::memcpy(a, out + offset, count * sizeof(T));
+      std::memcpy(b, ref + offset, count * sizeof(T));
+      for (size_t i = 0; i < count; i++) {
+        const double va = Element::value(a[i], o.quantization);
+        const double vb = Element::value(b[i], o.quantization);
+        const int64_t ka = Element::key(a[i]);
+        const int64_t kb = Element::key(b[i]);
+        const double diff = std::fabs(va - vb);
+        // Unsigned, the distance of int64 extremes does not fit int64_t
+        const uint64_t d =
+            static_cast<uint64_t>(ka) - static_cast<uint64_t>(kb);
+        ulp[i] = (ka > kb) ? d : (0 - d);
+        // Bitwise operators keep the loop free of branches. A NaN matches
+        // only another NaN.
+        const bool nanA = (va != va);
+        const bool nanB = (vb != vb);
+        const bool close = (ulp[i] <= p.ulpTolerance) |
+                           (diff <= p.absTolerance) |
+                           (diff <= p.relTolerance * std::fabs(vb));
+        const bool match = (nanA & nanB) | (!nanA & !nanB & close);
+        mismatch[i] = static_cast<uint8_t>(!match);
+        error[i] = (nanA | nanB) ? 0.0 : diff;
+      }
+      size_t numMismatches = 0;
+      double maxError = 0.0;
+      uint64_t maxUlp = 0;
+      for (size_t i = 0; i < count; i++) {
+        numMismatches += mismatch[i];
+        maxError = std::max(maxError, error[i]);
+        maxUlp = std::max(maxUlp, ulp[i]);
+      }
+      report.numMismatches += numMismatches;
+      report.maxAbsError = std::max(report.maxAbsError, maxError);
+      report.maxUlpError = std::max(report.maxUlpError, maxUlp);
+      for (size_t i = 0; (i < count) && (numMismatches > 0) &&
+                         (report.firstMismatches.size() <
+                          p.maxReportedMismatches);
+           i++) {
+        if (mismatch[i]) {
+          report.firstMismatches.push_back(base + i);
+        }
+      }
+    }
+  }
+
+  std::unordered_map<std::string, Output> outputs_;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_OUTPUT_VALIDATOR_HPP
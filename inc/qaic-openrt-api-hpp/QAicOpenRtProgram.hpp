@@ -106,6 +106,7 @@ public:
       throw CoreExceptionRuntime("Failed to get Program Status");
     }
     return ((info.status == QAicProgramStatus::QAIC_PROGRAM_FULLY_ACTIVATED) ||
+            (info.status == QAicProgramStatus::QAIC_PROGRAM_STANDBY) ||
             (info.status == QAicProgramStatus::QAIC_PROGRAM_LOADED));
   }
 
@@ -122,6 +123,20 @@ public:
         QAicProgramActivationCmd::QAIC_PROGRAM_CMD_ACTIVATE_FULL);
   }
 
+  /// \brief Activate a program in standby. Device resources are assigned
+  /// but the program does not run. The next activate(), or the first run()
+  /// or runAsync() of an ExecObj of the program, moves it to ready before
+  /// submitting, which only has to make the activation ready. A program
+  /// already activated is left as is.
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Internal error in activating program
+  /// \retval QS_ERROR Failed to run Activation command, e.g. the device
+  /// lacks the resources to hold the program in standby
+  QStatus standby() {
+    return program_->processActivateCmd(
+        QAicProgramActivationCmd::QAIC_PROGRAM_CMD_ACTIVATE_STANDBY);
+  }
+
   /// \brief Deactivate a program. This is an optional step, the program will
   /// automatically be deactivated when all references to the program
   /// are destroyed, e.g, when no execObj are pointing to the program
@@ -147,6 +162,19 @@ public:
     return info.status == QAicProgramStatus::QAIC_PROGRAM_FULLY_ACTIVATED;
   }
 
+  /// \brief Returns the standby state of a program
+  /// \retval true If program is currently activated in standby
+  /// \retval false If program is not currently in standby
+  /// \exception CoreExceptionRuntime
+  /// - When failed to get program info
+  bool isStandby() {
+    QAicProgramInfo info;
+    if (program_->getProgramInfo(info) != QS_SUCCESS) {
+      throw CoreExceptionRuntime("Failed to get Program Status");
+    }
+    return info.status == QAicProgramStatus::QAIC_PROGRAM_STANDBY;
+  }
+
   /// \brief Get Program Information
   /// \return The program info
   const ProgramInfo &getProgramInfo() const { return programInfo_; }
@@ -200,6 +228,23 @@ public:
     QProgram::initProperties(&programProperties);
   }
 
+  /// \brief Initialize scheduling properties to default, which leave the
+  /// submissions of the program unscheduled unless a device budget is set
+  static void initSchedProperties(QAicProgramSchedProperties &properties) {
+    QProgram::initSchedProperties(&properties);
+  }
+
+  /// \brief Set how the submissions of this program are scheduled against
+  /// those of the other programs on its device, taken at the next activation
+  /// \param[in] properties Started from initSchedProperties
+  /// \exception CoreExceptionRuntime
+  /// - When the properties are invalid
+  void setSchedProperties(const QAicProgramSchedProperties &properties) {
+    if (program_->setSchedProperties(properties) != QS_SUCCESS) {
+      throw CoreExceptionRuntime("Invalid program sched properties");
+    }
+  }
+
   shQProgram &getProgram() { return program_; }
 
   QID getQid() const noexcept { return program_->getQid(); }
@@ -0,0 +1,463 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_PROGRAM_SWAP_HPP
+#define QAIC_OPENRT_PROGRAM_SWAP_HPP
+
+#include "QAicOpenRtLogger.hpp"
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtProgram.hpp"
+#include "QAicRuntimeTypes.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief Properties used to configure a ProgramSwap
+struct ProgramSwapProperties {
+  /// Maximum time swap() waits for the requests holding the old program to
+  /// complete before releasing it.
+  std::chrono::milliseconds drainTimeout = std::chrono::milliseconds(10000);
+  /// Maximum time acquire() waits for a program while a swap that could not
+  /// hold the new program in standby replaces the old one.
+  std::chrono::milliseconds acquireTimeout = std::chrono::milliseconds(10000);
+};
+
+/// \brief Moves one program version through its activation states. All
+/// but standby are required, a version without standby is always swapped
+/// by releasing the old version first.
+struct ProgramSwapOps {
+  /// Load images and constants on device
+  std::function<QStatus()> load;
+  /// Assign the device resources without running the program
+  std::function<QStatus()> standby;
+  /// Make the program ready for execution, from loaded or standby
+  std::function<QStatus()> activate;
+  /// Deactivate and unload
+  std::function<QStatus()> release;
+};
+
+/// \brief Outcome of the last swap
+struct ProgramSwapStats {
+  /// Version serving once the swap returned
+  uint64_t version = 0;
+  /// True when the new version was held in standby while the old one
+  /// served, new requests then never waited
+  bool standby = false;
+  /// Time new requests waited in acquire() for a program
+  std::chrono::microseconds gap = std::chrono::microseconds(0);
+  /// Time spent waiting for the requests of the old version
+  std::chrono::microseconds drain = std::chrono::microseconds(0);
+};
+
+/// \brief A ProgramSwap replaces the program serving requests with a new
+/// version without tearing the old one down first. Requests take a Lease
+/// on the current version for as long as they use it. A swap:
+/// - loads the new version and activates it in standby while the old one
+///   keeps serving,
+/// - makes it ready and redirects the leases taken from then on,
+/// - waits for the leases on the old version to be returned,
+/// - releases the old version.
+///
+/// When the device cannot hold both versions, the standby activation
+/// fails and the swap falls back to draining and releasing the old version
+/// before activating the new one. The new version is still loaded ahead,
+/// new requests wait in acquire() only for the activation.
+///
+/// ExecObjs created from the program of a lease must be released with the
+/// lease, a program with ExecObjs cannot be deactivated.
+class ProgramSwap : public Logger {
+  struct Version;
+
+public:
+  using Clock = std::chrono::steady_clock;
+  using VersionID = uint64_t;
+
+  /// \brief Holds one program version in service. Returned on destruction
+  /// or reset(), an empty lease holds nothing.
+  class Lease {
+  public:
+    Lease() = default;
+    Lease(Lease &&other) noexcept = default;
+    Lease &operator=(Lease &&other) noexcept {
+      if (this != &other) {
+        reset();
+        version_ = std::move(other.version_);
+      }
+      return *this;
+    }
+    ~Lease() { reset(); }
+
+    explicit operator bool() const { return version_ != nullptr; }
+
+    /// \brief Get the version held, 0 for an empty lease
+    VersionID getVersion() const { return version_ ? version_->id : 0; }
+
+    /// \brief Get the program of the version held, null for an empty lease
+    /// or a version swapped in with user provided operations only
+    shProgram getProgram() const {
+      return version_ ? version_->program : nullptr;
+    }
+
+    /// \brief Return the version, the lease becomes empty
+    void reset() {
+      if (!version_) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lk(version_->mutex);
+        version_->numLeases--;
+      }
+      version_->drainCv.notify_all();
+      version_.reset();
+    }
+
+    Lease(const Lease &) = delete;            // Disable Copy Constructor
+    Lease &operator=(const Lease &) = delete; // Disable Assignment Operator
+
+  private:
+    friend class ProgramSwap;
+    explicit Lease(std::shared_ptr<Version> version)
+        : version_(std::move(version)) {}
+
+    std::shared_ptr<Version> version_;
+  };
+
+  /// \brief Create a ProgramSwap serving a program
+  /// \param[in] context A previously created context
+  /// \param[in] program Program of the first version, activated if needed
+  /// \param[in] properties ProgramSwap properties
+  /// \return Shared pointer ProgramSwap
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  /// - When the program fails to load or activate
+  static shProgramSwap
+  Factory(shContext context, shProgram program,
+          const ProgramSwapProperties &properties = ProgramSwapProperties()) {
+    if (!context || !program) {
+      throw CoreExceptionInit("Invalid ProgramSwap parameters");
+    }
+    shProgramSwap obj = shProgramSwap(new (std::nothrow)
+                                          ProgramSwap(properties));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create ProgramSwap Object");
+    }
+    obj->setContext(context);
+    obj->init(programOps(program), program);
+    return obj;
+  }
+
+  /// \brief Create a ProgramSwap on top of user provided operations
+  /// \param[in] ops Operations of the first version
+  /// \param[in] properties ProgramSwap properties
+  /// \param[in] program Optional program returned by the leases
+  /// \return Shared pointer ProgramSwap
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When required operations are missing
+  /// - When the first version fails to load or activate
+  static shProgramSwap
+  Factory(ProgramSwapOps ops,
+          const ProgramSwapProperties &properties = ProgramSwapProperties(),
+          shProgram program = nullptr) {
+    shProgramSwap obj = shProgramSwap(new (std::nothrow)
+                                          ProgramSwap(properties));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create ProgramSwap Object");
+    }
+    obj->init(std::move(ops), std::move(program));
+    return obj;
+  }
+
+  /// \brief Operations driving a Program through its activation states
+  static ProgramSwapOps programOps(shProgram program) {
+    ProgramSwapOps ops;
+    ops.load = [program]() { return program->load(); };
+    ops.standby = [program]() { return program->standby(); };
+    ops.activate = [program]() { return program->activate(); };
+    ops.release = [program]() {
+      QStatus status = program->deactivate();
+      if (status != QS_SUCCESS) {
+        return status;
+      }
+      return program->unload();
+    };
+    return ops;
+  }
+
+  /// \brief Destructor waits up to drainTimeout for the leases of every
+  /// version and releases them
+  ~ProgramSwap() {
+    std::vector<std::shared_ptr<Version>> versions;
+    {
+      std::lock_guard<std::mutex> swapLk(swapMutex_);
+      {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stopping_ = true;
+        if (current_) {
+          versions.emplace_back(std::move(current_));
+        }
+      }
+      switchCv_.notify_all();
+      versions.insert(versions.end(), retired_.begin(), retired_.end());
+      retired_.clear();
+    }
+    for (auto &version : versions) {
+      if (!drain(*version, properties_.drainTimeout)) {
+        logError("Releasing program version " + std::to_string(version->id) +
+                 " with leases outstanding");
+      }
+      if (version->ops.release() != QS_SUCCESS) {
+        logError("Failed to release program version " +
+                 std::to_string(version->id));
+      }
+    }
+  }
+
+  /// \brief Take a lease on the version currently serving. Waits up to
+  /// acquireTimeout while a swap is between versions.
+  /// \return Lease, empty if no version became available or once the
+  /// ProgramSwap is being destroyed
+  Lease acquire() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (!switchCv_.wait_for(lk, properties_.acquireTimeout, [this] {
+          return stopping_ || current_ != nullptr;
+        }) ||
+        stopping_) {
+      return Lease();
+    }
+    {
+      std::lock_guard<std::mutex> versionLk(current_->mutex);
+      current_->numLeases++;
+    }
+    return Lease(current_);
+  }
+
+  /// \brief Replace the serving program by \p program
+  /// \retval QS_SUCCESS New version serving, the old one is released or,
+  /// if its leases outlived drainTimeout, released by the next swap
+  /// \retval QS_INVAL Invalid program
+  /// \retval QS_TIMEDOUT The old version did not drain in time and could not
+  /// make room for the new one, the old version keeps serving
+  /// \retval Other The new version failed to load or activate, the old
+  /// version keeps serving
+  QStatus swap(shProgram program) {
+    if (!program) {
+      return QS_INVAL;
+    }
+    return swap(programOps(program), program);
+  }
+
+  /// \brief Replace the serving version by one driven by \p ops
+  /// \param[in] ops Operations of the new version
+  /// \param[in] program Optional program returned by the leases
+  /// \return See swap(shProgram)
+  QStatus swap(ProgramSwapOps ops, shProgram program = nullptr) {
+    std::lock_guard<std::mutex> swapLk(swapMutex_);
+    releaseRetired();
+    if (!ops.load || !ops.activate || !ops.release) {
+      logError("Missing program swap operations");
+      return QS_INVAL;
+    }
+    std::shared_ptr<Version> next = makeVersion(std::move(ops), program);
+
+    QStatus status = next->ops.load();
+    if (status != QS_SUCCESS) {
+      logError("Failed to load program version " + std::to_string(next->id));
+      return status;
+    }
+
+    ProgramSwapStats stats;
+    stats.version = next->id;
+    stats.standby = next->ops.standby && (next->ops.standby() == QS_SUCCESS) &&
+                    (next->ops.activate() == QS_SUCCESS);
+    if (stats.standby) {
+      std::shared_ptr<Version> prev = exchange(next);
+      const Clock::time_point drainStart = Clock::now();
+      if (!prev) {
+        // Nothing served, a previous swap failed to restore its version
+      } else if (drain(*prev, properties_.drainTimeout)) {
+        stats.drain = sinceUs(drainStart);
+        releaseVersion(prev);
+      } else {
+        stats.drain = sinceUs(drainStart);
+        logWarn("Program version " + std::to_string(prev->id) +
+                " did not drain, released by the next swap");
+        retired_.emplace_back(std::move(prev));
+      }
+    } else {
+      logInfo("Program version " + std::to_string(next->id) +
+              " cannot be held in standby, swapping after drain");
+      status = swapAfterDrain(next, stats);
+      if (status != QS_SUCCESS) {
+        return status;
+      }
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    lastStats_ = stats;
+    return QS_SUCCESS;
+  }
+
+  /// \brief Get the version currently serving, 0 while between versions
+  VersionID getVersion() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return current_ ? current_->id : 0;
+  }
+
+  /// \brief Get the number of old versions whose leases did not drain yet
+  size_t getNumRetired() {
+    std::lock_guard<std::mutex> swapLk(swapMutex_);
+    return retired_.size();
+  }
+
+  /// \brief Get the outcome of the last successful swap
+  ProgramSwapStats getLastSwapStats() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return lastStats_;
+  }
+
+  ProgramSwap(const ProgramSwap &) = delete; // Disable Copy Constructor
+  ProgramSwap &
+  operator=(const ProgramSwap &) = delete; // Disable Assignment Operator
+
+private:
+  struct Version {
+    VersionID id = 0;
+    ProgramSwapOps ops;
+    shProgram program;
+    std::mutex mutex;
+    std::condition_variable drainCv;
+    uint32_t numLeases = 0;
+  };
+
+  explicit ProgramSwap(const ProgramSwapProperties &properties)
+      : properties_(properties) {}
+
+  void init(ProgramSwapOps ops, shProgram program) {
+    if (!ops.load || !ops.activate || !ops.release) {
+      throw CoreExceptionInit("Missing program swap operations");
+    }
+    std::shared_ptr<Version> first = makeVersion(std::move(ops), program);
+    if ((first->ops.load() != QS_SUCCESS) ||
+        (first->ops.activate() != QS_SUCCESS)) {
+      throw CoreExceptionInit("Failed to activate program");
+    }
+    lastStats_.version = first->id;
+    exchange(first);
+  }
+
+  std::shared_ptr<Version> makeVersion(ProgramSwapOps ops,
+                                       shProgram program) {
+    std::shared_ptr<Version> version = std::make_shared<Version>();
+    version->id = nextVersionId_++;
+    version->ops = std::move(ops);
+    version->program = std::move(program);
+    return version;
+  }
+
+  static std::chrono::microseconds sinceUs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start);
+  }
+
+  // Redirect the leases taken from now on, returns the version replaced
+  std::shared_ptr<Version> exchange(std::shared_ptr<Version> version) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      current_.swap(version);
+    }
+    switchCv_.notify_all();
+    return version;
+  }
+
+  static bool drain(Version &version, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lk(version.mutex);
+    return version.drainCv.wait_for(
+        lk, timeout, [&version] { return version.numLeases == 0; });
+  }
+
+  bool releaseVersion(const std::shared_ptr<Version> &version) {
+    if (version->ops.release() != QS_SUCCESS) {
+      logError("Failed to release program version " +
+               std::to_string(version->id));
+      return false;
+    }
+    return true;
+  }
+
+  // Retired versions whose leases were returned since the swap that retired
+  // them, called with swapMutex_ held
+  void releaseRetired() {
+    for (auto it = retired_.begin(); it != retired_.end();) {
+      if (drain(**it, std::chrono::milliseconds(0)) && releaseVersion(*it)) {
+        it = retired_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // The device cannot hold both versions: new requests wait while the old
+  // version drains and is released, then the new one is activated. Should
+  // that fail, the old version is activated again.
+  QStatus swapAfterDrain(const std::shared_ptr<Version> &next,
+                         ProgramSwapStats &stats) {
+    const Clock::time_point gapStart = Clock::now();
+    std::shared_ptr<Version> prev = exchange(nullptr);
+    bool drained = !prev || drain(*prev, properties_.drainTimeout);
+    stats.drain = sinceUs(gapStart);
+    if (prev && (!drained || !releaseVersion(prev))) {
+      exchange(prev);
+      (void)next->ops.release();
+      return drained ? QS_ERROR : QS_TIMEDOUT;
+    }
+
+    QStatus status = next->ops.activate();
+    if (status != QS_SUCCESS) {
+      logError("Failed to activate program version " +
+               std::to_string(next->id));
+      (void)next->ops.release();
+      if (!prev) {
+        return status;
+      }
+      if ((prev->ops.load() != QS_SUCCESS) ||
+          (prev->ops.activate() != QS_SUCCESS)) {
+        logError("Failed to restore program version " +
+                 std::to_string(prev->id));
+      } else {
+        exchange(prev);
+      }
+      return status;
+    }
+    exchange(next);
+    stats.gap = sinceUs(gapStart);
+    return QS_SUCCESS;
+  }
+
+  const ProgramSwapProperties properties_;
+  // Serializes swaps, guards retired_
+  std::mutex swapMutex_;
+  std::vector<std::shared_ptr<Version>> retired_;
+  // Guards current_, lastStats_ and stopping_
+  std::mutex mutex_;
+  std::condition_variable switchCv_;
+  std::shared_ptr<Version> current_;
+  ProgramSwapStats lastStats_;
+  bool stopping_ = false;
+  VersionID nextVersionId_ = 1;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_PROGRAM_SWAP_HPP
@@ -0,0 +1,400 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_TRAFFIC_RECORDER_HPP
+#define QAIC_OPENRT_TRAFFIC_RECORDER_HPP
+
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicRuntimeTypes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief One recorded request
+struct TrafficRequest {
+  /// Start of the request relative to the start of the recording
+  std::chrono::nanoseconds start{0};
+  /// From the start of the request to its completion
+  std::chrono::nanoseconds duration{0};
+  /// Recording thread, numbered in the order threads first recorded
+  uint32_t threadIndex = 0;
+  /// ID of the ExecObj that ran the request
+  QAicExecObjID execObjId = 0;
+  QStatus status = QS_SUCCESS;
+  /// Size of each program input, smaller than the buffer for partial
+  /// tensors
+  std::vector<uint64_t> inputSizes;
+  /// Content of each program input, empty unless payloads are recorded
+  std::vector<std::vector<uint8_t>> inputs;
+};
+
+/// \brief Requests of a recording, sorted by start time
+struct TrafficTrace {
+  uint32_t numThreads = 0;
+  bool hasPayload = false;
+  std::vector<TrafficRequest> requests;
+};
+
+/// \brief Properties used to configure a TrafficRecorder
+struct TrafficRecorderProperties {
+  /// Record the content of the inputs, the trace grows by the input size
+  /// of every request
+  bool recordPayload = false;
+  /// Requests beyond this number are counted but not recorded
+  uint64_t maxRequests = 1000000;
+};
+
+/// \brief A TrafficRecorder captures the requests run by the ExecObjs it is
+/// set on (see ExecObj::setTrafficRecorder) into a TrafficTrace: when and
+/// by which thread and ExecObj each request ran, how long it took and the
+/// size, optionally the content, of its inputs. Traces are saved to a
+/// compact binary file and replayed by TrafficReplay to reproduce the
+/// load shape of an application against any program.
+///
+/// Recording is thread safe. Each request costs two locks and, with
+/// payloads, a copy of its inputs on the thread that starts it.
+class TrafficRecorder {
+public:
+  /// \brief Create a TrafficRecorder, the recording starts now
+  /// \param[in] properties TrafficRecorder properties
+  /// \return Shared pointer TrafficRecorder
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  static shTrafficRecorder
+  Factory(const TrafficRecorderProperties &properties =
+              TrafficRecorderProperties()) {
+    if (properties.maxRequests == 0) {
+      throw CoreExceptionInit("Invalid TrafficRecorder maxRequests");
+    }
+    shTrafficRecorder obj = shTrafficRecorder(
+        new (std::nothrow) TrafficRecorder(properties));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create TrafficRecorder Object");
+    }
+    return obj;
+  }
+
+  /// \brief Record a request
+  /// \param[in] execObjId ExecObj that ran the request
+  /// \param[in] begin Start of the request
+  /// \param[in] end Completion of the request
+  /// \param[in] status Status of the request
+  /// \param[in] buffers Buffers of the request
+  /// \param[in] inputIndices Index in \a buffers of each program input
+  void record(QAicExecObjID execObjId,
+              std::chrono::steady_clock::time_point begin,
+              std::chrono::steady_clock::time_point end, QStatus status,
+              const std::vector<QBuffer> &buffers,
+              const std::vector<uint32_t> &inputIndices) {
+    TrafficRequest request =
+        makeRequest(execObjId, begin, buffers, inputIndices);
+    request.duration = end - begin;
+    request.status = status;
+    add(std::move(request));
+  }
+
+  /// \brief Start a request that completes on another thread, e.g. a run
+  /// of ExecObj::runAsync. The request is attributed to the calling thread
+  /// and its inputs are copied now, while the buffers hold them.
+  /// \param[in] execObjId ExecObj that runs the request
+  /// \param[in] buffers Buffers of the request
+  /// \param[in] inputIndices Index in \a buffers of each program input
+  /// \return The request, recorded by endRequest()
+  TrafficRequest beginRequest(QAicExecObjID execObjId,
+                              const std::vector<QBuffer> &buffers,
+                              const std::vector<uint32_t> &inputIndices) {
+    return makeRequest(execObjId, std::chrono::steady_clock::now(), buffers,
+                       inputIndices);
+  }
+
+  /// \brief Record a request of beginRequest() completed now
+  /// \param[in] request Request returned by beginRequest()
+  /// \param[in] status Status of the request
+  void endRequest(TrafficRequest request, QStatus status) {
+    request.duration =
+        std::chrono::steady_clock::now() - (start_ + request.start);
+    request.status = status;
+    add(std::move(request));
+  }
+
+  /// \brief Get the requests recorded so far
+  /// \param[out] trace Requests sorted by start time
+  void getTrace(TrafficTrace &trace) const {
+    std::lock_guard<std::mutex> lk(m_);
+    trace.numThreads = static_cast<uint32_t>(threadIndices_.size());
+    trace.hasPayload = properties_.recordPayload;
+    trace.requests = requests_;
+    // Requests are recorded at completion
+    std::stable_sort(trace.requests.begin(), trace.requests.end(),
+                     [](const TrafficRequest &a, const TrafficRequest &b) {
+                       return a.start < b.start;
+                     });
+  }
+
+  /// \brief Get the number of requests not recorded for lack of room
+  uint64_t getNumDropped() const {
+    std::lock_guard<std::mutex> lk(m_);
+    return numDropped_;
+  }
+
+  /// \brief Write the requests recorded so far to a file
+  /// \param[in] path File written
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_ERROR Failed to write the file
+  QStatus save(const std::string &path) const {
+    TrafficTrace trace;
+    getTrace(trace);
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs.is_open()) {
+      return QS_ERROR;
+    }
+    write(ofs, trace);
+    ofs.close();
+    return ofs.fail() ? QS_ERROR : QS_SUCCESS;
+  }
+
+  /// \brief Write a trace in the format of the trace files. Values are in
+  /// host byte order: a header of magic, version, flags, number of threads
+  /// and number of requests, then for each request its start, duration,
+  /// thread, ExecObj, status and input sizes, followed by the inputs when
+  /// the trace has payloads.
+  /// \param[in] os Stream written
+  /// \param[in] trace Trace to write
+  static void write(std::ostream &os, const TrafficTrace &trace) {
+    os.write(magic_, sizeof(magic_));
+    put<uint32_t>(os, version_);
+    put<uint32_t>(os, trace.hasPayload ? flagPayload_ : 0);
+    put<uint32_t>(os, trace.numThreads);
+    put<uint64_t>(os, trace.requests.size());
+    for (const auto &request : trace.requests) {
+      put<int64_t>(os, request.start.count());
+      put<int64_t>(os, request.duration.count());
+      put<uint32_t>(os, request.threadIndex);
+      put<uint32_t>(os, request.execObjId);
+      put<int32_t>(os, static_cast<int32_t>(request.status));
+      put<uint32_t>(os, static_cast<uint32_t>(request.inputSizes.size()));
+      for (uint64_t size : request.inputSizes) {
+        put<uint64_t>(os, size);
+      }
+      if (!trace.hasPayload) {
+        continue;
+      }
+      for (uint32_t i = 0; i < request.inputSizes.size(); i++) {
+        const bool present = i < request.inputs.size() &&
+                             request.inputs.at(i).size() ==
+                                 request.inputSizes.at(i);
+        put<uint8_t>(os, present ? 1 : 0);
+        if (present) {
+          os.write(reinterpret_cast<const char *>(request.inputs.at(i).data()),
+                   request.inputs.at(i).size());
+        }
+      }
+    }
+  }
+
+  /// \brief Read a trace written by write() or save()
+  /// \param[in] is Stream holding the trace
+  /// \param[out] trace Trace read
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_INVAL Malformed or truncated trace
+  /// \retval QS_UNSUPPORTED Trace of another version
+  static QStatus read(std::istream &is, TrafficTrace &trace) {
+    trace = TrafficTrace();
+    char magic[sizeof(magic_)];
+    uint32_t version = 0;
+    uint32_t flags = 0;
+    uint32_t numThreads = 0;
+    uint64_t numRequests = 0;
+    if (!is.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, magic_, sizeof(magic_)) != 0 ||
+        !get(is, version)) {
+      return QS_INVAL;
+    }
+    if (version != version_) {
+      return QS_UNSUPPORTED;
+    }
+    if (!get(is, flags) || !get(is, numThreads) || !get(is, numRequests) ||
+        (flags & ~flagPayload_) != 0) {
+      return QS_INVAL;
+    }
+
+    TrafficTrace parsed;
+    parsed.numThreads = numThreads;
+    parsed.hasPayload = (flags & flagPayload_) != 0;
+    std::chrono::nanoseconds last{0};
+    for (uint64_t r = 0; r < numRequests; r++) {
+      TrafficRequest request;
+      int64_t start = 0;
+      int64_t duration = 0;
+      int32_t status = 0;
+      uint32_t numInputs = 0;
+      if (!get(is, start) || !get(is, duration) ||
+          !get(is, request.threadIndex) || !get(is, request.execObjId) ||
+          !get(is, status) || !get(is, numInputs)) {
+        return QS_INVAL;
+      }
+      request.start = std::chrono::nanoseconds(start);
+      request.duration = std::chrono::nanoseconds(duration);
+      if (start < 0 || duration < 0 || request.start < last ||
+          request.threadIndex >= numThreads || status < QS_SUCCESS ||
+          status > QS_ERROR || numInputs > maxInputs_) {
+        return QS_INVAL;
+      }
+      last = request.start;
+      request.status = static_cast<QStatus>(status);
+      request.inputSizes.resize(numInputs);
+      for (auto &size : request.inputSizes) {
+        if (!get(is, size) || size > maxInputSize_) {
+          return QS_INVAL;
+        }
+      }
+      if (parsed.hasPayload) {
+        request.inputs.resize(numInputs);
+        for (uint32_t i = 0; i < numInputs; i++) {
+          uint8_t present = 0;
+          if (!get(is, present) || present > 1) {
+            return QS_INVAL;
+          }
+          if (present == 0) {
+            continue;
+          }
+          // Read in chunks, a corrupt size must not allocate more than the
+          // stream holds
+          std::vector<uint8_t> &input = request.inputs.at(i);
+          uint64_t remaining = request.inputSizes.at(i);
+          while (remaining > 0) {
+            const size_t chunk =
+                static_cast<size_t>(std::min<uint64_t>(remaining, 1 << 20));
+            const size_t offset = input.size();
+            input.resize(offset + chunk);
+            if (!is.read(reinterpret_cast<char *>(input.data() + offset),
+                         chunk)) {
+              return QS_INVAL;
+            }
+            remaining -= chunk;
+          }
+        }
+      }
+      parsed.requests.emplace_back(std::move(request));
+    }
+    if (is.peek() != std::char_traits<char>::eof()) {
+      return QS_INVAL;
+    }
+    trace = std::move(parsed);
+    return QS_SUCCESS;
+  }
+
+  /// \brief Read a trace file written by save()
+  /// \param[in] path File read
+  /// \param[out] trace Trace read
+  /// \retval QS_SUCCESS Successful completion
+  /// \retval QS_ERROR Failed to open the file
+  /// \retval QS_INVAL Malformed or truncated trace
+  /// \retval QS_UNSUPPORTED Trace of another version
+  static QStatus load(const std::string &path, TrafficTrace &trace) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.is_open()) {
+      return QS_ERROR;
+    }
+    return read(ifs, trace);
+  }
+
+  TrafficRecorder(const TrafficRecorder &) = delete; // Disable Copy Constructor
+  TrafficRecorder &
+  operator=(const TrafficRecorder &) = delete; // Disable Assignment Operator
+
+private:
+  explicit TrafficRecorder(const TrafficRecorderProperties &properties)
+      : properties_(properties), start_(std::chrono::steady_clock::now()) {}
+
+  TrafficRequest makeRequest(QAicExecObjID execObjId,
+                             std::chrono::steady_clock::time_point begin,
+                             const std::vector<QBuffer> &buffers,
+                             const std::vector<uint32_t> &inputIndices) {
+    TrafficRequest request;
+    request.start = begin - start_;
+    request.execObjId = execObjId;
+    bool full = false;
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      full = requests_.size() >= properties_.maxRequests;
+      auto it = threadIndices_.find(std::this_thread::get_id());
+      if (it == threadIndices_.end()) {
+        it = threadIndices_
+                 .emplace(std::this_thread::get_id(),
+                          static_cast<uint32_t>(threadIndices_.size()))
+                 .first;
+      }
+      request.threadIndex = it->second;
+    }
+    request.inputSizes.reserve(inputIndices.size());
+    for (uint32_t index : inputIndices) {
+      const QBuffer *buffer =
+          (index < buffers.size()) ? &buffers.at(index) : nullptr;
+      request.inputSizes.push_back((buffer != nullptr) ? buffer->size : 0);
+      // A request past the limit is dropped, its inputs are not copied
+      if (!properties_.recordPayload || full) {
+        continue;
+      }
+      // Inputs in device allocated memory have no payload
+      if (buffer != nullptr && buffer->buf != nullptr) {
+        request.inputs.emplace_back(buffer->buf, buffer->buf + buffer->size);
+      } else {
+        request.inputs.emplace_back();
+      }
+    }
+    return request;
+  }
+
+  void add(TrafficRequest &&request) {
+    std::lock_guard<std::mutex> lk(m_);
+    if (requests_.size() >= properties_.maxRequests) {
+      numDropped_++;
+      return;
+    }
+    requests_.emplace_back(std::move(request));
+  }
+
+  template <typename T> static void put(std::ostream &os, T value) {
+    os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  template <typename T> static bool get(std::istream &is, T &value) {
+    return static_cast<bool>(
+        is.read(reinterpret_cast<char *>(&value), sizeof(value)));
+  }
+
+  static constexpr char magic_[8] = {'Q', 'A', 'I', 'C', 'T', 'R', 'F', 0};
+  static constexpr uint32_t version_ = 1;
+  static constexpr uint32_t flagPayload_ = 1;
+  // Bounds of a sane trace, larger values come from a corrupt file
+  static constexpr uint32_t maxInputs_ = 4096;
+  static constexpr uint64_t maxInputSize_ = 1ULL << 32;
+
+  const TrafficRecorderProperties properties_;
+  const std::chrono::steady_clock::time_point start_;
+  mutable std::mutex m_;
+  std::unordered_map<std::thread::id, uint32_t> threadIndices_;
+  std::vector<TrafficRequest> requests_;
+  uint64_t numDropped_ = 0;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_TRAFFIC_RECORDER_HPP
@@ -0,0 +1,409 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_OPENRT_TRAFFIC_REPLAY_HPP
+#define QAIC_OPENRT_TRAFFIC_REPLAY_HPP
+
+#include "QAicOpenRtLogger.hpp"
+#include "QAicOpenRtExceptions.hpp"
+#include "QAicOpenRtApiFwdDecl.hpp"
+#include "QAicOpenRtExecObj.hpp"
+#include "QAicOpenRtInferenceVector.hpp"
+#include "QAicOpenRtLoadGen.hpp"
+#include "QAicOpenRtTrafficRecorder.hpp"
+#include "QAicRuntimeTypes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qaic {
+namespace openrt {
+
+/// \brief Properties used to configure a TrafficReplay
+struct TrafficReplayProperties {
+  /// Recorded start times are multiplied by this factor, 0.5 replays twice
+  /// as fast. With 0 each thread sends its next request as soon as the
+  /// previous one completed.
+  double timeScale = 1.0;
+  /// Copy the recorded inputs into the buffers of the requests, when the
+  /// trace has payloads
+  bool usePayload = true;
+};
+
+/// \brief Outcome of a TrafficReplay run
+struct TrafficReplayReport {
+  uint64_t numRequests = 0;
+  uint64_t numCompleted = 0;
+  uint64_t numFailed = 0;
+  /// Requests whose status differs from the recorded one
+  uint64_t numStatusChanged = 0;
+  /// From the first start to the last completion
+  double durationSec = 0;
+  double recordedDurationSec = 0;
+  /// From the scaled recorded start time to completion, waiting for a
+  /// thread or an ExecObj still busy with earlier requests is included
+  LoadGenLatency latency;
+  /// From the actual start of the request to completion
+  LoadGenLatency serviceTime;
+  /// Service time of the same requests when recorded
+  LoadGenLatency recordedServiceTime;
+};
+
+/// \brief Executes one request synchronously on the given buffers, with
+/// the recorded partial sizes and payloads applied to the inputs
+using TrafficExecFunction =
+    std::function<QStatus(const std::vector<QBuffer> &)>;
+
+/// \brief A TrafficReplay reproduces the load shape of a TrafficTrace: each
+/// recorded thread is replayed by a thread of its own, sending its requests
+/// in order at their recorded start times to the backend (typically one
+/// ExecObj) standing for the recorded ExecObj, with the recorded input
+/// sizes. Replaying the same trace against two runtime or program versions
+/// compares them under the same traffic.
+///
+/// Recorded inputs are matched to the program inputs in order. Sizes are
+/// limited to the buffer size and only apply to inputs allowing partial
+/// buffers, so a trace can be replayed against any program.
+class TrafficReplay : public Logger {
+public:
+  /// \brief Create a TrafficReplay running one ExecObj per recorded ExecObj
+  /// \param[in] context A previously created context
+  /// \param[in] program A previously created program shared object
+  /// \param[in] trace Requests to replay
+  /// \param[in] properties TrafficReplay properties
+  /// \param[in] inputs Initial content of the buffers, zero if null.
+  /// Requests with recorded payloads overwrite it.
+  /// \return Shared pointer TrafficReplay
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  /// - When execObj creation fails
+  static shTrafficReplay Factory(shContext context, shProgram program,
+                                 const TrafficTrace &trace,
+                                 const TrafficReplayProperties &properties,
+                                 shInferenceVector inputs = nullptr) {
+    if (!context || !program) {
+      throw CoreExceptionInit("Invalid TrafficReplay parameters");
+    }
+    std::vector<shExecObj> execObjs;
+    std::vector<TrafficExecFunction> backends;
+    for (size_t i = 0; i < getExecObjIds(trace).size(); i++) {
+      shExecObj execObj = ExecObj::Factory(context, program);
+      backends.emplace_back(
+          [execObj](const std::vector<QBuffer> &buffers) -> QStatus {
+            const QStatus status = execObj->setData(buffers);
+            return (status != QS_SUCCESS) ? status : execObj->run();
+          });
+      execObjs.emplace_back(execObj);
+    }
+    shTrafficReplay obj =
+        Factory(trace, properties, program->getBufferMappings(),
+                std::move(backends), inputs);
+    obj->setContext(context);
+    obj->execObjs_ = std::move(execObjs);
+    return obj;
+  }
+
+  /// \brief Create a TrafficReplay on top of user provided execution
+  /// backends
+  /// \param[in] trace Requests to replay
+  /// \param[in] properties TrafficReplay properties
+  /// \param[in] bufferMappings Buffers passed to the backends
+  /// \param[in] backends One execution function per recorded ExecObj, in
+  /// the order of getExecObjIds()
+  /// \param[in] inputs Initial content of the buffers, zero if null
+  /// \return Shared pointer TrafficReplay
+  /// \exception CoreExceptionNullPtr
+  /// - When memory allocation for object fails
+  /// \exception CoreExceptionInit
+  /// - When input Parameters are invalid
+  static shTrafficReplay Factory(const TrafficTrace &trace,
+                                 const TrafficReplayProperties &properties,
+                                 const BufferMappings &bufferMappings,
+                                 std::vector<TrafficExecFunction> backends,
+                                 shInferenceVector inputs = nullptr) {
+    shTrafficReplay obj = shTrafficReplay(new (std::nothrow) TrafficReplay(
+        trace, properties, bufferMappings, std::move(backends)));
+    if (!obj) {
+      throw CoreExceptionNullPtr("Failed to create TrafficReplay Object");
+    }
+    obj->init(inputs);
+    return obj;
+  }
+
+  /// \brief Get the distinct ExecObjs of a trace
+  /// \param[in] trace Recorded requests
+  /// \return ExecObj IDs in the order of their first request
+  static std::vector<QAicExecObjID> getExecObjIds(const TrafficTrace &trace) {
+    std::vector<QAicExecObjID> ids;
+    for (const auto &request : trace.requests) {
+      if (std::find(ids.begin(), ids.end(), request.execObjId) == ids.end()) {
+        ids.push_back(request.execObjId);
+      }
+    }
+    return ids;
+  }
+
+  /// \brief Replay the whole trace
+  /// \param[out] report Outcome of the replay
+  /// \retval QS_SUCCESS Successful completion, failed requests are
+  /// reported in \a report
+  /// \retval QS_BUSY Another run is in progress
+  QStatus run(TrafficReplayReport &report) {
+    std::unique_lock<std::mutex> runLock(runMutex_, std::try_to_lock);
+    if (!runLock.owns_lock()) {
+      return QS_BUSY;
+    }
+
+    std::vector<ThreadSamples> samples(threadRequests_.size());
+    start_ = Clock::now();
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threadRequests_.size(); i++) {
+      workers.emplace_back(&TrafficReplay::workerLoop, this, i,
+                           std::ref(samples.at(i)));
+    }
+    for (auto &t : workers) {
+      t.join();
+    }
+    buildReport(samples, Clock::now() - start_, report);
+    return QS_SUCCESS;
+  }
+
+  /// \brief Get the number of replay threads
+  uint32_t getNumThreads() const {
+    return static_cast<uint32_t>(threadRequests_.size());
+  }
+
+  TrafficReplay(const TrafficReplay &) = delete; // Disable Copy Constructor
+  TrafficReplay &
+  operator=(const TrafficReplay &) = delete; // Disable Assignment Operator
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // Buffers of one backend, guarded by its mutex while a request runs
+  struct Backend {
+    TrafficExecFunction exec;
+    std::mutex m;
+    std::vector<std::vector<uint8_t>> storage;
+    std::vector<QBuffer> buffers;
+  };
+
+  // Owned by one worker thread during a run
+  struct ThreadSamples {
+    uint64_t numCompleted = 0;
+    uint64_t numFailed = 0;
+    uint64_t numStatusChanged = 0;
+    Clock::duration lastDone{0};
+    std::vector<int64_t> latencyNs;
+    std::vector<int64_t> serviceNs;
+  };
+
+  TrafficReplay(const TrafficTrace &trace,
+                const TrafficReplayProperties &properties,
+                const BufferMappings &bufferMappings,
+                std::vector<TrafficExecFunction> backends)
+      : trace_(trace), properties_(properties),
+        bufferMappings_(bufferMappings) {
+    for (auto &exec : backends) {
+      backends_.emplace_back(new (std::nothrow) Backend());
+      if (backends_.back()) {
+        backends_.back()->exec = std::move(exec);
+      }
+    }
+  }
+
+  void init(const shInferenceVector &inputs) {
+    if (trace_.requests.empty()) {
+      throw CoreExceptionInit("Empty TrafficReplay trace");
+    }
+    if (!std::isfinite(properties_.timeScale) || properties_.timeScale < 0) {
+      throw CoreExceptionInit("Invalid TrafficReplay timeScale");
+    }
+    const std::vector<QAicExecObjID> ids = getExecObjIds(trace_);
+    if (backends_.size() != ids.size()) {
+      throw CoreExceptionInit("Invalid number of TrafficReplay backends");
+    }
+    for (const auto &backend : backends_) {
+      if (!backend) {
+        throw CoreExceptionNullPtr("Failed to create TrafficReplay backend");
+      }
+      if (!backend->exec) {
+        throw CoreExceptionInit("Invalid TrafficReplay backend");
+      }
+    }
+    if (inputs && inputs->getVector().size() != bufferMappings_.size()) {
+      throw CoreExceptionInit("Invalid TrafficReplay inputs");
+    }
+
+    for (const auto &mapping : bufferMappings_) {
+      if (mapping.index >= bufferMappings_.size()) {
+        throw CoreExceptionInit("Invalid TrafficReplay buffer mappings");
+      }
+      if (mapping.ioType == QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT) {
+        inputMappings_.push_back(&mapping);
+      }
+    }
+    for (auto &backend : backends_) {
+      backend->storage.resize(bufferMappings_.size());
+      backend->buffers.resize(bufferMappings_.size());
+      for (const auto &mapping : bufferMappings_) {
+        std::vector<uint8_t> &storage = backend->storage.at(mapping.index);
+        storage.assign(mapping.size, 0);
+        if (inputs) {
+          const QBuffer &initial = inputs->getVector().at(mapping.index);
+          if (initial.buf != nullptr) {
+            std::memcpy(storage.data(), initial.buf,
+                        std::min<size_t>(initial.size, storage.size()));
+          }
+        }
+        QBuffer &qbuf = backend->buffers.at(mapping.index);
+        qbuf.buf = storage.data();
+        qbuf.size = storage.size();
+        qbuf.handle = 0;
+        qbuf.offset = 0;
+        qbuf.type = QBufferType::QBUFFER_TYPE_HEAP;
+      }
+    }
+
+    uint32_t numThreads = trace_.numThreads;
+    for (uint32_t i = 0; i < trace_.requests.size(); i++) {
+      const TrafficRequest &request = trace_.requests.at(i);
+      numThreads = std::max(numThreads, request.threadIndex + 1);
+      requestBackends_.push_back(static_cast<uint32_t>(
+          std::find(ids.begin(), ids.end(), request.execObjId) -
+          ids.begin()));
+    }
+    threadRequests_.resize(numThreads);
+    for (uint32_t i = 0; i < trace_.requests.size(); i++) {
+      threadRequests_.at(trace_.requests.at(i).threadIndex).push_back(i);
+    }
+  }
+
+  // Apply the recorded sizes and payloads to the inputs of a backend
+  void prepare(const TrafficRequest &request, Backend &backend) const {
+    for (uint32_t i = 0; i < inputMappings_.size(); i++) {
+      const BufferMapping &mapping = *inputMappings_.at(i);
+      QBuffer &qbuf = backend.buffers.at(mapping.index);
+      qbuf.size = mapping.size;
+      if (i >= request.inputSizes.size()) {
+        continue;
+      }
+      if (mapping.isPartialBufferAllowed) {
+        qbuf.size = static_cast<size_t>(
+            std::min<uint64_t>(request.inputSizes.at(i), mapping.size));
+      }
+      if (properties_.usePayload && i < request.inputs.size()) {
+        const std::vector<uint8_t> &payload = request.inputs.at(i);
+        std::memcpy(qbuf.buf, payload.data(),
+                    std::min<size_t>(payload.size(), mapping.size));
+      }
+    }
+  }
+
+  void workerLoop(uint32_t threadIndex, ThreadSamples &samples) {
+    for (uint32_t requestIndex : threadRequests_.at(threadIndex)) {
+      const TrafficRequest &request = trace_.requests.at(requestIndex);
+      // The replay starts with the first recorded request
+      const Clock::time_point intended =
+          start_ + std::chrono::duration_cast<Clock::duration>(
+                       (request.start - trace_.requests.front().start) *
+                       properties_.timeScale);
+      std::this_thread::sleep_until(intended);
+
+      Backend &backend = *backends_.at(requestBackends_.at(requestIndex));
+      std::lock_guard<std::mutex> lk(backend.m);
+      prepare(request, backend);
+      const Clock::time_point begin = Clock::now();
+      QStatus status = QS_ERROR;
+      try {
+        status = backend.exec(backend.buffers);
+      } catch (const std::exception &e) {
+        logError(std::string("Request execution failed: ") + e.what());
+        status = QS_ERROR;
+      }
+      const Clock::time_point done = Clock::now();
+
+      samples.lastDone = std::max(samples.lastDone, done - start_);
+      if (status != request.status) {
+        samples.numStatusChanged++;
+      }
+      if (status != QS_SUCCESS) {
+        samples.numFailed++;
+        continue;
+      }
+      samples.numCompleted++;
+      // Unpaced requests are due when their thread is free
+      const Clock::time_point due =
+          (properties_.timeScale > 0) ? intended : begin;
+      samples.latencyNs.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(done - due)
+              .count());
+      samples.serviceNs.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(done - begin)
+              .count());
+    }
+  }
+
+  void buildReport(std::vector<ThreadSamples> &samples,
+                   Clock::duration elapsed, TrafficReplayReport &report) const {
+    report = TrafficReplayReport();
+    std::vector<int64_t> latencyNs;
+    std::vector<int64_t> serviceNs;
+    Clock::duration lastDone{0};
+    for (auto &s : samples) {
+      report.numCompleted += s.numCompleted;
+      report.numFailed += s.numFailed;
+      report.numStatusChanged += s.numStatusChanged;
+      lastDone = std::max(lastDone, s.lastDone);
+      latencyNs.insert(latencyNs.end(), s.latencyNs.begin(),
+                       s.latencyNs.end());
+      serviceNs.insert(serviceNs.end(), s.serviceNs.begin(),
+                       s.serviceNs.end());
+    }
+    report.numRequests = trace_.requests.size();
+
+    std::vector<int64_t> recordedNs;
+    std::chrono::nanoseconds recordedEnd{0};
+    for (const auto &request : trace_.requests) {
+      recordedEnd = std::max(recordedEnd, request.start + request.duration);
+      if (request.status == QS_SUCCESS) {
+        recordedNs.push_back(request.duration.count());
+      }
+    }
+    const std::chrono::nanoseconds firstStart = trace_.requests.front().start;
+    report.recordedDurationSec =
+        std::chrono::duration<double>(recordedEnd - firstStart).count();
+    report.durationSec =
+        std::chrono::duration<double>(std::min(lastDone, elapsed)).count();
+    report.latency = LoadGen::summarize(latencyNs);
+    report.serviceTime = LoadGen::summarize(serviceNs);
+    report.recordedServiceTime = LoadGen::summarize(recordedNs);
+  }
+
+  const TrafficTrace trace_;
+  const TrafficReplayProperties properties_;
+  const BufferMappings bufferMappings_;
+  std::vector<std::unique_ptr<Backend>> backends_;
+  std::vector<shExecObj> execObjs_;
+  // Program inputs in the order of the recorded input sizes
+  std::vector<const BufferMapping *> inputMappings_;
+  // Backend of each request and requests of each thread, in trace order
+  std::vector<uint32_t> requestBackends_;
+  std::vector<std::vector<uint32_t>> threadRequests_;
+  std::mutex runMutex_;
+  Clock::time_point start_;
+};
+
+} // namespace openrt
+} // namespace qaic
+
+#endif // QAIC_OPENRT_TRAFFIC_REPLAY_HPP
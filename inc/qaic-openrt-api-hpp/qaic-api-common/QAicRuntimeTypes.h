@@ -51,10 +51,36 @@ constexpr uint8_t QAIC_PROGRAM_PROPERTIES_SUBMIT_TIMEOUT_MS_DEFAULT = 0;
 /// to choose a timeout value. By default kernel sets this value as 5000
 /// millisecond and it can be changed using sysfs/module parameter.
 
+constexpr uint32_t QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT = 32;
+constexpr uint32_t QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_MAX = 32768;
+/// Number of inferences the device queue of an activation is sized to hold.
+/// Every queued inference takes the DMA request elements of the program in
+/// the queue, the queue size is derived from their count.
+
+constexpr uint32_t QAIC_PROGRAM_PROPERTIES_SCHED_WEIGHT_DEFAULT = 1;
+/// Share of the device a program gets among the programs of its priority
+/// class that have submissions waiting, relative to their weights.
+
+constexpr uint32_t QAIC_PROGRAM_PROPERTIES_SCHED_MAX_WAIT_US_DEFAULT = 100000;
+/// Submissions of a program waiting longer than this are served ahead of
+/// higher priority programs, so that no program starves. Zero disables it.
+
+/// \brief Priority class of the submissions of a program, a device serves
+/// waiting submissions of a higher class first
+enum class QAicSchedPriority : uint32_t {
+  QAIC_SCHED_PRIORITY_HIGH = 0,
+  QAIC_SCHED_PRIORITY_NORMAL = 1,
+  QAIC_SCHED_PRIORITY_LOW = 2,
+};
+
 /// \brief Buffer Type for inference buffers
 enum class QBufferType : uint32_t {
   /// QBUFFER_TYPE_HEAP (default)
   QBUFFER_TYPE_HEAP = 0,
+  /// QBUFFER_TYPE_DMABUF, caller owned memory exported as a dma-buf,
+  /// \a handle is the dma-buf file descriptor and \a buf the optional
+  /// CPU mapping of it
+  QBUFFER_TYPE_DMABUF = 1,
   QBUFFER_TYPE_INVAL = std::numeric_limits<uint32_t>::max()
 };
 
@@ -519,9 +545,47 @@ struct QAicProgramProperties {
   uint64_t reserved02;
 };
 
+/// \brief Scheduling of the submissions of a program against those of the
+/// other programs on its device, set with QProgram::setSchedProperties and
+/// taken at the next activation.
+///
+/// None of this holds submissions back by default: priorities and weights
+/// only order submissions that wait for a device budget, set by
+/// DeviceInFlight or QAIC_SCHED_DEVICE_INFLIGHT. Without either, a program
+/// asking for a priority or weight other than the default gets a budget of
+/// the deepest VC queue of the programs on the device.
+///
+/// StructSize is set by initSchedProperties to the size the caller was built
+/// with, fields added later are appended and a smaller size is rejected.
+struct QAicProgramSchedProperties {
+  uint32_t StructSize;
+  /// QAicSchedPriority of the submissions of the program
+  uint32_t Priority;
+  /// Share of the device among programs of the same priority
+  uint32_t Weight;
+  /// Inferences of the program on the device at once, 0 is unlimited
+  uint32_t MaxInFlight;
+  /// How long higher priorities may hold the submissions of the program
+  /// back, 0 is unbounded
+  uint32_t MaxWaitUs;
+  /// Inferences of all programs on the device at once. The smallest budget
+  /// asked by the activations on a device applies, 0 asks for none and
+  /// leaves it to QAIC_SCHED_DEVICE_INFLIGHT, which is unset by default.
+  uint32_t DeviceInFlight;
+  /// Inferences the device queue holds before submissions wait for room,
+  /// 0 selects QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT, at most
+  /// QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_MAX. Raised for the next
+  /// activation when submissions often find the queue full.
+  uint32_t NumInferencesInFlight;
+};
+
 /// Define execObj properties as created
 enum class QAicExecObjPropertiesBitField {
   QAIC_EXECOBJ_PROPERTIES_AUTO_LOAD_ACTIVATE = 0x04,
+  /// Spin on the completion of an inference before blocking, for latency
+  /// critical single stream use. Costs a core while waiting, the spin budget
+  /// is set with QAIC_BUSY_POLL_BUDGET_US, 0 to 1000000 us, default 100.
+  QAIC_EXECOBJ_PROPERTIES_BUSY_POLL = 0x08,
   QAIC_EXECOBJ_PROPERTIES_DEFAULT = QAIC_EXECOBJ_PROPERTIES_AUTO_LOAD_ACTIVATE,
 };
 using QAicExecObjProperties = uint32_t;
@@ -555,6 +619,9 @@ enum class QAicProgramStatus {
   /// Program is currently activated, all resources to run the program have been
   /// assigned and initialized successfully
   QAIC_PROGRAM_FULLY_ACTIVATED = 2,
+  /// Program resources have been assigned, the program becomes fully
+  /// activated without reloading when an inference is enqueued
+  QAIC_PROGRAM_STANDBY = 3,
   /// All numbers above this are errors
   QAIC_PROGRAM_ERROR = 100,
   /// Program load error occurred
@@ -568,6 +635,9 @@ enum class QAicProgramActivationCmd {
   QAIC_PROGRAM_CMD_ACTIVATE_FULL = 0,
   /// Command to fully deactivate
   QAIC_PROGRAM_CMD_DEACTIVATE_FULL = 1,
+  /// Command to activate in standby, resources are assigned but the
+  /// program does not run until fully activated
+  QAIC_PROGRAM_CMD_ACTIVATE_STANDBY = 2,
   /// Reserved
   QAIC_PROGRAM_CMD_RESERVED = 100,
   QAIC_PROGRAM_CMD_INVAL = 101
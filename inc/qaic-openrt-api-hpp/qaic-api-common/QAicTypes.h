@@ -34,6 +34,13 @@ typedef enum {
   QS_UNSUPPORTED = 11,
   /// CRC Data Transfer Error
   QS_DATA_CRC_ERROR = 12,
+  /// The deadline of the request passed before it completed
+  QS_DEADLINE_EXCEEDED = 13,
+  /// The request was canceled before it was submitted
+  QS_CANCELED = 14,
+  /// The device was reset and the program is being re-established, the
+  /// request can be retried
+  QS_DEVICE_RECOVERING = 15,
   /// Generic device error
   QS_DEV_ERROR = 300,
   /// Generic error
@@ -16,7 +16,10 @@ public:
   enum BufferTransformType { INITIAL = 0, TRANSFORMED = 1 };
 
   QBindingsParser();
-  bool init(const aicnwdesc::networkDescriptor &protoDesc);
+  /// \a ioDescPb is a serialized IO descriptor previously generated for the
+  /// same network descriptor, e.g. from the program cache
+  bool init(const aicnwdesc::networkDescriptor &protoDesc,
+            const std::vector<uint8_t> *ioDescPb = nullptr);
 
   QStatus getIoBufferInfo(QAicIoBufferInfo *&ioBufferInfo) const;
   QStatus getIoBufferInfoDma(QAicIoBufferInfo *&ioBufferInfoDma) const;
@@ -46,6 +49,7 @@ private:
   bool validate();
   // Support for parsing and generating protocol buffer based IO Descriptor
   bool generateIoDescPb(const aicnwdesc::networkDescriptor &protoDesc);
+  bool restoreIoDescPb(const std::vector<uint8_t> &ioDescPb);
 
   // Support for parsing and generating legacy IO Descriptor
   bool generateIoDesc(const aicnwdesc::networkDescriptor &protoDesc);
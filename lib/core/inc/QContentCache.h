@@ -0,0 +1,132 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QCONTENT_CACHE_H
+#define QCONTENT_CACHE_H
+
+#include "QAicRuntimeTypes.h"
+#include "QUtil.h"
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace qaic {
+
+/// SHA-256 of the content of a load
+using QContentDigest = qutil::Sha256::Digest;
+
+/// Identifies what was loaded on a device by its content
+struct QContentKey {
+  QID qid = 0;
+  QContentDigest digest = {};
+  uint64_t size = 0;
+
+  bool operator<(const QContentKey &other) const {
+    return std::tie(qid, digest, size) <
+           std::tie(other.qid, other.digest, other.size);
+  }
+};
+
+/// Digest of the segments making up a load, in the order they are loaded.
+/// Each segment is prefixed with its size, so that the same bytes split
+/// into other segments are other content. Equal digests are trusted to be
+/// equal content, by other processes too.
+class QContentHasher {
+public:
+  void add(const void *data, size_t size) {
+    const uint64_t segmentSize = size;
+    sha_.update(&segmentSize, sizeof(segmentSize));
+    sha_.update(data, size);
+    size_ += size;
+  }
+  QContentDigest getDigest() const { return sha_.getDigest(); }
+  uint64_t getSize() const { return size_; }
+
+private:
+  qutil::Sha256 sha_;
+  uint64_t size_ = 0;
+};
+
+/// Objects loaded on a device, shared by everything in the process that
+/// loads the same content. An object lives for as long as one of its users
+/// holds it, the cache only keeps track of it.
+template <typename T> class QContentCache {
+public:
+  using Factory = std::function<std::shared_ptr<T>()>;
+
+  /// Returns the live object loaded from the content of \p key, or the one
+  /// \p factory creates. While another caller creates it, waits for that
+  /// one instead of loading the same content twice. \p reused is set when
+  /// an existing object is returned.
+  std::shared_ptr<T> get(const QContentKey &key, const Factory &factory,
+                         bool &reused) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      auto it = entries_.find(key);
+      if (it == entries_.end()) {
+        break;
+      }
+      if (!it->second.loading) {
+        if (std::shared_ptr<T> obj = it->second.obj.lock()) {
+          reused = true;
+          return obj;
+        }
+        entries_.erase(it);
+        break;
+      }
+      loadedCv_.wait(lock);
+    }
+    prune();
+    entries_[key].loading = true;
+    lock.unlock();
+
+    std::shared_ptr<T> obj = factory();
+
+    lock.lock();
+    if (obj) {
+      entries_[key] = {obj, false};
+    } else {
+      // A waiter tries for itself
+      entries_.erase(key);
+    }
+    loadedCv_.notify_all();
+    reused = false;
+    return obj;
+  }
+
+  /// Objects alive
+  size_t getNumEntries() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    prune();
+    return entries_.size();
+  }
+
+private:
+  struct Entry {
+    std::weak_ptr<T> obj;
+    bool loading = false;
+  };
+
+  // Called with mutex_ held
+  void prune() {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (!it->second.loading && it->second.obj.expired()) {
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable loadedCv_;
+  std::map<QContentKey, Entry> entries_;
+};
+
+} // namespace qaic
+
+#endif // QCONTENT_CACHE_H
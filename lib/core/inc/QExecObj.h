@@ -3,6 +3,9 @@
 
 #ifndef QEXECOBJ_H
 #define QEXECOBJ_H
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <queue>
 
 #include "QAicRuntimeTypes.h"
@@ -15,6 +18,9 @@
 #include "QAicApi.pb.h"
 #include "metadataflatbufDecode.hpp"
 #include "QProgram.h"
+#include "QDmabufCache.h"
+#include "QNumaTopology.h"
+#include "QExecRunState.h"
 
 namespace qaic {
 
@@ -32,6 +38,10 @@ class ExecObjProfilingHandle;
 class ExecObjProfiling;
 using QSessionID = std::atomic_uint64_t;
 
+// Number of dma-buf registrations kept per ExecObj, a producer cycling through
+// a pool of frames up to this size never imports the same dma-buf twice
+constexpr size_t dmabufBindingCacheSize = 8;
+
 class QExecObj : public virtual QComponent, private QIAicApiContext {
 public:
   static shQExecObj createExecObj(shQContext context,
@@ -50,7 +60,24 @@ public:
 
   virtual QStatus submit();
   virtual QStatus finish();
+  // run() and runAsync() move a program activated in standby to ready
+  // before submitting
   virtual QStatus run();
+  // Submits the inference and returns, \a done is called from a completion
+  // thread once outputs are post processed. The ExecObj must outlive the call
+  // to \a done and not be submitted again before it.
+  virtual QStatus runAsync(QWaitCallback done);
+  // Runs starting or submitting past \a deadline are dropped with
+  // QS_DEADLINE_EXCEEDED, and the wait of run() returns it at the deadline.
+  // The wait of runAsync() is not cut short. time_point::max() disables it.
+  // An inference left on the device by a run cut short is waited for by the
+  // next run, up to the deadline of that run. Busy polling spins within the
+  // deadline.
+  virtual void setDeadline(std::chrono::steady_clock::time_point deadline);
+  // Drops a run() or runAsync() that has not submitted its inference yet,
+  // it returns QS_CANCELED. QS_BUSY once the inference is on the device,
+  // QS_INVAL when the ExecObj is not running.
+  virtual QStatus cancel();
 
   virtual QStatus prepareToSubmit();
   virtual bool isReady(); // Program is loaded and activated
@@ -76,8 +103,25 @@ private:
 
   QBuffer *getBufferArrayPtr();
   bool initPrePostTransforms();
+  void bindCallingThread();
   QStatus preTransform();
   QStatus postTransform();
+  QStatus runPending();
+  QStatus runAsyncPending(QWaitCallback done);
+  QStatus readyFromStandby();
+  QStatus beginRun();
+  QStatus claimSubmit();
+  std::function<QStatus(QInfHandle &, std::chrono::steady_clock::time_point)>
+  lateInferenceWaiter();
+  void initDirectDmaIndex();
+  QStatus bindDmabufs(const uint32_t numBuffers, const QBuffer *buffers);
+  // Inference handle and its DMA buffers, either the default heap one or one
+  // with caller dma-bufs imported in place of some of the DMA buffers
+  struct InfBinding {
+    std::shared_ptr<QInfHandle> infHandle;
+    std::vector<QBuffer> dmaBuffers;
+  };
+  void useInfBinding(const std::shared_ptr<InfBinding> &binding);
   static constexpr QAicExecObjProperties defaultExecObjProperties_ =
       static_cast<uint32_t>(
           QAicExecObjPropertiesBitField::QAIC_EXECOBJ_PROPERTIES_DEFAULT);
@@ -95,10 +139,23 @@ private:
   std::vector<QBuffer> userQBuffersVec_;        // user Buffers
   std::shared_ptr<QInfHandle> infHandle_;
   std::vector<QBuffer> dmaBuffers_;
+  std::shared_ptr<InfBinding> defaultBinding_;
+  std::shared_ptr<InfBinding> activeBinding_;
+  QDmabufCache<InfBinding> dmabufCache_;
+  // DMA buffer a user buffer can be bound to directly, -1 when the buffer
+  // needs a transform, is partial or shares its DMA buffer
+  std::vector<int32_t> directDmaIndex_;
   aicppp::BufferBindings bufferBindings_; // For Pre/Post Processing
   QProgramDevice *programDevice_;
   bool initialized_;
+  // Spin budget of a wait, 0 when busy polling is not enabled
+  uint32_t busyPollBudgetUs_;
+  // Placement of calling threads, null when NUMA placement is disabled
+  QNumaPlacementShared numaPlacement_;
   bool hasPartialTensor_;
+  // Deadline, cancellation and the inference left on the device by a run
+  // cut short at its deadline
+  QExecRunState<QInfHandle> runState_;
 };
 
 } // namespace qaic
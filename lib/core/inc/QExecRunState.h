@@ -0,0 +1,130 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QEXEC_RUN_STATE_H
+#define QEXEC_RUN_STATE_H
+
+#include "QAicRuntimeTypes.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace qaic {
+
+/// Run state of an ExecObj. A run is pending from begin() until
+/// claimSubmit(), only then can it be canceled, and it goes back to idle
+/// with end().
+///
+/// A run whose wait returned at its deadline leaves its inference on the
+/// device, still using the DMA buffers of \p Handle. It is kept as the late
+/// inference and waited for before the next run uses the buffers, no longer
+/// than that run has until its own deadline.
+template <typename Handle> class QExecRunState {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  QExecRunState() = default;
+  QExecRunState(const QExecRunState &) = delete;
+  QExecRunState &operator=(const QExecRunState &) = delete;
+
+  /// Clock::time_point::max() disables the deadline
+  void setDeadline(Clock::time_point deadline) { deadline_ = deadline; }
+  Clock::time_point getDeadline() const { return deadline_; }
+  bool hasDeadline() const {
+    return deadline_.load() != Clock::time_point::max();
+  }
+  bool isDeadlinePassed() const {
+    return hasDeadline() && (Clock::now() >= deadline_.load());
+  }
+
+  /// Moves an idle run to pending, once the late inference is reaped.
+  /// \p waitUntil(handle, deadline) waits for an inference and returns
+  /// QS_DEADLINE_EXCEEDED when it is still running at \p deadline.
+  /// \returns QS_DEADLINE_EXCEEDED when the deadline passed, either before
+  /// or while waiting for the late inference, QS_BUSY when already running
+  template <typename WaitUntil> QStatus begin(WaitUntil &&waitUntil) {
+    if (isDeadlinePassed()) {
+      return QS_DEADLINE_EXCEEDED;
+    }
+    State expected = State::Idle;
+    if (!state_.compare_exchange_strong(expected, State::Pending)) {
+      return QS_BUSY;
+    }
+    // Owned by the run from here, concurrent begin() calls failed above
+    if (reapLate(waitUntil, deadline_) == QS_DEADLINE_EXCEEDED) {
+      state_ = State::Idle;
+      return QS_DEADLINE_EXCEEDED;
+    }
+    return QS_SUCCESS;
+  }
+
+  /// Last point a pending run can be dropped, past it the inference is on
+  /// the device and cannot be withdrawn.
+  /// \returns QS_CANCELED when canceled meanwhile
+  QStatus claimSubmit() {
+    if (isDeadlinePassed()) {
+      return QS_DEADLINE_EXCEEDED;
+    }
+    State expected = State::Pending;
+    if (!state_.compare_exchange_strong(expected, State::Submitted)) {
+      return QS_CANCELED;
+    }
+    return QS_SUCCESS;
+  }
+
+  /// \returns QS_BUSY once the inference is on the device or the run was
+  /// canceled already, QS_INVAL when not running
+  QStatus cancel() {
+    State expected = State::Pending;
+    if (state_.compare_exchange_strong(expected, State::Canceled)) {
+      return QS_SUCCESS;
+    }
+    if ((expected == State::Submitted) || (expected == State::Canceled)) {
+      return QS_BUSY;
+    }
+    return QS_INVAL;
+  }
+
+  /// Keeps the inference of a run whose wait returned at its deadline, the
+  /// next run waits for it
+  void setLate(std::shared_ptr<Handle> late) { late_ = std::move(late); }
+
+  void end() { state_ = State::Idle; }
+
+  bool isRunning() const { return state_.load() != State::Idle; }
+  bool hasLateInference() const { return late_ != nullptr; }
+
+  /// Waits for the late inference without bound, e.g. before its buffers
+  /// are released. Not to be called while running.
+  template <typename WaitUntil> QStatus reapLate(WaitUntil &&waitUntil) {
+    return reapLate(waitUntil, Clock::time_point::max());
+  }
+
+private:
+  enum class State : uint32_t { Idle, Pending, Canceled, Submitted };
+
+  template <typename WaitUntil>
+  QStatus reapLate(WaitUntil &waitUntil, Clock::time_point deadline) {
+    if (late_ == nullptr) {
+      return QS_SUCCESS;
+    }
+    QStatus status = waitUntil(*late_, deadline);
+    if (status == QS_DEADLINE_EXCEEDED) {
+      // Still on the device, the next run waits for it again
+      return status;
+    }
+    // Done, or failed past the retries of the wait, it is not waited for
+    // again
+    late_.reset();
+    return status;
+  }
+
+  std::atomic<State> state_{State::Idle};
+  std::atomic<Clock::time_point> deadline_{Clock::time_point::max()};
+  std::shared_ptr<Handle> late_;
+};
+
+} // namespace qaic
+
+#endif // QEXEC_RUN_STATE_H
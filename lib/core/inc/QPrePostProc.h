@@ -22,6 +22,8 @@ public:
   QStatus
   processOutputBuffers(const aicppp::BufferBindings &bufferBindings) const;
   QStatus validateTransformKind();
+  // Hook called with every block of temporaries before first use
+  void setTempBlockHook(aicppp::PrePostProcessor::TempBlockHook hook);
 
 private:
   std::unique_ptr<aicppp::PrePostProcessor> ppp_;
@@ -30,6 +30,8 @@ using shQProgram = std::shared_ptr<QProgram>;
 class QIConstants;
 using shQIConstants = std::shared_ptr<QIConstants>;
 
+struct QProgramCacheEntry;
+
 QAicObjId getNextObjId();
 
 class QProgram : public virtual QComponent,
@@ -47,6 +49,7 @@ public:
   };
 
   static QStatus initProperties(QAicProgramProperties *properties);
+  static QStatus initSchedProperties(QAicProgramSchedProperties *properties);
 
   static shQProgram createProgram(shQContext context,
                                   const QAicProgramProperties &properties,
@@ -83,6 +86,16 @@ public:
   const std::string strIoBindings(const aicapi::IoBinding *binding) const;
   const shQContext &context() { return context_; }
   QStatus getDeviceQueueLevel(uint32_t &fillLevel, uint32_t &queueSize);
+  /// Taken at the next activation, QS_INVAL when \p properties is older
+  /// than this library supports
+  QStatus setSchedProperties(const QAicProgramSchedProperties &properties);
+  QAicProgramSchedProperties getSchedProperties() const;
+  /// \p callback is called once an image or constants the activation is
+  /// attached to are gone with the process that loaded them. Work on the
+  /// program fails with QS_DEVICE_RECOVERING until it is activated again,
+  /// which loads them again. Called from a thread of the runtime that the
+  /// callback must not block on the program, nullptr stops it.
+  void setSharedImageLostCallback(std::function<void()> callback);
 
   bool isManuallyActivated();
   AicMetadataFlat::MetadataT getMetadata() const {
@@ -124,7 +137,7 @@ protected:
   const QData &getProgramBuffer();
   bool hasPartialTensor() const { return hasPartialTensor_; };
   const QAicProgramProperties programProperties_;
-  bool updateInternalData();
+  bool updateInternalData(const QProgramCacheEntry *cached = nullptr);
   QID dev_;
   shQIConstants constants_;
   QBuffer constantsQBuffer_;
@@ -142,6 +155,7 @@ protected:
 
 private:
   bool init();
+  bool extractMetadata();
   QStatus activate(QID dev);
   QStatus deactivate(QID dev);
   QStatus parseIoDescriptor();
@@ -151,6 +165,7 @@ private:
                         uint32_t maxSize);
 
   const std::string strBufferMappings(const QAicBufferMappings *mapping) const;
+  void notifySharedImageLost();
 
   QAicIoBufferInfo *bufferInfoDma_;
 
@@ -182,6 +197,17 @@ private:
                                 QAIC_PROGRAM_PROPERTIES_SELECT_MASK_DEFAULT),
       QAIC_PROGRAM_PROPERTIES_SUBMIT_NUM_RETRIES_DEFAULT,
       QAIC_PROGRAM_PROPERTIES_SUBMIT_TIMEOUT_MS_DEFAULT, 0};
+  static constexpr QAicProgramSchedProperties defaultSchedProperties_ = {
+      sizeof(QAicProgramSchedProperties),
+      static_cast<uint32_t>(QAicSchedPriority::QAIC_SCHED_PRIORITY_NORMAL),
+      QAIC_PROGRAM_PROPERTIES_SCHED_WEIGHT_DEFAULT, 0,
+      QAIC_PROGRAM_PROPERTIES_SCHED_MAX_WAIT_US_DEFAULT, 0,
+      QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT};
+  // Held while the callback runs, so that replacing it waits for it
+  std::mutex sharedImageLostMutex_;
+  std::function<void()> sharedImageLostCallback_;
+  mutable std::mutex schedPropertiesMutex_;
+  QAicProgramSchedProperties schedProperties_ = defaultSchedProperties_;
   const char *userName_;
   std::vector<uint8_t> updatedNwDescData_;
 };
@@ -0,0 +1,97 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QPROGRAM_CACHE_H
+#define QPROGRAM_CACHE_H
+
+#include "QAicRuntimeTypes.h"
+#include "QLogger.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace qaic {
+
+/// Identifies a QPC by the content of its network image and network
+/// descriptor
+struct QProgramCacheKey {
+  uint64_t networkHash = 0;
+  uint64_t networkSize = 0;
+  uint64_t networkDescHash = 0;
+  uint64_t networkDescSize = 0;
+
+  bool operator==(const QProgramCacheKey &other) const {
+    return (networkHash == other.networkHash) &&
+           (networkSize == other.networkSize) &&
+           (networkDescHash == other.networkDescHash) &&
+           (networkDescSize == other.networkDescSize);
+  }
+};
+
+/// Program state derived from a QPC that is expensive to rebuild
+struct QProgramCacheEntry {
+  /// Metadata section of the network ELF as found in the image
+  std::vector<uint8_t> metadata;
+  /// Bytes of metadata in front of the flatbuffer, e.g. a terminator header.
+  /// The flatbuffer behind it passed verification when the entry was stored.
+  uint32_t metadataHeaderSize = 0;
+  /// Serialized aicapi::IoDesc generated by QBindingsParser
+  std::vector<uint8_t> ioDescPb;
+};
+
+class QProgramCache;
+using shQProgramCache = std::shared_ptr<QProgramCache>;
+
+/// On disk cache of parsed programs, one file per QPC content. Entries are
+/// only used by the runtime version that wrote them and every read is
+/// checked against a hash of the file, a stale or corrupt entry is removed
+/// and rebuilt by the next store.
+class QProgramCache : virtual public QLogger {
+public:
+  static constexpr uint32_t formatVersion = 1;
+
+  explicit QProgramCache(std::string dir);
+
+  static QProgramCacheKey makeKey(const QData &network,
+                                  const QData &networkDesc);
+
+  /// QS_SUCCESS on a hit, QS_ERROR when there is no usable entry
+  QStatus lookup(const QProgramCacheKey &key, QProgramCacheEntry &entry);
+  /// Writes the entry to a temporary file and renames it in place, so
+  /// concurrent processes never see a partial entry
+  QStatus store(const QProgramCacheKey &key, const QProgramCacheEntry &entry);
+
+  std::string getEntryPath(const QProgramCacheKey &key) const;
+  const std::string &getDir() const { return dir_; }
+
+  uint64_t getNumHits() const { return numHits_; }
+  uint64_t getNumMisses() const { return numMisses_; }
+
+  /// Entries written by another runtime version are ignored
+  static std::string getRuntimeVersion();
+
+private:
+  const std::string dir_;
+  std::atomic<uint64_t> numHits_{0};
+  std::atomic<uint64_t> numMisses_{0};
+};
+
+/// Owner of the process wide cache, enabled by pointing
+/// QAIC_PROGRAM_CACHE_DIR at a writable directory
+class QProgramCacheManager {
+public:
+  /// nullptr when the cache is disabled
+  static shQProgramCache getProgramCache();
+
+private:
+  static shQProgramCache programCache_;
+  static bool initialized_;
+  static std::mutex m_;
+};
+
+} // namespace qaic
+
+#endif // QPROGRAM_CACHE_H
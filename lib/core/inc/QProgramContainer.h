@@ -4,7 +4,9 @@
 #ifndef QProgramCONTAINER_H
 #define QProgramCONTAINER_H
 
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "QAicRuntimeTypes.h"
 #include "QUtil.h"
@@ -13,6 +15,8 @@
 #include "AICNetworkDesc.pb.h"
 #include "QLogger.h"
 #include "QBindingsParser.h"
+#include "QContentCache.h"
+#include "QSharedImageRegistry.h"
 
 namespace qaic {
 
@@ -37,6 +41,12 @@ public:
   virtual ~QDeviceImageCommon();
   QNNConstantsInterface *getConstants();
   bool isLoaded() { return true; }
+  /// Loads the constants again when they were attached to the load of
+  /// another process that exited since
+  QStatus reloadIfStale(QProgramContainer *programContainer);
+  /// Watches the load of another process the constants are attached to,
+  /// see QSharedImageRegistry::watch(). \return 0 when not attached
+  uint64_t watchShared(QSharedImageRegistry::LostCallback onLost);
 
   QDeviceImageCommon(const QDeviceImageCommon &) =
       delete; // Disable copy constructor
@@ -56,6 +66,12 @@ private:
   QRuntimeInterface *rt_;
   QNNConstantsInterface *constDesc_;
   QNNConstantsInterface *const_;
+  // Set while the constants are claimed in the shared image registry
+  QSharedImageRegistry *registry_;
+  QSharedImageKey sharedKey_;
+  bool shared_;
+  // Serializes reloads by the programs sharing the constants
+  std::mutex reloadMutex_;
 };
 
 class QDeviceImage : virtual public QLogger {
@@ -68,6 +84,15 @@ public:
   QNNImageInterface *getNNImage();
   QNNConstantsInterface *getConstants();
   bool isLoaded() { return true; }
+  /// Same as QDeviceImageCommon::reloadIfStale() for the network image and
+  /// its constants
+  QStatus reloadIfStale(QProgramContainer *programContainer);
+  /// Calls \p onLost once a load of another process the image or its
+  /// constants are attached to is gone with that process. Replaces the
+  /// previous watch.
+  void watchShared(const QSharedImageRegistry::LostCallback &onLost);
+  /// Stops watchShared(), waits for a callback running on another thread
+  void unwatchShared();
   QDeviceImage(const QDeviceImage &) = delete; // Disable copy constructor
   QDeviceImage &
   operator=(const QDeviceImage &) = delete; // Disable assignment operator
@@ -83,6 +108,12 @@ private:
   QRuntimeInterface *rt_;
   shQDeviceImageCommon commonImage_;
   QNNImageInterface *networkImage_;
+  // Set while the image is claimed in the shared image registry
+  QSharedImageRegistry *registry_;
+  QSharedImageKey sharedKey_;
+  bool shared_;
+  // Handles of watchShared() in the registry of the process
+  std::vector<uint64_t> watches_;
 };
 
 class QProgramContainer {
@@ -120,7 +151,17 @@ public:
   aicnwdesc::networkDescriptor &getNetworkDescriptor() { return networkDesc_; }
   void getConstantsBuffer(QBuffer &staticCompileTimeConstBuf,
                           QBuffer &dynamicCompileTimeConstBuf);
+  // Constants of a compressed QPC are not held decompressed, they are
+  // decompressed while being loaded with loadCompressedConstants()
+  bool hasCompressedConstants() const { return compressedConstants_; }
+  QStatus loadCompressedConstants(QNNConstantsInterface *constants,
+                                  uint64_t dynamicConstantsOffset);
   QStatus getBufferByName(const std::string &name, QData &qdata);
+  // Digest of what is loaded to the device for Constants (descriptor and
+  // constants) or Network, computed once. Compressed constants are digested
+  // as stored in the QPC, without decompressing them.
+  QStatus getContentDigest(containerElements elem, QContentDigest &digest,
+                           uint64_t &size);
 
   QProgramContainer(const QProgramContainer &) =
       delete; // Disable Copy Constructor
@@ -134,7 +175,10 @@ private:
     ContainerBuffer() : valid(false) { qutil::initQBuffer(qb); }
   };
   QStatus init();
+  bool getSegment(const char *name, uint8_t **buf, size_t *size);
   std::unordered_map<QID, shQDeviceImageCommon> commonImageLoadedMap_;
+  // Constants loaded by all containers of the process, by content
+  static QContentCache<QDeviceImageCommon> constantsCache_;
   shQpcInfo qpcInfo_;
   std::vector<QAicQpcProgramInfo> programInfoList_;
   std::vector<QAicQpcConstantsInfo> constantsInfoList_;
@@ -155,6 +199,16 @@ private:
   QAicQpcHandle *qpcHandle_;
   aicnwdesc::networkDescriptor networkDesc_;
   std::mutex commonImageLoadedMapMutex_;
+  bool compressedConstants_ = false;
+  size_t constantsSize_ = 0;
+  size_t staticConstantsSize_ = 0;
+  // Decompressed segments of a compressed QPC, by segment name
+  std::unordered_map<std::string, std::vector<uint8_t>> segmentStore_;
+  std::mutex segmentStoreMutex_;
+  // Content digest and size by container element
+  std::unordered_map<int, std::pair<QContentDigest, uint64_t>>
+      contentDigests_;
+  std::mutex contentDigestMutex_;
   static constexpr const char constantsDescSegmentName_[] = "constantsdesc.bin";
   static constexpr const char constantsSegmentName_[] = "constants.bin";
   static constexpr const char networkDescSegmentName_[] = "networkdesc.bin";
@@ -4,6 +4,7 @@
 #ifndef QPROGRAM_DEVICE_H
 #define QPROGRAM_DEVICE_H
 
+#include <atomic>
 #include <queue>
 
 #include "QAicRuntimeTypes.h"
@@ -17,6 +18,7 @@
 #include "AICNetworkDesc.pb.h"
 #include "QComponent.h"
 #include "QNeuralNetworkInterface.h"
+#include "QVCQueueSizing.h"
 #include "QProgramInfo.h"
 #include "QMonitorDeviceObserver.h"
 #include "QProgramContainer.h"
@@ -55,9 +57,12 @@ public:
   // State Info Functions
   bool isActive();      // Program has an Activation ID, either standby or ready
   bool isReady();       // Program has an Activation ID, and is fully activated
+  bool isStandby();     // Program has an Activation ID, and is in standby
   bool isDeviceReady(); // Device is ready for operation, not in error
   bool isInError();
   bool isLoaded();
+  // A load of another process the activation uses is gone with it
+  bool isSharedImageLost() const { return sharedImageLost_; }
 
   QStatus getInferenceCompletedCount(uint64_t &count);
   QStatus getDeviceQueueLevel(uint32_t &fillLevel, uint32_t &queueSize);
@@ -82,6 +87,7 @@ private:
     UNLOAD_SIG,              // From external API event UNLOAD
     ACTIVATE_SIG,            // From external API event ACTIVATE
     DEACTIVATE_SIG,          // From external API event DEACTIVATE
+    STANDBY_SIG,             // From external API event ACTIVATE_STANDBY
     LOAD_COMPLETE_SIG,       // From return status of load operation
     LOAD_FAILED_SIG,         // From return status of load operation
     UNLOAD_COMPLETE_SIG,     // From return status of unload operation
@@ -126,9 +132,11 @@ private:
   bool load_action();
   bool unload_action();
   bool activate_action();
+  bool ready_action();
   bool deactivate_action();
   void handleLoadError();
   void handleActivateError();
+  void sharedImageLost();
   void run();
   void setHsmSignal(Signals sig);
   void setHsmSignalWithLock(const Signals sig);
@@ -153,6 +161,7 @@ private:
 
   // Active Super
   Q_STATE_DECL(active_super);
+  Q_STATE_DECL(ac_standby);
   Q_STATE_DECL(ac_ready);
   Q_STATE_DECL(ac_deactivating);
 
@@ -168,6 +177,12 @@ private:
   QNNImageInterface *nnImage_;         // Loaded Image
   QNNConstantsInterface *nnConstants_; // Loaded Constants
   QNeuralNetworkInterface *qnn_;       // Activated Network
+  QVCQueueSizing vcQueueSizing_;       // VC queue size of activations
+  // In flight target vcQueueSizing_ started from
+  uint32_t vcQueueInFlightAsked_ =
+      QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT;
+  // State the next activation starts in, standby or ready
+  QActivationStateType activationState_;
   QRuntimeInterface *rt_;
   std::mutex programMutex_;
   std::queue<Signals> signals_;
@@ -178,6 +193,9 @@ private:
   std::vector<shQExecObj> execObjs_;
   std::mutex execObjsLock_;
   bool autoLoadActivate_;
+  // Set from the watch thread of the shared image registry, cleared by the
+  // next activation
+  std::atomic<bool> sharedImageLost_{false};
   NotifyDeviceStateInfoFuncCb deviceStateInfoFuncCb_ =
       [this](std::shared_ptr<QDeviceStateInfo> event) -> void {
     notifyDeviceStateInfo(event);
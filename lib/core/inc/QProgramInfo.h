@@ -13,7 +13,8 @@ enum ProgramState {
   STATE_PROGRAM_LOAD_ERROR,
   STATE_PROGRAM_ACTIVATE_ERROR,
   STATE_PROGRAM_DEVICE_ERROR,
-  STATE_PROGRAM_TRANSITION
+  STATE_PROGRAM_TRANSITION,
+  STATE_PROGRAM_STANDBY
 };
 
 struct QProgramInfo {
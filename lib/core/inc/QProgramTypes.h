@@ -10,7 +10,8 @@ class QProgram;
 enum QProgramActivationCmd {
   QProgram_CMD_ACTIVATE_FULL = 0,   /// Command to fully activate
   QProgram_CMD_DEACTIVATE_FULL = 1, /// Command to fully deactivate
-  QIPROGRRAM_CMD_INVALID = 2
+  QProgram_CMD_ACTIVATE_STANDBY = 2, /// Command to activate in standby
+  QIPROGRRAM_CMD_INVALID = 3
 };
 
 } // namespace qaic
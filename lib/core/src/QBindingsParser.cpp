@@ -281,15 +281,30 @@ bool QBindingsParser::validate() {
   return true;
 }
 
-bool QBindingsParser::init(const aicnwdesc::networkDescriptor &networkDesc) {
+bool QBindingsParser::init(const aicnwdesc::networkDescriptor &networkDesc,
+                           const std::vector<uint8_t> *ioDescPb) {
   ioDescBuffer_.clear();
   bool rc = validate();
   rc &= generateIoDesc(networkDesc);
-  rc &= generateIoDescPb(networkDesc);
+  if (ioDescPb != nullptr) {
+    rc &= restoreIoDescPb(*ioDescPb);
+  } else {
+    rc &= generateIoDescPb(networkDesc);
+  }
   rc &= updateIoBufferInfoDma(networkDesc);
   return rc;
 }
 
+bool QBindingsParser::restoreIoDescPb(const std::vector<uint8_t> &ioDescPb) {
+  ioDescObject_ = std::make_unique<aicapi::IoDesc>();
+  if (!ioDescObject_->ParseFromArray(ioDescPb.data(), ioDescPb.size())) {
+    LogError("Failed to parse cached IO descriptor");
+    ioDescObject_.reset();
+    return false;
+  }
+  return true;
+}
+
 void QBindingsParser::createBinding(
     const aicnwdesc::IODescriptor &nwIoDescriptor, aicapi::IoBinding *ioBinding,
     uint32_t index, aicnwdesc::direction bufferIoDirection,
@@ -551,6 +566,7 @@ bool QBindingsParser::generateIoDescPb(
 bool QBindingsParser::updateIoBufferInfoDma(
     const aicnwdesc::networkDescriptor &networkDesc) {
 
+  bufferMappingsVectorDma_.clear();
   for (int32_t idx = 0; idx < networkDesc.dma_buffers_size(); idx++) {
     QAicBufferIoTypeEnum ioType =
         (networkDesc.dma_buffers(idx).dir() == aicnwdesc::In)
@@ -283,9 +283,11 @@ QContext::registerNotifyDeviceStateInfo(NotifyDeviceStateInfoPriority prio,
 QStatus QContext::unRegisterNotifyDeviceStateInfo(void *clientObj) {
   std::unique_lock<std::mutex> lk(notifyDeviceStateInfoPriorityDbMutex_);
   auto it = notifyDeviceStateInfoPriorityDb_.begin();
-  for (; it != notifyDeviceStateInfoPriorityDb_.end(); ++it) {
+  while (it != notifyDeviceStateInfoPriorityDb_.end()) {
     if (it->second.first == clientObj) {
       it = notifyDeviceStateInfoPriorityDb_.erase(it);
+    } else {
+      ++it;
     }
   }
   return QS_SUCCESS;
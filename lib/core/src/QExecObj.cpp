@@ -1,6 +1,8 @@
 // Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: BSD-3-Clause-Clear
 
+#include <cerrno>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <limits>
@@ -12,6 +14,8 @@
 #include "QContext.h"
 #include "QLogger.h"
 #include "QUtil.h"
+#include "QOsal.h"
+#include "QNumaTopology.h"
 #include <google/protobuf/util/json_util.h>
 
 namespace qaic {
@@ -20,6 +24,11 @@ static std::atomic<QAicObjId> NextUniqueObjId{0};
 
 // Inference retry count during Sub System Restart
 constexpr uint16_t inferenceRetryCount = 5;
+// Spin budget of an ExecObj created with QAIC_EXECOBJ_PROPERTIES_BUSY_POLL
+constexpr uint32_t defaultBusyPollBudgetUs = 100;
+// Longer spins only hold the core a blocking wait would give back
+constexpr uint32_t maxBusyPollBudgetUs = 1000000;
+static const std::string QAicBusyPollBudgetEnv = "QAIC_BUSY_POLL_BUDGET_US";
 
 //==================================================================================
 // QExecObj Static Api
@@ -74,6 +83,7 @@ shQExecObj QExecObj::createExecObj(shQContext context,
 }
 
 QStatus QExecObj::releaseExecObj() {
+  (void)runState_.reapLate(lateInferenceWaiter());
   context_->unRegisterExecObj(this);
   programDevice_->unregisterExecObj(this);
   return QS_SUCCESS;
@@ -99,11 +109,36 @@ QExecObj::QExecObj(shQContext &context, const QAicExecObjProperties *properties,
       properties_(defaultExecObjProperties_), dev_(qid), program_(program),
       ioDescPbData_{0, nullptr}, numBuffers_(numBuffers),
       metadata_(program->getMetadata()), rt_(context_->rt()), qnn_(nullptr),
-      netdesc_(program->getNetworkDesc()), programDevice_(nullptr),
-      initialized_(false), hasPartialTensor_(checkPartialTensor(netdesc_)) {
+      netdesc_(program->getNetworkDesc()),
+      dmabufCache_(dmabufBindingCacheSize), programDevice_(nullptr),
+      initialized_(false), busyPollBudgetUs_(0),
+      hasPartialTensor_(checkPartialTensor(netdesc_)) {
   if (properties != nullptr) {
     properties_ = *properties;
   }
+  numaPlacement_ = QNumaPlacementManager::getNumaPlacement();
+  if ((numaPlacement_ != nullptr) &&
+      (numaPlacement_->getPolicy() == QNumaPolicy::None)) {
+    numaPlacement_.reset();
+  }
+  if ((properties_ & static_cast<uint32_t>(
+                         QAicExecObjPropertiesBitField::
+                             QAIC_EXECOBJ_PROPERTIES_BUSY_POLL)) != 0) {
+    busyPollBudgetUs_ = defaultBusyPollBudgetUs;
+    if (const char *env = std::getenv(QAicBusyPollBudgetEnv.c_str())) {
+      char *end = nullptr;
+      errno = 0;
+      unsigned long value = strtoul(env, &end, 10);
+      if ((end == env) || (*end != '\0') || (errno != 0) ||
+          (env[0] == '-') || (value > maxBusyPollBudgetUs)) {
+        LogWarn("Ignoring invalid {} value {}, expected 0 to {}, using {}",
+                QAicBusyPollBudgetEnv, env, maxBusyPollBudgetUs,
+                busyPollBudgetUs_);
+      } else {
+        busyPollBudgetUs_ = static_cast<uint32_t>(value);
+      }
+    }
+  }
   LogDebugApi("Created ExecObj ID:{}", Id_);
 }
 
@@ -114,6 +149,9 @@ QExecObj::~QExecObj() {
        0) &&
       (!program_->isManuallyActivated())) {
     infHandle_.reset();
+    activeBinding_.reset();
+    defaultBinding_.reset();
+    dmabufCache_.clear();
     program_->putActivationHandle(dev_);
   }
 }
@@ -133,6 +171,19 @@ QStatus QExecObj::prepareToSubmit() {
   }
 }
 
+// A program activated in standby holds its resources but does not run, the
+// first run moves it to ready before submitting to it
+QStatus QExecObj::readyFromStandby() {
+  if (!programDevice_->isStandby()) {
+    return QS_SUCCESS;
+  }
+  if (prepareToSubmit() != QS_SUCCESS) {
+    LogErrorApi("ExecObj ID:{} failed to ready program from standby", Id_);
+    return QS_ERROR;
+  }
+  return QS_SUCCESS;
+}
+
 bool QExecObj::isReady() {
   if (!programDevice_) {
     return false;
@@ -171,20 +222,180 @@ QStatus QExecObj::setData(const uint32_t numBuffers, const QBuffer *buffers) {
     }
   }
 
+  status = bindDmabufs(numBuffers, buffers);
+  if (status != QS_SUCCESS) {
+    return status;
+  }
+
   for (uint32_t i = 0; i < numBuffers; i++) {
     bufferBindings_.userBindings[i].ptr = (char *)buffers[i].buf;
     bufferBindings_.userBindings[i].size = buffers[i].size;
+    if (buffers[i].type == QBufferType::QBUFFER_TYPE_DMABUF) {
+      // Alias the DMA binding so that the copy transform is skipped
+      bufferBindings_.userBindings[i].ptr =
+          bufferBindings_.dmaBindings[directDmaIndex_[i]].ptr;
+    }
+  }
+
+  return QS_SUCCESS;
+}
+
+//
+// Caller owned dma-bufs replace the DMA buffer they are bound to, the device
+// reads and writes them in place. Each distinct set of dma-bufs is imported
+// once and kept in dmabufCache_, so steady state setData with buffers from a
+// producer's pool does not touch the kernel.
+//
+QStatus QExecObj::bindDmabufs(const uint32_t numBuffers,
+                              const QBuffer *buffers) {
+  QDmabufKeyVec keys;
+  for (uint32_t i = 0; i < numBuffers; i++) {
+    if (buffers[i].type != QBufferType::QBUFFER_TYPE_DMABUF) {
+      continue;
+    }
+    if ((i >= directDmaIndex_.size()) || (directDmaIndex_[i] < 0)) {
+      LogErrorApi("Buffer at index {} cannot be a dma-buf, it requires a "
+                  "transform or shares its DMA buffer",
+                  i);
+      return QS_INVAL;
+    }
+    const uint32_t dmaIndex = directDmaIndex_[i];
+    if (buffers[i].size != dmaQBuffersVec_[dmaIndex].size) {
+      LogErrorApi("Unexpected dma-buf size at index {}, size {}, expected {}",
+                  i, buffers[i].size, dmaQBuffersVec_[dmaIndex].size);
+      return QS_INVAL;
+    }
+    QDmabufKey key;
+    if (QOsal::getDmabufKey(buffers[i], key) != QS_SUCCESS) {
+      LogErrorApi("Invalid dma-buf handle {} at index {}", buffers[i].handle,
+                  i);
+      return QS_BADFD;
+    }
+    // An import is one BO, slices of it cannot be attached twice
+    for (const auto &other : keys) {
+      if ((other.dev == key.dev) && (other.ino == key.ino)) {
+        LogErrorApi("dma-buf at index {} is already bound to another buffer",
+                    i);
+        return QS_INVAL;
+      }
+    }
+    keys.emplace_back(key);
+  }
+
+  if (keys.empty()) {
+    if (activeBinding_ != defaultBinding_) {
+      useInfBinding(defaultBinding_);
+    }
+    return QS_SUCCESS;
+  }
+
+  std::shared_ptr<InfBinding> binding = dmabufCache_.find(keys);
+  if (binding == nullptr) {
+    std::vector<QBuffer> dmaQBuffers = dmaQBuffersVec_;
+    for (uint32_t i = 0; i < numBuffers; i++) {
+      if (buffers[i].type == QBufferType::QBUFFER_TYPE_DMABUF) {
+        dmaQBuffers[directDmaIndex_[i]] = buffers[i];
+      }
+    }
+    const QDirection *bufferDirs = nullptr;
+    uint32_t bufferDirSize = 0;
+    program_->getUserBufferDirections(bufferDirs, bufferDirSize);
+
+    binding = std::make_shared<InfBinding>();
+    binding->infHandle =
+        qnn_->getInfHandle(dmaQBuffers.data(), dmaQBuffers.size(), bufferDirs,
+                           program_->hasPartialTensor());
+    if ((binding->infHandle == nullptr) ||
+        (qnn_->getInfBuffers(binding->infHandle.get(), binding->dmaBuffers) !=
+         QS_SUCCESS)) {
+      LogErrorApi("Failed to register dma-bufs with the device");
+      return QS_ERROR;
+    }
+    LogDebugApi("Registered {} dma-bufs", keys.size());
+    dmabufCache_.insert(keys, binding);
   }
 
+  if (binding != activeBinding_) {
+    useInfBinding(binding);
+  }
   return QS_SUCCESS;
 }
 
+void QExecObj::useInfBinding(const std::shared_ptr<InfBinding> &binding) {
+  activeBinding_ = binding;
+  infHandle_ = binding->infHandle;
+  dmaBuffers_ = binding->dmaBuffers;
+  bufferBindings_.dmaBindings.clear();
+  for (auto &buf : dmaBuffers_) {
+    aicppp::BufferBinding dmaBinding = {(char *)buf.buf, buf.size};
+    bufferBindings_.dmaBindings.emplace_back(dmaBinding);
+  }
+}
+
+//
+// A user buffer can be replaced by a dma-buf when its only transform is a
+// full copy to a DMA buffer that no other input or output uses
+//
+void QExecObj::initDirectDmaIndex() {
+  directDmaIndex_.assign(numBuffers_, -1);
+  std::vector<uint32_t> dmaUsers(dmaQBuffersVec_.size(), 0);
+  std::vector<int32_t> candidates(numBuffers_, -1);
+
+  auto checkIo = [&](const aicnwdesc::IOBinding &io, uint32_t userIndex) {
+    if (io.transformseq_size() == 0) {
+      return;
+    }
+    for (const auto &t : io.transformseq()) {
+      if (t.kind() == aicnwdesc::CopyDMABufferTransform) {
+        uint32_t dmaIndex = t.copy_dma_buffer().buffer_num();
+        if (dmaIndex < dmaUsers.size()) {
+          dmaUsers[dmaIndex]++;
+        }
+      }
+    }
+    const auto &copyDMA = io.transformseq(0);
+    if ((io.transformseq_size() != 1) || io.is_partial_allowed() ||
+        (copyDMA.kind() != aicnwdesc::CopyDMABufferTransform) ||
+        (copyDMA.copy_dma_buffer().offset() != 0) ||
+        (copyDMA.copy_dma_buffer().buffer_num() >= dmaQBuffersVec_.size())) {
+      return;
+    }
+    candidates[userIndex] = copyDMA.copy_dma_buffer().buffer_num();
+  };
+
+  uint32_t userIndex = 0;
+  for (const auto &input : netdesc_->inputs()) {
+    checkIo(input, userIndex++);
+  }
+  for (const auto &output : netdesc_->outputs()) {
+    checkIo(output, userIndex++);
+  }
+
+  QAicIoBufferInfo *bufInfo = nullptr;
+  if ((program_->getIoBufferInfo(&bufInfo) != QS_SUCCESS) ||
+      (bufInfo == nullptr)) {
+    return;
+  }
+  for (uint32_t i = 0; (i < numBuffers_) && (i < bufInfo->numBufferMappings);
+       i++) {
+    int32_t dmaIndex = candidates[i];
+    if ((dmaIndex >= 0) && (dmaUsers[dmaIndex] == 1) &&
+        (bufInfo->bufferMappings[i].size == dmaQBuffersVec_[dmaIndex].size)) {
+      directDmaIndex_[i] = dmaIndex;
+    }
+  }
+}
+
 // Submit to Hardware
 QStatus QExecObj::submit() {
   QStatus status = QS_SUCCESS;
   if ((infHandle_ == nullptr) || (programDevice_ == nullptr)) {
     return QS_ERROR;
   }
+  // Retryable, the program is back once activated again
+  if (programDevice_->isSharedImageLost()) {
+    return QS_DEVICE_RECOVERING;
+  }
   if (!programDevice_->isDeviceReady()) {
     return QS_DEV_ERROR;
   }
@@ -199,12 +410,18 @@ QStatus QExecObj::submit() {
   std::uint16_t retryCount = inferenceRetryCount;
   while (retryCount--) {
     status = qnn->enqueueData(infHandle_.get());
+    if ((status != QS_SUCCESS) && runState_.isDeadlinePassed()) {
+      // No point in waiting for the device to take it
+      status = QS_DEADLINE_EXCEEDED;
+      break;
+    }
     if (status != QS_SUCCESS) {
       /* Wait for device to recover */
       std::this_thread::sleep_for(std::chrono::seconds(1));
       LogWarnApi("Enqueue data retryCount {}",
                  (inferenceRetryCount - retryCount));
-      if (programDevice_->isDeviceReady()) {
+      if (programDevice_->isDeviceReady() &&
+          !programDevice_->isSharedImageLost()) {
         continue;
       }
     }
@@ -212,6 +429,9 @@ QStatus QExecObj::submit() {
   }
 
   if (status != QS_SUCCESS) {
+    if (programDevice_->isSharedImageLost()) {
+      return QS_DEVICE_RECOVERING;
+    }
     LogErrorApi("Failed to enqueue data");
     return status;
   }
@@ -225,6 +445,10 @@ QStatus QExecObj::finish() {
   if ((infHandle_ == nullptr) || (programDevice_ == nullptr)) {
     return QS_ERROR;
   }
+  // Retryable, the program is back once activated again
+  if (programDevice_->isSharedImageLost()) {
+    return QS_DEVICE_RECOVERING;
+  }
   if (!programDevice_->isDeviceReady()) {
     return QS_DEV_ERROR;
   }
@@ -235,8 +459,27 @@ QStatus QExecObj::finish() {
     return QS_ERROR;
   }
 
-  status = qnn->wait(infHandle_.get());
+  if (runState_.hasDeadline()) {
+    const auto deadline = runState_.getDeadline();
+    status = (busyPollBudgetUs_ != 0)
+                 ? qnn->waitBusyPollUntil(infHandle_.get(), busyPollBudgetUs_,
+                                          deadline)
+                 : qnn->waitUntil(infHandle_.get(), deadline);
+    if (status == QS_DEADLINE_EXCEEDED) {
+      // Still on the device, the next run reaps it
+      runState_.setLate(infHandle_);
+      return status;
+    }
+  } else if (busyPollBudgetUs_ != 0) {
+    status = qnn->waitBusyPoll(infHandle_.get(), busyPollBudgetUs_);
+  } else {
+    status = qnn->wait(infHandle_.get());
+  }
   if (status != QS_SUCCESS) {
+    // In flight when the images went with their loader
+    if (programDevice_->isSharedImageLost()) {
+      return QS_DEVICE_RECOVERING;
+    }
     LogErrorApi("wait in kernel failed");
     return status;
   }
@@ -250,7 +493,9 @@ QStatus
 QExecObj::validateExecObjProperties(const QAicExecObjProperties *properties) {
   uint32_t invalidProperties =
       ~(static_cast<uint32_t>(QAicExecObjPropertiesBitField::
-                                  QAIC_EXECOBJ_PROPERTIES_AUTO_LOAD_ACTIVATE));
+                                  QAIC_EXECOBJ_PROPERTIES_AUTO_LOAD_ACTIVATE) |
+        static_cast<uint32_t>(QAicExecObjPropertiesBitField::
+                                  QAIC_EXECOBJ_PROPERTIES_BUSY_POLL));
   if ((properties != nullptr) && ((*properties & invalidProperties) != 0)) {
     return QS_INVAL;
   }
@@ -279,12 +524,28 @@ QStatus QExecObj::postTransform() {
 
 QStatus QExecObj::run() {
   QStatus status = QS_SUCCESS;
+  bindCallingThread();
   // Run requires that the program be activated
   if ((programDevice_ == nullptr) || (!programDevice_->isActive())) {
     LogErrorApi("{}: Invalid program state, not activated", __FUNCTION__);
     return QS_INVAL;
   }
-  status = ppHandle_->validateTransformKind();
+  status = readyFromStandby();
+  if (status != QS_SUCCESS) {
+    return status;
+  }
+  status = beginRun();
+  if (status != QS_SUCCESS) {
+    return status;
+  }
+  status = runPending();
+  runState_.end();
+  return status;
+}
+
+// Body of run() once the run is pending
+QStatus QExecObj::runPending() {
+  QStatus status = ppHandle_->validateTransformKind();
   if (status != QS_SUCCESS) {
     LogError("Transform Sequence validation failed");
     return status;
@@ -296,6 +557,10 @@ QStatus QExecObj::run() {
     return status;
   }
 
+  status = claimSubmit();
+  if (status != QS_SUCCESS) {
+    return status;
+  }
   status = submit();
   if (status != QS_SUCCESS) {
     LogErrorApi("Failed to run program at submit stage");
@@ -303,18 +568,133 @@ QStatus QExecObj::run() {
   }
 
   status = finish();
-  if (status != QS_SUCCESS) {
+  if (status == QS_DEADLINE_EXCEEDED) {
+    LogDebugApi("Deadline passed waiting for inference");
+  } else if (status != QS_SUCCESS) {
     LogErrorApi("Failed to run program at finish stage");
+  }
+  return status;
+}
+
+QStatus QExecObj::runAsync(QWaitCallback done) {
+  QStatus status = QS_SUCCESS;
+  if (!done) {
+    return QS_INVAL;
+  }
+  bindCallingThread();
+  if ((programDevice_ == nullptr) || (!programDevice_->isActive())) {
+    LogErrorApi("{}: Invalid program state, not activated", __FUNCTION__);
+    return QS_INVAL;
+  }
+  status = readyFromStandby();
+  if (status != QS_SUCCESS) {
+    return status;
+  }
+  status = beginRun();
+  if (status != QS_SUCCESS) {
+    return status;
+  }
+  status = runAsyncPending(std::move(done));
+  if (status != QS_SUCCESS) {
+    runState_.end();
+  }
+  return status;
+}
+
+// Body of runAsync() once the run is pending
+QStatus QExecObj::runAsyncPending(QWaitCallback done) {
+  QStatus status = ppHandle_->validateTransformKind();
+  if (status != QS_SUCCESS) {
+    LogError("Transform Sequence validation failed");
     return status;
   }
 
+  status = preTransform();
+  if (status != QS_SUCCESS) {
+    LogError("Failed to perform perTransformation");
+    return status;
+  }
+
+  status = claimSubmit();
+  if (status != QS_SUCCESS) {
+    return status;
+  }
+  status = submit();
+  if (status != QS_SUCCESS) {
+    LogErrorApi("Failed to run program at submit stage");
+    return status;
+  }
+
+  QNeuralNetworkInterface *qnn = program_->nn();
+  if (qnn == nullptr) {
+    LogErrorApi("Unexpected null pointer qnn");
+    return QS_ERROR;
+  }
+  status = qnn->waitAsync(infHandle_.get(),
+                          [this, done = std::move(done)](QStatus waitStatus) {
+                            if (waitStatus == QS_SUCCESS) {
+                              waitStatus = postTransform();
+                            } else {
+                              LogErrorApi("wait in kernel failed");
+                            }
+                            runState_.end();
+                            done(waitStatus);
+                          });
+  if (status != QS_SUCCESS) {
+    LogErrorApi("Failed to queue wait for inference");
+  }
   return status;
 }
 
+void QExecObj::setDeadline(std::chrono::steady_clock::time_point deadline) {
+  runState_.setDeadline(deadline);
+}
+
+QStatus QExecObj::cancel() { return runState_.cancel(); }
+
+// Moves an idle ExecObj to pending, late requests are dropped before any
+// pre-processing. The inference a previous run left on the device at its
+// deadline is waited for first, no longer than this run has.
+QStatus QExecObj::beginRun() {
+  QStatus status = runState_.begin(lateInferenceWaiter());
+  if (status == QS_BUSY) {
+    LogErrorApi("ExecObj ID:{} is already running", Id_);
+  }
+  return status;
+}
+
+// Last point a pending run can be dropped, past it the inference is on the
+// device and cannot be withdrawn
+QStatus QExecObj::claimSubmit() { return runState_.claimSubmit(); }
+
+std::function<QStatus(QInfHandle &, std::chrono::steady_clock::time_point)>
+QExecObj::lateInferenceWaiter() {
+  return [this](QInfHandle &infHandle,
+                std::chrono::steady_clock::time_point deadline) {
+    QNeuralNetworkInterface *qnn = program_->nn();
+    if (qnn == nullptr) {
+      return QS_ERROR;
+    }
+    QStatus status = qnn->waitUntil(&infHandle, deadline);
+    if ((status != QS_SUCCESS) && (status != QS_DEADLINE_EXCEEDED)) {
+      LogWarnApi("Wait for late inference failed: {}", status);
+    }
+    return status;
+  };
+}
+
 //----------------------------------------------------------------------
 // Private Methods
 //----------------------------------------------------------------------
 
+// With NUMA placement enabled a thread running inferences is pinned next to
+// the device of the ExecObj it runs, next to its buffers
+void QExecObj::bindCallingThread() {
+  if (numaPlacement_ != nullptr) {
+    (void)numaPlacement_->bindCallerToDevice(dev_);
+  }
+}
+
 bool QExecObj::initPrePostTransforms() {
   // This function will initialize ppHandle_ or return false
   // netdesc_ is the default network descriptor created by the program
@@ -322,9 +702,16 @@ bool QExecObj::initPrePostTransforms() {
   if (ppHandle_ == nullptr) {
     LogErrorApi("Error in creating PrePost Handle");
     return false;
-  } else {
-    return true;
   }
+  // Temporaries are allocated on the first inference, on whatever node the
+  // heap hands out, place them next to the device
+  if (numaPlacement_ != nullptr) {
+    ppHandle_->setTempBlockHook(
+        [placement = numaPlacement_, qid = dev_](void *block, size_t size) {
+          (void)placement->bindMemoryToDevice(block, size, qid);
+        });
+  }
+  return true;
 }
 
 QStatus QExecObj::init() {
@@ -416,28 +803,26 @@ QStatus QExecObj::init() {
     return QS_ERROR;
   }
 
-  infHandle_ =
+  defaultBinding_ = std::make_shared<InfBinding>();
+  defaultBinding_->infHandle =
       qnn_->getInfHandle(dmaQBuffersVec_.data(), dmaQBuffersVec_.size(),
                          bufferDirs, program_->hasPartialTensor());
 
-  if (infHandle_ == nullptr) {
+  if (defaultBinding_->infHandle == nullptr) {
     LogErrorApiReport(QAicErrorType::QIAC_ERROR_EXECOBJ_RUNTIME, nullptr, 0,
                       " Error creating exec obj, failed to get infHandle");
     return QS_ERROR;
   }
 
-  if (qnn_->getInfBuffers(infHandle_.get(), dmaBuffers_) != QS_SUCCESS) {
+  if (qnn_->getInfBuffers(defaultBinding_->infHandle.get(),
+                          defaultBinding_->dmaBuffers) != QS_SUCCESS) {
     return QS_ERROR;
   }
 
-  // DMA Buffer bindings won't change, we keep the same DMA buffer for the
-  // life of this object
-  for (auto &buf : dmaBuffers_) {
-    aicppp::BufferBinding binding = {(char *)buf.buf, buf.size};
-    binding.ptr = (char *)buf.buf;
-    binding.size = buf.size;
-    bufferBindings_.dmaBindings.emplace_back(binding);
-  }
+  // DMA Buffer bindings only change when caller dma-bufs are bound in place
+  // of them, see bindDmabufs
+  useInfBinding(defaultBinding_);
+  initDirectDmaIndex();
 
   initialized_ = true;
   return QS_SUCCESS;
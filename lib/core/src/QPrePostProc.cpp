@@ -57,6 +57,11 @@ QStatus QPrePostProc::processOutputBuffers(
   return QS_SUCCESS;
 }
 
+void QPrePostProc::setTempBlockHook(
+    aicppp::PrePostProcessor::TempBlockHook hook) {
+  ppp_->setTempBlockHook(std::move(hook));
+}
+
 QStatus QPrePostProc::validateTransformKind() {
   QStatus status = QS_INVAL;
 
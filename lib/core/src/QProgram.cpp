@@ -5,6 +5,7 @@
 #include "QAicRuntimeTypes.h"
 #include "QContext.h"
 #include "QProgram.h"
+#include "QProgramCache.h"
 #include "QBindingsParser.h"
 #include "QLogger.h"
 #include "elfio/elfio.hpp"
@@ -18,6 +19,11 @@ static std::atomic<QAicObjId> NextUniqueObjId{ObjIdBase};
 static std::mutex ObjIdLock;
 
 constexpr QAicProgramProperties QProgram::defaultProperties_;
+constexpr QAicProgramSchedProperties QProgram::defaultSchedProperties_;
+
+// Applications built against earlier releases pass the same layout
+static_assert(sizeof(QAicProgramProperties) == 24,
+              "QAicProgramProperties layout is part of the ABI");
 
 QAicObjId getNextObjId() {
   std::lock_guard<std::mutex> guard(ObjIdLock);
@@ -35,6 +41,45 @@ QStatus QProgram::initProperties(QAicProgramProperties *properties) {
   return QS_SUCCESS;
 }
 
+QStatus
+QProgram::initSchedProperties(QAicProgramSchedProperties *properties) {
+  if (properties == nullptr) {
+    return QS_INVAL;
+  }
+  *properties = defaultSchedProperties_;
+  return QS_SUCCESS;
+}
+
+QStatus
+QProgram::setSchedProperties(const QAicProgramSchedProperties &properties) {
+  // Fields appended after this release are not known here and left out
+  if (properties.StructSize < sizeof(QAicProgramSchedProperties)) {
+    LogErrorApi("Unsupported sched properties size {}",
+                properties.StructSize);
+    return QS_INVAL;
+  }
+  if (properties.Priority >
+      static_cast<uint32_t>(QAicSchedPriority::QAIC_SCHED_PRIORITY_LOW)) {
+    LogErrorApi("Invalid sched priority {}", properties.Priority);
+    return QS_INVAL;
+  }
+  if (properties.NumInferencesInFlight >
+      QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_MAX) {
+    LogErrorApi("Invalid inferences in flight {}",
+                properties.NumInferencesInFlight);
+    return QS_INVAL;
+  }
+  std::lock_guard<std::mutex> lock(schedPropertiesMutex_);
+  schedProperties_ = properties;
+  schedProperties_.StructSize = sizeof(QAicProgramSchedProperties);
+  return QS_SUCCESS;
+}
+
+QAicProgramSchedProperties QProgram::getSchedProperties() const {
+  std::lock_guard<std::mutex> lock(schedPropertiesMutex_);
+  return schedProperties_;
+}
+
 shQProgram QProgram::createProgram(shQContext context,
                                    const QAicProgramProperties &properties,
                                    QID dev, const char *name,
@@ -146,6 +191,18 @@ QStatus QProgram::unload() {
   return progDev->unload();
 }
 
+void QProgram::setSharedImageLostCallback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(sharedImageLostMutex_);
+  sharedImageLostCallback_ = std::move(callback);
+}
+
+void QProgram::notifySharedImageLost() {
+  std::lock_guard<std::mutex> lock(sharedImageLostMutex_);
+  if (sharedImageLostCallback_) {
+    sharedImageLostCallback_();
+  }
+}
+
 bool QProgram::isActive() {
   std::unique_lock<std::mutex> lock(programMutex_);
   QProgramDevice *progDev = getProgramDevice();
@@ -166,6 +223,10 @@ QStatus QProgram::processActivateCmd(QAicProgramActivationCmd cmd) {
   case QAicProgramActivationCmd::QAIC_PROGRAM_CMD_DEACTIVATE_FULL:
     icmd = QProgram_CMD_DEACTIVATE_FULL;
     break;
+  case QAicProgramActivationCmd::QAIC_PROGRAM_CMD_ACTIVATE_STANDBY:
+    icmd = QProgram_CMD_ACTIVATE_STANDBY;
+    isManuallyActivated_ = true;
+    break;
   default:
     icmd = QIPROGRRAM_CMD_INVALID;
     break;
@@ -410,6 +471,58 @@ bool QProgram::init() {
     return false;
   }
 
+  // A warm start takes the parsed state from the program cache instead of
+  // the network ELF, falling back to parsing if the entry is not usable
+  shQProgramCache programCache = QProgramCacheManager::getProgramCache();
+  QProgramCacheKey cacheKey;
+  QProgramCacheEntry cacheEntry;
+  bool ret = false;
+  if (programCache) {
+    cacheKey = QProgramCache::makeKey(networkData_, networkDescData_);
+    if (programCache->lookup(cacheKey, cacheEntry) == QS_SUCCESS) {
+      metadataBuffer_ = cacheEntry.metadata;
+      metadataBufferInit_ = metadataBuffer_;
+      metadataBufferRaw_ = metadataBuffer_;
+      ret = updateInternalData(&cacheEntry);
+      if (!ret) {
+        LogWarn("Ignoring cached state of program {}",
+                networkDesc_.network_name());
+      }
+    }
+  }
+
+  if (!ret) {
+    if (!extractMetadata()) {
+      return false;
+    }
+    metadataBufferInit_ = metadataBuffer_;
+    metadataBufferRaw_ = metadataBuffer_;
+    ret = updateInternalData();
+    if (ret && programCache) {
+      cacheEntry.metadata = metadataBufferRaw_;
+      cacheEntry.metadataHeaderSize =
+          metadataBufferRaw_.size() - metadataBuffer_.size();
+      cacheEntry.ioDescPb = ioDescPbBuffer_;
+      (void)programCache->store(cacheKey, cacheEntry);
+    }
+  }
+
+  if (ret) {
+    auto getBaseName = [](std::string wholeName) {
+      return wholeName.substr(wholeName.find_last_of("/\\") + 1);
+    };
+    name_ = userName_ ? getBaseName(userName_)
+                      : std::string("user") + "_" +
+                            getBaseName(networkDesc_.network_name()) + "_" +
+                            std::to_string(Id_);
+  }
+  return ret;
+}
+
+//
+// Copies the metadata section out of the network ELF
+//
+bool QProgram::extractMetadata() {
   std::stringstream is(
       std::string((char *)networkData_.data, networkData_.size));
 
@@ -437,30 +550,34 @@ bool QProgram::init() {
     metadataBuffer_ = std::vector<uint8_t>( metaSec->get_data(), metaSec->get_data() + metaSec->get_size());
   }
 
-  metadataBufferInit_ = metadataBuffer_;
-  metadataBufferRaw_ = metadataBuffer_;
-
-  bool ret = updateInternalData();
-  if (ret) {
-    auto getBaseName = [](std::string wholeName) {
-      return wholeName.substr(wholeName.find_last_of("/\\") + 1);
-    };
-    name_ = userName_ ? getBaseName(userName_)
-                      : std::string("user") + "_" +
-                            getBaseName(networkDesc_.network_name()) + "_" +
-                            std::to_string(Id_);
-  }
-  return ret;
+  return true;
 }
 
 //
 // Following procedure will be reused when network descriptor and metadata are
 // updated
 //
-bool QProgram::updateInternalData() {
+bool QProgram::updateInternalData(const QProgramCacheEntry *cached) {
   QStatus status = QS_ERROR;
   // Skip for MQ program which does not have metadata
-  if (!metadataBuffer_.empty()) {
+  if ((!metadataBuffer_.empty()) && (cached != nullptr)) {
+    // The cache checksum only catches corruption, anyone able to write the
+    // cache directory controls these bytes. Verify them again, it is cheap
+    // next to parsing the network ELF.
+    if (cached->metadataHeaderSize >= metadataBuffer_.size()) {
+      LogError("Invalid cached metadata header size {} of {} bytes",
+               cached->metadataHeaderSize, metadataBuffer_.size());
+      return false;
+    }
+    metadataBuffer_.erase(metadataBuffer_.begin(),
+                          metadataBuffer_.begin() +
+                              cached->metadataHeaderSize);
+    if (!metadata::FlatDecode::flatbufValidate(metadataBuffer_)) {
+      LogError("Cached metadata_flat failed to verify");
+      return false;
+    }
+    metadata_ = AicMetadataFlat::UnPackMetadata(metadataBuffer_.data());
+  } else if (!metadataBuffer_.empty()) {
     std::string metadataErrors;
     metadata_ = metadata::FlatDecode::readMetadataFlatNativeCPP(metadataBuffer_,
                                                                 metadataErrors);
@@ -496,7 +613,8 @@ bool QProgram::updateInternalData() {
             AIC_NETWORK_DESCRIPTION_MINOR_VERSION);
   }
 
-  if (!bindingsParser_.init(networkDesc_)) {
+  if (!bindingsParser_.init(networkDesc_,
+                            cached ? &cached->ioDescPb : nullptr)) {
     LogErrorApi("Failed to initialize bindingsParser");
     return false;
   }
@@ -522,17 +640,22 @@ bool QProgram::updateInternalData() {
     return false;
   }
 
-  try {
-    ioDescPbBuffer_.resize(ioDescPb_->ByteSizeLong());
-  } catch (const std::bad_alloc &ba) {
-    LogErrorApi("Failed to resize vector for Protocol Buffer {}", ba.what());
-    return false;
-  }
+  if (cached != nullptr) {
+    ioDescPbBuffer_ = cached->ioDescPb;
+  } else {
+    try {
+      ioDescPbBuffer_.resize(ioDescPb_->ByteSizeLong());
+    } catch (const std::bad_alloc &ba) {
+      LogErrorApi("Failed to resize vector for Protocol Buffer {}",
+                  ba.what());
+      return false;
+    }
 
-  if (!ioDescPb_->SerializeToArray(ioDescPbBuffer_.data(),
-                                   ioDescPbBuffer_.size())) {
-    LogErrorApi("Failed to serialize Protocol Buffer for IO Descriptor");
-    return false;
+    if (!ioDescPb_->SerializeToArray(ioDescPbBuffer_.data(),
+                                     ioDescPbBuffer_.size())) {
+      LogErrorApi("Failed to serialize Protocol Buffer for IO Descriptor");
+      return false;
+    }
   }
 
   dmaBufferQDirections_.clear();
@@ -0,0 +1,242 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QProgramCache.h"
+#include "QAicQpc.h"
+#include "QOsal.h"
+#include "QUtil.h"
+#include "AICMetadata.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#ifndef AIC_RUNTIME_VERSION
+#define AIC_RUNTIME_VERSION "unknown"
+#endif
+
+namespace qaic {
+
+static const std::string QAicProgramCacheDirEnv = "QAIC_PROGRAM_CACHE_DIR";
+constexpr uint32_t programCacheMagic = 0x43505141; // "AQPC"
+constexpr size_t runtimeVersionSize = 64;
+
+shQProgramCache QProgramCacheManager::programCache_;
+bool QProgramCacheManager::initialized_ = false;
+std::mutex QProgramCacheManager::m_;
+
+namespace {
+// Fixed size header, followed by the metadata and the IO descriptor
+struct QProgramCacheFileHeader {
+  uint32_t magic;
+  uint32_t formatVersion;
+  char runtimeVersion[runtimeVersionSize];
+  QProgramCacheKey key;
+  uint64_t metadataSize;
+  uint64_t ioDescPbSize;
+  uint32_t metadataHeaderSize;
+  uint32_t reserved;
+  // Covers the header, with this field zeroed, and the payload
+  uint64_t checksum;
+};
+static_assert(std::is_trivially_copyable<QProgramCacheFileHeader>::value &&
+                  (sizeof(QProgramCacheFileHeader) == 136),
+              "cache header is written as is, without padding");
+
+uint64_t checksum(QProgramCacheFileHeader header,
+                  const std::vector<uint8_t> &metadata,
+                  const std::vector<uint8_t> &ioDescPb) {
+  header.checksum = 0;
+  uint64_t hash = qutil::hash64(&header, sizeof(header));
+  hash = qutil::hash64(metadata.data(), metadata.size(), hash);
+  return qutil::hash64(ioDescPb.data(), ioDescPb.size(), hash);
+}
+
+bool writeAll(int fd, const void *data, size_t size) {
+  const char *p = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = ::write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+} // namespace
+
+QProgramCache::QProgramCache(std::string dir)
+    : QLogger("QProgramCache"), dir_(std::move(dir)) {}
+
+std::string QProgramCache::getRuntimeVersion() {
+  return fmt::format("{} nd{}.{} md{}.{} f{}", AIC_RUNTIME_VERSION,
+                     AIC_NETWORK_DESCRIPTION_MAJOR_VERSION,
+                     AIC_NETWORK_DESCRIPTION_MINOR_VERSION,
+                     AIC_METADATA_MAJOR_VERSION, AIC_METADATA_MINOR_VERSION,
+                     formatVersion);
+}
+
+QProgramCacheKey QProgramCache::makeKey(const QData &network,
+                                        const QData &networkDesc) {
+  QProgramCacheKey key;
+  key.networkHash = qutil::hash64(network.data, network.size);
+  key.networkSize = network.size;
+  key.networkDescHash = qutil::hash64(networkDesc.data, networkDesc.size);
+  key.networkDescSize = networkDesc.size;
+  return key;
+}
+
+// Entries of different runtime versions may share the directory, e.g.
+// during a rolling upgrade
+std::string QProgramCache::getEntryPath(const QProgramCacheKey &key) const {
+  const std::string version = getRuntimeVersion();
+  return fmt::format("{}/{:016x}{:016x}-{:08x}.qprog", dir_, key.networkHash,
+                     key.networkDescHash,
+                     qutil::hash64(version.data(), version.size()) &
+                         0xffffffff);
+}
+
+QStatus QProgramCache::lookup(const QProgramCacheKey &key,
+                              QProgramCacheEntry &entry) {
+  const std::string path = getEntryPath(key);
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs.is_open()) {
+    LogDebug("No cached program {}", path);
+    numMisses_++;
+    return QS_ERROR;
+  }
+
+  auto reject = [&](const char *reason) {
+    LogWarn("Removing cached program {}: {}", path, reason);
+    ifs.close();
+    std::remove(path.c_str());
+    numMisses_++;
+    return QS_ERROR;
+  };
+
+  QProgramCacheFileHeader header;
+  if (!ifs.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    return reject("truncated header");
+  }
+  const std::string version = getRuntimeVersion();
+  if ((header.magic != programCacheMagic) ||
+      (header.formatVersion != formatVersion) ||
+      (strncmp(header.runtimeVersion, version.c_str(), runtimeVersionSize) !=
+       0)) {
+    return reject("written by another runtime");
+  }
+  if (!(header.key == key)) {
+    return reject("key mismatch");
+  }
+  ifs.seekg(0, std::ios::end);
+  const uint64_t fileSize = static_cast<uint64_t>(ifs.tellg());
+  if ((header.metadataSize > fileSize) || (header.ioDescPbSize > fileSize) ||
+      (fileSize !=
+       sizeof(header) + header.metadataSize + header.ioDescPbSize) ||
+      (header.metadataHeaderSize > header.metadataSize)) {
+    return reject("size mismatch");
+  }
+  ifs.seekg(sizeof(header));
+
+  QProgramCacheEntry cached;
+  cached.metadata.resize(header.metadataSize);
+  cached.ioDescPb.resize(header.ioDescPbSize);
+  cached.metadataHeaderSize = header.metadataHeaderSize;
+  if (!ifs.read(reinterpret_cast<char *>(cached.metadata.data()),
+                cached.metadata.size()) ||
+      !ifs.read(reinterpret_cast<char *>(cached.ioDescPb.data()),
+                cached.ioDescPb.size())) {
+    return reject("truncated payload");
+  }
+  if (checksum(header, cached.metadata, cached.ioDescPb) != header.checksum) {
+    return reject("checksum mismatch");
+  }
+
+  entry = std::move(cached);
+  numHits_++;
+  LogDebug("Using cached program {}", path);
+  return QS_SUCCESS;
+}
+
+QStatus QProgramCache::store(const QProgramCacheKey &key,
+                             const QProgramCacheEntry &entry) {
+  if (entry.metadataHeaderSize > entry.metadata.size()) {
+    return QS_INVAL;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(dir_, ec);
+  if (ec) {
+    LogWarn("Failed to create program cache {}: {}", dir_, ec.message());
+    return QS_ERROR;
+  }
+
+  QProgramCacheFileHeader header{};
+  header.magic = programCacheMagic;
+  header.formatVersion = formatVersion;
+  const std::string version = getRuntimeVersion();
+  strncpy(header.runtimeVersion, version.c_str(), runtimeVersionSize - 1);
+  header.key = key;
+  header.metadataSize = entry.metadata.size();
+  header.ioDescPbSize = entry.ioDescPb.size();
+  header.metadataHeaderSize = entry.metadataHeaderSize;
+  header.checksum = checksum(header, entry.metadata, entry.ioDescPb);
+
+  const std::string path = getEntryPath(key);
+  // A new file of a unique name, 0600: nothing already at the name, e.g. a
+  // link planted by another user of the directory, is written through
+  std::string tmpPath = path + ".XXXXXX";
+  int fd = mkostemp(&tmpPath[0], O_CLOEXEC);
+  if (fd < 0) {
+    LogWarn("Failed to create cached program {}: {}", tmpPath,
+            QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  bool written =
+      writeAll(fd, &header, sizeof(header)) &&
+      writeAll(fd, entry.metadata.data(), entry.metadata.size()) &&
+      writeAll(fd, entry.ioDescPb.data(), entry.ioDescPb.size());
+  if (close(fd) != 0) {
+    written = false;
+  }
+  if (!written) {
+    LogWarn("Failed to write cached program {}", tmpPath);
+    std::remove(tmpPath.c_str());
+    return QS_ERROR;
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    LogWarn("Failed to install cached program {}", path);
+    std::remove(tmpPath.c_str());
+    return QS_ERROR;
+  }
+  LogDebug("Stored cached program {}", path);
+  return QS_SUCCESS;
+}
+
+//======================================================================
+// QProgramCacheManager
+//======================================================================
+shQProgramCache QProgramCacheManager::getProgramCache() {
+  std::unique_lock<std::mutex> lk(m_);
+  if (!initialized_) {
+    initialized_ = true;
+    const char *dir = std::getenv(QAicProgramCacheDirEnv.c_str());
+    if ((dir != nullptr) && (dir[0] != '\0')) {
+      programCache_ = std::make_shared<QProgramCache>(dir);
+    }
+  }
+  return programCache_;
+}
+
+} // namespace qaic
@@ -11,6 +11,8 @@ namespace qaic {
 
 using commonImageMap = std::unordered_map<QID, shQDeviceImageCommon>;
 
+QContentCache<QDeviceImageCommon> QProgramContainer::constantsCache_;
+
 shQDeviceImageCommon
 QDeviceImageCommon::Factory(QID device, QProgramContainer *programContainer,
                             QDeviceImageType imageSelect) {
@@ -40,12 +42,47 @@ QDeviceImageCommon::QDeviceImageCommon(QID device,
                                        __attribute__((unused)),
                                        QDeviceImageType imageSelect)
     : device_(device), imageSelect_(imageSelect), rt_(nullptr),
-      constDesc_(nullptr), const_(nullptr) {
+      constDesc_(nullptr), const_(nullptr), registry_(nullptr),
+      shared_(false) {
   rt_ = getRuntime(this);
 }
 
 QDeviceImageCommon::~QDeviceImageCommon() { unload(); }
 
+QStatus QDeviceImageCommon::reloadIfStale(QProgramContainer *programContainer) {
+  std::lock_guard<std::mutex> lock(reloadMutex_);
+  if (!shared_ ||
+      registry_->isLoaded(sharedKey_, constDesc_->getConstantsID())) {
+    return QS_SUCCESS;
+  }
+  // The device released the constants with the process that loaded them,
+  // the reference this process held went with the registry entry
+  QStatus status = constDesc_->detach();
+  if (status != QS_SUCCESS) {
+    LogErrorG("Constants on device {} are gone with their loader but still "
+              "used by an active program",
+              device_);
+    return status;
+  }
+  LogWarnG("Constants on device {} are gone with their loader, loading "
+           "them again",
+           device_);
+  constDesc_ = nullptr;
+  registry_ = nullptr;
+  shared_ = false;
+  return load(programContainer);
+}
+
+uint64_t
+QDeviceImageCommon::watchShared(QSharedImageRegistry::LostCallback onLost) {
+  std::lock_guard<std::mutex> lock(reloadMutex_);
+  if (!shared_) {
+    return 0;
+  }
+  return registry_->watch(sharedKey_, constDesc_->getConstantsID(),
+                          std::move(onLost));
+}
+
 QStatus QDeviceImageCommon::load(QProgramContainer *programContainer) {
 
   QStatus status;
@@ -76,6 +113,38 @@ QStatus QDeviceImageCommon::load(QProgramContainer *programContainer) {
       return QS_SUCCESS;
     }
 
+    // Constants another process loaded on the device are attached to
+    QSharedImageRegistry *registry = QSharedImageRegistryManager::getRegistry();
+    if ((registry != nullptr) &&
+        (programContainer->getContentDigest(QProgramContainer::Constants,
+                                            sharedKey_.digest,
+                                            sharedKey_.size) == QS_SUCCESS)) {
+      sharedKey_.qid = device_;
+      sharedKey_.kind = QSharedImageKind::Constants;
+      QSharedImageClaim claim = QSharedImageClaim::Private;
+      uint32_t id = 0;
+      if (registry->acquire(sharedKey_, claim, id,
+                            QSharedImageRegistryManager::getLoadWait()) !=
+          QS_SUCCESS) {
+        claim = QSharedImageClaim::Private;
+      }
+      if (claim == QSharedImageClaim::Reuse) {
+        constDesc_ = rt_->attachConstants(device_, id, status);
+        if (status != QS_SUCCESS) {
+          constDesc_ = nullptr;
+          bool lastHolder;
+          (void)registry->release(sharedKey_, id, lastHolder);
+          return status;
+        }
+        registry_ = registry;
+        shared_ = true;
+        return QS_SUCCESS;
+      }
+      if (claim == QSharedImageClaim::Load) {
+        registry_ = registry;
+      }
+    }
+
     QBuffer staticCompileTimeConstBuf;
     QBuffer dynamicCompileTimeConstBuf;
     programContainer->getConstantsBuffer(staticCompileTimeConstBuf,
@@ -87,6 +156,15 @@ QStatus QDeviceImageCommon::load(QProgramContainer *programContainer) {
       goto exit_failure;
     }
 
+    if (programContainer->hasCompressedConstants()) {
+      status = programContainer->loadCompressedConstants(
+          constDesc_, constDesc->staticConstantsSize);
+      if (status != QS_SUCCESS) {
+        LogErrorG("Failed to load compressed compile time constants");
+        goto exit_failure;
+      }
+    }
+
     if (staticCompileTimeConstBuf.size > 0) {
       // static compile time constants are loaded at DDR address 0
       status = constDesc_->loadConstantsAtOffset(staticCompileTimeConstBuf, 0);
@@ -106,10 +184,23 @@ QStatus QDeviceImageCommon::load(QProgramContainer *programContainer) {
         goto exit_failure;
       }
     }
+
+    if (registry_ != nullptr) {
+      if (registry_->publish(sharedKey_, constDesc_->getConstantsID()) ==
+          QS_SUCCESS) {
+        shared_ = true;
+      } else {
+        registry_ = nullptr;
+      }
+    }
   }
 
   return QS_SUCCESS;
 exit_failure:
+  if (registry_ != nullptr) {
+    (void)registry_->abandon(sharedKey_);
+    registry_ = nullptr;
+  }
   (void)unload(); // We already have an error code
   return status;
 }
@@ -117,7 +208,19 @@ exit_failure:
 QStatus QDeviceImageCommon::unload() {
   QStatus status = QS_SUCCESS;
   if (constDesc_ != nullptr) {
-    if (constDesc_->unload() != QS_SUCCESS) {
+    // Shared constants stay on the device while other holders use them. If
+    // the registry lost the entry, its loader exited and the device already
+    // released them.
+    bool lastHolder = !shared_;
+    if (shared_) {
+      (void)registry_->release(sharedKey_, constDesc_->getConstantsID(),
+                               lastHolder);
+      registry_ = nullptr;
+      shared_ = false;
+    }
+    QStatus unloadStatus =
+        lastHolder ? constDesc_->unload() : constDesc_->detach();
+    if (unloadStatus != QS_SUCCESS) {
       LogErrorG("Failed to unload constants Desc in exit_failure");
       status = QS_ERROR;
     }
@@ -167,11 +270,72 @@ QDeviceImage::QDeviceImage(QID device, QProgramContainer *programContainer
                            shQDeviceImageCommon shCommonImage,
                            QDeviceImageType imageSelect)
     : device_(device), imageSelect_(imageSelect), rt_(nullptr),
-      commonImage_(shCommonImage), networkImage_(nullptr) {
+      commonImage_(shCommonImage), networkImage_(nullptr), registry_(nullptr),
+      shared_(false) {
   rt_ = getRuntime(this);
 }
 
-QDeviceImage::~QDeviceImage() { unload(); }
+QDeviceImage::~QDeviceImage() {
+  unwatchShared();
+  unload();
+}
+
+QStatus QDeviceImage::reloadIfStale(QProgramContainer *programContainer) {
+  if (commonImage_) {
+    QStatus status = commonImage_->reloadIfStale(programContainer);
+    if (status != QS_SUCCESS) {
+      return status;
+    }
+  }
+  if (!shared_ ||
+      registry_->isLoaded(sharedKey_, networkImage_->getImageID())) {
+    return QS_SUCCESS;
+  }
+  // Same as for the constants of QDeviceImageCommon::reloadIfStale()
+  QStatus status = networkImage_->detach();
+  if (status != QS_SUCCESS) {
+    LogErrorG("Network on device {} is gone with its loader but still used "
+              "by an active program",
+              device_);
+    return status;
+  }
+  LogWarnG("Network on device {} is gone with its loader, loading it again",
+           device_);
+  networkImage_ = nullptr;
+  registry_ = nullptr;
+  shared_ = false;
+  return load(programContainer);
+}
+
+void QDeviceImage::watchShared(
+    const QSharedImageRegistry::LostCallback &onLost) {
+  unwatchShared();
+  if (commonImage_) {
+    uint64_t handle = commonImage_->watchShared(onLost);
+    if (handle != 0) {
+      watches_.push_back(handle);
+    }
+  }
+  if (shared_) {
+    uint64_t handle =
+        registry_->watch(sharedKey_, networkImage_->getImageID(), onLost);
+    if (handle != 0) {
+      watches_.push_back(handle);
+    }
+  }
+}
+
+void QDeviceImage::unwatchShared() {
+  if (watches_.empty()) {
+    return;
+  }
+  // Shared loads are only claimed in the registry of the process
+  QSharedImageRegistry *registry = QSharedImageRegistryManager::getRegistry();
+  for (uint64_t handle : watches_) {
+    registry->unwatch(handle);
+  }
+  watches_.clear();
+}
 
 QStatus QDeviceImage::load(QProgramContainer *programContainer) {
   auto const getMetadataCRC = [&](QProgramContainer *programContainer) {
@@ -199,18 +363,65 @@ QStatus QDeviceImage::load(QProgramContainer *programContainer) {
 
     status = programContainer->getBuffer(QProgramContainer::Network, qbuf);
 
-    if (status == QS_SUCCESS) {
-      networkImage_ =
-          rt_->loadImage(device_, qbuf, "NetworkImage", status, metadataCRC);
-      if (status != QS_SUCCESS) {
-        networkImage_ = nullptr;
-        goto exit_failure;
+    if (status != QS_SUCCESS) {
+      return status;
+    }
+
+    // An image another process loaded on the device is attached to
+    QSharedImageRegistry *registry = QSharedImageRegistryManager::getRegistry();
+    if ((registry != nullptr) &&
+        (programContainer->getContentDigest(QProgramContainer::Network,
+                                            sharedKey_.digest,
+                                            sharedKey_.size) == QS_SUCCESS)) {
+      sharedKey_.qid = device_;
+      sharedKey_.kind = QSharedImageKind::NetworkImage;
+      QSharedImageClaim claim = QSharedImageClaim::Private;
+      uint32_t id = 0;
+      if (registry->acquire(sharedKey_, claim, id,
+                            QSharedImageRegistryManager::getLoadWait()) !=
+          QS_SUCCESS) {
+        claim = QSharedImageClaim::Private;
+      }
+      if (claim == QSharedImageClaim::Reuse) {
+        networkImage_ = rt_->attachImage(device_, qbuf, id, status);
+        if (status != QS_SUCCESS) {
+          networkImage_ = nullptr;
+          bool lastHolder;
+          (void)registry->release(sharedKey_, id, lastHolder);
+          return status;
+        }
+        registry_ = registry;
+        shared_ = true;
+        return QS_SUCCESS;
+      }
+      if (claim == QSharedImageClaim::Load) {
+        registry_ = registry;
+      }
+    }
+
+    networkImage_ =
+        rt_->loadImage(device_, qbuf, "NetworkImage", status, metadataCRC);
+    if (status != QS_SUCCESS) {
+      networkImage_ = nullptr;
+      goto exit_failure;
+    }
+
+    if (registry_ != nullptr) {
+      if (registry_->publish(sharedKey_, networkImage_->getImageID()) ==
+          QS_SUCCESS) {
+        shared_ = true;
+      } else {
+        registry_ = nullptr;
       }
     }
   }
 
   return QS_SUCCESS;
 exit_failure:
+  if (registry_ != nullptr) {
+    (void)registry_->abandon(sharedKey_);
+    registry_ = nullptr;
+  }
   (void)unload(); // We already have an error code
   return status;
 }
@@ -218,10 +429,21 @@ exit_failure:
 QStatus QDeviceImage::unload() {
   QStatus status = QS_SUCCESS;
   if (networkImage_ != nullptr) {
-    if (networkImage_->unload() != QS_SUCCESS) {
+    // Same as for the constants of QDeviceImageCommon::unload()
+    bool lastHolder = !shared_;
+    if (shared_) {
+      (void)registry_->release(sharedKey_, networkImage_->getImageID(),
+                               lastHolder);
+      registry_ = nullptr;
+      shared_ = false;
+    }
+    QStatus unloadStatus =
+        lastHolder ? networkImage_->unload() : networkImage_->detach();
+    if (unloadStatus != QS_SUCCESS) {
       LogErrorG("Failed to unload network in exit_failure");
       status = QS_ERROR;
     }
+    networkImage_ = nullptr;
   }
   return status;
 }
@@ -268,7 +490,8 @@ bool QProgramContainer::contains(containerElements elemType) {
     return ((constDescBuf_.qb.buf != nullptr) && (constDescBuf_.qb.size != 0) &&
             (constDescBuf_.valid));
   case Constants:
-    return (((staticCompileTimeConstBuf_.qb.buf != nullptr) &&
+    return (compressedConstants_ ||
+            ((staticCompileTimeConstBuf_.qb.buf != nullptr) &&
              (staticCompileTimeConstBuf_.qb.size != 0) &&
              (staticCompileTimeConstBuf_.valid)) ||
             ((dynamicCompileTimeConstBuf_.qb.buf != nullptr) &&
@@ -399,9 +622,21 @@ QStatus QProgramContainer::init() {
     }
   }
 
-  if (getQPCSegment(qpcBuf_.get(), constantsDescSegmentName_,
-                    &(constDescBuf_.qb.buf), &(constDescBuf_.qb.size),
-                    0) != true) {
+  // Compressed constants are not expanded in host memory, they are
+  // decompressed while being loaded to the device
+  if (isQpcCompressed(qpcBuf_.get()) && !staticCompileTimeConstBuf_.valid &&
+      !dynamicCompileTimeConstBuf_.valid) {
+    int sizeRc = getQPCSegmentSize(qpcBuf_.get(), constantsSegmentName_,
+                                   &constantsSize_, &staticConstantsSize_);
+    if ((sizeRc == -EBADMSG) || (staticConstantsSize_ > constantsSize_)) {
+      LogErrorG("Invalid compressed constants segment in program container");
+      return QS_ERROR;
+    }
+    compressedConstants_ = (sizeRc == 0) && (constantsSize_ != 0);
+  }
+
+  if (getSegment(constantsDescSegmentName_, &(constDescBuf_.qb.buf),
+                 &(constDescBuf_.qb.size)) != true) {
     LogErrorG("Failed to extract constants descriptor segment from program "
               "container");
     return QS_ERROR;
@@ -409,9 +644,8 @@ QStatus QProgramContainer::init() {
     constDescBuf_.valid = true;
   }
 
-  if (getQPCSegment(qpcBuf_.get(), networkDescSegmentName_,
-                    &(networkDescBuf_.qb.buf), &(networkDescBuf_.qb.size),
-                    0) != true) {
+  if (getSegment(networkDescSegmentName_, &(networkDescBuf_.qb.buf),
+                 &(networkDescBuf_.qb.size)) != true) {
     LogErrorG("Failed to extract network desriptor segment from program "
               "container {}",
               rc);
@@ -420,8 +654,8 @@ QStatus QProgramContainer::init() {
     networkDescBuf_.valid = true;
   }
 
-  if (getQPCSegment(qpcBuf_.get(), networkSegmentName_, &(progBuf_.qb.buf),
-                    &(progBuf_.qb.size), 0) != true) {
+  if (getSegment(networkSegmentName_, &(progBuf_.qb.buf),
+                 &(progBuf_.qb.size)) != true) {
     LogErrorG("Failed to extract network segment from program container {}",
               rc);
     return QS_ERROR;
@@ -429,17 +663,15 @@ QStatus QProgramContainer::init() {
     progBuf_.valid = true;
   }
 
-  if (getQPCSegment(qpcBuf_.get(), constantsCRCSegmentName_,
-                    &(constantsCRCBuf_.qb.buf), &(constantsCRCBuf_.qb.size),
-                    0) != true) {
+  if (getSegment(constantsCRCSegmentName_, &(constantsCRCBuf_.qb.buf),
+                 &(constantsCRCBuf_.qb.size)) != true) {
     LogInfoG("No CRC segment for constants");
   } else {
     constantsCRCBuf_.valid = true;
   }
 
-  if (getQPCSegment(qpcBuf_.get(), metadataCRCSegmentName_,
-                    &(metadataCRCBuf_.qb.buf), &(metadataCRCBuf_.qb.size),
-                    0) != true) {
+  if (getSegment(metadataCRCSegmentName_, &(metadataCRCBuf_.qb.buf),
+                 &(metadataCRCBuf_.qb.size)) != true) {
     LogInfoG("No CRC segment for metadata");
   } else {
     metadataCRCBuf_.valid = true;
@@ -580,7 +812,24 @@ QProgramContainer::getCommonDeviceImage(QID device,
   std::unique_lock<std::mutex> lock(commonImageLoadedMapMutex_);
   commonImageMap::const_iterator found = commonImageLoadedMap_.find(device);
   if (found == commonImageLoadedMap_.end()) {
-    commonImage = QDeviceImageCommon::Factory(device, this, imageSelect);
+    // Other programs with the same constants share their load on the device
+    QContentKey key;
+    key.qid = device;
+    if ((imageSelect & ConstantsImage) &&
+        (getContentDigest(Constants, key.digest, key.size) == QS_SUCCESS)) {
+      bool reused = false;
+      commonImage = constantsCache_.get(
+          key,
+          [&]() {
+            return QDeviceImageCommon::Factory(device, this, imageSelect);
+          },
+          reused);
+      if (reused) {
+        LogInfoG("Reusing constants of another program on device {}", device);
+      }
+    } else {
+      commonImage = QDeviceImageCommon::Factory(device, this, imageSelect);
+    }
     if (!commonImage) {
       LogErrorG("Failed to created common image object for constants");
       return QS_ERROR;
@@ -616,10 +865,129 @@ QStatus QProgramContainer::getIoDescriptor(QData *ioDescData) {
   return QS_SUCCESS;
 }
 
+QStatus
+QProgramContainer::loadCompressedConstants(QNNConstantsInterface *constants,
+                                           uint64_t dynamicConstantsOffset) {
+  if ((constants == nullptr) || !compressedConstants_) {
+    return QS_INVAL;
+  }
+
+  // Same placement as uncompressed constants, static constants at DDR
+  // offset 0 and dynamic constants at dynamicConstantsOffset
+  const struct {
+    uint64_t start;
+    uint64_t size;
+    uint64_t ddrOffset;
+  } ranges[] = {{0, staticConstantsSize_, 0},
+                {staticConstantsSize_, constantsSize_ - staticConstantsSize_,
+                 dynamicConstantsOffset}};
+
+  for (const auto &range : ranges) {
+    QStatus status = QS_SUCCESS;
+    int rc = streamQPCSegment(
+        qpcBuf_.get(), constantsSegmentName_, range.start, range.size, 0,
+        [&](const uint8_t *chunk, size_t chunkSize, uint64_t rawOffset) {
+          QBuffer qbuf;
+          qbuf.buf = const_cast<uint8_t *>(chunk);
+          qbuf.size = chunkSize;
+          status = constants->loadConstantsAtOffset(
+              qbuf, range.ddrOffset + (rawOffset - range.start));
+          return (status == QS_SUCCESS) ? 0 : -EIO;
+        });
+    if (status != QS_SUCCESS) {
+      return status;
+    }
+    if (rc != 0) {
+      LogErrorG("Failed to decompress constants, error {}", rc);
+      return QS_ERROR;
+    }
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QProgramContainer::getContentDigest(containerElements elem,
+                                            QContentDigest &digest,
+                                            uint64_t &size) {
+  std::lock_guard<std::mutex> lk(contentDigestMutex_);
+  auto found = contentDigests_.find(elem);
+  if (found != contentDigests_.end()) {
+    digest = found->second.first;
+    size = found->second.second;
+    return QS_SUCCESS;
+  }
+
+  QContentHasher hasher;
+  switch (elem) {
+  case Network:
+    if (!contains(Network)) {
+      return QS_INVAL;
+    }
+    hasher.add(progBuf_.qb.buf, progBuf_.qb.size);
+    break;
+  case Constants:
+    if (!contains(ConstantsDescriptor)) {
+      return QS_INVAL;
+    }
+    hasher.add(constDescBuf_.qb.buf, constDescBuf_.qb.size);
+    if (compressedConstants_) {
+      // The stored blocks decode to the same constants every time, the
+      // same constants compressed otherwise only miss a reuse
+      const uint8_t *stored = nullptr;
+      size_t storedSize = 0;
+      int rc = getQPCStoredSegment(qpcBuf_.get(), constantsSegmentName_,
+                                   &stored, &storedSize);
+      if (rc != 0) {
+        LogErrorG("Failed to find compressed constants, error {}", rc);
+        return QS_ERROR;
+      }
+      hasher.add(stored, storedSize);
+    } else {
+      for (const ContainerBuffer *constBuf :
+           {&staticCompileTimeConstBuf_, &dynamicCompileTimeConstBuf_}) {
+        if (constBuf->valid) {
+          hasher.add(constBuf->qb.buf, constBuf->qb.size);
+        }
+      }
+    }
+    break;
+  default:
+    return QS_INVAL;
+  }
+  digest = hasher.getDigest();
+  size = hasher.getSize();
+  contentDigests_[elem] = {digest, size};
+  return QS_SUCCESS;
+}
+
+// Segments of a compressed QPC are decompressed on first use and kept for
+// the lifetime of the container
+bool QProgramContainer::getSegment(const char *name, uint8_t **buf,
+                                   size_t *size) {
+  if (!isQpcCompressed(qpcBuf_.get())) {
+    return getQPCSegment(qpcBuf_.get(), name, buf, size, 0);
+  }
+
+  std::lock_guard<std::mutex> lock(segmentStoreMutex_);
+  auto it = segmentStore_.find(name);
+  if (it == segmentStore_.end()) {
+    std::vector<uint8_t> segment;
+    int rc = readQPCSegment(qpcBuf_.get(), name, segment, 0);
+    if (rc != 0) {
+      if (rc != -ENOENT) {
+        LogErrorG("Failed to decompress segment {}, error {}", name, rc);
+      }
+      return false;
+    }
+    it = segmentStore_.emplace(name, std::move(segment)).first;
+  }
+  *buf = it->second.data();
+  *size = it->second.size();
+  return true;
+}
+
 QStatus QProgramContainer::getBufferByName(const std::string &name,
                                            QData &qdata) {
-  if (getQPCSegment(qpcBuf_.get(), name.c_str(), &qdata.data, &qdata.size, 0) ==
-      false) {
+  if (getSegment(name.c_str(), &qdata.data, &qdata.size) == false) {
     return QS_INVAL;
   }
   return QS_SUCCESS;
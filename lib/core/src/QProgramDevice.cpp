@@ -14,6 +14,7 @@
 #include "elfio/elfio.hpp"
 #include "metadataflatbufDecode.hpp"
 #include "QExecObj.h"
+#include "QFlightRecorder.h"
 
 namespace qaic {
 
@@ -25,7 +26,8 @@ QProgramDevice::QProgramDevice(shQContext context, QProgram *program, QID dev)
       QComponent("ProgDev", NextUniqueObjId++, context.get()),
       QIAicApiContext(context), dev_(dev), qnaid_(UINT32_MAX),
       program_(program), nnImage_(nullptr), nnConstants_(nullptr),
-      qnn_(nullptr), rt_(nullptr), devInfoValidated_(false) {
+      qnn_(nullptr), activationState_(ACTIVATION_STATE_CMD_READY),
+      rt_(nullptr), devInfoValidated_(false) {
   if ((program_ != nullptr) && (program_->context_ != nullptr)) {
     rt_ = program->context_->rt();
   }
@@ -64,6 +66,8 @@ ProgramState QProgramDevice::getProgramState() {
   // for optimal performance
   if (isIn(Q_STATE_CAST(this->ac_ready))) {
     return STATE_PROGRAM_READY;
+  } else if (isIn(Q_STATE_CAST(this->ac_standby))) {
+    return STATE_PROGRAM_STANDBY;
   } else if (isIn(Q_STATE_CAST(this->loaded_super))) {
     return STATE_PROGRAM_LOADED;
   } else if (isIn(Q_STATE_CAST(this->initial)) ||
@@ -102,6 +106,9 @@ void QProgramDevice::getProgramInfo(QAicProgramInfo &info) {
   case STATE_PROGRAM_READY:
     info.status = QAicProgramStatus::QAIC_PROGRAM_FULLY_ACTIVATED;
     break;
+  case STATE_PROGRAM_STANDBY:
+    info.status = QAicProgramStatus::QAIC_PROGRAM_STANDBY;
+    break;
   case STATE_PROGRAM_LOAD_ERROR:
     info.status = QAicProgramStatus::QIAC_PROGRAM_LOAD_ERROR;
     break;
@@ -146,6 +153,12 @@ bool QProgramDevice::isReady() {
   return (isIn(Q_STATE_CAST(this->ac_ready)));
 }
 
+bool QProgramDevice::isStandby() {
+  std::unique_lock<std::mutex> lk(programMutex_);
+  LogDebugApi("Current Program state {}", str(getProgramState()));
+  return (isIn(Q_STATE_CAST(this->ac_standby)));
+}
+
 bool QProgramDevice::isDeviceReady() {
   std::unique_lock<std::mutex> lk(programMutex_);
   LogDebugApi("Current Program state {}", str(getProgramState()));
@@ -156,6 +169,7 @@ bool QProgramDevice::isLoaded() {
   std::unique_lock<std::mutex> lk(programMutex_);
   LogDebugApi("Current Program state {}", str(getProgramState()));
   return (isIn(Q_STATE_CAST(this->ac_ready)) ||
+          isIn(Q_STATE_CAST(this->ac_standby)) ||
           isIn(Q_STATE_CAST(this->loaded)));
 }
 
@@ -208,6 +222,9 @@ QStatus QProgramDevice::processActivateCmd(QProgramActivationCmd cmd) {
   case QProgram_CMD_ACTIVATE_FULL:
     status = activate();
     break;
+  case QProgram_CMD_ACTIVATE_STANDBY:
+    status = standby_request();
+    break;
   case QProgram_CMD_DEACTIVATE_FULL:
     // Deactivating while ExecObj are registered with program device
     // will cause the ExecObj to become invalid, unless they are tied
@@ -222,6 +239,7 @@ QStatus QProgramDevice::processActivateCmd(QProgramActivationCmd cmd) {
     LogErrorApi("Received unsupported Activation command {}", cmd);
     break;
   }
+  qFlightRecord(QFlightEventType::ActivationCmd, dev_, cmd, status);
   return status;
 }
 
@@ -259,6 +277,12 @@ QProgramDevice::notifyDeviceStateInfo(std::shared_ptr<QDeviceStateInfo> event) {
   uint32_t vcid = event->vcId();
   std::string deviceSBDF = event->deviceSBDF();
 
+  qFlightRecord(QFlightEventType::DeviceEvent, qid, event->deviceEvent(),
+                vcid);
+  if (event->deviceEvent() == DEVICE_DOWN) {
+    (void)QFlightRecorderManager::dumpOnError("device down");
+  }
+
   std::unique_lock<std::mutex> lk(programMutex_);
 
   uint32_t qnnVcid = qutil::INVALID_VCID;
@@ -378,6 +402,8 @@ std::string QProgramDevice::str(ProgramState state) {
     return "STATE_PROGRAM_DEVICE_ERROR";
   case STATE_PROGRAM_TRANSITION:
     return "STATE_PROGRAM_TRANSITION";
+  case STATE_PROGRAM_STANDBY:
+    return "STATE_PROGRAM_STANDBY";
   default:
     return "STATE_UNKNOWN";
   }
@@ -400,6 +426,25 @@ QStatus QProgramDevice::activate() {
   return status;
 }
 
+// Assigns the activation resources without running the program, so that a
+// later activate() only has to move the activation to ready. A program
+// already in standby or ready is left as is.
+QStatus QProgramDevice::standby_request() {
+  QStatus status = QS_SUCCESS;
+  std::unique_lock<std::mutex> lk(programMutex_);
+  if (isIn(Q_STATE_CAST(this->active_super))) {
+    return QS_SUCCESS;
+  }
+  setHsmSignalWithLock(STANDBY_SIG);
+  run();
+  if (!isIn(Q_STATE_CAST(this->ac_standby))) {
+    LogErrorApi("Failed to Activate program in standby, state:{}",
+                str(getProgramState()));
+    status = QS_ERROR;
+  }
+  return status;
+}
+
 QStatus QProgramDevice::ready_request() {
   QStatus status = QS_SUCCESS;
   std::unique_lock<std::mutex> lk(programMutex_);
@@ -507,15 +552,77 @@ bool QProgramDevice::load_action() {
 bool QProgramDevice::activate_action() {
   QStatus status = QS_ERROR;
 
-  // Defaults
-  QActivationStateType activationState = ACTIVATION_STATE_CMD_READY;
+  // Loads attached from another process are gone once it exits
+  if (deviceImage_) {
+    if (deviceImage_->reloadIfStale(program_->getContainer()) != QS_SUCCESS) {
+      LogErrorApi("Failed to load again the images of an exited process");
+      return false;
+    }
+    nnConstants_ = deviceImage_->getConstants();
+    nnImage_ = deviceImage_->getNNImage();
+    if (nnImage_ == nullptr) {
+      return false;
+    }
+  }
 
-  qnn_ = rt_->activateNetwork(nnImage_, nnConstants_, status, activationState,
+  const QAicProgramSchedProperties properties =
+      program_->getSchedProperties();
+  // A new target replaces what tuning of earlier activations reached
+  if (properties.NumInferencesInFlight != vcQueueInFlightAsked_) {
+    vcQueueSizing_ = QVCQueueSizing(properties.NumInferencesInFlight);
+    vcQueueInFlightAsked_ = properties.NumInferencesInFlight;
+  }
+  qnn_ = rt_->activateNetwork(nnImage_, nnConstants_, status,
+                              activationState_,
                               program_->programProperties_.SubmitRetryTimeoutMs,
-                              program_->programProperties_.SubmitNumRetries);
+                              program_->programProperties_.SubmitNumRetries,
+                              vcQueueSizing_.getInferencesInFlight());
   if ((status != QS_SUCCESS) || (qnn_ == nullptr)) {
     return false;
   }
+
+  QSubmitSchedParams schedParams;
+  schedParams.priority = properties.Priority;
+  schedParams.weight = properties.Weight;
+  schedParams.maxInFlight = properties.MaxInFlight;
+  schedParams.maxWaitUs = properties.MaxWaitUs;
+  schedParams.deviceInFlight = properties.DeviceInFlight;
+  schedParams.queueInFlight = vcQueueSizing_.getInferencesInFlight();
+  if (qnn_->setSubmitSchedParams(schedParams) != QS_SUCCESS) {
+    LogErrorApi("Failed to schedule program submissions");
+    (void)qnn_->deactivate();
+    qnn_ = nullptr;
+    return false;
+  }
+
+  // The loader of an image attached to may exit while the activation is in
+  // service, not only before
+  sharedImageLost_ = false;
+  if (deviceImage_) {
+    deviceImage_->watchShared([this]() { sharedImageLost(); });
+  }
+  return true;
+}
+
+void QProgramDevice::sharedImageLost() {
+  if (sharedImageLost_.exchange(true)) {
+    return;
+  }
+  LogWarnApi("Images on device {} are gone with the process that loaded "
+             "them, the program is to be activated again",
+             dev_);
+  program_->notifySharedImageLost();
+}
+
+bool QProgramDevice::ready_action() {
+  if (qnn_ == nullptr) {
+    return false;
+  }
+  if (qnn_->activateStateChange(ACTIVATION_STATE_CMD_READY) != QS_SUCCESS) {
+    LogErrorApi("Failed to move activation {} from standby to ready",
+                qnn_->getId());
+    return false;
+  }
   return true;
 }
 
@@ -532,7 +639,16 @@ bool QProgramDevice::unload_action() {
 }
 
 bool QProgramDevice::deactivate_action() {
+  if (deviceImage_) {
+    deviceImage_->unwatchShared();
+  }
   if (qnn_ != nullptr) {
+    // A queue that was often full gets room for more inferences at the
+    // next activation
+    uint64_t numSubmits = 0;
+    uint64_t numQueueFull = 0;
+    qnn_->getSubmitQueueStats(numSubmits, numQueueFull);
+    vcQueueSizing_.observe(numSubmits, numQueueFull);
     if (qnn_->deactivate() != QS_SUCCESS) {
       return false;
     }
@@ -566,6 +682,8 @@ void QProgramDevice::logEventStateName(int32_t sig, const char *state) {
   switch (sig) {
   case Q_ENTRY_SIG:
     eventName = "Q_ENTRY_SIG";
+    QFlightRecorderManager::getRecorder().recordText(
+        QFlightEventType::StateEnter, dev_, state);
     break;
   case Q_EXIT_SIG:
     eventName = "Q_EXIT_SIG";
@@ -591,6 +709,9 @@ void QProgramDevice::logEventStateName(int32_t sig, const char *state) {
   case DEACTIVATE_SIG:
     eventName = "DEACTIVATE_SIG";
     break;
+  case STANDBY_SIG:
+    eventName = "STANDBY_SIG";
+    break;
   case LOAD_COMPLETE_SIG:
     eventName = "LOAD_COMPLETE_SIG";
     break;
@@ -660,6 +781,11 @@ Q_STATE_DEF(QProgramDevice, created_super) {
     setHsmSignal(ACTIVATE_SIG);
     break;
 
+  case STANDBY_SIG:
+    setHsmSignal(LOAD_SIG);
+    setHsmSignal(STANDBY_SIG);
+    break;
+
   case DEVICE_DOWN_SIG:
     // Move to error state
     return tran(Q_STATE_CAST(&device_error));
@@ -774,6 +900,11 @@ Q_STATE_DEF(QProgramDevice, loaded) {
   case Q_ENTRY_SIG:
     break;
   case ACTIVATE_SIG:
+    activationState_ = ACTIVATION_STATE_CMD_READY;
+    return tran(Q_STATE_CAST(&activating));
+
+  case STANDBY_SIG:
+    activationState_ = ACTIVATION_STATE_CMD_STANDBY;
     return tran(Q_STATE_CAST(&activating));
 
   case UNLOAD_SIG:
@@ -804,6 +935,9 @@ Q_STATE_DEF(QProgramDevice, activating) {
     break;
 
   case ACTIVATE_COMPLETE_SIG:
+    if (activationState_ == ACTIVATION_STATE_CMD_STANDBY) {
+      return tran(Q_STATE_CAST(&ac_standby));
+    }
     return tran(Q_STATE_CAST(&ac_ready));
     break;
 
@@ -820,6 +954,11 @@ Q_STATE_DEF(QProgramDevice, activate_failed) {
     break;
 
   case ACTIVATE_SIG:
+    activationState_ = ACTIVATION_STATE_CMD_READY;
+    return tran(Q_STATE_CAST(&activating));
+
+  case STANDBY_SIG:
+    activationState_ = ACTIVATION_STATE_CMD_STANDBY;
     return tran(Q_STATE_CAST(&activating));
 
   case Q_EXIT_SIG:
@@ -866,6 +1005,29 @@ Q_STATE_DEF(QProgramDevice, active_super) {
   return super(&loaded_super);
 }
 
+//-------------------------------------------------------------------------------------------------
+// Resources are assigned but the program does not run until moved to ready
+Q_STATE_DEF(QProgramDevice, ac_standby) {
+  logEventStateName(e->sig, __func__);
+  switch (e->sig) {
+  case Q_ENTRY_SIG:
+    break;
+
+  case ACTIVATE_SIG:
+    if (ready_action()) {
+      return tran(Q_STATE_CAST(&ac_ready));
+    }
+    break;
+
+  case Q_EXIT_SIG:
+    break;
+
+  default:
+    break;
+  }
+  return super(&active_super);
+}
+
 //-------------------------------------------------------------------------------------------------
 Q_STATE_DEF(QProgramDevice, ac_ready) {
   logEventStateName(e->sig, __func__);
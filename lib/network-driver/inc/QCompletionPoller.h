@@ -0,0 +1,89 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QCOMPLETION_POLLER_H
+#define QCOMPLETION_POLLER_H
+
+#include "QAicRuntimeTypes.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace qaic {
+
+/// Spin then block completion policy. A waiter first polls a cheap,
+/// non blocking probe of the completion source for up to a spin budget, and
+/// only then falls back to the blocking wait. The blocking wait always runs
+/// to reap the completion, after a successful probe it returns immediately.
+/// This trades a core for the sleep and wake up latency of the blocking wait.
+///
+/// A source whose probe never fires, e.g. a driver that does not signal the
+/// eventfd, would burn the budget on every wait. Once probeWarmupWaits waits
+/// went by without a single probe hit, spinning is skipped. Spinning is also
+/// skipped on a single CPU, where it only delays whoever signals completion.
+class QCompletionPoller {
+public:
+  static constexpr uint64_t probeWarmupWaits = 64;
+
+  explicit QCompletionPoller(
+      bool canSpin = (std::thread::hardware_concurrency() > 1))
+      : canSpin_(canSpin) {}
+
+  /// \p probe returns true once the completion is signalled, \p block is the
+  /// blocking wait whose status is returned
+  template <typename Probe, typename Block>
+  QStatus wait(std::chrono::microseconds spinBudget, Probe &&probe,
+               Block &&block) {
+    uint64_t waits = numWaits_.fetch_add(1, std::memory_order_relaxed);
+    if (canSpin_ && (spinBudget.count() > 0) && isProbeUseful(waits)) {
+      const auto deadline = std::chrono::steady_clock::now() + spinBudget;
+      while (true) {
+        if (probe()) {
+          numSpinHits_.fetch_add(1, std::memory_order_relaxed);
+          return block();
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+          break;
+        }
+        cpuRelax();
+      }
+    }
+    numBlockingWaits_.fetch_add(1, std::memory_order_relaxed);
+    return block();
+  }
+
+  uint64_t getNumWaits() const { return numWaits_; }
+  /// Waits completed within the spin budget
+  uint64_t getNumSpinHits() const { return numSpinHits_; }
+  /// Waits that went to the blocking wait without a probe hit
+  uint64_t getNumBlockingWaits() const { return numBlockingWaits_; }
+
+private:
+  bool isProbeUseful(uint64_t waits) const {
+    return (waits < probeWarmupWaits) ||
+           (numSpinHits_.load(std::memory_order_relaxed) != 0);
+  }
+
+  static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+  }
+
+  const bool canSpin_;
+  std::atomic<uint64_t> numWaits_{0};
+  std::atomic<uint64_t> numSpinHits_{0};
+  std::atomic<uint64_t> numBlockingWaits_{0};
+};
+
+} // namespace qaic
+
+#endif // QCOMPLETION_POLLER_H
@@ -0,0 +1,164 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QCOMPLETION_REAPER_H
+#define QCOMPLETION_REAPER_H
+
+#include "QAicRuntimeTypes.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace qaic {
+
+/// In order reaping of the async waits of one network. The KMD has no non
+/// blocking wait, a wait timeout of 0 selects its default timeout, so
+/// reaping runs on a completion thread of the network and never on the
+/// reactor thread that watches the source. Each completion on a VC adds one
+/// to its eventfd counter, the reactor handler credits the count it drained
+/// and the completion thread reaps as many waits from the head, their
+/// kernel wait returning right away.
+///
+/// A credit may belong to a completion that is not queued here, e.g. of
+/// another network or a synchronous wait on the same VC. The check of the
+/// head then finds it still running, the wait of the check blocks the
+/// completion thread of this network only and the remaining credits are
+/// dropped, the completion of the head signals again.
+///
+/// Without a source, e.g. no usable eventfd on the VC, the reaper is polled:
+/// every queued wait counts as credited and the check of the head blocks
+/// until it completes.
+template <typename Wait> class QCompletionReaper {
+public:
+  /// Queues \p wait. \p onFirst runs under the queue lock when the queue was
+  /// empty, e.g. to arm a timer.
+  template <typename OnFirst> void push(Wait wait, OnFirst &&onFirst) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    waits_.push_back(std::move(wait));
+    if (waits_.size() == 1) {
+      onFirst();
+    }
+    if (polled_) {
+      readyCv_.notify_one();
+    }
+  }
+
+  /// Credits \p count completions signalled by the source
+  void signal(uint64_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    credits_ = std::min<uint64_t>(credits_ + count, waits_.size());
+    if (credits_ != 0) {
+      readyCv_.notify_one();
+    }
+  }
+
+  /// Allows waitReady() to block again, \p polled when nothing signals
+  void start(bool polled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = false;
+    polled_ = polled;
+  }
+
+  /// Wakes waitReady() for good and ends a running reap() after the wait it
+  /// is checking
+  void stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    readyCv_.notify_all();
+  }
+
+  /// Blocks the completion thread until a credited wait is queued. Returns
+  /// false once stopped.
+  bool waitReady() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    readyCv_.wait(lock, [this]() { return stopped_ || isReady(); });
+    return !stopped_;
+  }
+
+  /// Reaps credited waits in order. \p check is the kernel wait of the head,
+  /// called without the lock, QS_TIMEDOUT means it is still running.
+  /// \p complete gets each reaped wait with its status. \p onEmpty runs under
+  /// the queue lock once the queue drained, e.g. to disarm a timer.
+  /// Not to be called concurrently with itself.
+  template <typename Check, typename Complete, typename OnEmpty>
+  void reap(Check &&check, Complete &&complete, OnEmpty &&onEmpty) {
+    while (true) {
+      Wait *head;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_ || !isReady()) {
+          return;
+        }
+        // Only the reaper removes entries, the head stays valid
+        head = &waits_.front();
+      }
+
+      QStatus status = check(*head);
+
+      Wait done;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        numChecks_++;
+        if (status == QS_TIMEDOUT) {
+          numMissedChecks_++;
+          credits_ = 0;
+          return;
+        }
+        done = std::move(waits_.front());
+        waits_.pop_front();
+        credits_ = (credits_ != 0) ? (credits_ - 1) : 0;
+        if (waits_.empty()) {
+          onEmpty();
+        }
+      }
+      complete(std::move(done), status);
+    }
+  }
+
+  /// Removes all queued waits, e.g. when the source goes away
+  std::deque<Wait> drain() {
+    std::deque<Wait> waits;
+    std::lock_guard<std::mutex> lock(mutex_);
+    waits.swap(waits_);
+    credits_ = 0;
+    return waits;
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return waits_.size();
+  }
+
+  /// Kernel waits issued
+  uint64_t getNumChecks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return numChecks_;
+  }
+  /// Kernel waits that found the head still running and so blocked
+  uint64_t getNumMissedChecks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return numMissedChecks_;
+  }
+
+private:
+  // Called with the lock held
+  bool isReady() const {
+    return !waits_.empty() && (polled_ || (credits_ != 0));
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable readyCv_;
+  std::deque<Wait> waits_;
+  uint64_t credits_ = 0;
+  bool polled_ = false;
+  bool stopped_ = false;
+  uint64_t numChecks_ = 0;
+  uint64_t numMissedChecks_ = 0;
+};
+
+} // namespace qaic
+
+#endif // QCOMPLETION_REAPER_H
@@ -9,6 +9,7 @@
 #include "QRuntimePlatformKmdDeviceInterface.h"
 #include "QDevInterface.h"
 #include "QActivationStateCmd.h"
+#include "QVCQueueSizing.h"
 
 #include <atomic>
 #include <memory>
@@ -45,11 +46,12 @@ public:
   [[nodiscard]] virtual QStatus unloadConstants(QNNConstantsID constantsID) = 0;
   ///\p naID and \p vc are output parameters. After successful activation,
   /// a QVirtualChannelInterface object will be returned to caller through \p
-  /// vc.
+  /// vc. The VC queue holds 2^\p queueSizePow2 request elements.
   [[nodiscard]] virtual QStatus
   activate(QNNImageID imageID, QNNConstantsID constantsID, QNAID &naID,
            uint64_t &ddrBase, uint64_t &mcIDBase, QVirtualChannelInterface **vc,
-           QActivationStateType initialState = ACTIVATION_STATE_CMD_READY) = 0;
+           QActivationStateType initialState = ACTIVATION_STATE_CMD_READY,
+           uint32_t queueSizePow2 = DefaultVCQueueSizePow2) = 0;
   [[nodiscard]] virtual QStatus sendActivationStateChangeCommand(
       std::vector<std::pair<QNAID, QActivationStateType>> &stateCmdSet) = 0;
 
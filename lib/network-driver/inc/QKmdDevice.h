@@ -49,7 +49,8 @@ public:
   [[nodiscard]] virtual QStatus activate(
       QNNImageID imageID, QNNConstantsID constantsID, QNAID &naID,
       uint64_t &ddrBase, uint64_t &mcIDBase, QVirtualChannelInterface **vc,
-      QActivationStateType initialState = ACTIVATION_STATE_CMD_READY) override;
+      QActivationStateType initialState = ACTIVATION_STATE_CMD_READY,
+      uint32_t queueSizePow2 = DefaultVCQueueSizePow2) override;
 
   [[nodiscard]] virtual QStatus sendActivationStateChangeCommand(
       std::vector<std::pair<QNAID, QActivationStateType>> &stateCmdSet)
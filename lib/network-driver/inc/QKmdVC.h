@@ -11,13 +11,15 @@
 #include <condition_variable>
 #include <memory>
 #include <thread>
+#include <unistd.h>
 
 namespace qaic {
 
 class QKmdVC : public QVirtualChannelInterface {
 public:
-  QKmdVC(QID devID, QVCID vc, uint32_t qSizePow2)
-      : QVirtualChannelInterface(devID, vc, 0, 0, qSizePow2){};
+  /// The VC owns \p efd, the eventfd handed to the KMD when the VC was set up
+  QKmdVC(QID devID, QVCID vc, uint32_t qSizePow2, int efd = -1)
+      : QVirtualChannelInterface(devID, vc, 0, 0, qSizePow2), efd_(efd){};
 
   void advanceReqQueueTP(uint32_t) override{};
   void advanceRespQueueHP(uint32_t) override{};
@@ -35,7 +37,16 @@ public:
 
   bool hasResponse() const override { return true; }
 
-  ~QKmdVC() = default;
+  int getEventFd() const override { return efd_; }
+
+  ~QKmdVC() {
+    if (efd_ >= 0) {
+      close(efd_);
+    }
+  }
+
+private:
+  const int efd_;
 };
 
 } // namespace qaic
@@ -13,9 +13,11 @@ class QKmdVCFactory : public QVCFactoryInterface {
 public:
   std::unique_ptr<QVirtualChannelInterface, VCDeleter>
   makeVC(QID devID, QVCID vc, uint8_t *, uint8_t *, uint32_t qSizePow2,
-         VCDeleter deleter, void *) override {
+         VCDeleter deleter, void *vcData) override {
+    // vcData optionally points to the eventfd of the VC
+    int efd = (vcData != nullptr) ? *static_cast<int *>(vcData) : -1;
     return std::unique_ptr<QVirtualChannelInterface, VCDeleter>(
-        new QKmdVC(devID, vc, qSizePow2), deleter);
+        new QKmdVC(devID, vc, qSizePow2, efd), deleter);
   }
 };
 
@@ -10,6 +10,7 @@
 #include "QDevAic100Interface.h"
 
 #include "assert.h"
+#include <cstring>
 #include <memory>
 #include <tuple>
 #include <vector>
@@ -23,15 +24,33 @@ using QReqElemStencil = std::vector<std::unique_ptr<QDmaRequestElement>>;
 /// the buffer and lastly the size of the trunk.
 using QElemToBufVec = std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>;
 
+/// Fields of a pre-encoded request element written for each inference
+struct QDmaPatchSite {
+  /// Buffer of the element, IDX_NO_DMA if none
+  int32_t bufIndex = IDX_NO_DMA;
+  /// Word of the element holding the host address, 0 if no DMA
+  uint8_t addrWord = 0;
+  bool needResponse = false;
+  /// Smallest buffer the element transfers from or to
+  uint32_t minSize = 0;
+};
+
 /// This class stores the stencil generated by QImageParserInterface objects.
 /// A stencil contains partially configured request elements which are used
 /// as a base for the fully configured request elements.
+///
+/// The elements are encoded once when the metadata is created, for the
+/// activation once getUpdatedMetadata() applied the base addresses. Each
+/// inference copies the encoded elements and writes only the fields listed
+/// in the patch sites.
 class QMetaData : public QMetaDataInterface, public QLogger {
 public:
   QMetaData(uint32_t numBuf, const QElemToBufVec &bufMap,
             QReqElemStencil stencil)
       : QLogger("QMetaData"), stencil_(std::move(stencil)), numBuf_(numBuf),
-        elemToBufVec_(bufMap) {}
+        elemToBufVec_(bufMap) {
+    encodeTemplates();
+  }
 
   std::unique_ptr<QMetaDataInterface>
   getUpdatedMetadata(uint64_t ddrBase, uint64_t mcIDBase) const override {
@@ -46,47 +65,63 @@ public:
     return newMeta;
   }
 
-  /// Loop through the elements in the stencil, update target elements with
+  /// Copy the encoded elements in the stencil, update target elements with
   /// request ID and buffer address if specified in the stencil
   QStatus updateDmaReqElements(QReqID &reqID, const QBuffer *bufs,
                                uint32_t bufCount, std::vector<uint8_t *> &elems,
                                QReqID &lastReqID) const override {
-    if (stencil_.size() > elems.size()) {
+    const uint32_t elemSize = QDmaRequestElement::getSize();
+    const size_t numElems = patchSites_.size();
+    if (numElems > elems.size()) {
       LogError("Expecting space for {} request elements, got only {}",
-               stencil_.size(), elems.size());
+               numElems, elems.size());
       return QS_INVAL;
     }
-    QReqID i = 0, last = 0;
-
-    for (const auto &item : stencil_) {
-      int index = item->getBufIndex();
-      bool needResponse = false;
+    // Elements next to each other in the queue are copied at once
+    for (size_t first = 0; first < numElems;) {
+      size_t last = first + 1;
+      while ((last < numElems) &&
+             (elems[last] == elems[last - 1] + elemSize)) {
+        last++;
+      }
+      memcpy(elems[first], &reqTemplate_[first * elemSize],
+             (last - first) * elemSize);
+      first = last;
+    }
 
+    QReqID i = 0, last = 0;
+    for (const auto &site : patchSites_) {
       // Skip reqID of 0
       if (reqID + i == 0) {
         reqID += 1;
       }
+      uint8_t *elem = elems[i];
+      *(uint16_t *)elem = reqID + i;
 
       // This item does not have DMA transfer
-      if (index == IDX_NO_DMA) {
-        item->encodeElement(elems[i], reqID + i);
+      if (site.bufIndex == IDX_NO_DMA) {
         i++;
         continue;
       }
 
-      if ((uint32_t)index >= bufCount) {
-        LogError("No matching buffer for index {}, total buffers {}", index,
-                 bufCount);
+      if ((uint32_t)site.bufIndex >= bufCount) {
+        LogError("No matching buffer for index {}, total buffers {}",
+                 site.bufIndex, bufCount);
         return QS_INVAL;
       }
-      // updateElement returns false if the input buffer is not valid,
-      // say buffer smaller than required by metadata
-      if (!item->encodeElement(elems[i], reqID + i, bufs[index],
-                               needResponse)) {
-        LogError("Invalid user buffer");
-        return QS_INVAL;
+      if (site.addrWord != 0) {
+        // The buffer size must be no smaller than specified in metadata
+        const QBuffer &qbuf = bufs[site.bufIndex];
+        if (!qbuf.buf || qbuf.size < site.minSize) {
+          LogError("Invalid user buffer");
+          return QS_INVAL;
+        }
+        uint64_t addr = (uint64_t)qbuf.buf;
+        uint32_t *data = (uint32_t *)elem;
+        data[site.addrWord] = addr & 0xffffffff;
+        data[site.addrWord + 1] = addr >> 32;
       }
-      if (needResponse) {
+      if (site.needResponse) {
         last = reqID + i;
       }
       i++;
@@ -136,8 +171,14 @@ public:
       return QS_INVAL;
     }
 
+    // Size and offset are set by the caller for each inference
     for (uint32_t index = 0; index < num; index++) {
-      stencil_[start + index]->encodeMem(&attachSliceEntry[index]);
+      qaic_attach_slice_entry &entry = attachSliceEntry[index];
+      const uint64_t size = entry.size;
+      const uint64_t offset = entry.offset;
+      entry = sliceTemplate_[start + index];
+      entry.size = size;
+      entry.offset = offset;
     }
     return QS_SUCCESS;
   }
@@ -154,11 +195,41 @@ public:
     return ss.str();
   }
 
+  const std::vector<QDmaPatchSite> &getPatchSites() const {
+    return patchSites_;
+  }
+
 private:
+  void encodeTemplates() {
+    const uint32_t elemSize = QDmaRequestElement::getSize();
+    reqTemplate_.resize(stencil_.size() * elemSize);
+    sliceTemplate_.resize(stencil_.size());
+    patchSites_.resize(stencil_.size());
+    for (size_t i = 0; i < stencil_.size(); i++) {
+      QDmaRequestElement &item = *stencil_[i];
+      memcpy(&reqTemplate_[i * elemSize], item.getData(), elemSize);
+      item.encodeMem(&sliceTemplate_[i]);
+      QDmaPatchSite &site = patchSites_[i];
+      site.bufIndex = item.getBufIndex();
+      site.needResponse = item.isResponseRequired();
+      site.minSize = item.getDmaSize();
+      if (item.getDmaDirection() == DmaInbound) {
+        site.addrWord = 2;
+      } else if (item.getDmaDirection() == DmaOutbound) {
+        site.addrWord = 4;
+      }
+    }
+  }
+
   /// The stencil contains partially configrued request elements
   const QReqElemStencil stencil_;
   const uint32_t numBuf_;
   const QElemToBufVec elemToBufVec_;
+  /// Encoded stencil, one element after the other
+  std::vector<uint8_t> reqTemplate_;
+  /// Slices of the stencil, without size and offset
+  std::vector<qaic_attach_slice_entry> sliceTemplate_;
+  std::vector<QDmaPatchSite> patchSites_;
 };
 
 } // namespace qaic
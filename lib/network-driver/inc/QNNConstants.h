@@ -22,6 +22,8 @@ public:
 
   QStatus unload() override;
 
+  QStatus detach() override;
+
   QStatus loadConstantsAtOffset(const QBuffer &buf, uint64_t offset) override;
 
   ~QNNConstants() {}
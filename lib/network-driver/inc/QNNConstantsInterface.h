@@ -21,6 +21,11 @@ public:
   /// pointer to the object shall not be used again.
   virtual QStatus unload() = 0;
 
+  /// Release the object but keep the constants on the device, they are still
+  /// used by another holder, see QSharedImageRegistry. Same rules as
+  /// unload().
+  virtual QStatus detach() = 0;
+
   /// Load a segment of constants at specified offset.
   virtual QStatus loadConstantsAtOffset(const QBuffer &buf,
                                         uint64_t offset) = 0;
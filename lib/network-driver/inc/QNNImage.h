@@ -27,6 +27,8 @@ public:
 
   QStatus unload() override;
 
+  QStatus detach() override;
+
   QMetaDataInterface *getMetaData() const { return meta_.get(); }
 
   ~QNNImage() {}
@@ -21,6 +21,10 @@ public:
   /// pointer to the object shall not be used again.
   virtual QStatus unload() = 0;
 
+  /// Release the object but keep the image on the device, it is still used
+  /// by another holder, see QSharedImageRegistry. Same rules as unload().
+  virtual QStatus detach() = 0;
+
   virtual ~QNNImageInterface() = default;
 };
 
@@ -11,9 +11,16 @@
 #include "QNNConstantsInterface.h"
 #include "QActivationStateCmd.h"
 #include "QNNImageInterface.h"
+#include "QCompletionReactor.h"
+#include "QCompletionPoller.h"
+#include "QCompletionReaper.h"
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 
 namespace qaic {
@@ -55,6 +62,8 @@ private:
   bool hasPartialTensor_;
   // Local Data
   uint32_t numBufs_;
+  // Holds a submit scheduler grant from enqueue until completion
+  mutable std::atomic_bool schedGranted_{false};
 
   friend class QNeuralnetwork;
 };
@@ -72,13 +81,15 @@ public:
                                  uint32_t waitTimeoutMs,
                                  uint32_t numMaxWaitRetries);
 
-  ~QNeuralnetwork() = default;
+  ~QNeuralnetwork();
 
   /// Initialization should be called after construction
   virtual bool init() override;
 
   QStatus deactivate() override;
   virtual QStatus activateStateChange(QActivationStateType stateCmd) override;
+  virtual QStatus
+  setSubmitSchedParams(const QSubmitSchedParams &params) override;
   virtual std::shared_ptr<QInfHandle>
   getInfHandle(const QBuffer *bufs, uint32_t numBuf, const QDirection *bufDir,
                bool hasPartialTensor = false) const override;
@@ -89,6 +100,16 @@ public:
               const std::vector<uint64_t> &dmaBufferSizes) const override;
   virtual QStatus enqueueData(const QInfHandle *infHandle) override;
   virtual QStatus wait(const QInfHandle *infHandle) override;
+  virtual QStatus waitAsync(const QInfHandle *infHandle,
+                            QWaitCallback done) override;
+  virtual QStatus waitBusyPoll(const QInfHandle *infHandle,
+                               uint32_t spinBudgetUs) override;
+  virtual QStatus
+  waitUntil(const QInfHandle *infHandle,
+            std::chrono::steady_clock::time_point deadline) override;
+  virtual QStatus
+  waitBusyPollUntil(const QInfHandle *infHandle, uint32_t spinBudgetUs,
+                    std::chrono::steady_clock::time_point deadline) override;
   // Get buffers allocated in getInfHandle()
   virtual QStatus getInfBuffers(const QInfHandle *infHandle,
                                 std::vector<QBuffer> &bufs) const override;
@@ -101,6 +122,11 @@ public:
   virtual uint64_t getInfCount() const override { return infCount_; };
   virtual uint32_t getVcQueueSize() const override { return dbcFifoSize_; };
   virtual uint32_t getVcQueueLevel() const override;
+  virtual void getSubmitQueueStats(uint64_t &numSubmits,
+                                   uint64_t &numQueueFull) const override {
+    numSubmits = numSubmits_;
+    numQueueFull = numQueueFull_;
+  }
   virtual uint32_t getVcId() const override;
   virtual QStatus
   getExecProfilingData(const QInfHandle *infHandle,
@@ -131,6 +157,14 @@ private:
   QStatus prepareInfHandleBuf(qaic_create_bo *createBO, QBuffer &kbuf) const;
   void freeInfBuffers(uint8_t *boReqPtr, uint32_t reqProcessed,
                       std::vector<QBuffer> &kmdQBufs) const;
+  QStatus waitExec(const QInfHandle *infHandle, uint32_t timeoutMs);
+  QStatus startCompletionSource();
+  void stopCompletionSource();
+  void signalCompletions(QCompletionEvent event);
+  void completionThread();
+  void reapCompletions();
+  int getCompletionProbeFd();
+  void releaseSchedGrant(const QInfHandle *infHandle);
 
   // Constructor Arguments
   QDeviceInterface *dev_;
@@ -153,10 +187,42 @@ private:
   uint32_t dbcQueuedSize_;
   std::atomic<uint64_t> infCount_;
   shQDevInterface devInterface_;
+  // Feed back to the VC queue sizing of the next activation
+  std::atomic<uint64_t> numSubmits_{0};
+  std::atomic<uint64_t> numQueueFull_{0};
 
   // Uninitialized Locals
   std::condition_variable submitWaitCv_;
   std::mutex submitWaitMutex_;
+
+  // Inferences waited on asynchronously, in enqueue order
+  struct PendingWait {
+    const QInfHandle *infHandle;
+    QWaitCallback done;
+    std::chrono::steady_clock::time_point start;
+  };
+  QCompletionReaper<PendingWait> completionReaper_;
+  // Guards starting and stopping the completion source and thread
+  std::mutex pendingWaitsMutex_;
+  QCompletionReactorShared reactor_;
+  // Read by the reactor handler without the lock, 0 when the VC eventfd is
+  // not watched by this network
+  std::atomic<QCompletionSourceID> completionSourceId_{0};
+  // Timeout armed on the completion source while waits are pending
+  uint32_t completionTimeoutMs_ = 0;
+  // Reaps the waits and runs their callbacks, its kernel waits may block it
+  // but never a reactor thread
+  std::thread completionThread_;
+  // Set before the completion thread starts, nothing signals it
+  bool completionPolled_ = false;
+  QCompletionPoller completionPoller_;
+  // Edge triggered epoll on the VC eventfd, probes without draining it
+  std::once_flag probeOnce_;
+  int probeFd_ = -1;
+  // Submit scheduler of the device, null when not scheduled, kept after
+  // deactivate
+  QSubmitSchedulerShared scheduler_;
+  QSubmitClientID schedClientId_ = 0;
 };
 
 } // namespace qaic
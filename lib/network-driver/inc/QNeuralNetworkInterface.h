@@ -5,11 +5,17 @@
 #define QINEURAL_NETWORK_H
 
 #include "QActivationStateCmd.h"
+#include "QSubmitScheduler.h"
+
+#include <chrono>
+#include <functional>
 
 namespace qaic {
 
 struct QInfHandle;
 
+using QWaitCallback = std::function<void(QStatus)>;
+
 struct ExecProfilingData {
   ExecProfilingData()
       : isValid(false), queueDepth(0), numInfInQueue(0),
@@ -49,6 +55,11 @@ public:
 
   virtual QStatus activateStateChange(QActivationStateType stateCmd) = 0;
 
+  /// Schedules the submissions of this activation against those of the
+  /// other programs on the device. Called once, before the first
+  /// submission; without it submissions go straight to the device.
+  virtual QStatus setSubmitSchedParams(const QSubmitSchedParams &params) = 0;
+
   /// GetInfHandle
   virtual std::shared_ptr<QInfHandle>
   getInfHandle(const QBuffer *bufs, uint32_t numBuf, const QDirection *bufDir,
@@ -65,6 +76,30 @@ public:
   virtual ~QNeuralNetworkInterface() = default;
 
   virtual QStatus wait(const QInfHandle *infHandle) = 0;
+
+  /// Returns without blocking, \p done is called with the result of the
+  /// wait from the completion thread of the network, never from a shared
+  /// reactor thread. Inferences complete in the order they were enqueued.
+  virtual QStatus waitAsync(const QInfHandle *infHandle,
+                            QWaitCallback done) = 0;
+
+  /// Same as wait() but spins on the completion for up to \p spinBudgetUs
+  /// before blocking, for latency critical single stream use
+  virtual QStatus waitBusyPoll(const QInfHandle *infHandle,
+                               uint32_t spinBudgetUs) = 0;
+
+  /// Same as wait() but returns QS_DEADLINE_EXCEEDED once \p deadline
+  /// passed. The inference then is still in flight, it must be waited for
+  /// again before its handle is submitted again.
+  virtual QStatus
+  waitUntil(const QInfHandle *infHandle,
+            std::chrono::steady_clock::time_point deadline) = 0;
+
+  /// Same as waitUntil() but spins first as waitBusyPoll() does, for no
+  /// longer than is left until \p deadline
+  virtual QStatus
+  waitBusyPollUntil(const QInfHandle *infHandle, uint32_t spinBudgetUs,
+                    std::chrono::steady_clock::time_point deadline) = 0;
   // Get buffers allocated in getInfHandle()
 
   virtual QStatus getInfBuffers(const QInfHandle *infHandle,
@@ -77,6 +112,10 @@ public:
   virtual uint64_t getInfCount() const = 0;
   virtual uint32_t getVcQueueSize() const = 0;
   virtual uint32_t getVcQueueLevel() const = 0;
+  /// Submissions of this activation, and those of them that found the VC
+  /// queue full and waited for room
+  virtual void getSubmitQueueStats(uint64_t &numSubmits,
+                                   uint64_t &numQueueFull) const = 0;
   virtual uint32_t getVcId() const = 0;
   virtual QStatus
   getExecProfilingData(const QInfHandle *infHandle,
@@ -46,6 +46,13 @@ public:
   [[nodiscard]] QNNConstantsInterface *
   loadConstantsEx(QID deviceID, const QBuffer &constDescBuf, const char *name,
                   QStatus &status) override;
+  [[nodiscard]] QNNImageInterface *attachImage(QID deviceID,
+                                               const QBuffer &buf,
+                                               QNNImageID imageID,
+                                               QStatus &status) override;
+  [[nodiscard]] QNNConstantsInterface *
+  attachConstants(QID deviceID, QNNConstantsID constantsID,
+                  QStatus &status) override;
   [[nodiscard]] QNeuralNetworkInterface *activateNetwork(
       QNNImageInterface *image, QNNConstantsInterface *constants,
       QStatus &status,
@@ -53,7 +60,9 @@ public:
       uint32_t waitTimeoutMs =
           QAIC_PROGRAM_PROPERTIES_SUBMIT_TIMEOUT_MS_DEFAULT,
       uint32_t numMaxWaitRetries =
-          QAIC_PROGRAM_PROPERTIES_SUBMIT_NUM_RETRIES_DEFAULT) override;
+          QAIC_PROGRAM_PROPERTIES_SUBMIT_NUM_RETRIES_DEFAULT,
+      uint32_t inferencesInFlight =
+          QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT) override;
 
   [[nodiscard]] QStatus sendActivationStateChangeCommand(
       QID deviceID,
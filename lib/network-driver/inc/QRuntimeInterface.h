@@ -49,6 +49,19 @@ public:
   loadConstantsEx(QID deviceID, const QBuffer &constDescBuf, const char *name,
                   QStatus &status) = 0;
 
+  /// Wrap network image \p imageID already loaded into device \p deviceID,
+  /// e.g. by another process, without loading it again. \p buf is the same
+  /// network image that was loaded, its metadata is parsed for activation.
+  [[nodiscard]] virtual QNNImageInterface *
+  attachImage(QID deviceID, const QBuffer &buf, QNNImageID imageID,
+              QStatus &status) = 0;
+
+  /// Wrap constants \p constantsID already loaded into device \p deviceID,
+  /// e.g. by another process, without loading them again.
+  [[nodiscard]] virtual QNNConstantsInterface *
+  attachConstants(QID deviceID, QNNConstantsID constantsID,
+                  QStatus &status) = 0;
+
   /// Activate a network with preloaded \p image and \p constants.
   /// The \p status is an output parameter. The return value is a pointer
   /// to QNeuralNetworkInterface object. The pointer is valid only when status
@@ -56,6 +69,8 @@ public:
   /// QS_SUCCESS. Caller MUST NOT delete the pointer at the end of
   /// inference, but rather call QNeuralNetworkInterface::deactivate() instead.
   /// Optional parameters:
+  /// \p inferencesInFlight sizes the VC queue to hold that many inferences
+  /// of the image, see QVCQueueSizing.
   [[nodiscard]] virtual QNeuralNetworkInterface *activateNetwork(
       QNNImageInterface *image, QNNConstantsInterface *constants,
       QStatus &status,
@@ -63,7 +78,9 @@ public:
       uint32_t waitTimeoutMs =
           QAIC_PROGRAM_PROPERTIES_SUBMIT_TIMEOUT_MS_DEFAULT,
       uint32_t numMaxWaitRetries =
-          QAIC_PROGRAM_PROPERTIES_SUBMIT_NUM_RETRIES_DEFAULT) = 0;
+          QAIC_PROGRAM_PROPERTIES_SUBMIT_NUM_RETRIES_DEFAULT,
+      uint32_t inferencesInFlight =
+          QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT) = 0;
 
   [[nodiscard]] virtual QStatus sendActivationStateChangeCommand(
       QID deviceID,
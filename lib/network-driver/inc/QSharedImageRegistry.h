@@ -0,0 +1,199 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QSHARED_IMAGE_REGISTRY_H
+#define QSHARED_IMAGE_REGISTRY_H
+
+#include "QAicRuntimeTypes.h"
+#include "QLogger.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace qaic {
+
+class QMonitorNamedMutex;
+
+enum class QSharedImageKind : uint32_t {
+  Constants = 1,
+  NetworkImage = 2,
+};
+
+/// Identifies a load by its content, equal keys are loads of the same bytes
+/// on the same device. Other processes attach to what the key names, so
+/// the digest must be cryptographic.
+struct QSharedImageKey {
+  QID qid = 0;
+  QSharedImageKind kind = QSharedImageKind::Constants;
+  /// SHA-256 of the content
+  std::array<uint8_t, 32> digest = {};
+  uint64_t size = 0;
+};
+
+/// What the caller of QSharedImageRegistry::acquire() is to do
+enum class QSharedImageClaim {
+  /// Loaded by this or another process, attach to the returned ID
+  Reuse,
+  /// Not loaded yet, the caller loads it and then calls publish(), or
+  /// abandon() if the load failed
+  Load,
+  /// The registry can not track the load, the caller loads it for itself
+  /// and does not release it to the registry
+  Private,
+};
+
+/// Registry of the network images and constants loaded on the devices of the
+/// host, shared by all processes of a user opening it under the same name.
+/// The registry is created private to the user and not opened when it is
+/// owned by another user or accessible to others. A process
+/// about to load a QPC looks its content up by digest and attaches to the IDs
+/// another process already loaded instead of uploading its own copy. Loads
+/// are reference counted per process, the last process releasing one
+/// unloads it.
+///
+/// The registry lives in shared memory and is serialized between processes
+/// by a QMonitorNamedMutex. Processes that exit without releasing are pruned
+/// the next time the entry is looked at, as are entries that do not hold
+/// together. The device reclaims the loads of a process when it exits, so
+/// an entry is dropped once the process that loaded it is gone. Its holders
+/// find out with isLoaded(), or from a watch() while the load is in service,
+/// and acquire the content again, the first one loads it and the others
+/// attach to that load.
+class QSharedImageRegistry : public QLogger {
+public:
+  static constexpr uint32_t maxEntries = 256;
+  /// Processes holding one entry at once
+  static constexpr uint32_t maxHolders = 64;
+
+  /// Called from the watch thread of the registry, at most once per watch
+  using LostCallback = std::function<void()>;
+
+  explicit QSharedImageRegistry(std::string name);
+  ~QSharedImageRegistry();
+
+  QSharedImageRegistry(const QSharedImageRegistry &) = delete;
+  QSharedImageRegistry &operator=(const QSharedImageRegistry &) = delete;
+
+  /// Opens the registry, creating it if this is the first process
+  QStatus init();
+
+  /// Takes a reference on \p key for this process. While another process
+  /// is loading the same content, waits up to \p loadWait for it to finish.
+  /// \p id is set with \p claim Reuse.
+  QStatus acquire(const QSharedImageKey &key, QSharedImageClaim &claim,
+                  uint32_t &id, std::chrono::milliseconds loadWait);
+
+  /// Makes a load claimed with QSharedImageClaim::Load available to others
+  QStatus publish(const QSharedImageKey &key, uint32_t id);
+
+  /// Gives up a load claimed with QSharedImageClaim::Load
+  QStatus abandon(const QSharedImageKey &key);
+
+  /// Returns a reference of acquire() on the load \p id. \p lastHolder is
+  /// set when no process holds the load anymore, the caller then unloads it
+  /// from the device. QS_INVAL once the loader of \p id exited.
+  QStatus release(const QSharedImageKey &key, uint32_t id, bool &lastHolder);
+
+  /// False once the load \p id is gone from the device with the process
+  /// that loaded it, its holders then acquire \p key again
+  bool isLoaded(const QSharedImageKey &key, uint32_t id);
+
+  /// References held on \p key by all processes
+  uint32_t getNumHolders(const QSharedImageKey &key);
+
+  /// Calls \p onLost once isLoaded() turns false for the load \p id, checked
+  /// every watch interval by a thread of the registry. \return Handle for
+  /// unwatch(), 0 if the registry is not open
+  uint64_t watch(const QSharedImageKey &key, uint32_t id,
+                 LostCallback onLost);
+
+  /// Stops a watch. Waits for its callback to return when it is running on
+  /// another thread, so the callback may not call unwatch() while holding a
+  /// lock the caller of unwatch() holds.
+  void unwatch(uint64_t handle);
+
+  /// Time between two checks of the watches, 100 ms unless set
+  void setWatchInterval(std::chrono::milliseconds interval);
+
+  const std::string &getName() const { return name_; }
+
+  /// Removes the registry from the host, processes that have it open keep
+  /// using their mapping
+  static QStatus unlink(const std::string &name);
+
+private:
+  struct Table;
+  struct Entry;
+
+  /// Holds both the process and the host lock, the named mutex does not
+  /// serialize threads of one process
+  class Lock {
+  public:
+    explicit Lock(QSharedImageRegistry &registry);
+    ~Lock();
+
+  private:
+    QSharedImageRegistry &registry_;
+    std::lock_guard<std::mutex> guard_;
+  };
+
+  struct Watch {
+    QSharedImageKey key;
+    uint32_t id;
+    LostCallback onLost;
+  };
+
+  static bool isValid(const Entry &entry);
+  Entry *find(const QSharedImageKey &key);
+  void prune(Entry &entry);
+  void watchThread();
+
+  std::string name_;
+  std::mutex mutex_;
+  std::unique_ptr<QMonitorNamedMutex> namedMutex_;
+  int shmDesc_ = -1;
+  Table *table_ = nullptr;
+
+  // Guards the watches, started with the first one
+  std::mutex watchMutex_;
+  std::condition_variable watchCv_;
+  std::map<uint64_t, Watch> watches_;
+  uint64_t nextWatch_ = 1;
+  // Watch whose callback is running, 0 for none
+  uint64_t firing_ = 0;
+  bool stopping_ = false;
+  std::chrono::milliseconds watchInterval_;
+  std::thread watchThread_;
+};
+
+/// Owner of the registry of the process
+class QSharedImageRegistryManager {
+public:
+  /// The registry named by QAIC_SHARED_IMAGE_REGISTRY, processes setting
+  /// the same name share their loads. nullptr if not set or the registry
+  /// could not be opened, loads are then private to the process. Its
+  /// watches are checked every QAIC_SHARED_IMAGE_WATCH_MS.
+  static QSharedImageRegistry *getRegistry();
+
+  /// Wait for a load of another process, QAIC_SHARED_IMAGE_LOAD_WAIT_MS
+  static std::chrono::milliseconds getLoadWait();
+
+private:
+  static std::unique_ptr<QSharedImageRegistry> registry_;
+  static std::chrono::milliseconds loadWait_;
+  static std::chrono::milliseconds watchInterval_;
+  static bool initialized_;
+  static std::mutex m_;
+};
+
+} // namespace qaic
+
+#endif // QSHARED_IMAGE_REGISTRY_H
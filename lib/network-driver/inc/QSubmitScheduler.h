@@ -0,0 +1,154 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QSUBMIT_SCHEDULER_H
+#define QSUBMIT_SCHEDULER_H
+
+#include "QAicRuntimeTypes.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace qaic {
+
+/// Scheduling parameters of one program sharing a device
+struct QSubmitSchedParams {
+  /// QAicSchedPriority, lower values are served first
+  uint32_t priority = static_cast<uint32_t>(
+      QAicSchedPriority::QAIC_SCHED_PRIORITY_NORMAL);
+  /// Share of the device among programs of the same priority, 0 is taken as 1
+  uint32_t weight = QAIC_PROGRAM_PROPERTIES_SCHED_WEIGHT_DEFAULT;
+  /// Inferences of the program on the device at once, 0 is unlimited
+  uint32_t maxInFlight = 0;
+  /// Wait after which a submission is served ahead of higher priorities,
+  /// 0 never
+  uint32_t maxWaitUs = QAIC_PROGRAM_PROPERTIES_SCHED_MAX_WAIT_US_DEFAULT;
+  /// Device budget asked by the program, 0 asks for none
+  uint32_t deviceInFlight = 0;
+  /// Inferences the VC queue of the program is sized for, derives a device
+  /// budget when none is set, see QSubmitScheduler. 0 derives none.
+  uint32_t queueInFlight = 0;
+
+  /// Asks for an order other than plain first come first served
+  bool isOrdered() const {
+    return (priority != static_cast<uint32_t>(
+                            QAicSchedPriority::QAIC_SCHED_PRIORITY_NORMAL)) ||
+           (weight != QAIC_PROGRAM_PROPERTIES_SCHED_WEIGHT_DEFAULT);
+  }
+};
+
+using QSubmitClientID = uint64_t;
+
+class QSubmitScheduler;
+using QSubmitSchedulerShared = std::shared_ptr<QSubmitScheduler>;
+
+/// Orders the submissions of the programs sharing a device. Each program
+/// registers as a client, takes a grant before submitting an inference and
+/// returns it once the inference completed or failed to submit.
+///
+/// Grants go to the highest priority class with waiting submissions, and
+/// within a class by start time fair queueing on the client weights: each
+/// grant advances the virtual time of its client by the inverse of its
+/// weight, the client with the smallest virtual time is served next. A
+/// client becoming busy again starts at the current virtual time, idle time
+/// is not banked. A client whose submissions waited longer than its
+/// maxWaitUs gets one served before any priority, and then waits again.
+///
+/// With a device budget, at most that many inferences of all clients are on
+/// the device at once, which is what keeps a bulk program from filling the
+/// device ahead of an interactive one. The budget is the smallest one asked
+/// by a client, else the default of the scheduler. Without either nothing
+/// waits for a grant, so priorities and weights would order nothing: once a
+/// client asks for a priority or weight other than the default, the budget
+/// is derived as the deepest VC queue of the clients. One program alone
+/// still fills its queue, several no longer fill theirs all at once.
+/// Without any of this, which is the default, only the per client caps hold
+/// submissions back.
+class QSubmitScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// \p deviceInFlight is the device budget while no client asks for one,
+  /// 0 is unlimited
+  explicit QSubmitScheduler(uint32_t deviceInFlight = 0)
+      : defaultDeviceInFlight_(deviceInFlight),
+        deviceInFlight_(deviceInFlight) {}
+
+  QSubmitScheduler(const QSubmitScheduler &) = delete;
+  QSubmitScheduler &operator=(const QSubmitScheduler &) = delete;
+
+  QStatus addClient(const QSubmitSchedParams &params, QSubmitClientID &id);
+
+  /// Grants still held by the client are returned and its waiting
+  /// submissions fail with QS_CANCELED
+  QStatus removeClient(QSubmitClientID id);
+
+  /// Blocks until the client may submit one inference.
+  /// \returns QS_TIMEDOUT if not granted within \p timeout, QS_CANCELED if
+  /// the client was removed meanwhile
+  QStatus acquire(QSubmitClientID id, std::chrono::microseconds timeout);
+
+  /// Returns a grant of acquire()
+  QStatus release(QSubmitClientID id);
+
+  uint32_t getDeviceInFlight() const;
+  uint32_t getNumInFlight() const;
+  uint32_t getNumInFlight(QSubmitClientID id) const;
+  size_t getNumClients() const;
+
+private:
+  struct Waiter {
+    Clock::time_point enqueued;
+    bool granted = false;
+    bool canceled = false;
+  };
+
+  struct Client {
+    QSubmitSchedParams params;
+    /// Virtual time of the next grant, in 1/weightScale units
+    uint64_t virtualTime = 0;
+    uint32_t inFlight = 0;
+    Clock::time_point lastDispatched;
+    std::deque<Waiter *> waiters;
+  };
+
+  /// Virtual time a grant of a weight 1 client takes
+  static constexpr uint64_t weightScale = 1 << 16;
+
+  bool canGrant(const Client &client) const;
+  void grant(Client &client);
+  void dispatch(Clock::time_point now);
+  void updateDeviceInFlight();
+
+  const uint32_t defaultDeviceInFlight_;
+  uint32_t deviceInFlight_;
+  mutable std::mutex mutex_;
+  std::condition_variable grantCv_;
+  // Ordered so that ties are broken the same way on every dispatch
+  std::map<QSubmitClientID, Client> clients_;
+  QSubmitClientID nextId_ = 1;
+  uint32_t numInFlight_ = 0;
+  size_t numWaiters_ = 0;
+  uint64_t virtualTime_ = 0;
+};
+
+/// Owner of the submit scheduler of each device of the process
+class QSubmitSchedulerManager {
+public:
+  /// The device budget is read from QAIC_SCHED_DEVICE_INFLIGHT
+  static QSubmitSchedulerShared getScheduler(QID qid);
+
+private:
+  static std::unordered_map<QID, QSubmitSchedulerShared> schedulers_;
+  static std::mutex m_;
+};
+
+} // namespace qaic
+
+#endif // QSUBMIT_SCHEDULER_H
@@ -0,0 +1,86 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QVC_QUEUE_SIZING_H
+#define QVC_QUEUE_SIZING_H
+
+#include "QAicRuntimeTypes.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace qaic {
+
+/// Queue size of a VC when nothing is known of the program, also the
+/// smallest queue an activation gets
+constexpr uint32_t DefaultVCQueueSizePow2 = 9; // 512
+/// Bounds the queue memory the KMD allocates for an activation,
+/// 64 byte request elements plus response elements
+constexpr uint32_t MaxVCQueueSizePow2 = 15; // 32768
+/// Upper bound of the in flight target reached by tuning
+constexpr uint32_t MaxVCQueueInferencesInFlight = 1024;
+
+/// Sizes the VC queue of an activation. Every queued inference takes the
+/// request elements of the program stencil in the queue, so the queue must
+/// hold stencil size times the number of inferences the application keeps
+/// in flight. A fixed size starves small programs of pipelining depth and
+/// cannot hold even one inference of a program with a huge stencil.
+///
+/// The queue size is fixed once activated. Submissions that found the queue
+/// full are fed back with observe(), and the next activation of the program
+/// gets room for more inferences.
+class QVCQueueSizing {
+public:
+  /// Share of submissions finding the queue full, in percent, above which
+  /// the in flight target doubles
+  static constexpr uint64_t queueFullGrowPercent = 1;
+
+  explicit QVCQueueSizing(
+      uint32_t inferencesInFlight =
+          QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT)
+      : inferencesInFlight_(
+            std::min(inferencesInFlight != 0
+                         ? inferencesInFlight
+                         : QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT,
+                     MaxVCQueueInferencesInFlight)) {}
+
+  /// \returns log2 of the queue size holding \p inferencesInFlight
+  /// inferences of \p reqElementsPerInference request elements each. Never
+  /// below the default size, never above the largest size, a stencil that
+  /// does not fit the largest queue gets the largest queue.
+  static uint32_t sizePow2(uint32_t reqElementsPerInference,
+                           uint32_t inferencesInFlight) {
+    const uint64_t needed = static_cast<uint64_t>(reqElementsPerInference) *
+                            std::max(inferencesInFlight, 1u);
+    uint32_t pow2 = DefaultVCQueueSizePow2;
+    while ((pow2 < MaxVCQueueSizePow2) && ((uint64_t(1) << pow2) < needed)) {
+      pow2++;
+    }
+    return pow2;
+  }
+
+  /// \returns log2 of the queue size for the current in flight target
+  uint32_t getSizePow2(uint32_t reqElementsPerInference) const {
+    return sizePow2(reqElementsPerInference, inferencesInFlight_);
+  }
+
+  uint32_t getInferencesInFlight() const { return inferencesInFlight_; }
+
+  /// Feed back an activation that made \p numSubmits submissions, of which
+  /// \p numQueueFull found the queue full and waited for room
+  void observe(uint64_t numSubmits, uint64_t numQueueFull) {
+    if ((numSubmits == 0) ||
+        (numQueueFull * 100 <= numSubmits * queueFullGrowPercent)) {
+      return;
+    }
+    inferencesInFlight_ =
+        std::min(inferencesInFlight_ * 2, MaxVCQueueInferencesInFlight);
+  }
+
+private:
+  uint32_t inferencesInFlight_;
+};
+
+} // namespace qaic
+
+#endif // QVC_QUEUE_SIZING_H
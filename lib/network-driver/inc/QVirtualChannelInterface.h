@@ -82,6 +82,10 @@ public:
 
   virtual uint32_t getQueueSize() const { return queueSize_; }
 
+  /// Descriptor that becomes readable when the channel has completions,
+  /// or -1 if the backend does not signal completions
+  virtual int getEventFd() const { return -1; }
+
 protected:
   /// The QID of the device the virtual channels belongs to.
   /// In this class the i
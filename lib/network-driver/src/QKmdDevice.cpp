@@ -15,9 +15,11 @@
 #include "elfio/elfio.hpp"
 
 #include <fcntl.h>
+#include <sys/eventfd.h>
 #include <sstream>
 #include <unistd.h>
 #include <memory>
+#include <algorithm>
 #include <cstdlib>
 
 uint32_t globalImgFormat = 0; // 0=ELF, 1=BIN
@@ -28,7 +30,6 @@ const uint32_t NncImageTag = 100;
 const uint32_t NncMetaTag = 200;
 const uint32_t NncConstantsTag = 300;
 const uint32_t MaxVCID = 15;
-const uint32_t DefaultVCQueueSizePow2 = 9; // 512
 // The size of the gap between request and response queues
 const uint32_t QueueBufDMZSize = 0xFF;
 // The alignment boundary for the buffer of request+response queues
@@ -442,11 +443,12 @@ QStatus QKmdDevice::loadConstantsAtOffset(QNNConstantsID constantsID,
 QStatus QKmdDevice::activate(QNNImageID imageID, QNNConstantsID constantsID,
                              QNAID &naID, uint64_t &ddrBase, uint64_t &mcIDBase,
                              QVirtualChannelInterface **vc,
-                             QActivationStateType initialState) {
+                             QActivationStateType initialState,
+                             uint32_t queueSizePow2) {
   QStatus status = QS_SUCCESS;
-  uint32_t qSizePow2 = DefaultVCQueueSizePow2;
+  uint32_t qSizePow2 = std::min(queueSizePow2, MaxVCQueueSizePow2);
 
-  int efd = QOsal::eventfd(0, 0);
+  int efd = QOsal::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
   if (efd == -1) {
     LogError("Device {} failed to create eventfd: {}", devID_,
              QOsal::strerror_safe(errno));
@@ -651,24 +653,26 @@ QStatus QKmdDevice::sendActivationStateChangeCommand(
 
 QStatus QKmdDevice::createVC(QVCID vcid, int efd, QVirtualChannelInterface **vc,
                              uint32_t qSizePow2) {
-  if (efd >= 0)
-    close(efd);
   VCDeleter deleter = [=](QVirtualChannelInterface *vc) { delete vc; };
   QStatus status = QS_SUCCESS;
 
   std::unique_lock<std::mutex> lock(vcMapMutex_);
   if (vcMap_.find(vcid) == vcMap_.end()) {
+    // The VC keeps the eventfd the KMD signals completions on
     std::unique_ptr<QVirtualChannelInterface, VCDeleter> vcBackend =
         vcFactory_->makeVC(devID_, vcid, nullptr, nullptr, qSizePow2, deleter,
-                           nullptr);
+                           &efd);
     *vc = vcBackend.get();
     vcMap_[vcid] = std::move(vcBackend);
+    return status;
   } else if (vcid == NNC_VC_RESERVATION_ID_SKIP) {
     *vc = vcMap_[vcid].get();
   } else {
     LogError("Duplicate vcid");
     status = QS_ERROR;
   }
+  if (efd >= 0)
+    close(efd);
 
   return status;
 }
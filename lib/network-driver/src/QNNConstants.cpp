@@ -18,6 +18,14 @@ QStatus QNNConstants::unload() {
   return status;
 }
 
+QStatus QNNConstants::detach() {
+  if (refCnt_ != 0) {
+    return QS_BUSY;
+  }
+  delete this;
+  return QS_SUCCESS;
+}
+
 QStatus QNNConstants::loadConstantsAtOffset(const QBuffer &buf,
                                             uint64_t offset) {
 
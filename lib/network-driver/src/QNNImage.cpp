@@ -17,4 +17,12 @@ QStatus QNNImage::unload() {
   return status;
 }
 
+QStatus QNNImage::detach() {
+  if (refCnt_ != 0) {
+    return QS_BUSY;
+  }
+  delete this;
+  return QS_SUCCESS;
+}
+
 } // namespace qaic
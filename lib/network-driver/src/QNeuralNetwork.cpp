@@ -4,6 +4,7 @@
 #include "QNeuralNetwork.h"
 #include "QDmaElement.h"
 #include "QDeviceInterface.h"
+#include "QFlightRecorder.h"
 #include "QVirtualChannelInterface.h"
 #include "QLogger.h"
 #include "QMetaData.h"
@@ -12,10 +13,16 @@
 #include "QUtil.h"
 #include "QDevAic100Interface.h"
 #include "QKmdDevice.h"
+#include "QNumaTopology.h"
 #include "QOsal.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
 #include <chrono>
 #include <memory>
+#include <system_error>
 #include <thread>
 #include <vector>
 
@@ -24,6 +31,13 @@
 namespace qaic {
 
 constexpr uint16_t deactivationRetryCount = 5;
+// Kernel wait of the completion thread when nothing signals it, it returns
+// as soon as the head completes. Bounds how long stopping the thread takes.
+constexpr uint32_t completionPollWaitMs = 100;
+// Kernel wait used while reaping, the head of the queue is normally done
+constexpr uint32_t completionReapTimeoutMs = 1;
+// The KMD waits this long when no wait timeout is given
+constexpr uint32_t kmdDefaultWaitTimeoutMs = 5000;
 //
 // QInfHandle
 //
@@ -204,6 +218,12 @@ std::shared_ptr<QInfHandle> QNeuralnetwork::createInfHandle(std::unique_ptr<uint
     case QBufferType::QBUFFER_TYPE_HEAP:
       attachSliceEntry[attachSliceEntryProcessed].offset = offset;
       break;
+    case QBufferType::QBUFFER_TYPE_DMABUF:
+      // The imported BO spans the whole dma-buf, slices are relative to the
+      // start of the caller's region within it
+      attachSliceEntry[attachSliceEntryProcessed].offset =
+          offset + kmdQBufs[bufIndex].offset;
+      break;
     default:
       LogError("QBuffer type is not supported");
       freeInfBuffers(boReqPtr, reqProcessed, kmdQBufs);
@@ -229,6 +249,9 @@ std::shared_ptr<QInfHandle> QNeuralnetwork::createInfHandle(std::unique_ptr<uint
       attachSlice->hdr.handle = 0;
       attachSlice->hdr.dir = static_cast<uint32_t>(dirs[i]);
       attachSlice->hdr.size = size ? kmdQBufs[bufIndex].size : size;
+      if (size && (kmdQBufs[bufIndex].type == QBufferType::QBUFFER_TYPE_DMABUF)) {
+        attachSlice->hdr.size += kmdQBufs[bufIndex].offset;
+      }
       attachSlice->data = (uint64_t)attachSliceEntry;
 
       QBuffer zero_buf{0, NULL, 0, 0, QBufferType::QBUFFER_TYPE_HEAP};
@@ -419,12 +442,21 @@ QNeuralnetwork::loadData(const QInfHandle *infHandle,
       continue;
     }
 
-    if ((bufs[i].type != QBufferType::QBUFFER_TYPE_HEAP) ||
+    if ((bufs[i].type != infHandle->kmdQBufs_[i].type) ||
         infHandle->kmdQBufs_[i].size != bufs[i].size) {
       LogError("Invalid Buffer Size at index {} Size:{}, expected:{}", i,
                bufs[i].size, infHandle->kmdQBufs_[i].size);
       return QS_INVAL;
     }
+    if (bufs[i].type == QBufferType::QBUFFER_TYPE_DMABUF) {
+      // Registered dma-buf, the device reads it in place
+      if ((bufs[i].handle != infHandle->kmdQBufs_[i].handle) ||
+          (bufs[i].offset != infHandle->kmdQBufs_[i].offset)) {
+        LogError("dma-buf at index {} is not the one registered", i);
+        return QS_INVAL;
+      }
+      continue;
+    }
     if ((bufs[i].size > 0) && (bufs[i].buf != nullptr)) {
       memcpy(infHandle->kmdQBufs_[i].buf, bufs[i].buf, bufs[i].size);
     } else {
@@ -477,11 +509,62 @@ QNeuralnetwork::enqueueData(const QInfHandle *infHandle) {
   if (infHandle == nullptr) {
     return QS_INVAL;
   }
+  if (scheduler_ != nullptr) {
+    // Wait for the turn of this program as long as a submitted inference
+    // may take to complete
+    const uint32_t waitTimeoutMs =
+        (waitTimeoutMs_ != 0) ? waitTimeoutMs_ : kmdDefaultWaitTimeoutMs;
+    ret = scheduler_->acquire(schedClientId_,
+                              std::chrono::milliseconds(waitTimeoutMs) *
+                                  (numMaxWaitRetries_ + 1));
+    if (ret != QS_SUCCESS) {
+      LogWarn("Dev {} VC {} NAID {} not scheduled to submit: {}",
+              (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(), naID_, ret);
+      // Canceled when the activation went away while waiting
+      return (ret == QS_CANCELED) ? QS_CANCELED : QS_BUSY;
+    }
+    infHandle->schedGranted_ = true;
+  }
   ret = runExecute(
       infHandle, reinterpret_cast<const qaic_execute *>(infHandle->execute_.get()),
       infHandle->hasPartialTensor_);
-  if (ret != QS_SUCCESS)
+  if (ret != QS_SUCCESS) {
+    releaseSchedGrant(infHandle);
     return ret;
+  }
+  return QS_SUCCESS;
+}
+
+void QNeuralnetwork::releaseSchedGrant(const QInfHandle *infHandle) {
+  if ((scheduler_ != nullptr) && infHandle->schedGranted_.exchange(false)) {
+    (void)scheduler_->release(schedClientId_);
+  }
+}
+
+QStatus
+QNeuralnetwork::setSubmitSchedParams(const QSubmitSchedParams &params) {
+  if (scheduler_ != nullptr) {
+    return QS_INVAL;
+  }
+  QSubmitSchedulerShared scheduler =
+      QSubmitSchedulerManager::getScheduler(dev_->getID());
+  QStatus status = scheduler->addClient(params, schedClientId_);
+  if (status != QS_SUCCESS) {
+    return status;
+  }
+  const uint32_t deviceInFlight = scheduler->getDeviceInFlight();
+  LogInfo("Dev {} VC {} NAID {} scheduled with priority {} weight {} "
+          "max in flight {} max wait {}us, device budget {}",
+          (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(), naID_,
+          params.priority, params.weight, params.maxInFlight,
+          params.maxWaitUs, deviceInFlight);
+  if (params.isOrdered() && (deviceInFlight == 0)) {
+    LogWarn("Dev {} VC {} NAID {} priority {} and weight {} have no effect "
+            "without a device budget",
+            (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(), naID_,
+            params.priority, params.weight);
+  }
+  scheduler_ = std::move(scheduler);
   return QS_SUCCESS;
 }
 
@@ -491,7 +574,6 @@ QNeuralnetwork::enqueueData(const QInfHandle *infHandle) {
 
 QStatus QNeuralnetwork::wait(const QInfHandle *infHandle) {
   QStatus status = QS_SUCCESS;
-  qaic_wait wait = {};
   uint32_t retries = 0;
 
   if (infHandle == nullptr) {
@@ -502,33 +584,352 @@ QStatus QNeuralnetwork::wait(const QInfHandle *infHandle) {
     return QS_INVAL;
   }
 
-  wait.handle = infHandle->waitHandle_;
-  wait.timeout = waitTimeoutMs_;
-  wait.dbc_id = vc_->getVC();
-
+  qFlightRecord(QFlightEventType::WaitStart, dev_->getID(), vc_->getVC(),
+                infHandle->waitHandle_);
   while (1) {
-    if (devInterface_->runDevCmd(QAIC_DEV_CMD_WAIT_EXEC, &wait) != QS_SUCCESS) {
-      if ((errno == ETIMEDOUT) && (++retries <= numMaxWaitRetries_)) {
+    status = waitExec(infHandle, waitTimeoutMs_);
+    if (status != QS_SUCCESS) {
+      if ((status == QS_TIMEDOUT) && (++retries <= numMaxWaitRetries_)) {
         LogWarn(
             "Dev {} VC {} wait handle {} Kernel wait timeout, retries:{} of {}",
             (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(),
             infHandle->waitHandle_, retries, numMaxWaitRetries_);
         continue;
       }
-      LogError("Dev {} VC {} failed to send wait exec IOCTL: {} ",
-               (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(),
-               QOsal::strerror_safe(errno));
       status = QS_ERROR;
       break;
     } else {
       break;
     }
   }
+  qFlightRecord(QFlightEventType::WaitEnd, dev_->getID(),
+                infHandle->waitHandle_, status);
+  if (status != QS_SUCCESS) {
+    (void)QFlightRecorderManager::dumpOnError("wait failed");
+  }
+
+  releaseSchedGrant(infHandle);
+  submitWaitCv_.notify_one(); // Notify any thread waiting for space in Queue
+  return status;
+}
+
+QStatus
+QNeuralnetwork::waitUntil(const QInfHandle *infHandle,
+                          std::chrono::steady_clock::time_point deadline) {
+  QStatus status = QS_SUCCESS;
+  uint32_t retries = 0;
+
+  if (infHandle == nullptr) {
+    return QS_INVAL;
+  } else if (infHandle->waitHandle_ <= 0) {
+    LogError("Dev {} VC {} invalid wait handle ", (uint32_t)dev_->getID(),
+             (uint32_t)vc_->getVC());
+    return QS_INVAL;
+  }
+
+  const uint32_t waitTimeoutMs =
+      (waitTimeoutMs_ != 0) ? waitTimeoutMs_ : kmdDefaultWaitTimeoutMs;
+  qFlightRecord(QFlightEventType::WaitStart, dev_->getID(), vc_->getVC(),
+                infHandle->waitHandle_);
+  while (1) {
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      // Still in flight, the grant is returned once it is waited for
+      qFlightRecord(QFlightEventType::WaitEnd, dev_->getID(),
+                    infHandle->waitHandle_, QS_DEADLINE_EXCEEDED);
+      return QS_DEADLINE_EXCEEDED;
+    }
+    // Kernel waits are in ms, round up so the deadline is not missed by a
+    // wait returning just before it
+    auto remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           deadline - now + std::chrono::microseconds(999))
+                           .count();
+    uint32_t timeoutMs = static_cast<uint32_t>(
+        std::min<int64_t>(std::max<int64_t>(remainingMs, 1), waitTimeoutMs));
+    status = waitExec(infHandle, timeoutMs);
+    if (status == QS_TIMEDOUT) {
+      // Only full kernel timeouts count against the retries of wait()
+      if ((timeoutMs == waitTimeoutMs) &&
+          (++retries > numMaxWaitRetries_)) {
+        status = QS_ERROR;
+        break;
+      }
+      continue;
+    }
+    if (status != QS_SUCCESS) {
+      status = QS_ERROR;
+    }
+    break;
+  }
+  qFlightRecord(QFlightEventType::WaitEnd, dev_->getID(),
+                infHandle->waitHandle_, status);
+  if (status != QS_SUCCESS) {
+    (void)QFlightRecorderManager::dumpOnError("wait failed");
+  }
 
+  releaseSchedGrant(infHandle);
   submitWaitCv_.notify_one(); // Notify any thread waiting for space in Queue
   return status;
 }
 
+QNeuralnetwork::~QNeuralnetwork() {
+  stopCompletionSource();
+  if (probeFd_ >= 0) {
+    close(probeFd_);
+  }
+}
+
+// The counter of the VC eventfd is drained by the completion reactor, which
+// credits async waits with it. The probe must not read it, it watches the
+// eventfd edge triggered from its own epoll instead: every signal is
+// reported once, whether or not the counter was drained in between.
+int QNeuralnetwork::getCompletionProbeFd() {
+  std::call_once(probeOnce_, [this]() {
+    int fd = vc_->getEventFd();
+    if (fd < 0) {
+      return;
+    }
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+      return;
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLET;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      LogWarn("Dev {} VC {} busy poll probe unavailable: {}",
+              (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(),
+              QOsal::strerror_safe(errno));
+      close(epollFd);
+      return;
+    }
+    probeFd_ = epollFd;
+  });
+  return probeFd_;
+}
+
+QStatus QNeuralnetwork::waitBusyPoll(const QInfHandle *infHandle,
+                                     uint32_t spinBudgetUs) {
+  int probeFd = getCompletionProbeFd();
+  if ((infHandle == nullptr) || (probeFd < 0)) {
+    return wait(infHandle);
+  }
+
+  // The VC eventfd is signalled for any completion on the VC, a false hit
+  // only means going to the blocking wait early. Concurrent waiters share
+  // the probe, one may take the edge of another, who then spins its budget.
+  auto probe = [probeFd]() {
+    struct epoll_event event;
+    return (epoll_wait(probeFd, &event, 1, 0) > 0);
+  };
+  return completionPoller_.wait(
+      std::chrono::microseconds(spinBudgetUs), probe,
+      [this, infHandle]() { return wait(infHandle); });
+}
+
+QStatus QNeuralnetwork::waitBusyPollUntil(
+    const QInfHandle *infHandle, uint32_t spinBudgetUs,
+    std::chrono::steady_clock::time_point deadline) {
+  if (deadline == std::chrono::steady_clock::time_point::max()) {
+    return waitBusyPoll(infHandle, spinBudgetUs);
+  }
+  int probeFd = getCompletionProbeFd();
+  if ((infHandle == nullptr) || (probeFd < 0)) {
+    return waitUntil(infHandle, deadline);
+  }
+  // Spinning past the deadline would only delay reporting it
+  auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+      deadline - std::chrono::steady_clock::now());
+  auto spinBudget = std::max(
+      std::chrono::microseconds(0),
+      std::min(std::chrono::microseconds(spinBudgetUs), remaining));
+  auto probe = [probeFd]() {
+    struct epoll_event event;
+    return (epoll_wait(probeFd, &event, 1, 0) > 0);
+  };
+  auto block = [this, infHandle, deadline]() {
+    return waitUntil(infHandle, deadline);
+  };
+  return completionPoller_.wait(spinBudget, probe, block);
+}
+
+QStatus QNeuralnetwork::waitExec(const QInfHandle *infHandle,
+                                 uint32_t timeoutMs) {
+  qaic_wait wait = {};
+  wait.handle = infHandle->waitHandle_;
+  wait.timeout = timeoutMs;
+  wait.dbc_id = vc_->getVC();
+
+  if (devInterface_->runDevCmd(QAIC_DEV_CMD_WAIT_EXEC, &wait) != QS_SUCCESS) {
+    if (errno == ETIMEDOUT) {
+      return QS_TIMEDOUT;
+    }
+    LogError("Dev {} VC {} failed to send wait exec IOCTL: {} ",
+             (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(),
+             QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QNeuralnetwork::waitAsync(const QInfHandle *infHandle,
+                                  QWaitCallback done) {
+  if ((infHandle == nullptr) || !done) {
+    return QS_INVAL;
+  } else if (infHandle->waitHandle_ <= 0) {
+    LogError("Dev {} VC {} invalid wait handle ", (uint32_t)dev_->getID(),
+             (uint32_t)vc_->getVC());
+    return QS_INVAL;
+  }
+
+  std::lock_guard<std::mutex> lock(pendingWaitsMutex_);
+  if (!completionThread_.joinable()) {
+    QStatus status = startCompletionSource();
+    if (status != QS_SUCCESS) {
+      return status;
+    }
+  }
+  completionReaper_.push(
+      {infHandle, std::move(done), std::chrono::steady_clock::now()},
+      [this]() {
+        QCompletionSourceID sourceId = completionSourceId_;
+        if (sourceId != 0) {
+          (void)reactor_->setSourceTimeout(sourceId, completionTimeoutMs_);
+        }
+      });
+  return QS_SUCCESS;
+}
+
+// Called with pendingWaitsMutex_ held
+QStatus QNeuralnetwork::startCompletionSource() {
+  // The eventfd of a VC is watched by the first network using it. Others
+  // sharing the VC, or all without a usable eventfd, are polled by their
+  // completion thread.
+  QCompletionSourceID sourceId = 0;
+  int fd = vc_->getEventFd();
+  if (fd >= 0) {
+    reactor_ = QCompletionReactorManager::getCompletionReactor();
+    if (reactor_ == nullptr) {
+      LogWarn("Dev {} VC {} completion reactor is not available, polling",
+              (uint32_t)dev_->getID(), (uint32_t)vc_->getVC());
+    } else {
+      auto handler = [this](QCompletionEvent event) {
+        signalCompletions(event);
+      };
+      if (reactor_->addSource(fd, 0, handler, sourceId) != QS_SUCCESS) {
+        sourceId = 0;
+      }
+    }
+  }
+  // Signalled completions need no timer, it only catches an inference that
+  // never completes
+  completionTimeoutMs_ =
+      (waitTimeoutMs_ != 0) ? waitTimeoutMs_ : kmdDefaultWaitTimeoutMs;
+  completionPolled_ = (sourceId == 0);
+  completionReaper_.start(completionPolled_);
+  try {
+    completionThread_ = std::thread([this]() { completionThread(); });
+  } catch (const std::system_error &e) {
+    LogError("Dev {} VC {} failed to start completion thread: {}",
+             (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(), e.what());
+    if (sourceId != 0) {
+      (void)reactor_->removeSource(sourceId);
+    }
+    return QS_ERROR;
+  }
+  completionSourceId_ = sourceId;
+  return QS_SUCCESS;
+}
+
+void QNeuralnetwork::stopCompletionSource() {
+  QCompletionSourceID sourceId;
+  std::thread thread;
+  {
+    std::lock_guard<std::mutex> lock(pendingWaitsMutex_);
+    if (!completionThread_.joinable()) {
+      return;
+    }
+    sourceId = completionSourceId_;
+    completionSourceId_ = 0;
+    thread = std::move(completionThread_);
+  }
+  if (sourceId != 0) {
+    (void)reactor_->removeSource(sourceId);
+  }
+  completionReaper_.stop();
+  if (thread.get_id() == std::this_thread::get_id()) {
+    // Deactivated from a wait callback, the thread ends once it returns
+    thread.detach();
+  } else {
+    thread.join();
+  }
+
+  // Nothing reaps these anymore
+  std::deque<PendingWait> abandoned = completionReaper_.drain();
+  if (!abandoned.empty()) {
+    LogWarn("Dev {} VC {} NAID {} deactivated with {} inferences in flight",
+            (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(), naID_,
+            abandoned.size());
+  }
+  for (auto &pending : abandoned) {
+    releaseSchedGrant(pending.infHandle);
+    pending.done(QS_ERROR);
+  }
+}
+
+// Runs on a reactor thread and must not block, it only credits the
+// completion thread with the completions the VC eventfd signalled
+void QNeuralnetwork::signalCompletions(QCompletionEvent event) {
+  if (event == QCompletionEvent::Ready) {
+    uint64_t count = 0;
+    if (read(vc_->getEventFd(), &count, sizeof(count)) == sizeof(count)) {
+      completionReaper_.signal(count);
+    }
+  } else {
+    // Nothing completed for a whole wait timeout, check the head
+    completionReaper_.signal(1);
+  }
+}
+
+void QNeuralnetwork::completionThread() {
+  QNumaPlacementManager::bindRuntimeThread();
+  while (completionReaper_.waitReady()) {
+    reapCompletions();
+  }
+}
+
+// Runs on the completion thread, wait callbacks are called from here
+void QNeuralnetwork::reapCompletions() {
+  const uint32_t waitTimeoutMs =
+      (waitTimeoutMs_ != 0) ? waitTimeoutMs_ : kmdDefaultWaitTimeoutMs;
+  const auto maxWait =
+      std::chrono::milliseconds(waitTimeoutMs) * (numMaxWaitRetries_ + 1);
+  const uint32_t checkTimeoutMs =
+      completionPolled_ ? completionPollWaitMs : completionReapTimeoutMs;
+
+  auto check = [this, &maxWait, checkTimeoutMs](const PendingWait &pending) {
+    QStatus status = waitExec(pending.infHandle, checkTimeoutMs);
+    if ((status == QS_TIMEDOUT) &&
+        (std::chrono::steady_clock::now() - pending.start >= maxWait)) {
+      LogError("Dev {} VC {} wait handle {} timed out",
+               (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(),
+               pending.infHandle->waitHandle_);
+      status = QS_ERROR;
+    }
+    return status;
+  };
+  auto complete = [this](PendingWait pending, QStatus status) {
+    releaseSchedGrant(pending.infHandle);
+    submitWaitCv_.notify_one(); // Notify any thread waiting for space in Queue
+    pending.done(status);
+  };
+  completionReaper_.reap(check, complete, [this]() {
+    QCompletionSourceID sourceId = completionSourceId_;
+    if (sourceId != 0) {
+      (void)reactor_->setSourceTimeout(sourceId, 0);
+    }
+  });
+}
+
 //
 // returns all in/out buffers for a batch
 //
@@ -631,6 +1032,7 @@ QStatus QNeuralnetwork::runExecute(const QInfHandle *infHandle,
         if (submitRetryFirst) {
           submitFirstTimePoint = now;
           submitRetryFirst = false;
+          numQueueFull_++;
 
           // Check if the queue size is adequate for this execution
           ret = getExecProfilingData(infHandle, execProfilingData);
@@ -648,6 +1050,8 @@ QStatus QNeuralnetwork::runExecute(const QInfHandle *infHandle,
           }
         }
         submitRetryCount++;
+        qFlightRecord(QFlightEventType::SubmitAgain, dev_->getID(),
+                      vc_->getVC(), submitRetryCount);
         LogDebug("Dev:{} VC:{} Device Busy in runExecute, retry:{} of {}, "
                  "waiting {} ms",
                  (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(),
@@ -664,6 +1068,9 @@ QStatus QNeuralnetwork::runExecute(const QInfHandle *infHandle,
               (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(),
               QOsal::strerror_safe(errno), submitRetryCount,
               submitRetryWaitProgressiveUs / 1000, totalWaitTimeMs);
+          qFlightRecord(QFlightEventType::SubmitBusy, dev_->getID(),
+                        vc_->getVC());
+          (void)QFlightRecorderManager::dumpOnError("submit busy");
           return QS_BUSY;
         }
         if (submitWaitCv_.wait_until(lock,
@@ -688,9 +1095,15 @@ QStatus QNeuralnetwork::runExecute(const QInfHandle *infHandle,
       LogError("Dev {} VC {} failed to send Execute IOCTL: {}",
                (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(),
                QOsal::strerror_safe(errno));
+      QFlightRecorderManager::getRecorder().recordText(
+          QFlightEventType::Error, dev_->getID(), "execute");
+      (void)QFlightRecorderManager::dumpOnError("submit failed");
       return QS_ERROR;
     }
     success = true;
+    numSubmits_++;
+    qFlightRecord(QFlightEventType::Submit, dev_->getID(), vc_->getVC(),
+                  infHandle->waitHandle_);
     break;
   }
   if (!success) {
@@ -710,7 +1123,15 @@ QNeuralnetwork::prepareInfHandleBuf(qaic_create_bo *createBO,
 
   qaic_attach_slice *attach_slice = reinterpret_cast<qaic_attach_slice *>(createBO + 1);
 
-  if (devInterface_->runDevCmd(QAIC_DEV_CMD_MEM, createBO) != QS_SUCCESS) {
+  // Caller owned dma-bufs are imported rather than allocated, the data stays
+  // where the producer wrote it and nothing is mapped here
+  QDevInterfaceCmdEnum cmd = QAIC_DEV_CMD_MEM;
+  if ((kbuf.type == QBufferType::QBUFFER_TYPE_DMABUF) && (createBO->size != 0)) {
+    createBO->handle = static_cast<uint32_t>(kbuf.handle);
+    cmd = QAIC_DEV_CMD_PRIME_FD;
+  }
+
+  if (devInterface_->runDevCmd(cmd, createBO) != QS_SUCCESS) {
     LogError("Dev {} VC {} failed to send Mem IOCTL: {}",
              (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(),
              QOsal::strerror_safe(errno));
@@ -788,6 +1209,20 @@ QStatus QNeuralnetwork::activateStateChange(QActivationStateType
 
 QStatus QNeuralnetwork::deactivate() {
 
+  stopCompletionSource();
+  if (scheduler_ != nullptr) {
+    // Fails the submissions still waiting and returns the grants of those
+    // in flight. scheduler_ stays set for submitters racing with this, the
+    // removed client makes their acquire and release no-ops.
+    (void)scheduler_->removeClient(schedClientId_);
+  }
+  if (completionPoller_.getNumWaits() != 0) {
+    LogInfo("Dev {} VC {} NAID {} busy poll waits {} spin hits {} blocking {}",
+            (uint32_t)dev_->getID(), (uint32_t)vc_->getVC(), naID_,
+            completionPoller_.getNumWaits(), completionPoller_.getNumSpinHits(),
+            completionPoller_.getNumBlockingWaits());
+  }
+
   bool deactivate_vc = false;
   vc_->decRef();
 
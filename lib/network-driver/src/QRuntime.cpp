@@ -160,11 +160,71 @@ QNNConstantsInterface *QRuntime::loadConstantsEx(QID deviceID,
   return constants;
 }
 
+QNNImageInterface *QRuntime::attachImage(QID deviceID, const QBuffer &buf,
+                                         QNNImageID imageID, QStatus &status) {
+  QBuffer networkElfBuf = {};
+  QDeviceInterface *dev = devFactory_->getDevice(deviceID);
+  if (dev == nullptr) {
+    status = QS_NODEV;
+    return nullptr;
+  }
+
+  if (getQPCSegment(buf.buf, "network.elf", &(networkElfBuf.buf),
+                    &(networkElfBuf.size), 0)) {
+    if (networkElfBuf.buf == nullptr) {
+      status = QS_INVAL;
+      return nullptr;
+    }
+  } else {
+    networkElfBuf.buf = buf.buf;
+    networkElfBuf.size = buf.size;
+  }
+
+  std::unique_ptr<QMetaDataInterface> meta =
+      imgParser_->parseImage(networkElfBuf, status);
+  if (status != QS_SUCCESS) {
+    LogError("Failed to parse network image , error {}",
+             qutil::statusStr(status));
+    return nullptr;
+  }
+  assert(meta != nullptr);
+  QNNImage *img =
+      new QNNImage(dev, std::move(meta), networkElfBuf, deviceID, imageID);
+  if (!img) {
+    LogError("Failed to create QNNImage with image ID {}", imageID);
+    status = QS_NOMEM;
+    return nullptr;
+  }
+  LogInfo("Network image attached with ID {}", imageID);
+  status = QS_SUCCESS;
+  return img;
+}
+
+QNNConstantsInterface *QRuntime::attachConstants(QID deviceID,
+                                                 QNNConstantsID constantsID,
+                                                 QStatus &status) {
+  QDeviceInterface *dev = devFactory_->getDevice(deviceID);
+  if (dev == nullptr) {
+    status = QS_NODEV;
+    return nullptr;
+  }
+  QNNConstants *constants = new QNNConstants(dev, deviceID, constantsID);
+  if (!constants) {
+    LogError("Failed to create QNNConstants with ID {}", constantsID);
+    status = QS_NOMEM;
+    return nullptr;
+  }
+  LogInfo("Network constants attached with ID {}", constantsID);
+  status = QS_SUCCESS;
+  return constants;
+}
+
 QNeuralNetworkInterface *
 QRuntime::activateNetwork(QNNImageInterface *image,
                           QNNConstantsInterface *constants, QStatus &status,
                           QActivationStateType initialState,
-                          uint32_t waitTimeoutMs, uint32_t numMaxWaitRetries) {
+                          uint32_t waitTimeoutMs, uint32_t numMaxWaitRetries,
+                          uint32_t inferencesInFlight) {
   if (image == nullptr) {
     status = QS_INVAL;
     return nullptr;
@@ -194,10 +254,18 @@ QRuntime::activateNetwork(QNNImageInterface *image,
   QVirtualChannelInterface *vc = nullptr;
   uint64_t ddrBase = 0, mcIDBase = 0;
 
+  // The VC queue holds the request elements of every queued inference
+  auto meta = static_cast<QNNImage *>(image)->getMetaData();
+  assert(meta != nullptr);
+  const uint32_t queueSizePow2 = QVCQueueSizing::sizePow2(
+      meta->getReqElementsCount(), inferencesInFlight);
+  LogInfo("VC queue of {} elements for {} request elements per inference",
+          1u << queueSizePow2, meta->getReqElementsCount());
+
   uint16_t retryCount = activationRetryCount;
   while (retryCount--) {
     status = dev->activate(image->getImageID(), constantsId, naID, ddrBase,
-                           mcIDBase, &vc, initialState);
+                           mcIDBase, &vc, initialState, queueSizePow2);
 
     if (status == QS_AGAIN) {
       /* Wait for device to recover */
@@ -219,8 +287,6 @@ QRuntime::activateNetwork(QNNImageInterface *image,
     return nullptr;
   }
 
-  auto meta = static_cast<QNNImage *>(image)->getMetaData();
-  assert(meta != nullptr);
   auto updatedMeta = meta->getUpdatedMetadata(ddrBase, mcIDBase);
   assert(updatedMeta != nullptr);
 
@@ -0,0 +1,511 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QSharedImageRegistry.h"
+#include "QMonitorNamedMutex.h"
+#include "QOsalUtils.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace qaic {
+
+static const std::string QAicSharedImageRegistryEnv =
+    "QAIC_SHARED_IMAGE_REGISTRY";
+static const std::string QAicSharedImageLoadWaitEnv =
+    "QAIC_SHARED_IMAGE_LOAD_WAIT_MS";
+static const std::string QAicSharedImageWatchEnv =
+    "QAIC_SHARED_IMAGE_WATCH_MS";
+static const std::string QAicSharedImageMutexSuffix = "Mutex";
+
+// "QAICSHIM"
+static constexpr uint64_t tableMagic = 0x4d49485343494151ULL;
+static constexpr uint32_t tableVersion = 2;
+static constexpr std::chrono::milliseconds loadPollInterval(5);
+static constexpr std::chrono::milliseconds defaultWatchInterval(100);
+
+enum EntryState : uint32_t {
+  EntryFree = 0,
+  EntryLoading,
+  EntryReady,
+};
+
+struct QSharedImageRegistry::Entry {
+  struct Holder {
+    int32_t pid;
+    uint32_t count;
+  };
+  uint32_t state;
+  uint32_t kind;
+  int32_t qid;
+  uint32_t id;
+  uint8_t digest[32];
+  uint64_t size;
+  int32_t loaderPid;
+  uint32_t numHolders;
+  Holder holders[maxHolders];
+};
+
+// Shared by all processes, any change of the layout bumps tableVersion
+struct QSharedImageRegistry::Table {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t reserved;
+  Entry entries[maxEntries];
+};
+
+static bool isProcessAlive(int32_t pid) {
+  if (pid <= 0) {
+    // kill() would signal a process group
+    return false;
+  }
+  // EPERM is a live process of another user
+  return (::kill(pid, 0) == 0) || (errno != ESRCH);
+}
+
+QSharedImageRegistry::Lock::Lock(QSharedImageRegistry &registry)
+    : registry_(registry), guard_(registry.mutex_) {
+  registry_.namedMutex_->lock();
+}
+
+QSharedImageRegistry::Lock::~Lock() { registry_.namedMutex_->unlock(); }
+
+QSharedImageRegistry::QSharedImageRegistry(std::string name)
+    : QLogger("QSharedImageRegistry"), name_(std::move(name)),
+      watchInterval_(defaultWatchInterval) {}
+
+QSharedImageRegistry::~QSharedImageRegistry() {
+  {
+    std::lock_guard<std::mutex> lk(watchMutex_);
+    stopping_ = true;
+  }
+  watchCv_.notify_all();
+  if (watchThread_.joinable()) {
+    watchThread_.join();
+  }
+  if (table_ != nullptr) {
+    QOsal::munmap(table_, sizeof(Table));
+  }
+  if (shmDesc_ != -1) {
+    close(shmDesc_);
+  }
+}
+
+QStatus QSharedImageRegistry::init() {
+  if (table_ != nullptr) {
+    return QS_SUCCESS;
+  }
+  namedMutex_ = QMonitorNamedMutexBuilder::buildNamedMutex(
+      name_ + QAicSharedImageMutexSuffix);
+  if (namedMutex_ == nullptr) {
+    LogError("Failed to create the mutex of registry {}", name_);
+    return QS_ERROR;
+  }
+
+  Lock lock(*this);
+  // Private to the user, the entries decide what other processes attach to
+  // and which processes are signalled to probe them
+  shmDesc_ = QOsal::shm_open(name_.c_str(), O_CREAT | O_RDWR | O_NOFOLLOW,
+                             S_IRUSR | S_IWUSR);
+  if (shmDesc_ == -1) {
+    LogError("Failed to open registry {} with errno {}", name_, errno);
+    return QS_ERROR;
+  }
+
+  struct stat st;
+  if (fstat(shmDesc_, &st) == -1) {
+    LogError("Failed to stat registry {} with errno {}", name_, errno);
+    close(shmDesc_);
+    shmDesc_ = -1;
+    return QS_ERROR;
+  }
+  // Created by someone else before us, or opened up since
+  if ((st.st_uid != geteuid()) || ((st.st_mode & (S_IRWXG | S_IRWXO)) != 0)) {
+    LogError("Registry {} is not private to this user, mode {:o}", name_,
+             st.st_mode & 0777);
+    close(shmDesc_);
+    shmDesc_ = -1;
+    return QS_ERROR;
+  }
+
+  // A new region reads as zeros, which is an empty table
+  if (((static_cast<size_t>(st.st_size) < sizeof(Table)) &&
+       (ftruncate(shmDesc_, sizeof(Table)) == -1))) {
+    LogError("Failed to size registry {} with errno {}", name_, errno);
+    close(shmDesc_);
+    shmDesc_ = -1;
+    return QS_ERROR;
+  }
+
+  void *addr = QOsal::mmap(nullptr, sizeof(Table), PROT_READ | PROT_WRITE,
+                           MAP_SHARED, shmDesc_, 0);
+  if (addr == MAP_FAILED) {
+    LogError("Failed to map registry {} with errno {}", name_, errno);
+    close(shmDesc_);
+    shmDesc_ = -1;
+    return QS_ERROR;
+  }
+  Table *table = static_cast<Table *>(addr);
+  if (table->magic == 0) {
+    table->version = tableVersion;
+    table->magic = tableMagic;
+  } else if ((table->magic != tableMagic) ||
+             (table->version != tableVersion)) {
+    LogError("Registry {} has an unknown layout, version {}", name_,
+             table->version);
+    QOsal::munmap(addr, sizeof(Table));
+    close(shmDesc_);
+    shmDesc_ = -1;
+    return QS_ERROR;
+  }
+  table_ = table;
+  return QS_SUCCESS;
+}
+
+// Called with the lock held
+bool QSharedImageRegistry::isValid(const Entry &entry) {
+  if (((entry.state != EntryLoading) && (entry.state != EntryReady)) ||
+      ((entry.kind != static_cast<uint32_t>(QSharedImageKind::Constants)) &&
+       (entry.kind !=
+        static_cast<uint32_t>(QSharedImageKind::NetworkImage))) ||
+      (entry.loaderPid <= 0) || (entry.numHolders > maxHolders)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < entry.numHolders; i++) {
+    if ((entry.holders[i].pid <= 0) || (entry.holders[i].count == 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Called with the lock held
+QSharedImageRegistry::Entry *
+QSharedImageRegistry::find(const QSharedImageKey &key) {
+  for (Entry &entry : table_->entries) {
+    if (entry.state == EntryFree) {
+      continue;
+    }
+    if (!isValid(entry)) {
+      LogWarn("Dropping a corrupt entry of registry {}", name_);
+      std::memset(&entry, 0, sizeof(entry));
+      continue;
+    }
+    prune(entry);
+    if ((entry.state != EntryFree) &&
+        (entry.kind == static_cast<uint32_t>(key.kind)) &&
+        (entry.qid == key.qid) && (entry.size == key.size) &&
+        (std::memcmp(entry.digest, key.digest.data(), sizeof(entry.digest)) ==
+         0)) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+// Called with the lock held
+void QSharedImageRegistry::prune(Entry &entry) {
+  if (!isProcessAlive(entry.loaderPid)) {
+    // The device released the load along with its process
+    std::memset(&entry, 0, sizeof(entry));
+    return;
+  }
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < entry.numHolders; i++) {
+    if (isProcessAlive(entry.holders[i].pid)) {
+      entry.holders[kept++] = entry.holders[i];
+    }
+  }
+  entry.numHolders = kept;
+}
+
+QStatus QSharedImageRegistry::acquire(const QSharedImageKey &key,
+                                      QSharedImageClaim &claim, uint32_t &id,
+                                      std::chrono::milliseconds loadWait) {
+  if (table_ == nullptr) {
+    return QS_INVAL;
+  }
+  const int32_t pid = getpid();
+  const auto deadline = std::chrono::steady_clock::now() + loadWait;
+  while (true) {
+    {
+      Lock lock(*this);
+      Entry *entry = find(key);
+      if (entry == nullptr) {
+        for (Entry &free : table_->entries) {
+          if (free.state == EntryFree) {
+            entry = &free;
+            break;
+          }
+        }
+        if (entry == nullptr) {
+          LogWarn("Registry {} is full, loading for this process", name_);
+          claim = QSharedImageClaim::Private;
+          return QS_SUCCESS;
+        }
+        entry->state = EntryLoading;
+        entry->kind = static_cast<uint32_t>(key.kind);
+        entry->qid = key.qid;
+        std::memcpy(entry->digest, key.digest.data(), sizeof(entry->digest));
+        entry->size = key.size;
+        entry->loaderPid = pid;
+        entry->holders[0] = {pid, 1};
+        entry->numHolders = 1;
+        claim = QSharedImageClaim::Load;
+        return QS_SUCCESS;
+      }
+
+      if (entry->state == EntryReady) {
+        Entry::Holder *holder = nullptr;
+        for (uint32_t i = 0; i < entry->numHolders; i++) {
+          if (entry->holders[i].pid == pid) {
+            holder = &entry->holders[i];
+            break;
+          }
+        }
+        if (holder == nullptr) {
+          if (entry->numHolders == maxHolders) {
+            LogWarn("Registry {} has no room for another holder", name_);
+            claim = QSharedImageClaim::Private;
+            return QS_SUCCESS;
+          }
+          holder = &entry->holders[entry->numHolders++];
+          *holder = {pid, 0};
+        }
+        holder->count++;
+        id = entry->id;
+        claim = QSharedImageClaim::Reuse;
+        return QS_SUCCESS;
+      }
+    }
+
+    // Being loaded, by another process or another thread of this one
+    if (std::chrono::steady_clock::now() >= deadline) {
+      LogWarn("Timed out waiting for a load in registry {}", name_);
+      claim = QSharedImageClaim::Private;
+      return QS_SUCCESS;
+    }
+    std::this_thread::sleep_for(loadPollInterval);
+  }
+}
+
+QStatus QSharedImageRegistry::publish(const QSharedImageKey &key,
+                                      uint32_t id) {
+  if (table_ == nullptr) {
+    return QS_INVAL;
+  }
+  Lock lock(*this);
+  Entry *entry = find(key);
+  if ((entry == nullptr) || (entry->state != EntryLoading) ||
+      (entry->loaderPid != getpid())) {
+    return QS_INVAL;
+  }
+  entry->id = id;
+  entry->state = EntryReady;
+  return QS_SUCCESS;
+}
+
+QStatus QSharedImageRegistry::abandon(const QSharedImageKey &key) {
+  if (table_ == nullptr) {
+    return QS_INVAL;
+  }
+  Lock lock(*this);
+  Entry *entry = find(key);
+  if ((entry == nullptr) || (entry->state != EntryLoading) ||
+      (entry->loaderPid != getpid())) {
+    return QS_INVAL;
+  }
+  std::memset(entry, 0, sizeof(*entry));
+  return QS_SUCCESS;
+}
+
+QStatus QSharedImageRegistry::release(const QSharedImageKey &key,
+                                      uint32_t id, bool &lastHolder) {
+  lastHolder = false;
+  if (table_ == nullptr) {
+    return QS_INVAL;
+  }
+  const int32_t pid = getpid();
+  Lock lock(*this);
+  Entry *entry = find(key);
+  // A load of the same content after the loader of \p id exited is not
+  // what the caller holds
+  if ((entry == nullptr) || (entry->state != EntryReady) ||
+      (entry->id != id)) {
+    return QS_INVAL;
+  }
+  for (uint32_t i = 0; i < entry->numHolders; i++) {
+    if (entry->holders[i].pid != pid) {
+      continue;
+    }
+    if (--entry->holders[i].count == 0) {
+      entry->holders[i] = entry->holders[--entry->numHolders];
+    }
+    if (entry->numHolders == 0) {
+      std::memset(entry, 0, sizeof(*entry));
+      lastHolder = true;
+    }
+    return QS_SUCCESS;
+  }
+  return QS_INVAL;
+}
+
+bool QSharedImageRegistry::isLoaded(const QSharedImageKey &key, uint32_t id) {
+  if (table_ == nullptr) {
+    return false;
+  }
+  Lock lock(*this);
+  Entry *entry = find(key);
+  return (entry != nullptr) && (entry->state == EntryReady) &&
+         (entry->id == id);
+}
+
+uint32_t QSharedImageRegistry::getNumHolders(const QSharedImageKey &key) {
+  if (table_ == nullptr) {
+    return 0;
+  }
+  Lock lock(*this);
+  Entry *entry = find(key);
+  uint32_t count = 0;
+  if (entry != nullptr) {
+    for (uint32_t i = 0; i < entry->numHolders; i++) {
+      count += entry->holders[i].count;
+    }
+  }
+  return count;
+}
+
+uint64_t QSharedImageRegistry::watch(const QSharedImageKey &key, uint32_t id,
+                                     LostCallback onLost) {
+  if ((table_ == nullptr) || !onLost) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lk(watchMutex_);
+  if (stopping_) {
+    return 0;
+  }
+  const uint64_t handle = nextWatch_++;
+  watches_[handle] = {key, id, std::move(onLost)};
+  if (!watchThread_.joinable()) {
+    watchThread_ = std::thread(&QSharedImageRegistry::watchThread, this);
+  }
+  return handle;
+}
+
+void QSharedImageRegistry::unwatch(uint64_t handle) {
+  std::unique_lock<std::mutex> lk(watchMutex_);
+  watches_.erase(handle);
+  if (std::this_thread::get_id() != watchThread_.get_id()) {
+    watchCv_.wait(lk, [this, handle] { return firing_ != handle; });
+  }
+}
+
+void QSharedImageRegistry::setWatchInterval(
+    std::chrono::milliseconds interval) {
+  {
+    std::lock_guard<std::mutex> lk(watchMutex_);
+    watchInterval_ = interval;
+  }
+  watchCv_.notify_all();
+}
+
+void QSharedImageRegistry::watchThread() {
+  std::unique_lock<std::mutex> lk(watchMutex_);
+  while (true) {
+    watchCv_.wait_for(lk, watchInterval_, [this] { return stopping_; });
+    if (stopping_) {
+      return;
+    }
+    std::vector<std::pair<uint64_t, Watch>> watches;
+    for (const auto &it : watches_) {
+      watches.push_back({it.first, {it.second.key, it.second.id, nullptr}});
+    }
+    // Not holding the watches while taking the registry lock, that may
+    // wait for other processes
+    lk.unlock();
+    std::vector<uint64_t> lost;
+    for (const auto &it : watches) {
+      if (!isLoaded(it.second.key, it.second.id)) {
+        lost.push_back(it.first);
+      }
+    }
+    lk.lock();
+    for (uint64_t handle : lost) {
+      auto it = watches_.find(handle);
+      if (it == watches_.end()) {
+        // Unwatched meanwhile
+        continue;
+      }
+      LostCallback onLost = std::move(it->second.onLost);
+      watches_.erase(it);
+      firing_ = handle;
+      lk.unlock();
+      onLost();
+      lk.lock();
+      firing_ = 0;
+      watchCv_.notify_all();
+    }
+  }
+}
+
+QStatus QSharedImageRegistry::unlink(const std::string &name) {
+  QStatus status = QS_SUCCESS;
+  for (const std::string &shmName :
+       {name, name + QAicSharedImageMutexSuffix}) {
+    if ((::shm_unlink(shmName.c_str()) == -1) && (errno != ENOENT)) {
+      status = QS_ERROR;
+    }
+  }
+  return status;
+}
+
+std::unique_ptr<QSharedImageRegistry> QSharedImageRegistryManager::registry_;
+std::chrono::milliseconds QSharedImageRegistryManager::loadWait_(600000);
+std::chrono::milliseconds
+    QSharedImageRegistryManager::watchInterval_(defaultWatchInterval);
+bool QSharedImageRegistryManager::initialized_ = false;
+std::mutex QSharedImageRegistryManager::m_;
+
+QSharedImageRegistry *QSharedImageRegistryManager::getRegistry() {
+  std::lock_guard<std::mutex> lk(m_);
+  if (initialized_) {
+    return registry_.get();
+  }
+  initialized_ = true;
+  if (const char *env = std::getenv(QAicSharedImageLoadWaitEnv.c_str())) {
+    int value = atoi(env);
+    if (value > 0) {
+      loadWait_ = std::chrono::milliseconds(value);
+    }
+  }
+  if (const char *env = std::getenv(QAicSharedImageWatchEnv.c_str())) {
+    int value = atoi(env);
+    if (value > 0) {
+      watchInterval_ = std::chrono::milliseconds(value);
+    }
+  }
+  const char *name = std::getenv(QAicSharedImageRegistryEnv.c_str());
+  if ((name == nullptr) || (*name == '\0')) {
+    return nullptr;
+  }
+  auto registry = std::make_unique<QSharedImageRegistry>(name);
+  if (registry->init() == QS_SUCCESS) {
+    registry->setWatchInterval(watchInterval_);
+    registry_ = std::move(registry);
+  }
+  return registry_.get();
+}
+
+std::chrono::milliseconds QSharedImageRegistryManager::getLoadWait() {
+  std::lock_guard<std::mutex> lk(m_);
+  return loadWait_;
+}
+
+} // namespace qaic
@@ -0,0 +1,231 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QSubmitScheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+namespace qaic {
+
+static const std::string QAicSchedDeviceInFlightEnv =
+    "QAIC_SCHED_DEVICE_INFLIGHT";
+
+std::unordered_map<QID, QSubmitSchedulerShared>
+    QSubmitSchedulerManager::schedulers_;
+std::mutex QSubmitSchedulerManager::m_;
+
+QSubmitSchedulerShared QSubmitSchedulerManager::getScheduler(QID qid) {
+  std::unique_lock<std::mutex> lk(m_);
+  auto it = schedulers_.find(qid);
+  if (it != schedulers_.end()) {
+    return it->second;
+  }
+  uint32_t deviceInFlight = 0;
+  if (const char *env = std::getenv(QAicSchedDeviceInFlightEnv.c_str())) {
+    int value = atoi(env);
+    if (value > 0) {
+      deviceInFlight = static_cast<uint32_t>(value);
+    }
+  }
+  QSubmitSchedulerShared scheduler =
+      std::make_shared<QSubmitScheduler>(deviceInFlight);
+  schedulers_.emplace(qid, scheduler);
+  return scheduler;
+}
+
+QStatus QSubmitScheduler::addClient(const QSubmitSchedParams &params,
+                                    QSubmitClientID &id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  id = nextId_++;
+  Client &client = clients_[id];
+  client.params = params;
+  client.params.weight = std::max(params.weight, 1u);
+  client.virtualTime = virtualTime_;
+  updateDeviceInFlight();
+  return QS_SUCCESS;
+}
+
+QStatus QSubmitScheduler::removeClient(QSubmitClientID id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = clients_.find(id);
+  if (it == clients_.end()) {
+    return QS_INVAL;
+  }
+  // Submissions still waiting would never be granted, they fail and must
+  // not touch the client once woken
+  for (Waiter *waiter : it->second.waiters) {
+    waiter->canceled = true;
+  }
+  numWaiters_ -= it->second.waiters.size();
+  numInFlight_ -= it->second.inFlight;
+  clients_.erase(it);
+  updateDeviceInFlight();
+  dispatch(Clock::now());
+  grantCv_.notify_all();
+  return QS_SUCCESS;
+}
+
+// Called with mutex_ held
+void QSubmitScheduler::updateDeviceInFlight() {
+  uint32_t deviceInFlight = 0;
+  for (const auto &entry : clients_) {
+    const uint32_t asked = entry.second.params.deviceInFlight;
+    if ((asked != 0) && ((deviceInFlight == 0) || (asked < deviceInFlight))) {
+      deviceInFlight = asked;
+    }
+  }
+  if (deviceInFlight == 0) {
+    deviceInFlight = defaultDeviceInFlight_;
+  }
+  if (deviceInFlight == 0) {
+    uint32_t deepestQueue = 0;
+    bool ordered = false;
+    for (const auto &entry : clients_) {
+      deepestQueue = std::max(deepestQueue, entry.second.params.queueInFlight);
+      ordered = ordered || entry.second.params.isOrdered();
+    }
+    if (ordered) {
+      deviceInFlight = deepestQueue;
+    }
+  }
+  deviceInFlight_ = deviceInFlight;
+}
+
+bool QSubmitScheduler::canGrant(const Client &client) const {
+  if ((deviceInFlight_ != 0) && (numInFlight_ >= deviceInFlight_)) {
+    return false;
+  }
+  return (client.params.maxInFlight == 0) ||
+         (client.inFlight < client.params.maxInFlight);
+}
+
+void QSubmitScheduler::grant(Client &client) {
+  virtualTime_ = std::max(virtualTime_, client.virtualTime);
+  client.virtualTime += weightScale / client.params.weight;
+  client.inFlight++;
+  numInFlight_++;
+}
+
+// Called with mutex_ held
+void QSubmitScheduler::dispatch(Clock::time_point now) {
+  while (numWaiters_ != 0) {
+    Client *next = nullptr;
+    Client *starved = nullptr;
+    Clock::time_point starvedSince;
+    for (auto &entry : clients_) {
+      Client &client = entry.second;
+      if (client.waiters.empty() || !canGrant(client)) {
+        continue;
+      }
+      // Waiting is counted from the last grant made while others waited,
+      // a starved client gets one submission per maxWaitUs ahead of higher
+      // priorities rather than all it has waiting
+      const Clock::time_point waitingSince =
+          std::max(client.waiters.front()->enqueued, client.lastDispatched);
+      if ((client.params.maxWaitUs != 0) &&
+          (now - waitingSince >=
+           std::chrono::microseconds(client.params.maxWaitUs)) &&
+          ((starved == nullptr) || (waitingSince < starvedSince))) {
+        starved = &client;
+        starvedSince = waitingSince;
+      }
+      if ((next == nullptr) ||
+          (client.params.priority < next->params.priority) ||
+          ((client.params.priority == next->params.priority) &&
+           (client.virtualTime < next->virtualTime))) {
+        next = &client;
+      }
+    }
+    if (starved != nullptr) {
+      next = starved;
+    }
+    if (next == nullptr) {
+      return;
+    }
+    next->waiters.front()->granted = true;
+    next->waiters.pop_front();
+    numWaiters_--;
+    next->lastDispatched = now;
+    grant(*next);
+  }
+}
+
+QStatus QSubmitScheduler::acquire(QSubmitClientID id,
+                                  std::chrono::microseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = clients_.find(id);
+  if (it == clients_.end()) {
+    return QS_INVAL;
+  }
+  Client &client = it->second;
+
+  // Nobody waits, nothing to order
+  if ((numWaiters_ == 0) && canGrant(client)) {
+    client.virtualTime = std::max(client.virtualTime, virtualTime_);
+    grant(client);
+    return QS_SUCCESS;
+  }
+
+  const Clock::time_point now = Clock::now();
+  if (client.waiters.empty() && (client.inFlight == 0)) {
+    client.virtualTime = std::max(client.virtualTime, virtualTime_);
+  }
+  Waiter waiter;
+  waiter.enqueued = now;
+  client.waiters.push_back(&waiter);
+  numWaiters_++;
+  dispatch(now);
+  grantCv_.notify_all();
+
+  // Starvation only reorders grants, which are made when grants are
+  // returned, so there is nothing to do on a timer
+  if (!grantCv_.wait_until(lock, now + timeout, [&waiter] {
+        return waiter.granted || waiter.canceled;
+      })) {
+    client.waiters.erase(
+        std::find(client.waiters.begin(), client.waiters.end(), &waiter));
+    numWaiters_--;
+    return QS_TIMEDOUT;
+  }
+  return waiter.canceled ? QS_CANCELED : QS_SUCCESS;
+}
+
+QStatus QSubmitScheduler::release(QSubmitClientID id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = clients_.find(id);
+  if ((it == clients_.end()) || (it->second.inFlight == 0)) {
+    return QS_INVAL;
+  }
+  it->second.inFlight--;
+  numInFlight_--;
+  if (numWaiters_ != 0) {
+    dispatch(Clock::now());
+    grantCv_.notify_all();
+  }
+  return QS_SUCCESS;
+}
+
+uint32_t QSubmitScheduler::getDeviceInFlight() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return deviceInFlight_;
+}
+
+uint32_t QSubmitScheduler::getNumInFlight() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return numInFlight_;
+}
+
+uint32_t QSubmitScheduler::getNumInFlight(QSubmitClientID id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = clients_.find(id);
+  return (it != clients_.end()) ? it->second.inFlight : 0;
+}
+
+size_t QSubmitScheduler::getNumClients() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return clients_.size();
+}
+
+} // namespace qaic
@@ -5,6 +5,7 @@
 #define PREPOSTPROC_H
 
 #include <assert.h>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -64,6 +65,11 @@ public:
 
   virtual void preProcessInputs(const BufferBindings &bindings) = 0;
   virtual void postProcessOutputs(const BufferBindings &bindings) = 0;
+
+  // Called with every block of temporaries once allocated, before it is
+  // touched, e.g. to place it on the NUMA node of the device
+  using TempBlockHook = std::function<void(void *block, size_t size)>;
+  virtual void setTempBlockHook(TempBlockHook hook) = 0;
 };
 } // namespace aicppp
 
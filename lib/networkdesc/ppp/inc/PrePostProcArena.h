@@ -0,0 +1,135 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef PREPOSTPROCARENA_H
+#define PREPOSTPROCARENA_H
+
+#include <algorithm>
+#include <assert.h>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace aicppp {
+
+// Arena for the temporary tensors of one PrePostProcessor.
+//
+// Temporaries are planned once, when the transforms are prepared: reserve()
+// hands out a slot and release() returns it to its size class so that a
+// later transform of the same plan reuses it. commit() then backs every slot
+// planned since the previous commit with a single page aligned block, each
+// slot starting on its own cache line. Running transforms only dereferences
+// slots, the arena belongs to a single handle and never locks.
+class TempArena {
+public:
+  static constexpr size_t slotAlignment = 64;
+  static constexpr size_t blockAlignment = 4096;
+
+  // Called with every block once allocated, before any slot is touched
+  using BlockHook = std::function<void(void *block, size_t size)>;
+  void setBlockHook(BlockHook hook) { blockHook_ = std::move(hook); }
+
+  // Returns a slot of at least size bytes, preferring the smallest released
+  // slot that fits
+  int reserve(size_t size) {
+    size_t sizeClass = getSizeClass(size);
+    for (size_t c = sizeClass; c < freeSlots_.size(); c++) {
+      if (!freeSlots_[c].empty()) {
+        int slot = freeSlots_[c].back();
+        freeSlots_[c].pop_back();
+        return slot;
+      }
+    }
+    slots_.push_back({sizeClass, blocks_.size(), pendingBytes_});
+    pendingBytes_ = alignTo(pendingBytes_ + getClassSize(sizeClass),
+                            slotAlignment);
+    return static_cast<int>(slots_.size() - 1);
+  }
+
+  // Makes slot available to later reservations of the current plan
+  void release(int slot) {
+    assert((slot >= 0) && (static_cast<size_t>(slot) < slots_.size()));
+    const Slot &s = slots_[slot];
+    assert(s.block == blocks_.size() && "slot is already committed");
+    if (freeSlots_.size() <= s.sizeClass)
+      freeSlots_.resize(s.sizeClass + 1);
+    freeSlots_[s.sizeClass].push_back(slot);
+  }
+
+  // Allocates the block for the current plan and starts a new plan. Slots
+  // of earlier plans stay valid.
+  bool commit() {
+    freeSlots_.clear();
+    if (planStart_ == slots_.size())
+      return true;
+    void *block = nullptr;
+    size_t size = alignTo(std::max<size_t>(pendingBytes_, 1), blockAlignment);
+    if (posix_memalign(&block, blockAlignment, size) != 0)
+      return false;
+    if (blockHook_)
+      blockHook_(block, size);
+    blocks_.emplace_back(static_cast<char *>(block));
+    committedBytes_ += size;
+    pendingBytes_ = 0;
+    planStart_ = slots_.size();
+    return true;
+  }
+
+  char *get(int slot) const {
+    assert((slot >= 0) && (static_cast<size_t>(slot) < slots_.size()));
+    const Slot &s = slots_[slot];
+    assert(s.block < blocks_.size() && "slot is not committed");
+    return blocks_[s.block].get() + s.offset;
+  }
+
+  size_t getSlotSize(int slot) const {
+    return getClassSize(slots_[slot].sizeClass);
+  }
+  size_t getNumSlots() const { return slots_.size(); }
+  size_t getNumBlocks() const { return blocks_.size(); }
+  size_t getCommittedBytes() const { return committedBytes_; }
+
+  // Four size classes per power of two above the cache line size, so a slot
+  // wastes at most a quarter of its size
+  static size_t getSizeClass(size_t size) {
+    if (size <= slotAlignment)
+      return 0;
+    size_t e = 63 - __builtin_clzll(size - 1); // 2^e < size <= 2^(e+1)
+    size_t step = size_t(1) << (e - 2);
+    return 1 + (e - 6) * 4 + (size - (size_t(1) << e) - 1) / step;
+  }
+  static size_t getClassSize(size_t sizeClass) {
+    if (sizeClass == 0)
+      return slotAlignment;
+    size_t e = 6 + (sizeClass - 1) / 4;
+    size_t step = size_t(1) << (e - 2);
+    return (size_t(1) << e) + step * ((sizeClass - 1) % 4 + 1);
+  }
+
+private:
+  static size_t alignTo(size_t x, size_t m) { return (x + m - 1) / m * m; }
+
+  struct Slot {
+    size_t sizeClass;
+    size_t block;
+    size_t offset;
+  };
+  struct BlockDeleter {
+    void operator()(char *p) const { free(p); }
+  };
+
+  std::vector<Slot> slots_;
+  // Released slots of the current plan, by size class
+  std::vector<std::vector<int>> freeSlots_;
+  std::vector<std::unique_ptr<char, BlockDeleter>> blocks_;
+  BlockHook blockHook_;
+  size_t planStart_ = 0;
+  size_t pendingBytes_ = 0;
+  size_t committedBytes_ = 0;
+};
+
+} // namespace aicppp
+
+#endif // PREPOSTPROCARENA_H
@@ -2,11 +2,12 @@
 // SPDX-License-Identifier: BSD-3-Clause-Clear
 
 #include "PrePostProc.h"
+#include "PrePostProcArena.h"
 
 #include "AICNetworkDesc.pb.h"
 
 #include <inttypes.h>
-#include <list>
+#include <new>
 
 using namespace aicnwdesc;
 using google::protobuf::RepeatedField;
@@ -155,8 +156,6 @@ public:
     return (T *)getBufferRaw(ppp);
   }
 
-  void allocIfNeeded(PPP_CLASS *ppp);
-
   dataType type_;
   float scale_;
   int32_t offset_;
@@ -184,6 +183,9 @@ public:
 
   void preProcessInputs(const BufferBindings &bindings) override;
   void postProcessOutputs(const BufferBindings &bindings) override;
+  void setTempBlockHook(TempBlockHook hook) override {
+    tempArena_.setBlockHook(std::move(hook));
+  }
 
   size_t getDMABufferSize(int bindingNum) const {
     assert(bindings_);
@@ -200,22 +202,13 @@ private:
   friend class Tensor;
   void allocateTemps(
       const std::vector<std::vector<std::unique_ptr<Transform>>> &xfms);
-  char *getTempBuffer(int size);
-  void freeTempBuffer(Tensor &t);
-  struct Buffer {
-    Buffer() : buf(nullptr), size(0) {}
-    Buffer(char *buf, int size) : buf(buf), size(size) {}
-    char *buf;
-    int size;
-  };
-  std::list<Buffer> freeBuffers_;
+  TempArena tempArena_;
 
   // Number of partial inputs per DMA buffer.
   std::vector<int> numPartialInputs_;
 
   void prepareInputTransforms(int numDMABuffers);
   void prepareOutputTransforms();
-  std::vector<std::unique_ptr<char[]>> allocedBuffers_;
   std::vector<std::vector<std::unique_ptr<Transform>>> inputTransforms_;
   std::vector<std::vector<std::unique_ptr<Transform>>> outputTransforms_;
 
@@ -236,11 +229,6 @@ PPP_CLASS::PPP_CLASS(const networkDescriptor *nwDesc) : nwDesc_(nwDesc) {
   AICPPP_DEBUG(printf("creating PPP %p\n", this));
 }
 
-void Tensor::allocIfNeeded(PPP_CLASS *ppp) {
-  if (buf_.kind == Binding::Kind::Temp && buf_.buf == nullptr)
-    buf_.buf = ppp->getTempBuffer(getSizeInBytes());
-}
-
 size_t Tensor::getBufferRawSize(PPP_CLASS *ppp) const {
   switch (buf_.kind) {
   case Binding::User:
@@ -761,10 +749,15 @@ void PPP_CLASS::postProcessOutputs(const BufferBindings &bindings) {
   bindings_ = nullptr;
 }
 
+// Plans the temporaries of one set of transforms and backs them with a
+// single arena block. A temp is live from the transform that writes it to
+// the transform that reads it, after which its slot is reused.
 void PPP_CLASS::allocateTemps(
     const std::vector<std::vector<std::unique_ptr<Transform>>> &xfms) {
 
-  std::vector<char *> tempBuffers;
+  std::vector<int> tempSlots;
+  // Tensors are pointed at their slot once the block is allocated
+  std::vector<std::pair<Tensor *, int>> placements;
 
   for (auto &ioxfms : xfms) {
     for (auto &xfm : ioxfms) {
@@ -773,7 +766,8 @@ void PPP_CLASS::allocateTemps(
         assert(src.buf_.buf == nullptr);
         int tempNum = src.buf_.num;
         assert(tempNum != -1);
-        src.buf_.buf = tempBuffers[tempNum];
+        assert(static_cast<size_t>(tempNum) < tempSlots.size());
+        placements.emplace_back(&src, tempSlots[tempNum]);
       }
 
       Tensor &dst = xfm->dstT_;
@@ -781,54 +775,32 @@ void PPP_CLASS::allocateTemps(
         assert(dst.buf_.buf == nullptr);
         int tempNum = dst.buf_.num;
         assert(tempNum != -1);
-        if (tempBuffers.size() <= static_cast<size_t>(tempNum))
-          tempBuffers.resize(tempNum + 1, nullptr);
-        assert(tempBuffers[tempNum] == nullptr);
-        tempBuffers[tempNum] = getTempBuffer(dst.getSizeInBytes());
-        dst.buf_.buf = tempBuffers[tempNum];
+        if (tempSlots.size() <= static_cast<size_t>(tempNum))
+          tempSlots.resize(tempNum + 1, -1);
+        assert(tempSlots[tempNum] == -1);
+        tempSlots[tempNum] = tempArena_.reserve(dst.getSizeInBytes());
+        placements.emplace_back(&dst, tempSlots[tempNum]);
+
+        AICPPP_DEBUG(printf("%p temp %d size %zu slot %d\n", this, tempNum,
+                            dst.getSizeInBytes(), tempSlots[tempNum]));
       }
 
       if (src.buf_.kind == Binding::Temp) {
-        freeTempBuffer(src);
-        tempBuffers[src.buf_.num] = nullptr;
+        tempArena_.release(tempSlots[src.buf_.num]);
+        tempSlots[src.buf_.num] = -1;
       }
     }
   }
-}
-
-char *PPP_CLASS::getTempBuffer(int size) {
-
-  AICPPP_DEBUG(printf("%p getTempBuffer %d\n", this, size));
-
-  for (auto it = freeBuffers_.begin(), ie = freeBuffers_.end(); it != ie;
-       ++it) {
-
-    AICPPP_DEBUG(printf("%p checking free buffer size %d\n", this, it->size));
-
-    if (it->size >= size) {
-
-      AICPPP_DEBUG(printf("%p reusing free buffer\n", this));
-
-      char *buf = it->buf;
-      freeBuffers_.erase(it);
-      return buf;
-    }
-  }
-
-  AICPPP_DEBUG(printf("%p allocate buffer %d\n", this, size));
-
-  allocedBuffers_.emplace_back(new char[size]);
-  return allocedBuffers_.back().get();
-}
 
-void PPP_CLASS::freeTempBuffer(Tensor &t) {
-  if (t.buf_.kind != Binding::Kind::Temp)
-    return;
+  if (!tempArena_.commit())
+    throw std::bad_alloc();
 
-  AICPPP_DEBUG(printf("%p adding free buffer\n", this));
+  for (auto &placement : placements)
+    placement.first->buf_.buf = tempArena_.get(placement.second);
 
-  assert(t.buf_.buf != nullptr);
-  freeBuffers_.emplace_front(t.buf_.buf, t.getSizeInBytes());
+  AICPPP_DEBUG(printf("%p temp arena %zu slots %zu bytes\n", this,
+                      tempArena_.getNumSlots(),
+                      tempArena_.getCommittedBytes()));
 }
 
 } // namespace PPP_CORE
@@ -70,10 +70,50 @@ struct QpcSegment {
 };
 
 enum CompressionType {
-  FASTPATH = 0, // Fast path, no compression
-  SLOWPATH = 1  // Slow path for offline use compressed
+  FASTPATH = 0,  // Fast path, no compression
+  SLOWPATH = 1,  // Slow path for offline use compressed
+  COMPRESSED = 2 // Slow path layout, segment data is block compressed
 };
 
+// Codec used for the blocks of a compressed segment. LZ4 blocks use the
+// standard LZ4 block format, so they can be inspected with stock tooling.
+enum QpcCodec : uint32_t { QPC_CODEC_NONE = 0, QPC_CODEC_LZ4 = 1 };
+
+#define AICQPC_SEGMENT_MAGIC_NUMBER 0x5A435051 // "QPCZ"
+#define AICQPC_SEGMENT_RAW_BLOCK 0x80000000u
+
+// In a COMPRESSED QPC every segment starts with this header. QpcSegment::size
+// is the stored size including the header, QpcSegment::offset is still the
+// uncompressed size of the static constants.
+// The header is followed by numBlocks uint32_t stored block sizes and the
+// blocks back to back. Blocks are independent and all but the last one
+// decompress to blockSize bytes. A stored size with AICQPC_SEGMENT_RAW_BLOCK
+// set is a block that did not compress and is kept as is.
+// With codec QPC_CODEC_NONE numBlocks is 0 and the raw data follows the
+// header.
+struct QpcCompressedSegmentHeader {
+  uint32_t magicNumber;
+  uint32_t codec;
+  uint32_t blockSize;
+  uint32_t numBlocks;
+  uint64_t rawSize;
+};
+
+struct QpcCompressionOptions {
+  QpcCodec codec = QPC_CODEC_LZ4;
+  // Independent block size, upper bound on the decompression granularity
+  uint32_t blockSize = 1024 * 1024;
+  // Worker threads, 0 uses all hardware threads
+  uint32_t numThreads = 0;
+  // Segments smaller than this are stored uncompressed
+  uint64_t minSegmentSize = 4096;
+};
+
+// Receives decompressed segment data in order. \p rawOffset is the offset of
+// \p chunk within the uncompressed segment. A non zero return aborts.
+using QpcChunkSink = std::function<int(const uint8_t *chunk, size_t chunkSize,
+                                       uint64_t rawOffset)>;
+
 struct QAicQpc {
   QpcHeader hdr;
   uint64_t numImages;
@@ -96,6 +136,10 @@ struct QpcSegmentDesc {
 // Create an empty QPC handle object
 int createQpcHandle(QAicQpcHandle **handle, CompressionType c);
 
+// Set the options used to compress segments of a COMPRESSED handle
+int setQpcCompressionOptions(QAicQpcHandle *handle,
+                             const QpcCompressionOptions &options);
+
 // Build up a QPC object from a qpc segment array.
 int buildFromSegments(QAicQpcHandle *handle, const QpcSegment *segments,
                       size_t numSegments);
@@ -104,6 +148,12 @@ int buildFromSegments(QAicQpcHandle *handle, const QpcSegment *segments,
 int buildFromSegments(const std::vector<QpcSegmentDesc> &segmentVec,
                       const std::string &qpcPath);
 
+// Write a COMPRESSED QPC object to qpcPath from QPC segment descriptor array.
+// File backed constants are compressed while streaming from disk.
+int buildFromSegments(const std::vector<QpcSegmentDesc> &segmentVec,
+                      const std::string &qpcPath,
+                      const QpcCompressionOptions &options);
+
 // Get serialized QPC object. This buffer is valid only till the handle is
 // not destroyed
 int getSerializedQpc(QAicQpcHandle *handle, uint8_t **serializedQpc,
@@ -143,6 +193,41 @@ uint8_t *copyQpcBuffer(uint8_t *destination, uint8_t *source, size_t destSize);
 bool getQPCSegment(const uint8_t *source, const char *segName, uint8_t **segBuf,
                    size_t *segSize, size_t offset);
 
+// Returns true if the QPC buffer \p source is a COMPRESSED QPC.
+// getQPCSegment only returns segments of a COMPRESSED QPC that are stored
+// uncompressed, use readQPCSegment or streamQPCSegment for the others.
+bool isQpcCompressed(const uint8_t *source);
+
+// Uncompressed size of a segment and its static constants size (the
+// QpcSegment offset). Works for every layout getQPCSegment supports.
+// return 0 on success, -ENOENT if the segment does not exist, -EBADMSG if it
+// is corrupt
+int getQPCSegmentSize(const uint8_t *source, const char *segName,
+                      size_t *rawSize, size_t *rawOffset);
+
+// Segment as it is stored in the QPC, compressed or not, without decoding
+// it. Equal stored bytes decode to equal data.
+// return 0 on success, -ENOENT if the segment does not exist
+int getQPCStoredSegment(const uint8_t *source, const char *segName,
+                        const uint8_t **stored, size_t *storedSize);
+
+// Decompresses the segment into \p dest using up to \p numThreads threads
+// (0 for all hardware threads).
+// return 0 on success, -ENOENT if the segment does not exist, -EBADMSG if it
+// is corrupt
+int readQPCSegment(const uint8_t *source, const char *segName,
+                   std::vector<uint8_t> &dest, unsigned numThreads);
+
+// Decompresses [rawStart, rawStart + rawSize) of the segment and passes it
+// to \p sink in order. Blocks are decompressed on up to \p numThreads
+// threads while the sink consumes the previous batch. Uncompressed segments
+// are passed to the sink without a copy.
+// return 0 on success, the sink return code if it aborted, negative errno
+// otherwise
+int streamQPCSegment(const uint8_t *source, const char *segName,
+                     uint64_t rawStart, uint64_t rawSize, unsigned numThreads,
+                     const QpcChunkSink &sink);
+
 //  This function iterates over the vector of segments and returns an iterator
 //  to the requested segment if present or end() iterator if absent
 //  This function does not modify anything
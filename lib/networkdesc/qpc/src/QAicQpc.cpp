@@ -4,11 +4,18 @@
 #include "QAicQpc.h"
 // #include "crc32.h"
 #include "elfio/elfio.hpp"
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <climits>
+#include <deque>
+#include <fstream>
+#include <future>
 #include <iostream>
 #include <malloc.h>
 #include <memory>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -34,6 +41,7 @@ struct QAicQpcOffsets {
 
 struct QAicQpcHandle {
   uint64_t compressionType;
+  QpcCompressionOptions compressionOptions;
   std::vector<uint8_t> *qpcBuffer;
   QAicQpcOffsets *qpcOffsets;
 };
@@ -64,6 +72,463 @@ size_t writeElement(const T *src, size_t elts, std::vector<uint8_t> &buffer,
   return alignTo(offset + bytes,
                  8); // Return an 8 byte aligned offset for next op
 }
+
+//----------------------------------------------------------------------------
+// LZ4 block format codec. Only the block format is implemented, framing is
+// provided by QpcCompressedSegmentHeader.
+//----------------------------------------------------------------------------
+constexpr size_t lz4MinMatch = 4;
+constexpr size_t lz4LastLiterals = 5;
+constexpr size_t lz4MatchFindLimit = 12;
+constexpr size_t lz4MaxDistance = 65535;
+constexpr uint32_t lz4HashLog = 16;
+constexpr uint32_t maxBlockSize = 64 * 1024 * 1024;
+
+static uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint32_t lz4Hash(uint32_t sequence) {
+  return (sequence * 2654435761U) >> (32 - lz4HashLog);
+}
+
+static bool lz4WriteLength(uint8_t *&op, const uint8_t *oend, size_t length) {
+  for (; length >= 255; length -= 255) {
+    if (op >= oend) {
+      return false;
+    }
+    *op++ = 255;
+  }
+  if (op >= oend) {
+    return false;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return true;
+}
+
+// Writes one sequence, a zero matchLength writes the trailing literals
+static bool lz4WriteSequence(uint8_t *&op, const uint8_t *oend,
+                             const uint8_t *literals, size_t literalLength,
+                             size_t offset, size_t matchLength) {
+  if (op >= oend) {
+    return false;
+  }
+  uint8_t *token = op++;
+  *token = static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4);
+  if ((literalLength >= 15) && !lz4WriteLength(op, oend, literalLength - 15)) {
+    return false;
+  }
+  if (static_cast<size_t>(oend - op) < literalLength) {
+    return false;
+  }
+  memcpy(op, literals, literalLength);
+  op += literalLength;
+  if (matchLength == 0) {
+    return true;
+  }
+  if (oend - op < 2) {
+    return false;
+  }
+  *op++ = static_cast<uint8_t>(offset);
+  *op++ = static_cast<uint8_t>(offset >> 8);
+  size_t extra = matchLength - lz4MinMatch;
+  *token |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+  return (extra < 15) || lz4WriteLength(op, oend, extra - 15);
+}
+
+// Greedy single pass compression. Returns the compressed size, or 0 if it
+// does not fit in dstCapacity.
+static size_t lz4CompressBlock(const uint8_t *src, size_t srcSize,
+                               uint8_t *dst, size_t dstCapacity) {
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  const uint8_t *iend = src + srcSize;
+  uint8_t *op = dst;
+  const uint8_t *oend = dst + dstCapacity;
+
+  if (srcSize > lz4MatchFindLimit) {
+    const uint8_t *mflimit = iend - lz4MatchFindLimit;
+    const uint8_t *matchlimit = iend - lz4LastLiterals;
+    std::vector<uint32_t> table(1u << lz4HashLog, 0);
+    uint32_t misses = 0;
+    while (ip < mflimit) {
+      uint32_t sequence = read32(ip);
+      uint32_t &entry = table[lz4Hash(sequence)];
+      const uint8_t *ref = src + entry;
+      entry = static_cast<uint32_t>(ip - src);
+      if ((ref >= ip) || (static_cast<size_t>(ip - ref) > lz4MaxDistance) ||
+          (read32(ref) != sequence)) {
+        // Step faster through data that does not compress
+        ip += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+      while ((ip > anchor) && (ref > src) && (ip[-1] == ref[-1])) {
+        ip--;
+        ref--;
+      }
+      const uint8_t *matchEnd = ip + lz4MinMatch;
+      const uint8_t *refEnd = ref + lz4MinMatch;
+      while ((matchEnd < matchlimit) && (*matchEnd == *refEnd)) {
+        matchEnd++;
+        refEnd++;
+      }
+      if (!lz4WriteSequence(op, oend, anchor, ip - anchor, ip - ref,
+                            matchEnd - ip)) {
+        return 0;
+      }
+      table[lz4Hash(read32(matchEnd - 2))] =
+          static_cast<uint32_t>(matchEnd - 2 - src);
+      ip = matchEnd;
+      anchor = ip;
+    }
+  }
+  if (!lz4WriteSequence(op, oend, anchor, iend - anchor, 0, 0)) {
+    return 0;
+  }
+  return op - dst;
+}
+
+static bool lz4ReadLength(const uint8_t *&ip, const uint8_t *iend,
+                          size_t &length) {
+  uint8_t b;
+  do {
+    if (ip >= iend) {
+      return false;
+    }
+    b = *ip++;
+    length += b;
+  } while (b == 255);
+  return true;
+}
+
+// Returns true if src decodes to exactly dstSize bytes. Every read and write
+// is bounds checked, corrupt input never touches memory outside the buffers.
+static bool lz4DecompressBlock(const uint8_t *src, size_t srcSize,
+                               uint8_t *dst, size_t dstSize) {
+  const uint8_t *ip = src;
+  const uint8_t *iend = src + srcSize;
+  uint8_t *op = dst;
+  uint8_t *oend = dst + dstSize;
+
+  while (ip < iend) {
+    uint8_t token = *ip++;
+    size_t literalLength = token >> 4;
+    if ((literalLength == 15) && !lz4ReadLength(ip, iend, literalLength)) {
+      return false;
+    }
+    if ((static_cast<size_t>(iend - ip) < literalLength) ||
+        (static_cast<size_t>(oend - op) < literalLength)) {
+      return false;
+    }
+    memcpy(op, ip, literalLength);
+    ip += literalLength;
+    op += literalLength;
+    if (ip == iend) {
+      break; // The last sequence has no match
+    }
+    if (iend - ip < 2) {
+      return false;
+    }
+    size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    if ((offset == 0) || (offset > static_cast<size_t>(op - dst))) {
+      return false;
+    }
+    size_t matchLength = token & 15;
+    if ((matchLength == 15) && !lz4ReadLength(ip, iend, matchLength)) {
+      return false;
+    }
+    matchLength += lz4MinMatch;
+    if (static_cast<size_t>(oend - op) < matchLength) {
+      return false;
+    }
+    const uint8_t *ref = op - offset;
+    if (offset >= matchLength) {
+      memcpy(op, ref, matchLength);
+    } else {
+      // Overlapping match repeats the last offset bytes
+      for (size_t i = 0; i < matchLength; i++) {
+        op[i] = ref[i];
+      }
+    }
+    op += matchLength;
+  }
+  return op == oend;
+}
+
+//----------------------------------------------------------------------------
+// Compressed segments
+//----------------------------------------------------------------------------
+static unsigned workerCount(unsigned numThreads, uint64_t numItems) {
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return static_cast<unsigned>(
+      std::min<uint64_t>(numThreads, std::max<uint64_t>(numItems, 1)));
+}
+
+// Runs fn(0) .. fn(count - 1) on up to numThreads threads, including the
+// calling thread
+static void parallelFor(uint64_t count, unsigned numThreads,
+                        const std::function<void(uint64_t)> &fn) {
+  unsigned workers = workerCount(numThreads, count);
+  std::atomic<uint64_t> next{0};
+  auto run = [&]() {
+    for (uint64_t i = next++; i < count; i = next++) {
+      fn(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < workers; t++) {
+    threads.emplace_back(run);
+  }
+  run();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+static bool validOptions(const QpcCompressionOptions &options) {
+  return ((options.codec == QPC_CODEC_NONE) ||
+          (options.codec == QPC_CODEC_LZ4)) &&
+         (options.blockSize != 0) && (options.blockSize <= maxBlockSize);
+}
+
+static bool segmentHeader(uint64_t rawSize,
+                          const QpcCompressionOptions &options,
+                          QpcCompressedSegmentHeader &hdr) {
+  hdr.magicNumber = AICQPC_SEGMENT_MAGIC_NUMBER;
+  hdr.codec = (rawSize < options.minSegmentSize) ? QPC_CODEC_NONE
+                                                 : options.codec;
+  hdr.blockSize = 0;
+  hdr.numBlocks = 0;
+  hdr.rawSize = rawSize;
+  if (hdr.codec != QPC_CODEC_NONE) {
+    uint64_t numBlocks = (rawSize + options.blockSize - 1) / options.blockSize;
+    if (numBlocks > UINT32_MAX) {
+      return false;
+    }
+    hdr.blockSize = options.blockSize;
+    hdr.numBlocks = static_cast<uint32_t>(numBlocks);
+  }
+  return true;
+}
+
+static uint64_t blockRawSize(const QpcCompressedSegmentHeader &hdr,
+                             uint64_t block) {
+  return std::min<uint64_t>(hdr.blockSize, hdr.rawSize - block * hdr.blockSize);
+}
+
+// Compresses [data, data + size) block by block. Blocks that do not shrink
+// are stored raw.
+static void compressBlocks(const uint8_t *data, uint64_t size,
+                           const QpcCompressionOptions &options,
+                           std::vector<std::vector<uint8_t>> &blocks,
+                           std::vector<uint32_t> &storedSizes) {
+  uint64_t numBlocks = (size + options.blockSize - 1) / options.blockSize;
+  blocks.assign(numBlocks, {});
+  storedSizes.assign(numBlocks, 0);
+  parallelFor(numBlocks, options.numThreads, [&](uint64_t b) {
+    const uint8_t *raw = data + b * options.blockSize;
+    size_t rawSize = std::min<uint64_t>(options.blockSize,
+                                        size - b * options.blockSize);
+    std::vector<uint8_t> &block = blocks[b];
+    block.resize(rawSize);
+    size_t stored = (rawSize > 1)
+                        ? lz4CompressBlock(raw, rawSize, block.data(),
+                                           rawSize - 1)
+                        : 0;
+    if (stored == 0) {
+      memcpy(block.data(), raw, rawSize);
+      storedSizes[b] =
+          static_cast<uint32_t>(rawSize) | AICQPC_SEGMENT_RAW_BLOCK;
+    } else {
+      block.resize(stored);
+      storedSizes[b] = static_cast<uint32_t>(stored);
+    }
+  });
+}
+
+static void appendBytes(std::vector<uint8_t> &out, const void *src,
+                        size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(src);
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+// Encodes a complete segment: header, block table and blocks
+static int compressSegment(const uint8_t *data, uint64_t size,
+                           const QpcCompressionOptions &options,
+                           std::vector<uint8_t> &out) {
+  QpcCompressedSegmentHeader hdr;
+  if (!segmentHeader(size, options, hdr)) {
+    return -EINVAL;
+  }
+  out.clear();
+  appendBytes(out, &hdr, sizeof(hdr));
+  if (hdr.codec == QPC_CODEC_NONE) {
+    appendBytes(out, data, size);
+    return 0;
+  }
+  std::vector<std::vector<uint8_t>> blocks;
+  std::vector<uint32_t> storedSizes;
+  compressBlocks(data, size, options, blocks, storedSizes);
+  appendBytes(out, storedSizes.data(), storedSizes.size() * sizeof(uint32_t));
+  for (const auto &block : blocks) {
+    appendBytes(out, block.data(), block.size());
+  }
+  return 0;
+}
+
+// Validated view of a compressed segment. Segment data is only byte aligned
+// in QPC files, so the header and block table are copied out.
+struct SegmentView {
+  QpcCompressedSegmentHeader hdr;
+  const uint8_t *data; // First block, or the raw data for QPC_CODEC_NONE
+  std::vector<uint32_t> storedSizes;
+  std::vector<uint64_t> blockOffsets;
+};
+
+static bool parseSegment(const QpcSegment &segment, SegmentView &view) {
+  QpcCompressedSegmentHeader &hdr = view.hdr;
+  if ((segment.start == nullptr) || (segment.size < sizeof(hdr))) {
+    return false;
+  }
+  memcpy(&hdr, segment.start, sizeof(hdr));
+  uint64_t avail = segment.size - sizeof(hdr);
+  view.data = segment.start + sizeof(hdr);
+  if (hdr.magicNumber != AICQPC_SEGMENT_MAGIC_NUMBER) {
+    return false;
+  }
+  if (hdr.codec == QPC_CODEC_NONE) {
+    return (hdr.numBlocks == 0) && (hdr.rawSize <= avail);
+  }
+  if ((hdr.codec != QPC_CODEC_LZ4) || (hdr.blockSize == 0) ||
+      (hdr.blockSize > maxBlockSize) ||
+      (hdr.numBlocks !=
+       (hdr.rawSize + hdr.blockSize - 1) / hdr.blockSize)) {
+    return false;
+  }
+  uint64_t tableSize = static_cast<uint64_t>(hdr.numBlocks) * sizeof(uint32_t);
+  if (tableSize > avail) {
+    return false;
+  }
+  view.storedSizes.resize(hdr.numBlocks);
+  memcpy(view.storedSizes.data(), view.data, tableSize);
+  view.data += tableSize;
+  avail -= tableSize;
+
+  view.blockOffsets.resize(hdr.numBlocks);
+  uint64_t offset = 0;
+  for (uint32_t b = 0; b < hdr.numBlocks; b++) {
+    uint64_t stored = view.storedSizes[b];
+    if (stored & AICQPC_SEGMENT_RAW_BLOCK) {
+      stored &= ~AICQPC_SEGMENT_RAW_BLOCK;
+      if (stored != blockRawSize(hdr, b)) {
+        return false;
+      }
+    }
+    view.blockOffsets[b] = offset;
+    offset += stored;
+  }
+  return offset <= avail;
+}
+
+static bool decodeBlock(const SegmentView &view, uint64_t block,
+                        uint8_t *dst) {
+  uint32_t stored = view.storedSizes[block];
+  const uint8_t *src = view.data + view.blockOffsets[block];
+  uint64_t rawSize = blockRawSize(view.hdr, block);
+  if (stored & AICQPC_SEGMENT_RAW_BLOCK) {
+    memcpy(dst, src, rawSize);
+    return true;
+  }
+  return lz4DecompressBlock(src, stored, dst, rawSize);
+}
+
+// Decodes blocks [first, last) to dst on up to numThreads threads
+static bool decodeBlocks(const SegmentView &view, uint64_t first,
+                         uint64_t last, uint8_t *dst, unsigned numThreads) {
+  std::atomic<bool> ok{true};
+  parallelFor(last - first, numThreads, [&](uint64_t i) {
+    if (!decodeBlock(view, first + i, dst + i * view.hdr.blockSize)) {
+      ok = false;
+    }
+  });
+  return ok;
+}
+
+static int decodeSegment(const QpcSegment &segment, bool compressed,
+                         std::vector<uint8_t> &dest, unsigned numThreads) {
+  if (!compressed) {
+    dest.assign(segment.start, segment.start + segment.size);
+    return 0;
+  }
+  SegmentView view;
+  if (!parseSegment(segment, view)) {
+    return -EBADMSG;
+  }
+  if (view.hdr.codec == QPC_CODEC_NONE) {
+    dest.assign(view.data, view.data + view.hdr.rawSize);
+    return 0;
+  }
+  dest.resize(view.hdr.rawSize);
+  return decodeBlocks(view, 0, view.hdr.numBlocks, dest.data(), numThreads)
+             ? 0
+             : -EBADMSG;
+}
+
+// Decodes the blocks covering [rawStart, rawStart + rawSize) in batches of
+// one block per thread. The next batch is decoded while the sink consumes
+// the current one.
+static int streamBlocks(const SegmentView &view, uint64_t rawStart,
+                        uint64_t rawSize, unsigned numThreads,
+                        const QpcChunkSink &sink) {
+  const uint64_t blockSize = view.hdr.blockSize;
+  const uint64_t rawEnd = rawStart + rawSize;
+  const uint64_t firstBlock = rawStart / blockSize;
+  const uint64_t lastBlock = (rawEnd + blockSize - 1) / blockSize;
+  const uint64_t batchBlocks = workerCount(numThreads, lastBlock - firstBlock);
+
+  std::unique_ptr<uint8_t[]> batches[2];
+  for (auto &batch : batches) {
+    batch.reset(new (std::nothrow) uint8_t[batchBlocks * blockSize]);
+    if (batch == nullptr) {
+      return -ENOMEM;
+    }
+  }
+  auto decode = [&](uint64_t first, int slot) {
+    return decodeBlocks(view, first, std::min(first + batchBlocks, lastBlock),
+                        batches[slot].get(), numThreads);
+  };
+
+  std::future<bool> pending =
+      std::async(std::launch::async, decode, firstBlock, 0);
+  int slot = 0;
+  for (uint64_t first = firstBlock; first < lastBlock;
+       first += batchBlocks, slot ^= 1) {
+    if (!pending.get()) {
+      return -EBADMSG;
+    }
+    uint64_t next = first + batchBlocks;
+    if (next < lastBlock) {
+      pending = std::async(std::launch::async, decode, next, slot ^ 1);
+    }
+    uint64_t chunkStart = std::max(first * blockSize, rawStart);
+    uint64_t chunkEnd = std::min(next * blockSize, rawEnd);
+    int rc = sink(batches[slot].get() + (chunkStart - first * blockSize),
+                  chunkEnd - chunkStart, chunkStart);
+    if (rc != 0) {
+      if (pending.valid()) {
+        pending.wait();
+      }
+      return rc;
+    }
+  }
+  return 0;
+}
 } // namespace aicqpc
 
 static uint64_t writeQAicQpcObject(QAicQpcHandle *handle,
@@ -89,7 +554,7 @@ static uint64_t writeQAicQpcObject(QAicQpcHandle *handle,
                                        *handle->qpcBuffer, writeOffset, commit);
   }
 
-  if (handle->compressionType == SLOWPATH) {
+  if (handle->compressionType != FASTPATH) {
     // Set names offset
     for (segmentCount = 0; segmentCount < numSegments; ++segmentCount) {
       (offsets->imageNameOffsets)->push_back(writeOffset);
@@ -119,7 +584,7 @@ static void fixupQAicQpcObject(QAicQpcHandle *handle, uint8_t *base) {
       reinterpret_cast<QpcSegment *>(computeAddr(base, offsets->imagesOffset));
 
   // No fixup needed for the segment contents in case of fastpath
-  if (handle->compressionType == SLOWPATH) {
+  if (handle->compressionType != FASTPATH) {
     for (segmentCount = 0; segmentCount < aicQpc->numImages; ++segmentCount) {
       aicQpc->images[segmentCount].name = reinterpret_cast<char *>(
           computeAddr(base, offsets->imageNameOffsets->at(segmentCount)));
@@ -195,6 +660,7 @@ int createQpcHandle(QAicQpcHandle **handle, CompressionType c) {
   }
 
   (*handle)->compressionType = static_cast<uint64_t>(c);
+  (*handle)->compressionOptions = QpcCompressionOptions();
 
   // Default init
   (*handle)->qpcBuffer = new std::vector<uint8_t>();
@@ -210,6 +676,15 @@ int createQpcHandle(QAicQpcHandle **handle, CompressionType c) {
   return 0;
 }
 
+int setQpcCompressionOptions(QAicQpcHandle *handle,
+                             const QpcCompressionOptions &options) {
+  if ((handle == nullptr) || !aicqpc::validOptions(options)) {
+    return -EINVAL;
+  }
+  handle->compressionOptions = options;
+  return 0;
+}
+
 static int convertNetworkElfSection(
     std::stringstream &is, std::ostringstream &os,
     const std::string &sourceSectionName, const std::string &destSectionName,
@@ -377,8 +852,44 @@ static int convertNetworkElfSection(
   return 0;
 }
 
-static void serializeFromVector(QAicQpcHandle *handle,
-                                std::vector<QpcSegment> &segmentVector) {
+// Replaces the segments of a COMPRESSED QPC with their uncompressed data
+static int expandSegments(const QAicQpc *qpc,
+                          std::vector<QpcSegment> &segmentVector,
+                          std::deque<std::vector<uint8_t>> &rawSegments) {
+  segmentVector.assign(qpc->images, qpc->images + qpc->numImages);
+  if (qpc->hdr.compressionType != COMPRESSED) {
+    return 0;
+  }
+  for (auto &segment : segmentVector) {
+    rawSegments.emplace_back();
+    if (int rc = aicqpc::decodeSegment(segment, true, rawSegments.back(), 0);
+        rc != 0) {
+      return rc;
+    }
+    segment.start = rawSegments.back().data();
+    segment.size = rawSegments.back().size();
+  }
+  return 0;
+}
+
+static int serializeFromVector(QAicQpcHandle *handle,
+                               std::vector<QpcSegment> &segmentVector) {
+  // Compressed segments only need to live until they are copied in
+  std::deque<std::vector<uint8_t>> compressedSegments;
+  if (handle->compressionType == COMPRESSED) {
+    for (auto &segment : segmentVector) {
+      compressedSegments.emplace_back();
+      if (int rc = aicqpc::compressSegment(segment.start, segment.size,
+                                           handle->compressionOptions,
+                                           compressedSegments.back());
+          rc != 0) {
+        return rc;
+      }
+      segment.start = compressedSegments.back().data();
+      segment.size = compressedSegments.back().size();
+    }
+  }
+
   // Clear the buffer
   (handle->qpcBuffer)->clear();
   uint64_t qpcBufferSize = 0;
@@ -392,6 +903,7 @@ static void serializeFromVector(QAicQpcHandle *handle,
       writeQAicQpcObject(handle, &segmentVector[0], segmentVector.size(), true);
 
   fixupQAicQpcObject(handle, (handle->qpcBuffer)->data());
+  return 0;
 }
 
 int convertNetworkElfSection(
@@ -399,8 +911,11 @@ int convertNetworkElfSection(
     size_t &serialQpcSz, const std::string &sourceSectionName,
     const std::string &destSectionName,
     std::function<std::vector<uint8_t>(const uint8_t *, size_t)> convFunction) {
-  std::vector<QpcSegment> segmentVector{qpc->images,
-                                        qpc->images + qpc->numImages};
+  std::vector<QpcSegment> segmentVector;
+  std::deque<std::vector<uint8_t>> rawSegments;
+  if (int rc = expandSegments(qpc, segmentVector, rawSegments); rc != 0) {
+    return rc;
+  }
 
   // Find network elf
   std::vector<QpcSegment>::iterator networkElfIt =
@@ -436,7 +951,9 @@ int convertNetworkElfSection(
       rc != 0) {
     return rc;
   }
-  serializeFromVector(handle, segmentVector);
+  if (int rc = serializeFromVector(handle, segmentVector); rc != 0) {
+    return rc;
+  }
   if (int rc = getSerializedQpc(handle, &serialQpc, &serialQpcSz); rc != 0) {
     return rc;
   }
@@ -460,9 +977,7 @@ int buildFromSegments(QAicQpcHandle *handle, const QpcSegment *segments,
 
   segmentVector.assign(segments, segments + numSegments);
 
-  serializeFromVector(handle, segmentVector);
-
-  return 0;
+  return serializeFromVector(handle, segmentVector);
 }
 
 int getSerializedQpc(QAicQpcHandle *handle, uint8_t **serializedQpc,
@@ -503,9 +1018,14 @@ int buildFromQpc(QAicQpcHandle *handle, const QAicQpc *qpc) {
     return -EINVAL;
   }
 
-  (void)buildFromSegments(handle, qpc->images, qpc->numImages);
+  std::vector<QpcSegment> segmentVector;
+  std::deque<std::vector<uint8_t>> rawSegments;
+  if (int rc = expandSegments(qpc, segmentVector, rawSegments); rc != 0) {
+    return rc;
+  }
 
-  return 0;
+  return buildFromSegments(handle, segmentVector.data(),
+                           segmentVector.size());
 }
 
 void destroyQpcHandle(QAicQpcHandle *handle) {
@@ -557,45 +1077,152 @@ uint8_t *copyQpcBuffer(uint8_t *destination, uint8_t *source, size_t destSize) {
   return destination;
 }
 
+static const QpcSegment *findSegment(const uint8_t *source,
+                                     const char *segName) {
+  uint32_t qpcMagic = AICQPC_MAGIC_NUMBER;
+
+  if (source == nullptr || segName == nullptr ||
+      memcmp(source, (void *)&qpcMagic, sizeof(uint32_t)) != 0) {
+    return nullptr;
+  }
+
+  const QAicQpc *qpc = reinterpret_cast<const QAicQpc *>(source);
+  for (uint64_t count = 0; count < qpc->numImages; count++) {
+    if (strcmp(segName, qpc->images[count].name) == 0) {
+      return &(qpc->images[count]);
+    }
+  }
+  return nullptr;
+}
+
 bool getQPCSegment(const uint8_t *source, const char *segName, uint8_t **segBuf,
                    size_t *segSize, size_t offset) {
-  bool retVal = false;
+  if (segName == nullptr || segBuf == nullptr) {
+    return false;
+  }
+
+  const QpcSegment *found = findSegment(source, segName);
+  if (found == nullptr) {
+    return false;
+  }
+
+  QpcSegment segment = *found;
+  if (isQpcCompressed(source)) {
+    // Only segments stored uncompressed can be returned in place
+    aicqpc::SegmentView view;
+    if (!aicqpc::parseSegment(segment, view) ||
+        (view.hdr.codec != QPC_CODEC_NONE)) {
+      return false;
+    }
+    segment.start = const_cast<uint8_t *>(view.data);
+    segment.size = view.hdr.rawSize;
+  }
+
+  // segment.offset is always 0 for all images sans
+  // constants.bin. At this point for compile time
+  // constants we only have 2 sections.
+  if (segment.offset > 0 && offset == 0) {
+    // Load static compile time constants.
+    *segBuf = segment.start;
+    *segSize = segment.offset;
+  } else {
+    *segBuf = segment.start + segment.offset;
+    *segSize = segment.size - segment.offset;
+  }
+
+  return true;
+}
+
+bool isQpcCompressed(const uint8_t *source) {
   uint32_t qpcMagic = AICQPC_MAGIC_NUMBER;
 
-  if (segName == nullptr || segBuf == nullptr) {
-    return retVal; // false
-  }
-
-  if (source != nullptr) {
-    // Check if the user passed in a QPC image
-    if (memcmp(source, (void *)&qpcMagic, sizeof(uint32_t)) == 0) {
-      // This is a qpc image. Get the constantsdesc
-      const QAicQpc *qpc = reinterpret_cast<const QAicQpc *>(source);
-
-      for (uint64_t count = 0; count < qpc->numImages; count++) {
-        QpcSegment *segment = &(qpc->images[count]);
-        if (strcmp(segName, segment->name) == 0) {
-
-          // segment->offset is always 0 for all images sans
-          // constants.bin. At this point for compile time
-          // constants we only have 2 sections.
-          if (segment->offset > 0 && offset == 0) {
-            // Load static compile time constants.
-            *segBuf = segment->start;
-            *segSize = segment->offset;
-          } else {
-            *segBuf = segment->start + segment->offset;
-            *segSize = segment->size - segment->offset;
-          }
-
-          retVal = true;
-          break;
-        }
-      }
+  if (source == nullptr ||
+      memcmp(source, (void *)&qpcMagic, sizeof(uint32_t)) != 0) {
+    return false;
+  }
+  return reinterpret_cast<const QAicQpc *>(source)->hdr.compressionType ==
+         COMPRESSED;
+}
+
+int getQPCSegmentSize(const uint8_t *source, const char *segName,
+                      size_t *rawSize, size_t *rawOffset) {
+  if (rawSize == nullptr || rawOffset == nullptr) {
+    return -EINVAL;
+  }
+  const QpcSegment *segment = findSegment(source, segName);
+  if (segment == nullptr) {
+    return -ENOENT;
+  }
+
+  if (isQpcCompressed(source)) {
+    aicqpc::SegmentView view;
+    if (!aicqpc::parseSegment(*segment, view)) {
+      return -EBADMSG;
+    }
+    *rawSize = view.hdr.rawSize;
+  } else {
+    *rawSize = segment->size;
+  }
+  *rawOffset = segment->offset;
+  return 0;
+}
+
+int getQPCStoredSegment(const uint8_t *source, const char *segName,
+                        const uint8_t **stored, size_t *storedSize) {
+  if (stored == nullptr || storedSize == nullptr) {
+    return -EINVAL;
+  }
+  const QpcSegment *segment = findSegment(source, segName);
+  if (segment == nullptr) {
+    return -ENOENT;
+  }
+  *stored = segment->start;
+  *storedSize = segment->size;
+  return 0;
+}
+
+int readQPCSegment(const uint8_t *source, const char *segName,
+                   std::vector<uint8_t> &dest, unsigned numThreads) {
+  const QpcSegment *segment = findSegment(source, segName);
+  if (segment == nullptr) {
+    return -ENOENT;
+  }
+  return aicqpc::decodeSegment(*segment, isQpcCompressed(source), dest,
+                               numThreads);
+}
+
+int streamQPCSegment(const uint8_t *source, const char *segName,
+                     uint64_t rawStart, uint64_t rawSize, unsigned numThreads,
+                     const QpcChunkSink &sink) {
+  const QpcSegment *segment = findSegment(source, segName);
+  if (segment == nullptr) {
+    return -ENOENT;
+  }
+  if (!sink) {
+    return -EINVAL;
+  }
+
+  aicqpc::SegmentView view;
+  const uint8_t *rawData = segment->start;
+  uint64_t segmentRawSize = segment->size;
+  if (isQpcCompressed(source)) {
+    if (!aicqpc::parseSegment(*segment, view)) {
+      return -EBADMSG;
     }
+    segmentRawSize = view.hdr.rawSize;
+    rawData = (view.hdr.codec == QPC_CODEC_NONE) ? view.data : nullptr;
   }
 
-  return retVal;
+  if (rawStart > segmentRawSize || rawSize > segmentRawSize - rawStart) {
+    return -EINVAL;
+  }
+  if (rawSize == 0) {
+    return 0;
+  }
+  if (rawData != nullptr) {
+    return sink(rawData + rawStart, rawSize, rawStart);
+  }
+  return aicqpc::streamBlocks(view, rawStart, rawSize, numThreads, sink);
 }
 
 std::vector<QpcSegment>::iterator
@@ -679,9 +1306,86 @@ int writeConstants(std::ofstream &qpcFile, const std::string &inputFilePath,
   return 0;
 }
 
-// Builds the QPC from \p segments.  Writes QPC to \p outputPath.
-int buildFromSegments(const std::vector<QpcSegmentDesc> &segmentVec,
-                      const std::string &qpcPath) {
+/// Incrementally compress constants from inputFile to qpcFile, one block
+/// per thread at a time
+int writeCompressedConstants(std::ofstream &qpcFile,
+                             const std::string &inputFilePath,
+                             std::vector<QpcSegment> &segments, int idx,
+                             const QpcCompressionOptions &options) {
+  std::ifstream inputFile(inputFilePath,
+                          std::ifstream::ate | std::ifstream::binary);
+  if (!inputFile) {
+    std::cout
+        << "Error: buildFromSegments failed. Unable to read segment from file: "
+        << inputFilePath << std::endl;
+    return -EINVAL;
+  }
+
+  uint64_t fileSize = static_cast<uint64_t>(inputFile.tellg());
+  inputFile.seekg(std::ios_base::beg);
+
+  QpcCompressedSegmentHeader hdr;
+  if (!aicqpc::segmentHeader(fileSize, options, hdr)) {
+    return -EINVAL;
+  }
+
+  // The block table is only known once every block is compressed, reserve
+  // it now and fill it in at the end.
+  uint64_t segmentStart = qpcFile.tellp();
+  write(qpcFile, reinterpret_cast<const uint8_t *>(&hdr), sizeof(hdr));
+  uint64_t tableOffset = qpcFile.tellp();
+  std::vector<uint32_t> storedSizes(hdr.numBlocks, 0);
+  write(qpcFile, reinterpret_cast<const uint8_t *>(storedSizes.data()),
+        storedSizes.size() * sizeof(uint32_t));
+
+  const uint64_t batchSize =
+      (hdr.codec == QPC_CODEC_NONE)
+          ? 1024 * 1024
+          : static_cast<uint64_t>(options.blockSize) *
+                aicqpc::workerCount(options.numThreads, hdr.numBlocks);
+  std::vector<uint8_t> batch;
+  std::vector<std::vector<uint8_t>> blocks;
+  std::vector<uint32_t> batchSizes;
+  for (uint64_t pos = 0; pos < fileSize; pos += batch.size()) {
+    batch.resize(std::min(batchSize, fileSize - pos));
+    if (!inputFile.read((char *)batch.data(), batch.size())) {
+      std::cout << "Error: buildFromSegments failed. Unable to read segment "
+                   "from file: "
+                << inputFilePath << std::endl;
+      return -EIO;
+    }
+    if (hdr.codec == QPC_CODEC_NONE) {
+      write(qpcFile, batch.data(), batch.size());
+      continue;
+    }
+    aicqpc::compressBlocks(batch.data(), batch.size(), options, blocks,
+                           batchSizes);
+    std::copy(batchSizes.begin(), batchSizes.end(),
+              storedSizes.begin() + pos / options.blockSize);
+    for (const auto &block : blocks) {
+      write(qpcFile, block.data(), block.size());
+    }
+  }
+
+  uint64_t segmentEnd = qpcFile.tellp();
+  qpcFile.seekp(tableOffset);
+  write(qpcFile, reinterpret_cast<const uint8_t *>(storedSizes.data()),
+        storedSizes.size() * sizeof(uint32_t));
+  qpcFile.seekp(segmentEnd);
+
+  // Record the stored size of this segment
+  segments[idx].size = segmentEnd - segmentStart;
+
+  inputFile.close();
+
+  return 0;
+}
+
+// Builds the QPC from \p segments.  Writes QPC to \p outputPath. Segments
+// are compressed with \p options unless it is null.
+static int writeQpcFile(const std::vector<QpcSegmentDesc> &segmentVec,
+                        const std::string &qpcPath,
+                        const QpcCompressionOptions *options) {
   if (segmentVec.empty()) {
     std::cout
         << "Error: buildFromSegments failed. No segment descriptors provided."
@@ -754,7 +1458,7 @@ int buildFromSegments(const std::vector<QpcSegmentDesc> &segmentVec,
   // we'll have to come back and fix them up after the fact.
   QAicQpc qpc;
   qpc.hdr.size = 0;
-  qpc.hdr.compressionType = SLOWPATH;
+  qpc.hdr.compressionType = (options != nullptr) ? COMPRESSED : SLOWPATH;
   qpc.hdr.base = 0;
   qpc.numImages = numSegments;
   qpc.images = nullptr;
@@ -782,9 +1486,20 @@ int buildFromSegments(const std::vector<QpcSegmentDesc> &segmentVec,
     // If this segment is the constants file, write it directly from
     // the binary file (it hasn't been stored in the segments buffer).
     if (segments[i].name == constantsBinaryFileName) {
-      int res = writeConstants(qpcFile, constantsFilePath, segments, i);
+      int res = (options != nullptr)
+                    ? writeCompressedConstants(qpcFile, constantsFilePath,
+                                               segments, i, *options)
+                    : writeConstants(qpcFile, constantsFilePath, segments, i);
       if (res != 0)
         return res;
+    } else if (options != nullptr) {
+      std::vector<uint8_t> stored;
+      int res = aicqpc::compressSegment(segments[i].start, segments[i].size,
+                                        *options, stored);
+      if (res != 0)
+        return res;
+      write(qpcFile, stored.data(), stored.size());
+      segments[i].size = stored.size();
     } else {
       write(qpcFile, segments[i].start, segments[i].size);
     }
@@ -813,11 +1528,31 @@ int buildFromSegments(const std::vector<QpcSegmentDesc> &segmentVec,
   return 0;
 }
 
+int buildFromSegments(const std::vector<QpcSegmentDesc> &segmentVec,
+                      const std::string &qpcPath) {
+  return writeQpcFile(segmentVec, qpcPath, nullptr);
+}
+
+int buildFromSegments(const std::vector<QpcSegmentDesc> &segmentVec,
+                      const std::string &qpcPath,
+                      const QpcCompressionOptions &options) {
+  if (!aicqpc::validOptions(options)) {
+    std::cout << "Error: buildFromSegments failed. Invalid compression "
+                 "options."
+              << std::endl;
+    return -EINVAL;
+  }
+  return writeQpcFile(segmentVec, qpcPath, &options);
+}
+
 std::unique_ptr<uint8_t[]>
 getNetworkElfSectionDataFromQpc(QAicQpc *qpc, std::string sectionName,
                                 size_t &size) {
-  std::vector<QpcSegment> segmentVector{qpc->images,
-                                        qpc->images + qpc->numImages};
+  std::vector<QpcSegment> segmentVector;
+  std::deque<std::vector<uint8_t>> rawSegments;
+  if (expandSegments(qpc, segmentVector, rawSegments) != 0) {
+    return nullptr;
+  }
   // Find network elf
   std::vector<QpcSegment>::iterator networkElfIt =
       getQPCSegment(segmentVector, networkElfFileName);
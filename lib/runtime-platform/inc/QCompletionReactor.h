@@ -0,0 +1,113 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QCOMPLETIONREACTOR_H
+#define QCOMPLETIONREACTOR_H
+
+#include "QAicRuntimeTypes.h"
+#include "QLogger.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace qaic {
+
+enum class QCompletionEvent {
+  /// The descriptor of the source is readable
+  Ready,
+  /// The source was not ready for its whole timeout
+  Timeout,
+};
+
+using QCompletionHandler = std::function<void(QCompletionEvent)>;
+using QCompletionSourceID = uint64_t;
+
+class QCompletionReactor;
+using QCompletionReactorShared = std::shared_ptr<QCompletionReactor>;
+
+/// Multiplexes completion sources of a process onto a small pool of threads.
+/// A source is a readable descriptor, typically an eventfd the device
+/// signals, plus the handler that reaps its completions. Handlers run on a
+/// reactor thread, never concurrently for the same source, and must not
+/// block for long as they hold up other sources. Draining the descriptor,
+/// e.g. reading the eventfd counter, is up to the handler.
+class QCompletionReactor : public QLogger {
+public:
+  explicit QCompletionReactor(uint32_t numThreads);
+  ~QCompletionReactor();
+
+  QStatus init();
+
+  /// Watches \a fd. \a handler is called with Ready when it becomes
+  /// readable and, if \a timeoutMs is not 0, with Timeout each time it was
+  /// not readable for \a timeoutMs.
+  QStatus addSource(int fd, uint32_t timeoutMs, QCompletionHandler handler,
+                    QCompletionSourceID &id);
+
+  /// Stops watching a source. Blocks until a running handler of the source
+  /// returns, unless called from that handler.
+  QStatus removeSource(QCompletionSourceID id);
+
+  /// Changes the timeout of a source, 0 disables it
+  QStatus setSourceTimeout(QCompletionSourceID id, uint32_t timeoutMs);
+
+  uint32_t getNumThreads() const { return numThreads_; }
+  size_t getNumSources() const;
+
+  QCompletionReactor(const QCompletionReactor &) = delete;
+  QCompletionReactor &operator=(const QCompletionReactor &) = delete;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Source {
+    int fd;
+    uint32_t timeoutMs;
+    QCompletionHandler handler;
+    Clock::time_point deadline;
+    bool running = false;
+    bool pendingReady = false;
+    bool removed = false;
+    std::thread::id runningThread;
+  };
+  using SourceShared = std::shared_ptr<Source>;
+
+  void reactorThread();
+  int getWaitTimeoutMs();
+  void dispatch(QCompletionSourceID id, QCompletionEvent event);
+  void dispatchExpired();
+  void wake();
+  QStatus arm(QCompletionSourceID id, int fd, int op);
+
+  const uint32_t numThreads_;
+  int epollFd_ = -1;
+  int wakeFd_ = -1;
+  std::atomic_bool stop_{false};
+  std::vector<std::thread> threads_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable handlerDoneCv_;
+  std::unordered_map<QCompletionSourceID, SourceShared> sources_;
+  QCompletionSourceID nextId_ = 1;
+};
+
+/// Owner of the completion reactor shared by all networks of the process
+class QCompletionReactorManager {
+public:
+  static QCompletionReactorShared &getCompletionReactor();
+
+private:
+  static QCompletionReactorShared completionReactor_;
+  static std::mutex m_;
+};
+
+} // namespace qaic
+
+#endif // QCOMPLETIONREACTOR_H
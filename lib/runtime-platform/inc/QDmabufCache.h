@@ -0,0 +1,124 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QDMABUFCACHE_H
+#define QDMABUFCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace qaic {
+
+/// Identity of a registered dma-buf region. The dma-buf is identified by the
+/// file it refers to (device and inode) rather than by the descriptor number,
+/// descriptor numbers are recycled once the caller closes them while the
+/// inode stays unique for as long as the dma-buf exists.
+struct QDmabufKey {
+  uint64_t dev = 0;
+  uint64_t ino = 0;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+
+  bool operator==(const QDmabufKey &other) const {
+    return (dev == other.dev) && (ino == other.ino) &&
+           (offset == other.offset) && (size == other.size);
+  }
+  bool operator!=(const QDmabufKey &other) const { return !(*this == other); }
+};
+
+using QDmabufKeyVec = std::vector<QDmabufKey>;
+
+/// Bounded least recently used cache of device registrations for dma-buf
+/// regions. A registration is keyed by the full set of dma-bufs it binds,
+/// the value is whatever object keeps the device import alive. Evicting an
+/// entry drops the cache reference only, users still holding the value keep
+/// the import alive until they release it.
+template <class T> class QDmabufCache {
+public:
+  explicit QDmabufCache(size_t capacity) : capacity_(capacity) {}
+
+  /// Returns the registration for \a keys and marks it most recently used,
+  /// or nullptr if there is none
+  std::shared_ptr<T> find(const QDmabufKeyVec &keys) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->first == keys) {
+        entries_.splice(entries_.begin(), entries_, it);
+        return entries_.front().second;
+      }
+    }
+    return nullptr;
+  }
+
+  /// Adds or replaces the registration for \a keys. The least recently used
+  /// entry is evicted when the cache is full. Returns the evicted value so
+  /// that the caller controls where the import is released.
+  std::shared_ptr<T> insert(const QDmabufKeyVec &keys,
+                            std::shared_ptr<T> value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<T> evicted;
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->first == keys) {
+        evicted = std::move(it->second);
+        entries_.erase(it);
+        break;
+      }
+    }
+    if (capacity_ == 0) {
+      return value;
+    }
+    if (!evicted && (entries_.size() >= capacity_)) {
+      evicted = std::move(entries_.back().second);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(keys, std::move(value));
+    return evicted;
+  }
+
+  /// Drops every registration that references the dma-buf \a dev / \a ino
+  size_t erase(uint64_t dev, uint64_t ino) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t erased = 0;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      bool match = false;
+      for (const auto &key : it->first) {
+        if ((key.dev == dev) && (key.ino == ino)) {
+          match = true;
+          break;
+        }
+      }
+      if (match) {
+        it = entries_.erase(it);
+        erased++;
+      } else {
+        ++it;
+      }
+    }
+    return erased;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+  }
+
+  size_t capacity() const { return capacity_; }
+
+private:
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  std::list<std::pair<QDmabufKeyVec, std::shared_ptr<T>>> entries_;
+};
+
+} // namespace qaic
+
+#endif // QDMABUFCACHE_H
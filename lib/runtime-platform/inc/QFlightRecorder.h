@@ -0,0 +1,257 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QFLIGHTRECORDER_H
+#define QFLIGHTRECORDER_H
+
+#include "QAicRuntimeTypes.h"
+#include "QLogger.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace qaic {
+
+enum class QFlightEventType : uint16_t {
+  None = 0,
+  /// Execute accepted, id device, arg0 VC, arg1 wait handle
+  Submit = 1,
+  /// Execute refused with EAGAIN, id device, arg0 VC, arg1 retry
+  SubmitAgain = 2,
+  /// Execute given up after the retries, id device, arg0 VC
+  SubmitBusy = 3,
+  /// Wait for an inference, id device, arg0 VC, arg1 wait handle
+  WaitStart = 4,
+  /// Wait returned, id device, arg0 wait handle, arg1 status
+  WaitEnd = 5,
+  /// Program state entered, id device, text the state
+  StateEnter = 6,
+  /// Activation command, id device, arg0 command, arg1 status
+  ActivationCmd = 7,
+  /// ioctl returned, id request, arg0 return code, arg1 errno
+  Ioctl = 8,
+  /// Device state change, id device, arg0 event, arg1 VC
+  DeviceEvent = 9,
+  /// Error, id device, text what failed
+  Error = 10,
+  /// Marker placed by the application, text
+  Mark = 11,
+};
+
+/// One recorded event, 32 bytes
+struct QFlightEvent {
+  /// Monotonic clock
+  uint64_t timeNs;
+  QFlightEventType type;
+  /// QFlightEventFlagText: arg0 and arg1 hold up to 16 characters
+  uint16_t flags;
+  uint32_t id;
+  uint64_t arg0;
+  uint64_t arg1;
+};
+static_assert(sizeof(QFlightEvent) == 32, "QFlightEvent is part of the dump");
+
+constexpr uint16_t QFlightEventFlagText = 1;
+
+/// Events of one thread, oldest first
+struct QFlightThreadEvents {
+  uint32_t tid = 0;
+  /// Overwritten while the dump was written
+  uint64_t numLost = 0;
+  std::vector<QFlightEvent> events;
+};
+
+/// A decoded dump
+struct QFlightDump {
+  int32_t pid = 0;
+  /// Time of the dump, on the clock of the events
+  uint64_t monotonicNs = 0;
+  /// Wall clock time of the dump
+  uint64_t realtimeNs = 0;
+  std::string reason;
+  std::vector<QFlightThreadEvents> threads;
+};
+
+/// Always on recorder of runtime events. Each thread records into a ring of
+/// its own without locks, so recording an event costs a clock read and a
+/// few stores. Rings keep the latest events of each thread and are written
+/// to a file on error, on a signal or on request, for qaic-flight-decode to
+/// print.
+///
+/// Dumps do not stop the recording threads. Events a thread overwrote while
+/// its ring was written are counted as lost by the decoder.
+class QFlightRecorder : public QLogger {
+public:
+  /// Threads recording at once, later threads do not record
+  static constexpr uint32_t maxThreads = 256;
+  static constexpr uint32_t defaultEventsPerThread = 2048;
+
+  /// \a eventsPerThread is rounded up to a power of two, dumps hold one
+  /// event less per thread
+  explicit QFlightRecorder(uint32_t eventsPerThread = defaultEventsPerThread);
+  ~QFlightRecorder();
+
+  QFlightRecorder(const QFlightRecorder &) = delete;
+  QFlightRecorder &operator=(const QFlightRecorder &) = delete;
+
+  void setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  void record(QFlightEventType type, uint32_t id, uint64_t arg0 = 0,
+              uint64_t arg1 = 0) {
+    if (isEnabled()) {
+      write(type, 0, id, arg0, arg1);
+    }
+  }
+
+  /// Records the first 16 characters of \a text
+  void recordText(QFlightEventType type, uint32_t id, const char *text);
+
+  /// Writes the rings to a new file \a path, readable by the user only. An
+  /// existing file or link is not overwritten.
+  QStatus dump(const std::string &path, const char *reason);
+
+  /// Writes the rings to \a fd. Async signal safe, allocates nothing.
+  QStatus dumpToFd(int fd, const char *reason);
+
+  /// Writes the rings to a new file in the dump directory, see
+  /// setDumpDir(). \a path is set to the file written if not null, async
+  /// signal safe otherwise.
+  QStatus dumpToDir(const char *reason, std::string *path = nullptr);
+
+  /// Directory of dumpToDir(). By default /tmp/qaic-flight-<uid>, created
+  /// on the first dump and not written to unless private to the user. Set
+  /// before signals are handled.
+  QStatus setDumpDir(const std::string &dir);
+
+  /// Dumps on \a signum until the recorder is destroyed. One recorder of
+  /// the process handles signals.
+  QStatus installSignalHandler(int signum);
+
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /// Reads a dump written by this or another process
+  static QStatus decode(const std::string &path, QFlightDump &dump);
+
+  static const char *getEventName(QFlightEventType type);
+
+  /// One line describing \a event
+  static std::string format(const QFlightEvent &event);
+
+  /// Prints the events of all threads merged by time, relative to the dump
+  static void print(const QFlightDump &dump, std::ostream &os);
+
+private:
+  struct Ring {
+    std::atomic<uint64_t> head{0};
+    // First event of the thread owning the ring
+    std::atomic<uint64_t> start{0};
+    std::atomic<bool> inUse{false};
+    std::atomic<uint32_t> tid{0};
+    uint64_t mask = 0;
+    std::unique_ptr<QFlightEvent[]> events;
+  };
+
+  // Ring of the calling thread for the recorder it last recorded into
+  struct ThreadRing {
+    uint64_t recorderId = 0;
+    std::shared_ptr<Ring> ring;
+    ~ThreadRing();
+  };
+
+  Ring *getThreadRing() {
+    ThreadRing &cached = threadRing_;
+    if (cached.recorderId == id_) {
+      return cached.ring.get();
+    }
+    return claimRing();
+  }
+  Ring *claimRing();
+
+  void write(QFlightEventType type, uint16_t flags, uint32_t id,
+             uint64_t arg0, uint64_t arg1) {
+    Ring *ring = getThreadRing();
+    if (ring == nullptr) {
+      return;
+    }
+    const uint64_t head = ring->head.load(std::memory_order_relaxed);
+    QFlightEvent &event = ring->events[head & ring->mask];
+    event.timeNs = now();
+    event.type = type;
+    event.flags = flags;
+    event.id = id;
+    event.arg0 = arg0;
+    event.arg1 = arg1;
+    ring->head.store(head + 1, std::memory_order_release);
+  }
+  static void onSignal(int signum);
+
+  static thread_local ThreadRing threadRing_;
+  static std::atomic<uint64_t> nextId_;
+  static std::atomic<QFlightRecorder *> signalRecorder_;
+
+  const uint64_t id_;
+  const uint64_t eventsPerThread_;
+  std::atomic<bool> enabled_{true};
+  // Read without locks by dumps
+  std::atomic<Ring *> rings_[maxThreads];
+  // Guards the ownership of the rings and the dump directory
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Ring>> ownedRings_;
+  // Preformatted prefix of the dump files, read by signal handlers
+  char dumpPrefix_[256];
+  // Default directory checked before each dump, empty once set
+  char privateDir_[256];
+  std::atomic<uint32_t> dumpSeq_{0};
+  int signum_ = 0;
+  struct sigaction oldAction_ {};
+};
+
+/// Recorder of the process, enabled unless QAIC_FLIGHT_RECORDER is 0.
+/// QAIC_FLIGHT_RECORDER_EVENTS sets the events kept per thread,
+/// QAIC_FLIGHT_RECORDER_DIR where dumps are written and
+/// QAIC_FLIGHT_RECORDER_SIGNAL a signal that dumps.
+class QFlightRecorderManager {
+public:
+  static QFlightRecorder &getRecorder() {
+    QFlightRecorder *recorder = recorder_.load(std::memory_order_acquire);
+    return (recorder != nullptr) ? *recorder : init();
+  }
+
+  /// Dump on error. Errors tend to come in bursts, at most one dump is
+  /// written per dumpInterval and maxErrorDumps per process.
+  static QStatus dumpOnError(const char *reason);
+
+  static constexpr std::chrono::seconds dumpInterval{10};
+  static constexpr uint32_t maxErrorDumps = 16;
+
+private:
+  static QFlightRecorder &init();
+
+  static std::atomic<QFlightRecorder *> recorder_;
+  static std::chrono::steady_clock::time_point lastErrorDump_;
+  static uint32_t numErrorDumps_;
+  static std::mutex m_;
+};
+
+inline void qFlightRecord(QFlightEventType type, uint32_t id,
+                          uint64_t arg0 = 0, uint64_t arg1 = 0) {
+  QFlightRecorderManager::getRecorder().record(type, id, arg0, arg1);
+}
+
+} // namespace qaic
+
+#endif // QFLIGHTRECORDER_H
@@ -0,0 +1,130 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QNUMATOPOLOGY_H
+#define QNUMATOPOLOGY_H
+
+#include "QAicRuntimeTypes.h"
+#include "QLogger.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace qaic {
+
+/// Where a device sits in the host topology
+struct QDeviceLocality {
+  /// NUMA node of the PCIe root port of the device, -1 when the host is not
+  /// NUMA or the firmware does not report it
+  int numaNode = -1;
+  /// CPUs local to the device, sorted, empty when unknown
+  std::vector<uint32_t> cpus;
+};
+
+/// Reads device locality from sysfs. The root is a parameter so that a fake
+/// tree can stand in for /sys.
+class QNumaTopology : public QLogger {
+public:
+  explicit QNumaTopology(std::string sysfsRoot = "/sys");
+
+  /// Locality of the PCI device at \a pciAddr, e.g. 0000:3b:00.0. Hosts
+  /// that are not NUMA report numaNode -1, QS_UNSUPPORTED when sysfs has no
+  /// entry for the device.
+  QStatus getDeviceLocality(const std::string &pciAddr,
+                            QDeviceLocality &locality) const;
+  QStatus getOnlineNodes(std::vector<uint32_t> &nodes) const;
+  QStatus getNodeCpus(uint32_t node, std::vector<uint32_t> &cpus) const;
+
+  /// Parses the kernel cpulist format, e.g. "0-3,8,10-11"
+  static QStatus parseCpuList(const std::string &list,
+                              std::vector<uint32_t> &cpus);
+
+private:
+  bool readLine(const std::string &path, std::string &line) const;
+
+  const std::string sysfsRoot_;
+};
+
+enum class QNumaPolicy {
+  /// Leave placement to the OS scheduler and allocator
+  None,
+  /// Pin threads to the CPUs local to their device and bind the host
+  /// buffers of a device to its node
+  DeviceLocal,
+};
+
+class QNumaPlacement;
+using QNumaPlacementShared = std::shared_ptr<QNumaPlacement>;
+
+/// Placement of runtime threads and host buffers next to the devices they
+/// serve. Localities are read once per device and cached.
+class QNumaPlacement : public QLogger {
+public:
+  /// \a pciAddrs maps each device to its PCI address
+  QNumaPlacement(QNumaPolicy policy, QNumaTopology topology,
+                 std::map<QID, std::string> pciAddrs);
+
+  QNumaPolicy getPolicy() const { return policy_; }
+
+  QStatus getDeviceLocality(QID qid, QDeviceLocality &locality);
+
+  /// Pins the calling thread to the CPUs local to device \a qid
+  QStatus bindThreadToDevice(QID qid);
+
+  /// Pins an application thread to the CPUs local to device \a qid before
+  /// it drives an inference. Cheap when the device is the one of the last
+  /// call. A thread moving to a device behind another node is pinned again,
+  /// one moving to a device of unknown locality gets its own affinity back.
+  QStatus bindCallerToDevice(QID qid);
+
+  /// CPUs local to any device, for runtime threads serving every device.
+  /// Empty when that would not restrict them, e.g. with devices on every
+  /// node or a device of unknown locality.
+  std::vector<uint32_t> getRuntimeCpus();
+
+  /// Pins the calling thread to getRuntimeCpus()
+  QStatus bindRuntimeThread();
+
+  /// Prefers the node of device \a qid for the pages of the range. Pages
+  /// already touched on another node are moved there.
+  QStatus bindMemoryToDevice(void *addr, size_t size, QID qid);
+
+  static QStatus parsePolicy(const std::string &name, QNumaPolicy &policy);
+
+private:
+  QStatus getDeviceLocalityLocked(QID qid, QDeviceLocality &locality);
+
+  const QNumaPolicy policy_;
+  const QNumaTopology topology_;
+  const std::map<QID, std::string> pciAddrs_;
+  std::mutex mutex_;
+  std::map<QID, QDeviceLocality> localities_;
+  bool runtimeCpusKnown_ = false;
+  std::vector<uint32_t> runtimeCpus_;
+};
+
+/// Owner of the process wide placement, its policy is read from
+/// QAIC_NUMA_PLACEMENT ("none" or "device")
+class QNumaPlacementManager {
+public:
+  static QNumaPlacementShared &getNumaPlacement();
+
+  /// Shorthand for runtime threads, does nothing unless placement is enabled
+  static void bindRuntimeThread();
+
+  /// Shorthands for the host buffers of device \a qid and the helper
+  /// threads filling them, do nothing unless placement is enabled
+  static void bindThreadToDevice(QID qid);
+  static void bindMemoryToDevice(void *addr, size_t size, QID qid);
+
+private:
+  static QNumaPlacementShared numaPlacement_;
+  static std::mutex m_;
+};
+
+} // namespace qaic
+
+#endif // QNUMATOPOLOGY_H
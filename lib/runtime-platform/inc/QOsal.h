@@ -11,6 +11,7 @@
 #include "dev/common/QRuntimePlatformDeviceInterface.h"
 #include "dev/aic100/qaic_accel.h"
 #include "QOsalUtils.h"
+#include "QDmabufCache.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -81,6 +82,9 @@ QStatus getQPciInfo(uint32_t qid, QPciInfo *qPciInfo);
 int ppoll(struct pollfd *fds, nfds_t nfds, const struct timespec *timeout_ts,
           const sigset_t *sigmask);
 int cpu_setaffinity(int cpu);
+int setThreadAffinity(const std::vector<uint32_t> &cpus);
+int getThreadAffinity(std::vector<uint32_t> &cpus);
+int bindMemoryToNode(void *addr, size_t length, int node);
 int getDevicePath(std::string &path, QPciInfo &dev);
 int initPlatform();
 QStatus getTelemetryInfo(QTelemetryInfo &telemetryInfo,
@@ -89,6 +93,7 @@ int getCtrlChannelPath(std::string &path, const QPciInfo &pciInfo_,
                        QCtrlChannelID ccID);
 QStatus allocUserDmabuf(uint8_t **buf, uint32_t size, uint64_t *hdl);
 void freeUserDmabuf(void *vaddr);
+QStatus getDmabufKey(const QBuffer &buffer, QDmabufKey &key);
 int shm_open(const char *name, int oflag, mode_t mode);
 uint32_t getMemReqSize(size_t size);
 QStatus getPlatformNspDeviceList(std::list<std::string> &devList);
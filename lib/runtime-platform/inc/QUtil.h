@@ -8,6 +8,7 @@
 #include "spdlog/spdlog.h"
 #include "QTypes.h"
 
+#include <array>
 #include <cstddef>
 #include <memory>
 #include <sstream>
@@ -35,6 +36,30 @@ std::string uint32ToPCIeStr(uint32_t pcie);
 std::string pcieLinkSpeed(uint32_t maxSpeed);
 std::string qPciInfoToPCIeStr(QPciInfo pciInfo);
 
+/// 64 bit content hash (XXH64) for keying large buffers, e.g. QPC images.
+/// Not cryptographic.
+uint64_t hash64(const void *data, size_t size, uint64_t seed = 0);
+
+/// Streaming SHA-256 (FIPS 180-4), for keys the content is trusted by, e.g.
+/// loads shared between processes
+class Sha256 {
+public:
+  using Digest = std::array<uint8_t, 32>;
+
+  Sha256();
+  void update(const void *data, size_t size);
+  /// Digest of the data so far, more can be added afterwards
+  Digest getDigest() const;
+
+private:
+  void compress(const uint8_t *block);
+
+  uint32_t state_[8];
+  uint8_t buffer_[64];
+  size_t bufferSize_;
+  uint64_t length_;
+};
+
 std::string str(const QDevInfo &info);
 std::string str(const QResourceInfo &info);
 std::string str(const QPerformanceInfo &info);
@@ -6,6 +6,8 @@
 #include "QOsal.h"
 #include "QTypes.h"
 #include "QUtil.h"
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 
@@ -43,6 +45,12 @@ const char *statusStr(const QStatus &status) {
     return "UNSUPPORTED";
   case QS_DATA_CRC_ERROR:
     return "DATA_CRC_ERROR";
+  case QS_DEADLINE_EXCEEDED:
+    return "DEADLINE_EXCEEDED";
+  case QS_CANCELED:
+    return "CANCELED";
+  case QS_DEVICE_RECOVERING:
+    return "DEVICE_RECOVERING";
   case QS_DEV_ERROR:
     return "DEV_ERROR";
   case QS_ERROR:
@@ -362,6 +370,214 @@ std::string qPciInfoToPCIeStr(QPciInfo pciInfo) {
      << unsigned(pciInfo.function); // Function
   return ss.str();
 }
+//
+// XXH64, streams 32 bytes per round through four independent lanes
+//
+namespace {
+constexpr uint64_t hashPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t hashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t hashPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t hashPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t hashPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t hashRound(uint64_t acc, uint64_t input) {
+  acc += input * hashPrime2;
+  acc = rotl64(acc, 31);
+  return acc * hashPrime1;
+}
+
+inline uint64_t hashMerge(uint64_t acc, uint64_t lane) {
+  acc ^= hashRound(0, lane);
+  return acc * hashPrime1 + hashPrime4;
+}
+} // namespace
+
+uint64_t hash64(const void *data, size_t size, uint64_t seed) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  const uint8_t *const end = p + size;
+  uint64_t h;
+
+  if (size >= 32) {
+    uint64_t v1 = seed + hashPrime1 + hashPrime2;
+    uint64_t v2 = seed + hashPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - hashPrime1;
+    const uint8_t *const limit = end - 32;
+    do {
+      v1 = hashRound(v1, read64(p));
+      v2 = hashRound(v2, read64(p + 8));
+      v3 = hashRound(v3, read64(p + 16));
+      v4 = hashRound(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    h = hashMerge(h, v1);
+    h = hashMerge(h, v2);
+    h = hashMerge(h, v3);
+    h = hashMerge(h, v4);
+  } else {
+    h = seed + hashPrime5;
+  }
+  h += static_cast<uint64_t>(size);
+
+  while (p + 8 <= end) {
+    h ^= hashRound(0, read64(p));
+    h = rotl64(h, 27) * hashPrime1 + hashPrime4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(read32(p)) * hashPrime1;
+    h = rotl64(h, 23) * hashPrime2 + hashPrime3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= (*p) * hashPrime5;
+    h = rotl64(h, 11) * hashPrime1;
+    p++;
+  }
+  h ^= h >> 33;
+  h *= hashPrime2;
+  h ^= h >> 29;
+  h *= hashPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+//
+// SHA-256, 64 byte blocks through 64 rounds
+//
+namespace {
+constexpr uint32_t sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+inline uint32_t rotr32(uint32_t x, int r) { return (x >> r) | (x << (32 - r)); }
+
+inline uint32_t readBe32(const uint8_t *p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+} // namespace
+
+Sha256::Sha256()
+    : state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f,
+             0x9b05688c, 0x1f83d9ab, 0x5be0cd19},
+      buffer_{}, bufferSize_(0), length_(0) {}
+
+void Sha256::compress(const uint8_t *block) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = readBe32(block + i * 4);
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^
+                  (w[i - 15] >> 3);
+    uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^
+                  (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+  uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+    uint32_t ch = (e & f) ^ (~e & g);
+    uint32_t t1 = h + s1 + ch + sha256K[i] + w[i];
+    uint32_t s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+    uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+    uint32_t t2 = s0 + maj;
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state_[0] += a;
+  state_[1] += b;
+  state_[2] += c;
+  state_[3] += d;
+  state_[4] += e;
+  state_[5] += f;
+  state_[6] += g;
+  state_[7] += h;
+}
+
+void Sha256::update(const void *data, size_t size) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  length_ += size;
+  if (bufferSize_ != 0) {
+    size_t take = std::min(size, sizeof(buffer_) - bufferSize_);
+    memcpy(buffer_ + bufferSize_, p, take);
+    bufferSize_ += take;
+    p += take;
+    size -= take;
+    if (bufferSize_ < sizeof(buffer_)) {
+      return;
+    }
+    compress(buffer_);
+    bufferSize_ = 0;
+  }
+  while (size >= sizeof(buffer_)) {
+    compress(p);
+    p += sizeof(buffer_);
+    size -= sizeof(buffer_);
+  }
+  memcpy(buffer_, p, size);
+  bufferSize_ = size;
+}
+
+Sha256::Digest Sha256::getDigest() const {
+  // Padding goes to a copy, the stream can go on
+  Sha256 last = *this;
+  const uint64_t bits = length_ * 8;
+  const uint8_t pad = 0x80;
+  last.update(&pad, 1);
+  const uint8_t zero[64] = {};
+  size_t zeros = (last.bufferSize_ <= 56) ? (56 - last.bufferSize_)
+                                          : (120 - last.bufferSize_);
+  last.update(zero, zeros);
+  uint8_t lengthBe[8];
+  for (int i = 0; i < 8; i++) {
+    lengthBe[i] = static_cast<uint8_t>(bits >> (56 - i * 8));
+  }
+  last.update(lengthBe, sizeof(lengthBe));
+
+  Digest digest;
+  for (int i = 0; i < 8; i++) {
+    digest[i * 4] = static_cast<uint8_t>(last.state_[i] >> 24);
+    digest[i * 4 + 1] = static_cast<uint8_t>(last.state_[i] >> 16);
+    digest[i * 4 + 2] = static_cast<uint8_t>(last.state_[i] >> 8);
+    digest[i * 4 + 3] = static_cast<uint8_t>(last.state_[i]);
+  }
+  return digest;
+}
+
 void convertToHostFormat(const host_api_info_data_header_internal_t &source,
                          QHostApiInfoDevData &target) {
   target.formatVersion = source.format_version;
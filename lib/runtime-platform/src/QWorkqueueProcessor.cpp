@@ -3,6 +3,7 @@
 #include "QWorkqueueProcessor.h"
 #include "QWorkqueueElement.h"
 #include "QUtil.h"
+#include "QNumaTopology.h"
 #include <chrono>
 
 namespace qaic {
@@ -71,6 +72,7 @@ void QWorkqueueProcessor::ready(WorkqueueElementCB &wqElem,
 
 void QWorkqueueProcessor::run() {
 
+  QNumaPlacementManager::bindRuntimeThread();
   while (1) {
     std::unique_lock<std::mutex> lock(mutex_);
     while (!ready_ && !terminate_) {
@@ -7,6 +7,7 @@
 #include "QWorkthread.h"
 #include "QLogger.h"
 #include "QUtil.h"
+#include "QNumaTopology.h"
 
 namespace qaic {
 
@@ -45,6 +46,7 @@ void QWorkthread::release() { terminate(); }
 
 // Private
 void QWorkthread::workthread() {
+  QNumaPlacementManager::bindRuntimeThread();
   while (1) {
     std::unique_lock<std::mutex> lock(mutex_);
     while (!ready_ && !terminate_) {
@@ -62,6 +62,7 @@ QStatus QRuntimePlatformDeviceAic100::runDevCmd(QDevInterfaceCmdEnum cmd,
   /* KMD based on DRM interface structures */
   qaic_create_bo *createBO = nullptr;
   qaic_attach_slice *attachBO = nullptr;
+  drm_prime_handle primeHandle = {};
 
   if (devHandle_.fileDev.fd == INVALID_FILE_DEV_HANDLE) {
     LogErrorG("Invalid file descriptor");
@@ -105,6 +106,49 @@ QStatus QRuntimePlatformDeviceAic100::runDevCmd(QDevInterfaceCmdEnum cmd,
     devCmd.cmdRspBuf = (void *)attachBO;
     status = QOsal::runDeviceCmd(QAIC_DEV_INTERFACE_AIC100, devHandle_, devCmd);
     break;
+  case QAIC_DEV_CMD_PRIME_FD:
+    /* Import a dma-buf, createBO->handle carries the dma-buf fd in and the
+       GEM handle out, the rest of the request is laid out as for
+       QAIC_DEV_CMD_MEM */
+    createBO = (qaic_create_bo *)data;
+    primeHandle.fd = static_cast<int32_t>(createBO->handle);
+    primeHandle.flags = 0;
+    primeHandle.handle = 0;
+
+    devCmd.cmdReq = DRM_IOCTL_PRIME_FD_TO_HANDLE;
+    devCmd.cmdSize = sizeof(primeHandle);
+    devCmd.cmdType = QDEV_CMD_TYPE_WRITE_AND_READ;
+    devCmd.cmdRspBuf = (void *)&primeHandle;
+    status = QOsal::runDeviceCmd(QAIC_DEV_INTERFACE_AIC100, devHandle_, devCmd);
+
+    if (status != QS_SUCCESS) {
+      LogErrorG("dma-buf import failed. fd {} Error {}", primeHandle.fd,
+                status);
+      break;
+    }
+    createBO->handle = primeHandle.handle;
+
+    /* attach slicing information to the imported BO */
+    attachBO = reinterpret_cast<qaic_attach_slice *>(createBO + 1);
+    attachBO->hdr.handle = createBO->handle;
+
+    devCmd.cmdReq = DRM_IOCTL_QAIC_ATTACH_SLICE_BO;
+    devCmd.cmdSize = sizeof(*attachBO);
+    devCmd.cmdType = QDEV_CMD_TYPE_WRITE_ONLY;
+    devCmd.cmdRspBuf = (void *)attachBO;
+    status = QOsal::runDeviceCmd(QAIC_DEV_INTERFACE_AIC100, devHandle_, devCmd);
+    if (status != QS_SUCCESS) {
+      /* Release the import, the caller only frees attached BOs */
+      drm_gem_close closeBO = {};
+      closeBO.handle = primeHandle.handle;
+      devCmd.cmdReq = DRM_IOCTL_GEM_CLOSE;
+      devCmd.cmdSize = sizeof(closeBO);
+      devCmd.cmdType = QDEV_CMD_TYPE_WRITE_ONLY;
+      devCmd.cmdRspBuf = (void *)&closeBO;
+      QOsal::runDeviceCmd(QAIC_DEV_INTERFACE_AIC100, devHandle_, devCmd);
+      status = QS_INVAL;
+    }
+    break;
   case QAIC_DEV_CMD_MMAP_DEV:
     devCmd.cmdReq = DRM_IOCTL_QAIC_MMAP_BO;
     devCmd.cmdSize = sizeof(qaic_mmap_bo);
@@ -0,0 +1,313 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QCompletionReactor.h"
+#include "QNumaTopology.h"
+#include "QOsal.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+namespace qaic {
+
+static const std::string QAicCompletionThreadsEnv = "QAIC_COMPLETION_THREADS";
+constexpr uint32_t defaultCompletionThreads = 2;
+constexpr int maxEventsPerWait = 64;
+// Source ids start at 1, 0 tags the wake descriptor
+constexpr QCompletionSourceID wakeSourceId = 0;
+
+QCompletionReactorShared QCompletionReactorManager::completionReactor_;
+std::mutex QCompletionReactorManager::m_;
+
+QCompletionReactorShared &QCompletionReactorManager::getCompletionReactor() {
+  std::unique_lock<std::mutex> lk(m_);
+  if (QCompletionReactorManager::completionReactor_ == nullptr) {
+    uint32_t numThreads = defaultCompletionThreads;
+    if (const char *env = std::getenv(QAicCompletionThreadsEnv.c_str())) {
+      int value = atoi(env);
+      if (value > 0) {
+        numThreads = static_cast<uint32_t>(value);
+      }
+    }
+    QCompletionReactorShared reactorTmp =
+        std::make_shared<QCompletionReactor>(numThreads);
+    if (reactorTmp->init() == QS_SUCCESS) {
+      QCompletionReactorManager::completionReactor_ = std::move(reactorTmp);
+    }
+  }
+  return QCompletionReactorManager::completionReactor_;
+}
+
+QCompletionReactor::QCompletionReactor(uint32_t numThreads)
+    : QLogger("QCompletionReactor"), numThreads_(numThreads) {}
+
+QCompletionReactor::~QCompletionReactor() {
+  stop_ = true;
+  wake();
+  for (auto &thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+  if (wakeFd_ >= 0) {
+    close(wakeFd_);
+  }
+  if (epollFd_ >= 0) {
+    close(epollFd_);
+  }
+}
+
+QStatus QCompletionReactor::init() {
+  if ((numThreads_ == 0) || (epollFd_ >= 0)) {
+    return QS_INVAL;
+  }
+
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd_ < 0) {
+    LogError("Failed to create epoll instance: {}",
+             QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  wakeFd_ = QOsal::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFd_ < 0) {
+    LogError("Failed to create eventfd: {}", QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  // Edge triggered, so that each wake() releases one waiting thread
+  epoll_event event = {};
+  event.events = EPOLLIN | EPOLLET;
+  event.data.u64 = wakeSourceId;
+  if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event) != 0) {
+    LogError("Failed to watch eventfd: {}", QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+
+  for (uint32_t i = 0; i < numThreads_; i++) {
+    threads_.emplace_back(&QCompletionReactor::reactorThread, this);
+  }
+  return QS_SUCCESS;
+}
+
+void QCompletionReactor::wake() {
+  if (wakeFd_ >= 0) {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t rc = write(wakeFd_, &one, sizeof(one));
+  }
+}
+
+QStatus QCompletionReactor::arm(QCompletionSourceID id, int fd, int op) {
+  epoll_event event = {};
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.u64 = id;
+  if (epoll_ctl(epollFd_, op, fd, &event) != 0) {
+    LogError("Failed to watch completion source {}: {}", id,
+             QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QCompletionReactor::addSource(int fd, uint32_t timeoutMs,
+                                      QCompletionHandler handler,
+                                      QCompletionSourceID &id) {
+  if ((fd < 0) || !handler) {
+    return QS_INVAL;
+  }
+  if (epollFd_ < 0) {
+    return QS_ERROR;
+  }
+
+  auto source = std::make_shared<Source>();
+  source->fd = fd;
+  source->timeoutMs = timeoutMs;
+  source->handler = std::move(handler);
+  source->deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    QCompletionSourceID newId = nextId_++;
+    QStatus status = arm(newId, fd, EPOLL_CTL_ADD);
+    if (status != QS_SUCCESS) {
+      return status;
+    }
+    sources_[newId] = std::move(source);
+    id = newId;
+  }
+
+  // A waiting thread may have to wake up earlier for the new timeout
+  if (timeoutMs != 0) {
+    wake();
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QCompletionReactor::removeSource(QCompletionSourceID id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = sources_.find(id);
+  if (it == sources_.end()) {
+    return QS_INVAL;
+  }
+  SourceShared source = it->second;
+  sources_.erase(it);
+  source->removed = true;
+  // The descriptor may already be closed by its owner, which removes it
+  // from the epoll set
+  epoll_ctl(epollFd_, EPOLL_CTL_DEL, source->fd, nullptr);
+
+  if (source->running &&
+      (source->runningThread != std::this_thread::get_id())) {
+    handlerDoneCv_.wait(lock, [&source] { return !source->running; });
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QCompletionReactor::setSourceTimeout(QCompletionSourceID id,
+                                             uint32_t timeoutMs) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sources_.find(id);
+    if (it == sources_.end()) {
+      return QS_INVAL;
+    }
+    Source &source = *it->second;
+    if (source.timeoutMs == timeoutMs) {
+      return QS_SUCCESS;
+    }
+    source.timeoutMs = timeoutMs;
+    source.deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+  }
+  if (timeoutMs != 0) {
+    wake();
+  }
+  return QS_SUCCESS;
+}
+
+size_t QCompletionReactor::getNumSources() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return sources_.size();
+}
+
+int QCompletionReactor::getWaitTimeoutMs() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool hasDeadline = false;
+  Clock::time_point nearest;
+  for (const auto &entry : sources_) {
+    const Source &source = *entry.second;
+    if ((source.timeoutMs == 0) || source.running) {
+      continue;
+    }
+    if (!hasDeadline || (source.deadline < nearest)) {
+      nearest = source.deadline;
+      hasDeadline = true;
+    }
+  }
+  if (!hasDeadline) {
+    return -1;
+  }
+  auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+      nearest - Clock::now());
+  return static_cast<int>(std::max<int64_t>(remaining.count(), 0));
+}
+
+void QCompletionReactor::dispatch(QCompletionSourceID id,
+                                  QCompletionEvent event) {
+  SourceShared source;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sources_.find(id);
+    if (it == sources_.end()) {
+      return;
+    }
+    source = it->second;
+    if (source->running) {
+      // Handled once the running handler returns
+      if (event == QCompletionEvent::Ready) {
+        source->pendingReady = true;
+      }
+      return;
+    }
+    source->running = true;
+    source->runningThread = std::this_thread::get_id();
+  }
+
+  while (true) {
+    source->handler(event);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (source->pendingReady && !source->removed) {
+      source->pendingReady = false;
+      event = QCompletionEvent::Ready;
+      continue;
+    }
+    source->running = false;
+    source->deadline =
+        Clock::now() + std::chrono::milliseconds(source->timeoutMs);
+    // A ready event disarmed the one shot descriptor
+    if (!source->removed && (event == QCompletionEvent::Ready)) {
+      (void)arm(id, source->fd, EPOLL_CTL_MOD);
+    }
+    handlerDoneCv_.notify_all();
+    break;
+  }
+}
+
+void QCompletionReactor::dispatchExpired() {
+  while (true) {
+    QCompletionSourceID expired = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Clock::time_point now = Clock::now();
+      for (const auto &entry : sources_) {
+        const Source &source = *entry.second;
+        if ((source.timeoutMs != 0) && !source.running &&
+            (source.deadline <= now)) {
+          expired = entry.first;
+          break;
+        }
+      }
+    }
+    if (expired == 0) {
+      return;
+    }
+    dispatch(expired, QCompletionEvent::Timeout);
+  }
+}
+
+void QCompletionReactor::reactorThread() {
+  epoll_event events[maxEventsPerWait];
+
+  QNumaPlacementManager::bindRuntimeThread();
+
+  while (!stop_) {
+    int count = epoll_wait(epollFd_, events, maxEventsPerWait,
+                           getWaitTimeoutMs());
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LogError("epoll wait failed: {}", QOsal::strerror_safe(errno));
+      break;
+    }
+    for (int i = 0; (i < count) && !stop_; i++) {
+      if (events[i].data.u64 == wakeSourceId) {
+        uint64_t value;
+        [[maybe_unused]] ssize_t rc = read(wakeFd_, &value, sizeof(value));
+        continue;
+      }
+      dispatch(events[i].data.u64, QCompletionEvent::Ready);
+    }
+    if (!stop_) {
+      dispatchExpired();
+    }
+  }
+
+  // Pass the stop request on to the next waiting thread
+  wake();
+}
+
+} // namespace qaic
@@ -5,6 +5,7 @@
 #include "QRuntimePlatformApi.h"
 #include "QUtil.h"
 #include "QOsal.h"
+#include "QNumaTopology.h"
 
 #include <libudev.h>
 
@@ -103,6 +104,8 @@ void QDeviceStateMonitor::monitorQaicDevices(
 
   int monitorFd = -1;
 
+  QNumaPlacementManager::bindRuntimeThread();
+
   uDev = udev_new();
   if (!uDev) {
     LogError("Failed to create udev");
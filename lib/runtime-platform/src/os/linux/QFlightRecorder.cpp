@@ -0,0 +1,616 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QFlightRecorder.h"
+#include "QDeviceStateInfo.h"
+#include "QOsal.h"
+#include "QUtil.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <time.h>
+#include <tuple>
+#include <unistd.h>
+
+namespace qaic {
+
+static const std::string QAicFlightRecorderEnv = "QAIC_FLIGHT_RECORDER";
+static const std::string QAicFlightRecorderEventsEnv =
+    "QAIC_FLIGHT_RECORDER_EVENTS";
+static const std::string QAicFlightRecorderDirEnv = "QAIC_FLIGHT_RECORDER_DIR";
+static const std::string QAicFlightRecorderSignalEnv =
+    "QAIC_FLIGHT_RECORDER_SIGNAL";
+
+constexpr char flightMagic[8] = {'Q', 'A', 'I', 'C', 'F', 'L', 'T', '\0'};
+constexpr uint32_t flightVersion = 1;
+constexpr uint32_t minEventsPerThread = 16;
+// Bounds what a corrupt dump can make the decoder allocate
+constexpr uint32_t maxEventsPerThread = 1u << 24;
+// Names dumpToDir() tries past the ones already taken
+constexpr uint32_t maxDumpNameAttempts = 16;
+// Dumps hold the addresses and arguments of the process, and a dump file
+// must not be a link planted to truncate another file
+constexpr int dumpOpenFlags =
+    O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC;
+constexpr mode_t dumpFileMode = S_IRUSR | S_IWUSR;
+
+// Dump file: FlightFileHeader, then for each ring a FlightRingHeader, its
+// events oldest first and the head of the ring after they were written
+struct FlightFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t eventSize;
+  int32_t pid;
+  uint32_t numRings;
+  uint32_t eventsPerThread;
+  uint32_t reserved;
+  uint64_t monotonicNs;
+  uint64_t realtimeNs;
+  char reason[64];
+};
+static_assert(sizeof(FlightFileHeader) == 112, "Dump layout");
+
+struct FlightRingHeader {
+  uint32_t tid;
+  uint32_t numEvents;
+  // Ring index of the first event
+  uint64_t first;
+};
+static_assert(sizeof(FlightRingHeader) == 16, "Dump layout");
+
+thread_local QFlightRecorder::ThreadRing QFlightRecorder::threadRing_;
+std::atomic<uint64_t> QFlightRecorder::nextId_{1};
+std::atomic<QFlightRecorder *> QFlightRecorder::signalRecorder_{nullptr};
+
+std::atomic<QFlightRecorder *> QFlightRecorderManager::recorder_{nullptr};
+std::chrono::steady_clock::time_point QFlightRecorderManager::lastErrorDump_;
+uint32_t QFlightRecorderManager::numErrorDumps_ = 0;
+std::mutex QFlightRecorderManager::m_;
+
+static uint32_t roundUpPowerOf2(uint32_t value) {
+  uint32_t power = 1;
+  while (power < value) {
+    power <<= 1;
+  }
+  return power;
+}
+
+// Async signal safe
+static bool writeAll(int fd, const void *data, size_t size) {
+  const char *p = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = ::write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Async signal safe, appends the decimal \a value at \a pos of \a buf
+static size_t appendNumber(char *buf, size_t pos, size_t size,
+                           uint64_t value) {
+  char digits[20];
+  size_t len = 0;
+  do {
+    digits[len++] = static_cast<char>('0' + (value % 10));
+    value /= 10;
+  } while (value != 0);
+  while ((len > 0) && (pos + 1 < size)) {
+    buf[pos++] = digits[--len];
+  }
+  buf[pos] = '\0';
+  return pos;
+}
+
+static size_t appendString(char *buf, size_t pos, size_t size,
+                           const char *str) {
+  while ((*str != '\0') && (pos + 1 < size)) {
+    buf[pos++] = *str++;
+  }
+  buf[pos] = '\0';
+  return pos;
+}
+
+// Async signal safe, creates \a dir if missing and checks that only the
+// user can get to it, it is not a link either
+static bool makePrivateDir(const char *dir) {
+  if ((::mkdir(dir, S_IRWXU) != 0) && (errno != EEXIST)) {
+    return false;
+  }
+  struct stat st;
+  return (::lstat(dir, &st) == 0) && S_ISDIR(st.st_mode) &&
+         (st.st_uid == geteuid()) &&
+         ((st.st_mode & (S_IRWXG | S_IRWXO)) == 0);
+}
+
+//======================================================================
+// QFlightRecorder
+//======================================================================
+QFlightRecorder::ThreadRing::~ThreadRing() {
+  if (ring != nullptr) {
+    ring->inUse.store(false, std::memory_order_release);
+  }
+}
+
+QFlightRecorder::QFlightRecorder(uint32_t eventsPerThread)
+    : QLogger("QFlightRecorder"), id_(nextId_++),
+      eventsPerThread_(roundUpPowerOf2(std::min(
+          std::max(eventsPerThread, minEventsPerThread), maxEventsPerThread))) {
+  for (auto &ring : rings_) {
+    ring.store(nullptr, std::memory_order_relaxed);
+  }
+  dumpPrefix_[0] = '\0';
+  privateDir_[0] = '\0';
+  const std::string dir = fmt::format("/tmp/qaic-flight-{}", geteuid());
+  if (setDumpDir(dir) == QS_SUCCESS) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::memcpy(privateDir_, dir.c_str(), dir.size() + 1);
+  }
+}
+
+QFlightRecorder::~QFlightRecorder() {
+  if (signum_ != 0) {
+    sigaction(signum_, &oldAction_, nullptr);
+    signalRecorder_.store(nullptr, std::memory_order_release);
+  }
+}
+
+QFlightRecorder::Ring *QFlightRecorder::claimRing() {
+  ThreadRing &cached = threadRing_;
+  // A thread records into one recorder at a time
+  if (cached.ring != nullptr) {
+    cached.ring->inUse.store(false, std::memory_order_release);
+    cached.ring.reset();
+  }
+  cached.recorderId = id_;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_ptr<Ring> ring;
+  for (const auto &owned : ownedRings_) {
+    if (!owned->inUse.load(std::memory_order_acquire)) {
+      ring = owned;
+      break;
+    }
+  }
+  if (ring == nullptr) {
+    if (ownedRings_.size() >= maxThreads) {
+      // Cached, the thread does not try again
+      return nullptr;
+    }
+    ring = std::make_shared<Ring>();
+    ring->mask = eventsPerThread_ - 1;
+    ring->events.reset(new QFlightEvent[eventsPerThread_]());
+    rings_[ownedRings_.size()].store(ring.get(), std::memory_order_release);
+    ownedRings_.push_back(ring);
+  }
+  // Events of the previous owner are not attributed to this thread
+  ring->start.store(ring->head.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  ring->tid.store(static_cast<uint32_t>(QOsal::getPid()),
+                  std::memory_order_relaxed);
+  ring->inUse.store(true, std::memory_order_release);
+  cached.ring = ring;
+  return ring.get();
+}
+
+void QFlightRecorder::recordText(QFlightEventType type, uint32_t id,
+                                 const char *text) {
+  if (!isEnabled()) {
+    return;
+  }
+  uint64_t packed[2] = {0, 0};
+  if (text != nullptr) {
+    std::memcpy(packed, text, strnlen(text, sizeof(packed)));
+  }
+  write(type, QFlightEventFlagText, id, packed[0], packed[1]);
+}
+
+QStatus QFlightRecorder::dumpToFd(int fd, const char *reason) {
+  uint32_t numRings = 0;
+  while ((numRings < maxThreads) &&
+         (rings_[numRings].load(std::memory_order_acquire) != nullptr)) {
+    numRings++;
+  }
+
+  FlightFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, flightMagic, sizeof(header.magic));
+  header.version = flightVersion;
+  header.eventSize = sizeof(QFlightEvent);
+  header.pid = static_cast<int32_t>(getpid());
+  header.numRings = numRings;
+  header.eventsPerThread = static_cast<uint32_t>(eventsPerThread_);
+  header.monotonicNs = now();
+  struct timespec ts;
+  if (clock_gettime(CLOCK_REALTIME, &ts) == 0) {
+    header.realtimeNs =
+        static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+  }
+  if (reason != nullptr) {
+    (void)appendString(header.reason, 0, sizeof(header.reason), reason);
+  }
+  if (!writeAll(fd, &header, sizeof(header))) {
+    return QS_ERROR;
+  }
+
+  const uint64_t capacity = eventsPerThread_;
+  for (uint32_t i = 0; i < numRings; i++) {
+    Ring *ring = rings_[i].load(std::memory_order_acquire);
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    // The slot after the head may be being written
+    uint64_t first = (head >= capacity) ? head - capacity + 1 : 0;
+    first = std::max(first,
+                     std::min(ring->start.load(std::memory_order_relaxed),
+                              head));
+    FlightRingHeader ringHeader;
+    ringHeader.tid = ring->tid.load(std::memory_order_relaxed);
+    ringHeader.numEvents = static_cast<uint32_t>(head - first);
+    ringHeader.first = first;
+    if (!writeAll(fd, &ringHeader, sizeof(ringHeader))) {
+      return QS_ERROR;
+    }
+    // The events wrap at the end of the ring
+    const uint64_t offset = first & ring->mask;
+    const uint64_t numBeforeWrap =
+        std::min<uint64_t>(ringHeader.numEvents, capacity - offset);
+    if (!writeAll(fd, &ring->events[offset],
+                  numBeforeWrap * sizeof(QFlightEvent)) ||
+        !writeAll(fd, &ring->events[0],
+                  (ringHeader.numEvents - numBeforeWrap) *
+                      sizeof(QFlightEvent))) {
+      return QS_ERROR;
+    }
+    const uint64_t headAfter = ring->head.load(std::memory_order_acquire);
+    if (!writeAll(fd, &headAfter, sizeof(headAfter))) {
+      return QS_ERROR;
+    }
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QFlightRecorder::dump(const std::string &path, const char *reason) {
+  int fd = ::open(path.c_str(), dumpOpenFlags, dumpFileMode);
+  if (fd < 0) {
+    LogError("Failed to open {}: {}", path, QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  QStatus status = dumpToFd(fd, reason);
+  if (::close(fd) != 0) {
+    status = QS_ERROR;
+  }
+  if (status != QS_SUCCESS) {
+    LogError("Failed to write {}", path);
+  }
+  return status;
+}
+
+QStatus QFlightRecorder::dumpToDir(const char *reason, std::string *path) {
+  if ((privateDir_[0] != '\0') && !makePrivateDir(privateDir_)) {
+    return QS_ERROR;
+  }
+  char file[sizeof(dumpPrefix_) + 32];
+  int fd = -1;
+  // Names of an earlier process with the same pid are skipped
+  for (uint32_t attempt = 0; (fd < 0) && (attempt < maxDumpNameAttempts);
+       attempt++) {
+    size_t pos = appendString(file, 0, sizeof(file), dumpPrefix_);
+    pos = appendNumber(file, pos, sizeof(file),
+                       dumpSeq_.fetch_add(1, std::memory_order_relaxed));
+    (void)appendString(file, pos, sizeof(file), ".bin");
+    fd = ::open(file, dumpOpenFlags, dumpFileMode);
+    if ((fd < 0) && (errno != EEXIST)) {
+      break;
+    }
+  }
+  if (fd < 0) {
+    return QS_ERROR;
+  }
+  QStatus status = dumpToFd(fd, reason);
+  if (::close(fd) != 0) {
+    status = QS_ERROR;
+  }
+  if ((status == QS_SUCCESS) && (path != nullptr)) {
+    *path = file;
+  }
+  return status;
+}
+
+QStatus QFlightRecorder::setDumpDir(const std::string &dir) {
+  std::string prefix =
+      fmt::format("{}/qaic-flight-{}-", dir.empty() ? "." : dir, getpid());
+  if (prefix.size() >= sizeof(dumpPrefix_)) {
+    LogError("Dump directory {} is too long", dir);
+    return QS_INVAL;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::memcpy(dumpPrefix_, prefix.c_str(), prefix.size() + 1);
+  // A directory of the application is used as it is
+  privateDir_[0] = '\0';
+  return QS_SUCCESS;
+}
+
+QStatus QFlightRecorder::installSignalHandler(int signum) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (signum_ != 0) {
+    return (signum_ == signum) ? QS_SUCCESS : QS_BUSY;
+  }
+  QFlightRecorder *expected = nullptr;
+  if (!signalRecorder_.compare_exchange_strong(expected, this,
+                                               std::memory_order_acq_rel)) {
+    LogError("Another recorder handles signals");
+    return QS_BUSY;
+  }
+  struct sigaction action {};
+  action.sa_handler = &QFlightRecorder::onSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  if (sigaction(signum, &action, &oldAction_) != 0) {
+    LogError("Failed to handle signal {}: {}", signum,
+             QOsal::strerror_safe(errno));
+    signalRecorder_.store(nullptr, std::memory_order_release);
+    return QS_INVAL;
+  }
+  signum_ = signum;
+  return QS_SUCCESS;
+}
+
+void QFlightRecorder::onSignal(int signum) {
+  (void)signum; // unused parameter
+  const int savedErrno = errno;
+  QFlightRecorder *recorder = signalRecorder_.load(std::memory_order_acquire);
+  if (recorder != nullptr) {
+    (void)recorder->dumpToDir("signal");
+  }
+  errno = savedErrno;
+}
+
+QStatus QFlightRecorder::decode(const std::string &path, QFlightDump &dump) {
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs.is_open()) {
+    LogErrorG("Failed to open {}", path);
+    return QS_ERROR;
+  }
+  auto readExact = [&ifs](void *data, size_t size) {
+    ifs.read(static_cast<char *>(data), static_cast<std::streamsize>(size));
+    return static_cast<size_t>(ifs.gcount()) == size;
+  };
+
+  FlightFileHeader header;
+  if (!readExact(&header, sizeof(header)) ||
+      (std::memcmp(header.magic, flightMagic, sizeof(flightMagic)) != 0)) {
+    LogErrorG("{} is not a flight recorder dump", path);
+    return QS_INVAL;
+  }
+  if ((header.version != flightVersion) ||
+      (header.eventSize != sizeof(QFlightEvent)) ||
+      (header.numRings > maxThreads) ||
+      (header.eventsPerThread > maxEventsPerThread) ||
+      (header.eventsPerThread != roundUpPowerOf2(header.eventsPerThread))) {
+    LogErrorG("Unsupported dump {} version {} event size {}", path,
+              header.version, header.eventSize);
+    return QS_INVAL;
+  }
+  header.reason[sizeof(header.reason) - 1] = '\0';
+
+  dump = QFlightDump();
+  dump.pid = header.pid;
+  dump.monotonicNs = header.monotonicNs;
+  dump.realtimeNs = header.realtimeNs;
+  dump.reason = header.reason;
+  for (uint32_t i = 0; i < header.numRings; i++) {
+    FlightRingHeader ringHeader;
+    if (!readExact(&ringHeader, sizeof(ringHeader)) ||
+        (ringHeader.numEvents > header.eventsPerThread)) {
+      LogErrorG("Dump {} is truncated or corrupt", path);
+      return QS_INVAL;
+    }
+    std::vector<QFlightEvent> events(ringHeader.numEvents);
+    uint64_t headAfter = 0;
+    if (!readExact(events.data(), events.size() * sizeof(QFlightEvent)) ||
+        !readExact(&headAfter, sizeof(headAfter)) ||
+        (headAfter < ringHeader.first + ringHeader.numEvents)) {
+      LogErrorG("Dump {} is truncated or corrupt", path);
+      return QS_INVAL;
+    }
+    if (ringHeader.numEvents == 0) {
+      continue;
+    }
+    // Slots the thread wrote while they were dumped, including the one it
+    // may have been writing, hold newer or torn events
+    const uint64_t capacity = header.eventsPerThread;
+    uint64_t firstValid = ringHeader.first;
+    if (headAfter + 1 > capacity) {
+      firstValid = std::max(firstValid, headAfter + 1 - capacity);
+    }
+    QFlightThreadEvents thread;
+    thread.tid = ringHeader.tid;
+    thread.numLost = std::min<uint64_t>(firstValid - ringHeader.first,
+                                        ringHeader.numEvents);
+    thread.events.assign(events.begin() + thread.numLost, events.end());
+    dump.threads.push_back(std::move(thread));
+  }
+  return QS_SUCCESS;
+}
+
+const char *QFlightRecorder::getEventName(QFlightEventType type) {
+  switch (type) {
+  case QFlightEventType::None:
+    return "None";
+  case QFlightEventType::Submit:
+    return "Submit";
+  case QFlightEventType::SubmitAgain:
+    return "SubmitAgain";
+  case QFlightEventType::SubmitBusy:
+    return "SubmitBusy";
+  case QFlightEventType::WaitStart:
+    return "WaitStart";
+  case QFlightEventType::WaitEnd:
+    return "WaitEnd";
+  case QFlightEventType::StateEnter:
+    return "StateEnter";
+  case QFlightEventType::ActivationCmd:
+    return "ActivationCmd";
+  case QFlightEventType::Ioctl:
+    return "Ioctl";
+  case QFlightEventType::DeviceEvent:
+    return "DeviceEvent";
+  case QFlightEventType::Error:
+    return "Error";
+  case QFlightEventType::Mark:
+    return "Mark";
+  }
+  return "Unknown";
+}
+
+static const char *deviceEventStr(uint64_t event) {
+  switch (event) {
+  case DEVICE_UP:
+    return "DEVICE_UP";
+  case DEVICE_DOWN:
+    return "DEVICE_DOWN";
+  case VC_UP:
+    return "VC_UP";
+  case VC_DOWN:
+    return "VC_DOWN";
+  case VC_UP_WAIT_TIMER_EXPIRY:
+    return "VC_UP_WAIT_TIMER_EXPIRY";
+  default:
+    return "INVALID_EVENT";
+  }
+}
+
+std::string QFlightRecorder::format(const QFlightEvent &event) {
+  const char *name = getEventName(event.type);
+  if ((event.flags & QFlightEventFlagText) != 0) {
+    char text[17] = {};
+    std::memcpy(text, &event.arg0, sizeof(event.arg0));
+    std::memcpy(text + sizeof(event.arg0), &event.arg1, sizeof(event.arg1));
+    return fmt::format("{} id {} {}", name, event.id, text);
+  }
+  switch (event.type) {
+  case QFlightEventType::Submit:
+  case QFlightEventType::WaitStart:
+    return fmt::format("{} qid {} vc {} handle {}", name, event.id,
+                       event.arg0, event.arg1);
+  case QFlightEventType::SubmitAgain:
+    return fmt::format("{} qid {} vc {} retry {}", name, event.id,
+                       event.arg0, event.arg1);
+  case QFlightEventType::SubmitBusy:
+    return fmt::format("{} qid {} vc {}", name, event.id, event.arg0);
+  case QFlightEventType::WaitEnd:
+    return fmt::format("{} qid {} handle {} {}", name, event.id, event.arg0,
+                       qutil::statusStr(static_cast<QStatus>(event.arg1)));
+  case QFlightEventType::ActivationCmd:
+    return fmt::format("{} qid {} cmd {} {}", name, event.id, event.arg0,
+                       qutil::statusStr(static_cast<QStatus>(event.arg1)));
+  case QFlightEventType::Ioctl:
+    return fmt::format("{} req {:#x} rc {} errno {}", name, event.id,
+                       static_cast<int64_t>(event.arg0), event.arg1);
+  case QFlightEventType::DeviceEvent:
+    return fmt::format("{} qid {} {} vc {}", name, event.id,
+                       deviceEventStr(event.arg0), event.arg1);
+  default:
+    return fmt::format("{} id {} {:#x} {:#x}", name, event.id, event.arg0,
+                       event.arg1);
+  }
+}
+
+void QFlightRecorder::print(const QFlightDump &dump, std::ostream &os) {
+  os << fmt::format("pid {} reason {} wall clock {}.{:09}\n", dump.pid,
+                    dump.reason, dump.realtimeNs / 1000000000ULL,
+                    dump.realtimeNs % 1000000000ULL);
+  std::vector<std::tuple<uint64_t, uint32_t, const QFlightEvent *>> merged;
+  for (const auto &thread : dump.threads) {
+    if (thread.numLost != 0) {
+      os << fmt::format("tid {} lost {} events while dumped\n", thread.tid,
+                        thread.numLost);
+    }
+    for (const auto &event : thread.events) {
+      merged.emplace_back(event.timeNs, thread.tid, &event);
+    }
+  }
+  std::stable_sort(merged.begin(), merged.end(),
+                   [](const auto &a, const auto &b) {
+                     return std::get<0>(a) < std::get<0>(b);
+                   });
+  // Times relative to the dump, in milliseconds
+  for (const auto &entry : merged) {
+    const double ms =
+        (static_cast<double>(std::get<0>(entry)) -
+         static_cast<double>(dump.monotonicNs)) /
+        1e6;
+    os << fmt::format("{:12.3f} ms tid {:<7} {}\n", ms, std::get<1>(entry),
+                      format(*std::get<2>(entry)));
+  }
+}
+
+//======================================================================
+// QFlightRecorderManager
+//======================================================================
+QFlightRecorder &QFlightRecorderManager::init() {
+  std::lock_guard<std::mutex> lk(m_);
+  QFlightRecorder *recorder = recorder_.load(std::memory_order_acquire);
+  if (recorder != nullptr) {
+    return *recorder;
+  }
+  uint32_t eventsPerThread = QFlightRecorder::defaultEventsPerThread;
+  if (const char *env = std::getenv(QAicFlightRecorderEventsEnv.c_str())) {
+    if (atoi(env) > 0) {
+      eventsPerThread = static_cast<uint32_t>(atoi(env));
+    } else {
+      LogWarnG("Ignoring invalid {} value {}", QAicFlightRecorderEventsEnv,
+               env);
+    }
+  }
+  // Threads record until the process exits, the recorder is never destroyed
+  recorder = new QFlightRecorder(eventsPerThread);
+  if (const char *env = std::getenv(QAicFlightRecorderEnv.c_str())) {
+    recorder->setEnabled(atoi(env) != 0);
+  }
+  if (const char *env = std::getenv(QAicFlightRecorderDirEnv.c_str())) {
+    (void)recorder->setDumpDir(env);
+  }
+  if (const char *env = std::getenv(QAicFlightRecorderSignalEnv.c_str())) {
+    (void)recorder->installSignalHandler(atoi(env));
+  }
+  recorder_.store(recorder, std::memory_order_release);
+  return *recorder;
+}
+
+QStatus QFlightRecorderManager::dumpOnError(const char *reason) {
+  QFlightRecorder &recorder = getRecorder();
+  if (!recorder.isEnabled()) {
+    return QS_SUCCESS;
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    const auto now = std::chrono::steady_clock::now();
+    if ((numErrorDumps_ >= maxErrorDumps) ||
+        ((numErrorDumps_ != 0) && (now - lastErrorDump_ < dumpInterval))) {
+      return QS_BUSY;
+    }
+    numErrorDumps_++;
+    lastErrorDump_ = now;
+  }
+  std::string path;
+  QStatus status = recorder.dumpToDir(reason, &path);
+  if (status == QS_SUCCESS) {
+    LogWarnG("Flight recorder dumped to {} on {}", path, reason);
+  } else {
+    LogWarnG("Flight recorder dump on {} failed", reason);
+  }
+  return status;
+}
+
+} // namespace qaic
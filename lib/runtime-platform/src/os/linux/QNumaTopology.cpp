@@ -0,0 +1,377 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QNumaTopology.h"
+#include "QOsal.h"
+#include "QUtil.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+namespace qaic {
+
+static const std::string QAicNumaPlacementEnv = "QAIC_NUMA_PLACEMENT";
+// Bounds what a corrupt cpulist can expand to
+constexpr uint32_t maxCpuId = 65535;
+
+QNumaPlacementShared QNumaPlacementManager::numaPlacement_;
+std::mutex QNumaPlacementManager::m_;
+
+//======================================================================
+// QNumaTopology
+//======================================================================
+QNumaTopology::QNumaTopology(std::string sysfsRoot)
+    : QLogger("QNumaTopology"), sysfsRoot_(std::move(sysfsRoot)) {}
+
+bool QNumaTopology::readLine(const std::string &path,
+                             std::string &line) const {
+  std::ifstream ifs(path);
+  if (!ifs.is_open()) {
+    return false;
+  }
+  std::getline(ifs, line);
+  return !ifs.bad();
+}
+
+QStatus QNumaTopology::parseCpuList(const std::string &list,
+                                    std::vector<uint32_t> &cpus) {
+  cpus.clear();
+  size_t pos = 0;
+  auto parseNumber = [&list, &pos](uint32_t &value) {
+    size_t start = pos;
+    uint64_t number = 0;
+    while ((pos < list.size()) && (list[pos] >= '0') && (list[pos] <= '9')) {
+      number = number * 10 + (list[pos] - '0');
+      if (number > maxCpuId) {
+        return false;
+      }
+      pos++;
+    }
+    value = static_cast<uint32_t>(number);
+    return pos != start;
+  };
+
+  // An empty list is valid, e.g. a memory only node
+  if ((list.empty()) || (list == "\n")) {
+    return QS_SUCCESS;
+  }
+  while (pos < list.size()) {
+    uint32_t first;
+    uint32_t last;
+    if (!parseNumber(first)) {
+      return QS_INVAL;
+    }
+    last = first;
+    if ((pos < list.size()) && (list[pos] == '-')) {
+      pos++;
+      if (!parseNumber(last) || (last < first)) {
+        return QS_INVAL;
+      }
+    }
+    for (uint32_t cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+    if (pos == list.size()) {
+      break;
+    }
+    if (list[pos] == '\n') {
+      pos++;
+      if (pos != list.size()) {
+        return QS_INVAL;
+      }
+      break;
+    }
+    if (list[pos] != ',') {
+      return QS_INVAL;
+    }
+    pos++;
+    if ((pos == list.size()) || (list[pos] == '\n')) {
+      return QS_INVAL;
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return QS_SUCCESS;
+}
+
+QStatus QNumaTopology::getOnlineNodes(std::vector<uint32_t> &nodes) const {
+  std::string line;
+  if (!readLine(sysfsRoot_ + "/devices/system/node/online", line)) {
+    return QS_UNSUPPORTED;
+  }
+  return parseCpuList(line, nodes);
+}
+
+QStatus QNumaTopology::getNodeCpus(uint32_t node,
+                                   std::vector<uint32_t> &cpus) const {
+  std::string line;
+  std::string path = fmt::format("{}/devices/system/node/node{}/cpulist",
+                                 sysfsRoot_, node);
+  if (!readLine(path, line)) {
+    return QS_INVAL;
+  }
+  return parseCpuList(line, cpus);
+}
+
+QStatus QNumaTopology::getDeviceLocality(const std::string &pciAddr,
+                                         QDeviceLocality &locality) const {
+  locality = QDeviceLocality();
+  const std::string devPath =
+      fmt::format("{}/bus/pci/devices/{}", sysfsRoot_, pciAddr);
+
+  std::string line;
+  if (!readLine(devPath + "/numa_node", line)) {
+    LogDebug("No NUMA information for device {}", pciAddr);
+    return QS_UNSUPPORTED;
+  }
+  char *end = nullptr;
+  long node = strtol(line.c_str(), &end, 10);
+  if ((end == line.c_str()) || (*end != '\0') || (node < -1) ||
+      (node > INT32_MAX)) {
+    LogError("Invalid NUMA node '{}' for device {}", line, pciAddr);
+    return QS_INVAL;
+  }
+  locality.numaNode = static_cast<int>(node);
+
+  // local_cpulist is the node cpulist on current kernels, older ones only
+  // report the node
+  QStatus status = QS_SUCCESS;
+  if (readLine(devPath + "/local_cpulist", line)) {
+    status = parseCpuList(line, locality.cpus);
+  } else if (locality.numaNode >= 0) {
+    status = getNodeCpus(static_cast<uint32_t>(locality.numaNode),
+                         locality.cpus);
+  }
+  if (status != QS_SUCCESS) {
+    LogError("Invalid local CPU list for device {}", pciAddr);
+    locality.cpus.clear();
+  }
+  return status;
+}
+
+//======================================================================
+// QNumaPlacement
+//======================================================================
+QNumaPlacement::QNumaPlacement(QNumaPolicy policy, QNumaTopology topology,
+                               std::map<QID, std::string> pciAddrs)
+    : QLogger("QNumaPlacement"), policy_(policy),
+      topology_(std::move(topology)), pciAddrs_(std::move(pciAddrs)) {}
+
+QStatus QNumaPlacement::parsePolicy(const std::string &name,
+                                    QNumaPolicy &policy) {
+  if (name.empty() || (name == "none")) {
+    policy = QNumaPolicy::None;
+  } else if (name == "device") {
+    policy = QNumaPolicy::DeviceLocal;
+  } else {
+    return QS_INVAL;
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QNumaPlacement::getDeviceLocalityLocked(QID qid,
+                                                QDeviceLocality &locality) {
+  auto cached = localities_.find(qid);
+  if (cached != localities_.end()) {
+    locality = cached->second;
+    return QS_SUCCESS;
+  }
+  auto pciAddr = pciAddrs_.find(qid);
+  if (pciAddr == pciAddrs_.end()) {
+    return QS_INVAL;
+  }
+  // Devices without NUMA information are cached as such
+  QStatus status = topology_.getDeviceLocality(pciAddr->second, locality);
+  if ((status != QS_SUCCESS) && (status != QS_UNSUPPORTED)) {
+    return status;
+  }
+  localities_[qid] = locality;
+  return QS_SUCCESS;
+}
+
+QStatus QNumaPlacement::getDeviceLocality(QID qid,
+                                          QDeviceLocality &locality) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return getDeviceLocalityLocked(qid, locality);
+}
+
+QStatus QNumaPlacement::bindThreadToDevice(QID qid) {
+  if (policy_ == QNumaPolicy::None) {
+    return QS_SUCCESS;
+  }
+  QDeviceLocality locality;
+  QStatus status = getDeviceLocality(qid, locality);
+  if ((status != QS_SUCCESS) || locality.cpus.empty()) {
+    return status;
+  }
+  if (QOsal::setThreadAffinity(locality.cpus) != 0) {
+    LogWarn("Failed to bind thread to the CPUs of device {}: {}", qid,
+            QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  return QS_SUCCESS;
+}
+
+std::vector<uint32_t> QNumaPlacement::getRuntimeCpus() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (runtimeCpusKnown_) {
+    return runtimeCpus_;
+  }
+  runtimeCpusKnown_ = true;
+
+  std::vector<uint32_t> nodes;
+  std::vector<uint32_t> cpus;
+  for (const auto &entry : pciAddrs_) {
+    QDeviceLocality locality;
+    if ((getDeviceLocalityLocked(entry.first, locality) != QS_SUCCESS) ||
+        (locality.numaNode < 0) || locality.cpus.empty()) {
+      // A device of unknown locality may be anywhere
+      return runtimeCpus_;
+    }
+    uint32_t node = static_cast<uint32_t>(locality.numaNode);
+    if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+      nodes.push_back(node);
+      cpus.insert(cpus.end(), locality.cpus.begin(), locality.cpus.end());
+    }
+  }
+  std::vector<uint32_t> onlineNodes;
+  if ((topology_.getOnlineNodes(onlineNodes) != QS_SUCCESS) ||
+      (nodes.size() >= onlineNodes.size())) {
+    return runtimeCpus_;
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  runtimeCpus_ = std::move(cpus);
+  return runtimeCpus_;
+}
+
+QStatus QNumaPlacement::bindCallerToDevice(QID qid) {
+  if (policy_ == QNumaPolicy::None) {
+    return QS_SUCCESS;
+  }
+  // Pinning done for the calling thread, the thread may drive devices of
+  // several placements in tests
+  struct CallerBinding {
+    const QNumaPlacement *placement = nullptr;
+    QID qid = 0;
+    bool pinned = false;
+    std::vector<uint32_t> cpus;
+    std::vector<uint32_t> ownCpus;
+  };
+  static thread_local CallerBinding binding;
+  if ((binding.placement == this) && (binding.qid == qid)) {
+    return QS_SUCCESS;
+  }
+
+  QDeviceLocality locality;
+  QStatus status = getDeviceLocality(qid, locality);
+  if (status != QS_SUCCESS) {
+    return status;
+  }
+  // A failed bind is not retried on every inference
+  binding.placement = this;
+  binding.qid = qid;
+
+  std::vector<uint32_t> cpus = std::move(locality.cpus);
+  if (cpus.empty()) {
+    if (!binding.pinned) {
+      return QS_SUCCESS;
+    }
+    cpus = binding.ownCpus;
+  } else if (!binding.pinned) {
+    if (QOsal::getThreadAffinity(binding.ownCpus) != 0) {
+      LogWarn("Failed to read thread affinity: {}",
+              QOsal::strerror_safe(errno));
+      return QS_ERROR;
+    }
+  }
+  if (binding.pinned && (cpus == binding.cpus)) {
+    return QS_SUCCESS;
+  }
+  if (QOsal::setThreadAffinity(cpus) != 0) {
+    LogWarn("Failed to bind thread to the CPUs of device {}: {}", qid,
+            QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  binding.pinned = (cpus != binding.ownCpus);
+  binding.cpus = std::move(cpus);
+  return QS_SUCCESS;
+}
+
+QStatus QNumaPlacement::bindRuntimeThread() {
+  if (policy_ == QNumaPolicy::None) {
+    return QS_SUCCESS;
+  }
+  std::vector<uint32_t> cpus = getRuntimeCpus();
+  if (cpus.empty()) {
+    return QS_SUCCESS;
+  }
+  if (QOsal::setThreadAffinity(cpus) != 0) {
+    LogWarn("Failed to bind runtime thread: {}", QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QNumaPlacement::bindMemoryToDevice(void *addr, size_t size,
+                                           QID qid) {
+  if ((addr == nullptr) || (size == 0)) {
+    return QS_INVAL;
+  }
+  if (policy_ == QNumaPolicy::None) {
+    return QS_SUCCESS;
+  }
+  QDeviceLocality locality;
+  QStatus status = getDeviceLocality(qid, locality);
+  if ((status != QS_SUCCESS) || (locality.numaNode < 0)) {
+    return status;
+  }
+  if (QOsal::bindMemoryToNode(addr, size, locality.numaNode) != 0) {
+    LogWarn("Failed to bind {} bytes to node {}: {}", size, locality.numaNode,
+            QOsal::strerror_safe(errno));
+    return QS_ERROR;
+  }
+  return QS_SUCCESS;
+}
+
+//======================================================================
+// QNumaPlacementManager
+//======================================================================
+QNumaPlacementShared &QNumaPlacementManager::getNumaPlacement() {
+  std::unique_lock<std::mutex> lk(m_);
+  if (QNumaPlacementManager::numaPlacement_ == nullptr) {
+    QNumaPolicy policy = QNumaPolicy::None;
+    if (const char *env = std::getenv(QAicNumaPlacementEnv.c_str())) {
+      if (QNumaPlacement::parsePolicy(env, policy) != QS_SUCCESS) {
+        LogWarnG("Ignoring invalid {} value {}", QAicNumaPlacementEnv, env);
+      }
+    }
+    std::map<QID, std::string> pciAddrs;
+    if (policy != QNumaPolicy::None) {
+      DevList devList;
+      QOsal::enumAicDevices(devList);
+      for (const auto &dev : devList) {
+        pciAddrs[dev.first] = qutil::qPciInfoToPCIeStr(dev.second);
+      }
+    }
+    QNumaPlacementManager::numaPlacement_ = std::make_shared<QNumaPlacement>(
+        policy, QNumaTopology(), std::move(pciAddrs));
+  }
+  return QNumaPlacementManager::numaPlacement_;
+}
+
+void QNumaPlacementManager::bindRuntimeThread() {
+  (void)getNumaPlacement()->bindRuntimeThread();
+}
+
+void QNumaPlacementManager::bindThreadToDevice(QID qid) {
+  (void)getNumaPlacement()->bindThreadToDevice(qid);
+}
+
+void QNumaPlacementManager::bindMemoryToDevice(void *addr, size_t size,
+                                               QID qid) {
+  (void)getNumaPlacement()->bindMemoryToDevice(addr, size, qid);
+}
+
+} // namespace qaic
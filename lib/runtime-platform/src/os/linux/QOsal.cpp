@@ -6,6 +6,7 @@
 #include "QUtil.h"
 #include "QDevCmd.h"
 #include "QDevMq.h"
+#include "QFlightRecorder.h"
 
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -27,6 +28,11 @@
 #include <libudev.h>
 #include <sys/utsname.h>
 #include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <linux/udmabuf.h>
+#include <limits>
+#include <unistd.h>
 
 extern "C" {
 #include <pci/pci.h>
@@ -212,6 +218,61 @@ int cpu_setaffinity(int cpu) {
   }
 }
 
+int setThreadAffinity(const std::vector<uint32_t> &cpus) {
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (uint32_t cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      errno = EINVAL;
+      return -1;
+    }
+    CPU_SET(cpu, &cpuset);
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset)) {
+    return -1;
+  }
+  return 0;
+}
+
+//
+// Prefer node for the pages of the range, without pulling in libnuma. The
+// range is widened to whole pages. Pages already touched elsewhere are
+// moved, those shared with another process stay where they are.
+//
+int bindMemoryToNode(void *addr, size_t length, int node) {
+  if ((addr == nullptr) || (length == 0) || (node < 0)) {
+    errno = EINVAL;
+    return -1;
+  }
+  const uintptr_t pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+  uintptr_t start = reinterpret_cast<uintptr_t>(addr) & ~(pageSize - 1);
+  uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + length + pageSize - 1) &
+                  ~(pageSize - 1);
+
+  constexpr size_t bitsPerWord = sizeof(unsigned long) * 8;
+  std::vector<unsigned long> nodeMask(node / bitsPerWord + 1, 0);
+  nodeMask[node / bitsPerWord] = 1UL << (node % bitsPerWord);
+  return static_cast<int>(::syscall(SYS_mbind, start, end - start,
+                                    MPOL_PREFERRED, nodeMask.data(),
+                                    nodeMask.size() * bitsPerWord + 1,
+                                    MPOL_MF_MOVE));
+}
+
+int getThreadAffinity(std::vector<uint32_t> &cpus) {
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset)) {
+    return -1;
+  }
+  cpus.clear();
+  for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &cpuset)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return 0;
+}
+
 int createUdevMap(UdevMap &udevMap, const std::string key,
                   uint8_t parentSearchStep) {
   struct udev *udev = nullptr;
@@ -376,14 +437,131 @@ int getCtrlChannelPath(std::string &path, const QPciInfo &pciInfo,
   return 1;
 }
 
-QStatus allocUserDmabuf(uint8_t __attribute__((unused)) * *buf,
-                        uint32_t __attribute__((unused)) size,
-                        __attribute__((unused)) uint64_t *hdl) {
+//
+// User dma-buf allocations are backed by a sealed memfd, hugetlb backed when
+// the size allows it, and exported through /dev/udmabuf. The returned handle
+// is the dma-buf file descriptor, it can be passed to the device as a
+// QBUFFER_TYPE_DMABUF buffer. The memfd is only needed until the dma-buf is
+// created, the dma-buf keeps the pages pinned.
+//
+struct UserDmabuf {
+  size_t size;
+  int dmabufFd;
+};
+static std::map<void *, UserDmabuf> userDmabufs;
+static const std::string udmabufDevice = "/dev/udmabuf";
+constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+static int createSealedMemfd(size_t size, bool hugetlb) {
+  unsigned int flags = MFD_CLOEXEC | MFD_ALLOW_SEALING;
+  if (hugetlb) {
+    flags |= MFD_HUGETLB;
+  }
+  int memFd = ::memfd_create("qaic-user-dmabuf", flags);
+  if (memFd < 0) {
+    return -1;
+  }
+  // udmabuf requires the memfd to be sealed against shrinking
+  if ((::ftruncate(memFd, size) < 0) ||
+      (::fcntl(memFd, F_ADD_SEALS, F_SEAL_SHRINK) < 0)) {
+    ::close(memFd);
+    return -1;
+  }
+  return memFd;
+}
 
-  return QS_UNSUPPORTED;
+QStatus allocUserDmabuf(uint8_t **buf, uint32_t size, uint64_t *hdl) {
+  if ((buf == nullptr) || (hdl == nullptr) || (size == 0)) {
+    return QS_INVAL;
+  }
+
+  int devFd = ::open(udmabufDevice.c_str(), O_RDWR | O_CLOEXEC);
+  if (devFd < 0) {
+    LogDebugG("{} not available: {}", udmabufDevice, strerror_safe(errno));
+    return QS_UNSUPPORTED;
+  }
+
+  const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  size_t allocSize = 0;
+  int memFd = -1;
+  if (size >= hugePageSize) {
+    allocSize = (size + hugePageSize - 1) & ~(hugePageSize - 1);
+    memFd = createSealedMemfd(allocSize, true);
+  }
+  if (memFd < 0) {
+    allocSize = (size + pageSize - 1) & ~(pageSize - 1);
+    memFd = createSealedMemfd(allocSize, false);
+  }
+  if (memFd < 0) {
+    LogErrorG("Failed to create memfd of size {}: {}", allocSize,
+              strerror_safe(errno));
+    ::close(devFd);
+    return QS_NOMEM;
+  }
+
+  struct udmabuf_create create = {};
+  create.memfd = static_cast<uint32_t>(memFd);
+  create.flags = UDMABUF_FLAGS_CLOEXEC;
+  create.offset = 0;
+  create.size = allocSize;
+  int dmabufFd = ::ioctl(devFd, UDMABUF_CREATE, &create);
+  ::close(devFd);
+  if (dmabufFd < 0) {
+    LogErrorG("Failed to create udmabuf of size {}: {}", allocSize,
+              strerror_safe(errno));
+    ::close(memFd);
+    return QS_ERROR;
+  }
+
+  void *vaddr = ::mmap(nullptr, allocSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       memFd, 0);
+  ::close(memFd);
+  if (vaddr == MAP_FAILED) {
+    LogErrorG("Failed to map user dma-buf: {}", strerror_safe(errno));
+    ::close(dmabufFd);
+    return QS_NOMEM;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    userDmabufs[vaddr] = {allocSize, dmabufFd};
+  }
+  *buf = reinterpret_cast<uint8_t *>(vaddr);
+  *hdl = static_cast<uint64_t>(dmabufFd);
+  return QS_SUCCESS;
 }
 
-void freeUserDmabuf(void __attribute__((unused)) * vaddr) {}
+void freeUserDmabuf(void *vaddr) {
+  UserDmabuf dmabuf;
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = userDmabufs.find(vaddr);
+    if (it == userDmabufs.end()) {
+      LogErrorG("Unknown user dma-buf {}", vaddr);
+      return;
+    }
+    dmabuf = it->second;
+    userDmabufs.erase(it);
+  }
+  ::munmap(vaddr, dmabuf.size);
+  ::close(dmabuf.dmabufFd);
+}
+
+QStatus getDmabufKey(const QBuffer &buffer, QDmabufKey &key) {
+  if ((buffer.type != QBufferType::QBUFFER_TYPE_DMABUF) ||
+      (buffer.handle > static_cast<uint64_t>(std::numeric_limits<int>::max()))) {
+    return QS_INVAL;
+  }
+  struct stat st;
+  if (::fstat(static_cast<int>(buffer.handle), &st) < 0) {
+    return QS_BADFD;
+  }
+  key.dev = static_cast<uint64_t>(st.st_dev);
+  key.ino = static_cast<uint64_t>(st.st_ino);
+  key.offset = buffer.offset;
+  key.size = buffer.size;
+  return QS_SUCCESS;
+}
 
 uint32_t getMemReqSize(size_t size) { return (uint32_t)size; }
 
@@ -492,6 +670,11 @@ QStatus runIoctlCmd(int devFd, QDevCmd &devCmd) {
   }
 
   rc = ioctl(devFd, devCmd.cmdReq, devCmd.cmdRspBuf);
+  const int savedErrno = errno;
+  qFlightRecord(QFlightEventType::Ioctl,
+                static_cast<uint32_t>(devCmd.cmdReq), rc,
+                (rc < 0) ? savedErrno : 0);
+  errno = savedErrno;
   if (rc < 0) {
     status = QS_INVAL;
   }
@@ -0,0 +1,195 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicOpenRtAicStats.hpp"
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtAicStatsUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtAicStatsUnitTest(){};
+  ~QAicOpenRtAicStatsUnitTest() = default;
+
+  QAicOpenRtAicStatsUnitTest(const QAicOpenRtAicStatsUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtAicStatsUnitTest &
+  operator=(const QAicOpenRtAicStatsUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void AicStatsDecodeTest();
+  void AicStatsExportTest();
+  void AicStatsInvalidTest();
+
+  aicnwdesc::Stats syntheticStats();
+  std::vector<uint64_t> syntheticBuffer(uint32_t numSnapshots);
+  std::string readFile(const std::string &path);
+};
+
+// Two cores, core 0 runs 2 ops over 2 thread groups, core 1 runs 1 op.
+// One PMU event is selected.
+aicnwdesc::Stats QAicOpenRtAicStatsUnitTest::syntheticStats() {
+  aicnwdesc::Stats stats;
+  stats.set_print_op_stats(true);
+  stats.add_ops_per_core(2);
+  stats.add_ops_per_core(1);
+  stats.add_pmu_events(17);
+  auto *core0 = stats.add_core_op_name_kinds();
+  auto *op = core0->add_tg_op_name_kinds()->add_op_name_kinds();
+  op->set_name("conv1");
+  op->set_kind("Convolution");
+  op = core0->add_tg_op_name_kinds()->add_op_name_kinds();
+  op->set_name("relu,1");
+  op->set_kind("Relu");
+  // core 1 names intentionally absent
+  return stats;
+}
+
+std::vector<uint64_t>
+QAicOpenRtAicStatsUnitTest::syntheticBuffer(uint32_t numSnapshots) {
+  std::vector<uint64_t> words;
+  for (uint32_t it = 0; it < numSnapshots; it++) {
+    const uint64_t base = 1000 * (it + 1);
+    // core 0
+    words.insert(words.end(), {base + 0, base + 100, 5});
+    words.insert(words.end(), {base + 100, base + 150, 6});
+    // core 1
+    words.insert(words.end(), {base + 10, base + 210, 7});
+  }
+  return words;
+}
+
+std::string QAicOpenRtAicStatsUnitTest::readFile(const std::string &path) {
+  std::ifstream ifs(path);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+void QAicOpenRtAicStatsUnitTest::AicStatsDecodeTest() {
+  qaic::openrt::shAicStats aicStats =
+      qaic::openrt::AicStats::Factory(syntheticStats());
+  ASSERT_TRUE(aicStats != nullptr);
+  ASSERT_TRUE(aicStats->getSnapshotSize() == 3 * 3 * sizeof(uint64_t));
+
+  std::vector<uint64_t> words = syntheticBuffer(2);
+  QBuffer qbuf;
+  qbuf.buf = reinterpret_cast<uint8_t *>(words.data());
+  qbuf.size = words.size() * sizeof(uint64_t);
+
+  std::vector<qaic::openrt::AicOpStat> ops;
+  ASSERT_TRUE(aicStats->decode(qbuf, ops) == QS_SUCCESS);
+  ASSERT_TRUE(ops.size() == 6);
+
+  ASSERT_TRUE(ops.at(0).name == "conv1");
+  ASSERT_TRUE(ops.at(0).kind == "Convolution");
+  ASSERT_TRUE(ops.at(0).cycles() == 100);
+  ASSERT_TRUE(ops.at(0).pmuCounts.size() == 1);
+  ASSERT_TRUE(ops.at(0).pmuCounts.at(0) == 5);
+
+  // Second op comes from the second thread group of core 0
+  ASSERT_TRUE(ops.at(1).name == "relu,1");
+  ASSERT_TRUE(ops.at(1).cycles() == 50);
+
+  // Core 1 has no names in the descriptor
+  ASSERT_TRUE(ops.at(2).core == 1);
+  ASSERT_TRUE(ops.at(2).name == "op0");
+  ASSERT_TRUE(ops.at(2).cycles() == 200);
+
+  ASSERT_TRUE(ops.at(3).iteration == 1);
+  ASSERT_TRUE(ops.at(3).startCycle == 2000);
+
+  // Locate the stats buffer by name
+  BufferMappings mappings;
+  mappings.emplace_back("out", 0, QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT,
+                        16, false,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT);
+  mappings.emplace_back(qaic::openrt::AicStats::statsBufferName, 1,
+                        QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT,
+                        static_cast<uint32_t>(qbuf.size), false,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  std::vector<QBuffer> buffers{QBuffer(), qbuf};
+  QBuffer found;
+  ASSERT_TRUE(qaic::openrt::AicStats::findStatsBuffer(mappings, buffers,
+                                                      found) == QS_SUCCESS);
+  ASSERT_TRUE(found.buf == qbuf.buf);
+  mappings.pop_back();
+  ASSERT_TRUE(qaic::openrt::AicStats::findStatsBuffer(mappings, buffers,
+                                                      found) == QS_INVAL);
+}
+
+void QAicOpenRtAicStatsUnitTest::AicStatsExportTest() {
+  qaic::openrt::shAicStats aicStats =
+      qaic::openrt::AicStats::Factory(syntheticStats());
+  ASSERT_TRUE(aicStats != nullptr);
+  aicStats->setCyclesPerUs(10.0);
+
+  std::vector<uint64_t> words = syntheticBuffer(1);
+  QBuffer qbuf;
+  qbuf.buf = reinterpret_cast<uint8_t *>(words.data());
+  qbuf.size = words.size() * sizeof(uint64_t);
+  std::vector<qaic::openrt::AicOpStat> ops;
+  ASSERT_TRUE(aicStats->decode(qbuf, ops) == QS_SUCCESS);
+
+  const std::string tracePath = "/tmp/" + testName() + ".json";
+  const std::string csvPath = "/tmp/" + testName() + ".csv";
+  ASSERT_TRUE(aicStats->writeChromeTrace(ops, tracePath) == QS_SUCCESS);
+  ASSERT_TRUE(aicStats->writeCsv(ops, csvPath) == QS_SUCCESS);
+
+  std::string trace = readFile(tracePath);
+  ASSERT_TRUE(trace.find("\"traceEvents\"") != std::string::npos);
+  ASSERT_TRUE(trace.find("\"name\":\"conv1\"") != std::string::npos);
+  // relu starts 100 cycles after the first op, 10 cycles per us
+  ASSERT_TRUE(trace.find("\"ts\":10.000,\"dur\":5.000") != std::string::npos);
+  ASSERT_TRUE(trace.find("\"pmu_17\":6") != std::string::npos);
+
+  std::string csv = readFile(csvPath);
+  ASSERT_TRUE(csv.find("iteration,core,op,name") == 0);
+  ASSERT_TRUE(csv.find("0,0,1,\"relu,1\",Relu,1100,1150,50,5.000,33.333,6") !=
+              std::string::npos);
+
+  std::remove(tracePath.c_str());
+  std::remove(csvPath.c_str());
+}
+
+void QAicOpenRtAicStatsUnitTest::AicStatsInvalidTest() {
+  qaic::openrt::shAicStats aicStats =
+      qaic::openrt::AicStats::Factory(syntheticStats());
+  ASSERT_TRUE(aicStats != nullptr);
+
+  // Buffer smaller than one snapshot
+  std::vector<uint64_t> words(4);
+  QBuffer qbuf;
+  qbuf.buf = reinterpret_cast<uint8_t *>(words.data());
+  qbuf.size = words.size() * sizeof(uint64_t);
+  std::vector<qaic::openrt::AicOpStat> ops;
+  ASSERT_TRUE(aicStats->decode(qbuf, ops) == QS_INVAL);
+
+  qbuf.buf = nullptr;
+  ASSERT_TRUE(aicStats->decode(qbuf, ops) == QS_INVAL);
+
+  // Descriptor without ops
+  aicnwdesc::Stats empty;
+  ASSERT_THROW(qaic::openrt::AicStats::Factory(empty),
+               qaic::openrt::CoreExceptionInit);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtAicStatsUnitTest, AicStatsDecodeTest) {
+  AicStatsDecodeTest();
+}
+
+TEST_F(QAicOpenRtAicStatsUnitTest, AicStatsExportTest) {
+  AicStatsExportTest();
+}
+
+TEST_F(QAicOpenRtAicStatsUnitTest, AdversarialAicStatsInvalidTest) {
+  AicStatsInvalidTest();
+}
+
+} // namespace QAicOpenRtUnitTest
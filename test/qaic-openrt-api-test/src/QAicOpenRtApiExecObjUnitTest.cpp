@@ -25,6 +25,7 @@ protected:
   void TestRunInference(std::string, uint32_t,
                         TestType type = TestType::TEST_TYPE_NORMAL);
   void TestRunInferenceProgramPreActivated(std::string, uint32_t);
+  void TestRunInferenceProgramStandby(std::string, uint32_t);
   void TestRunInferencePartialTensor(std::string, uint32_t);
 }; // class QAicOpenRtApiExecObjUnitTest
 
@@ -157,6 +158,59 @@ void QAicOpenRtApiExecObjUnitTest::TestRunInferenceProgramPreActivated(
   }
 }
 
+void QAicOpenRtApiExecObjUnitTest::TestRunInferenceProgramStandby(
+    std::string testBasePath, uint32_t numInference) {
+  std::vector<QID> devIds;
+  QAicContextProperties properties = 0x00;
+  qaic::openrt::Util util;
+  QStatus status;
+  ASSERT_TRUE(util.getDeviceIds(devIds) == QS_SUCCESS);
+  qaic::openrt::shContext context =
+      qaic::openrt::Context::Factory(&properties, devIds);
+  ASSERT_TRUE(context != nullptr);
+
+  qaic::openrt::shQpc qpc;
+
+  qpc = qaic::openrt::Qpc::Factory(testBasePath);
+
+  ASSERT_TRUE(qpc);
+
+  qaic::openrt::shProgram program;
+  QAicProgramProperties programProperties;
+  qaic::openrt::Program::initProperties(programProperties);
+
+  program = qaic::openrt::Program::Factory(context, devIds.front(), "TestName",
+                                           qpc, &programProperties);
+
+  ASSERT_TRUE(program);
+
+  ASSERT_TRUE(program->standby() == QS_SUCCESS) << "Program standby failed";
+  ASSERT_TRUE(program->isStandby());
+
+  qaic::openrt::shExecObj execObj;
+  execObj = qaic::openrt::ExecObj::Factory(context, program);
+
+  ASSERT_TRUE(execObj);
+  // Creating the ExecObj does not take the program out of standby
+  ASSERT_TRUE(program->isStandby());
+
+  qaic::openrt::shInferenceVector inferenceVect =
+      qaic::openrt::InferenceVector::Factory(qpc);
+  ASSERT_TRUE(inferenceVect);
+
+  std::vector<QBuffer> data = inferenceVect->getVector();
+  execObj->setData(data);
+
+  for (auto i = 0; i < numInference; i++) {
+    LogInfo("Starting inference number {}", i + 1);
+    status = execObj->run();
+
+    ASSERT_TRUE(status == QS_SUCCESS) << "Inference run fail";
+    // The first run moved the program to ready before submitting
+    ASSERT_TRUE(program->isActivated());
+  }
+}
+
 void QAicOpenRtApiExecObjUnitTest::TestRunInferencePartialTensor(
     std::string testBasePath, uint32_t numInference) {
   std::vector<QID> devIds;
@@ -247,6 +301,11 @@ TEST_F(QAicOpenRtApiExecObjUnitTest, RunInferenceTestProgramPreActivated) {
       "/opt/qti-aic/test-data/aic100/v2/4nsp/4nsp-add", 10 /*Num inferences*/);
 }
 
+TEST_F(QAicOpenRtApiExecObjUnitTest, RunInferenceTestProgramStandby) {
+  TestRunInferenceProgramStandby(
+      "/opt/qti-aic/test-data/aic100/v2/4nsp/4nsp-add", 10 /*Num inferences*/);
+}
+
 TEST_F(QAicOpenRtApiExecObjUnitTest, DISABLED_RunInferenceTestPartialTensor) {
   // TODO: Enable once we have a QPC that allows partialtensor
   TestRunInferencePartialTensor(
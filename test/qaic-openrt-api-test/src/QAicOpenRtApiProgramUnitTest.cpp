@@ -21,6 +21,7 @@ public:
 protected:
   void TestCreateProgram(std::string);
   void TestLoadActivateProgram(std::string);
+  void TestStandbyActivateProgram(std::string);
 
 }; // class QAicOpenRtApiProgramUnitTest
 
@@ -100,6 +101,55 @@ void QAicOpenRtApiProgramUnitTest::TestLoadActivateProgram(
   ASSERT_TRUE(program->unload() == QS_SUCCESS) << "Program unload failed";
 }
 
+void QAicOpenRtApiProgramUnitTest::TestStandbyActivateProgram(
+    std::string testBasePath) {
+  std::vector<QID> devIds;
+  QAicContextProperties properties = 0x00;
+  qaic::openrt::Util util;
+  ASSERT_TRUE(util.getDeviceIds(devIds) == QS_SUCCESS);
+  qaic::openrt::shContext context =
+      qaic::openrt::Context::Factory(&properties, devIds);
+  ASSERT_TRUE(context != nullptr);
+
+  qaic::openrt::shQpc qpc;
+
+  qpc = qaic::openrt::Qpc::Factory(testBasePath);
+
+  ASSERT_TRUE(qpc);
+
+  qaic::openrt::shProgram program;
+  QAicProgramProperties programProperties;
+  qaic::openrt::Program::initProperties(programProperties);
+
+  program = qaic::openrt::Program::Factory(context, devIds.front(), "TestName",
+                                           qpc, &programProperties);
+
+  ASSERT_TRUE(program);
+
+  // STANDBY_SIG from created loads and activates in standby
+  ASSERT_TRUE(program->standby() == QS_SUCCESS) << "Program standby failed";
+  ASSERT_TRUE(program->isStandby());
+  ASSERT_FALSE(program->isActivated());
+
+  // A second standby request leaves the activation as is
+  ASSERT_TRUE(program->standby() == QS_SUCCESS) << "Program standby failed";
+  ASSERT_TRUE(program->isStandby());
+
+  // ACTIVATE_SIG moves the standby activation to ready
+  ASSERT_TRUE(program->activate() == QS_SUCCESS) << "Program activate failed";
+  ASSERT_TRUE(program->isActivated());
+  ASSERT_FALSE(program->isStandby());
+
+  // Standby does not take a ready program back
+  ASSERT_TRUE(program->standby() == QS_SUCCESS) << "Program standby failed";
+  ASSERT_TRUE(program->isActivated());
+
+  ASSERT_TRUE(program->deactivate() == QS_SUCCESS)
+      << "Program deactivate failed";
+  ASSERT_FALSE(program->isStandby());
+  ASSERT_TRUE(program->unload() == QS_SUCCESS) << "Program unload failed";
+}
+
 TEST_F(QAicOpenRtApiProgramUnitTest, CreateProgramTest) {
   TestCreateProgram(
       "/opt/qti-aic/test-data/aic100/v2/4nsp/4nsp-quant-resnet50");
@@ -110,4 +160,9 @@ TEST_F(QAicOpenRtApiProgramUnitTest, LoadActivateProgramTest) {
       "/opt/qti-aic/test-data/aic100/v2/4nsp/4nsp-quant-resnet50");
 }
 
+TEST_F(QAicOpenRtApiProgramUnitTest, StandbyActivateProgramTest) {
+  TestStandbyActivateProgram(
+      "/opt/qti-aic/test-data/aic100/v2/4nsp/4nsp-quant-resnet50");
+}
+
 } // namespace QAicOpenRtContextUnitTest
\ No newline at end of file
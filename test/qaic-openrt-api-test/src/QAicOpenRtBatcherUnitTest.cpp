@@ -0,0 +1,377 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicOpenRtBatcher.hpp"
+
+#include <atomic>
+#include <future>
+#include <thread>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtBatcherUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtBatcherUnitTest(){};
+  ~QAicOpenRtBatcherUnitTest() = default;
+
+  QAicOpenRtBatcherUnitTest(const QAicOpenRtBatcherUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtBatcherUnitTest &
+  operator=(const QAicOpenRtBatcherUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  static constexpr uint32_t batchSize = 4;
+  static constexpr uint32_t sampleSize = 16;
+
+  void BatcherFullBatchTest();
+  void BatcherDeadlineTest();
+  void BatcherPartialBufferTest();
+  void BatcherInvalidInputTest();
+  void BatcherRequestDeadlineTest();
+  void BatcherCancelTest();
+  void BatcherProgramBatchSizeTest(const std::string &testBasePath);
+
+  BufferMappings simulatedMappings(bool partial);
+  qaic::openrt::BatchExecFunction simulatedBackend();
+  qaic::openrt::BatchExecFunction busyBackend(std::shared_future<void> gate);
+  std::vector<uint8_t> sample(uint8_t seed);
+
+  // Recorded by the simulated backend
+  std::atomic<uint32_t> lastNumValid_{0};
+  std::atomic<uint32_t> lastInputSize_{0};
+  std::atomic<uint32_t> numBusyCalls_{0};
+};
+
+BufferMappings QAicOpenRtBatcherUnitTest::simulatedMappings(bool partial) {
+  BufferMappings mappings;
+  mappings.emplace_back("input", 0, QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT,
+                        batchSize * sampleSize, partial,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  mappings.emplace_back("output", 1,
+                        QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT,
+                        batchSize * sampleSize, false,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  return mappings;
+}
+
+// The simulated backend adds one to every input byte of every slot
+qaic::openrt::BatchExecFunction QAicOpenRtBatcherUnitTest::simulatedBackend() {
+  return [this](std::vector<QBuffer> &buffers, uint32_t numValid) -> QStatus {
+    if (buffers.size() != 2) {
+      return QS_INVAL;
+    }
+    lastNumValid_ = numValid;
+    lastInputSize_ = buffers.at(0).size;
+    for (uint32_t i = 0; i < buffers.at(0).size; i++) {
+      buffers.at(1).buf[i] = buffers.at(0).buf[i] + 1;
+    }
+    return QS_SUCCESS;
+  };
+}
+
+// Same as the simulated backend, the first batch keeps the device busy until
+// the gate opens
+qaic::openrt::BatchExecFunction
+QAicOpenRtBatcherUnitTest::busyBackend(std::shared_future<void> gate) {
+  qaic::openrt::BatchExecFunction backend = simulatedBackend();
+  return [this, gate, backend](std::vector<QBuffer> &buffers,
+                               uint32_t numValid) -> QStatus {
+    if (numBusyCalls_++ == 0) {
+      gate.wait();
+    }
+    return backend(buffers, numValid);
+  };
+}
+
+std::vector<uint8_t> QAicOpenRtBatcherUnitTest::sample(uint8_t seed) {
+  std::vector<uint8_t> data(sampleSize);
+  for (uint32_t i = 0; i < sampleSize; i++) {
+    data.at(i) = static_cast<uint8_t>(seed + i);
+  }
+  return data;
+}
+
+void QAicOpenRtBatcherUnitTest::BatcherFullBatchTest() {
+  qaic::openrt::BatcherProperties properties;
+  properties.batchSize = batchSize;
+  properties.maxWait = std::chrono::seconds(10);
+  qaic::openrt::shBatcher batcher = qaic::openrt::Batcher::Factory(
+      simulatedMappings(false), properties,
+      {simulatedBackend(), simulatedBackend()});
+  ASSERT_TRUE(batcher != nullptr);
+
+  constexpr uint32_t numSamples = batchSize * 8;
+  std::vector<std::future<qaic::openrt::BatchSampleResult>> futures(
+      numSamples);
+  std::vector<std::thread> submitters;
+  for (uint32_t t = 0; t < batchSize; t++) {
+    submitters.emplace_back([&, t]() {
+      for (uint32_t s = t; s < numSamples; s += batchSize) {
+        std::vector<uint8_t> data = sample(static_cast<uint8_t>(s));
+        QBuffer qbuf{sampleSize, data.data(), 0, 0,
+                     QBufferType::QBUFFER_TYPE_HEAP};
+        futures.at(s) = batcher->submit({qbuf});
+      }
+    });
+  }
+  for (auto &t : submitters) {
+    t.join();
+  }
+
+  // Full batches never wait for the deadline
+  for (uint32_t s = 0; s < numSamples; s++) {
+    ASSERT_TRUE(futures.at(s).wait_for(std::chrono::seconds(5)) ==
+                std::future_status::ready);
+    qaic::openrt::BatchSampleResult result = futures.at(s).get();
+    ASSERT_TRUE(result.status == QS_SUCCESS);
+    ASSERT_TRUE(result.outputs.size() == 1);
+    std::vector<uint8_t> expected = sample(static_cast<uint8_t>(s + 1));
+    ASSERT_TRUE(result.outputs.at(0) == expected);
+  }
+
+  uint64_t batches = 0;
+  uint64_t samples = 0;
+  batcher->getStats(batches, samples);
+  ASSERT_TRUE(batches == numSamples / batchSize);
+  ASSERT_TRUE(samples == numSamples);
+}
+
+void QAicOpenRtBatcherUnitTest::BatcherDeadlineTest() {
+  qaic::openrt::BatcherProperties properties;
+  properties.batchSize = batchSize;
+  properties.maxWait = std::chrono::milliseconds(5);
+  qaic::openrt::shBatcher batcher = qaic::openrt::Batcher::Factory(
+      simulatedMappings(false), properties, {simulatedBackend()});
+  ASSERT_TRUE(batcher != nullptr);
+
+  std::vector<uint8_t> data = sample(7);
+  QBuffer qbuf{sampleSize, data.data(), 0, 0, QBufferType::QBUFFER_TYPE_HEAP};
+  auto future = batcher->submit({qbuf});
+  ASSERT_TRUE(future.wait_for(std::chrono::seconds(5)) ==
+              std::future_status::ready);
+  qaic::openrt::BatchSampleResult result = future.get();
+  ASSERT_TRUE(result.status == QS_SUCCESS);
+  ASSERT_TRUE(result.outputs.at(0) == sample(8));
+
+  // Partial batch is padded to the full batch size
+  ASSERT_TRUE(lastNumValid_ == 1);
+  ASSERT_TRUE(lastInputSize_ == batchSize * sampleSize);
+}
+
+void QAicOpenRtBatcherUnitTest::BatcherPartialBufferTest() {
+  qaic::openrt::BatcherProperties properties;
+  properties.batchSize = batchSize;
+  properties.maxWait = std::chrono::milliseconds(5);
+  properties.padPartialBatch = false;
+  qaic::openrt::shBatcher batcher = qaic::openrt::Batcher::Factory(
+      simulatedMappings(true), properties, {simulatedBackend()});
+  ASSERT_TRUE(batcher != nullptr);
+
+  std::vector<std::future<qaic::openrt::BatchSampleResult>> futures;
+  for (uint8_t s = 0; s < 2; s++) {
+    std::vector<uint8_t> data = sample(s);
+    QBuffer qbuf{sampleSize, data.data(), 0, 0,
+                 QBufferType::QBUFFER_TYPE_HEAP};
+    futures.emplace_back(batcher->submit({qbuf}));
+  }
+  for (uint8_t s = 0; s < 2; s++) {
+    qaic::openrt::BatchSampleResult result = futures.at(s).get();
+    ASSERT_TRUE(result.status == QS_SUCCESS);
+    ASSERT_TRUE(result.outputs.at(0) == sample(s + 1));
+  }
+  // Input allows partial buffers, only the valid samples are sent
+  ASSERT_TRUE(lastInputSize_ == lastNumValid_ * sampleSize);
+}
+
+void QAicOpenRtBatcherUnitTest::BatcherInvalidInputTest() {
+  qaic::openrt::BatcherProperties properties;
+  properties.batchSize = batchSize;
+  qaic::openrt::shBatcher batcher = qaic::openrt::Batcher::Factory(
+      simulatedMappings(false), properties, {simulatedBackend()});
+  ASSERT_TRUE(batcher != nullptr);
+
+  // Wrong sample size
+  std::vector<uint8_t> data(sampleSize * 2);
+  QBuffer qbuf{static_cast<uint32_t>(data.size()), data.data(), 0, 0,
+               QBufferType::QBUFFER_TYPE_HEAP};
+  ASSERT_TRUE(batcher->submit({qbuf}).get().status == QS_INVAL);
+
+  // Wrong number of inputs
+  ASSERT_TRUE(batcher->submit({}).get().status == QS_INVAL);
+
+  // Rejected once stopped
+  batcher->stop();
+  qbuf.size = sampleSize;
+  ASSERT_TRUE(batcher->submit({qbuf}).get().status == QS_BUSY);
+
+  // Batch size must divide every buffer
+  properties.batchSize = 3;
+  ASSERT_THROW(qaic::openrt::Batcher::Factory(simulatedMappings(false),
+                                              properties, {simulatedBackend()}),
+               qaic::openrt::CoreExceptionInit);
+
+  // Without a program the batch size is not known
+  properties.batchSize = 0;
+  ASSERT_THROW(qaic::openrt::Batcher::Factory(simulatedMappings(false),
+                                              properties, {simulatedBackend()}),
+               qaic::openrt::CoreExceptionInit);
+}
+
+void QAicOpenRtBatcherUnitTest::BatcherRequestDeadlineTest() {
+  using Clock = qaic::openrt::Batcher::Clock;
+  qaic::openrt::BatcherProperties properties;
+  properties.batchSize = batchSize;
+  properties.maxWait = std::chrono::milliseconds(1);
+  std::promise<void> gate;
+  qaic::openrt::shBatcher batcher = qaic::openrt::Batcher::Factory(
+      simulatedMappings(false), properties,
+      {busyBackend(gate.get_future().share())});
+  ASSERT_TRUE(batcher != nullptr);
+
+  std::vector<uint8_t> data = sample(3);
+  QBuffer qbuf{sampleSize, data.data(), 0, 0, QBufferType::QBUFFER_TYPE_HEAP};
+
+  // Already late, never queued
+  auto late = batcher->submit({qbuf}, Clock::now());
+  ASSERT_TRUE(late.get().status == QS_DEADLINE_EXCEEDED);
+
+  // Occupy the device
+  auto first = batcher->submit({qbuf});
+  while (numBusyCalls_ == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // Expires while queued behind the busy device
+  auto expiring =
+      batcher->submit({qbuf}, Clock::now() + std::chrono::milliseconds(10));
+  auto patient =
+      batcher->submit({qbuf}, Clock::now() + std::chrono::seconds(60));
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  gate.set_value();
+
+  ASSERT_TRUE(first.get().status == QS_SUCCESS);
+  ASSERT_TRUE(expiring.get().status == QS_DEADLINE_EXCEEDED);
+  qaic::openrt::BatchSampleResult result = patient.get();
+  ASSERT_TRUE(result.status == QS_SUCCESS);
+  ASSERT_TRUE(result.outputs.at(0) == sample(4));
+  // The expired sample did not take a slot
+  ASSERT_TRUE(lastNumValid_ == 1);
+
+  uint64_t expired = 0;
+  uint64_t canceled = 0;
+  batcher->getDropStats(expired, canceled);
+  ASSERT_TRUE(expired == 1);
+  ASSERT_TRUE(canceled == 0);
+}
+
+void QAicOpenRtBatcherUnitTest::BatcherCancelTest() {
+  qaic::openrt::BatcherProperties properties;
+  properties.batchSize = batchSize;
+  properties.maxWait = std::chrono::milliseconds(1);
+  std::promise<void> gate;
+  qaic::openrt::shBatcher batcher = qaic::openrt::Batcher::Factory(
+      simulatedMappings(false), properties,
+      {busyBackend(gate.get_future().share())});
+  ASSERT_TRUE(batcher != nullptr);
+
+  std::vector<uint8_t> data = sample(9);
+  QBuffer qbuf{sampleSize, data.data(), 0, 0, QBufferType::QBUFFER_TYPE_HEAP};
+  qaic::openrt::Batcher::RequestID firstId = 0;
+  auto first = batcher->submit(
+      {qbuf}, qaic::openrt::Batcher::Clock::time_point::max(), &firstId);
+  while (numBusyCalls_ == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  // Dispatched already
+  ASSERT_FALSE(batcher->cancel(firstId));
+
+  qaic::openrt::Batcher::RequestID queuedId = 0;
+  auto queued = batcher->submit(
+      {qbuf}, qaic::openrt::Batcher::Clock::time_point::max(), &queuedId);
+  auto kept = batcher->submit({qbuf});
+  ASSERT_TRUE(batcher->cancel(queuedId));
+  ASSERT_FALSE(batcher->cancel(queuedId));
+  ASSERT_TRUE(queued.get().status == QS_CANCELED);
+  gate.set_value();
+
+  ASSERT_TRUE(first.get().status == QS_SUCCESS);
+  ASSERT_TRUE(kept.get().status == QS_SUCCESS);
+  ASSERT_FALSE(batcher->cancel(0));
+
+  uint64_t expired = 0;
+  uint64_t canceled = 0;
+  batcher->getDropStats(expired, canceled);
+  ASSERT_TRUE(expired == 0);
+  ASSERT_TRUE(canceled == 1);
+}
+
+void QAicOpenRtBatcherUnitTest::BatcherProgramBatchSizeTest(
+    const std::string &testBasePath) {
+  std::vector<QID> devIds;
+  QAicContextProperties contextProperties = 0x00;
+  qaic::openrt::Util util;
+  ASSERT_TRUE(util.getDeviceIds(devIds) == QS_SUCCESS);
+  qaic::openrt::shContext context =
+      qaic::openrt::Context::Factory(&contextProperties, devIds);
+  ASSERT_TRUE(context != nullptr);
+  qaic::openrt::shQpc qpc = qaic::openrt::Qpc::Factory(testBasePath);
+  ASSERT_TRUE(qpc);
+  QAicProgramProperties programProperties;
+  qaic::openrt::Program::initProperties(programProperties);
+  qaic::openrt::shProgram program = qaic::openrt::Program::Factory(
+      context, devIds.front(), "TestName", qpc, &programProperties);
+  ASSERT_TRUE(program);
+  const int32_t compiledBatchSize =
+      program->getProgram()->getNetworkDesc()->batch_size();
+  ASSERT_TRUE(compiledBatchSize > 0);
+
+  // The batch size of the program is used by default
+  qaic::openrt::shBatcher batcher =
+      qaic::openrt::Batcher::Factory(context, program);
+  ASSERT_TRUE(batcher != nullptr);
+  ASSERT_TRUE(batcher->getBatchSize() ==
+              static_cast<uint32_t>(compiledBatchSize));
+  batcher->stop();
+
+  // A batch size other than the program's is rejected
+  qaic::openrt::BatcherProperties properties;
+  properties.batchSize = static_cast<uint32_t>(compiledBatchSize) * 2;
+  ASSERT_THROW(qaic::openrt::Batcher::Factory(context, program, properties),
+               qaic::openrt::CoreExceptionInit);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtBatcherUnitTest, BatcherFullBatchTest) {
+  BatcherFullBatchTest();
+}
+
+TEST_F(QAicOpenRtBatcherUnitTest, BatcherDeadlineTest) {
+  BatcherDeadlineTest();
+}
+
+TEST_F(QAicOpenRtBatcherUnitTest, BatcherPartialBufferTest) {
+  BatcherPartialBufferTest();
+}
+
+TEST_F(QAicOpenRtBatcherUnitTest, AdversarialBatcherInvalidInputTest) {
+  BatcherInvalidInputTest();
+}
+
+TEST_F(QAicOpenRtBatcherUnitTest, BatcherRequestDeadlineTest) {
+  BatcherRequestDeadlineTest();
+}
+
+TEST_F(QAicOpenRtBatcherUnitTest, BatcherCancelTest) { BatcherCancelTest(); }
+
+TEST_F(QAicOpenRtBatcherUnitTest, AdversarialBatcherProgramBatchSizeTest) {
+  BatcherProgramBatchSizeTest(
+      "/opt/qti-aic/test-data/aic100/v2/4nsp/4nsp-quant-resnet50");
+}
+
+} // namespace QAicOpenRtUnitTest
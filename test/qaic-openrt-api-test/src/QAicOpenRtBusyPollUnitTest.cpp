@@ -0,0 +1,294 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QCompletionPoller.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::QCompletionPoller;
+using std::chrono::microseconds;
+
+class QAicOpenRtBusyPollUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtBusyPollUnitTest(){};
+  ~QAicOpenRtBusyPollUnitTest() = default;
+
+  QAicOpenRtBusyPollUnitTest(const QAicOpenRtBusyPollUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtBusyPollUnitTest &
+  operator=(const QAicOpenRtBusyPollUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void SpinHitTest();
+  void BudgetExhaustedTest();
+  void NoSpinTest();
+  void SilentProbeTest();
+  void BlockingErrorTest();
+  void EdgeProbeTest();
+  void LatencyTest();
+
+  // Simulated inference, a device thread completes it after a delay. The
+  // probe reads the completion status, the blocking wait sleeps on a
+  // condition variable as the kernel wait would.
+  class SimulatedCompletion {
+  public:
+    explicit SimulatedCompletion(microseconds delay) {
+      device_ = std::thread([this, delay]() {
+        auto end = std::chrono::steady_clock::now() + delay;
+        while (std::chrono::steady_clock::now() < end) {
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          done_ = true;
+        }
+        cv_.notify_one();
+      });
+    }
+    ~SimulatedCompletion() { device_.join(); }
+
+    bool probe() { return done_.load(std::memory_order_acquire); }
+    QStatus block() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return done_.load(); });
+      return QS_SUCCESS;
+    }
+
+  private:
+    std::atomic_bool done_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread device_;
+  };
+
+  static QStatus waitFor(QCompletionPoller &poller, microseconds budget,
+                         SimulatedCompletion &completion) {
+    return poller.wait(
+        budget, [&completion]() { return completion.probe(); },
+        [&completion]() { return completion.block(); });
+  }
+};
+
+void QAicOpenRtBusyPollUnitTest::SpinHitTest() {
+  QCompletionPoller poller(true);
+  uint32_t probes = 0;
+  uint32_t blocks = 0;
+  // Completes on the fifth probe
+  ASSERT_TRUE(poller.wait(
+                  microseconds(1000000), [&probes]() { return ++probes == 5; },
+                  [&blocks]() {
+                    blocks++;
+                    return QS_SUCCESS;
+                  }) == QS_SUCCESS);
+  // The blocking wait still reaps the completion
+  ASSERT_TRUE(probes == 5);
+  ASSERT_TRUE(blocks == 1);
+  ASSERT_TRUE(poller.getNumWaits() == 1);
+  ASSERT_TRUE(poller.getNumSpinHits() == 1);
+  ASSERT_TRUE(poller.getNumBlockingWaits() == 0);
+}
+
+void QAicOpenRtBusyPollUnitTest::BudgetExhaustedTest() {
+  QCompletionPoller poller(true);
+  uint32_t probes = 0;
+  uint32_t blocks = 0;
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(poller.wait(
+                  microseconds(200),
+                  [&probes]() {
+                    probes++;
+                    return false;
+                  },
+                  [&blocks]() {
+                    blocks++;
+                    return QS_SUCCESS;
+                  }) == QS_SUCCESS);
+  ASSERT_TRUE(std::chrono::steady_clock::now() - start >= microseconds(200));
+  ASSERT_TRUE(probes > 1);
+  ASSERT_TRUE(blocks == 1);
+  ASSERT_TRUE(poller.getNumSpinHits() == 0);
+  ASSERT_TRUE(poller.getNumBlockingWaits() == 1);
+}
+
+void QAicOpenRtBusyPollUnitTest::NoSpinTest() {
+  uint32_t probes = 0;
+  auto probe = [&probes]() {
+    probes++;
+    return true;
+  };
+  auto block = []() { return QS_SUCCESS; };
+
+  QCompletionPoller poller(true);
+  ASSERT_TRUE(poller.wait(microseconds(0), probe, block) == QS_SUCCESS);
+  ASSERT_TRUE(probes == 0);
+  ASSERT_TRUE(poller.getNumBlockingWaits() == 1);
+
+  // Single CPU
+  QCompletionPoller noSpin(false);
+  ASSERT_TRUE(noSpin.wait(microseconds(100), probe, block) == QS_SUCCESS);
+  ASSERT_TRUE(probes == 0);
+  ASSERT_TRUE(noSpin.getNumBlockingWaits() == 1);
+}
+
+void QAicOpenRtBusyPollUnitTest::SilentProbeTest() {
+  QCompletionPoller poller(true);
+  uint64_t probes = 0;
+  auto silentProbe = [&probes]() {
+    probes++;
+    return false;
+  };
+  auto block = []() { return QS_SUCCESS; };
+
+  for (uint64_t i = 0; i < QCompletionPoller::probeWarmupWaits; i++) {
+    ASSERT_TRUE(poller.wait(microseconds(10), silentProbe, block) ==
+                QS_SUCCESS);
+  }
+  ASSERT_TRUE(probes >= QCompletionPoller::probeWarmupWaits);
+
+  // A source that never signals stops costing the spin budget
+  uint64_t warmupProbes = probes;
+  for (uint32_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(poller.wait(microseconds(10), silentProbe, block) ==
+                QS_SUCCESS);
+  }
+  ASSERT_TRUE(probes == warmupProbes);
+  ASSERT_TRUE(poller.getNumBlockingWaits() == poller.getNumWaits());
+}
+
+void QAicOpenRtBusyPollUnitTest::BlockingErrorTest() {
+  QCompletionPoller poller(true);
+  auto failedWait = []() { return QS_ERROR; };
+  ASSERT_TRUE(poller.wait(
+                  microseconds(100), []() { return true; }, failedWait) ==
+              QS_ERROR);
+  ASSERT_TRUE(poller.wait(
+                  microseconds(100), []() { return false; }, failedWait) ==
+              QS_ERROR);
+}
+
+// The network driver probes the VC eventfd through an edge triggered epoll,
+// the counter stays for the completion reactor draining it
+void QAicOpenRtBusyPollUnitTest::EdgeProbeTest() {
+  int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  ASSERT_TRUE(efd >= 0);
+  int probeFd = epoll_create1(EPOLL_CLOEXEC);
+  ASSERT_TRUE(probeFd >= 0);
+  struct epoll_event event = {};
+  event.events = EPOLLIN | EPOLLET;
+  ASSERT_TRUE(epoll_ctl(probeFd, EPOLL_CTL_ADD, efd, &event) == 0);
+  auto probe = [probeFd]() {
+    struct epoll_event ready;
+    return (epoll_wait(probeFd, &ready, 1, 0) > 0);
+  };
+  auto signal = [efd]() {
+    uint64_t one = 1;
+    return (write(efd, &one, sizeof(one)) == sizeof(one));
+  };
+
+  ASSERT_FALSE(probe());
+  ASSERT_TRUE(signal());
+  ASSERT_TRUE(probe());
+  // Each signal is reported once
+  ASSERT_FALSE(probe());
+  // Also while the counter was not drained
+  ASSERT_TRUE(signal());
+  ASSERT_TRUE(probe());
+  ASSERT_FALSE(probe());
+
+  // Nothing was consumed
+  uint64_t count = 0;
+  ASSERT_TRUE(read(efd, &count, sizeof(count)) == sizeof(count));
+  ASSERT_TRUE(count == 2);
+  ASSERT_FALSE(probe());
+
+  QCompletionPoller poller(true);
+  uint32_t blocked = 0;
+  auto block = [&blocked]() {
+    blocked++;
+    return QS_SUCCESS;
+  };
+  std::thread device([&signal]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    signal();
+  });
+  ASSERT_TRUE(poller.wait(std::chrono::seconds(5), probe, block) ==
+              QS_SUCCESS);
+  device.join();
+  ASSERT_TRUE(poller.getNumSpinHits() == 1);
+  ASSERT_TRUE(blocked == 1);
+
+  close(probeFd);
+  close(efd);
+}
+
+void QAicOpenRtBusyPollUnitTest::LatencyTest() {
+  if (std::thread::hardware_concurrency() < 2) {
+    GTEST_SKIP() << "busy polling needs a core of its own";
+  }
+  constexpr uint32_t numInferences = 200;
+  constexpr microseconds inferenceTime(30);
+
+  // Time from the device completing to the waiter returning
+  auto measure = [&](microseconds budget) {
+    QCompletionPoller poller;
+    std::vector<int64_t> latencies;
+    for (uint32_t i = 0; i < numInferences; i++) {
+      auto start = std::chrono::steady_clock::now();
+      SimulatedCompletion completion(inferenceTime);
+      EXPECT_TRUE(waitFor(poller, budget, completion) == QS_SUCCESS);
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      latencies.push_back(
+          std::chrono::duration_cast<microseconds>(elapsed - inferenceTime)
+              .count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return std::make_pair(latencies[numInferences / 2],
+                          latencies[numInferences * 99 / 100]);
+  };
+
+  auto blocking = measure(microseconds(0));
+  auto polling = measure(microseconds(1000));
+  LogInfo("{}: {} inferences of {} us, blocking p50 {} us p99 {} us, busy "
+          "poll p50 {} us p99 {} us",
+          testName(), numInferences, inferenceTime.count(), blocking.first,
+          blocking.second, polling.first, polling.second);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtBusyPollUnitTest, SpinHitTest) { SpinHitTest(); }
+
+TEST_F(QAicOpenRtBusyPollUnitTest, BudgetExhaustedTest) {
+  BudgetExhaustedTest();
+}
+
+TEST_F(QAicOpenRtBusyPollUnitTest, NoSpinTest) { NoSpinTest(); }
+
+TEST_F(QAicOpenRtBusyPollUnitTest, AdversarialSilentProbeTest) {
+  SilentProbeTest();
+}
+
+TEST_F(QAicOpenRtBusyPollUnitTest, AdversarialBlockingErrorTest) {
+  BlockingErrorTest();
+}
+
+TEST_F(QAicOpenRtBusyPollUnitTest, EdgeProbeTest) { EdgeProbeTest(); }
+
+TEST_F(QAicOpenRtBusyPollUnitTest, LatencyTest) { LatencyTest(); }
+
+} // namespace QAicOpenRtUnitTest
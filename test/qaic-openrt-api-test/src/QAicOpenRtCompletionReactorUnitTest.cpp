@@ -0,0 +1,600 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QCompletionReactor.h"
+#include "QCompletionReaper.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::QCompletionEvent;
+using qaic::QCompletionReactor;
+using qaic::QCompletionReaper;
+using qaic::QCompletionSourceID;
+
+class QAicOpenRtCompletionReactorUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtCompletionReactorUnitTest(){};
+  ~QAicOpenRtCompletionReactorUnitTest() = default;
+
+  QAicOpenRtCompletionReactorUnitTest(
+      const QAicOpenRtCompletionReactorUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtCompletionReactorUnitTest &
+  operator=(const QAicOpenRtCompletionReactorUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void ManySourcesTest();
+  void SlowSourceTest();
+  void SharedVCTest();
+  void ReaperCreditTest();
+  void TimeoutTest();
+  void RemoveRunningSourceTest();
+  void RemoveFromHandlerTest();
+  void InvalidSourceTest();
+
+  // Simulated completion queue of a device, the device thread posts
+  // completions and signals the eventfd as the KMD would
+  struct SimulatedQueue {
+    int fd = -1;
+    std::atomic<uint64_t> posted{0};
+    std::atomic<uint64_t> reaped{0};
+    std::atomic<uint32_t> inHandler{0};
+    std::atomic_bool overlapped{false};
+
+    SimulatedQueue() { fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC); }
+    ~SimulatedQueue() {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+    void post() {
+      posted++;
+      uint64_t one = 1;
+      [[maybe_unused]] ssize_t rc = write(fd, &one, sizeof(one));
+    }
+    // Handler, drains the eventfd then reaps everything posted so far
+    void reap() {
+      if (inHandler++ != 0) {
+        overlapped = true;
+      }
+      uint64_t count;
+      [[maybe_unused]] ssize_t rc = read(fd, &count, sizeof(count));
+      reaped = posted.load();
+      inHandler--;
+    }
+  };
+
+  // Simulated VC with async waits reaped as the network driver does. The
+  // device completes inferences in order and signals each one, the kernel
+  // wait of a running inference blocks for a ms, or until it completes when
+  // nothing signals the VC. The reactor handler only credits, the waits are
+  // reaped by a completion thread of the VC.
+  struct SimulatedVC {
+    struct Wait {
+      uint64_t seq = 0;
+    };
+    int fd = -1;
+    bool polled = false;
+    uint64_t numSubmitted = 0;
+    std::atomic<uint64_t> numCompleted{0};
+    std::vector<std::chrono::steady_clock::time_point> completedAt;
+    std::atomic<uint64_t> numReaped{0};
+    std::atomic<int64_t> maxLatencyUs{0};
+    std::atomic_bool checkedOffThread{false};
+    QCompletionReaper<Wait> reaper;
+    std::thread thread;
+
+    explicit SimulatedVC(size_t maxInferences, bool polled = false)
+        : polled(polled), completedAt(maxInferences) {
+      fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      reaper.start(polled);
+      thread = std::thread([this]() {
+        while (reaper.waitReady()) {
+          reap();
+        }
+      });
+    }
+    ~SimulatedVC() {
+      reaper.stop();
+      thread.join();
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+    void submit() { reaper.push({numSubmitted++}, []() {}); }
+    void complete() {
+      completedAt[numCompleted] = std::chrono::steady_clock::now();
+      numCompleted++;
+      uint64_t one = 1;
+      [[maybe_unused]] ssize_t rc = write(fd, &one, sizeof(one));
+    }
+    void handle(QCompletionEvent event) {
+      uint64_t count = 0;
+      if (event == QCompletionEvent::Timeout) {
+        reaper.signal(1);
+      } else if (read(fd, &count, sizeof(count)) == sizeof(count)) {
+        reaper.signal(count);
+      }
+    }
+    void reap() {
+      reaper.reap(
+          [this](const Wait &wait) {
+            if (std::this_thread::get_id() != thread.get_id()) {
+              checkedOffThread = true;
+            }
+            auto end = std::chrono::steady_clock::now() +
+                       std::chrono::milliseconds(polled ? 100 : 1);
+            while (std::chrono::steady_clock::now() < end) {
+              if (wait.seq < numCompleted) {
+                return QS_SUCCESS;
+              }
+              std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            return QS_TIMEDOUT;
+          },
+          [this](Wait wait, QStatus) {
+            auto latency =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - completedAt[wait.seq])
+                    .count();
+            int64_t max = maxLatencyUs;
+            while ((latency > max) &&
+                   !maxLatencyUs.compare_exchange_weak(max, latency)) {
+            }
+            numReaped++;
+          },
+          []() {});
+    }
+  };
+
+  static bool waitFor(const std::function<bool()> &cond,
+                      std::chrono::milliseconds limit) {
+    auto end = std::chrono::steady_clock::now() + limit;
+    while (!cond()) {
+      if (std::chrono::steady_clock::now() > end) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+  }
+};
+
+void QAicOpenRtCompletionReactorUnitTest::ManySourcesTest() {
+  constexpr size_t numQueues = 32;
+  constexpr uint64_t completionsPerQueue = 2000;
+
+  QCompletionReactor reactor(4);
+  ASSERT_TRUE(reactor.init() == QS_SUCCESS);
+
+  std::vector<std::unique_ptr<SimulatedQueue>> queues;
+  std::vector<QCompletionSourceID> ids(numQueues);
+  for (size_t i = 0; i < numQueues; i++) {
+    queues.push_back(std::make_unique<SimulatedQueue>());
+    SimulatedQueue *queue = queues.back().get();
+    ASSERT_TRUE(queue->fd >= 0);
+    ASSERT_TRUE(reactor.addSource(
+                    queue->fd, 0,
+                    [queue](QCompletionEvent event) {
+                      if (event == QCompletionEvent::Ready) {
+                        queue->reap();
+                      }
+                    },
+                    ids[i]) == QS_SUCCESS);
+  }
+  ASSERT_TRUE(reactor.getNumSources() == numQueues);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> devices;
+  for (size_t d = 0; d < 4; d++) {
+    devices.emplace_back([&queues, d]() {
+      for (uint64_t c = 0; c < completionsPerQueue; c++) {
+        for (size_t i = d; i < numQueues; i += 4) {
+          queues[i]->post();
+        }
+      }
+    });
+  }
+  for (auto &device : devices) {
+    device.join();
+  }
+
+  // The last signal of each queue is delivered, so everything gets reaped
+  ASSERT_TRUE(waitFor(
+      [&queues]() {
+        for (auto &queue : queues) {
+          if (queue->reaped != completionsPerQueue) {
+            return false;
+          }
+        }
+        return true;
+      },
+      std::chrono::seconds(10)));
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  LogInfo("{}: {} completions on {} queues reaped by {} threads in {} us",
+          testName(), completionsPerQueue * numQueues, numQueues,
+          reactor.getNumThreads(), elapsed.count());
+
+  for (size_t i = 0; i < numQueues; i++) {
+    ASSERT_FALSE(queues[i]->overlapped);
+    ASSERT_TRUE(reactor.removeSource(ids[i]) == QS_SUCCESS);
+  }
+  ASSERT_TRUE(reactor.getNumSources() == 0);
+}
+
+void QAicOpenRtCompletionReactorUnitTest::SlowSourceTest() {
+  constexpr size_t numVCs = 16;
+  constexpr uint64_t inferencesPerVC = 200;
+
+  // A single thread, any blocking of the slow VC delays all others
+  QCompletionReactor reactor(1);
+  ASSERT_TRUE(reactor.init() == QS_SUCCESS);
+
+  std::vector<std::unique_ptr<SimulatedVC>> vcs;
+  std::vector<QCompletionSourceID> ids(numVCs);
+  for (size_t i = 0; i < numVCs; i++) {
+    vcs.push_back(std::make_unique<SimulatedVC>(inferencesPerVC));
+    SimulatedVC *vc = vcs.back().get();
+    ASSERT_TRUE(vc->fd >= 0);
+    ASSERT_TRUE(reactor.addSource(
+                    vc->fd, 0,
+                    [vc](QCompletionEvent event) { vc->handle(event); },
+                    ids[i]) == QS_SUCCESS);
+  }
+
+  // The slow VC has an inference in flight for the whole test, its timer
+  // only catches inferences that never complete
+  SimulatedVC &slow = *vcs[0];
+  slow.submit();
+  ASSERT_TRUE(reactor.setSourceTimeout(ids[0], 1000) == QS_SUCCESS);
+
+  std::thread device([&vcs]() {
+    for (uint64_t c = 0; c < inferencesPerVC; c++) {
+      for (size_t i = 1; i < numVCs; i++) {
+        vcs[i]->submit();
+      }
+      for (size_t i = 1; i < numVCs; i++) {
+        vcs[i]->complete();
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  });
+  device.join();
+
+  ASSERT_TRUE(waitFor(
+      [&vcs]() {
+        for (size_t i = 1; i < numVCs; i++) {
+          if (vcs[i]->numReaped != inferencesPerVC) {
+            return false;
+          }
+        }
+        return true;
+      },
+      std::chrono::seconds(10)));
+
+  // The running inference of the slow VC was never waited for
+  ASSERT_TRUE(slow.numReaped == 0);
+  ASSERT_TRUE(slow.reaper.getNumChecks() == 0);
+  int64_t maxLatencyUs = 0;
+  for (size_t i = 1; i < numVCs; i++) {
+    ASSERT_TRUE(vcs[i]->reaper.getNumMissedChecks() == 0);
+    maxLatencyUs = std::max<int64_t>(maxLatencyUs, vcs[i]->maxLatencyUs);
+  }
+  LogInfo("{}: max completion latency of {} VCs next to a slow one {} us",
+          testName(), numVCs - 1, maxLatencyUs);
+
+  // Its completion is reaped as soon as it is signalled
+  slow.complete();
+  ASSERT_TRUE(waitFor([&slow]() { return slow.numReaped == 1; },
+                      std::chrono::seconds(5)));
+  ASSERT_TRUE(slow.reaper.getNumMissedChecks() == 0);
+
+  for (size_t i = 0; i < numVCs; i++) {
+    ASSERT_TRUE(reactor.removeSource(ids[i]) == QS_SUCCESS);
+  }
+}
+
+void QAicOpenRtCompletionReactorUnitTest::SharedVCTest() {
+  constexpr uint64_t numInferences = 200;
+
+  QCompletionReactor reactor(1);
+  ASSERT_TRUE(reactor.init() == QS_SUCCESS);
+
+  // The first network of a VC watches its eventfd, the second one is polled
+  // by its completion thread. Completions of both signal the eventfd.
+  SimulatedVC watching(1);
+  SimulatedVC polled(numInferences, true);
+  ASSERT_TRUE(watching.fd >= 0);
+  QCompletionSourceID id = 0;
+  ASSERT_TRUE(reactor.addSource(
+                  watching.fd, 0,
+                  [&watching](QCompletionEvent event) {
+                    watching.handle(event);
+                  },
+                  id) == QS_SUCCESS);
+
+  // The watching network has an inference in flight for the whole test
+  watching.submit();
+  std::thread device([&watching, &polled]() {
+    uint64_t one = 1;
+    for (uint64_t c = 0; c < numInferences; c++) {
+      polled.submit();
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      polled.complete();
+      [[maybe_unused]] ssize_t rc = write(watching.fd, &one, sizeof(one));
+    }
+  });
+  device.join();
+
+  // The polled network reaps without any signal
+  ASSERT_TRUE(
+      waitFor([&polled]() { return polled.numReaped == numInferences; },
+              std::chrono::seconds(10)));
+  LogInfo("{}: max completion latency of a polled network {} us", testName(),
+          polled.maxLatencyUs.load());
+
+  // The foreign credits only cost the completion thread of the watching
+  // network a check, no kernel wait ran on the reactor thread
+  ASSERT_TRUE(watching.numReaped == 0);
+  ASSERT_TRUE(watching.reaper.getNumMissedChecks() > 0);
+  ASSERT_FALSE(watching.checkedOffThread);
+  ASSERT_FALSE(polled.checkedOffThread);
+
+  watching.complete();
+  ASSERT_TRUE(waitFor([&watching]() { return watching.numReaped == 1; },
+                      std::chrono::seconds(5)));
+  ASSERT_TRUE(reactor.removeSource(id) == QS_SUCCESS);
+}
+
+void QAicOpenRtCompletionReactorUnitTest::ReaperCreditTest() {
+  QCompletionReaper<uint64_t> reaper;
+  uint64_t numCompleted = 0;
+  std::vector<uint64_t> reaped;
+  uint32_t armed = 0;
+  uint32_t disarmed = 0;
+  auto check = [&numCompleted](uint64_t seq) {
+    return (seq < numCompleted) ? QS_SUCCESS : QS_TIMEDOUT;
+  };
+  auto complete = [&reaped](uint64_t seq, QStatus status) {
+    ASSERT_TRUE(status == QS_SUCCESS);
+    reaped.push_back(seq);
+  };
+  auto reap = [&]() { reaper.reap(check, complete, [&]() { disarmed++; }); };
+
+  for (uint64_t seq = 0; seq < 4; seq++) {
+    reaper.push(seq, [&armed]() { armed++; });
+  }
+  ASSERT_TRUE(armed == 1);
+
+  // Nothing signalled, nothing is waited for
+  reap();
+  ASSERT_TRUE(reaper.getNumChecks() == 0);
+
+  // Only as many waits as signalled are reaped
+  numCompleted = 3;
+  reaper.signal(2);
+  reap();
+  ASSERT_TRUE((reaped == std::vector<uint64_t>{0, 1}));
+  ASSERT_TRUE(reaper.getNumMissedChecks() == 0);
+
+  // Credits of completions not queued here, the running head is checked once
+  // and the rest dropped
+  reaper.signal(1);
+  reap();
+  ASSERT_TRUE(reaped.size() == 3);
+  reaper.signal(100);
+  reap();
+  ASSERT_TRUE(reaper.getNumMissedChecks() == 1);
+  ASSERT_TRUE(reaped.size() == 3);
+  reap();
+  ASSERT_TRUE(reaper.getNumChecks() == 4);
+
+  numCompleted = 4;
+  reaper.signal(1);
+  reap();
+  ASSERT_TRUE(reaped.size() == 4);
+  ASSERT_TRUE(disarmed == 1);
+  ASSERT_TRUE(reaper.size() == 0);
+
+  // Credits never exceed the queued waits
+  reaper.signal(10);
+  reaper.push(4, [&armed]() { armed++; });
+  ASSERT_TRUE(armed == 2);
+  reap();
+  ASSERT_TRUE(reaper.getNumChecks() == 5);
+  ASSERT_TRUE(reaper.drain().size() == 1);
+
+  // Polled, queued waits are ready without a signal
+  reaper.start(true);
+  reaper.push(5, [&armed]() { armed++; });
+  ASSERT_TRUE(reaper.waitReady());
+  numCompleted = 6;
+  reap();
+  ASSERT_TRUE(reaped.size() == 5);
+
+  // Stopping wakes the completion thread for good and ends reaping
+  reaper.push(6, [&armed]() { armed++; });
+  reaper.stop();
+  ASSERT_FALSE(reaper.waitReady());
+  numCompleted = 7;
+  reap();
+  ASSERT_TRUE(reaped.size() == 5);
+  ASSERT_TRUE(reaper.drain().size() == 1);
+}
+
+void QAicOpenRtCompletionReactorUnitTest::TimeoutTest() {
+  QCompletionReactor reactor(1);
+  ASSERT_TRUE(reactor.init() == QS_SUCCESS);
+
+  SimulatedQueue queue;
+  std::atomic<uint32_t> timeouts{0};
+  QCompletionSourceID id = 0;
+  ASSERT_TRUE(reactor.addSource(
+                  queue.fd, 0,
+                  [&](QCompletionEvent event) {
+                    if (event == QCompletionEvent::Timeout) {
+                      timeouts++;
+                    } else {
+                      queue.reap();
+                    }
+                  },
+                  id) == QS_SUCCESS);
+
+  // No timeout set, nothing fires
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_TRUE(timeouts == 0);
+
+  // Polling while completions are outstanding
+  ASSERT_TRUE(reactor.setSourceTimeout(id, 1) == QS_SUCCESS);
+  ASSERT_TRUE(waitFor([&timeouts]() { return timeouts >= 5; },
+                      std::chrono::seconds(5)));
+
+  // A signal is still delivered as ready
+  queue.post();
+  ASSERT_TRUE(waitFor([&queue]() { return queue.reaped == 1; },
+                      std::chrono::seconds(5)));
+
+  ASSERT_TRUE(reactor.setSourceTimeout(id, 0) == QS_SUCCESS);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  uint32_t stopped = timeouts;
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_TRUE(timeouts == stopped);
+
+  ASSERT_TRUE(reactor.removeSource(id) == QS_SUCCESS);
+}
+
+void QAicOpenRtCompletionReactorUnitTest::RemoveRunningSourceTest() {
+  QCompletionReactor reactor(2);
+  ASSERT_TRUE(reactor.init() == QS_SUCCESS);
+
+  SimulatedQueue queue;
+  std::atomic_bool entered{false};
+  std::atomic_bool returned{false};
+  QCompletionSourceID id = 0;
+  ASSERT_TRUE(reactor.addSource(
+                  queue.fd, 0,
+                  [&](QCompletionEvent) {
+                    entered = true;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    returned = true;
+                  },
+                  id) == QS_SUCCESS);
+
+  queue.post();
+  ASSERT_TRUE(waitFor([&entered]() { return entered.load(); },
+                      std::chrono::seconds(5)));
+  // The owner may free what the handler uses once this returns
+  ASSERT_TRUE(reactor.removeSource(id) == QS_SUCCESS);
+  ASSERT_TRUE(returned);
+
+  // Signals of a removed source are ignored
+  entered = false;
+  queue.post();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(entered);
+}
+
+void QAicOpenRtCompletionReactorUnitTest::RemoveFromHandlerTest() {
+  QCompletionReactor reactor(1);
+  ASSERT_TRUE(reactor.init() == QS_SUCCESS);
+
+  SimulatedQueue queue;
+  std::atomic<uint32_t> calls{0};
+  QCompletionSourceID id = 0;
+  std::atomic<QStatus> removeStatus{QS_ERROR};
+  ASSERT_TRUE(reactor.addSource(
+                  queue.fd, 1,
+                  [&](QCompletionEvent) {
+                    if (calls++ == 0) {
+                      removeStatus = reactor.removeSource(id);
+                    }
+                  },
+                  id) == QS_SUCCESS);
+
+  ASSERT_TRUE(waitFor([&calls]() { return calls >= 1; },
+                      std::chrono::seconds(5)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_TRUE(calls == 1);
+  ASSERT_TRUE(removeStatus == QS_SUCCESS);
+  ASSERT_TRUE(reactor.getNumSources() == 0);
+}
+
+void QAicOpenRtCompletionReactorUnitTest::InvalidSourceTest() {
+  QCompletionReactor reactor(1);
+  QCompletionSourceID id = 0;
+  auto handler = [](QCompletionEvent) {};
+
+  // Not initialized
+  SimulatedQueue queue;
+  ASSERT_TRUE(reactor.addSource(queue.fd, 0, handler, id) == QS_ERROR);
+
+  ASSERT_TRUE(reactor.init() == QS_SUCCESS);
+  ASSERT_TRUE(reactor.init() == QS_INVAL);
+  ASSERT_TRUE(reactor.addSource(-1, 0, handler, id) == QS_INVAL);
+  ASSERT_TRUE(reactor.addSource(queue.fd, 0, nullptr, id) == QS_INVAL);
+
+  // Not a descriptor epoll can watch
+  int closedFd = eventfd(0, 0);
+  close(closedFd);
+  ASSERT_TRUE(reactor.addSource(closedFd, 0, handler, id) == QS_ERROR);
+
+  ASSERT_TRUE(reactor.removeSource(12345) == QS_INVAL);
+  ASSERT_TRUE(reactor.setSourceTimeout(12345, 1) == QS_INVAL);
+
+  // The same descriptor can only be watched once
+  ASSERT_TRUE(reactor.addSource(queue.fd, 0, handler, id) == QS_SUCCESS);
+  QCompletionSourceID other = 0;
+  ASSERT_TRUE(reactor.addSource(queue.fd, 0, handler, other) == QS_ERROR);
+  ASSERT_TRUE(reactor.removeSource(id) == QS_SUCCESS);
+  ASSERT_TRUE(reactor.removeSource(id) == QS_INVAL);
+
+  QCompletionReactor noThreads(0);
+  ASSERT_TRUE(noThreads.init() == QS_INVAL);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtCompletionReactorUnitTest, ManySourcesTest) {
+  ManySourcesTest();
+}
+
+TEST_F(QAicOpenRtCompletionReactorUnitTest, SlowSourceTest) {
+  SlowSourceTest();
+}
+
+TEST_F(QAicOpenRtCompletionReactorUnitTest, SharedVCTest) { SharedVCTest(); }
+
+TEST_F(QAicOpenRtCompletionReactorUnitTest, ReaperCreditTest) {
+  ReaperCreditTest();
+}
+
+TEST_F(QAicOpenRtCompletionReactorUnitTest, TimeoutTest) { TimeoutTest(); }
+
+TEST_F(QAicOpenRtCompletionReactorUnitTest, RemoveRunningSourceTest) {
+  RemoveRunningSourceTest();
+}
+
+TEST_F(QAicOpenRtCompletionReactorUnitTest, RemoveFromHandlerTest) {
+  RemoveFromHandlerTest();
+}
+
+TEST_F(QAicOpenRtCompletionReactorUnitTest, AdversarialInvalidSourceTest) {
+  InvalidSourceTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,315 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QContentCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::QContentCache;
+using qaic::QContentHasher;
+using qaic::QContentKey;
+using std::chrono::milliseconds;
+
+class QAicOpenRtConstantsDedupUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtConstantsDedupUnitTest(){};
+  ~QAicOpenRtConstantsDedupUnitTest() = default;
+
+  QAicOpenRtConstantsDedupUnitTest(const QAicOpenRtConstantsDedupUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtConstantsDedupUnitTest &
+  operator=(const QAicOpenRtConstantsDedupUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void SharedVariantsTest();
+  void RefCountTest();
+  void ConcurrentLoadTest();
+  void FailedLoadTest();
+  void KeyTest();
+
+  // Device DDR holding the uploaded constants
+  struct SimulatedDevice {
+    std::atomic<uint32_t> numUploads{0};
+    std::atomic<uint64_t> residentBytes{0};
+  };
+
+  // Constants loaded on a simulated device, unloaded with the last user
+  struct SimulatedConstants {
+    SimulatedConstants(SimulatedDevice &device, uint64_t size)
+        : device_(device), size_(size) {
+      device_.numUploads++;
+      device_.residentBytes += size_;
+    }
+    ~SimulatedConstants() { device_.residentBytes -= size_; }
+    SimulatedDevice &device_;
+    uint64_t size_;
+  };
+  using Cache = QContentCache<SimulatedConstants>;
+
+  // Synthetic QPC constants, a descriptor and static and dynamic segments
+  struct Segments {
+    std::vector<uint8_t> descriptor;
+    std::vector<uint8_t> staticConstants;
+    std::vector<uint8_t> dynamicConstants;
+  };
+
+  static Segments makeSegments(uint8_t seed, size_t size) {
+    Segments segments;
+    segments.descriptor.assign(64, seed);
+    segments.staticConstants.resize(size);
+    segments.dynamicConstants.resize(size / 4);
+    for (size_t i = 0; i < size; i++) {
+      segments.staticConstants[i] = static_cast<uint8_t>(i * 31 + seed);
+    }
+    for (size_t i = 0; i < size / 4; i++) {
+      segments.dynamicConstants[i] = static_cast<uint8_t>(i * 7 + seed);
+    }
+    return segments;
+  }
+
+  // Same order as QProgramContainer::getContentDigest()
+  static QContentKey makeKey(QID qid, const Segments &segments) {
+    QContentHasher hasher;
+    hasher.add(segments.descriptor.data(), segments.descriptor.size());
+    hasher.add(segments.staticConstants.data(),
+               segments.staticConstants.size());
+    hasher.add(segments.dynamicConstants.data(),
+               segments.dynamicConstants.size());
+    QContentKey key;
+    key.qid = qid;
+    key.digest = hasher.getDigest();
+    key.size = hasher.getSize();
+    return key;
+  }
+
+  static std::string toHex(const qaic::QContentDigest &digest) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (uint8_t byte : digest) {
+      hex += digits[byte >> 4];
+      hex += digits[byte & 0xf];
+    }
+    return hex;
+  }
+
+  static std::shared_ptr<SimulatedConstants>
+  load(Cache &cache, SimulatedDevice &device, const QContentKey &key,
+       bool &reused) {
+    return cache.get(
+        key,
+        [&]() {
+          return std::make_shared<SimulatedConstants>(device, key.size);
+        },
+        reused);
+  }
+};
+
+void QAicOpenRtConstantsDedupUnitTest::SharedVariantsTest() {
+  Cache cache;
+  SimulatedDevice device0;
+  SimulatedDevice device1;
+  // Batch size variants of one model have the same constants
+  const Segments model = makeSegments(1, 1 << 20);
+  const Segments other = makeSegments(2, 1 << 20);
+
+  std::vector<std::shared_ptr<SimulatedConstants>> variants;
+  bool reused = true;
+  for (int batch = 0; batch < 4; batch++) {
+    variants.push_back(load(cache, device0, makeKey(0, model), reused));
+    ASSERT_NE(variants.back(), nullptr);
+    ASSERT_EQ(reused, batch != 0);
+    ASSERT_EQ(variants.back(), variants.front());
+  }
+  ASSERT_EQ(device0.numUploads, 1u);
+  ASSERT_EQ(device0.residentBytes, makeKey(0, model).size);
+
+  // Other content, or the same content on another device, is not shared
+  auto otherModel = load(cache, device0, makeKey(0, other), reused);
+  ASSERT_FALSE(reused);
+  auto otherDevice = load(cache, device1, makeKey(1, model), reused);
+  ASSERT_FALSE(reused);
+  ASSERT_NE(otherModel, variants.front());
+  ASSERT_NE(otherDevice, variants.front());
+  ASSERT_EQ(device0.numUploads, 2u);
+  ASSERT_EQ(device1.numUploads, 1u);
+  ASSERT_EQ(cache.getNumEntries(), 3u);
+}
+
+void QAicOpenRtConstantsDedupUnitTest::RefCountTest() {
+  Cache cache;
+  SimulatedDevice device;
+  const QContentKey key = makeKey(0, makeSegments(3, 1 << 16));
+  bool reused = false;
+
+  auto first = load(cache, device, key, reused);
+  auto second = load(cache, device, key, reused);
+  ASSERT_TRUE(reused);
+
+  // The constants stay on the device while one program uses them
+  first.reset();
+  ASSERT_EQ(device.residentBytes, key.size);
+  ASSERT_EQ(cache.getNumEntries(), 1u);
+  auto third = load(cache, device, key, reused);
+  ASSERT_TRUE(reused);
+  ASSERT_EQ(device.numUploads, 1u);
+
+  // Unloaded with the last one, and uploaded again when needed
+  second.reset();
+  third.reset();
+  ASSERT_EQ(device.residentBytes, 0u);
+  ASSERT_EQ(cache.getNumEntries(), 0u);
+  auto fourth = load(cache, device, key, reused);
+  ASSERT_FALSE(reused);
+  ASSERT_EQ(device.numUploads, 2u);
+}
+
+void QAicOpenRtConstantsDedupUnitTest::ConcurrentLoadTest() {
+  Cache cache;
+  SimulatedDevice device;
+  const QContentKey key = makeKey(0, makeSegments(4, 1 << 16));
+
+  // Programs loaded at once wait for one upload
+  std::vector<std::shared_ptr<SimulatedConstants>> loaded(8);
+  std::atomic<uint32_t> numReused{0};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < loaded.size(); i++) {
+    threads.emplace_back([&, i]() {
+      bool reused = false;
+      loaded[i] = cache.get(
+          key,
+          [&]() {
+            std::this_thread::sleep_for(milliseconds(50));
+            return std::make_shared<SimulatedConstants>(device, key.size);
+          },
+          reused);
+      if (reused) {
+        numReused++;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(device.numUploads, 1u);
+  ASSERT_EQ(numReused, loaded.size() - 1);
+  for (auto &constants : loaded) {
+    ASSERT_EQ(constants, loaded.front());
+  }
+}
+
+void QAicOpenRtConstantsDedupUnitTest::FailedLoadTest() {
+  Cache cache;
+  SimulatedDevice device;
+  const QContentKey key = makeKey(0, makeSegments(5, 1 << 16));
+  bool reused = true;
+
+  // A failed load is not remembered
+  auto failed = cache.get(
+      key, []() { return std::shared_ptr<SimulatedConstants>(); }, reused);
+  ASSERT_EQ(failed, nullptr);
+  ASSERT_FALSE(reused);
+  ASSERT_EQ(cache.getNumEntries(), 0u);
+
+  // A program waiting on a load that fails loads for itself
+  std::shared_ptr<SimulatedConstants> waited;
+  std::thread loader([&]() {
+    bool loaderReused = false;
+    (void)cache.get(
+        key,
+        []() {
+          std::this_thread::sleep_for(milliseconds(50));
+          return std::shared_ptr<SimulatedConstants>();
+        },
+        loaderReused);
+  });
+  std::this_thread::sleep_for(milliseconds(10));
+  waited = load(cache, device, key, reused);
+  loader.join();
+  ASSERT_NE(waited, nullptr);
+  ASSERT_FALSE(reused);
+  ASSERT_EQ(device.numUploads, 1u);
+}
+
+void QAicOpenRtConstantsDedupUnitTest::KeyTest() {
+  const Segments model = makeSegments(6, 4096);
+  const QContentKey key = makeKey(0, model);
+  ASSERT_EQ(key.size, model.descriptor.size() + model.staticConstants.size() +
+                          model.dynamicConstants.size());
+  ASSERT_EQ(makeKey(0, model).digest, key.digest);
+
+  // One changed byte anywhere is other content
+  Segments changed = model;
+  changed.dynamicConstants.back() ^= 1;
+  ASSERT_NE(makeKey(0, changed).digest, key.digest);
+  changed = model;
+  changed.descriptor.front() ^= 1;
+  ASSERT_NE(makeKey(0, changed).digest, key.digest);
+
+  // So are the same bytes split into other segments
+  changed = model;
+  changed.descriptor.push_back(changed.staticConstants.front());
+  changed.staticConstants.erase(changed.staticConstants.begin());
+  ASSERT_EQ(makeKey(0, changed).size, key.size);
+  ASSERT_NE(makeKey(0, changed).digest, key.digest);
+
+  // Reference SHA-256 values
+  const std::string abc = "abc";
+  qaic::qutil::Sha256 sha;
+  ASSERT_EQ(toHex(sha.getDigest()), "e3b0c44298fc1c149afbf4c8996fb924"
+                                    "27ae41e4649b934ca495991b7852b855");
+  sha.update(abc.data(), abc.size());
+  ASSERT_EQ(toHex(sha.getDigest()), "ba7816bf8f01cfea414140de5dae2223"
+                                    "b00361a396177a9cb410ff61f20015ad");
+  // Fed in pieces that straddle the blocks
+  const std::string million(1000000, 'a');
+  qaic::qutil::Sha256 pieces;
+  for (size_t offset = 0; offset < million.size(); offset += 333) {
+    pieces.update(million.data() + offset,
+                  std::min<size_t>(333, million.size() - offset));
+  }
+  ASSERT_EQ(toHex(pieces.getDigest()), "cdc76e5c9914fb9281a1c7e284d73e67"
+                                       "f1809a48a497200e046d39ccc7112cd0");
+
+  // Equal digests of different sizes are not shared
+  Cache cache;
+  SimulatedDevice device;
+  QContentKey truncated = key;
+  truncated.size--;
+  bool reused = true;
+  auto a = load(cache, device, key, reused);
+  auto b = load(cache, device, truncated, reused);
+  ASSERT_FALSE(reused);
+  ASSERT_NE(a, b);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtConstantsDedupUnitTest, SharedVariantsTest) {
+  SharedVariantsTest();
+}
+
+TEST_F(QAicOpenRtConstantsDedupUnitTest, RefCountTest) { RefCountTest(); }
+
+TEST_F(QAicOpenRtConstantsDedupUnitTest, ConcurrentLoadTest) {
+  ConcurrentLoadTest();
+}
+
+TEST_F(QAicOpenRtConstantsDedupUnitTest, AdversarialFailedLoadTest) {
+  FailedLoadTest();
+}
+
+TEST_F(QAicOpenRtConstantsDedupUnitTest, AdversarialKeyTest) { KeyTest(); }
+
+} // namespace QAicOpenRtUnitTest
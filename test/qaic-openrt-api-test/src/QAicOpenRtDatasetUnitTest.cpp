@@ -0,0 +1,439 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicOpenRtDataset.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtDatasetUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtDatasetUnitTest(){};
+  ~QAicOpenRtDatasetUnitTest() = default;
+
+  QAicOpenRtDatasetUnitTest(const QAicOpenRtDatasetUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtDatasetUnitTest &
+  operator=(const QAicOpenRtDatasetUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  static constexpr uint32_t numSamples = 10;
+  static constexpr uint32_t numInputs = 2;
+  static constexpr uint32_t inputSize = 100;
+
+  void SetUp() override {
+    char dir[] = "/tmp/qaic-dataset-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    dir_ = dir;
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    std::filesystem::remove_all(dir_, ec);
+  }
+
+  void PackedDatasetTest();
+  void FileSetDatasetDirectoryTest();
+  void DatasetStreamerOrderTest();
+  void DatasetStreamerLoopTest();
+  void DatasetStreamerHeldSlotsTest();
+  void DatasetStreamerPartialInputTest();
+  void DatasetCorruptPackTest();
+  void DatasetInvalidParametersTest();
+
+  std::vector<uint8_t> sample(uint32_t index, uint32_t input, size_t size);
+  std::vector<std::vector<std::string>> writeFileSets(const std::string &dir);
+  BufferMappings simulatedMappings(bool partial);
+  void expectSample(const qaic::openrt::DatasetSlot &slot);
+
+  std::string dir_;
+};
+
+std::vector<uint8_t> QAicOpenRtDatasetUnitTest::sample(uint32_t index,
+                                                       uint32_t input,
+                                                       size_t size) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; i++) {
+    data.at(i) = static_cast<uint8_t>(index * 31 + input * 7 + i);
+  }
+  return data;
+}
+
+// Named so that sorting groups the inputs of a sample
+std::vector<std::vector<std::string>>
+QAicOpenRtDatasetUnitTest::writeFileSets(const std::string &dir) {
+  std::filesystem::create_directories(dir);
+  std::vector<std::vector<std::string>> fileSets;
+  for (uint32_t s = 0; s < numSamples; s++) {
+    std::vector<std::string> fileSet;
+    for (uint32_t in = 0; in < numInputs; in++) {
+      char name[32];
+      snprintf(name, sizeof(name), "/%04u-%u.raw", s, in);
+      std::string path = dir + name;
+      std::vector<uint8_t> data = sample(s, in, inputSize);
+      std::ofstream ofs(path, std::ios::binary);
+      ofs.write(reinterpret_cast<const char *>(data.data()), data.size());
+      fileSet.push_back(path);
+    }
+    fileSets.push_back(fileSet);
+  }
+  return fileSets;
+}
+
+BufferMappings QAicOpenRtDatasetUnitTest::simulatedMappings(bool partial) {
+  BufferMappings mappings;
+  for (uint32_t in = 0; in < numInputs; in++) {
+    mappings.emplace_back(("input" + std::to_string(in)).c_str(), in,
+                          QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT,
+                          inputSize, partial,
+                          QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  }
+  mappings.emplace_back("output", numInputs,
+                        QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT, inputSize,
+                        false, QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  return mappings;
+}
+
+void QAicOpenRtDatasetUnitTest::expectSample(
+    const qaic::openrt::DatasetSlot &slot) {
+  ASSERT_TRUE(slot.inferenceVector != nullptr);
+  const std::vector<QBuffer> &buffers = slot.inferenceVector->getVector();
+  ASSERT_TRUE(buffers.size() == numInputs + 1);
+  for (uint32_t in = 0; in < numInputs; in++) {
+    std::vector<uint8_t> expected =
+        sample(static_cast<uint32_t>(slot.sampleIndex), in, inputSize);
+    ASSERT_TRUE(buffers.at(in).size == inputSize);
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(),
+                           buffers.at(in).buf));
+  }
+}
+
+void QAicOpenRtDatasetUnitTest::PackedDatasetTest() {
+  const std::string pack = dir_ + "/dataset.qds";
+  ASSERT_TRUE(qaic::openrt::PackedDataset::write(
+                  pack, writeFileSets(dir_ + "/files")) == QS_SUCCESS);
+  auto dataset = qaic::openrt::PackedDataset::Factory(pack);
+  ASSERT_TRUE(dataset->getNumSamples() == numSamples);
+  ASSERT_TRUE(dataset->getNumInputs() == numInputs);
+
+  for (uint32_t s = 0; s < numSamples; s++) {
+    for (uint32_t in = 0; in < numInputs; in++) {
+      QData data;
+      ASSERT_TRUE(dataset->getInput(s, in, data) == QS_SUCCESS);
+      ASSERT_TRUE(data.size == inputSize);
+      // Inputs are aligned for vectorized copies
+      ASSERT_TRUE(reinterpret_cast<uintptr_t>(data.data) %
+                      qaic::openrt::PackedDataset::dataAlignment ==
+                  0);
+      std::vector<uint8_t> expected = sample(s, in, inputSize);
+      ASSERT_TRUE(std::equal(expected.begin(), expected.end(), data.data));
+
+      std::vector<uint8_t> copy(inputSize);
+      size_t size = 0;
+      ASSERT_TRUE(dataset->readInput(s, in, copy.data(), copy.size(), size) ==
+                  QS_SUCCESS);
+      ASSERT_TRUE(size == inputSize);
+      ASSERT_TRUE(copy == expected);
+      ASSERT_TRUE(dataset->readInput(s, in, copy.data(), inputSize - 1,
+                                     size) == QS_INVAL);
+    }
+  }
+  QData data;
+  ASSERT_TRUE(dataset->getInput(numSamples, 0, data) == QS_INVAL);
+  ASSERT_TRUE(dataset->getInput(0, numInputs, data) == QS_INVAL);
+}
+
+void QAicOpenRtDatasetUnitTest::FileSetDatasetDirectoryTest() {
+  std::vector<std::vector<std::string>> fileSets = writeFileSets(dir_);
+  auto dataset = qaic::openrt::FileSetDataset::Factory(dir_, numInputs);
+  ASSERT_TRUE(dataset->getNumSamples() == numSamples);
+  ASSERT_TRUE(dataset->getFileSets() == fileSets);
+
+  std::vector<uint8_t> copy(inputSize);
+  size_t size = 0;
+  ASSERT_TRUE(dataset->readInput(3, 1, copy.data(), copy.size(), size) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(size == inputSize);
+  ASSERT_TRUE(copy == sample(3, 1, inputSize));
+  ASSERT_TRUE(dataset->readInput(3, 1, copy.data(), inputSize - 1, size) ==
+              QS_INVAL);
+
+  // 20 files do not make whole samples of 3 inputs
+  ASSERT_THROW(qaic::openrt::FileSetDataset::Factory(dir_, 3),
+               qaic::openrt::CoreExceptionInit);
+}
+
+void QAicOpenRtDatasetUnitTest::DatasetStreamerOrderTest() {
+  const std::string pack = dir_ + "/dataset.qds";
+  ASSERT_TRUE(qaic::openrt::PackedDataset::write(
+                  pack, writeFileSets(dir_ + "/files")) == QS_SUCCESS);
+  qaic::openrt::DatasetStreamerProperties properties;
+  properties.numSlots = 3;
+  properties.numThreads = 2;
+  properties.loop = false;
+  for (qaic::openrt::shDatasetSource source :
+       {qaic::openrt::shDatasetSource(
+            qaic::openrt::PackedDataset::Factory(pack)),
+        qaic::openrt::shDatasetSource(
+            qaic::openrt::FileSetDataset::Factory(dir_ + "/files",
+                                                  numInputs))}) {
+    auto streamer = qaic::openrt::DatasetStreamer::Factory(
+        simulatedMappings(false), source, properties);
+    for (uint32_t s = 0; s < numSamples; s++) {
+      qaic::openrt::DatasetSlot slot;
+      ASSERT_TRUE(streamer->acquire(slot) == QS_SUCCESS);
+      ASSERT_TRUE(slot.sampleIndex == s);
+      expectSample(slot);
+      streamer->release(slot);
+    }
+    qaic::openrt::DatasetSlot slot;
+    ASSERT_TRUE(streamer->acquire(slot) == QS_BUSY);
+
+    uint64_t loaded = 0;
+    uint64_t stalls = 0;
+    streamer->getStats(loaded, stalls);
+    ASSERT_TRUE(loaded == numSamples);
+  }
+}
+
+void QAicOpenRtDatasetUnitTest::DatasetStreamerLoopTest() {
+  writeFileSets(dir_);
+  qaic::openrt::DatasetStreamerProperties properties;
+  properties.numSlots = 4;
+  properties.numThreads = 3;
+  auto streamer = qaic::openrt::DatasetStreamer::Factory(
+      simulatedMappings(false),
+      qaic::openrt::FileSetDataset::Factory(dir_, numInputs), properties);
+
+  // Two consumers in flight at once, as with two ExecObjs
+  qaic::openrt::DatasetSlot previous;
+  ASSERT_TRUE(streamer->acquire(previous) == QS_SUCCESS);
+  for (uint32_t i = 1; i < numSamples * 3; i++) {
+    qaic::openrt::DatasetSlot slot;
+    ASSERT_TRUE(streamer->acquire(slot) == QS_SUCCESS);
+    ASSERT_TRUE(slot.sampleIndex == i % numSamples);
+    ASSERT_TRUE(slot.slotIndex != previous.slotIndex);
+    expectSample(slot);
+    expectSample(previous);
+    streamer->release(previous);
+    previous = slot;
+  }
+  streamer->release(previous);
+  streamer->stop();
+  qaic::openrt::DatasetSlot slot;
+  ASSERT_TRUE(streamer->acquire(slot) == QS_BUSY);
+}
+
+void QAicOpenRtDatasetUnitTest::DatasetStreamerHeldSlotsTest() {
+  writeFileSets(dir_);
+  qaic::openrt::DatasetStreamerProperties properties;
+  properties.numSlots = 2;
+  properties.numThreads = 2;
+  auto streamer = qaic::openrt::DatasetStreamer::Factory(
+      simulatedMappings(false),
+      qaic::openrt::FileSetDataset::Factory(dir_, numInputs), properties);
+
+  qaic::openrt::DatasetSlot first;
+  qaic::openrt::DatasetSlot second;
+  ASSERT_TRUE(streamer->acquire(first) == QS_SUCCESS);
+  ASSERT_TRUE(streamer->acquire(second) == QS_SUCCESS);
+
+  // Slots in use are never refilled under the consumer
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  uint64_t loaded = 0;
+  uint64_t stalls = 0;
+  streamer->getStats(loaded, stalls);
+  ASSERT_TRUE(loaded == 2);
+  expectSample(first);
+  expectSample(second);
+
+  streamer->release(first);
+  // Releasing twice is harmless
+  streamer->release(first);
+  qaic::openrt::DatasetSlot third;
+  ASSERT_TRUE(streamer->acquire(third) == QS_SUCCESS);
+  ASSERT_TRUE(third.sampleIndex == 2);
+  ASSERT_TRUE(third.slotIndex == first.slotIndex);
+  expectSample(third);
+  expectSample(second);
+}
+
+void QAicOpenRtDatasetUnitTest::DatasetStreamerPartialInputTest() {
+  std::vector<std::vector<std::string>> fileSets = writeFileSets(dir_);
+  // Sample 1 is short on its first input
+  std::filesystem::resize_file(fileSets.at(1).at(0), inputSize / 2);
+
+  qaic::openrt::DatasetStreamerProperties properties;
+  properties.loop = false;
+  auto streamer = qaic::openrt::DatasetStreamer::Factory(
+      simulatedMappings(true),
+      qaic::openrt::FileSetDataset::Factory(fileSets), properties);
+  qaic::openrt::DatasetSlot slot;
+  ASSERT_TRUE(streamer->acquire(slot) == QS_SUCCESS);
+  ASSERT_TRUE(slot.inferenceVector->getVector().at(0).size == inputSize);
+  streamer->release(slot);
+  ASSERT_TRUE(streamer->acquire(slot) == QS_SUCCESS);
+  ASSERT_TRUE(slot.sampleIndex == 1);
+  ASSERT_TRUE(slot.inferenceVector->getVector().at(0).size == inputSize / 2);
+  streamer->release(slot);
+  // The slot is back to full size for the next sample
+  for (uint32_t s = 2; s < 2 + properties.numSlots; s++) {
+    ASSERT_TRUE(streamer->acquire(slot) == QS_SUCCESS);
+    expectSample(slot);
+    streamer->release(slot);
+  }
+
+  // Without partial buffers the short sample fails alone
+  streamer = qaic::openrt::DatasetStreamer::Factory(
+      simulatedMappings(false),
+      qaic::openrt::FileSetDataset::Factory(fileSets), properties);
+  ASSERT_TRUE(streamer->acquire(slot) == QS_SUCCESS);
+  streamer->release(slot);
+  ASSERT_TRUE(streamer->acquire(slot) == QS_ERROR);
+  ASSERT_TRUE(slot.sampleIndex == 1);
+  ASSERT_TRUE(slot.inferenceVector == nullptr);
+  ASSERT_TRUE(streamer->acquire(slot) == QS_SUCCESS);
+  ASSERT_TRUE(slot.sampleIndex == 2);
+  expectSample(slot);
+  streamer->release(slot);
+}
+
+void QAicOpenRtDatasetUnitTest::DatasetCorruptPackTest() {
+  const std::string pack = dir_ + "/dataset.qds";
+  ASSERT_TRUE(qaic::openrt::PackedDataset::write(
+                  pack, writeFileSets(dir_ + "/files")) == QS_SUCCESS);
+  std::vector<char> good;
+  {
+    std::ifstream ifs(pack, std::ios::binary);
+    good.assign(std::istreambuf_iterator<char>(ifs),
+                std::istreambuf_iterator<char>());
+  }
+  auto writeVariant = [&](const std::vector<char> &bytes) {
+    std::ofstream ofs(pack, std::ios::binary | std::ios::trunc);
+    ofs.write(bytes.data(), bytes.size());
+  };
+  using Header = qaic::openrt::PackedDataset::Header;
+  using IndexEntry = qaic::openrt::PackedDataset::IndexEntry;
+
+  // Wrong magic
+  std::vector<char> bytes = good;
+  bytes.at(0) ^= 1;
+  writeVariant(bytes);
+  ASSERT_THROW(qaic::openrt::PackedDataset::Factory(pack),
+               qaic::openrt::CoreExceptionInit);
+
+  // Index larger than the file
+  bytes = good;
+  Header header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  header.numSamples = UINT64_MAX / 2;
+  std::memcpy(bytes.data(), &header, sizeof(header));
+  writeVariant(bytes);
+  ASSERT_THROW(qaic::openrt::PackedDataset::Factory(pack),
+               qaic::openrt::CoreExceptionInit);
+
+  // Entry past the end of the file
+  bytes = good;
+  IndexEntry entry;
+  const size_t lastEntry =
+      sizeof(Header) + (numSamples * numInputs - 1) * sizeof(IndexEntry);
+  std::memcpy(&entry, bytes.data() + lastEntry, sizeof(entry));
+  entry.size = UINT64_MAX - entry.offset + 1;
+  std::memcpy(bytes.data() + lastEntry, &entry, sizeof(entry));
+  writeVariant(bytes);
+  ASSERT_THROW(qaic::openrt::PackedDataset::Factory(pack),
+               qaic::openrt::CoreExceptionInit);
+
+  // Truncated data
+  bytes = good;
+  bytes.resize(bytes.size() - 1);
+  writeVariant(bytes);
+  ASSERT_THROW(qaic::openrt::PackedDataset::Factory(pack),
+               qaic::openrt::CoreExceptionInit);
+
+  // Shorter than a header
+  bytes.resize(sizeof(Header) - 1);
+  writeVariant(bytes);
+  ASSERT_THROW(qaic::openrt::PackedDataset::Factory(pack),
+               qaic::openrt::CoreExceptionInit);
+
+  ASSERT_THROW(qaic::openrt::PackedDataset::Factory(dir_ + "/missing"),
+               qaic::openrt::CoreExceptionInit);
+}
+
+void QAicOpenRtDatasetUnitTest::DatasetInvalidParametersTest() {
+  std::vector<std::vector<std::string>> fileSets = writeFileSets(dir_);
+  ASSERT_TRUE(qaic::openrt::PackedDataset::write(dir_ + "/x.qds", {}) ==
+              QS_INVAL);
+  ASSERT_TRUE(qaic::openrt::PackedDataset::write(
+                  dir_ + "/x.qds", {{fileSets.at(0).at(0)}, fileSets.at(1)}) ==
+              QS_INVAL);
+  ASSERT_TRUE(qaic::openrt::PackedDataset::write(
+                  dir_ + "/x.qds", {{dir_ + "/missing"}}) == QS_ERROR);
+
+  ASSERT_THROW(qaic::openrt::FileSetDataset::Factory(
+                   std::vector<std::vector<std::string>>{}),
+               qaic::openrt::CoreExceptionInit);
+  ASSERT_THROW(qaic::openrt::FileSetDataset::Factory(
+                   {{fileSets.at(0).at(0)}, fileSets.at(1)}),
+               qaic::openrt::CoreExceptionInit);
+  ASSERT_THROW(qaic::openrt::FileSetDataset::Factory(dir_ + "/missing", 1),
+               qaic::openrt::CoreExceptionInit);
+
+  auto source = qaic::openrt::FileSetDataset::Factory(fileSets);
+  qaic::openrt::DatasetStreamerProperties properties;
+  // Dataset inputs must match the program inputs
+  BufferMappings mappings = simulatedMappings(false);
+  mappings.erase(mappings.begin());
+  ASSERT_THROW(
+      qaic::openrt::DatasetStreamer::Factory(mappings, source, properties),
+      qaic::openrt::CoreExceptionInit);
+  ASSERT_THROW(qaic::openrt::DatasetStreamer::Factory(simulatedMappings(false),
+                                                      nullptr, properties),
+               qaic::openrt::CoreExceptionInit);
+  properties.numSlots = 0;
+  ASSERT_THROW(qaic::openrt::DatasetStreamer::Factory(simulatedMappings(false),
+                                                      source, properties),
+               qaic::openrt::CoreExceptionInit);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtDatasetUnitTest, PackedDatasetTest) { PackedDatasetTest(); }
+
+TEST_F(QAicOpenRtDatasetUnitTest, FileSetDatasetDirectoryTest) {
+  FileSetDatasetDirectoryTest();
+}
+
+TEST_F(QAicOpenRtDatasetUnitTest, DatasetStreamerOrderTest) {
+  DatasetStreamerOrderTest();
+}
+
+TEST_F(QAicOpenRtDatasetUnitTest, DatasetStreamerLoopTest) {
+  DatasetStreamerLoopTest();
+}
+
+TEST_F(QAicOpenRtDatasetUnitTest, DatasetStreamerHeldSlotsTest) {
+  DatasetStreamerHeldSlotsTest();
+}
+
+TEST_F(QAicOpenRtDatasetUnitTest, DatasetStreamerPartialInputTest) {
+  DatasetStreamerPartialInputTest();
+}
+
+TEST_F(QAicOpenRtDatasetUnitTest, AdversarialDatasetCorruptPackTest) {
+  DatasetCorruptPackTest();
+}
+
+TEST_F(QAicOpenRtDatasetUnitTest, AdversarialDatasetInvalidParametersTest) {
+  DatasetInvalidParametersTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,460 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicOpenRtDeviceRecovery.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::openrt::DeviceRecovery;
+using qaic::openrt::DeviceRecoveryOps;
+using qaic::openrt::DeviceRecoveryProperties;
+using qaic::openrt::DeviceRecoveryState;
+using qaic::openrt::DeviceRecoveryStats;
+using std::chrono::milliseconds;
+
+class QAicOpenRtDeviceRecoveryUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtDeviceRecoveryUnitTest(){};
+  ~QAicOpenRtDeviceRecoveryUnitTest() = default;
+
+  QAicOpenRtDeviceRecoveryUnitTest(const QAicOpenRtDeviceRecoveryUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtDeviceRecoveryUnitTest &
+  operator=(const QAicOpenRtDeviceRecoveryUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void ResetRecoveryTest();
+  void InFlightTest();
+  void AcquireWaitTest();
+  void RetryTest();
+  void EventSequenceTest();
+  void ProgramLostTest();
+  void InvalidUseTest();
+
+  // Simulated device running one program. A reset drops the program, work
+  // on it then fails like ExecObjs on a device in error.
+  struct SimulatedDevice {
+    DeviceRecoveryOps ops() {
+      DeviceRecoveryOps o;
+      o.teardown = [this]() {
+        numTeardowns++;
+        bool wasActive = active.exchange(false);
+        loaded = false;
+        return wasActive ? QS_SUCCESS : QS_ERROR;
+      };
+      o.load = [this]() {
+        std::this_thread::sleep_for(loadDelay);
+        if (!up || (failLoads > 0 && failLoads-- > 0)) {
+          return QS_ERROR;
+        }
+        numLoads++;
+        loaded = true;
+        return QS_SUCCESS;
+      };
+      o.activate = [this]() {
+        if (!up || !loaded) {
+          return QS_ERROR;
+        }
+        active = true;
+        return QS_SUCCESS;
+      };
+      o.reestablish = [this]() {
+        numReestablished++;
+        return QS_SUCCESS;
+      };
+      return o;
+    }
+
+    // udev reports the reset, the device drops everything loaded. Like
+    // ExecObjs, work fails once the programs saw the event.
+    void reset(DeviceRecovery &recovery, QID qid) {
+      up = false;
+      recovery.notifyDeviceEvent(qid, qaic::DEVICE_DOWN);
+      active = false;
+      loaded = false;
+    }
+
+    void restart(DeviceRecovery &recovery, QID qid) {
+      up = true;
+      recovery.notifyDeviceEvent(qid, qaic::DEVICE_UP);
+    }
+
+    QStatus infer() {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      return active ? QS_SUCCESS : QS_DEV_ERROR;
+    }
+
+    std::atomic_bool up{true};
+    std::atomic_bool loaded{false};
+    std::atomic_bool active{false};
+    std::atomic<int32_t> failLoads{0};
+    std::atomic<uint32_t> numLoads{0};
+    std::atomic<uint32_t> numTeardowns{0};
+    std::atomic<uint32_t> numReestablished{0};
+    milliseconds loadDelay{0};
+  };
+
+  static bool waitForState(DeviceRecovery &recovery,
+                           DeviceRecovery::ProgramID id,
+                           DeviceRecoveryState expected,
+                           milliseconds timeout = milliseconds(5000)) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    DeviceRecoveryState state = DeviceRecoveryState::Serving;
+    while (std::chrono::steady_clock::now() < deadline) {
+      if ((recovery.getState(id, state) == QS_SUCCESS) && (state == expected)) {
+        return true;
+      }
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+    return false;
+  }
+
+  static DeviceRecoveryProperties fastProperties() {
+    DeviceRecoveryProperties properties;
+    properties.drainTimeout = milliseconds(1000);
+    properties.retryInterval = milliseconds(5);
+    return properties;
+  }
+};
+
+void QAicOpenRtDeviceRecoveryUnitTest::ResetRecoveryTest() {
+  SimulatedDevice device;
+  auto recovery = DeviceRecovery::Factory(fastProperties());
+  DeviceRecovery::ProgramID id = 0;
+  ASSERT_EQ(recovery->add(0, device.ops(), id), QS_SUCCESS);
+  ASSERT_TRUE(device.active);
+  ASSERT_EQ(device.numReestablished, 1u);
+
+  QStatus status = QS_ERROR;
+  DeviceRecovery::Lease lease = recovery->acquire(id, status);
+  ASSERT_EQ(status, QS_SUCCESS);
+  ASSERT_TRUE(lease.isValid());
+  ASSERT_EQ(lease.check(device.infer()), QS_SUCCESS);
+
+  // Work on a lease taken before the reset fails with a retryable status
+  device.reset(*recovery, 0);
+  ASSERT_FALSE(lease.isValid());
+  ASSERT_EQ(lease.check(device.infer()), QS_DEVICE_RECOVERING);
+  ASSERT_EQ(lease.check(QS_SUCCESS), QS_SUCCESS);
+  DeviceRecoveryState state = DeviceRecoveryState::Serving;
+  ASSERT_EQ(recovery->getState(id, state), QS_SUCCESS);
+  ASSERT_EQ(state, DeviceRecoveryState::Down);
+  ASSERT_FALSE(recovery->acquire(id, status));
+  ASSERT_EQ(status, QS_DEVICE_RECOVERING);
+
+  // Re-established in the background once the device is back and the
+  // stale lease returned
+  device.restart(*recovery, 0);
+  std::this_thread::sleep_for(milliseconds(20));
+  ASSERT_FALSE(device.active);
+  lease.reset();
+  ASSERT_TRUE(waitForState(*recovery, id, DeviceRecoveryState::Serving));
+  ASSERT_TRUE(device.active);
+  ASSERT_EQ(device.numLoads, 2u);
+  ASSERT_EQ(device.numTeardowns, 1u);
+  ASSERT_EQ(device.numReestablished, 2u);
+
+  lease = recovery->acquire(id, status);
+  ASSERT_EQ(status, QS_SUCCESS);
+  ASSERT_EQ(lease.check(device.infer()), QS_SUCCESS);
+  DeviceRecoveryStats stats = recovery->getStats();
+  ASSERT_EQ(stats.numResets, 1u);
+  ASSERT_EQ(stats.numRecovered, 1u);
+  ASSERT_EQ(stats.numFailed, 0u);
+  ASSERT_EQ(stats.numRejected, 1u);
+  ASSERT_GT(stats.lastRecoveryTime.count(), 0);
+}
+
+void QAicOpenRtDeviceRecoveryUnitTest::InFlightTest() {
+  SimulatedDevice device;
+  auto recovery = DeviceRecovery::Factory(fastProperties());
+  DeviceRecovery::ProgramID id = 0;
+  ASSERT_EQ(recovery->add(0, device.ops(), id), QS_SUCCESS);
+
+  // Clients retrying on QS_DEVICE_RECOVERING never see another failure
+  std::atomic_bool stop{false};
+  std::atomic<uint32_t> numServed{0};
+  std::atomic<uint32_t> numRecovering{0};
+  std::atomic<uint32_t> numFailed{0};
+  std::vector<std::thread> clients;
+  for (int t = 0; t < 4; t++) {
+    clients.emplace_back([&]() {
+      while (!stop) {
+        QStatus status = QS_ERROR;
+        DeviceRecovery::Lease lease = recovery->acquire(id, status);
+        if (lease) {
+          status = lease.check(device.infer());
+        }
+        if (status == QS_SUCCESS) {
+          numServed++;
+        } else if (status == QS_DEVICE_RECOVERING) {
+          numRecovering++;
+          std::this_thread::sleep_for(milliseconds(1));
+        } else {
+          numFailed++;
+        }
+      }
+    });
+  }
+
+  for (int cycle = 0; cycle < 3; cycle++) {
+    std::this_thread::sleep_for(milliseconds(20));
+    device.reset(*recovery, 0);
+    std::this_thread::sleep_for(milliseconds(20));
+    device.restart(*recovery, 0);
+    ASSERT_TRUE(waitForState(*recovery, id, DeviceRecoveryState::Serving));
+  }
+  const uint32_t servedBeforeLast = numServed;
+  std::this_thread::sleep_for(milliseconds(20));
+  stop = true;
+  for (auto &client : clients) {
+    client.join();
+  }
+
+  ASSERT_EQ(numFailed, 0u);
+  ASSERT_GT(numRecovering, 0u);
+  // Service resumed after the last recovery
+  ASSERT_GT(numServed, servedBeforeLast);
+  ASSERT_EQ(recovery->getStats().numRecovered, 3u);
+}
+
+void QAicOpenRtDeviceRecoveryUnitTest::AcquireWaitTest() {
+  SimulatedDevice device;
+  DeviceRecoveryProperties properties = fastProperties();
+  properties.acquireTimeout = milliseconds(5000);
+  auto recovery = DeviceRecovery::Factory(properties);
+  DeviceRecovery::ProgramID id = 0;
+  ASSERT_EQ(recovery->add(0, device.ops(), id), QS_SUCCESS);
+
+  // A request arriving while the device is down waits for the recovery
+  device.reset(*recovery, 0);
+  QStatus status = QS_ERROR;
+  std::thread waiter([&]() {
+    DeviceRecovery::Lease lease = recovery->acquire(id, status);
+    if (lease) {
+      status = lease.check(device.infer());
+    }
+  });
+  std::this_thread::sleep_for(milliseconds(20));
+  device.restart(*recovery, 0);
+  waiter.join();
+  ASSERT_EQ(status, QS_SUCCESS);
+  ASSERT_EQ(recovery->getStats().numRejected, 0u);
+}
+
+void QAicOpenRtDeviceRecoveryUnitTest::RetryTest() {
+  SimulatedDevice device;
+  DeviceRecoveryProperties properties = fastProperties();
+  properties.maxAttempts = 3;
+  auto recovery = DeviceRecovery::Factory(properties);
+  DeviceRecovery::ProgramID id = 0;
+  ASSERT_EQ(recovery->add(0, device.ops(), id), QS_SUCCESS);
+
+  // Recovered on the last attempt
+  device.failLoads = 2;
+  device.reset(*recovery, 0);
+  device.restart(*recovery, 0);
+  ASSERT_TRUE(waitForState(*recovery, id, DeviceRecoveryState::Serving));
+  ASSERT_TRUE(device.active);
+
+  // Given up until the next reset
+  device.failLoads = 3;
+  device.reset(*recovery, 0);
+  device.restart(*recovery, 0);
+  ASSERT_TRUE(waitForState(*recovery, id, DeviceRecoveryState::Failed));
+  QStatus status = QS_ERROR;
+  ASSERT_FALSE(recovery->acquire(id, status));
+  ASSERT_EQ(status, QS_DEV_ERROR);
+  ASSERT_EQ(recovery->getStats().numFailed, 1u);
+
+  device.reset(*recovery, 0);
+  device.restart(*recovery, 0);
+  ASSERT_TRUE(waitForState(*recovery, id, DeviceRecoveryState::Serving));
+  ASSERT_TRUE(recovery->acquire(id, status));
+  ASSERT_EQ(recovery->getStats().numRecovered, 2u);
+}
+
+void QAicOpenRtDeviceRecoveryUnitTest::EventSequenceTest() {
+  SimulatedDevice device0;
+  SimulatedDevice device1;
+  auto recovery = DeviceRecovery::Factory(fastProperties());
+  DeviceRecovery::ProgramID id0 = 0;
+  DeviceRecovery::ProgramID id1 = 0;
+  ASSERT_EQ(recovery->add(0, device0.ops(), id0), QS_SUCCESS);
+  ASSERT_EQ(recovery->add(1, device1.ops(), id1), QS_SUCCESS);
+
+  // Only the programs of the reset device are affected, VC events and an
+  // up without a down change nothing
+  recovery->notifyDeviceEvent(0, qaic::VC_DOWN);
+  recovery->notifyDeviceEvent(0, qaic::VC_UP);
+  recovery->notifyDeviceEvent(0, qaic::DEVICE_UP);
+  device1.reset(*recovery, 1);
+  device1.reset(*recovery, 1);
+  QStatus status = QS_ERROR;
+  ASSERT_TRUE(recovery->acquire(id0, status));
+  ASSERT_FALSE(recovery->acquire(id1, status));
+  ASSERT_EQ(recovery->getStats().numResets, 1u);
+  device1.restart(*recovery, 1);
+  ASSERT_TRUE(waitForState(*recovery, id1, DeviceRecoveryState::Serving));
+  ASSERT_EQ(device0.numLoads, 1u);
+  ASSERT_EQ(device0.numTeardowns, 0u);
+
+  // Reset again while being recovered, recovered by the next up
+  device0.loadDelay = milliseconds(50);
+  device0.reset(*recovery, 0);
+  device0.restart(*recovery, 0);
+  ASSERT_TRUE(waitForState(*recovery, id0, DeviceRecoveryState::Recovering));
+  device0.reset(*recovery, 0);
+  DeviceRecoveryState state = DeviceRecoveryState::Serving;
+  std::this_thread::sleep_for(milliseconds(100));
+  ASSERT_EQ(recovery->getState(id0, state), QS_SUCCESS);
+  ASSERT_EQ(state, DeviceRecoveryState::Down);
+  device0.loadDelay = milliseconds(0);
+  device0.restart(*recovery, 0);
+  ASSERT_TRUE(waitForState(*recovery, id0, DeviceRecoveryState::Serving));
+  ASSERT_TRUE(device0.active);
+}
+
+void QAicOpenRtDeviceRecoveryUnitTest::ProgramLostTest() {
+  // Two programs on one device, the first attached to the images of a
+  // process that exits
+  SimulatedDevice lostDevice;
+  SimulatedDevice otherDevice;
+  auto recovery = DeviceRecovery::Factory(fastProperties());
+  DeviceRecovery::ProgramID id = 0;
+  DeviceRecovery::ProgramID otherId = 0;
+  ASSERT_EQ(recovery->add(0, lostDevice.ops(), id), QS_SUCCESS);
+  ASSERT_EQ(recovery->add(0, otherDevice.ops(), otherId), QS_SUCCESS);
+
+  QStatus status = QS_ERROR;
+  DeviceRecovery::Lease lease = recovery->acquire(id, status);
+  DeviceRecovery::Lease otherLease = recovery->acquire(otherId, status);
+  ASSERT_TRUE(lease);
+  ASSERT_TRUE(otherLease);
+
+  // Work in flight fails, the program is recovered alone
+  recovery->notifyProgramLost(id);
+  lostDevice.active = false;
+  ASSERT_FALSE(lease.isValid());
+  ASSERT_EQ(lease.check(lostDevice.infer()), QS_DEVICE_RECOVERING);
+  ASSERT_FALSE(recovery->acquire(id, status));
+  ASSERT_EQ(status, QS_DEVICE_RECOVERING);
+  ASSERT_TRUE(otherLease.isValid());
+  ASSERT_EQ(otherLease.check(otherDevice.infer()), QS_SUCCESS);
+
+  // Lost again before the recovery starts, recovered once
+  recovery->notifyProgramLost(id);
+  lease.reset();
+  ASSERT_TRUE(waitForState(*recovery, id, DeviceRecoveryState::Serving));
+  ASSERT_TRUE(lostDevice.active);
+  ASSERT_EQ(lostDevice.numLoads, 2u);
+  ASSERT_EQ(lostDevice.numReestablished, 2u);
+  ASSERT_EQ(otherDevice.numLoads, 1u);
+  ASSERT_EQ(otherDevice.numTeardowns, 0u);
+  lease = recovery->acquire(id, status);
+  ASSERT_EQ(status, QS_SUCCESS);
+  ASSERT_EQ(lease.check(lostDevice.infer()), QS_SUCCESS);
+
+  DeviceRecoveryStats stats = recovery->getStats();
+  ASSERT_EQ(stats.numResets, 1u);
+  ASSERT_EQ(stats.numRecovered, 1u);
+
+  // A device down recovers its programs once it is back
+  lease.reset();
+  otherLease.reset();
+  lostDevice.reset(*recovery, 0);
+  recovery->notifyProgramLost(id);
+  std::this_thread::sleep_for(milliseconds(20));
+  ASSERT_FALSE(lostDevice.active);
+  lostDevice.restart(*recovery, 0);
+  ASSERT_TRUE(waitForState(*recovery, id, DeviceRecoveryState::Serving));
+  ASSERT_EQ(lostDevice.numLoads, 3u);
+
+  // Unknown programs are ignored
+  recovery->notifyProgramLost(1234);
+}
+
+void QAicOpenRtDeviceRecoveryUnitTest::InvalidUseTest() {
+  SimulatedDevice device;
+  auto recovery = DeviceRecovery::Factory(fastProperties());
+  DeviceRecovery::ProgramID id = 0;
+
+  DeviceRecoveryOps ops = device.ops();
+  ops.teardown = nullptr;
+  ASSERT_EQ(recovery->add(0, ops, id), QS_INVAL);
+  ASSERT_EQ(recovery->add(0, nullptr, id), QS_INVAL);
+
+  // A program that fails to activate is not kept
+  device.up = false;
+  ASSERT_EQ(recovery->add(0, device.ops(), id), QS_ERROR);
+  device.up = true;
+
+  QStatus status = QS_SUCCESS;
+  ASSERT_FALSE(recovery->acquire(1234, status));
+  ASSERT_EQ(status, QS_INVAL);
+  DeviceRecoveryState state;
+  ASSERT_EQ(recovery->getState(1234, state), QS_INVAL);
+  ASSERT_EQ(recovery->remove(1234), QS_INVAL);
+
+  // A removed program is torn down and no longer recovered
+  ASSERT_EQ(recovery->add(0, device.ops(), id), QS_SUCCESS);
+  DeviceRecovery::Lease lease = recovery->acquire(id, status);
+  ASSERT_TRUE(lease);
+  lease.reset();
+  ASSERT_EQ(recovery->remove(id), QS_SUCCESS);
+  ASSERT_FALSE(device.active);
+  ASSERT_FALSE(recovery->acquire(id, status));
+  ASSERT_EQ(status, QS_INVAL);
+  device.reset(*recovery, 0);
+  device.restart(*recovery, 0);
+  std::this_thread::sleep_for(milliseconds(20));
+  ASSERT_FALSE(device.active);
+
+  // Destruction with the device down and a lease outstanding
+  ASSERT_EQ(recovery->add(0, device.ops(), id), QS_SUCCESS);
+  lease = recovery->acquire(id, status);
+  device.reset(*recovery, 0);
+  recovery.reset();
+  ASSERT_FALSE(lease.isValid());
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtDeviceRecoveryUnitTest, ResetRecoveryTest) {
+  ResetRecoveryTest();
+}
+
+TEST_F(QAicOpenRtDeviceRecoveryUnitTest, InFlightTest) { InFlightTest(); }
+
+TEST_F(QAicOpenRtDeviceRecoveryUnitTest, AcquireWaitTest) {
+  AcquireWaitTest();
+}
+
+TEST_F(QAicOpenRtDeviceRecoveryUnitTest, AdversarialRetryTest) {
+  RetryTest();
+}
+
+TEST_F(QAicOpenRtDeviceRecoveryUnitTest, AdversarialEventSequenceTest) {
+  EventSequenceTest();
+}
+
+TEST_F(QAicOpenRtDeviceRecoveryUnitTest, ProgramLostTest) {
+  ProgramLostTest();
+}
+
+TEST_F(QAicOpenRtDeviceRecoveryUnitTest, AdversarialInvalidUseTest) {
+  InvalidUseTest();
+}
+
+} // namespace QAicOpenRtUnitTest
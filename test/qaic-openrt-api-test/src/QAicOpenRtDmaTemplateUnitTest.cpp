@@ -0,0 +1,309 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QMetaData.h"
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::DmaInbound;
+using qaic::DmaLinkListTransfer;
+using qaic::DmaNoTransfer;
+using qaic::DmaOutbound;
+using qaic::DmaTransferDirection;
+using qaic::IDX_NO_DMA;
+using qaic::QDmaRequestElement;
+using qaic::QElemToBufVec;
+using qaic::QMetaData;
+using qaic::QReqElemStencil;
+using qaic::SemCmd;
+using qaic::SemCmdIncrement;
+using qaic::SemCmdWaitGtrEqual;
+
+class QAicOpenRtDmaTemplateUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtDmaTemplateUnitTest(){};
+  ~QAicOpenRtDmaTemplateUnitTest() = default;
+
+  QAicOpenRtDmaTemplateUnitTest(const QAicOpenRtDmaTemplateUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtDmaTemplateUnitTest &
+  operator=(const QAicOpenRtDmaTemplateUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void RequestEquivalenceTest();
+  void SliceEquivalenceTest();
+  void InvalidBufferTest();
+
+  static constexpr uint32_t numBufs = 8;
+  static constexpr uint64_t ddrBase = 0x100000000ULL;
+  static constexpr uint64_t mcIDBase = 0x20000;
+
+  struct ElementParams {
+    bool resp;
+    DmaTransferDirection dir;
+    uint64_t src;
+    uint64_t dst;
+    uint32_t len;
+    uint64_t dbAddr;
+    uint8_t dbWrite;
+    uint8_t dbLen;
+    uint32_t dbData;
+    std::array<SemCmd, 4> sems;
+    int32_t bufIndex;
+    bool vtcm;
+  };
+
+  // A DMA heavy network: transfers in and out of DDR and VTCM, doorbells,
+  // semaphores and elements without a transfer
+  static std::vector<ElementParams> makeNetwork(uint32_t numElems,
+                                                uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<ElementParams> params(numElems);
+    for (auto &p : params) {
+      const uint32_t kind = rng() % 4;
+      p.dir = (kind == 0) ? DmaNoTransfer
+                          : ((kind == 1) ? DmaInbound : DmaOutbound);
+      p.resp = (rng() % 3) == 0;
+      p.src = (p.dir == DmaOutbound) ? (rng() & 0xffff0) : 0;
+      p.dst = (p.dir == DmaInbound) ? (rng() & 0xffff0) : 0;
+      p.len = 64 + (rng() % 4096);
+      p.dbWrite = rng() % 2;
+      p.dbAddr = p.dbWrite ? (rng() & 0xfff0) : 0;
+      p.dbLen = rng() % 3;
+      p.dbData = rng();
+      for (auto &sem : p.sems) {
+        if ((rng() % 2) != 0) {
+          sem = SemCmd(true, rng() % 2, rng() % 2,
+                       (rng() % 2) ? SemCmdIncrement : SemCmdWaitGtrEqual,
+                       rng() % 2, rng() % 32, rng() % 4096);
+        }
+      }
+      // Some elements without a transfer still belong to a buffer
+      p.bufIndex = ((kind == 0) && ((rng() % 2) == 0))
+                       ? IDX_NO_DMA
+                       : static_cast<int32_t>(rng() % numBufs);
+      p.vtcm = (rng() % 2) != 0;
+    }
+    return params;
+  }
+
+  static QReqElemStencil makeStencil(const std::vector<ElementParams> &params) {
+    QReqElemStencil stencil;
+    for (const auto &p : params) {
+      stencil.emplace_back(new QDmaRequestElement(
+          0, 0, false, p.resp, DmaLinkListTransfer, p.dir, p.src, p.dst, p.len,
+          p.dbAddr, p.dbWrite, p.dbLen, p.dbData, p.sems, p.bufIndex, p.vtcm));
+    }
+    return stencil;
+  }
+
+  // The metadata of an activation, and the elements it was made from with
+  // the same base addresses applied
+  static std::unique_ptr<QMetaData>
+  activate(const std::vector<ElementParams> &params, QReqElemStencil &ref) {
+    QMetaData meta(numBufs, QElemToBufVec(params.size()), makeStencil(params));
+    auto base = makeStencil(params);
+    ref.clear();
+    for (const auto &item : base) {
+      ref.emplace_back(new QDmaRequestElement(*item, ddrBase, mcIDBase));
+    }
+    return std::unique_ptr<QMetaData>(static_cast<QMetaData *>(
+        meta.getUpdatedMetadata(ddrBase, mcIDBase).release()));
+  }
+
+  // Elements fully encoded one after the other
+  static QStatus encodeReference(const QReqElemStencil &ref,
+                                 qaic::QReqID &reqID, const QBuffer *bufs,
+                                 std::vector<uint8_t *> &elems,
+                                 qaic::QReqID &lastReqID) {
+    qaic::QReqID i = 0, last = 0;
+    for (const auto &item : ref) {
+      if (reqID + i == 0) {
+        reqID += 1;
+      }
+      bool needResponse = false;
+      if (item->getBufIndex() == IDX_NO_DMA) {
+        item->encodeElement(elems[i], reqID + i);
+      } else if (!item->encodeElement(elems[i], reqID + i,
+                                      bufs[item->getBufIndex()],
+                                      needResponse)) {
+        return QS_INVAL;
+      }
+      if (needResponse) {
+        last = reqID + i;
+      }
+      i++;
+    }
+    if (last) {
+      lastReqID = last;
+    }
+    reqID += i;
+    return QS_SUCCESS;
+  }
+
+  std::vector<std::vector<uint8_t>> userBufs_;
+
+  std::vector<QBuffer> makeBuffers() {
+    userBufs_.assign(numBufs, std::vector<uint8_t>(8192));
+    std::vector<QBuffer> bufs(numBufs);
+    for (uint32_t b = 0; b < numBufs; b++) {
+      bufs[b].buf = userBufs_[b].data();
+      bufs[b].size = userBufs_[b].size();
+    }
+    return bufs;
+  }
+};
+
+void QAicOpenRtDmaTemplateUnitTest::RequestEquivalenceTest() {
+  const uint32_t elemSize = QDmaRequestElement::getSize();
+  for (uint32_t seed = 0; seed < 8; seed++) {
+    const auto params = makeNetwork(300, seed);
+    QReqElemStencil ref;
+    auto meta = activate(params, ref);
+    auto bufs = makeBuffers();
+
+    // Request queue wrapping in the middle of the inference
+    const size_t queueSize = 512;
+    const size_t head = 400 + seed;
+    std::vector<uint8_t> queue(queueSize * elemSize, 0xa5);
+    std::vector<uint8_t> refQueue(queueSize * elemSize, 0x5a);
+    std::vector<uint8_t *> elems;
+    std::vector<uint8_t *> refElems;
+    for (size_t i = 0; i < params.size(); i++) {
+      const size_t slot = (head + i) % queueSize;
+      elems.push_back(&queue[slot * elemSize]);
+      refElems.push_back(&refQueue[slot * elemSize]);
+    }
+
+    // Request IDs wrapping past 0 as well
+    for (qaic::QReqID start : {qaic::QReqID(1), qaic::QReqID(65400),
+                               qaic::QReqID(0)}) {
+      qaic::QReqID reqID = start, refReqID = start;
+      qaic::QReqID lastReqID = 7, refLastReqID = 7;
+      ASSERT_EQ(meta->updateDmaReqElements(reqID, bufs.data(), numBufs,
+                                           elems, lastReqID),
+                QS_SUCCESS);
+      ASSERT_EQ(encodeReference(ref, refReqID, bufs.data(), refElems,
+                                refLastReqID),
+                QS_SUCCESS);
+      ASSERT_EQ(reqID, refReqID);
+      ASSERT_EQ(lastReqID, refLastReqID);
+      for (size_t i = 0; i < elems.size(); i++) {
+        ASSERT_EQ(memcmp(elems[i], refElems[i], elemSize), 0)
+            << "seed " << seed << " element " << i << " " << ref[i]->str();
+      }
+    }
+  }
+}
+
+void QAicOpenRtDmaTemplateUnitTest::SliceEquivalenceTest() {
+  const auto params = makeNetwork(200, 42);
+  QReqElemStencil ref;
+  auto meta = activate(params, ref);
+
+  std::vector<qaic_attach_slice_entry> slices(params.size());
+  std::vector<qaic_attach_slice_entry> refSlices(params.size());
+  memset(slices.data(), 0xff, slices.size() * sizeof(slices[0]));
+  memset(refSlices.data(), 0, refSlices.size() * sizeof(refSlices[0]));
+  for (size_t i = 0; i < params.size(); i++) {
+    slices[i].size = refSlices[i].size = params[i].len;
+    slices[i].offset = refSlices[i].offset = i * 4096;
+    ref[i]->encodeMem(&refSlices[i]);
+  }
+
+  // In the chunks a buffer is attached in
+  for (uint32_t start = 0; start < params.size(); start += 13) {
+    const uint32_t num =
+        std::min<uint32_t>(13, static_cast<uint32_t>(params.size()) - start);
+    ASSERT_EQ(meta->updateElementsFromMeta(&slices[start], start, num),
+              QS_SUCCESS);
+  }
+  // Also sets the padding the kernel requires to be zero
+  ASSERT_EQ(memcmp(slices.data(), refSlices.data(),
+                   slices.size() * sizeof(slices[0])),
+            0);
+  ASSERT_EQ(meta->updateElementsFromMeta(slices.data(), 190, 11), QS_INVAL);
+}
+
+void QAicOpenRtDmaTemplateUnitTest::InvalidBufferTest() {
+  const auto params = makeNetwork(64, 7);
+  QReqElemStencil ref;
+  auto meta = activate(params, ref);
+  auto bufs = makeBuffers();
+  const uint32_t elemSize = QDmaRequestElement::getSize();
+  std::vector<uint8_t> queue(params.size() * elemSize);
+  std::vector<uint8_t *> elems;
+  for (size_t i = 0; i < params.size(); i++) {
+    elems.push_back(&queue[i * elemSize]);
+  }
+  qaic::QReqID reqID = 1, lastReqID = 0;
+
+  // Not enough room for the inference
+  std::vector<uint8_t *> fewer(elems.begin(), elems.end() - 1);
+  ASSERT_EQ(meta->updateDmaReqElements(reqID, bufs.data(), numBufs, fewer,
+                                       lastReqID),
+            QS_INVAL);
+
+  // Buffers missing, too small or null
+  ASSERT_EQ(meta->updateDmaReqElements(reqID, bufs.data(), 1, elems,
+                                       lastReqID),
+            QS_INVAL);
+  int32_t transferred = IDX_NO_DMA;
+  for (const auto &site : meta->getPatchSites()) {
+    if (site.addrWord != 0) {
+      transferred = site.bufIndex;
+      break;
+    }
+  }
+  ASSERT_NE(transferred, IDX_NO_DMA);
+  auto small = bufs;
+  small[transferred].size = 1;
+  ASSERT_EQ(meta->updateDmaReqElements(reqID, small.data(), numBufs, elems,
+                                       lastReqID),
+            QS_INVAL);
+  auto null = bufs;
+  null[transferred].buf = nullptr;
+  ASSERT_EQ(meta->updateDmaReqElements(reqID, null.data(), numBufs, elems,
+                                       lastReqID),
+            QS_INVAL);
+
+  // Buffers of elements without a transfer are not used
+  std::vector<ElementParams> noTransfer(4, params[0]);
+  for (auto &p : noTransfer) {
+    p.dir = DmaNoTransfer;
+    p.bufIndex = 0;
+  }
+  auto noTransferMeta = activate(noTransfer, ref);
+  auto unused = bufs;
+  unused[0].buf = nullptr;
+  reqID = 1;
+  ASSERT_EQ(noTransferMeta->updateDmaReqElements(reqID, unused.data(),
+                                                 numBufs, elems, lastReqID),
+            QS_SUCCESS);
+  ASSERT_EQ(reqID, 5);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtDmaTemplateUnitTest, RequestEquivalenceTest) {
+  RequestEquivalenceTest();
+}
+
+TEST_F(QAicOpenRtDmaTemplateUnitTest, SliceEquivalenceTest) {
+  SliceEquivalenceTest();
+}
+
+TEST_F(QAicOpenRtDmaTemplateUnitTest, AdversarialInvalidBufferTest) {
+  InvalidBufferTest();
+}
+
+} // namespace QAicOpenRtUnitTest
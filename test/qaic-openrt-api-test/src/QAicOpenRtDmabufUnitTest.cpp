@@ -0,0 +1,203 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QOsal.h"
+#include "QDmabufCache.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtDmabufUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtDmabufUnitTest(){};
+  ~QAicOpenRtDmabufUnitTest() = default;
+
+  QAicOpenRtDmabufUnitTest(const QAicOpenRtDmabufUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtDmabufUnitTest &
+  operator=(const QAicOpenRtDmabufUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  static constexpr uint32_t regionSize = 4096;
+
+  void DmabufKeyTest();
+  void DmabufCacheTest();
+  void DmabufAllocTest();
+  void DmabufInvalidTest();
+
+  // memfd stands in for a dma-buf exported by another driver, both are
+  // anonymous files with a unique inode
+  int createStandIn();
+  QBuffer standInBuffer(int fd, uint32_t offset);
+};
+
+int QAicOpenRtDmabufUnitTest::createStandIn() {
+  int fd = ::memfd_create(testName().c_str(), MFD_CLOEXEC);
+  if ((fd >= 0) && (::ftruncate(fd, 2 * regionSize) < 0)) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+QBuffer QAicOpenRtDmabufUnitTest::standInBuffer(int fd, uint32_t offset) {
+  QBuffer qbuf;
+  qbuf.size = regionSize;
+  qbuf.buf = nullptr;
+  qbuf.handle = static_cast<uint64_t>(fd);
+  qbuf.offset = offset;
+  qbuf.type = QBufferType::QBUFFER_TYPE_DMABUF;
+  return qbuf;
+}
+
+void QAicOpenRtDmabufUnitTest::DmabufKeyTest() {
+  int fd = createStandIn();
+  ASSERT_TRUE(fd >= 0);
+  int other = createStandIn();
+  ASSERT_TRUE(other >= 0);
+
+  qaic::QDmabufKey key;
+  ASSERT_TRUE(qaic::QOsal::getDmabufKey(standInBuffer(fd, 0), key) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(key.size == regionSize);
+
+  // The same file through another descriptor is the same registration
+  int dupFd = ::dup(fd);
+  ASSERT_TRUE(dupFd >= 0);
+  qaic::QDmabufKey dupKey;
+  ASSERT_TRUE(qaic::QOsal::getDmabufKey(standInBuffer(dupFd, 0), dupKey) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(key == dupKey);
+
+  // Another region of the same file, or another file, is not
+  qaic::QDmabufKey offsetKey;
+  ASSERT_TRUE(qaic::QOsal::getDmabufKey(standInBuffer(fd, regionSize),
+                                        offsetKey) == QS_SUCCESS);
+  ASSERT_TRUE(key != offsetKey);
+  qaic::QDmabufKey otherKey;
+  ASSERT_TRUE(qaic::QOsal::getDmabufKey(standInBuffer(other, 0), otherKey) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(key != otherKey);
+
+  // A recycled descriptor number does not alias the closed dma-buf
+  ::close(fd);
+  ::close(dupFd);
+  int recycled = createStandIn();
+  ASSERT_TRUE(recycled >= 0);
+  qaic::QDmabufKey recycledKey;
+  ASSERT_TRUE(qaic::QOsal::getDmabufKey(standInBuffer(recycled, 0),
+                                        recycledKey) == QS_SUCCESS);
+  ASSERT_TRUE(key != recycledKey);
+
+  ::close(recycled);
+  ::close(other);
+}
+
+void QAicOpenRtDmabufUnitTest::DmabufCacheTest() {
+  struct Registration {
+    explicit Registration(std::atomic<int> &live) : live_(live) { live_++; }
+    ~Registration() { live_--; }
+    std::atomic<int> &live_;
+  };
+  std::atomic<int> live{0};
+  qaic::QDmabufCache<Registration> cache(2);
+
+  auto keys = [](uint64_t ino) {
+    qaic::QDmabufKey key;
+    key.ino = ino;
+    key.size = regionSize;
+    return qaic::QDmabufKeyVec{key};
+  };
+
+  cache.insert(keys(1), std::make_shared<Registration>(live));
+  cache.insert(keys(2), std::make_shared<Registration>(live));
+  ASSERT_TRUE(live == 2);
+  ASSERT_TRUE(cache.find(keys(1)) != nullptr);
+
+  // 2 is now the least recently used and gets evicted
+  std::shared_ptr<Registration> inUse = cache.find(keys(2));
+  cache.find(keys(1));
+  cache.insert(keys(3), std::make_shared<Registration>(live));
+  ASSERT_TRUE(cache.size() == 2);
+  ASSERT_TRUE(cache.find(keys(2)) == nullptr);
+  ASSERT_TRUE(cache.find(keys(1)) != nullptr);
+
+  // Evicted registrations stay alive while still referenced
+  ASSERT_TRUE(live == 3);
+  inUse.reset();
+  ASSERT_TRUE(live == 2);
+
+  cache.clear();
+  ASSERT_TRUE(live == 0);
+
+  // Dropping a dma-buf drops every registration that uses it
+  qaic::QDmabufKeyVec both = keys(1);
+  both.push_back(keys(3).front());
+  cache.insert(keys(1), std::make_shared<Registration>(live));
+  cache.insert(both, std::make_shared<Registration>(live));
+  ASSERT_TRUE(cache.erase(0, 3) == 1);
+  ASSERT_TRUE(cache.size() == 1);
+  ASSERT_TRUE(live == 1);
+  ASSERT_TRUE(cache.erase(0, 1) == 1);
+  ASSERT_TRUE(live == 0);
+}
+
+void QAicOpenRtDmabufUnitTest::DmabufAllocTest() {
+  uint8_t *buf = nullptr;
+  uint64_t handle = 0;
+  QStatus status = qaic::QOsal::allocUserDmabuf(&buf, regionSize, &handle);
+  if (status == QS_UNSUPPORTED) {
+    GTEST_SKIP() << "udmabuf is not available";
+  }
+  ASSERT_TRUE(status == QS_SUCCESS);
+  ASSERT_TRUE(buf != nullptr);
+
+  // The mapping is the dma-buf memory
+  buf[0] = 0x5a;
+  buf[regionSize - 1] = 0xa5;
+  QBuffer qbuf = standInBuffer(static_cast<int>(handle), 0);
+  qbuf.buf = buf;
+  qaic::QDmabufKey key;
+  ASSERT_TRUE(qaic::QOsal::getDmabufKey(qbuf, key) == QS_SUCCESS);
+
+  qaic::QOsal::freeUserDmabuf(buf);
+  ASSERT_TRUE(qaic::QOsal::getDmabufKey(qbuf, key) == QS_BADFD);
+}
+
+void QAicOpenRtDmabufUnitTest::DmabufInvalidTest() {
+  qaic::QDmabufKey key;
+  QBuffer heap;
+  heap.type = QBufferType::QBUFFER_TYPE_HEAP;
+  ASSERT_TRUE(qaic::QOsal::getDmabufKey(heap, key) == QS_INVAL);
+
+  int fd = createStandIn();
+  ASSERT_TRUE(fd >= 0);
+  ::close(fd);
+  ASSERT_TRUE(qaic::QOsal::getDmabufKey(standInBuffer(fd, 0), key) ==
+              QS_BADFD);
+
+  uint64_t handle = 0;
+  ASSERT_TRUE(qaic::QOsal::allocUserDmabuf(nullptr, regionSize, &handle) ==
+              QS_INVAL);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtDmabufUnitTest, DmabufKeyTest) { DmabufKeyTest(); }
+
+TEST_F(QAicOpenRtDmabufUnitTest, DmabufCacheTest) { DmabufCacheTest(); }
+
+TEST_F(QAicOpenRtDmabufUnitTest, DmabufAllocTest) { DmabufAllocTest(); }
+
+TEST_F(QAicOpenRtDmabufUnitTest, AdversarialDmabufInvalidTest) {
+  DmabufInvalidTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,173 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QExecRunState.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace QAicOpenRtUnitTest {
+
+using std::chrono::milliseconds;
+using Clock = std::chrono::steady_clock;
+
+class QAicOpenRtExecRunStateUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtExecRunStateUnitTest(){};
+  ~QAicOpenRtExecRunStateUnitTest() = default;
+
+  QAicOpenRtExecRunStateUnitTest(const QAicOpenRtExecRunStateUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtExecRunStateUnitTest &
+  operator=(const QAicOpenRtExecRunStateUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void CancelRaceTest();
+  void LateReapTest();
+  void DeadlinePassedTest();
+
+  // Inference on a simulated device, done at a fixed time
+  struct SimulatedInference {
+    Clock::time_point completesAt;
+    uint32_t numWaits = 0;
+  };
+  using RunState = qaic::QExecRunState<SimulatedInference>;
+
+  // Kernel wait of the simulated device, returns at the completion or at
+  // the deadline, whichever comes first
+  static QStatus waitUntil(SimulatedInference &inference,
+                           Clock::time_point deadline) {
+    inference.numWaits++;
+    std::this_thread::sleep_until(std::min(inference.completesAt, deadline));
+    return (inference.completesAt <= deadline) ? QS_SUCCESS
+                                               : QS_DEADLINE_EXCEEDED;
+  }
+};
+
+void QAicOpenRtExecRunStateUnitTest::CancelRaceTest() {
+  RunState state;
+  // Not running
+  ASSERT_EQ(state.cancel(), QS_INVAL);
+
+  for (int i = 0; i < 500; i++) {
+    ASSERT_EQ(state.begin(waitUntil), QS_SUCCESS);
+    ASSERT_EQ(state.begin(waitUntil), QS_BUSY);
+
+    std::atomic_bool go{false};
+    QStatus claimStatus = QS_ERROR;
+    QStatus cancelStatus = QS_ERROR;
+    std::thread submitter([&]() {
+      while (!go) {
+        std::this_thread::yield();
+      }
+      claimStatus = state.claimSubmit();
+    });
+    std::thread canceler([&]() {
+      while (!go) {
+        std::this_thread::yield();
+      }
+      cancelStatus = state.cancel();
+    });
+    go = true;
+    submitter.join();
+    canceler.join();
+
+    // Exactly one of them wins, a canceled run never reaches the device
+    // and a submitted one is never reported canceled
+    if (claimStatus == QS_SUCCESS) {
+      ASSERT_EQ(cancelStatus, QS_BUSY);
+    } else {
+      ASSERT_EQ(claimStatus, QS_CANCELED);
+      ASSERT_EQ(cancelStatus, QS_SUCCESS);
+      ASSERT_EQ(state.cancel(), QS_BUSY);
+    }
+    state.end();
+  }
+  ASSERT_FALSE(state.isRunning());
+}
+
+void QAicOpenRtExecRunStateUnitTest::LateReapTest() {
+  RunState state;
+  auto late = std::make_shared<SimulatedInference>();
+  late->completesAt = Clock::now() + milliseconds(300);
+  state.setLate(late);
+
+  // The next run has 20ms, it gives up on the late inference at its own
+  // deadline rather than waiting it out
+  Clock::time_point start = Clock::now();
+  state.setDeadline(start + milliseconds(20));
+  ASSERT_EQ(state.begin(waitUntil), QS_DEADLINE_EXCEEDED);
+  ASSERT_GE(Clock::now() - start, milliseconds(20));
+  ASSERT_LT(Clock::now() - start, milliseconds(200));
+  ASSERT_EQ(late->numWaits, 1u);
+  ASSERT_TRUE(state.hasLateInference());
+  ASSERT_FALSE(state.isRunning());
+
+  // Without a deadline the late inference is waited for and dropped
+  state.setDeadline(Clock::time_point::max());
+  ASSERT_EQ(state.begin(waitUntil), QS_SUCCESS);
+  ASSERT_GE(Clock::now(), late->completesAt);
+  ASSERT_EQ(late->numWaits, 2u);
+  ASSERT_FALSE(state.hasLateInference());
+  ASSERT_EQ(state.claimSubmit(), QS_SUCCESS);
+  state.end();
+
+  // Reaped once only
+  ASSERT_EQ(state.begin(waitUntil), QS_SUCCESS);
+  ASSERT_EQ(late->numWaits, 2u);
+  state.end();
+
+  // Released with a late inference, waited for without bound
+  auto released = std::make_shared<SimulatedInference>();
+  released->completesAt = Clock::now() + milliseconds(20);
+  state.setLate(released);
+  state.setDeadline(Clock::now());
+  ASSERT_EQ(state.reapLate(waitUntil), QS_SUCCESS);
+  ASSERT_GE(Clock::now(), released->completesAt);
+  ASSERT_FALSE(state.hasLateInference());
+}
+
+void QAicOpenRtExecRunStateUnitTest::DeadlinePassedTest() {
+  RunState state;
+  auto late = std::make_shared<SimulatedInference>();
+  late->completesAt = Clock::now() + milliseconds(10000);
+  state.setLate(late);
+
+  // A run past its deadline fails without touching the late inference
+  state.setDeadline(Clock::now() - milliseconds(1));
+  Clock::time_point start = Clock::now();
+  ASSERT_EQ(state.begin(waitUntil), QS_DEADLINE_EXCEEDED);
+  ASSERT_LT(Clock::now() - start, milliseconds(100));
+  ASSERT_EQ(late->numWaits, 0u);
+  ASSERT_FALSE(state.isRunning());
+
+  // The deadline passing after the start drops the run before it submits
+  state.setLate(nullptr);
+  state.setDeadline(Clock::now() + milliseconds(20));
+  ASSERT_EQ(state.begin(waitUntil), QS_SUCCESS);
+  std::this_thread::sleep_for(milliseconds(30));
+  ASSERT_TRUE(state.isDeadlinePassed());
+  ASSERT_EQ(state.claimSubmit(), QS_DEADLINE_EXCEEDED);
+  state.end();
+  ASSERT_FALSE(state.isRunning());
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtExecRunStateUnitTest, CancelRaceTest) { CancelRaceTest(); }
+
+TEST_F(QAicOpenRtExecRunStateUnitTest, LateReapTest) { LateReapTest(); }
+
+TEST_F(QAicOpenRtExecRunStateUnitTest, AdversarialDeadlinePassedTest) {
+  DeadlinePassedTest();
+}
+
+} // namespace QAicOpenRtUnitTest
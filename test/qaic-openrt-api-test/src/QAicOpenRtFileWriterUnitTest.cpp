@@ -0,0 +1,345 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicOpenRtFileWriter.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtFileWriterUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtFileWriterUnitTest(){};
+  ~QAicOpenRtFileWriterUnitTest() = default;
+
+  QAicOpenRtFileWriterUnitTest(const QAicOpenRtFileWriterUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtFileWriterUnitTest &
+  operator=(const QAicOpenRtFileWriterUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  static constexpr uint32_t numInferences = 20;
+  static constexpr uint32_t smallSize = 100;
+  // Larger than the staging buffer of packed files
+  static constexpr uint32_t largeSize = 1536 * 1024;
+
+  void SetUp() override {
+    char dir[] = "/tmp/qaic-filewriter-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    dir_ = dir;
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    std::filesystem::remove_all(dir_, ec);
+  }
+
+  void FileWriterPerFileTest(bool async);
+  void FileWriterPackedTest(bool async, bool directIo);
+  void FileWriterBackPressureTest();
+  void FileWriterFailedWriteTest();
+  void FileWriterCorruptPackedTest();
+
+  std::vector<uint8_t> output(uint32_t infNumber, uint32_t output,
+                              size_t size);
+  BufferMappings simulatedMappings(uint32_t largeOutputSize);
+  void fillBuffers(uint32_t infNumber, uint32_t largeOutputSize);
+  std::vector<uint8_t> readFile(const std::string &path);
+  void expectPacked(const std::string &path, uint32_t largeOutputSize);
+
+  std::string dir_;
+  std::vector<std::vector<uint8_t>> data_;
+  std::vector<QBuffer> buffers_;
+};
+
+std::vector<uint8_t> QAicOpenRtFileWriterUnitTest::output(uint32_t infNumber,
+                                                          uint32_t output,
+                                                          size_t size) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; i++) {
+    data.at(i) = static_cast<uint8_t>(infNumber * 13 + output * 5 + i);
+  }
+  return data;
+}
+
+// One input, then a small output whose name holds a path separator and a
+// second output of largeOutputSize bytes
+BufferMappings
+QAicOpenRtFileWriterUnitTest::simulatedMappings(uint32_t largeOutputSize) {
+  BufferMappings mappings;
+  mappings.emplace_back("input", 0, QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT,
+                        smallSize, false,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  mappings.emplace_back("out/small", 1,
+                        QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT, smallSize,
+                        false, QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  mappings.emplace_back("large", 2, QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT,
+                        largeOutputSize, false,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  return mappings;
+}
+
+// Buffers are overwritten for every inference, as an ExecObj would do
+void QAicOpenRtFileWriterUnitTest::fillBuffers(uint32_t infNumber,
+                                               uint32_t largeOutputSize) {
+  data_ = {std::vector<uint8_t>(smallSize, 0xff),
+           output(infNumber, 1, smallSize),
+           output(infNumber, 2, largeOutputSize)};
+  buffers_.clear();
+  for (auto &d : data_) {
+    QBuffer buffer{};
+    buffer.buf = d.data();
+    buffer.size = d.size();
+    buffer.type = QBufferType::QBUFFER_TYPE_HEAP;
+    buffers_.push_back(buffer);
+  }
+}
+
+std::vector<uint8_t>
+QAicOpenRtFileWriterUnitTest::readFile(const std::string &path) {
+  std::ifstream ifs(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(ifs),
+                              std::istreambuf_iterator<char>());
+}
+
+void QAicOpenRtFileWriterUnitTest::expectPacked(const std::string &path,
+                                                uint32_t largeOutputSize) {
+  std::vector<std::string> names;
+  std::vector<qaic::openrt::FileWriter::PackedEntry> entries;
+  ASSERT_TRUE(qaic::openrt::FileWriter::readPackedIndex(path, names,
+                                                        entries) == QS_SUCCESS);
+  ASSERT_TRUE(names.size() == 2);
+  ASSERT_TRUE(names.at(0) == "out_small");
+  ASSERT_TRUE(names.at(1) == "large");
+  ASSERT_TRUE(entries.size() == numInferences * 2);
+  std::vector<uint8_t> file = readFile(path);
+  for (uint32_t i = 0; i < entries.size(); i++) {
+    const auto &e = entries.at(i);
+    ASSERT_TRUE(e.infNumber == i / 2);
+    ASSERT_TRUE(e.nameIndex == i % 2);
+    ASSERT_TRUE(e.offset % qaic::openrt::FileWriter::packedAlignment == 0);
+    std::vector<uint8_t> expected =
+        output(i / 2, 1 + i % 2, (i % 2) ? largeOutputSize : smallSize);
+    ASSERT_TRUE(e.size == expected.size());
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(),
+                           file.begin() + e.offset));
+  }
+}
+
+void QAicOpenRtFileWriterUnitTest::FileWriterPerFileTest(bool async) {
+  qaic::openrt::FileWriter writer;
+  qaic::openrt::FileWriterProperties properties;
+  properties.async = async;
+  ASSERT_TRUE(writer.setOutputPath(dir_) == QS_SUCCESS);
+  ASSERT_TRUE(writer.setProperties(properties) == QS_SUCCESS);
+  BufferMappings mappings = simulatedMappings(smallSize);
+  for (uint32_t inf = 0; inf < numInferences; inf++) {
+    fillBuffers(inf, smallSize);
+    ASSERT_TRUE(writer.writeBuffers(buffers_, mappings, inf, false,
+                                    "-activation-0") == QS_SUCCESS);
+  }
+  ASSERT_TRUE(writer.flush() == QS_SUCCESS);
+  for (uint32_t inf = 0; inf < numInferences; inf++) {
+    const std::string suffix =
+        "-activation-0-inf-" + std::to_string(inf) + ".bin";
+    ASSERT_TRUE(readFile(dir_ + "/out_small" + suffix) ==
+                output(inf, 1, smallSize));
+    ASSERT_TRUE(readFile(dir_ + "/large" + suffix) ==
+                output(inf, 2, smallSize));
+  }
+  uint64_t bytesWritten = 0;
+  uint64_t stalls = 0;
+  writer.getStats(bytesWritten, stalls);
+  ASSERT_TRUE(bytesWritten == numInferences * 2 * smallSize);
+  ASSERT_TRUE(writer.close() == QS_SUCCESS);
+}
+
+void QAicOpenRtFileWriterUnitTest::FileWriterPackedTest(bool async,
+                                                        bool directIo) {
+  const std::string path = dir_ + "/outputs.qout";
+  {
+    qaic::openrt::FileWriter writer(dir_);
+    qaic::openrt::FileWriterProperties properties;
+    properties.async = async;
+    properties.format = qaic::openrt::FileWriterFormat::Packed;
+    properties.directIo = directIo;
+    ASSERT_TRUE(writer.setProperties(properties) == QS_SUCCESS);
+    BufferMappings mappings = simulatedMappings(largeSize);
+    for (uint32_t inf = 0; inf < numInferences; inf++) {
+      fillBuffers(inf, largeSize);
+      ASSERT_TRUE(writer.writeBuffers(buffers_, mappings, inf, false) ==
+                  QS_SUCCESS);
+    }
+    ASSERT_TRUE(writer.close() == QS_SUCCESS);
+  }
+  expectPacked(path, largeSize);
+
+  // Outputs smaller than a block are coalesced, and the writer destructor
+  // completes the file
+  {
+    qaic::openrt::FileWriter writer(dir_);
+    qaic::openrt::FileWriterProperties properties;
+    properties.async = async;
+    properties.format = qaic::openrt::FileWriterFormat::Packed;
+    properties.directIo = directIo;
+    ASSERT_TRUE(writer.setProperties(properties) == QS_SUCCESS);
+    BufferMappings mappings = simulatedMappings(smallSize);
+    for (uint32_t inf = 0; inf < numInferences; inf++) {
+      fillBuffers(inf, smallSize);
+      ASSERT_TRUE(writer.writeBuffers(buffers_, mappings, inf, false) ==
+                  QS_SUCCESS);
+    }
+  }
+  expectPacked(path, smallSize);
+}
+
+void QAicOpenRtFileWriterUnitTest::FileWriterBackPressureTest() {
+  qaic::openrt::FileWriter writer(dir_);
+  qaic::openrt::FileWriterProperties properties;
+  properties.async = true;
+  properties.format = qaic::openrt::FileWriterFormat::Packed;
+  // Less than one inference, every write waits for the queue to drain
+  properties.maxQueuedBytes = smallSize;
+  ASSERT_TRUE(writer.setProperties(properties) == QS_SUCCESS);
+  BufferMappings mappings = simulatedMappings(largeSize);
+  for (uint32_t inf = 0; inf < numInferences; inf++) {
+    fillBuffers(inf, largeSize);
+    ASSERT_TRUE(writer.writeBuffers(buffers_, mappings, inf, false) ==
+                QS_SUCCESS);
+  }
+  ASSERT_TRUE(writer.close() == QS_SUCCESS);
+  uint64_t bytesWritten = 0;
+  uint64_t stalls = 0;
+  writer.getStats(bytesWritten, stalls);
+  ASSERT_TRUE(bytesWritten ==
+              uint64_t{numInferences} * (smallSize + largeSize));
+  ASSERT_TRUE(stalls < numInferences);
+  expectPacked(dir_ + "/outputs.qout", largeSize);
+}
+
+void QAicOpenRtFileWriterUnitTest::FileWriterFailedWriteTest() {
+  const std::string gone = dir_ + "/gone";
+  std::filesystem::create_directories(gone);
+  qaic::openrt::FileWriter writer;
+  ASSERT_TRUE(writer.setOutputPath(dir_ + "/missing") == QS_ERROR);
+  ASSERT_TRUE(writer.setOutputPath(gone) == QS_SUCCESS);
+  qaic::openrt::FileWriterProperties properties;
+  properties.maxQueuedBytes = 0;
+  ASSERT_TRUE(writer.setProperties(properties) == QS_INVAL);
+  properties.maxQueuedBytes = smallSize;
+  properties.format = qaic::openrt::FileWriterFormat::Packed;
+  properties.packedFileName = "";
+  ASSERT_TRUE(writer.setProperties(properties) == QS_INVAL);
+  properties.format = qaic::openrt::FileWriterFormat::FilePerOutput;
+  properties.async = true;
+  ASSERT_TRUE(writer.setProperties(properties) == QS_SUCCESS);
+
+  // The failure of a queued write is reported by a later call
+  std::filesystem::remove_all(gone);
+  BufferMappings mappings = simulatedMappings(smallSize);
+  fillBuffers(0, smallSize);
+  ASSERT_TRUE(writer.writeBuffers(buffers_, mappings, 0, false) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(writer.flush() == QS_ERROR);
+  ASSERT_TRUE(writer.writeBuffers(buffers_, mappings, 1, false) == QS_ERROR);
+  ASSERT_TRUE(writer.close() == QS_ERROR);
+
+  // Mappings referring to missing buffers
+  buffers_.resize(2);
+  ASSERT_TRUE(writer.writeBuffers(buffers_, mappings, 0, false) == QS_ERROR);
+}
+
+void QAicOpenRtFileWriterUnitTest::FileWriterCorruptPackedTest() {
+  const std::string path = dir_ + "/outputs.qout";
+  {
+    qaic::openrt::FileWriter writer(dir_);
+    qaic::openrt::FileWriterProperties properties;
+    properties.format = qaic::openrt::FileWriterFormat::Packed;
+    ASSERT_TRUE(writer.setProperties(properties) == QS_SUCCESS);
+    BufferMappings mappings = simulatedMappings(smallSize);
+    fillBuffers(0, smallSize);
+    ASSERT_TRUE(writer.writeBuffers(buffers_, mappings, 0, false) ==
+                QS_SUCCESS);
+  }
+  std::vector<std::string> names;
+  std::vector<qaic::openrt::FileWriter::PackedEntry> entries;
+  ASSERT_TRUE(qaic::openrt::FileWriter::readPackedIndex(path, names,
+                                                        entries) == QS_SUCCESS);
+  ASSERT_TRUE(entries.size() == 2);
+  const std::vector<uint8_t> good = readFile(path);
+  auto corrupt = [&](size_t offset, uint64_t value) {
+    std::vector<uint8_t> bad = good;
+    std::memcpy(bad.data() + offset, &value, sizeof(value));
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char *>(bad.data()), bad.size());
+  };
+  qaic::openrt::FileWriter::PackedHeader header;
+  std::memcpy(&header, good.data(), sizeof(header));
+  const size_t entry = header.indexOffset;
+
+  // Entry count beyond the file
+  corrupt(offsetof(qaic::openrt::FileWriter::PackedHeader, numEntries),
+          uint64_t{1} << 40);
+  ASSERT_TRUE(qaic::openrt::FileWriter::readPackedIndex(path, names,
+                                                        entries) == QS_ERROR);
+  // Output past the index
+  corrupt(entry + offsetof(qaic::openrt::FileWriter::PackedEntry, size),
+          good.size());
+  ASSERT_TRUE(qaic::openrt::FileWriter::readPackedIndex(path, names,
+                                                        entries) == QS_ERROR);
+  // Output in the header block
+  corrupt(entry + offsetof(qaic::openrt::FileWriter::PackedEntry, offset), 0);
+  ASSERT_TRUE(qaic::openrt::FileWriter::readPackedIndex(path, names,
+                                                        entries) == QS_ERROR);
+  // Truncated name table
+  corrupt(0, header.magic | (uint64_t{header.formatVersion} << 32));
+  ASSERT_TRUE(qaic::openrt::FileWriter::readPackedIndex(path, names,
+                                                        entries) == QS_SUCCESS);
+  std::filesystem::resize_file(path, good.size() - 1);
+  ASSERT_TRUE(qaic::openrt::FileWriter::readPackedIndex(path, names,
+                                                        entries) == QS_ERROR);
+  ASSERT_TRUE(qaic::openrt::FileWriter::readPackedIndex(
+                  dir_ + "/missing.qout", names, entries) == QS_ERROR);
+}
+
+//------------------------------------------------------------------
+// Test Program
+//------------------------------------------------------------------
+TEST_F(QAicOpenRtFileWriterUnitTest, FileWriterPerFileTest) {
+  FileWriterPerFileTest(false);
+}
+
+TEST_F(QAicOpenRtFileWriterUnitTest, FileWriterAsyncPerFileTest) {
+  FileWriterPerFileTest(true);
+}
+
+TEST_F(QAicOpenRtFileWriterUnitTest, FileWriterPackedTest) {
+  FileWriterPackedTest(false, false);
+}
+
+TEST_F(QAicOpenRtFileWriterUnitTest, FileWriterAsyncPackedTest) {
+  FileWriterPackedTest(true, false);
+}
+
+TEST_F(QAicOpenRtFileWriterUnitTest, FileWriterAsyncPackedDirectIoTest) {
+  FileWriterPackedTest(true, true);
+}
+
+TEST_F(QAicOpenRtFileWriterUnitTest, FileWriterBackPressureTest) {
+  FileWriterBackPressureTest();
+}
+
+TEST_F(QAicOpenRtFileWriterUnitTest, AdversarialFileWriterFailedWriteTest) {
+  FileWriterFailedWriteTest();
+}
+
+TEST_F(QAicOpenRtFileWriterUnitTest, AdversarialFileWriterCorruptPackedTest) {
+  FileWriterCorruptPackedTest();
+}
+
+} // namespace QAicOpenRtUnitTest
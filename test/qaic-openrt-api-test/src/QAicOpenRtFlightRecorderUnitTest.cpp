@@ -0,0 +1,359 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QFlightRecorder.h"
+#include "QOsal.h"
+
+#include <csignal>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::QFlightDump;
+using qaic::QFlightEvent;
+using qaic::QFlightEventType;
+using qaic::QFlightRecorder;
+
+class QAicOpenRtFlightRecorderUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtFlightRecorderUnitTest(){};
+  ~QAicOpenRtFlightRecorderUnitTest() = default;
+
+  QAicOpenRtFlightRecorderUnitTest(const QAicOpenRtFlightRecorderUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtFlightRecorderUnitTest &
+  operator=(const QAicOpenRtFlightRecorderUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void SetUp() override {
+    char dir[] = "/tmp/qaic-flight-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    dir_ = dir;
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  void RecordDecodeTest();
+  void WrapTest();
+  void MultiThreadTest();
+  void SignalDumpTest();
+  void DecodeTest();
+  void DumpFileTest();
+
+  std::string dumpPath(const std::string &name) const {
+    return dir_ + "/" + name + ".bin";
+  }
+
+  std::string dir_;
+};
+
+void QAicOpenRtFlightRecorderUnitTest::RecordDecodeTest() {
+  QFlightRecorder recorder(64);
+  const uint64_t before = QFlightRecorder::now();
+  recorder.record(QFlightEventType::Submit, 1, 2, 17);
+  recorder.record(QFlightEventType::SubmitAgain, 1, 2, 1);
+  recorder.record(QFlightEventType::WaitEnd, 1, 17, QS_SUCCESS);
+  recorder.recordText(QFlightEventType::StateEnter, 1,
+                      "activated_full_super");
+  recorder.record(QFlightEventType::Ioctl, 0xc0104403, -1, EAGAIN);
+
+  const std::string path = dumpPath(testName());
+  ASSERT_EQ(recorder.dump(path, "request"), QS_SUCCESS);
+  QFlightDump dump;
+  ASSERT_EQ(QFlightRecorder::decode(path, dump), QS_SUCCESS);
+  ASSERT_EQ(dump.pid, getpid());
+  ASSERT_EQ(dump.reason, "request");
+  ASSERT_GE(dump.monotonicNs, before);
+  ASSERT_NE(dump.realtimeNs, 0u);
+  ASSERT_EQ(dump.threads.size(), 1u);
+  ASSERT_EQ(dump.threads[0].tid,
+            static_cast<uint32_t>(qaic::QOsal::getPid()));
+  ASSERT_EQ(dump.threads[0].numLost, 0u);
+
+  const auto &events = dump.threads[0].events;
+  ASSERT_EQ(events.size(), 5u);
+  ASSERT_EQ(events[0].type, QFlightEventType::Submit);
+  ASSERT_EQ(events[0].id, 1u);
+  ASSERT_EQ(events[0].arg0, 2u);
+  ASSERT_EQ(events[0].arg1, 17u);
+  for (size_t i = 1; i < events.size(); i++) {
+    ASSERT_GE(events[i].timeNs, events[i - 1].timeNs);
+  }
+  ASSERT_LE(events.back().timeNs, dump.monotonicNs);
+
+  // Text is cut at 16 characters
+  ASSERT_EQ(QFlightRecorder::format(events[3]),
+            "StateEnter id 1 activated_full_s");
+  ASSERT_EQ(QFlightRecorder::format(events[2]),
+            "WaitEnd qid 1 handle 17 SUCCESS");
+  ASSERT_EQ(QFlightRecorder::format(events[4]),
+            "Ioctl req 0xc0104403 rc -1 errno " + std::to_string(EAGAIN));
+
+  std::ostringstream os;
+  QFlightRecorder::print(dump, os);
+  ASSERT_NE(os.str().find("reason request"), std::string::npos);
+  ASSERT_NE(os.str().find("SubmitAgain qid 1 vc 2 retry 1"),
+            std::string::npos);
+}
+
+void QAicOpenRtFlightRecorderUnitTest::WrapTest() {
+  QFlightRecorder recorder(16);
+  for (uint64_t i = 0; i < 100; i++) {
+    recorder.record(QFlightEventType::Mark, 0, i);
+  }
+  const std::string path = dumpPath(testName());
+  ASSERT_EQ(recorder.dump(path, "wrap"), QS_SUCCESS);
+  QFlightDump dump;
+  ASSERT_EQ(QFlightRecorder::decode(path, dump), QS_SUCCESS);
+  ASSERT_EQ(dump.threads.size(), 1u);
+
+  // The latest events are kept, oldest first. The slot a thread may be
+  // writing during the dump is left out.
+  const auto &events = dump.threads[0].events;
+  ASSERT_EQ(events.size(), 15u);
+  ASSERT_EQ(dump.threads[0].numLost, 0u);
+  for (size_t i = 0; i < events.size(); i++) {
+    ASSERT_EQ(events[i].arg0, 85 + i);
+  }
+
+  // Sizes are rounded up to a power of two
+  QFlightRecorder rounded(20);
+  for (uint64_t i = 0; i < 100; i++) {
+    rounded.record(QFlightEventType::Mark, 0, i);
+  }
+  const std::string roundedPath = dumpPath(testName() + "Rounded");
+  ASSERT_EQ(rounded.dump(roundedPath, "wrap"), QS_SUCCESS);
+  ASSERT_EQ(QFlightRecorder::decode(roundedPath, dump), QS_SUCCESS);
+  ASSERT_EQ(dump.threads[0].events.size(), 31u);
+  ASSERT_EQ(dump.threads[0].events.front().arg0, 69u);
+}
+
+void QAicOpenRtFlightRecorderUnitTest::MultiThreadTest() {
+  QFlightRecorder recorder(256);
+  constexpr uint32_t numThreads = 4;
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < numThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (uint64_t seq = 0; !stop; seq++) {
+        recorder.record(QFlightEventType::Mark, t, seq, ~seq);
+      }
+    });
+  }
+
+  // Dumps while the threads record. Events are whole and in order, the
+  // ones overwritten while dumped are counted as lost.
+  const std::string path = dumpPath(testName());
+  for (int i = 0; i < 20; i++) {
+    std::filesystem::remove(path);
+    ASSERT_EQ(recorder.dump(path, "concurrent"), QS_SUCCESS);
+    QFlightDump dump;
+    ASSERT_EQ(QFlightRecorder::decode(path, dump), QS_SUCCESS);
+    for (const auto &thread : dump.threads) {
+      ASSERT_LT(thread.events.size() + thread.numLost, 256u);
+      for (size_t e = 0; e < thread.events.size(); e++) {
+        const QFlightEvent &event = thread.events[e];
+        ASSERT_EQ(event.id, thread.events.front().id);
+        ASSERT_EQ(event.arg1, ~event.arg0);
+        if (e > 0) {
+          ASSERT_EQ(event.arg0, thread.events[e - 1].arg0 + 1);
+        }
+      }
+    }
+  }
+  stop = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Rings of exited threads are reused, without their events
+  std::thread([&]() {
+    recorder.record(QFlightEventType::Mark, 100, 1, ~1ull);
+  }).join();
+  std::filesystem::remove(path);
+  ASSERT_EQ(recorder.dump(path, "reuse"), QS_SUCCESS);
+  QFlightDump dump;
+  ASSERT_EQ(QFlightRecorder::decode(path, dump), QS_SUCCESS);
+  ASSERT_EQ(dump.threads.size(), numThreads);
+  uint32_t numReused = 0;
+  for (const auto &thread : dump.threads) {
+    if ((thread.events.size() == 1) && (thread.events[0].id == 100)) {
+      numReused++;
+    }
+  }
+  ASSERT_EQ(numReused, 1u);
+}
+
+void QAicOpenRtFlightRecorderUnitTest::SignalDumpTest() {
+  struct sigaction previous {};
+  ASSERT_EQ(sigaction(SIGUSR2, nullptr, &previous), 0);
+  {
+    QFlightRecorder recorder(64);
+    ASSERT_EQ(recorder.setDumpDir(dir_), QS_SUCCESS);
+    ASSERT_EQ(recorder.installSignalHandler(SIGUSR2), QS_SUCCESS);
+    QFlightRecorder other(64);
+    ASSERT_EQ(other.installSignalHandler(SIGUSR1), QS_BUSY);
+
+    recorder.record(QFlightEventType::Error, 3);
+    ASSERT_EQ(raise(SIGUSR2), 0);
+    std::string path;
+    ASSERT_EQ(recorder.dumpToDir("request", &path), QS_SUCCESS);
+
+    // The signal wrote the first file of the directory
+    const std::string prefix =
+        dir_ + "/qaic-flight-" + std::to_string(getpid()) + "-";
+    ASSERT_EQ(path, prefix + "1.bin");
+    QFlightDump dump;
+    ASSERT_EQ(QFlightRecorder::decode(prefix + "0.bin", dump), QS_SUCCESS);
+    ASSERT_EQ(dump.reason, "signal");
+    ASSERT_EQ(dump.threads.size(), 1u);
+    ASSERT_EQ(dump.threads[0].events.size(), 1u);
+    ASSERT_EQ(dump.threads[0].events[0].type, QFlightEventType::Error);
+  }
+
+  // The previous handler is back
+  struct sigaction restored {};
+  ASSERT_EQ(sigaction(SIGUSR2, nullptr, &restored), 0);
+  ASSERT_EQ(restored.sa_handler, previous.sa_handler);
+}
+
+void QAicOpenRtFlightRecorderUnitTest::DecodeTest() {
+  QFlightDump dump;
+  ASSERT_EQ(QFlightRecorder::decode(dumpPath("missing"), dump), QS_ERROR);
+
+  QFlightRecorder recorder(64);
+  recorder.record(QFlightEventType::Submit, 0, 1, 2);
+  const std::string path = dumpPath(testName());
+  ASSERT_EQ(recorder.dump(path, "decode"), QS_SUCCESS);
+  std::string valid;
+  {
+    std::ifstream ifs(path, std::ios::binary);
+    valid.assign(std::istreambuf_iterator<char>(ifs),
+                 std::istreambuf_iterator<char>());
+  }
+  auto decodeBytes = [&](const std::string &bytes) {
+    const std::string corrupt = dumpPath("corrupt");
+    std::ofstream(corrupt, std::ios::binary) << bytes;
+    QFlightDump decoded;
+    return QFlightRecorder::decode(corrupt, decoded);
+  };
+  ASSERT_EQ(decodeBytes(valid), QS_SUCCESS);
+
+  // Not a dump, another version, truncated anywhere
+  std::string changed = valid;
+  changed[0] = 'X';
+  ASSERT_EQ(decodeBytes(changed), QS_INVAL);
+  changed = valid;
+  changed[8]++;
+  ASSERT_EQ(decodeBytes(changed), QS_INVAL);
+  ASSERT_EQ(decodeBytes(""), QS_INVAL);
+  for (size_t size = 1; size < valid.size(); size += 7) {
+    ASSERT_EQ(decodeBytes(valid.substr(0, size)), QS_INVAL) << size;
+  }
+
+  // A ring claiming more events than it holds
+  changed = valid;
+  changed[112 + 4] = static_cast<char>(0xff);
+  ASSERT_EQ(decodeBytes(changed), QS_INVAL);
+
+  // Nothing is recorded while disabled
+  QFlightRecorder disabled(64);
+  disabled.setEnabled(false);
+  disabled.record(QFlightEventType::Submit, 0);
+  disabled.recordText(QFlightEventType::Mark, 0, "disabled");
+  std::filesystem::remove(path);
+  ASSERT_EQ(disabled.dump(path, "disabled"), QS_SUCCESS);
+  ASSERT_EQ(QFlightRecorder::decode(path, dump), QS_SUCCESS);
+  ASSERT_TRUE(dump.threads.empty());
+
+  ASSERT_EQ(recorder.setDumpDir(std::string(300, 'd')), QS_INVAL);
+  ASSERT_EQ(recorder.dump(dir_ + "/missing/dump.bin", "missing"), QS_ERROR);
+}
+
+void QAicOpenRtFlightRecorderUnitTest::DumpFileTest() {
+  QFlightRecorder recorder(64);
+  recorder.record(QFlightEventType::Error, 5);
+  struct stat st;
+
+  // Dumps are for the user only, by default in a directory of their own
+  std::string path;
+  ASSERT_EQ(recorder.dumpToDir("private", &path), QS_SUCCESS);
+  const std::string privateDir =
+      "/tmp/qaic-flight-" + std::to_string(geteuid());
+  ASSERT_EQ(path.rfind(privateDir + "/qaic-flight-", 0), 0u) << path;
+  ASSERT_EQ(lstat(privateDir.c_str(), &st), 0);
+  ASSERT_TRUE(S_ISDIR(st.st_mode));
+  ASSERT_EQ(st.st_mode & 0777, static_cast<mode_t>(0700));
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  ASSERT_EQ(st.st_mode & 0777, static_cast<mode_t>(0600));
+  std::filesystem::remove(path);
+
+  // Not once others can get to it
+  ASSERT_EQ(chmod(privateDir.c_str(), 0755), 0);
+  const QStatus sharedStatus = recorder.dumpToDir("shared");
+  ASSERT_EQ(chmod(privateDir.c_str(), 0700), 0);
+  ASSERT_EQ(sharedStatus, QS_ERROR);
+
+  const std::string file = dumpPath(testName());
+  ASSERT_EQ(recorder.dump(file, "file"), QS_SUCCESS);
+  ASSERT_EQ(stat(file.c_str(), &st), 0);
+  ASSERT_EQ(st.st_mode & 0777, static_cast<mode_t>(0600));
+
+  // Files are not overwritten, nor are links followed
+  ASSERT_EQ(recorder.dump(file, "again"), QS_ERROR);
+  QFlightDump dump;
+  ASSERT_EQ(QFlightRecorder::decode(file, dump), QS_SUCCESS);
+  ASSERT_EQ(dump.reason, "file");
+  const std::string target = dumpPath("target");
+  std::ofstream(target) << "kept";
+  const std::string link = dumpPath("link");
+  ASSERT_EQ(symlink(target.c_str(), link.c_str()), 0);
+  ASSERT_EQ(recorder.dump(link, "link"), QS_ERROR);
+
+  // Names taken in the dump directory are skipped
+  ASSERT_EQ(recorder.setDumpDir(dir_), QS_SUCCESS);
+  const std::string prefix =
+      dir_ + "/qaic-flight-" + std::to_string(getpid()) + "-";
+  ASSERT_EQ(symlink(target.c_str(), (prefix + "0.bin").c_str()), 0);
+  ASSERT_EQ(recorder.dumpToDir("skip", &path), QS_SUCCESS);
+  ASSERT_EQ(path, prefix + "1.bin");
+  std::string kept;
+  std::ifstream(target) >> kept;
+  ASSERT_EQ(kept, "kept");
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtFlightRecorderUnitTest, RecordDecodeTest) {
+  RecordDecodeTest();
+}
+
+TEST_F(QAicOpenRtFlightRecorderUnitTest, WrapTest) { WrapTest(); }
+
+TEST_F(QAicOpenRtFlightRecorderUnitTest, MultiThreadTest) {
+  MultiThreadTest();
+}
+
+TEST_F(QAicOpenRtFlightRecorderUnitTest, SignalDumpTest) { SignalDumpTest(); }
+
+TEST_F(QAicOpenRtFlightRecorderUnitTest, AdversarialDecodeTest) {
+  DecodeTest();
+}
+
+TEST_F(QAicOpenRtFlightRecorderUnitTest, AdversarialDumpFileTest) {
+  DumpFileTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,270 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicOpenRtInputFill.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtInputFillUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtInputFillUnitTest(){};
+  ~QAicOpenRtInputFillUnitTest() = default;
+
+  QAicOpenRtInputFillUnitTest(const QAicOpenRtInputFillUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtInputFillUnitTest &
+  operator=(const QAicOpenRtInputFillUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  // Several chunks per input and a partial block at the end
+  static constexpr size_t numElements = (3 << 20) + 77;
+
+  void InputFillGeneratorTest();
+  void InputFillDeterministicTest();
+  void InputFillDataTypeTest();
+  void InputFillPatternTest();
+  void InputFillInvalidTest();
+
+  struct Inputs {
+    std::vector<float> fp32;
+    std::vector<uint16_t> fp16;
+    std::vector<int8_t> i8q;
+    std::vector<int64_t> i64;
+    std::vector<uint8_t> output;
+    std::vector<QBuffer> buffers;
+  };
+
+  BufferMappings simulatedMappings();
+  void allocate(Inputs &inputs, size_t count);
+  template <typename T> QBuffer toBuffer(std::vector<T> &data);
+};
+
+BufferMappings QAicOpenRtInputFillUnitTest::simulatedMappings() {
+  BufferMappings mappings;
+  const std::vector<std::pair<const char *, QAicBufferDataTypeEnum>> inputs =
+      {{"fp32", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT},
+       {"fp16", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT16},
+       {"i8q", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8Q},
+       {"i64", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT64I}};
+  uint32_t index = 0;
+  for (const auto &input : inputs) {
+    mappings.emplace_back(input.first, index++,
+                          QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT, 0, false,
+                          input.second);
+  }
+  mappings.emplace_back("output", index,
+                        QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT, 0, false,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  return mappings;
+}
+
+template <typename T>
+QBuffer QAicOpenRtInputFillUnitTest::toBuffer(std::vector<T> &data) {
+  QBuffer buffer{};
+  buffer.buf = reinterpret_cast<uint8_t *>(data.data());
+  buffer.size = data.size() * sizeof(T);
+  buffer.type = QBufferType::QBUFFER_TYPE_HEAP;
+  return buffer;
+}
+
+void QAicOpenRtInputFillUnitTest::allocate(Inputs &inputs, size_t count) {
+  inputs.fp32.assign(count, 0.0f);
+  inputs.fp16.assign(count, 0);
+  inputs.i8q.assign(count, 0);
+  inputs.i64.assign(count, 0);
+  inputs.output.assign(count, 0xa5);
+  inputs.buffers = {toBuffer(inputs.fp32), toBuffer(inputs.fp16),
+                    toBuffer(inputs.i8q), toBuffer(inputs.i64),
+                    toBuffer(inputs.output)};
+}
+
+void QAicOpenRtInputFillUnitTest::InputFillGeneratorTest() {
+  // Known answer of Philox4x32-10 for a zero counter and key
+  uint32_t words[4];
+  qaic::openrt::InputFill::philox(0, 1, 0, 0, words);
+  ASSERT_EQ(words[0], 0x6627e8d5u);
+  ASSERT_EQ(words[1], 0xe169c58du);
+  ASSERT_EQ(words[2], 0xbc57ac4cu);
+  ASSERT_EQ(words[3], 0x9b00dbd8u);
+
+  // Counters of a block match counters generated one at a time
+  std::vector<uint32_t> block(4 * qaic::openrt::InputFill::blockCounters);
+  qaic::openrt::InputFill::philox(1000, qaic::openrt::InputFill::blockCounters,
+                                  7, 0x123456789abcdefULL, block.data());
+  for (size_t i = 0; i < qaic::openrt::InputFill::blockCounters; i++) {
+    qaic::openrt::InputFill::philox(1000 + i, 1, 7, 0x123456789abcdefULL,
+                                    words);
+    ASSERT_EQ(std::memcmp(words, &block[4 * i], sizeof(words)), 0);
+  }
+
+  ASSERT_EQ(qaic::openrt::InputFill::floatToHalf(1.0f), 0x3c00);
+  ASSERT_EQ(qaic::openrt::InputFill::floatToHalf(-2.0f), 0xc000);
+  ASSERT_EQ(qaic::openrt::InputFill::floatToHalf(0.0f), 0x0000);
+  ASSERT_EQ(qaic::openrt::InputFill::floatToHalf(65504.0f), 0x7bff);
+  // Rounds to nearest even, overflows to infinity
+  ASSERT_EQ(qaic::openrt::InputFill::floatToHalf(1.0f + 0x1p-11f), 0x3c00);
+  ASSERT_EQ(qaic::openrt::InputFill::floatToHalf(1.0f + 0x1p-10f), 0x3c01);
+  ASSERT_EQ(qaic::openrt::InputFill::floatToHalf(65520.0f), 0x7c00);
+  // Smallest subnormal
+  ASSERT_EQ(qaic::openrt::InputFill::floatToHalf(0x1p-24f), 0x0001);
+  ASSERT_EQ(qaic::openrt::InputFill::floatToHalf(NAN) & 0x7e00, 0x7e00);
+}
+
+void QAicOpenRtInputFillUnitTest::InputFillDeterministicTest() {
+  qaic::openrt::InputFillProperties properties;
+  properties.seed = 42;
+  properties.numThreads = 1;
+  Inputs single;
+  allocate(single, numElements);
+  auto fill = qaic::openrt::InputFill::Factory(simulatedMappings(), properties);
+  ASSERT_EQ(fill->setQuantization("i8q", 0.01f, 3), QS_SUCCESS);
+  ASSERT_EQ(fill->fill(single.buffers), QS_SUCCESS);
+
+  // The split across threads does not change the values
+  properties.numThreads = 5;
+  Inputs parallel;
+  allocate(parallel, numElements);
+  fill = qaic::openrt::InputFill::Factory(simulatedMappings(), properties);
+  ASSERT_EQ(fill->setQuantization("i8q", 0.01f, 3), QS_SUCCESS);
+  ASSERT_EQ(fill->fill(parallel.buffers), QS_SUCCESS);
+  ASSERT_EQ(single.fp32, parallel.fp32);
+  ASSERT_EQ(single.fp16, parallel.fp16);
+  ASSERT_EQ(single.i8q, parallel.i8q);
+  ASSERT_EQ(single.i64, parallel.i64);
+
+  properties.seed = 43;
+  Inputs reseeded;
+  allocate(reseeded, numElements);
+  fill = qaic::openrt::InputFill::Factory(simulatedMappings(), properties);
+  ASSERT_EQ(fill->fill(reseeded.buffers), QS_SUCCESS);
+  ASSERT_NE(single.fp32, reseeded.fp32);
+  ASSERT_NE(single.i64, reseeded.i64);
+}
+
+void QAicOpenRtInputFillUnitTest::InputFillDataTypeTest() {
+  qaic::openrt::InputFillProperties properties;
+  properties.minValue = -2.0f;
+  properties.maxValue = 3.0f;
+  properties.indexLimit = 1000;
+  Inputs inputs;
+  allocate(inputs, numElements);
+  auto fill = qaic::openrt::InputFill::Factory(simulatedMappings(), properties);
+  // Reals in [-2, 3) quantize to [-90, 160], clamped to 127
+  ASSERT_EQ(fill->setQuantization("i8q", 0.02f, 10), QS_SUCCESS);
+  ASSERT_EQ(fill->fill(inputs.buffers), QS_SUCCESS);
+
+  double sum = 0.0;
+  for (size_t i = 0; i < numElements; i++) {
+    ASSERT_TRUE(std::isfinite(inputs.fp32[i]));
+    ASSERT_GE(inputs.fp32[i], -2.0f);
+    ASSERT_LE(inputs.fp32[i], 3.0f);
+    sum += inputs.fp32[i];
+    // Finite halves of magnitude at most 3.0
+    ASSERT_LE(inputs.fp16[i] & 0x7fff, 0x4200);
+    ASSERT_GE(inputs.i8q[i], -90);
+    ASSERT_GE(inputs.i64[i], 0);
+    ASSERT_LT(inputs.i64[i], 1000);
+  }
+  // Uniform over the range
+  ASSERT_NEAR(sum / numElements, 0.5, 0.01);
+  ASSERT_NE(*std::min_element(inputs.i8q.begin(), inputs.i8q.end()),
+            *std::max_element(inputs.i8q.begin(), inputs.i8q.end()));
+  // Outputs are not inputs
+  ASSERT_EQ(std::count(inputs.output.begin(), inputs.output.end(), 0xa5),
+            static_cast<long>(numElements));
+}
+
+void QAicOpenRtInputFillUnitTest::InputFillPatternTest() {
+  qaic::openrt::InputFillProperties properties;
+  properties.pattern = qaic::openrt::InputFillPattern::Ramp;
+  Inputs inputs;
+  allocate(inputs, 1000);
+  auto fill = qaic::openrt::InputFill::Factory(simulatedMappings(), properties);
+  ASSERT_EQ(fill->fill(inputs.buffers), QS_SUCCESS);
+  for (size_t i = 0; i < 1000; i++) {
+    ASSERT_FLOAT_EQ(inputs.fp32[i], -1.0f + (i % 256) / 128.0f);
+    ASSERT_EQ(inputs.i8q[i], static_cast<int8_t>(i % 256));
+    ASSERT_EQ(inputs.i64[i], static_cast<int64_t>(i % 256));
+  }
+
+  properties.pattern = qaic::openrt::InputFillPattern::RandomBytes;
+  fill = qaic::openrt::InputFill::Factory(simulatedMappings(), properties);
+  ASSERT_EQ(fill->fill(inputs.buffers), QS_SUCCESS);
+  // Index inputs get any 64 bit value
+  ASSERT_TRUE(std::any_of(inputs.i64.begin(), inputs.i64.end(),
+                          [](int64_t v) { return v < 0 || v >= 256; }));
+
+  properties.pattern = qaic::openrt::InputFillPattern::Zero;
+  fill = qaic::openrt::InputFill::Factory(simulatedMappings(), properties);
+  ASSERT_EQ(fill->fill(inputs.buffers), QS_SUCCESS);
+  ASSERT_TRUE(std::all_of(inputs.fp32.begin(), inputs.fp32.end(),
+                          [](float v) { return v == 0.0f; }));
+  ASSERT_TRUE(std::all_of(inputs.i64.begin(), inputs.i64.end(),
+                          [](int64_t v) { return v == 0; }));
+}
+
+void QAicOpenRtInputFillUnitTest::InputFillInvalidTest() {
+  qaic::openrt::InputFillProperties properties;
+  properties.minValue = 1.0f;
+  properties.maxValue = 1.0f;
+  ASSERT_THROW(
+      qaic::openrt::InputFill::Factory(simulatedMappings(), properties),
+      qaic::openrt::CoreExceptionInit);
+  properties.maxValue = INFINITY;
+  ASSERT_THROW(
+      qaic::openrt::InputFill::Factory(simulatedMappings(), properties),
+      qaic::openrt::CoreExceptionInit);
+  properties = qaic::openrt::InputFillProperties();
+  properties.indexLimit = 0;
+  ASSERT_THROW(
+      qaic::openrt::InputFill::Factory(simulatedMappings(), properties),
+      qaic::openrt::CoreExceptionInit);
+  ASSERT_THROW(qaic::openrt::InputFill::Factory(qaic::openrt::shProgram()),
+               qaic::openrt::CoreExceptionInit);
+
+  auto fill = qaic::openrt::InputFill::Factory(simulatedMappings());
+  ASSERT_EQ(fill->setQuantization("missing", 1.0f, 0), QS_INVAL);
+  ASSERT_EQ(fill->setQuantization("output", 1.0f, 0), QS_INVAL);
+  ASSERT_EQ(fill->setQuantization("i8q", -1.0f, 0), QS_INVAL);
+
+  Inputs inputs;
+  allocate(inputs, 16);
+  inputs.buffers.resize(2);
+  ASSERT_EQ(fill->fill(inputs.buffers), QS_INVAL);
+  allocate(inputs, 16);
+  inputs.buffers.at(1).buf = nullptr;
+  ASSERT_EQ(fill->fill(inputs.buffers), QS_INVAL);
+}
+
+//------------------------------------------------------------------
+// Test Program
+//------------------------------------------------------------------
+TEST_F(QAicOpenRtInputFillUnitTest, InputFillGeneratorTest) {
+  InputFillGeneratorTest();
+}
+
+TEST_F(QAicOpenRtInputFillUnitTest, InputFillDeterministicTest) {
+  InputFillDeterministicTest();
+}
+
+TEST_F(QAicOpenRtInputFillUnitTest, InputFillDataTypeTest) {
+  InputFillDataTypeTest();
+}
+
+TEST_F(QAicOpenRtInputFillUnitTest, InputFillPatternTest) {
+  InputFillPatternTest();
+}
+
+TEST_F(QAicOpenRtInputFillUnitTest, AdversarialInputFillInvalidTest) {
+  InputFillInvalidTest();
+}
+
+} // namespace QAicOpenRtUnitTest
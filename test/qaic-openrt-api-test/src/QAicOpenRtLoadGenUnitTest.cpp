@@ -0,0 +1,286 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicOpenRtLoadGen.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtLoadGenUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtLoadGenUnitTest(){};
+  ~QAicOpenRtLoadGenUnitTest() = default;
+
+  QAicOpenRtLoadGenUnitTest(const QAicOpenRtLoadGenUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtLoadGenUnitTest &
+  operator=(const QAicOpenRtLoadGenUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void LoadGenUnderloadTest();
+  void LoadGenOverloadTest();
+  void LoadGenPoissonTest();
+  void LoadGenTraceTest();
+  void LoadGenFailureTest();
+  void LoadGenInvalidPropertiesTest();
+
+  qaic::openrt::LoadGenExecFunction
+  simulatedBackend(std::chrono::microseconds serviceTime);
+
+  std::atomic<uint32_t> numCalls_{0};
+};
+
+// The simulated backend takes a known service time per request
+qaic::openrt::LoadGenExecFunction QAicOpenRtLoadGenUnitTest::simulatedBackend(
+    std::chrono::microseconds serviceTime) {
+  return [this, serviceTime]() -> QStatus {
+    numCalls_++;
+    std::this_thread::sleep_for(serviceTime);
+    return QS_SUCCESS;
+  };
+}
+
+void QAicOpenRtLoadGenUnitTest::LoadGenUnderloadTest() {
+  constexpr auto serviceTime = std::chrono::milliseconds(2);
+  qaic::openrt::LoadGenProperties properties;
+  properties.arrival = qaic::openrt::LoadGenArrival::FixedRate;
+  properties.rate = 200;
+  properties.warmup = std::chrono::milliseconds(100);
+  properties.duration = std::chrono::milliseconds(500);
+  qaic::openrt::shLoadGen loadGen = qaic::openrt::LoadGen::Factory(
+      properties,
+      {simulatedBackend(serviceTime), simulatedBackend(serviceTime)});
+  ASSERT_TRUE(loadGen != nullptr);
+
+  qaic::openrt::LoadGenReport report;
+  ASSERT_TRUE(loadGen->run(report) == QS_SUCCESS);
+
+  // Warm-up requests run but are not reported
+  ASSERT_TRUE(numCalls_ == 120);
+  ASSERT_TRUE(report.numOffered == 100);
+  ASSERT_TRUE(report.numCompleted == 100);
+  ASSERT_TRUE(report.numFailed == 0);
+  ASSERT_TRUE(report.numMissed == 0);
+  ASSERT_NEAR(report.windowSec, 0.5, 1e-6);
+  ASSERT_NEAR(report.offeredRate, 200, 1e-6);
+
+  // Well below capacity the target keeps up with the offered rate
+  ASSERT_TRUE(report.achievedRate >= 0.9 * report.offeredRate);
+  ASSERT_TRUE(report.achievedRate <= report.offeredRate);
+  ASSERT_TRUE(report.serviceTime.p50Us >= 2000);
+  ASSERT_TRUE(report.latency.p50Us >= report.serviceTime.p50Us);
+  ASSERT_TRUE(report.latency.p50Us <= report.latency.p90Us);
+  ASSERT_TRUE(report.latency.p90Us <= report.latency.p99Us);
+  ASSERT_TRUE(report.latency.p99Us <= report.latency.p999Us);
+  ASSERT_TRUE(report.latency.p999Us <= report.latency.maxUs);
+}
+
+void QAicOpenRtLoadGenUnitTest::LoadGenOverloadTest() {
+  constexpr auto serviceTime = std::chrono::milliseconds(10);
+  qaic::openrt::LoadGenProperties properties;
+  properties.arrival = qaic::openrt::LoadGenArrival::FixedRate;
+  properties.rate = 500;
+  properties.duration = std::chrono::milliseconds(500);
+  qaic::openrt::shLoadGen loadGen = qaic::openrt::LoadGen::Factory(
+      properties, {simulatedBackend(serviceTime)});
+  ASSERT_TRUE(loadGen != nullptr);
+
+  qaic::openrt::LoadGenReport report;
+  ASSERT_TRUE(loadGen->run(report) == QS_SUCCESS);
+
+  // A single backend serves at most 100 requests per second
+  ASSERT_TRUE(report.numOffered == 250);
+  ASSERT_TRUE(report.numOffered ==
+              report.numCompleted + report.numFailed + report.numMissed);
+  ASSERT_TRUE(report.numMissed >= 150);
+  ASSERT_TRUE(report.achievedRate <= 110);
+
+  // The queue in front of the backend shows up in the latency while the
+  // service time stays put
+  ASSERT_TRUE(report.serviceTime.p50Us >= 10000);
+  ASSERT_TRUE(report.serviceTime.p50Us < 100000);
+  ASSERT_TRUE(report.latency.p99Us > 200000);
+  ASSERT_TRUE(report.latency.maxUs > 10 * report.serviceTime.p50Us);
+}
+
+void QAicOpenRtLoadGenUnitTest::LoadGenPoissonTest() {
+  qaic::openrt::LoadGenProperties properties;
+  properties.arrival = qaic::openrt::LoadGenArrival::Poisson;
+  properties.rate = 1000;
+  properties.duration = std::chrono::seconds(1000);
+  properties.seed = 7;
+
+  constexpr uint32_t numArrivals = 100000;
+  qaic::openrt::LoadGenSchedule schedule(properties);
+  std::vector<double> gaps;
+  std::chrono::nanoseconds last(0);
+  std::chrono::nanoseconds offset(0);
+  ASSERT_TRUE(schedule.next(offset));
+  ASSERT_TRUE(offset.count() == 0);
+  for (uint32_t i = 0; i < numArrivals; i++) {
+    ASSERT_TRUE(schedule.next(offset));
+    ASSERT_TRUE(offset >= last);
+    gaps.push_back(static_cast<double>((offset - last).count()) / 1e9);
+    last = offset;
+  }
+
+  // Exponential gaps have a standard deviation equal to their mean
+  double sum = 0;
+  for (double gap : gaps) {
+    sum += gap;
+  }
+  const double mean = sum / gaps.size();
+  double var = 0;
+  for (double gap : gaps) {
+    var += (gap - mean) * (gap - mean);
+  }
+  const double stddev = std::sqrt(var / gaps.size());
+  ASSERT_NEAR(mean, 1.0 / properties.rate, 0.03 / properties.rate);
+  ASSERT_NEAR(stddev, mean, 0.05 * mean);
+
+  // Equal seeds send at equal times
+  qaic::openrt::LoadGenSchedule first(properties);
+  qaic::openrt::LoadGenSchedule replay(properties);
+  properties.seed = 8;
+  qaic::openrt::LoadGenSchedule other(properties);
+  std::chrono::nanoseconds a;
+  std::chrono::nanoseconds b;
+  std::chrono::nanoseconds c;
+  bool differs = false;
+  for (uint32_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(first.next(a) && replay.next(b) && other.next(c));
+    ASSERT_TRUE(a == b);
+    differs |= (a != c);
+  }
+  ASSERT_TRUE(differs);
+}
+
+void QAicOpenRtLoadGenUnitTest::LoadGenTraceTest() {
+  std::istringstream is("# send times in us\n1000\n1500\n1500\n\n4000\r\n");
+  std::vector<std::chrono::microseconds> trace;
+  ASSERT_TRUE(qaic::openrt::LoadGen::parseTrace(is, trace) == QS_SUCCESS);
+  const std::vector<std::chrono::microseconds> expected{
+      std::chrono::microseconds(0), std::chrono::microseconds(500),
+      std::chrono::microseconds(500), std::chrono::microseconds(3000)};
+  ASSERT_TRUE(trace == expected);
+
+  // A zero duration replays the whole trace
+  qaic::openrt::LoadGenProperties properties;
+  properties.arrival = qaic::openrt::LoadGenArrival::Trace;
+  properties.trace = trace;
+  properties.duration = std::chrono::microseconds(0);
+  qaic::openrt::shLoadGen loadGen = qaic::openrt::LoadGen::Factory(
+      properties, {simulatedBackend(std::chrono::microseconds(100)),
+                   simulatedBackend(std::chrono::microseconds(100))});
+  qaic::openrt::LoadGenReport report;
+  ASSERT_TRUE(loadGen->run(report) == QS_SUCCESS);
+  ASSERT_TRUE(numCalls_ == trace.size());
+  ASSERT_TRUE(report.numOffered == trace.size());
+  ASSERT_TRUE(report.numCompleted == trace.size());
+  ASSERT_TRUE(report.numMissed == 0);
+  ASSERT_TRUE(report.windowSec >= 0.003);
+
+  // A duration cuts the trace short
+  numCalls_ = 0;
+  properties.duration = std::chrono::microseconds(1000);
+  loadGen = qaic::openrt::LoadGen::Factory(
+      properties, {simulatedBackend(std::chrono::microseconds(100))});
+  ASSERT_TRUE(loadGen->run(report) == QS_SUCCESS);
+  ASSERT_TRUE(numCalls_ + report.numMissed == 3);
+  ASSERT_TRUE(report.numOffered == 3);
+}
+
+void QAicOpenRtLoadGenUnitTest::LoadGenFailureTest() {
+  qaic::openrt::LoadGenProperties properties;
+  properties.rate = 1000;
+  properties.duration = std::chrono::milliseconds(20);
+  std::atomic<uint32_t> index{0};
+  qaic::openrt::shLoadGen loadGen = qaic::openrt::LoadGen::Factory(
+      properties, {[&index]() -> QStatus {
+        uint32_t i = index++;
+        if (i % 3 == 1) {
+          return QS_ERROR;
+        }
+        if (i % 3 == 2) {
+          throw std::runtime_error("simulated failure");
+        }
+        return QS_SUCCESS;
+      }});
+
+  qaic::openrt::LoadGenReport report;
+  ASSERT_TRUE(loadGen->run(report) == QS_SUCCESS);
+  ASSERT_TRUE(report.numOffered == 20);
+  ASSERT_TRUE(report.numMissed == 0);
+  ASSERT_TRUE(report.numCompleted == 7);
+  ASSERT_TRUE(report.numFailed == 13);
+}
+
+void QAicOpenRtLoadGenUnitTest::LoadGenInvalidPropertiesTest() {
+  qaic::openrt::LoadGenProperties properties;
+  auto backend = simulatedBackend(std::chrono::microseconds(0));
+
+  ASSERT_THROW(qaic::openrt::LoadGen::Factory(properties, {}),
+               qaic::openrt::CoreExceptionInit);
+
+  properties.rate = 0;
+  ASSERT_THROW(qaic::openrt::LoadGen::Factory(properties, {backend}),
+               qaic::openrt::CoreExceptionInit);
+  properties.rate = std::nan("");
+  ASSERT_THROW(qaic::openrt::LoadGen::Factory(properties, {backend}),
+               qaic::openrt::CoreExceptionInit);
+  properties.rate = 100;
+  properties.duration = std::chrono::microseconds(0);
+  ASSERT_THROW(qaic::openrt::LoadGen::Factory(properties, {backend}),
+               qaic::openrt::CoreExceptionInit);
+  properties.duration = std::chrono::microseconds(-1);
+  ASSERT_THROW(qaic::openrt::LoadGen::Factory(properties, {backend}),
+               qaic::openrt::CoreExceptionInit);
+
+  properties.arrival = qaic::openrt::LoadGenArrival::Trace;
+  properties.duration = std::chrono::microseconds(0);
+  ASSERT_THROW(qaic::openrt::LoadGen::Factory(properties, {backend}),
+               qaic::openrt::CoreExceptionInit);
+  properties.trace = {std::chrono::microseconds(10),
+                      std::chrono::microseconds(5)};
+  ASSERT_THROW(qaic::openrt::LoadGen::Factory(properties, {backend}),
+               qaic::openrt::CoreExceptionInit);
+
+  std::vector<std::chrono::microseconds> trace;
+  for (const char *text : {"", "# only a comment\n", "10\n5\n", "10\nabc\n",
+                           "10us\n", "-5\n", "99999999999999999999999\n"}) {
+    std::istringstream is(text);
+    ASSERT_TRUE(qaic::openrt::LoadGen::parseTrace(is, trace) == QS_INVAL);
+    ASSERT_TRUE(trace.empty());
+  }
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtLoadGenUnitTest, LoadGenUnderloadTest) {
+  LoadGenUnderloadTest();
+}
+
+TEST_F(QAicOpenRtLoadGenUnitTest, LoadGenOverloadTest) {
+  LoadGenOverloadTest();
+}
+
+TEST_F(QAicOpenRtLoadGenUnitTest, LoadGenPoissonTest) { LoadGenPoissonTest(); }
+
+TEST_F(QAicOpenRtLoadGenUnitTest, LoadGenTraceTest) { LoadGenTraceTest(); }
+
+TEST_F(QAicOpenRtLoadGenUnitTest, LoadGenFailureTest) { LoadGenFailureTest(); }
+
+TEST_F(QAicOpenRtLoadGenUnitTest, AdversarialLoadGenInvalidPropertiesTest) {
+  LoadGenInvalidPropertiesTest();
+}
+
+} // namespace QAicOpenRtUnitTest
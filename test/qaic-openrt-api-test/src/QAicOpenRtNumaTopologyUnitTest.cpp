@@ -0,0 +1,395 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QNumaTopology.h"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::QDeviceLocality;
+using qaic::QNumaPlacement;
+using qaic::QNumaPolicy;
+using qaic::QNumaTopology;
+
+class QAicOpenRtNumaTopologyUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtNumaTopologyUnitTest(){};
+  ~QAicOpenRtNumaTopologyUnitTest() = default;
+
+  QAicOpenRtNumaTopologyUnitTest(const QAicOpenRtNumaTopologyUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtNumaTopologyUnitTest &
+  operator=(const QAicOpenRtNumaTopologyUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void SetUp() override {
+    char dir[] = "/tmp/qaic-fake-sysfs-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    root_ = dir;
+  }
+  void TearDown() override { std::filesystem::remove_all(root_); }
+
+  void CpuListTest();
+  void InvalidCpuListTest();
+  void DeviceLocalityTest();
+  void NoNumaTest();
+  void InvalidSysfsTest();
+  void RuntimeCpusTest();
+  void BindThreadTest();
+  void BindCallerTest();
+  void BindMemoryTest();
+  void ParsePolicyTest();
+
+  void writeFile(const std::string &path, const std::string &content) {
+    std::filesystem::path file = root_ + "/" + path;
+    std::filesystem::create_directories(file.parent_path());
+    std::ofstream ofs(file);
+    ofs << content;
+  }
+
+  // Dual socket host, one card per socket. The card on node 1 sits behind
+  // an older kernel without local_cpulist.
+  void makeDualSocketTree() {
+    writeFile("devices/system/node/online", "0-1\n");
+    writeFile("devices/system/node/node0/cpulist", "0-7,16-23\n");
+    writeFile("devices/system/node/node1/cpulist", "8-15,24-31\n");
+    writeFile("bus/pci/devices/0000:3b:00.0/numa_node", "0\n");
+    writeFile("bus/pci/devices/0000:3b:00.0/local_cpulist", "0-7,16-23\n");
+    writeFile("bus/pci/devices/0000:af:00.0/numa_node", "1\n");
+  }
+
+  static std::vector<uint32_t> range(uint32_t first, uint32_t last) {
+    std::vector<uint32_t> cpus;
+    for (uint32_t cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+    return cpus;
+  }
+
+  static std::vector<uint32_t> concat(std::vector<uint32_t> a,
+                                      const std::vector<uint32_t> &b) {
+    a.insert(a.end(), b.begin(), b.end());
+    return a;
+  }
+
+  std::string root_;
+};
+
+void QAicOpenRtNumaTopologyUnitTest::CpuListTest() {
+  std::vector<uint32_t> cpus;
+  ASSERT_TRUE(QNumaTopology::parseCpuList("0-3,8,10-11\n", cpus) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(cpus == std::vector<uint32_t>({0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_TRUE(QNumaTopology::parseCpuList("5", cpus) == QS_SUCCESS);
+  ASSERT_TRUE(cpus == std::vector<uint32_t>({5}));
+  ASSERT_TRUE(QNumaTopology::parseCpuList("7-7,2", cpus) == QS_SUCCESS);
+  ASSERT_TRUE(cpus == std::vector<uint32_t>({2, 7}));
+  // Memory only nodes have no CPUs
+  ASSERT_TRUE(QNumaTopology::parseCpuList("\n", cpus) == QS_SUCCESS);
+  ASSERT_TRUE(cpus.empty());
+  ASSERT_TRUE(QNumaTopology::parseCpuList("", cpus) == QS_SUCCESS);
+  ASSERT_TRUE(cpus.empty());
+}
+
+void QAicOpenRtNumaTopologyUnitTest::InvalidCpuListTest() {
+  const char *invalid[] = {"3-1", "a",    "1,",      ",1",    "1--2",
+                           "1-",  "-1",   "1 2",     "1,\n",  "0-3\n4",
+                           "1;2", "0x10", "4294967296", "0-99999999"};
+  for (const char *list : invalid) {
+    std::vector<uint32_t> cpus;
+    ASSERT_TRUE(QNumaTopology::parseCpuList(list, cpus) == QS_INVAL) << list;
+  }
+}
+
+void QAicOpenRtNumaTopologyUnitTest::DeviceLocalityTest() {
+  makeDualSocketTree();
+  QNumaTopology topology(root_);
+
+  std::vector<uint32_t> nodes;
+  ASSERT_TRUE(topology.getOnlineNodes(nodes) == QS_SUCCESS);
+  ASSERT_TRUE(nodes == std::vector<uint32_t>({0, 1}));
+
+  QDeviceLocality locality;
+  ASSERT_TRUE(topology.getDeviceLocality("0000:3b:00.0", locality) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(locality.numaNode == 0);
+  ASSERT_TRUE(locality.cpus == concat(range(0, 7), range(16, 23)));
+
+  // Falls back to the cpulist of the node
+  ASSERT_TRUE(topology.getDeviceLocality("0000:af:00.0", locality) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(locality.numaNode == 1);
+  ASSERT_TRUE(locality.cpus == concat(range(8, 15), range(24, 31)));
+}
+
+void QAicOpenRtNumaTopologyUnitTest::NoNumaTest() {
+  // Single node hosts report -1 and every CPU as local
+  writeFile("bus/pci/devices/0000:01:00.0/numa_node", "-1\n");
+  writeFile("bus/pci/devices/0000:01:00.0/local_cpulist", "0-15\n");
+  QNumaTopology topology(root_);
+
+  QDeviceLocality locality;
+  ASSERT_TRUE(topology.getDeviceLocality("0000:01:00.0", locality) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(locality.numaNode == -1);
+  ASSERT_TRUE(locality.cpus == range(0, 15));
+
+  // No sysfs entry at all, e.g. in a container
+  ASSERT_TRUE(topology.getDeviceLocality("0000:02:00.0", locality) ==
+              QS_UNSUPPORTED);
+  ASSERT_TRUE(locality.numaNode == -1);
+  ASSERT_TRUE(locality.cpus.empty());
+  std::vector<uint32_t> nodes;
+  ASSERT_TRUE(topology.getOnlineNodes(nodes) == QS_UNSUPPORTED);
+
+  // Placement treats such devices as having no locality
+  QNumaPlacement placement(QNumaPolicy::DeviceLocal, topology,
+                           {{0, "0000:02:00.0"}});
+  ASSERT_TRUE(placement.getDeviceLocality(0, locality) == QS_SUCCESS);
+  ASSERT_TRUE(locality.numaNode == -1);
+  ASSERT_TRUE(placement.bindThreadToDevice(0) == QS_SUCCESS);
+  ASSERT_TRUE(placement.getRuntimeCpus().empty());
+}
+
+void QAicOpenRtNumaTopologyUnitTest::InvalidSysfsTest() {
+  writeFile("bus/pci/devices/0000:01:00.0/numa_node", "garbage\n");
+  writeFile("bus/pci/devices/0000:02:00.0/numa_node", "-7\n");
+  writeFile("bus/pci/devices/0000:03:00.0/numa_node", "0\n");
+  writeFile("bus/pci/devices/0000:03:00.0/local_cpulist", "0-3,x\n");
+  // Node without a cpulist
+  writeFile("bus/pci/devices/0000:04:00.0/numa_node", "3\n");
+  QNumaTopology topology(root_);
+
+  QDeviceLocality locality;
+  ASSERT_TRUE(topology.getDeviceLocality("0000:01:00.0", locality) ==
+              QS_INVAL);
+  ASSERT_TRUE(topology.getDeviceLocality("0000:02:00.0", locality) ==
+              QS_INVAL);
+  ASSERT_TRUE(topology.getDeviceLocality("0000:03:00.0", locality) ==
+              QS_INVAL);
+  ASSERT_TRUE(locality.cpus.empty());
+  ASSERT_TRUE(topology.getDeviceLocality("0000:04:00.0", locality) ==
+              QS_INVAL);
+
+  QNumaPlacement placement(QNumaPolicy::DeviceLocal, topology,
+                           {{0, "0000:01:00.0"}});
+  ASSERT_TRUE(placement.getDeviceLocality(0, locality) == QS_INVAL);
+  ASSERT_TRUE(placement.getDeviceLocality(1, locality) == QS_INVAL);
+  ASSERT_TRUE(placement.bindThreadToDevice(1) == QS_INVAL);
+  ASSERT_TRUE(placement.getRuntimeCpus().empty());
+}
+
+void QAicOpenRtNumaTopologyUnitTest::RuntimeCpusTest() {
+  makeDualSocketTree();
+
+  // One card per socket, runtime threads may run anywhere
+  QNumaPlacement everyNode(QNumaPolicy::DeviceLocal, QNumaTopology(root_),
+                           {{0, "0000:3b:00.0"}, {1, "0000:af:00.0"}});
+  ASSERT_TRUE(everyNode.getRuntimeCpus().empty());
+
+  // Cards on socket 0 only
+  writeFile("bus/pci/devices/0000:3c:00.0/numa_node", "0\n");
+  QNumaPlacement oneNode(QNumaPolicy::DeviceLocal, QNumaTopology(root_),
+                         {{0, "0000:3b:00.0"}, {1, "0000:3c:00.0"}});
+  ASSERT_TRUE(oneNode.getRuntimeCpus() == concat(range(0, 7), range(16, 23)));
+
+  // Two of three sockets
+  writeFile("devices/system/node/online", "0-2\n");
+  writeFile("devices/system/node/node2/cpulist", "32-47\n");
+  QNumaPlacement twoNodes(QNumaPolicy::DeviceLocal, QNumaTopology(root_),
+                          {{0, "0000:3b:00.0"}, {1, "0000:af:00.0"}});
+  ASSERT_TRUE(twoNodes.getRuntimeCpus() == range(0, 31));
+}
+
+void QAicOpenRtNumaTopologyUnitTest::BindThreadTest() {
+  // The device is local to the first CPU of this host, so the bind can
+  // succeed wherever the test runs
+  cpu_set_t initial;
+  ASSERT_TRUE(sched_getaffinity(0, sizeof(initial), &initial) == 0);
+  uint32_t firstCpu = 0;
+  while (!CPU_ISSET(firstCpu, &initial)) {
+    firstCpu++;
+  }
+  writeFile("devices/system/node/online", "0-1\n");
+  writeFile("bus/pci/devices/0000:3b:00.0/numa_node", "0\n");
+  writeFile("bus/pci/devices/0000:3b:00.0/local_cpulist",
+            std::to_string(firstCpu) + "\n");
+
+  QNumaPlacement placement(QNumaPolicy::DeviceLocal, QNumaTopology(root_),
+                           {{0, "0000:3b:00.0"}});
+  QNumaPlacement disabled(QNumaPolicy::None, QNumaTopology(root_),
+                          {{0, "0000:3b:00.0"}});
+
+  std::thread([&]() {
+    cpu_set_t cpus;
+    // Policy none leaves the thread alone
+    ASSERT_TRUE(disabled.bindThreadToDevice(0) == QS_SUCCESS);
+    ASSERT_TRUE(disabled.bindRuntimeThread() == QS_SUCCESS);
+    ASSERT_TRUE(sched_getaffinity(0, sizeof(cpus), &cpus) == 0);
+    ASSERT_TRUE(CPU_EQUAL(&cpus, &initial));
+
+    ASSERT_TRUE(placement.bindThreadToDevice(0) == QS_SUCCESS);
+    ASSERT_TRUE(sched_getaffinity(0, sizeof(cpus), &cpus) == 0);
+    ASSERT_TRUE(CPU_COUNT(&cpus) == 1);
+    ASSERT_TRUE(CPU_ISSET(firstCpu, &cpus));
+
+    ASSERT_TRUE(placement.bindRuntimeThread() == QS_SUCCESS);
+  }).join();
+
+  // CPUs the host does not have
+  writeFile("bus/pci/devices/0000:3b:00.0/local_cpulist", "60000\n");
+  QNumaPlacement missingCpus(QNumaPolicy::DeviceLocal, QNumaTopology(root_),
+                             {{0, "0000:3b:00.0"}});
+  std::thread([&]() {
+    ASSERT_TRUE(missingCpus.bindThreadToDevice(0) == QS_ERROR);
+  }).join();
+}
+
+void QAicOpenRtNumaTopologyUnitTest::BindCallerTest() {
+  cpu_set_t initial;
+  ASSERT_TRUE(sched_getaffinity(0, sizeof(initial), &initial) == 0);
+  std::vector<uint32_t> hostCpus;
+  for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &initial)) {
+      hostCpus.push_back(cpu);
+    }
+  }
+  if (hostCpus.size() < 2) {
+    GTEST_SKIP() << "needs two CPUs to tell the nodes apart";
+  }
+  // One card local to each of two CPUs of this host, one of unknown
+  // locality
+  writeFile("devices/system/node/online", "0-1\n");
+  writeFile("bus/pci/devices/0000:3b:00.0/numa_node", "0\n");
+  writeFile("bus/pci/devices/0000:3b:00.0/local_cpulist",
+            std::to_string(hostCpus[0]) + "\n");
+  writeFile("bus/pci/devices/0000:af:00.0/numa_node", "1\n");
+  writeFile("bus/pci/devices/0000:af:00.0/local_cpulist",
+            std::to_string(hostCpus[1]) + "\n");
+  writeFile("bus/pci/devices/0000:01:00.0/numa_node", "-1\n");
+  QNumaPlacement placement(
+      QNumaPolicy::DeviceLocal, QNumaTopology(root_),
+      {{0, "0000:3b:00.0"}, {1, "0000:af:00.0"}, {2, "0000:01:00.0"}});
+
+  auto boundTo = [](uint32_t cpu) {
+    cpu_set_t cpus;
+    return (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) &&
+           (CPU_COUNT(&cpus) == 1) && CPU_ISSET(cpu, &cpus);
+  };
+  std::thread([&]() {
+    ASSERT_TRUE(placement.bindCallerToDevice(0) == QS_SUCCESS);
+    ASSERT_TRUE(boundTo(hostCpus[0]));
+    // The thread follows its device to the other node
+    ASSERT_TRUE(placement.bindCallerToDevice(1) == QS_SUCCESS);
+    ASSERT_TRUE(boundTo(hostCpus[1]));
+    ASSERT_TRUE(placement.bindCallerToDevice(0) == QS_SUCCESS);
+    ASSERT_TRUE(boundTo(hostCpus[0]));
+
+    // A device of unknown locality gives the thread its own affinity back
+    ASSERT_TRUE(placement.bindCallerToDevice(2) == QS_SUCCESS);
+    cpu_set_t cpus;
+    ASSERT_TRUE(sched_getaffinity(0, sizeof(cpus), &cpus) == 0);
+    ASSERT_TRUE(CPU_EQUAL(&cpus, &initial));
+  }).join();
+
+  // A thread that is not running inferences is left alone
+  std::thread([&]() {
+    ASSERT_TRUE(placement.bindCallerToDevice(2) == QS_SUCCESS);
+    cpu_set_t cpus;
+    ASSERT_TRUE(sched_getaffinity(0, sizeof(cpus), &cpus) == 0);
+    ASSERT_TRUE(CPU_EQUAL(&cpus, &initial));
+  }).join();
+}
+
+void QAicOpenRtNumaTopologyUnitTest::BindMemoryTest() {
+  writeFile("devices/system/node/node0/cpulist", "0\n");
+  writeFile("bus/pci/devices/0000:3b:00.0/numa_node", "0\n");
+  writeFile("bus/pci/devices/0000:01:00.0/numa_node", "-1\n");
+  QNumaPlacement placement(QNumaPolicy::DeviceLocal, QNumaTopology(root_),
+                           {{0, "0000:3b:00.0"}, {1, "0000:01:00.0"}});
+
+  const size_t size = 1 << 20;
+  char *buf = static_cast<char *>(mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  ASSERT_TRUE(buf != MAP_FAILED);
+  // Pages touched before the bind, as a buffer zeroed by its allocator
+  std::memset(buf, 1, size);
+  // Node 0 exists on every Linux host, unaligned ranges are widened
+  QStatus status = placement.bindMemoryToDevice(buf + 100, size - 200, 0);
+  LogInfo("{}: bind to node 0 returned {}", testName(),
+          static_cast<int>(status));
+  ASSERT_TRUE((status == QS_SUCCESS) || (status == QS_ERROR));
+  if (status == QS_SUCCESS) {
+    // Touched pages now sit on node 0
+    for (size_t offset = 0; offset < size; offset += size / 4) {
+      int node = -1;
+      ASSERT_TRUE(syscall(SYS_get_mempolicy, &node, nullptr, 0,
+                          buf + offset, MPOL_F_NODE | MPOL_F_ADDR) == 0);
+      ASSERT_TRUE(node == 0);
+    }
+  }
+  // No locality, nothing to do
+  ASSERT_TRUE(placement.bindMemoryToDevice(buf, size, 1) == QS_SUCCESS);
+  ASSERT_TRUE(placement.bindMemoryToDevice(nullptr, size, 0) == QS_INVAL);
+  ASSERT_TRUE(placement.bindMemoryToDevice(buf, 0, 0) == QS_INVAL);
+  ASSERT_TRUE(placement.bindMemoryToDevice(buf, size, 2) == QS_INVAL);
+
+  // Placement disabled leaves the pages alone
+  QNumaPlacement none(QNumaPolicy::None, QNumaTopology(root_), {});
+  ASSERT_TRUE(none.bindMemoryToDevice(buf, size, 0) == QS_SUCCESS);
+  munmap(buf, size);
+}
+
+void QAicOpenRtNumaTopologyUnitTest::ParsePolicyTest() {
+  QNumaPolicy policy;
+  ASSERT_TRUE(QNumaPlacement::parsePolicy("device", policy) == QS_SUCCESS);
+  ASSERT_TRUE(policy == QNumaPolicy::DeviceLocal);
+  ASSERT_TRUE(QNumaPlacement::parsePolicy("none", policy) == QS_SUCCESS);
+  ASSERT_TRUE(policy == QNumaPolicy::None);
+  ASSERT_TRUE(QNumaPlacement::parsePolicy("socket", policy) == QS_INVAL);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, CpuListTest) { CpuListTest(); }
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, AdversarialInvalidCpuListTest) {
+  InvalidCpuListTest();
+}
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, DeviceLocalityTest) {
+  DeviceLocalityTest();
+}
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, NoNumaTest) { NoNumaTest(); }
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, AdversarialInvalidSysfsTest) {
+  InvalidSysfsTest();
+}
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, RuntimeCpusTest) { RuntimeCpusTest(); }
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, BindThreadTest) { BindThreadTest(); }
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, BindCallerTest) { BindCallerTest(); }
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, BindMemoryTest) { BindMemoryTest(); }
+
+TEST_F(QAicOpenRtNumaTopologyUnitTest, ParsePolicyTest) { ParsePolicyTest(); }
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,296 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicOpenRtOutputValidator.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtOutputValidatorUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtOutputValidatorUnitTest(){};
+  ~QAicOpenRtOutputValidatorUnitTest() = default;
+
+  QAicOpenRtOutputValidatorUnitTest(const QAicOpenRtOutputValidatorUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtOutputValidatorUnitTest &
+  operator=(const QAicOpenRtOutputValidatorUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  // Not a multiple of the block size, so that the tail block is compared
+  static constexpr size_t numElements = 1000;
+
+  void OutputValidatorFloatTest();
+  void OutputValidatorHalfTest();
+  void OutputValidatorQuantizedTest();
+  void OutputValidatorIntegerTest();
+  void OutputValidatorSpecialValuesTest();
+  void OutputValidatorInvalidTest();
+
+  BufferMappings simulatedMappings();
+  template <typename T> QBuffer toBuffer(std::vector<T> &data);
+  qaic::openrt::ValidationReport validate(qaic::openrt::shOutputValidator &v,
+                                          const std::string &name,
+                                          QBuffer output, QBuffer reference,
+                                          QStatus expected);
+};
+
+BufferMappings QAicOpenRtOutputValidatorUnitTest::simulatedMappings() {
+  BufferMappings mappings;
+  mappings.emplace_back("input", 0, QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT,
+                        numElements, false,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT8);
+  const std::vector<std::pair<const char *, QAicBufferDataTypeEnum>> outputs =
+      {{"fp32", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT},
+       {"fp16", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT16},
+       {"u8q", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_UINT8Q},
+       {"i16q", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT16Q},
+       {"i64", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INT64I},
+       {"raw", QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_INVAL}};
+  uint32_t index = 1;
+  for (const auto &output : outputs) {
+    mappings.emplace_back(output.first, index++,
+                          QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT, 0,
+                          false, output.second);
+  }
+  return mappings;
+}
+
+template <typename T>
+QBuffer QAicOpenRtOutputValidatorUnitTest::toBuffer(std::vector<T> &data) {
+  QBuffer buffer{};
+  buffer.buf = reinterpret_cast<uint8_t *>(data.data());
+  buffer.size = data.size() * sizeof(T);
+  buffer.type = QBufferType::QBUFFER_TYPE_HEAP;
+  return buffer;
+}
+
+qaic::openrt::ValidationReport QAicOpenRtOutputValidatorUnitTest::validate(
+    qaic::openrt::shOutputValidator &v, const std::string &name,
+    QBuffer output, QBuffer reference, QStatus expected) {
+  qaic::openrt::ValidationReport report;
+  EXPECT_EQ(v->validate(name, output, reference, report), expected);
+  EXPECT_EQ(report.passed, expected == QS_SUCCESS);
+  return report;
+}
+
+void QAicOpenRtOutputValidatorUnitTest::OutputValidatorFloatTest() {
+  auto v = qaic::openrt::OutputValidator::Factory(simulatedMappings());
+  std::vector<float> ref(numElements);
+  for (size_t i = 0; i < numElements; i++) {
+    ref.at(i) = 1.0f + static_cast<float>(i) / 8;
+  }
+  std::vector<float> out = ref;
+  auto report = validate(v, "fp32", toBuffer(out), toBuffer(ref), QS_SUCCESS);
+  ASSERT_EQ(report.numElements, numElements);
+  ASSERT_EQ(report.maxAbsError, 0.0);
+
+  // One ULP off in the first and the last block, 0.5 off at 700
+  out.at(3) = std::nextafter(ref.at(3), 1000.0f);
+  out.at(999) = std::nextafter(ref.at(999), 0.0f);
+  out.at(700) = ref.at(700) + 0.5f;
+  report = validate(v, "fp32", toBuffer(out), toBuffer(ref), QS_ERROR);
+  ASSERT_EQ(report.numMismatches, 3u);
+  ASSERT_EQ(report.firstMismatches, (std::vector<size_t>{3, 700, 999}));
+  ASSERT_NEAR(report.maxAbsError, 0.5, 1e-6);
+
+  qaic::openrt::ValidationProperties properties;
+  properties.ulpTolerance = 1;
+  ASSERT_EQ(v->setProperties("fp32", properties), QS_SUCCESS);
+  report = validate(v, "fp32", toBuffer(out), toBuffer(ref), QS_ERROR);
+  ASSERT_EQ(report.firstMismatches, (std::vector<size_t>{700}));
+
+  // ref(700) is 88.5, 0.5 is within 1% of it
+  properties.relTolerance = 0.01;
+  ASSERT_EQ(v->setProperties("fp32", properties), QS_SUCCESS);
+  validate(v, "fp32", toBuffer(out), toBuffer(ref), QS_SUCCESS);
+
+  properties = qaic::openrt::ValidationProperties();
+  properties.absTolerance = 0.5;
+  ASSERT_EQ(v->setProperties("fp32", properties), QS_SUCCESS);
+  validate(v, "fp32", toBuffer(out), toBuffer(ref), QS_SUCCESS);
+
+  // The report keeps only the first mismatches
+  properties = qaic::openrt::ValidationProperties();
+  properties.maxReportedMismatches = 4;
+  ASSERT_EQ(v->setProperties("fp32", properties), QS_SUCCESS);
+  for (auto &x : out) {
+    x += 1.0f;
+  }
+  report = validate(v, "fp32", toBuffer(out), toBuffer(ref), QS_ERROR);
+  ASSERT_EQ(report.numMismatches, numElements);
+  ASSERT_EQ(report.firstMismatches, (std::vector<size_t>{0, 1, 2, 3}));
+}
+
+void QAicOpenRtOutputValidatorUnitTest::OutputValidatorHalfTest() {
+  auto v = qaic::openrt::OutputValidator::Factory(simulatedMappings());
+  // 1.0, 1.0 + 1 ULP, 65504 (max), a subnormal, -2.0
+  std::vector<uint16_t> ref = {0x3c00, 0x3c01, 0x7bff, 0x0001, 0xc000};
+  std::vector<uint16_t> out = {0x3c01, 0x3c01, 0x7bff, 0x0002, 0xc000};
+  auto report = validate(v, "fp16", toBuffer(out), toBuffer(ref), QS_ERROR);
+  ASSERT_EQ(report.firstMismatches, (std::vector<size_t>{0, 3}));
+  ASSERT_EQ(report.maxUlpError, 1u);
+  // 1 ULP at 1.0 is 2^-10
+  ASSERT_NEAR(report.maxAbsError, std::ldexp(1.0, -10), 1e-12);
+
+  qaic::openrt::ValidationProperties properties;
+  properties.absTolerance = std::ldexp(1.0, -10);
+  ASSERT_EQ(v->setProperties("fp16", properties), QS_SUCCESS);
+  validate(v, "fp16", toBuffer(out), toBuffer(ref), QS_SUCCESS);
+
+  // -0 and +0 are equal
+  ref = {0x0000};
+  out = {0x8000};
+  ASSERT_EQ(v->setProperties("fp16", qaic::openrt::ValidationProperties()),
+            QS_SUCCESS);
+  validate(v, "fp16", toBuffer(out), toBuffer(ref), QS_SUCCESS);
+}
+
+void QAicOpenRtOutputValidatorUnitTest::OutputValidatorQuantizedTest() {
+  auto v = qaic::openrt::OutputValidator::Factory(simulatedMappings());
+  ASSERT_EQ(v->setQuantization("u8q", 0.25f, 128), QS_SUCCESS);
+  std::vector<uint8_t> ref(numElements, 128);
+  std::vector<uint8_t> out = ref;
+  out.at(10) = 130; // 0.5 off once dequantized
+  out.at(20) = 127; // 0.25 off
+  auto report = validate(v, "u8q", toBuffer(out), toBuffer(ref), QS_ERROR);
+  ASSERT_EQ(report.numMismatches, 2u);
+  ASSERT_EQ(report.maxUlpError, 2u);
+  ASSERT_NEAR(report.maxAbsError, 0.5, 1e-9);
+
+  qaic::openrt::ValidationProperties properties;
+  properties.absTolerance = 0.3;
+  ASSERT_EQ(v->setProperties("u8q", properties), QS_SUCCESS);
+  report = validate(v, "u8q", toBuffer(out), toBuffer(ref), QS_ERROR);
+  ASSERT_EQ(report.firstMismatches, (std::vector<size_t>{10}));
+
+  // A tolerance in quantization steps
+  properties = qaic::openrt::ValidationProperties();
+  properties.ulpTolerance = 2;
+  ASSERT_EQ(v->setProperties("u8q", properties), QS_SUCCESS);
+  validate(v, "u8q", toBuffer(out), toBuffer(ref), QS_SUCCESS);
+
+  // Without quantization set, errors are in integer units
+  std::vector<int16_t> ref16(numElements, -300);
+  std::vector<int16_t> out16 = ref16;
+  out16.at(500) = 300;
+  report = validate(v, "i16q", toBuffer(out16), toBuffer(ref16), QS_ERROR);
+  ASSERT_EQ(report.maxAbsError, 600.0);
+  ASSERT_EQ(v->setQuantization("i16q", 0.001f, -300), QS_SUCCESS);
+  report = validate(v, "i16q", toBuffer(out16), toBuffer(ref16), QS_ERROR);
+  ASSERT_NEAR(report.maxAbsError, 0.6, 1e-6);
+}
+
+void QAicOpenRtOutputValidatorUnitTest::OutputValidatorIntegerTest() {
+  auto v = qaic::openrt::OutputValidator::Factory(simulatedMappings());
+  // Index values far apart do not overflow the error
+  std::vector<int64_t> ref = {0, std::numeric_limits<int64_t>::min(), 5};
+  std::vector<int64_t> out = {0, std::numeric_limits<int64_t>::max(), 5};
+  auto report = validate(v, "i64", toBuffer(out), toBuffer(ref), QS_ERROR);
+  ASSERT_EQ(report.firstMismatches, (std::vector<size_t>{1}));
+  ASSERT_EQ(report.maxUlpError, std::numeric_limits<uint64_t>::max());
+
+  // Unknown data types are compared byte for byte, ignoring tolerances
+  qaic::openrt::ValidationProperties properties;
+  properties.absTolerance = 100;
+  ASSERT_EQ(v->setProperties("raw", properties), QS_SUCCESS);
+  std::vector<uint8_t> refRaw = {1, 2, 3};
+  std::vector<uint8_t> outRaw = {1, 2, 4};
+  report = validate(v, "raw", toBuffer(outRaw), toBuffer(refRaw), QS_ERROR);
+  ASSERT_EQ(report.numElements, 3u);
+  ASSERT_EQ(report.firstMismatches, (std::vector<size_t>{2}));
+
+  // A size that is not a whole number of elements falls back to bytes
+  std::vector<uint8_t> odd = {0, 0, 0, 0, 0};
+  report = validate(v, "fp32", toBuffer(odd), toBuffer(odd), QS_SUCCESS);
+  ASSERT_EQ(report.numElements, 5u);
+}
+
+void QAicOpenRtOutputValidatorUnitTest::OutputValidatorSpecialValuesTest() {
+  auto v = qaic::openrt::OutputValidator::Factory(simulatedMappings());
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float inf = std::numeric_limits<float>::infinity();
+  // NaN payloads differ, so the block is not skipped as equal bytes
+  uint32_t otherNanBits = 0x7fc00001;
+  float otherNan;
+  std::memcpy(&otherNan, &otherNanBits, sizeof(otherNan));
+  std::vector<float> ref = {nan, inf, -inf, 0.0f, 1.0f};
+  std::vector<float> out = {otherNan, inf, -inf, -0.0f, 1.0f};
+  auto report = validate(v, "fp32", toBuffer(out), toBuffer(ref), QS_SUCCESS);
+  ASSERT_EQ(report.maxAbsError, 0.0);
+
+  qaic::openrt::ValidationProperties properties;
+  properties.absTolerance = 1e30;
+  properties.ulpTolerance = 1000;
+  ASSERT_EQ(v->setProperties("fp32", properties), QS_SUCCESS);
+  out = {1.0f, nan, inf, 0.0f, inf};
+  report = validate(v, "fp32", toBuffer(out), toBuffer(ref), QS_ERROR);
+  ASSERT_EQ(report.firstMismatches, (std::vector<size_t>{0, 1, 2, 4}));
+}
+
+void QAicOpenRtOutputValidatorUnitTest::OutputValidatorInvalidTest() {
+  BufferMappings inputsOnly;
+  inputsOnly.emplace_back("input", 0,
+                          QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT, 4, false,
+                          QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_FLOAT);
+  ASSERT_THROW(qaic::openrt::OutputValidator::Factory(inputsOnly),
+               qaic::openrt::CoreExceptionInit);
+  qaic::openrt::ValidationProperties properties;
+  properties.absTolerance = -1.0;
+  ASSERT_THROW(
+      qaic::openrt::OutputValidator::Factory(simulatedMappings(), properties),
+      qaic::openrt::CoreExceptionInit);
+  ASSERT_THROW(qaic::openrt::OutputValidator::Factory(
+                   qaic::openrt::shProgram()),
+               qaic::openrt::CoreExceptionInit);
+
+  auto v = qaic::openrt::OutputValidator::Factory(simulatedMappings());
+  ASSERT_EQ(v->setProperties("fp32", properties), QS_INVAL);
+  ASSERT_EQ(v->setProperties("input", qaic::openrt::ValidationProperties()),
+            QS_INVAL);
+  ASSERT_EQ(v->setQuantization("missing", 1.0f, 0), QS_INVAL);
+
+  std::vector<float> ref(4);
+  std::vector<float> out(3);
+  auto report = validate(v, "fp32", toBuffer(out), toBuffer(ref), QS_ERROR);
+  ASSERT_TRUE(report.sizeMismatch);
+  ASSERT_EQ(report.numElements, 0u);
+  report = validate(v, "input", toBuffer(ref), toBuffer(ref), QS_INVAL);
+  ASSERT_EQ(report.bufferName, "input");
+}
+
+//------------------------------------------------------------------
+// Test Program
+//------------------------------------------------------------------
+TEST_F(QAicOpenRtOutputValidatorUnitTest, OutputValidatorFloatTest) {
+  OutputValidatorFloatTest();
+}
+
+TEST_F(QAicOpenRtOutputValidatorUnitTest, OutputValidatorHalfTest) {
+  OutputValidatorHalfTest();
+}
+
+TEST_F(QAicOpenRtOutputValidatorUnitTest, OutputValidatorQuantizedTest) {
+  OutputValidatorQuantizedTest();
+}
+
+TEST_F(QAicOpenRtOutputValidatorUnitTest, OutputValidatorIntegerTest) {
+  OutputValidatorIntegerTest();
+}
+
+TEST_F(QAicOpenRtOutputValidatorUnitTest, OutputValidatorSpecialValuesTest) {
+  OutputValidatorSpecialValuesTest();
+}
+
+TEST_F(QAicOpenRtOutputValidatorUnitTest,
+       AdversarialOutputValidatorInvalidTest) {
+  OutputValidatorInvalidTest();
+}
+
+} // namespace QAicOpenRtUnitTest
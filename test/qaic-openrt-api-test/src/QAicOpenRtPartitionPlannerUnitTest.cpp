@@ -0,0 +1,290 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicPartitionPlanner.h"
+#include "AicMetadataFlat_generated.h"
+
+#include <map>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtPartitionPlannerUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtPartitionPlannerUnitTest(){};
+  ~QAicOpenRtPartitionPlannerUnitTest() = default;
+
+  QAicOpenRtPartitionPlannerUnitTest(
+      const QAicOpenRtPartitionPlannerUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtPartitionPlannerUnitTest &
+  operator=(const QAicOpenRtPartitionPlannerUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  static constexpr uint64_t MB = 1024 * 1024;
+
+  void DemandFromMetadataTest();
+  void PackTest();
+  void SpreadTest();
+  void PlanJsonTest();
+  void NoSpaceTest();
+  void InvalidCapacityTest();
+
+  static qaicpart::ProgramDemand demand(const std::string &name,
+                                        uint32_t numNsp, uint64_t ddrMB,
+                                        uint32_t instances = 1);
+  // A card of 14 NSPs and 16 GB of DDR
+  static qaicpart::CardCapacity card(QID devId);
+  // Checks that no card of the plan is oversubscribed
+  static bool withinCapacity(const qaicpart::ReservationPlan &plan);
+};
+
+qaicpart::ProgramDemand
+QAicOpenRtPartitionPlannerUnitTest::demand(const std::string &name,
+                                           uint32_t numNsp, uint64_t ddrMB,
+                                           uint32_t instances) {
+  qaicpart::ProgramDemand demand;
+  demand.name = name;
+  demand.numNsp = numNsp;
+  demand.numMcid = 2;
+  demand.numSem = 16;
+  demand.shddrSize = ddrMB * MB;
+  demand.instances = instances;
+  return demand;
+}
+
+qaicpart::CardCapacity QAicOpenRtPartitionPlannerUnitTest::card(QID devId) {
+  qaicpart::CardCapacity card;
+  card.devId = devId;
+  card.numNsp = 14;
+  card.numMcid = 64;
+  card.numSem = 256;
+  card.numVc = 16;
+  card.ddrSize = 16 * 1024 * MB;
+  return card;
+}
+
+bool QAicOpenRtPartitionPlannerUnitTest::withinCapacity(
+    const qaicpart::ReservationPlan &plan) {
+  for (const auto &c : plan.cards) {
+    uint64_t nsp = 0, ddr = 0, vc = 0;
+    for (const auto &res : plan.reservations) {
+      if (res.devId == c.devId) {
+        const auto &d = plan.programs[res.program];
+        nsp += d.numNsp;
+        ddr += d.shddrSize + d.l2RegionSize;
+        vc += d.numVc;
+      }
+    }
+    if ((nsp > c.numNsp) || (ddr > c.ddrSize) || (vc > c.numVc)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void QAicOpenRtPartitionPlannerUnitTest::DemandFromMetadataTest() {
+  AicMetadataFlat::MetadataT metadata;
+  metadata.numNSPs = 4;
+  metadata.numSemaphores = 32;
+  metadata.staticSharedDDRSize = 100 * MB;
+  metadata.dynamicSharedDDRSize = 28 * MB;
+  metadata.l2CachedDDRSize = 8 * MB;
+
+  // No host multicast table means no MCIDs
+  qaicpart::ProgramDemand d =
+      qaicpart::demandFromMetadata(metadata, testName());
+  ASSERT_TRUE(d.name == testName());
+  ASSERT_TRUE(d.numNsp == 4);
+  ASSERT_TRUE(d.numMcid == 0);
+  ASSERT_TRUE(d.numSem == 32);
+  ASSERT_TRUE(d.numVc == 1);
+  ASSERT_TRUE(d.shddrSize == 128 * MB);
+  ASSERT_TRUE(d.l2RegionSize == 8 * MB);
+  ASSERT_TRUE(d.instances == 1);
+
+  metadata.hostMulticastTable =
+      std::make_unique<AicMetadataFlat::AICMDHostMulticastEntryTableT>();
+  metadata.hostMulticastTable->multicastEntries.resize(3);
+  d = qaicpart::demandFromMetadata(metadata, testName());
+  ASSERT_TRUE(d.numMcid == 3);
+}
+
+void QAicOpenRtPartitionPlannerUnitTest::PackTest() {
+  // A heterogeneous mix: the max-of-resources reservation would need 8 NSPs
+  // for each of the 7 programs, i.e. 4 cards. Packed they fit on 2.
+  std::vector<qaicpart::ProgramDemand> programs = {
+      demand("large", 8, 4096), demand("medium", 4, 1024, 2),
+      demand("small", 1, 256, 4)};
+  std::vector<qaicpart::CardCapacity> cards = {card(0), card(1), card(2),
+                                               card(3)};
+
+  qaicpart::ReservationPlan plan;
+  ASSERT_TRUE(qaicpart::planReservations(programs, cards,
+                                         qaicpart::PlanObjective::Pack,
+                                         plan) == QS_SUCCESS);
+  ASSERT_TRUE(plan.reservations.size() == 7);
+  ASSERT_TRUE(plan.unplaced.empty());
+  ASSERT_TRUE(plan.getNumCardsUsed() == 2);
+  ASSERT_TRUE(withinCapacity(plan));
+
+  // Every instance is planned exactly once
+  std::map<std::pair<size_t, uint32_t>, int> seen;
+  for (const auto &res : plan.reservations) {
+    seen[{res.program, res.instance}]++;
+  }
+  ASSERT_TRUE(seen.size() == 7);
+}
+
+void QAicOpenRtPartitionPlannerUnitTest::SpreadTest() {
+  std::vector<qaicpart::ProgramDemand> programs = {demand("a", 2, 512, 4)};
+  std::vector<qaicpart::CardCapacity> cards = {card(0), card(1), card(2),
+                                               card(3)};
+
+  qaicpart::ReservationPlan plan;
+  ASSERT_TRUE(qaicpart::planReservations(programs, cards,
+                                         qaicpart::PlanObjective::Spread,
+                                         plan) == QS_SUCCESS);
+  ASSERT_TRUE(plan.getNumCardsUsed() == 4);
+
+  ASSERT_TRUE(qaicpart::planReservations(programs, cards,
+                                         qaicpart::PlanObjective::Pack,
+                                         plan) == QS_SUCCESS);
+  ASSERT_TRUE(plan.getNumCardsUsed() == 1);
+
+  // Spread balances cards of different sizes by what is left on them
+  cards[0].numNsp = 4;
+  ASSERT_TRUE(qaicpart::planReservations(programs, cards,
+                                         qaicpart::PlanObjective::Spread,
+                                         plan) == QS_SUCCESS);
+  for (const auto &res : plan.reservations) {
+    ASSERT_TRUE(res.devId != 0);
+  }
+  ASSERT_TRUE(withinCapacity(plan));
+}
+
+void QAicOpenRtPartitionPlannerUnitTest::PlanJsonTest() {
+  std::vector<qaicpart::ProgramDemand> programs = {demand("a", 2, 512, 2)};
+  std::vector<qaicpart::CardCapacity> cards = {card(7)};
+  qaicpart::ReservationPlan plan;
+  ASSERT_TRUE(qaicpart::planReservations(programs, cards,
+                                         qaicpart::PlanObjective::Pack,
+                                         plan) == QS_SUCCESS);
+
+  nlohmann::json json = plan.toJson();
+  ASSERT_TRUE(json["objective"] == "pack");
+  ASSERT_TRUE(json["cardsUsed"] == 1);
+  ASSERT_TRUE(json["reservations"].size() == 2);
+  ASSERT_TRUE(json["reservations"][0]["deviceId"] == 7);
+  ASSERT_TRUE(json["reservations"][0]["numNsp"] == 2);
+  ASSERT_TRUE(json["reservations"][0]["ddrSize"] == 512 * MB);
+  ASSERT_TRUE(json["unplaced"].empty());
+
+  // Card capacities round trip through the offline format
+  nlohmann::json cardsJson = nlohmann::json::array();
+  cardsJson.push_back({{"deviceId", 7},
+                       {"numNsp", 14},
+                       {"numMcid", 64},
+                       {"numSem", 256},
+                       {"numVc", 16},
+                       {"ddrSize", 16 * 1024 * MB}});
+  std::vector<qaicpart::CardCapacity> parsed;
+  ASSERT_TRUE(qaicpart::readCardCapacities(cardsJson, parsed) == QS_SUCCESS);
+  ASSERT_TRUE(parsed.size() == 1);
+  ASSERT_TRUE(parsed[0].devId == 7);
+  ASSERT_TRUE(parsed[0].numNsp == 14);
+  ASSERT_TRUE(parsed[0].ddrSize == 16 * 1024 * MB);
+
+  QResourceInfo info{};
+  info.nspFree = 10;
+  info.vcFree = 3;
+  info.dramFree = 2048;
+  qaicpart::CardCapacity fromInfo = qaicpart::capacityFromResourceInfo(5, info);
+  ASSERT_TRUE(fromInfo.devId == 5);
+  ASSERT_TRUE(fromInfo.numNsp == 10);
+  ASSERT_TRUE(fromInfo.numVc == 3);
+  ASSERT_TRUE(fromInfo.ddrSize == 2048 * MB);
+}
+
+void QAicOpenRtPartitionPlannerUnitTest::NoSpaceTest() {
+  // Larger than any card, and more instances than fit
+  std::vector<qaicpart::ProgramDemand> programs = {
+      demand("huge", 16, 1024), demand("fits", 8, 1024, 3)};
+  std::vector<qaicpart::CardCapacity> cards = {card(0), card(1)};
+
+  qaicpart::ReservationPlan plan;
+  ASSERT_TRUE(qaicpart::planReservations(programs, cards,
+                                         qaicpart::PlanObjective::Pack,
+                                         plan) == QS_NOSPC);
+  ASSERT_TRUE(plan.reservations.size() == 2);
+  ASSERT_TRUE(plan.unplaced.size() == 2);
+  ASSERT_TRUE(withinCapacity(plan));
+
+  // Nothing fits without cards, and nothing is planned without programs
+  ASSERT_TRUE(qaicpart::planReservations(programs, {},
+                                         qaicpart::PlanObjective::Spread,
+                                         plan) == QS_NOSPC);
+  ASSERT_TRUE(plan.reservations.empty());
+  ASSERT_TRUE(qaicpart::planReservations({}, cards,
+                                         qaicpart::PlanObjective::Spread,
+                                         plan) == QS_SUCCESS);
+  ASSERT_TRUE(plan.getNumCardsUsed() == 0);
+
+  // DDR is checked as well as NSPs
+  programs = {demand("ddr", 1, 10 * 1024, 2)};
+  ASSERT_TRUE(qaicpart::planReservations(programs, {card(0)},
+                                         qaicpart::PlanObjective::Pack,
+                                         plan) == QS_NOSPC);
+  ASSERT_TRUE(plan.reservations.size() == 1);
+}
+
+void QAicOpenRtPartitionPlannerUnitTest::InvalidCapacityTest() {
+  std::vector<qaicpart::CardCapacity> cards;
+  ASSERT_TRUE(qaicpart::readCardCapacities(nlohmann::json::object(), cards) ==
+              QS_INVAL);
+
+  nlohmann::json missing = nlohmann::json::array();
+  missing.push_back({{"deviceId", 0}, {"numNsp", 14}});
+  ASSERT_TRUE(qaicpart::readCardCapacities(missing, cards) == QS_INVAL);
+
+  nlohmann::json negative = nlohmann::json::array();
+  negative.push_back({{"deviceId", 0},
+                      {"numNsp", -1},
+                      {"numMcid", 64},
+                      {"numSem", 256},
+                      {"numVc", 16},
+                      {"ddrSize", 1}});
+  ASSERT_TRUE(qaicpart::readCardCapacities(negative, cards) == QS_INVAL);
+
+  qaicpart::PlanObjective objective;
+  ASSERT_TRUE(qaicpart::parsePlanObjective("spread", objective) ==
+              QS_SUCCESS);
+  ASSERT_TRUE(objective == qaicpart::PlanObjective::Spread);
+  ASSERT_TRUE(qaicpart::parsePlanObjective("max", objective) == QS_INVAL);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtPartitionPlannerUnitTest, DemandFromMetadataTest) {
+  DemandFromMetadataTest();
+}
+
+TEST_F(QAicOpenRtPartitionPlannerUnitTest, PackTest) { PackTest(); }
+
+TEST_F(QAicOpenRtPartitionPlannerUnitTest, SpreadTest) { SpreadTest(); }
+
+TEST_F(QAicOpenRtPartitionPlannerUnitTest, PlanJsonTest) { PlanJsonTest(); }
+
+TEST_F(QAicOpenRtPartitionPlannerUnitTest, AdversarialNoSpaceTest) {
+  NoSpaceTest();
+}
+
+TEST_F(QAicOpenRtPartitionPlannerUnitTest, AdversarialInvalidCapacityTest) {
+  InvalidCapacityTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,278 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "PrePostProcArena.h"
+
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <random>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtPrePostProcArenaUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtPrePostProcArenaUnitTest(){};
+  ~QAicOpenRtPrePostProcArenaUnitTest() = default;
+
+  QAicOpenRtPrePostProcArenaUnitTest(
+      const QAicOpenRtPrePostProcArenaUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtPrePostProcArenaUnitTest &
+  operator=(const QAicOpenRtPrePostProcArenaUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void SizeClassTest();
+  void AlignmentTest();
+  void ReuseTest();
+  void PlanTest();
+  void PlanningTimeTest();
+  void EmptyPlanTest();
+  void BlockHookTest();
+
+  // Sizes of the temporaries of a chain of transforms, each transform reads
+  // the previous temporary and writes the next one
+  static std::vector<size_t> chainSizes(size_t count, uint32_t seed);
+};
+
+std::vector<size_t>
+QAicOpenRtPrePostProcArenaUnitTest::chainSizes(size_t count, uint32_t seed) {
+  // Image and feature map shaped tensors of a few layouts and precisions
+  static const size_t shapes[] = {224 * 224 * 3,     224 * 224 * 3 * 4,
+                                  256 * 256 * 3,     1000 * 4,
+                                  512 * 512 * 3 * 2, 64 * 56 * 56 * 2};
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> dist(0, std::size(shapes) - 1);
+  std::vector<size_t> sizes(count);
+  for (auto &size : sizes) {
+    size = shapes[dist(gen)];
+  }
+  return sizes;
+}
+
+void QAicOpenRtPrePostProcArenaUnitTest::SizeClassTest() {
+  using aicppp::TempArena;
+  size_t prevClass = 0;
+  for (size_t size = 1; size <= (1 << 22); size += 1 + size / 7) {
+    size_t sizeClass = TempArena::getSizeClass(size);
+    size_t classSize = TempArena::getClassSize(sizeClass);
+    ASSERT_TRUE(sizeClass >= prevClass);
+    ASSERT_TRUE(classSize >= size);
+    // Small sizes round up to a cache line, others waste at most a quarter
+    if (size > TempArena::slotAlignment) {
+      ASSERT_TRUE(classSize - size < classSize / 4 + 1) << size;
+      ASSERT_TRUE(TempArena::getClassSize(sizeClass - 1) < size) << size;
+    }
+    prevClass = sizeClass;
+  }
+  ASSERT_TRUE(TempArena::getSizeClass(64) == 0);
+  ASSERT_TRUE(TempArena::getClassSize(TempArena::getSizeClass(65)) == 80);
+  ASSERT_TRUE(TempArena::getClassSize(TempArena::getSizeClass(4096)) ==
+              4096);
+}
+
+void QAicOpenRtPrePostProcArenaUnitTest::AlignmentTest() {
+  aicppp::TempArena arena;
+  std::vector<int> slots;
+  for (size_t size : {1, 63, 65, 100, 4097, 12345}) {
+    slots.push_back(arena.reserve(size));
+  }
+  ASSERT_TRUE(arena.commit());
+  ASSERT_TRUE(arena.getNumBlocks() == 1);
+  ASSERT_TRUE(reinterpret_cast<uintptr_t>(arena.get(slots[0])) %
+                  aicppp::TempArena::blockAlignment ==
+              0);
+  for (size_t i = 0; i < slots.size(); i++) {
+    char *buf = arena.get(slots[i]);
+    ASSERT_TRUE(reinterpret_cast<uintptr_t>(buf) %
+                    aicppp::TempArena::slotAlignment ==
+                0);
+    // Every slot is backed by its full size
+    memset(buf, static_cast<int>(i), arena.getSlotSize(slots[i]));
+  }
+  for (size_t i = 0; i < slots.size(); i++) {
+    ASSERT_TRUE(arena.get(slots[i])[0] == static_cast<char>(i));
+  }
+}
+
+void QAicOpenRtPrePostProcArenaUnitTest::ReuseTest() {
+  aicppp::TempArena arena;
+  int a = arena.reserve(1000);
+  arena.release(a);
+  // Same size class gets the released slot, another one does not
+  int b = arena.reserve(1010);
+  ASSERT_TRUE(b == a);
+  int c = arena.reserve(5000);
+  ASSERT_TRUE(c != a);
+  // A smaller temporary takes the smallest released slot that fits
+  arena.release(c);
+  arena.release(a);
+  ASSERT_TRUE(arena.reserve(100) == a);
+  ASSERT_TRUE(arena.reserve(100) == c);
+  ASSERT_TRUE(arena.commit());
+  char *first = arena.get(a);
+
+  // A new plan never reuses slots of a committed one
+  int d = arena.reserve(1000);
+  ASSERT_TRUE((d != a) && (d != c));
+  ASSERT_TRUE(arena.commit());
+  ASSERT_TRUE(arena.getNumBlocks() == 2);
+  ASSERT_TRUE(arena.get(a) == first);
+  ASSERT_TRUE(arena.get(d) != first);
+}
+
+void QAicOpenRtPrePostProcArenaUnitTest::PlanTest() {
+  // A chain of transforms needs two live temporaries at a time, with
+  // repeating sizes the arena holds only a few slots
+  aicppp::TempArena arena;
+  std::vector<size_t> sizes = {4096, 256, 4096, 256, 4096, 256, 4096};
+  int prev = -1;
+  std::vector<int> slots;
+  for (size_t size : sizes) {
+    int slot = arena.reserve(size);
+    if (prev != -1) {
+      ASSERT_TRUE(slot != prev);
+      arena.release(prev);
+    }
+    slots.push_back(slot);
+    prev = slot;
+  }
+  ASSERT_TRUE(arena.commit());
+  ASSERT_TRUE(arena.getNumSlots() == 2);
+  ASSERT_TRUE(arena.getCommittedBytes() == 2 * 4096);
+  for (size_t i = 1; i < slots.size(); i++) {
+    ASSERT_TRUE(arena.get(slots[i]) != arena.get(slots[i - 1]));
+  }
+}
+
+void QAicOpenRtPrePostProcArenaUnitTest::PlanningTimeTest() {
+  constexpr size_t numTemps = 64;
+  constexpr int iterations = 2000;
+  std::vector<size_t> sizes = chainSizes(numTemps, 42);
+
+  // The previous scheme: first fit over a list of free heap buffers
+  struct Buffer {
+    char *buf;
+    size_t size;
+  };
+  auto listStart = std::chrono::steady_clock::now();
+  size_t listBytes = 0;
+  for (int it = 0; it < iterations; it++) {
+    std::list<Buffer> freeBuffers;
+    std::vector<std::unique_ptr<char[]>> alloced;
+    Buffer prev{nullptr, 0};
+    for (size_t size : sizes) {
+      Buffer cur{nullptr, size};
+      for (auto b = freeBuffers.begin(); b != freeBuffers.end(); ++b) {
+        if (b->size >= size) {
+          cur = *b;
+          freeBuffers.erase(b);
+          break;
+        }
+      }
+      if (cur.buf == nullptr) {
+        alloced.emplace_back(new char[size]);
+        cur.buf = alloced.back().get();
+        listBytes += size;
+      }
+      if (prev.buf != nullptr) {
+        freeBuffers.push_back(prev);
+      }
+      prev = cur;
+    }
+  }
+  auto listTime = std::chrono::steady_clock::now() - listStart;
+
+  auto arenaStart = std::chrono::steady_clock::now();
+  size_t arenaBytes = 0;
+  for (int it = 0; it < iterations; it++) {
+    aicppp::TempArena arena;
+    int prev = -1;
+    for (size_t size : sizes) {
+      int slot = arena.reserve(size);
+      if (prev != -1) {
+        arena.release(prev);
+      }
+      prev = slot;
+    }
+    ASSERT_TRUE(arena.commit());
+    ASSERT_TRUE(arena.get(prev) != nullptr);
+    arenaBytes += arena.getCommittedBytes();
+  }
+  auto arenaTime = std::chrono::steady_clock::now() - arenaStart;
+
+  using us = std::chrono::microseconds;
+  LogInfo("{}: {} temps x {} plans, first fit {} us {} bytes/plan, arena {} "
+          "us {} bytes/plan",
+          testName(), numTemps, iterations,
+          std::chrono::duration_cast<us>(listTime).count(),
+          listBytes / iterations,
+          std::chrono::duration_cast<us>(arenaTime).count(),
+          arenaBytes / iterations);
+}
+
+void QAicOpenRtPrePostProcArenaUnitTest::EmptyPlanTest() {
+  aicppp::TempArena arena;
+  // Committing nothing allocates nothing
+  ASSERT_TRUE(arena.commit());
+  ASSERT_TRUE(arena.getNumBlocks() == 0);
+  ASSERT_TRUE(arena.getCommittedBytes() == 0);
+
+  // Zero sized temporaries still get a distinct cache line
+  int a = arena.reserve(0);
+  int b = arena.reserve(0);
+  ASSERT_TRUE(arena.commit());
+  ASSERT_TRUE(arena.get(a) != arena.get(b));
+  ASSERT_TRUE(arena.commit());
+  ASSERT_TRUE(arena.getNumBlocks() == 1);
+}
+
+void QAicOpenRtPrePostProcArenaUnitTest::BlockHookTest() {
+  aicppp::TempArena arena;
+  std::vector<std::pair<char *, size_t>> blocks;
+  arena.setBlockHook([&blocks](void *block, size_t size) {
+    blocks.emplace_back(static_cast<char *>(block), size);
+  });
+  int a = arena.reserve(1000);
+  ASSERT_TRUE(arena.commit());
+  // Nothing new to back, no block
+  ASSERT_TRUE(arena.commit());
+  int b = arena.reserve(100000);
+  ASSERT_TRUE(arena.commit());
+
+  // Every block is reported once, whole, and holds its slots
+  ASSERT_TRUE(blocks.size() == 2);
+  ASSERT_TRUE(blocks[0].second + blocks[1].second ==
+              arena.getCommittedBytes());
+  ASSERT_TRUE(arena.get(a) == blocks[0].first);
+  ASSERT_TRUE(arena.get(b) == blocks[1].first);
+  ASSERT_TRUE(blocks[1].second >= arena.getSlotSize(b));
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtPrePostProcArenaUnitTest, SizeClassTest) { SizeClassTest(); }
+
+TEST_F(QAicOpenRtPrePostProcArenaUnitTest, AlignmentTest) { AlignmentTest(); }
+
+TEST_F(QAicOpenRtPrePostProcArenaUnitTest, ReuseTest) { ReuseTest(); }
+
+TEST_F(QAicOpenRtPrePostProcArenaUnitTest, PlanTest) { PlanTest(); }
+
+TEST_F(QAicOpenRtPrePostProcArenaUnitTest, PlanningTimeTest) {
+  PlanningTimeTest();
+}
+
+TEST_F(QAicOpenRtPrePostProcArenaUnitTest, AdversarialEmptyPlanTest) {
+  EmptyPlanTest();
+}
+
+TEST_F(QAicOpenRtPrePostProcArenaUnitTest, BlockHookTest) { BlockHookTest(); }
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,345 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QProgramCache.h"
+#include "QUtil.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::QProgramCache;
+using qaic::QProgramCacheEntry;
+using qaic::QProgramCacheKey;
+
+class QAicOpenRtProgramCacheUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtProgramCacheUnitTest(){};
+  ~QAicOpenRtProgramCacheUnitTest() = default;
+
+  QAicOpenRtProgramCacheUnitTest(const QAicOpenRtProgramCacheUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtProgramCacheUnitTest &
+  operator=(const QAicOpenRtProgramCacheUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void SetUp() override {
+    char dir[] = "/tmp/qaic-program-cache-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    root_ = dir;
+    cacheDir_ = root_ + "/cache";
+
+    // Stand in for the network image and descriptor of a QPC
+    std::mt19937 gen(7);
+    network_.resize(64 * 1024 + 13);
+    for (auto &byte : network_) {
+      byte = static_cast<uint8_t>(gen());
+    }
+    networkDesc_.assign(300, 0x5a);
+  }
+  void TearDown() override { std::filesystem::remove_all(root_); }
+
+  void HashTest();
+  void RoundTripTest();
+  void KeyTest();
+  void CorruptEntryTest();
+  void ForeignEntryTest();
+  void ConcurrentStoreTest();
+  void UnwritableDirTest();
+  void PlantedLinkTest();
+
+  QProgramCacheKey makeKey() {
+    return QProgramCache::makeKey({network_.size(), network_.data()},
+                                  {networkDesc_.size(), networkDesc_.data()});
+  }
+
+  static QProgramCacheEntry makeEntry() {
+    QProgramCacheEntry entry;
+    entry.metadata.assign(4096, 0);
+    for (size_t i = 0; i < entry.metadata.size(); i++) {
+      entry.metadata[i] = static_cast<uint8_t>(i * 31);
+    }
+    entry.metadataHeaderSize = 8;
+    entry.ioDescPb = {0x0a, 0x04, 'n', 'a', 'm', 'e', 0x12, 0x00};
+    return entry;
+  }
+
+  static bool isEqual(const QProgramCacheEntry &a,
+                      const QProgramCacheEntry &b) {
+    return (a.metadata == b.metadata) &&
+           (a.metadataHeaderSize == b.metadataHeaderSize) &&
+           (a.ioDescPb == b.ioDescPb);
+  }
+
+  static std::vector<uint8_t> readFile(const std::string &path) {
+    std::ifstream ifs(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(ifs), {});
+  }
+
+  static void writeFile(const std::string &path,
+                        const std::vector<uint8_t> &data) {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char *>(data.data()), data.size());
+  }
+
+  std::string root_;
+  std::string cacheDir_;
+  std::vector<uint8_t> network_;
+  std::vector<uint8_t> networkDesc_;
+};
+
+void QAicOpenRtProgramCacheUnitTest::HashTest() {
+  // Reference XXH64 values
+  ASSERT_TRUE(qaic::qutil::hash64("", 0) == 0xef46db3751d8e999ULL);
+  ASSERT_TRUE(qaic::qutil::hash64("abc", 3) == 0x44bc2cf5ad770999ULL);
+
+  // Every tail length and alignment of the 32 byte stripes
+  std::vector<uint8_t> buf(network_.begin(), network_.begin() + 200);
+  for (size_t size = 1; size < 100; size++) {
+    uint64_t hash = qaic::qutil::hash64(buf.data(), size);
+    std::vector<uint8_t> copy(buf.begin() + 1, buf.begin() + 1 + size);
+    ASSERT_TRUE(qaic::qutil::hash64(copy.data(), size) ==
+                qaic::qutil::hash64(buf.data() + 1, size));
+    buf[size - 1] ^= 1;
+    ASSERT_TRUE(qaic::qutil::hash64(buf.data(), size) != hash);
+    buf[size - 1] ^= 1;
+  }
+  ASSERT_TRUE(qaic::qutil::hash64(buf.data(), buf.size(), 1) !=
+              qaic::qutil::hash64(buf.data(), buf.size(), 2));
+}
+
+void QAicOpenRtProgramCacheUnitTest::RoundTripTest() {
+  QProgramCache cache(cacheDir_);
+  QProgramCacheKey key = makeKey();
+  QProgramCacheEntry entry;
+
+  // Cold start, the directory does not exist yet
+  ASSERT_TRUE(cache.lookup(key, entry) == QS_ERROR);
+  ASSERT_TRUE(cache.getNumMisses() == 1);
+
+  ASSERT_TRUE(cache.store(key, makeEntry()) == QS_SUCCESS);
+  ASSERT_TRUE(std::filesystem::exists(cache.getEntryPath(key)));
+
+  // Warm start from another instance, as after a restart
+  QProgramCache restarted(cacheDir_);
+  ASSERT_TRUE(restarted.lookup(key, entry) == QS_SUCCESS);
+  ASSERT_TRUE(isEqual(entry, makeEntry()));
+  ASSERT_TRUE(restarted.getNumHits() == 1);
+
+  // Overwriting an entry replaces it
+  QProgramCacheEntry updated = makeEntry();
+  updated.ioDescPb.push_back(0x18);
+  ASSERT_TRUE(cache.store(key, updated) == QS_SUCCESS);
+  ASSERT_TRUE(restarted.lookup(key, entry) == QS_SUCCESS);
+  ASSERT_TRUE(isEqual(entry, updated));
+
+  // Programs without metadata or IO descriptor
+  QProgramCacheEntry empty;
+  ASSERT_TRUE(cache.store(key, empty) == QS_SUCCESS);
+  ASSERT_TRUE(restarted.lookup(key, entry) == QS_SUCCESS);
+  ASSERT_TRUE(isEqual(entry, empty));
+
+  // No temporary files left behind
+  size_t numFiles = 0;
+  for (const auto &file : std::filesystem::directory_iterator(cacheDir_)) {
+    ASSERT_TRUE(file.path().extension() == ".qprog");
+    numFiles++;
+  }
+  ASSERT_TRUE(numFiles == 1);
+
+  QProgramCacheEntry invalid = makeEntry();
+  invalid.metadataHeaderSize = invalid.metadata.size() + 1;
+  ASSERT_TRUE(cache.store(key, invalid) == QS_INVAL);
+}
+
+void QAicOpenRtProgramCacheUnitTest::KeyTest() {
+  QProgramCacheKey key = makeKey();
+  ASSERT_TRUE(key == makeKey());
+  ASSERT_TRUE(key.networkSize == network_.size());
+  ASSERT_TRUE(key.networkDescSize == networkDesc_.size());
+
+  // A single byte of either buffer is a different program
+  network_[network_.size() / 2] ^= 0x80;
+  QProgramCacheKey networkChanged = makeKey();
+  network_[network_.size() / 2] ^= 0x80;
+  networkDesc_.back() ^= 0x01;
+  QProgramCacheKey descChanged = makeKey();
+  networkDesc_.back() ^= 0x01;
+  ASSERT_TRUE(!(key == networkChanged));
+  ASSERT_TRUE(!(key == descChanged));
+
+  QProgramCache cache(cacheDir_);
+  ASSERT_TRUE(cache.getEntryPath(key) != cache.getEntryPath(networkChanged));
+  ASSERT_TRUE(cache.getEntryPath(key) != cache.getEntryPath(descChanged));
+  ASSERT_TRUE(cache.store(key, makeEntry()) == QS_SUCCESS);
+  QProgramCacheEntry entry;
+  ASSERT_TRUE(cache.lookup(networkChanged, entry) == QS_ERROR);
+  ASSERT_TRUE(cache.lookup(descChanged, entry) == QS_ERROR);
+  ASSERT_TRUE(cache.lookup(key, entry) == QS_SUCCESS);
+}
+
+void QAicOpenRtProgramCacheUnitTest::CorruptEntryTest() {
+  QProgramCache cache(cacheDir_);
+  QProgramCacheKey key = makeKey();
+  const std::string path = cache.getEntryPath(key);
+  ASSERT_TRUE(cache.store(key, makeEntry()) == QS_SUCCESS);
+  const std::vector<uint8_t> good = readFile(path);
+
+  // Bit flips anywhere in the header or the payload
+  for (size_t offset : {size_t(0), size_t(8), size_t(100), size_t(140),
+                        good.size() / 2, good.size() - 1}) {
+    std::vector<uint8_t> bad = good;
+    bad[offset] ^= 0x10;
+    writeFile(path, bad);
+    QProgramCacheEntry entry;
+    ASSERT_TRUE(cache.lookup(key, entry) == QS_ERROR) << offset;
+    // The entry is dropped so that the next store rebuilds it
+    ASSERT_TRUE(!std::filesystem::exists(path)) << offset;
+    ASSERT_TRUE(entry.metadata.empty());
+  }
+
+  // Truncated and extended files
+  for (size_t size : {size_t(0), size_t(10), size_t(136), good.size() - 1}) {
+    writeFile(path, std::vector<uint8_t>(good.begin(), good.begin() + size));
+    QProgramCacheEntry entry;
+    ASSERT_TRUE(cache.lookup(key, entry) == QS_ERROR) << size;
+  }
+  std::vector<uint8_t> extended = good;
+  extended.push_back(0);
+  writeFile(path, extended);
+  QProgramCacheEntry entry;
+  ASSERT_TRUE(cache.lookup(key, entry) == QS_ERROR);
+
+  writeFile(path, good);
+  ASSERT_TRUE(cache.lookup(key, entry) == QS_SUCCESS);
+  ASSERT_TRUE(isEqual(entry, makeEntry()));
+}
+
+void QAicOpenRtProgramCacheUnitTest::ForeignEntryTest() {
+  QProgramCache cache(cacheDir_);
+  QProgramCacheKey key = makeKey();
+  ASSERT_TRUE(cache.store(key, makeEntry()) == QS_SUCCESS);
+
+  // An entry of another program under this key, e.g. a hash collision or a
+  // copied file
+  QProgramCacheKey other = key;
+  other.networkHash++;
+  std::filesystem::copy_file(cache.getEntryPath(key),
+                             cache.getEntryPath(other));
+  QProgramCacheEntry entry;
+  ASSERT_TRUE(cache.lookup(other, entry) == QS_ERROR);
+  ASSERT_TRUE(!std::filesystem::exists(cache.getEntryPath(other)));
+
+  // Another runtime version names its entries differently
+  ASSERT_TRUE(cache.getEntryPath(key).find(cacheDir_ + "/") == 0);
+  ASSERT_TRUE(QProgramCache::getRuntimeVersion().find(
+                  fmt::format("f{}", QProgramCache::formatVersion)) !=
+              std::string::npos);
+  ASSERT_TRUE(cache.lookup(key, entry) == QS_SUCCESS);
+}
+
+void QAicOpenRtProgramCacheUnitTest::ConcurrentStoreTest() {
+  // Processes restarting together race to fill the cache, readers must
+  // only ever see complete entries
+  constexpr uint32_t numWriters = 4;
+  constexpr uint32_t numStores = 20;
+  QProgramCache cache(cacheDir_);
+  QProgramCacheKey key = makeKey();
+  ASSERT_TRUE(cache.store(key, makeEntry()) == QS_SUCCESS);
+
+  std::atomic<uint32_t> failures{0};
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < numWriters; i++) {
+    threads.emplace_back([&]() {
+      for (uint32_t j = 0; j < numStores; j++) {
+        if (cache.store(key, makeEntry()) != QS_SUCCESS) {
+          failures++;
+        }
+        QProgramCacheEntry entry;
+        if ((cache.lookup(key, entry) != QS_SUCCESS) ||
+            !isEqual(entry, makeEntry())) {
+          failures++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_TRUE(failures == 0);
+}
+
+void QAicOpenRtProgramCacheUnitTest::UnwritableDirTest() {
+  // The cache directory is a regular file
+  writeFile(cacheDir_, {1, 2, 3});
+  QProgramCache cache(cacheDir_);
+  QProgramCacheKey key = makeKey();
+  ASSERT_TRUE(cache.store(key, makeEntry()) == QS_ERROR);
+  QProgramCacheEntry entry;
+  ASSERT_TRUE(cache.lookup(key, entry) == QS_ERROR);
+
+  QProgramCache nested(cacheDir_ + "/sub");
+  ASSERT_TRUE(nested.store(key, makeEntry()) == QS_ERROR);
+}
+
+void QAicOpenRtProgramCacheUnitTest::PlantedLinkTest() {
+  // Another user of a shared cache directory links the entry to a file of
+  // ours, storing must replace the link and never write through it
+  const std::string victim = root_ + "/victim";
+  writeFile(victim, {1, 2, 3});
+  std::filesystem::create_directories(cacheDir_);
+  QProgramCache cache(cacheDir_);
+  QProgramCacheKey key = makeKey();
+  std::filesystem::create_symlink(victim, cache.getEntryPath(key));
+
+  ASSERT_TRUE(cache.store(key, makeEntry()) == QS_SUCCESS);
+  ASSERT_TRUE((readFile(victim) == std::vector<uint8_t>{1, 2, 3}));
+  auto status = std::filesystem::symlink_status(cache.getEntryPath(key));
+  ASSERT_TRUE(status.type() == std::filesystem::file_type::regular);
+  // Readable by the owner only
+  ASSERT_TRUE(status.permissions() == (std::filesystem::perms::owner_read |
+                                       std::filesystem::perms::owner_write));
+  QProgramCacheEntry entry;
+  ASSERT_TRUE(cache.lookup(key, entry) == QS_SUCCESS);
+  ASSERT_TRUE(isEqual(entry, makeEntry()));
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtProgramCacheUnitTest, HashTest) { HashTest(); }
+
+TEST_F(QAicOpenRtProgramCacheUnitTest, RoundTripTest) { RoundTripTest(); }
+
+TEST_F(QAicOpenRtProgramCacheUnitTest, KeyTest) { KeyTest(); }
+
+TEST_F(QAicOpenRtProgramCacheUnitTest, AdversarialCorruptEntryTest) {
+  CorruptEntryTest();
+}
+
+TEST_F(QAicOpenRtProgramCacheUnitTest, AdversarialForeignEntryTest) {
+  ForeignEntryTest();
+}
+
+TEST_F(QAicOpenRtProgramCacheUnitTest, ConcurrentStoreTest) {
+  ConcurrentStoreTest();
+}
+
+TEST_F(QAicOpenRtProgramCacheUnitTest, AdversarialUnwritableDirTest) {
+  UnwritableDirTest();
+}
+
+TEST_F(QAicOpenRtProgramCacheUnitTest, AdversarialPlantedLinkTest) {
+  PlantedLinkTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,335 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicOpenRtProgramSwap.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::openrt::ProgramSwap;
+using qaic::openrt::ProgramSwapOps;
+using qaic::openrt::ProgramSwapProperties;
+using qaic::openrt::ProgramSwapStats;
+using std::chrono::milliseconds;
+
+class QAicOpenRtProgramSwapUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtProgramSwapUnitTest(){};
+  ~QAicOpenRtProgramSwapUnitTest() = default;
+
+  QAicOpenRtProgramSwapUnitTest(const QAicOpenRtProgramSwapUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtProgramSwapUnitTest &
+  operator=(const QAicOpenRtProgramSwapUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void StandbySwapTest();
+  void SwapAfterDrainTest();
+  void DrainTimeoutTest();
+  void FailedSwapTest();
+  void InvalidOpsTest();
+
+  // Simulated device holding a number of activations, in standby or ready.
+  // Each program version takes one. A version released while requests
+  // still run on it is recorded as an error.
+  struct SimulatedDevice {
+    explicit SimulatedDevice(uint32_t slots) : numSlots(slots) {}
+
+    struct Version {
+      std::atomic_bool loaded{false};
+      std::atomic_bool active{false};
+      std::atomic_bool ready{false};
+      std::atomic<uint32_t> running{0};
+    };
+
+    ProgramSwapOps ops(Version &version) {
+      ProgramSwapOps o;
+      o.load = [&version]() {
+        version.loaded = true;
+        return QS_SUCCESS;
+      };
+      o.standby = [this, &version]() {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (!version.active) {
+          if (numActive == numSlots) {
+            return QS_ERROR;
+          }
+          numActive++;
+          version.active = true;
+        }
+        return QS_SUCCESS;
+      };
+      o.activate = [this, &version]() {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (failActivate || !version.loaded) {
+          return QS_ERROR;
+        }
+        if (!version.active) {
+          if (numActive == numSlots) {
+            return QS_ERROR;
+          }
+          numActive++;
+          version.active = true;
+        }
+        version.ready = true;
+        return QS_SUCCESS;
+      };
+      o.release = [this, &version]() {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (version.running != 0) {
+          numReleasedRunning++;
+        }
+        if (version.active) {
+          numActive--;
+        }
+        version.active = false;
+        version.ready = false;
+        version.loaded = false;
+        numReleased++;
+        return QS_SUCCESS;
+      };
+      return o;
+    }
+
+    std::mutex mutex;
+    const uint32_t numSlots;
+    uint32_t numActive = 0;
+    uint32_t numReleased = 0;
+    uint32_t numReleasedRunning = 0;
+    bool failActivate = false;
+  };
+
+  // Clients taking leases and running a request on the version they got
+  // until stopped. Counts requests that found no version.
+  struct Clients {
+    Clients(ProgramSwap &swap,
+            std::vector<SimulatedDevice::Version *> versions,
+            uint32_t numThreads) {
+      for (uint32_t t = 0; t < numThreads; t++) {
+        threads.emplace_back([&swap, versions, this]() {
+          while (!stop) {
+            ProgramSwap::Lease lease = swap.acquire();
+            if (!lease) {
+              numMissed++;
+              continue;
+            }
+            SimulatedDevice::Version *version =
+                versions.at(lease.getVersion() - 1);
+            if (!version->ready) {
+              numNotReady++;
+            }
+            version->running++;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            version->running--;
+            numServed++;
+          }
+        });
+      }
+    }
+    ~Clients() { join(); }
+    void join() {
+      stop = true;
+      for (auto &thread : threads) {
+        if (thread.joinable()) {
+          thread.join();
+        }
+      }
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic_bool stop{false};
+    std::atomic<uint32_t> numServed{0};
+    std::atomic<uint32_t> numMissed{0};
+    std::atomic<uint32_t> numNotReady{0};
+  };
+};
+
+void QAicOpenRtProgramSwapUnitTest::StandbySwapTest() {
+  SimulatedDevice device(2);
+  SimulatedDevice::Version v1;
+  SimulatedDevice::Version v2;
+  SimulatedDevice::Version v3;
+  auto swap = ProgramSwap::Factory(device.ops(v1));
+  ASSERT_EQ(swap->getVersion(), 1u);
+
+  Clients clients(*swap, {&v1, &v2, &v3}, 4);
+  std::this_thread::sleep_for(milliseconds(20));
+  ASSERT_EQ(swap->swap(device.ops(v2)), QS_SUCCESS);
+  ProgramSwapStats stats = swap->getLastSwapStats();
+  ASSERT_EQ(stats.version, 2u);
+  ASSERT_TRUE(stats.standby);
+  ASSERT_EQ(stats.gap.count(), 0);
+  ASSERT_EQ(swap->getVersion(), 2u);
+  // The old version is released only once its requests completed
+  ASSERT_FALSE(v1.active);
+  ASSERT_EQ(device.numReleasedRunning, 0u);
+
+  std::this_thread::sleep_for(milliseconds(20));
+  ASSERT_EQ(swap->swap(device.ops(v3)), QS_SUCCESS);
+  std::this_thread::sleep_for(milliseconds(20));
+  clients.join();
+
+  // Requests never waited for a version nor ran on one not ready
+  ASSERT_EQ(clients.numMissed, 0u);
+  ASSERT_EQ(clients.numNotReady, 0u);
+  ASSERT_GT(clients.numServed, 0u);
+  ASSERT_EQ(device.numReleased, 2u);
+  ASSERT_EQ(device.numReleasedRunning, 0u);
+  ASSERT_EQ(device.numActive, 1u);
+  ASSERT_EQ(swap->getNumRetired(), 0u);
+}
+
+void QAicOpenRtProgramSwapUnitTest::SwapAfterDrainTest() {
+  // A device holding one activation cannot take the new version in standby
+  SimulatedDevice device(1);
+  SimulatedDevice::Version v1;
+  SimulatedDevice::Version v2;
+  auto swap = ProgramSwap::Factory(device.ops(v1));
+
+  Clients clients(*swap, {&v1, &v2}, 4);
+  std::this_thread::sleep_for(milliseconds(20));
+  ASSERT_EQ(swap->swap(device.ops(v2)), QS_SUCCESS);
+  ProgramSwapStats stats = swap->getLastSwapStats();
+  ASSERT_FALSE(stats.standby);
+  ASSERT_GT(stats.gap.count(), 0);
+  std::this_thread::sleep_for(milliseconds(20));
+  clients.join();
+
+  // Requests arriving during the swap waited for the new version
+  ASSERT_EQ(clients.numMissed, 0u);
+  ASSERT_EQ(clients.numNotReady, 0u);
+  ASSERT_EQ(device.numReleasedRunning, 0u);
+  ASSERT_FALSE(v1.active);
+  ASSERT_TRUE(v2.ready);
+  ASSERT_EQ(swap->getVersion(), 2u);
+}
+
+void QAicOpenRtProgramSwapUnitTest::DrainTimeoutTest() {
+  SimulatedDevice device(3);
+  SimulatedDevice::Version v1;
+  SimulatedDevice::Version v2;
+  SimulatedDevice::Version v3;
+  ProgramSwapProperties properties;
+  properties.drainTimeout = milliseconds(10);
+  auto swap = ProgramSwap::Factory(device.ops(v1), properties);
+
+  ProgramSwap::Lease lease = swap->acquire();
+  ASSERT_EQ(lease.getVersion(), 1u);
+  // The new version serves, the old one is kept until its lease returns
+  ASSERT_EQ(swap->swap(device.ops(v2)), QS_SUCCESS);
+  ASSERT_EQ(swap->getVersion(), 2u);
+  ASSERT_EQ(swap->getNumRetired(), 1u);
+  ASSERT_TRUE(v1.active);
+  ASSERT_EQ(swap->acquire().getVersion(), 2u);
+
+  // Released by the next swap
+  lease.reset();
+  ASSERT_FALSE(lease);
+  ASSERT_EQ(swap->swap(device.ops(v3)), QS_SUCCESS);
+  ASSERT_EQ(swap->getNumRetired(), 0u);
+  ASSERT_FALSE(v1.active);
+  ASSERT_FALSE(v2.active);
+  ASSERT_EQ(device.numReleased, 2u);
+
+  // Destruction releases the version serving
+  swap.reset();
+  ASSERT_FALSE(v3.active);
+  ASSERT_EQ(device.numActive, 0u);
+}
+
+void QAicOpenRtProgramSwapUnitTest::FailedSwapTest() {
+  SimulatedDevice device(1);
+  SimulatedDevice::Version v1;
+  SimulatedDevice::Version v2;
+  SimulatedDevice::Version v3;
+  ProgramSwapProperties properties;
+  properties.drainTimeout = milliseconds(10);
+  auto swap = ProgramSwap::Factory(device.ops(v1), properties);
+
+  // A failed load leaves the old version serving
+  ProgramSwapOps ops = device.ops(v2);
+  ops.load = []() { return QS_ERROR; };
+  ASSERT_EQ(swap->swap(ops), QS_ERROR);
+  ASSERT_EQ(swap->getVersion(), 1u);
+  ASSERT_TRUE(v1.ready);
+
+  // An old version that does not drain keeps serving
+  {
+    ProgramSwap::Lease lease = swap->acquire();
+    ASSERT_EQ(swap->swap(device.ops(v2)), QS_TIMEDOUT);
+    ASSERT_EQ(swap->getVersion(), 1u);
+    ASSERT_TRUE(v1.ready);
+    ASSERT_FALSE(v2.loaded);
+  }
+
+  // A new version failing to activate is rolled back to the old one
+  device.failActivate = true;
+  ASSERT_EQ(swap->swap(device.ops(v3)), QS_ERROR);
+  ASSERT_EQ(swap->getVersion(), 0u);
+  device.failActivate = false;
+  ASSERT_EQ(swap->swap(device.ops(v3)), QS_SUCCESS);
+  ASSERT_EQ(swap->getVersion(), 5u);
+  ASSERT_TRUE(v3.ready);
+}
+
+void QAicOpenRtProgramSwapUnitTest::InvalidOpsTest() {
+  SimulatedDevice device(2);
+  SimulatedDevice::Version v1;
+  SimulatedDevice::Version v2;
+
+  ProgramSwapOps missing = device.ops(v1);
+  missing.release = nullptr;
+  ASSERT_THROW(ProgramSwap::Factory(missing),
+               qaic::openrt::CoreExceptionInit);
+
+  ProgramSwapOps failing = device.ops(v1);
+  failing.activate = []() { return QS_ERROR; };
+  ASSERT_THROW(ProgramSwap::Factory(failing),
+               qaic::openrt::CoreExceptionInit);
+
+  auto swap = ProgramSwap::Factory(device.ops(v1));
+  ASSERT_EQ(swap->swap(missing), QS_INVAL);
+  ASSERT_EQ(swap->swap(qaic::openrt::shProgram()), QS_INVAL);
+
+  // Without standby the swap goes through drain even with room to spare
+  ProgramSwapOps noStandby = device.ops(v2);
+  noStandby.standby = nullptr;
+  ASSERT_EQ(swap->swap(noStandby), QS_SUCCESS);
+  ASSERT_FALSE(swap->getLastSwapStats().standby);
+  ASSERT_FALSE(v1.active);
+  ASSERT_TRUE(v2.ready);
+
+  // Destruction does not wait for new requests
+  swap.reset();
+  ASSERT_EQ(device.numActive, 0u);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtProgramSwapUnitTest, StandbySwapTest) { StandbySwapTest(); }
+
+TEST_F(QAicOpenRtProgramSwapUnitTest, SwapAfterDrainTest) {
+  SwapAfterDrainTest();
+}
+
+TEST_F(QAicOpenRtProgramSwapUnitTest, DrainTimeoutTest) { DrainTimeoutTest(); }
+
+TEST_F(QAicOpenRtProgramSwapUnitTest, AdversarialFailedSwapTest) {
+  FailedSwapTest();
+}
+
+TEST_F(QAicOpenRtProgramSwapUnitTest, AdversarialInvalidOpsTest) {
+  InvalidOpsTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,344 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QAicQpc.h"
+
+#include <chrono>
+#include <random>
+
+namespace QAicOpenRtUnitTest {
+
+class QAicOpenRtQpcCompressionUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtQpcCompressionUnitTest(){};
+  ~QAicOpenRtQpcCompressionUnitTest() = default;
+
+  QAicOpenRtQpcCompressionUnitTest(const QAicOpenRtQpcCompressionUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtQpcCompressionUnitTest &
+  operator=(const QAicOpenRtQpcCompressionUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  static constexpr uint32_t blockSize = 4096;
+
+  void QpcCompressionRoundTripTest();
+  void QpcCompressionFileTest();
+  void QpcDecompressionThroughputTest();
+  void QpcCompressionCorruptTest();
+
+  // Constants like data: runs of repeated weights mixed with noise
+  std::vector<uint8_t> syntheticConstants(size_t size, uint32_t seed);
+  QAicQpcHandle *buildCompressed(std::vector<uint8_t> &constants,
+                                 uint64_t staticSize, uint32_t numThreads);
+  std::vector<uint8_t> streamRange(const uint8_t *qpcBuf, uint64_t start,
+                                   uint64_t size, unsigned numThreads);
+
+  std::string constantsDesc_{"constantsdesc"};
+  std::string networkElf_ = std::string(20000, 'e');
+};
+
+std::vector<uint8_t>
+QAicOpenRtQpcCompressionUnitTest::syntheticConstants(size_t size,
+                                                     uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::vector<uint8_t> data(size);
+  size_t pos = 0;
+  while (pos < size) {
+    size_t run = std::min<size_t>(size - pos, 16 + gen() % 512);
+    if (gen() % 4 == 0) {
+      for (size_t i = 0; i < run; i++) {
+        data[pos + i] = static_cast<uint8_t>(gen());
+      }
+    } else {
+      std::fill_n(data.begin() + pos, run, static_cast<uint8_t>(gen() % 8));
+    }
+    pos += run;
+  }
+  return data;
+}
+
+QAicQpcHandle *QAicOpenRtQpcCompressionUnitTest::buildCompressed(
+    std::vector<uint8_t> &constants, uint64_t staticSize,
+    uint32_t numThreads) {
+  std::vector<QpcSegment> segments;
+  segments.emplace_back(constantsDesc_.size(), 0,
+                        const_cast<char *>("constantsdesc.bin"),
+                        reinterpret_cast<uint8_t *>(constantsDesc_.data()));
+  segments.emplace_back(networkElf_.size(), 0,
+                        const_cast<char *>("network.elf"),
+                        reinterpret_cast<uint8_t *>(networkElf_.data()));
+  segments.emplace_back(constants.size(), staticSize,
+                        const_cast<char *>("constants.bin"), constants.data());
+
+  QpcCompressionOptions options;
+  options.blockSize = blockSize;
+  options.numThreads = numThreads;
+
+  QAicQpcHandle *handle = nullptr;
+  if ((createQpcHandle(&handle, COMPRESSED) != 0) ||
+      (setQpcCompressionOptions(handle, options) != 0) ||
+      (buildFromSegments(handle, segments.data(), segments.size()) != 0)) {
+    destroyQpcHandle(handle);
+    return nullptr;
+  }
+  return handle;
+}
+
+std::vector<uint8_t> QAicOpenRtQpcCompressionUnitTest::streamRange(
+    const uint8_t *qpcBuf, uint64_t start, uint64_t size, unsigned numThreads) {
+  std::vector<uint8_t> out;
+  uint64_t expectedOffset = start;
+  int rc = streamQPCSegment(
+      qpcBuf, "constants.bin", start, size, numThreads,
+      [&](const uint8_t *chunk, size_t chunkSize, uint64_t rawOffset) {
+        // Chunks arrive in order and back to back
+        if (rawOffset != expectedOffset) {
+          return -1;
+        }
+        expectedOffset += chunkSize;
+        out.insert(out.end(), chunk, chunk + chunkSize);
+        return 0;
+      });
+  if (rc != 0) {
+    out.clear();
+  }
+  return out;
+}
+
+void QAicOpenRtQpcCompressionUnitTest::QpcCompressionRoundTripTest() {
+  // Not a multiple of the block size, static part ends mid block
+  std::vector<uint8_t> constants = syntheticConstants(40 * blockSize + 123, 1);
+  const uint64_t staticSize = 17 * blockSize + 7;
+
+  QAicQpcHandle *handle = buildCompressed(constants, staticSize, 4);
+  ASSERT_TRUE(handle != nullptr);
+  uint8_t *qpcBuf = nullptr;
+  size_t qpcSize = 0;
+  ASSERT_TRUE(getSerializedQpc(handle, &qpcBuf, &qpcSize) == 0);
+  ASSERT_TRUE(isQpcCompressed(qpcBuf));
+  LogInfo("Constants {} bytes, QPC {} bytes", constants.size(), qpcSize);
+  ASSERT_TRUE(qpcSize < constants.size());
+
+  size_t rawSize = 0;
+  size_t rawOffset = 0;
+  ASSERT_TRUE(getQPCSegmentSize(qpcBuf, "constants.bin", &rawSize,
+                                &rawOffset) == 0);
+  ASSERT_TRUE(rawSize == constants.size());
+  ASSERT_TRUE(rawOffset == staticSize);
+  ASSERT_TRUE(getQPCSegmentSize(qpcBuf, "missing", &rawSize, &rawOffset) ==
+              -ENOENT);
+
+  std::vector<uint8_t> segment;
+  ASSERT_TRUE(readQPCSegment(qpcBuf, "constants.bin", segment, 3) == 0);
+  ASSERT_TRUE(segment == constants);
+  ASSERT_TRUE(readQPCSegment(qpcBuf, "network.elf", segment, 0) == 0);
+  ASSERT_TRUE(std::string(segment.begin(), segment.end()) == networkElf_);
+
+  // Small segments stay uncompressed and are returned in place
+  uint8_t *segBuf = nullptr;
+  size_t segSize = 0;
+  ASSERT_TRUE(getQPCSegment(qpcBuf, "constantsdesc.bin", &segBuf, &segSize, 0));
+  ASSERT_TRUE(std::string(reinterpret_cast<char *>(segBuf), segSize) ==
+              constantsDesc_);
+  ASSERT_FALSE(getQPCSegment(qpcBuf, "constants.bin", &segBuf, &segSize, 0));
+
+  // Static and dynamic ranges stream independently
+  std::vector<uint8_t> staticPart = streamRange(qpcBuf, 0, staticSize, 2);
+  ASSERT_TRUE(std::equal(staticPart.begin(), staticPart.end(),
+                         constants.begin()) &&
+              (staticPart.size() == staticSize));
+  std::vector<uint8_t> dynamicPart =
+      streamRange(qpcBuf, staticSize, constants.size() - staticSize, 3);
+  ASSERT_TRUE(std::equal(dynamicPart.begin(), dynamicPart.end(),
+                         constants.begin() + staticSize) &&
+              (dynamicPart.size() == constants.size() - staticSize));
+
+  // A relocated copy decodes the same
+  std::unique_ptr<uint8_t[]> copy(new uint8_t[qpcSize]);
+  ASSERT_TRUE(copyQpcBuffer(copy.get(), qpcBuf, qpcSize) == copy.get());
+  ASSERT_TRUE(readQPCSegment(copy.get(), "constants.bin", segment, 0) == 0);
+  ASSERT_TRUE(segment == constants);
+
+  // Stored bytes are the compressed form, identical in the copy
+  const uint8_t *stored = nullptr;
+  size_t storedSize = 0;
+  ASSERT_TRUE(getQPCStoredSegment(qpcBuf, "constants.bin", &stored,
+                                  &storedSize) == 0);
+  ASSERT_TRUE((storedSize > 0) && (storedSize < constants.size()));
+  const uint8_t *copyStored = nullptr;
+  size_t copyStoredSize = 0;
+  ASSERT_TRUE(getQPCStoredSegment(copy.get(), "constants.bin", &copyStored,
+                                  &copyStoredSize) == 0);
+  ASSERT_TRUE((copyStoredSize == storedSize) &&
+              std::equal(stored, stored + storedSize, copyStored));
+  ASSERT_TRUE(getQPCStoredSegment(qpcBuf, "missing", &stored, &storedSize) ==
+              -ENOENT);
+
+  // Rebuilding as SLOWPATH expands every segment
+  QAicQpcHandle *slowHandle = nullptr;
+  ASSERT_TRUE(createQpcHandle(&slowHandle, SLOWPATH) == 0);
+  QAicQpc *qpc = nullptr;
+  ASSERT_TRUE(getQpc(handle, &qpc) == 0);
+  ASSERT_TRUE(buildFromQpc(slowHandle, qpc) == 0);
+  uint8_t *slowBuf = nullptr;
+  ASSERT_TRUE(getSerializedQpc(slowHandle, &slowBuf, &qpcSize) == 0);
+  ASSERT_FALSE(isQpcCompressed(slowBuf));
+  ASSERT_TRUE(getQPCSegment(slowBuf, "constants.bin", &segBuf, &segSize, 0));
+  ASSERT_TRUE((segSize == staticSize) &&
+              std::equal(segBuf, segBuf + segSize, constants.begin()));
+
+  destroyQpcHandle(slowHandle);
+  destroyQpcHandle(handle);
+}
+
+void QAicOpenRtQpcCompressionUnitTest::QpcCompressionFileTest() {
+  std::vector<uint8_t> constants = syntheticConstants(64 * blockSize + 1, 2);
+  const std::string constantsPath = "/tmp/" + testName() + ".constants.bin";
+  const std::string qpcPath = "/tmp/" + testName() + ".qpc";
+  {
+    std::ofstream ofs(constantsPath, std::ios::binary);
+    ofs.write(reinterpret_cast<const char *>(constants.data()),
+              constants.size());
+  }
+
+  std::vector<QpcSegmentDesc> segmentVec;
+  segmentVec.emplace_back(networkElf_.size(), 0,
+                          const_cast<char *>("network.elf"),
+                          reinterpret_cast<uint8_t *>(networkElf_.data()));
+  segmentVec.emplace_back(32 * blockSize, const_cast<char *>("constants.bin"),
+                          constantsPath.c_str());
+
+  QpcCompressionOptions options;
+  options.blockSize = blockSize;
+  options.numThreads = 4;
+  ASSERT_TRUE(buildFromSegments(segmentVec, qpcPath, options) == 0);
+
+  std::ifstream ifs(qpcPath, std::ios::binary | std::ios::ate);
+  ASSERT_TRUE(ifs.good());
+  size_t qpcSize = static_cast<size_t>(ifs.tellg());
+  ifs.seekg(0);
+  std::unique_ptr<uint8_t[]> qpcBuf(new uint8_t[qpcSize]);
+  ifs.read(reinterpret_cast<char *>(qpcBuf.get()), qpcSize);
+  ASSERT_TRUE(copyQpcBuffer(qpcBuf.get(), qpcBuf.get(), qpcSize) ==
+              qpcBuf.get());
+  ASSERT_TRUE(isQpcCompressed(qpcBuf.get()));
+
+  std::vector<uint8_t> segment;
+  ASSERT_TRUE(readQPCSegment(qpcBuf.get(), "constants.bin", segment, 0) == 0);
+  ASSERT_TRUE(segment == constants);
+  ASSERT_TRUE(streamRange(qpcBuf.get(), 0, constants.size(), 4) == constants);
+
+  std::remove(constantsPath.c_str());
+  std::remove(qpcPath.c_str());
+}
+
+void QAicOpenRtQpcCompressionUnitTest::QpcDecompressionThroughputTest() {
+  std::vector<uint8_t> constants = syntheticConstants(64 * 1024 * 1024, 3);
+  std::vector<QpcSegment> segments;
+  segments.emplace_back(constants.size(), 0,
+                        const_cast<char *>("constants.bin"), constants.data());
+  QAicQpcHandle *handle = nullptr;
+  ASSERT_TRUE(createQpcHandle(&handle, COMPRESSED) == 0);
+
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(buildFromSegments(handle, segments.data(), segments.size()) ==
+              0);
+  double compressMs = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  uint8_t *qpcBuf = nullptr;
+  size_t qpcSize = 0;
+  ASSERT_TRUE(getSerializedQpc(handle, &qpcBuf, &qpcSize) == 0);
+  LogInfo("Compressed {} MiB to {} MiB in {:.1f} ms", constants.size() >> 20,
+          qpcSize >> 20, compressMs);
+
+  for (unsigned numThreads : {1u, 0u}) {
+    std::vector<uint8_t> segment;
+    start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(readQPCSegment(qpcBuf, "constants.bin", segment, numThreads) ==
+                0);
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    ASSERT_TRUE(segment == constants);
+    LogInfo("Decompressed with {} threads at {:.0f} MiB/s", numThreads,
+            (constants.size() >> 20) / (ms / 1000));
+  }
+
+  destroyQpcHandle(handle);
+}
+
+void QAicOpenRtQpcCompressionUnitTest::QpcCompressionCorruptTest() {
+  std::vector<uint8_t> constants = syntheticConstants(8 * blockSize, 4);
+  QAicQpcHandle *handle = buildCompressed(constants, 0, 2);
+  ASSERT_TRUE(handle != nullptr);
+  QAicQpc *qpc = nullptr;
+  ASSERT_TRUE(getQpc(handle, &qpc) == 0);
+  const uint8_t *qpcBuf = reinterpret_cast<const uint8_t *>(qpc);
+  QpcSegment *segment = &qpc->images[2];
+  ASSERT_TRUE(strcmp(segment->name, "constants.bin") == 0);
+  std::vector<uint8_t> out;
+
+  // Invalid requests
+  QpcCompressionOptions options;
+  options.blockSize = 0;
+  ASSERT_TRUE(setQpcCompressionOptions(handle, options) == -EINVAL);
+  ASSERT_TRUE(streamRange(qpcBuf, 1, constants.size(), 1).empty());
+  auto abort = [](const uint8_t *, size_t, uint64_t) { return -ECANCELED; };
+  ASSERT_TRUE(streamQPCSegment(qpcBuf, "constants.bin", 0, constants.size(),
+                               1, abort) == -ECANCELED);
+
+  // Garbage in the first block
+  QpcCompressedSegmentHeader hdr;
+  memcpy(&hdr, segment->start, sizeof(hdr));
+  uint8_t *blocks = segment->start + sizeof(hdr) + hdr.numBlocks * 4;
+  std::vector<uint8_t> saved(blocks, blocks + 64);
+  memset(blocks, 0xff, saved.size());
+  ASSERT_TRUE(readQPCSegment(qpcBuf, "constants.bin", out, 0) == -EBADMSG);
+  ASSERT_TRUE(streamRange(qpcBuf, 0, constants.size(), 2).empty());
+  std::copy(saved.begin(), saved.end(), blocks);
+  ASSERT_TRUE(readQPCSegment(qpcBuf, "constants.bin", out, 0) == 0);
+
+  // Block table pointing past the segment
+  uint32_t *table = reinterpret_cast<uint32_t *>(segment->start + sizeof(hdr));
+  uint32_t savedSize = table[1];
+  table[1] = 0x7fffffff;
+  ASSERT_TRUE(readQPCSegment(qpcBuf, "constants.bin", out, 0) == -EBADMSG);
+  table[1] = savedSize;
+
+  // Bad segment header
+  segment->start[0] ^= 0xff;
+  size_t rawSize = 0;
+  size_t rawOffset = 0;
+  ASSERT_TRUE(getQPCSegmentSize(qpcBuf, "constants.bin", &rawSize,
+                                &rawOffset) == -EBADMSG);
+  ASSERT_TRUE(readQPCSegment(qpcBuf, "constants.bin", out, 0) == -EBADMSG);
+  segment->start[0] ^= 0xff;
+
+  destroyQpcHandle(handle);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtQpcCompressionUnitTest, QpcCompressionRoundTripTest) {
+  QpcCompressionRoundTripTest();
+}
+
+TEST_F(QAicOpenRtQpcCompressionUnitTest, QpcCompressionFileTest) {
+  QpcCompressionFileTest();
+}
+
+TEST_F(QAicOpenRtQpcCompressionUnitTest, QpcDecompressionThroughputTest) {
+  QpcDecompressionThroughputTest();
+}
+
+TEST_F(QAicOpenRtQpcCompressionUnitTest, AdversarialQpcCompressionCorruptTest) {
+  QpcCompressionCorruptTest();
+}
+
+} // namespace QAicOpenRtUnitTest
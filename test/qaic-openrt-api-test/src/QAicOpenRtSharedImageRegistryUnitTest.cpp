@@ -0,0 +1,636 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QSharedImageRegistry.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::QSharedImageClaim;
+using qaic::QSharedImageKey;
+using qaic::QSharedImageKind;
+using qaic::QSharedImageRegistry;
+using std::chrono::milliseconds;
+
+class QAicOpenRtSharedImageRegistryUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtSharedImageRegistryUnitTest() : name_(uniqueName()) {
+    device_ = static_cast<SimulatedDevice *>(
+        mmap(nullptr, sizeof(SimulatedDevice), PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    new (device_) SimulatedDevice();
+  }
+  ~QAicOpenRtSharedImageRegistryUnitTest() {
+    (void)QSharedImageRegistry::unlink(name_);
+    munmap(device_, sizeof(SimulatedDevice));
+  }
+
+  QAicOpenRtSharedImageRegistryUnitTest(
+      const QAicOpenRtSharedImageRegistryUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtSharedImageRegistryUnitTest &
+  operator=(const QAicOpenRtSharedImageRegistryUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void ShareAcrossProcessesTest();
+  void RefCountTest();
+  void DeadProcessTest();
+  void PrivateFallbackTest();
+  void InvalidUseTest();
+  void LoaderExitTest();
+  void WatchLoaderExitTest();
+  void ForeignRegistryTest();
+
+  static constexpr uint32_t maxProcesses = 16;
+
+  // Device memory shared by the test processes, counts what was uploaded
+  struct SimulatedDevice {
+    std::atomic<uint32_t> numLoads{0};
+    std::atomic<uint32_t> numUnloads{0};
+    std::atomic<uint32_t> nextId{1};
+    std::atomic<uint32_t> arrived{0};
+    std::atomic<uint32_t> released{0};
+    std::atomic<uint32_t> ids[maxProcesses];
+
+    // Barrier of the test processes
+    static void wait(std::atomic<uint32_t> &count, uint32_t numProcesses) {
+      count++;
+      const auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while ((count < numProcesses) &&
+             (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(milliseconds(1));
+      }
+    }
+
+    uint32_t load() {
+      // An upload of a large image takes a while
+      std::this_thread::sleep_for(milliseconds(50));
+      numLoads++;
+      return nextId++;
+    }
+    void unload() { numUnloads++; }
+  };
+
+  static std::string uniqueName() {
+    static std::atomic<uint32_t> counter{0};
+    return "QAicRegistryTest" + std::to_string(getpid()) + "_" +
+           std::to_string(counter++);
+  }
+
+  // Content told apart by \p tag
+  static QSharedImageKey
+  key(uint64_t tag, QSharedImageKind kind = QSharedImageKind::Constants) {
+    QSharedImageKey k;
+    k.qid = 0;
+    k.kind = kind;
+    std::memcpy(k.digest.data(), &tag, sizeof(tag));
+    k.size = 1 << 20;
+    return k;
+  }
+
+  // Runs \p fn in \p numProcesses child processes, true if all returned true
+  static bool runProcesses(uint32_t numProcesses,
+                           const std::function<bool(uint32_t)> &fn) {
+    std::vector<pid_t> children;
+    for (uint32_t i = 0; i < numProcesses; i++) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        _exit(fn(i) ? 0 : 1);
+      }
+      if (pid < 0) {
+        return false;
+      }
+      children.push_back(pid);
+    }
+    bool ok = true;
+    for (pid_t pid : children) {
+      int wstatus = 0;
+      ok = (waitpid(pid, &wstatus, 0) == pid) && WIFEXITED(wstatus) &&
+           (WEXITSTATUS(wstatus) == 0) && ok;
+    }
+    return ok;
+  }
+
+  // Load the way QDeviceImageCommon does, through the registry
+  bool loadShared(QSharedImageRegistry &registry, const QSharedImageKey &k,
+                  uint32_t &id) {
+    QSharedImageClaim claim;
+    if (registry.acquire(k, claim, id, milliseconds(5000)) != QS_SUCCESS) {
+      return false;
+    }
+    if (claim == QSharedImageClaim::Load) {
+      id = device_->load();
+      return registry.publish(k, id) == QS_SUCCESS;
+    }
+    return claim == QSharedImageClaim::Reuse;
+  }
+
+  bool unloadShared(QSharedImageRegistry &registry, const QSharedImageKey &k,
+                    uint32_t id) {
+    bool lastHolder = false;
+    if (registry.release(k, id, lastHolder) != QS_SUCCESS) {
+      return false;
+    }
+    if (lastHolder) {
+      device_->unload();
+    }
+    return true;
+  }
+
+  std::string name_;
+  SimulatedDevice *device_;
+};
+
+void QAicOpenRtSharedImageRegistryUnitTest::ShareAcrossProcessesTest() {
+  const uint32_t numProcesses = 8;
+  const QSharedImageKey constants = key(0x1234);
+  const QSharedImageKey image = key(0x1234, QSharedImageKind::NetworkImage);
+
+  ASSERT_TRUE(runProcesses(numProcesses, [&](uint32_t i) {
+    QSharedImageRegistry registry(name_);
+    uint32_t id = 0;
+    uint32_t imageId = 0;
+    if ((registry.init() != QS_SUCCESS) ||
+        !loadShared(registry, constants, id) ||
+        !loadShared(registry, image, imageId)) {
+      return false;
+    }
+    device_->ids[i] = id;
+    // Everybody holds the load before anybody lets it go, and the loader
+    // does not exit while others hold it
+    device_->wait(device_->arrived, numProcesses);
+    bool ok = unloadShared(registry, constants, id) &&
+              unloadShared(registry, image, imageId);
+    device_->wait(device_->released, numProcesses);
+    return ok;
+  }));
+
+  // One upload and one unload of each, whatever the number of processes
+  ASSERT_EQ(device_->numLoads, 2u);
+  ASSERT_EQ(device_->numUnloads, 2u);
+  ASSERT_EQ(device_->arrived, numProcesses);
+  for (uint32_t i = 1; i < numProcesses; i++) {
+    ASSERT_EQ(device_->ids[i], device_->ids[0]);
+  }
+
+  QSharedImageRegistry registry(name_);
+  ASSERT_EQ(registry.init(), QS_SUCCESS);
+  ASSERT_EQ(registry.getNumHolders(constants), 0u);
+  ASSERT_EQ(registry.getNumHolders(image), 0u);
+}
+
+void QAicOpenRtSharedImageRegistryUnitTest::RefCountTest() {
+  QSharedImageRegistry registry(name_);
+  ASSERT_EQ(registry.init(), QS_SUCCESS);
+  const QSharedImageKey k = key(0xabcd);
+
+  // Threads of one process wait for each other's load as well
+  std::vector<std::thread> threads;
+  std::atomic<uint32_t> failed{0};
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() {
+      uint32_t id = 0;
+      if (!loadShared(registry, k, id)) {
+        failed++;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(failed, 0u);
+  ASSERT_EQ(device_->numLoads, 1u);
+  ASSERT_EQ(registry.getNumHolders(k), 4u);
+  const uint32_t loadedId = device_->nextId - 1;
+
+  for (int i = 0; i < 3; i++) {
+    bool lastHolder = true;
+    ASSERT_EQ(registry.release(k, loadedId, lastHolder), QS_SUCCESS);
+    ASSERT_FALSE(lastHolder);
+  }
+  bool lastHolder = false;
+  // Only the load that is held
+  ASSERT_EQ(registry.release(k, loadedId + 1, lastHolder), QS_INVAL);
+  ASSERT_EQ(registry.release(k, loadedId, lastHolder), QS_SUCCESS);
+  ASSERT_TRUE(lastHolder);
+  ASSERT_EQ(registry.getNumHolders(k), 0u);
+
+  // Unloaded content is loaded again, other content is independent
+  QSharedImageClaim claim;
+  uint32_t id = 0;
+  ASSERT_EQ(registry.acquire(k, claim, id, milliseconds(0)), QS_SUCCESS);
+  ASSERT_EQ(claim, QSharedImageClaim::Load);
+  QSharedImageKey other = k;
+  other.qid = 1;
+  ASSERT_EQ(registry.acquire(other, claim, id, milliseconds(0)), QS_SUCCESS);
+  ASSERT_EQ(claim, QSharedImageClaim::Load);
+  ASSERT_EQ(registry.abandon(k), QS_SUCCESS);
+  ASSERT_EQ(registry.abandon(other), QS_SUCCESS);
+}
+
+void QAicOpenRtSharedImageRegistryUnitTest::DeadProcessTest() {
+  QSharedImageRegistry registry(name_);
+  ASSERT_EQ(registry.init(), QS_SUCCESS);
+  const QSharedImageKey k = key(0x5678);
+
+  // A holder exiting without releasing is pruned
+  uint32_t id = 0;
+  ASSERT_TRUE(loadShared(registry, k, id));
+  ASSERT_TRUE(runProcesses(1, [&](uint32_t) {
+    QSharedImageRegistry child(name_);
+    uint32_t childId = 0;
+    return (child.init() == QS_SUCCESS) && loadShared(child, k, childId) &&
+           (childId == id);
+  }));
+  ASSERT_EQ(registry.getNumHolders(k), 1u);
+  ASSERT_TRUE(unloadShared(registry, k, id));
+  ASSERT_EQ(device_->numUnloads, 1u);
+
+  // The device released what an exited process loaded, it is loaded again
+  ASSERT_TRUE(runProcesses(1, [&](uint32_t) {
+    QSharedImageRegistry child(name_);
+    uint32_t childId = 0;
+    return (child.init() == QS_SUCCESS) && loadShared(child, k, childId);
+  }));
+  QSharedImageClaim claim;
+  ASSERT_EQ(registry.acquire(k, claim, id, milliseconds(0)), QS_SUCCESS);
+  ASSERT_EQ(claim, QSharedImageClaim::Load);
+  ASSERT_EQ(registry.abandon(k), QS_SUCCESS);
+
+  // Nor is a load that an exited process never finished waited for
+  ASSERT_TRUE(runProcesses(1, [&](uint32_t) {
+    QSharedImageRegistry child(name_);
+    QSharedImageClaim childClaim;
+    uint32_t childId = 0;
+    return (child.init() == QS_SUCCESS) &&
+           (child.acquire(k, childClaim, childId, milliseconds(0)) ==
+            QS_SUCCESS) &&
+           (childClaim == QSharedImageClaim::Load);
+  }));
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(registry.acquire(k, claim, id, milliseconds(5000)), QS_SUCCESS);
+  ASSERT_EQ(claim, QSharedImageClaim::Load);
+  ASSERT_LT(std::chrono::steady_clock::now() - start, milliseconds(1000));
+  ASSERT_EQ(registry.abandon(k), QS_SUCCESS);
+}
+
+void QAicOpenRtSharedImageRegistryUnitTest::PrivateFallbackTest() {
+  QSharedImageRegistry registry(name_);
+  ASSERT_EQ(registry.init(), QS_SUCCESS);
+  QSharedImageClaim claim;
+  uint32_t id = 0;
+
+  // A load that takes longer than the wait is done privately
+  ASSERT_EQ(registry.acquire(key(1), claim, id, milliseconds(0)), QS_SUCCESS);
+  ASSERT_EQ(claim, QSharedImageClaim::Load);
+  ASSERT_EQ(registry.acquire(key(1), claim, id, milliseconds(20)),
+            QS_SUCCESS);
+  ASSERT_EQ(claim, QSharedImageClaim::Private);
+
+  // So is anything past a full table
+  for (uint64_t tag = 2; tag <= QSharedImageRegistry::maxEntries; tag++) {
+    ASSERT_EQ(registry.acquire(key(tag), claim, id, milliseconds(0)),
+              QS_SUCCESS);
+    ASSERT_EQ(claim, QSharedImageClaim::Load);
+  }
+  ASSERT_EQ(registry.acquire(key(0), claim, id, milliseconds(0)), QS_SUCCESS);
+  ASSERT_EQ(claim, QSharedImageClaim::Private);
+
+  // A freed entry is used again
+  ASSERT_EQ(registry.abandon(key(7)), QS_SUCCESS);
+  ASSERT_EQ(registry.acquire(key(0), claim, id, milliseconds(0)), QS_SUCCESS);
+  ASSERT_EQ(claim, QSharedImageClaim::Load);
+}
+
+void QAicOpenRtSharedImageRegistryUnitTest::InvalidUseTest() {
+  const QSharedImageKey k = key(42);
+  QSharedImageClaim claim;
+  uint32_t id = 0;
+  bool lastHolder = true;
+
+  // Not opened
+  QSharedImageRegistry closed(name_);
+  ASSERT_EQ(closed.acquire(k, claim, id, milliseconds(0)), QS_INVAL);
+  ASSERT_EQ(closed.publish(k, 1), QS_INVAL);
+  ASSERT_EQ(closed.release(k, 1, lastHolder), QS_INVAL);
+  ASSERT_FALSE(closed.isLoaded(k, 1));
+  ASSERT_FALSE(lastHolder);
+
+  QSharedImageRegistry registry(name_);
+  ASSERT_EQ(registry.init(), QS_SUCCESS);
+  ASSERT_EQ(registry.init(), QS_SUCCESS);
+  // Unknown content
+  ASSERT_EQ(registry.publish(k, 1), QS_INVAL);
+  ASSERT_EQ(registry.abandon(k), QS_INVAL);
+  ASSERT_EQ(registry.release(k, 1, lastHolder), QS_INVAL);
+  ASSERT_EQ(registry.getNumHolders(k), 0u);
+
+  // A load is released only once published, and published only once
+  ASSERT_EQ(registry.acquire(k, claim, id, milliseconds(0)), QS_SUCCESS);
+  ASSERT_EQ(claim, QSharedImageClaim::Load);
+  ASSERT_EQ(registry.release(k, 9, lastHolder), QS_INVAL);
+  ASSERT_FALSE(registry.isLoaded(k, 9));
+  ASSERT_EQ(registry.publish(k, 9), QS_SUCCESS);
+  ASSERT_TRUE(registry.isLoaded(k, 9));
+  ASSERT_EQ(registry.publish(k, 10), QS_INVAL);
+  ASSERT_EQ(registry.abandon(k), QS_INVAL);
+
+  // Only the process holding a load releases it
+  ASSERT_TRUE(runProcesses(1, [&](uint32_t) {
+    QSharedImageRegistry child(name_);
+    bool childLast = false;
+    return (child.init() == QS_SUCCESS) &&
+           (child.release(k, 9, childLast) == QS_INVAL) &&
+           (child.abandon(k) == QS_INVAL);
+  }));
+  ASSERT_EQ(registry.release(k, 9, lastHolder), QS_SUCCESS);
+  ASSERT_TRUE(lastHolder);
+  ASSERT_EQ(registry.release(k, 9, lastHolder), QS_INVAL);
+
+  // Memory of another layout under the same name is not taken over
+  const std::string foreign = uniqueName();
+  int fd = shm_open(foreign.c_str(), O_CREAT | O_RDWR, 0600);
+  ASSERT_NE(fd, -1);
+  std::vector<uint8_t> garbage(4096, 0xa5);
+  ASSERT_EQ(write(fd, garbage.data(), garbage.size()),
+            static_cast<ssize_t>(garbage.size()));
+  close(fd);
+  QSharedImageRegistry corrupt(foreign);
+  ASSERT_EQ(corrupt.init(), QS_ERROR);
+  ASSERT_EQ(corrupt.acquire(k, claim, id, milliseconds(0)), QS_INVAL);
+  ASSERT_EQ(QSharedImageRegistry::unlink(foreign), QS_SUCCESS);
+
+  // Opt-in, without a name the process keeps its loads to itself
+  if (std::getenv("QAIC_SHARED_IMAGE_REGISTRY") == nullptr) {
+    ASSERT_EQ(qaic::QSharedImageRegistryManager::getRegistry(), nullptr);
+  }
+}
+
+void QAicOpenRtSharedImageRegistryUnitTest::LoaderExitTest() {
+  QSharedImageRegistry registry(name_);
+  ASSERT_EQ(registry.init(), QS_SUCCESS);
+  const QSharedImageKey k = key(0x9abc, QSharedImageKind::NetworkImage);
+
+  // Another process loads, this one attaches and outlives it
+  bool loaderExited = false;
+  std::thread loader([&]() {
+    loaderExited = runProcesses(1, [&](uint32_t) {
+      QSharedImageRegistry child(name_);
+      uint32_t childId = 0;
+      if ((child.init() != QS_SUCCESS) || !loadShared(child, k, childId)) {
+        return false;
+      }
+      device_->ids[0] = childId;
+      // Exits without releasing, along with its load on the device
+      device_->wait(device_->arrived, 2);
+      return true;
+    });
+  });
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while ((device_->ids[0] == 0) &&
+         (std::chrono::steady_clock::now() < deadline)) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  uint32_t id = 0;
+  ASSERT_TRUE(loadShared(registry, k, id));
+  device_->wait(device_->arrived, 2);
+  loader.join();
+  ASSERT_TRUE(loaderExited);
+  ASSERT_EQ(id, device_->ids[0]);
+  ASSERT_EQ(device_->numLoads, 1u);
+
+  // The holder finds its load gone and loads it again, what it held went
+  // with the loader
+  ASSERT_FALSE(registry.isLoaded(k, id));
+  bool lastHolder = true;
+  ASSERT_EQ(registry.release(k, id, lastHolder), QS_INVAL);
+  ASSERT_FALSE(lastHolder);
+  uint32_t newId = 0;
+  ASSERT_TRUE(loadShared(registry, k, newId));
+  ASSERT_NE(newId, id);
+  ASSERT_EQ(device_->numLoads, 2u);
+  ASSERT_TRUE(registry.isLoaded(k, newId));
+
+  // The other holders attach to the new load
+  ASSERT_TRUE(runProcesses(2, [&](uint32_t i) {
+    QSharedImageRegistry child(name_);
+    uint32_t childId = 0;
+    if ((child.init() != QS_SUCCESS) || !child.isLoaded(k, newId) ||
+        !loadShared(child, k, childId)) {
+      return false;
+    }
+    device_->ids[i + 1] = childId;
+    return unloadShared(child, k, childId);
+  }));
+  ASSERT_EQ(device_->ids[1], newId);
+  ASSERT_EQ(device_->ids[2], newId);
+  ASSERT_EQ(device_->numLoads, 2u);
+  ASSERT_EQ(device_->numUnloads, 0u);
+  ASSERT_TRUE(unloadShared(registry, k, newId));
+  ASSERT_EQ(device_->numUnloads, 1u);
+}
+
+void QAicOpenRtSharedImageRegistryUnitTest::WatchLoaderExitTest() {
+  QSharedImageRegistry registry(name_);
+  ASSERT_EQ(registry.init(), QS_SUCCESS);
+  registry.setWatchInterval(milliseconds(10));
+  const QSharedImageKey k = key(0xcafe, QSharedImageKind::NetworkImage);
+  const QSharedImageKey own = key(0xf00d);
+
+  // Not opened, nothing to watch
+  QSharedImageRegistry closed(name_);
+  ASSERT_EQ(closed.watch(k, 1, []() {}), 0u);
+
+  // Another process loads and exits while this one keeps running on it
+  bool loaderExited = false;
+  std::thread loader([&]() {
+    loaderExited = runProcesses(1, [&](uint32_t) {
+      QSharedImageRegistry child(name_);
+      uint32_t childId = 0;
+      if ((child.init() != QS_SUCCESS) || !loadShared(child, k, childId)) {
+        return false;
+      }
+      device_->ids[0] = childId;
+      device_->wait(device_->arrived, 2);
+      return true;
+    });
+  });
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while ((device_->ids[0] == 0) &&
+         (std::chrono::steady_clock::now() < deadline)) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  uint32_t id = 0;
+  uint32_t ownId = 0;
+  ASSERT_TRUE(loadShared(registry, k, id));
+  ASSERT_TRUE(loadShared(registry, own, ownId));
+
+  std::atomic<uint32_t> numLost{0};
+  std::atomic<uint32_t> numWrong{0};
+  uint64_t handle = 0;
+  handle = registry.watch(k, id, [&]() {
+    numLost++;
+    // Already stopped, and does not wait for itself
+    registry.unwatch(handle);
+  });
+  ASSERT_NE(handle, 0u);
+  const uint64_t ownHandle = registry.watch(own, ownId, [&]() { numWrong++; });
+  const uint64_t stopped = registry.watch(k, id, [&]() { numWrong++; });
+  ASSERT_NE(ownHandle, 0u);
+  ASSERT_NE(stopped, 0u);
+  registry.unwatch(stopped);
+  std::this_thread::sleep_for(milliseconds(50));
+  ASSERT_EQ(numLost, 0u);
+
+  device_->wait(device_->arrived, 2);
+  loader.join();
+  ASSERT_TRUE(loaderExited);
+  while ((numLost == 0) && (std::chrono::steady_clock::now() < deadline)) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  // Once, and only for the load that went with the loader
+  std::this_thread::sleep_for(milliseconds(50));
+  ASSERT_EQ(numLost, 1u);
+  ASSERT_EQ(numWrong, 0u);
+  ASSERT_TRUE(registry.isLoaded(own, ownId));
+
+  // The holder loads it again and serves on, watching the new load
+  uint32_t newId = 0;
+  ASSERT_TRUE(loadShared(registry, k, newId));
+  ASSERT_NE(newId, id);
+  ASSERT_EQ(device_->numLoads, 3u);
+  const uint64_t newHandle = registry.watch(k, newId, [&]() { numWrong++; });
+  ASSERT_NE(newHandle, 0u);
+  std::this_thread::sleep_for(milliseconds(50));
+  ASSERT_EQ(numWrong, 0u);
+  registry.unwatch(newHandle);
+  registry.unwatch(ownHandle);
+  ASSERT_TRUE(unloadShared(registry, k, newId));
+  ASSERT_TRUE(unloadShared(registry, own, ownId));
+  ASSERT_EQ(device_->numUnloads, 2u);
+}
+
+void QAicOpenRtSharedImageRegistryUnitTest::ForeignRegistryTest() {
+  // Created private to the user
+  {
+    QSharedImageRegistry registry(name_);
+    ASSERT_EQ(registry.init(), QS_SUCCESS);
+    struct stat st;
+    ASSERT_EQ(stat(("/dev/shm/" + name_).c_str(), &st), 0);
+    ASSERT_EQ(st.st_mode & 0777, static_cast<mode_t>(0600));
+    ASSERT_EQ(st.st_uid, geteuid());
+  }
+
+  // One others can write to is not used, whoever created it
+  const std::string shared = uniqueName();
+  int fd = shm_open(shared.c_str(), O_CREAT | O_RDWR, 0600);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(fchmod(fd, 0666), 0);
+  close(fd);
+  QSharedImageRegistry open(shared);
+  ASSERT_EQ(open.init(), QS_ERROR);
+  ASSERT_EQ(QSharedImageRegistry::unlink(shared), QS_SUCCESS);
+
+  // Entries that do not hold together are dropped rather than attached to,
+  // nor are their pids signalled
+  struct RawEntry {
+    uint32_t state;
+    uint32_t kind;
+    int32_t qid;
+    uint32_t id;
+    std::array<uint8_t, 32> digest;
+    uint64_t size;
+    int32_t loaderPid;
+    uint32_t numHolders;
+  };
+  const size_t tableHeader = 16;
+  QSharedImageRegistry registry(name_);
+  ASSERT_EQ(registry.init(), QS_SUCCESS);
+  fd = shm_open(name_.c_str(), O_RDWR, 0);
+  ASSERT_NE(fd, -1);
+  void *addr = mmap(nullptr, tableHeader + sizeof(RawEntry),
+                    PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  ASSERT_NE(addr, MAP_FAILED);
+  RawEntry *raw = reinterpret_cast<RawEntry *>(
+      static_cast<uint8_t *>(addr) + tableHeader);
+
+  const QSharedImageKey k = key(0xbad);
+  const std::vector<RawEntry> corrupt = {
+      // A process group for a loader
+      {2, 1, 0, 77, k.digest, k.size, -1, 0},
+      // More holders than there is room for
+      {2, 1, 0, 77, k.digest, k.size, getpid(), 1000},
+      // Unknown state and kind
+      {9, 1, 0, 77, k.digest, k.size, getpid(), 0},
+      {2, 9, 0, 77, k.digest, k.size, getpid(), 0},
+  };
+  for (const RawEntry &entry : corrupt) {
+    *raw = entry;
+    ASSERT_FALSE(registry.isLoaded(k, 77));
+    ASSERT_EQ(raw->state, 0u);
+    QSharedImageClaim claim;
+    uint32_t id = 0;
+    ASSERT_EQ(registry.acquire(k, claim, id, milliseconds(0)), QS_SUCCESS);
+    ASSERT_EQ(claim, QSharedImageClaim::Load);
+    ASSERT_EQ(registry.abandon(k), QS_SUCCESS);
+  }
+  munmap(addr, tableHeader + sizeof(RawEntry));
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtSharedImageRegistryUnitTest, ShareAcrossProcessesTest) {
+  ShareAcrossProcessesTest();
+}
+
+TEST_F(QAicOpenRtSharedImageRegistryUnitTest, RefCountTest) {
+  RefCountTest();
+}
+
+TEST_F(QAicOpenRtSharedImageRegistryUnitTest, DeadProcessTest) {
+  DeadProcessTest();
+}
+
+TEST_F(QAicOpenRtSharedImageRegistryUnitTest, PrivateFallbackTest) {
+  PrivateFallbackTest();
+}
+
+TEST_F(QAicOpenRtSharedImageRegistryUnitTest, AdversarialInvalidUseTest) {
+  InvalidUseTest();
+}
+
+TEST_F(QAicOpenRtSharedImageRegistryUnitTest, LoaderExitTest) {
+  LoaderExitTest();
+}
+
+TEST_F(QAicOpenRtSharedImageRegistryUnitTest, WatchLoaderExitTest) {
+  WatchLoaderExitTest();
+}
+
+TEST_F(QAicOpenRtSharedImageRegistryUnitTest, AdversarialForeignRegistryTest) {
+  ForeignRegistryTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,424 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QSubmitScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::QSubmitClientID;
+using qaic::QSubmitSchedParams;
+using qaic::QSubmitScheduler;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+class QAicOpenRtSubmitSchedulerUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtSubmitSchedulerUnitTest(){};
+  ~QAicOpenRtSubmitSchedulerUnitTest() = default;
+
+  QAicOpenRtSubmitSchedulerUnitTest(
+      const QAicOpenRtSubmitSchedulerUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtSubmitSchedulerUnitTest &
+  operator=(const QAicOpenRtSubmitSchedulerUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void InFlightCapTest();
+  void WeightedShareTest();
+  void PriorityTest();
+  void StarvationTest();
+  void InvalidClientTest();
+  void RemoveWithWaitersTest();
+  void ClientBudgetTest();
+  void DerivedBudgetTest();
+
+  static QSubmitSchedParams params(uint32_t priority, uint32_t weight,
+                                   uint32_t maxWaitUs = 0) {
+    QSubmitSchedParams p;
+    p.priority = priority;
+    p.weight = weight;
+    p.maxWaitUs = maxWaitUs;
+    return p;
+  }
+
+  // Simulated device serving one inference at a time with a fixed service
+  // time. Every client keeps threadsPerClient submitters busy, so each has
+  // submissions waiting whenever the device picks the next one. Returns the
+  // completions per client, skipping the first warmup ones.
+  static std::vector<uint32_t>
+  runDevice(QSubmitScheduler &scheduler,
+            const std::vector<QSubmitClientID> &clients,
+            uint32_t threadsPerClient, uint32_t numCompletions,
+            microseconds serviceTime, uint32_t warmup = 16) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<size_t> deviceQueue;
+    std::atomic_bool stop{false};
+    std::atomic<size_t> exited{0};
+    std::vector<std::thread> submitters;
+    for (size_t c = 0; c < clients.size(); c++) {
+      for (uint32_t t = 0; t < threadsPerClient; t++) {
+        submitters.emplace_back([&, c]() {
+          while (!stop) {
+            if (scheduler.acquire(clients[c], milliseconds(100)) !=
+                QS_SUCCESS) {
+              continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            deviceQueue.push_back(c);
+            cv.notify_one();
+          }
+          exited++;
+        });
+      }
+    }
+
+    std::vector<uint32_t> completions(clients.size(), 0);
+    uint32_t served = 0;
+    auto serveOne = [&]() {
+      size_t c;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cv.wait_for(lock, milliseconds(1),
+                         [&] { return !deviceQueue.empty(); })) {
+          return;
+        }
+        c = deviceQueue.front();
+        deviceQueue.pop_front();
+      }
+      std::this_thread::sleep_for(serviceTime);
+      if ((served >= warmup) && (served < warmup + numCompletions)) {
+        completions[c]++;
+      }
+      served++;
+      EXPECT_EQ(scheduler.release(clients[c]), QS_SUCCESS);
+    };
+    while (served < warmup + numCompletions) {
+      serveOne();
+    }
+    // Keep serving until the submitters blocked in acquire got out
+    stop = true;
+    while (exited < submitters.size()) {
+      serveOne();
+    }
+    for (auto &thread : submitters) {
+      thread.join();
+    }
+    // Grants of the last submissions
+    for (size_t c : deviceQueue) {
+      EXPECT_EQ(scheduler.release(clients[c]), QS_SUCCESS);
+    }
+    return completions;
+  }
+};
+
+void QAicOpenRtSubmitSchedulerUnitTest::InFlightCapTest() {
+  QSubmitScheduler scheduler;
+  QSubmitClientID capped;
+  QSubmitClientID free;
+  QSubmitSchedParams cappedParams;
+  cappedParams.maxInFlight = 2;
+  ASSERT_EQ(scheduler.addClient(cappedParams, capped), QS_SUCCESS);
+  ASSERT_EQ(scheduler.addClient(QSubmitSchedParams(), free), QS_SUCCESS);
+
+  ASSERT_EQ(scheduler.acquire(capped, milliseconds(10)), QS_SUCCESS);
+  ASSERT_EQ(scheduler.acquire(capped, milliseconds(10)), QS_SUCCESS);
+  ASSERT_EQ(scheduler.acquire(capped, milliseconds(10)), QS_TIMEDOUT);
+  ASSERT_EQ(scheduler.getNumInFlight(capped), 2u);
+
+  // Other programs are not held back by the cap
+  for (int i = 0; i < 8; i++) {
+    ASSERT_EQ(scheduler.acquire(free, milliseconds(10)), QS_SUCCESS);
+  }
+  ASSERT_EQ(scheduler.getNumInFlight(), 10u);
+
+  // A returned grant wakes up a waiting submission
+  std::atomic_bool granted{false};
+  std::thread waiter([&]() {
+    granted = (scheduler.acquire(capped, milliseconds(5000)) == QS_SUCCESS);
+  });
+  std::this_thread::sleep_for(milliseconds(20));
+  ASSERT_FALSE(granted);
+  ASSERT_EQ(scheduler.release(capped), QS_SUCCESS);
+  waiter.join();
+  ASSERT_TRUE(granted);
+  ASSERT_EQ(scheduler.getNumInFlight(capped), 2u);
+
+  // Removing a program returns its grants to the device
+  ASSERT_EQ(scheduler.removeClient(free), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getNumInFlight(), 2u);
+  ASSERT_EQ(scheduler.getNumClients(), 1u);
+}
+
+void QAicOpenRtSubmitSchedulerUnitTest::WeightedShareTest() {
+  QSubmitScheduler scheduler(1);
+  QSubmitClientID heavy;
+  QSubmitClientID light;
+  ASSERT_EQ(scheduler.addClient(params(1, 3), heavy), QS_SUCCESS);
+  ASSERT_EQ(scheduler.addClient(params(1, 1), light), QS_SUCCESS);
+
+  auto completions =
+      runDevice(scheduler, {heavy, light}, 4, 400, microseconds(200));
+  const double heavyShare =
+      double(completions[0]) / (completions[0] + completions[1]);
+  ASSERT_GT(heavyShare, 0.65);
+  ASSERT_LT(heavyShare, 0.85);
+  ASSERT_EQ(scheduler.getNumInFlight(), 0u);
+}
+
+void QAicOpenRtSubmitSchedulerUnitTest::PriorityTest() {
+  QSubmitScheduler scheduler(1);
+  QSubmitClientID interactive;
+  QSubmitClientID bulk;
+  ASSERT_EQ(scheduler.addClient(params(0, 1), interactive), QS_SUCCESS);
+  // A much larger weight does not buy a lower priority class a share
+  ASSERT_EQ(scheduler.addClient(params(2, 100), bulk), QS_SUCCESS);
+
+  auto completions =
+      runDevice(scheduler, {interactive, bulk}, 4, 200, microseconds(200));
+  ASSERT_EQ(completions[0], 200u);
+  ASSERT_EQ(completions[1], 0u);
+}
+
+void QAicOpenRtSubmitSchedulerUnitTest::StarvationTest() {
+  QSubmitScheduler scheduler(1);
+  QSubmitClientID interactive;
+  QSubmitClientID bulk;
+  ASSERT_EQ(scheduler.addClient(params(0, 1), interactive), QS_SUCCESS);
+  // Served at least every 2ms, about every 10th inference
+  ASSERT_EQ(scheduler.addClient(params(2, 1, 2000), bulk), QS_SUCCESS);
+
+  auto completions =
+      runDevice(scheduler, {interactive, bulk}, 4, 400, microseconds(200));
+  ASSERT_GE(completions[1], 5u);
+  ASSERT_GT(completions[0], completions[1] * 2);
+}
+
+void QAicOpenRtSubmitSchedulerUnitTest::InvalidClientTest() {
+  QSubmitScheduler scheduler(4);
+  QSubmitClientID id;
+  ASSERT_EQ(scheduler.acquire(1234, milliseconds(1)), QS_INVAL);
+  ASSERT_EQ(scheduler.release(1234), QS_INVAL);
+  ASSERT_EQ(scheduler.removeClient(1234), QS_INVAL);
+
+  // A weight of 0 is taken as 1 instead of dividing by it
+  ASSERT_EQ(scheduler.addClient(params(1, 0), id), QS_SUCCESS);
+  // Returning a grant that was never taken
+  ASSERT_EQ(scheduler.release(id), QS_INVAL);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(scheduler.acquire(id, milliseconds(1)), QS_SUCCESS);
+  }
+  // The device budget holds
+  ASSERT_EQ(scheduler.acquire(id, milliseconds(1)), QS_TIMEDOUT);
+  ASSERT_EQ(scheduler.getNumInFlight(), 4u);
+  ASSERT_EQ(scheduler.removeClient(id), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getNumInFlight(), 0u);
+  ASSERT_EQ(scheduler.release(id), QS_INVAL);
+
+  // Program sched properties start with the defaults of the scheduler,
+  // which ask for no device budget
+  QAicProgramSchedProperties properties;
+  qaic::openrt::Program::initSchedProperties(properties);
+  QSubmitSchedParams defaults;
+  ASSERT_EQ(properties.StructSize, sizeof(QAicProgramSchedProperties));
+  ASSERT_EQ(properties.Priority, defaults.priority);
+  ASSERT_EQ(properties.Weight, defaults.weight);
+  ASSERT_EQ(properties.MaxInFlight, defaults.maxInFlight);
+  ASSERT_EQ(properties.MaxWaitUs, defaults.maxWaitUs);
+  ASSERT_EQ(properties.DeviceInFlight, 0u);
+  // The program properties keep the layout of earlier releases
+  ASSERT_EQ(sizeof(QAicProgramProperties), 24u);
+}
+
+void QAicOpenRtSubmitSchedulerUnitTest::RemoveWithWaitersTest() {
+  QSubmitScheduler scheduler(2);
+  QSubmitClientID removed;
+  QSubmitClientID other;
+  ASSERT_EQ(scheduler.addClient(QSubmitSchedParams(), removed), QS_SUCCESS);
+  ASSERT_EQ(scheduler.addClient(QSubmitSchedParams(), other), QS_SUCCESS);
+  ASSERT_EQ(scheduler.acquire(removed, milliseconds(1)), QS_SUCCESS);
+  ASSERT_EQ(scheduler.acquire(removed, milliseconds(1)), QS_SUCCESS);
+
+  // Submitters of both clients queue behind the full budget
+  constexpr uint32_t numWaiters = 4;
+  std::vector<QStatus> removedStatus(numWaiters, QS_ERROR);
+  std::vector<QStatus> otherStatus(numWaiters, QS_ERROR);
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < numWaiters; i++) {
+    threads.emplace_back([&, i] {
+      removedStatus[i] = scheduler.acquire(removed, milliseconds(10000));
+    });
+    threads.emplace_back([&, i] {
+      otherStatus[i] = scheduler.acquire(other, milliseconds(10000));
+    });
+  }
+  std::this_thread::sleep_for(milliseconds(100));
+  // Nothing is granted while the removed client holds the budget
+  ASSERT_EQ(scheduler.getNumInFlight(other), 0u);
+
+  // Deactivating with submissions waiting fails them right away and hands
+  // the budget of the removed client to the other one
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(scheduler.removeClient(removed), QS_SUCCESS);
+  for (uint32_t i = 0; i < numWaiters / 2; i++) {
+    // The other client cycles through the budget
+    while (scheduler.getNumInFlight(other) == 0) {
+      std::this_thread::yield();
+    }
+    ASSERT_EQ(scheduler.release(other), QS_SUCCESS);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_LT(std::chrono::steady_clock::now() - start, milliseconds(5000));
+  for (uint32_t i = 0; i < numWaiters; i++) {
+    ASSERT_EQ(removedStatus[i], QS_CANCELED);
+    ASSERT_EQ(otherStatus[i], QS_SUCCESS);
+  }
+  ASSERT_EQ(scheduler.getNumClients(), 1u);
+  ASSERT_EQ(scheduler.getNumInFlight(), scheduler.getNumInFlight(other));
+  // Late returns of the removed client's grants are ignored
+  ASSERT_EQ(scheduler.release(removed), QS_INVAL);
+  ASSERT_EQ(scheduler.acquire(removed, milliseconds(1)), QS_INVAL);
+}
+
+void QAicOpenRtSubmitSchedulerUnitTest::ClientBudgetTest() {
+  // No budget unless a client asks for one
+  QSubmitScheduler scheduler;
+  QSubmitClientID unbudgeted;
+  ASSERT_EQ(scheduler.addClient(QSubmitSchedParams(), unbudgeted),
+            QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 0u);
+
+  QSubmitSchedParams wide;
+  wide.deviceInFlight = 8;
+  QSubmitSchedParams narrow;
+  narrow.deviceInFlight = 2;
+  QSubmitClientID wideId;
+  QSubmitClientID narrowId;
+  ASSERT_EQ(scheduler.addClient(wide, wideId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 8u);
+  // The smallest budget asked applies
+  ASSERT_EQ(scheduler.addClient(narrow, narrowId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 2u);
+  ASSERT_EQ(scheduler.acquire(unbudgeted, milliseconds(1)), QS_SUCCESS);
+  ASSERT_EQ(scheduler.acquire(wideId, milliseconds(1)), QS_SUCCESS);
+  ASSERT_EQ(scheduler.acquire(wideId, milliseconds(1)), QS_TIMEDOUT);
+
+  ASSERT_EQ(scheduler.removeClient(narrowId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 8u);
+  ASSERT_EQ(scheduler.acquire(wideId, milliseconds(1)), QS_SUCCESS);
+  ASSERT_EQ(scheduler.removeClient(wideId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 0u);
+
+  // The default of the scheduler applies while no client asks for one
+  QSubmitScheduler defaulted(3);
+  QSubmitClientID id;
+  ASSERT_EQ(defaulted.addClient(QSubmitSchedParams(), id), QS_SUCCESS);
+  ASSERT_EQ(defaulted.getDeviceInFlight(), 3u);
+  ASSERT_EQ(defaulted.addClient(narrow, id), QS_SUCCESS);
+  ASSERT_EQ(defaulted.getDeviceInFlight(), 2u);
+  ASSERT_EQ(defaulted.removeClient(id), QS_SUCCESS);
+  ASSERT_EQ(defaulted.getDeviceInFlight(), 3u);
+}
+
+void QAicOpenRtSubmitSchedulerUnitTest::DerivedBudgetTest() {
+  // Default order, nothing to derive a budget for
+  QSubmitScheduler scheduler;
+  QSubmitSchedParams bulk;
+  bulk.queueInFlight = 64;
+  QSubmitClientID bulkId;
+  ASSERT_EQ(scheduler.addClient(bulk, bulkId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 0u);
+
+  // A priority asked without a budget gets the deepest queue as one
+  QSubmitSchedParams interactive = params(0, 1);
+  interactive.queueInFlight = 8;
+  QSubmitClientID interactiveId;
+  ASSERT_EQ(scheduler.addClient(interactive, interactiveId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 64u);
+  for (int i = 0; i < 64; i++) {
+    ASSERT_EQ(scheduler.acquire(bulkId, milliseconds(1)), QS_SUCCESS);
+  }
+  ASSERT_EQ(scheduler.acquire(bulkId, milliseconds(1)), QS_TIMEDOUT);
+
+  // The returned grant goes to the higher priority
+  std::atomic<QStatus> bulkStatus{QS_ERROR};
+  std::atomic<QStatus> interactiveStatus{QS_ERROR};
+  std::thread bulkWaiting(
+      [&]() { bulkStatus = scheduler.acquire(bulkId, milliseconds(200)); });
+  std::thread interactiveWaiting([&]() {
+    interactiveStatus = scheduler.acquire(interactiveId, milliseconds(5000));
+  });
+  std::this_thread::sleep_for(milliseconds(20));
+  ASSERT_EQ(scheduler.release(bulkId), QS_SUCCESS);
+  interactiveWaiting.join();
+  bulkWaiting.join();
+  ASSERT_EQ(interactiveStatus, QS_SUCCESS);
+  ASSERT_EQ(bulkStatus, QS_TIMEDOUT);
+
+  // An explicit budget wins over the derived one
+  QSubmitSchedParams budgeted;
+  budgeted.deviceInFlight = 4;
+  QSubmitClientID budgetedId;
+  ASSERT_EQ(scheduler.addClient(budgeted, budgetedId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 4u);
+  ASSERT_EQ(scheduler.removeClient(budgetedId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 64u);
+
+  // A weight asks for an order too
+  ASSERT_EQ(scheduler.removeClient(interactiveId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 0u);
+  QSubmitSchedParams weighted = params(1, 3);
+  ASSERT_EQ(scheduler.addClient(weighted, interactiveId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.getDeviceInFlight(), 64u);
+  ASSERT_EQ(scheduler.removeClient(bulkId), QS_SUCCESS);
+  ASSERT_EQ(scheduler.removeClient(interactiveId), QS_SUCCESS);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtSubmitSchedulerUnitTest, InFlightCapTest) {
+  InFlightCapTest();
+}
+
+TEST_F(QAicOpenRtSubmitSchedulerUnitTest, WeightedShareTest) {
+  WeightedShareTest();
+}
+
+TEST_F(QAicOpenRtSubmitSchedulerUnitTest, PriorityTest) { PriorityTest(); }
+
+TEST_F(QAicOpenRtSubmitSchedulerUnitTest, StarvationTest) {
+  StarvationTest();
+}
+
+TEST_F(QAicOpenRtSubmitSchedulerUnitTest, AdversarialInvalidClientTest) {
+  InvalidClientTest();
+}
+
+TEST_F(QAicOpenRtSubmitSchedulerUnitTest, RemoveWithWaitersTest) {
+  RemoveWithWaitersTest();
+}
+
+TEST_F(QAicOpenRtSubmitSchedulerUnitTest, ClientBudgetTest) {
+  ClientBudgetTest();
+}
+
+TEST_F(QAicOpenRtSubmitSchedulerUnitTest, DerivedBudgetTest) {
+  DerivedBudgetTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,574 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtTrafficRecorder.hpp"
+#include "QAicOpenRtTrafficReplay.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::openrt::TrafficRecorder;
+using qaic::openrt::TrafficReplay;
+using qaic::openrt::TrafficRequest;
+using qaic::openrt::TrafficTrace;
+
+class QAicOpenRtTrafficReplayUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtTrafficReplayUnitTest(){};
+  ~QAicOpenRtTrafficReplayUnitTest() = default;
+
+  QAicOpenRtTrafficReplayUnitTest(const QAicOpenRtTrafficReplayUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtTrafficReplayUnitTest &
+  operator=(const QAicOpenRtTrafficReplayUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void SetUp() override {
+    char dir[] = "/tmp/qaic-traffic-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    dir_ = dir;
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  void RecordTest();
+  void AsyncRecordTest();
+  void SaveLoadTest();
+  void ReplayTest();
+  void ReplayTimeScaleTest();
+  void ReadTest();
+  void InvalidReplayTest();
+
+  // One partial input of 64 bytes, one full input of 16 bytes and an
+  // output
+  static BufferMappings simulatedMappings();
+  static TrafficTrace simulatedTrace(bool hasPayload);
+
+  // A request run by the simulated backend
+  struct Call {
+    std::chrono::steady_clock::time_point time;
+    std::vector<size_t> sizes;
+    uint8_t firstByte = 0;
+  };
+
+  std::string dir_;
+};
+
+BufferMappings QAicOpenRtTrafficReplayUnitTest::simulatedMappings() {
+  return {BufferMapping("in0", 0, QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT,
+                        64, true,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_UINT8Q),
+          BufferMapping("in1", 1, QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT,
+                        16, false,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_UINT8Q),
+          BufferMapping("out", 2, QAicBufferIoTypeEnum::BUFFER_IO_TYPE_OUTPUT,
+                        32, false,
+                        QAicBufferDataTypeEnum::BUFFER_DATA_TYPE_UINT8Q)};
+}
+
+// Two threads alternating on two ExecObjs, a request every 20ms
+TrafficTrace QAicOpenRtTrafficReplayUnitTest::simulatedTrace(bool hasPayload) {
+  TrafficTrace trace;
+  trace.numThreads = 2;
+  trace.hasPayload = hasPayload;
+  for (uint32_t i = 0; i < 10; i++) {
+    TrafficRequest request;
+    request.start = std::chrono::milliseconds(100 + 20 * i);
+    request.duration = std::chrono::milliseconds(2);
+    request.threadIndex = i % 2;
+    request.execObjId = 7 + (i % 2);
+    request.status = QS_SUCCESS;
+    request.inputSizes = {8ULL * (i + 1), 16};
+    if (hasPayload) {
+      request.inputs = {std::vector<uint8_t>(8 * (i + 1), i + 1),
+                        std::vector<uint8_t>(16, 0xA0)};
+    }
+    trace.requests.push_back(request);
+  }
+  return trace;
+}
+
+void QAicOpenRtTrafficReplayUnitTest::RecordTest() {
+  qaic::openrt::TrafficRecorderProperties properties;
+  properties.recordPayload = true;
+  qaic::openrt::shTrafficRecorder recorder =
+      TrafficRecorder::Factory(properties);
+  ASSERT_TRUE(recorder != nullptr);
+
+  // Simulated ExecObjs run by three threads, the partial input sized by
+  // the request number
+  constexpr uint32_t numThreads = 3;
+  constexpr uint32_t numRequests = 20;
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < numThreads; t++) {
+    threads.emplace_back([recorder, t]() {
+      std::vector<uint8_t> in0(64);
+      std::vector<uint8_t> out(32);
+      std::vector<QBuffer> buffers(2);
+      buffers.at(0).buf = in0.data();
+      buffers.at(1).buf = out.data();
+      buffers.at(1).size = out.size();
+      for (uint32_t i = 0; i < numRequests; i++) {
+        buffers.at(0).size = 1 + i;
+        std::fill(in0.begin(), in0.end(), static_cast<uint8_t>(t * 100 + i));
+        const auto begin = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        recorder->record(100 + t, begin, std::chrono::steady_clock::now(),
+                         (i == 5) ? QS_ERROR : QS_SUCCESS, buffers, {0});
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  TrafficTrace trace;
+  recorder->getTrace(trace);
+  ASSERT_TRUE(trace.numThreads == numThreads);
+  ASSERT_TRUE(trace.hasPayload);
+  ASSERT_TRUE(trace.requests.size() == numThreads * numRequests);
+  ASSERT_TRUE(recorder->getNumDropped() == 0);
+
+  // Each thread keeps one index and one ExecObj, its requests in order
+  std::vector<uint32_t> threadOf(numThreads, numThreads);
+  std::vector<uint32_t> next(numThreads, 0);
+  for (size_t r = 0; r < trace.requests.size(); r++) {
+    const TrafficRequest &request = trace.requests.at(r);
+    if (r > 0) {
+      ASSERT_TRUE(trace.requests.at(r - 1).start <= request.start);
+    }
+    ASSERT_TRUE(request.duration >= std::chrono::microseconds(500));
+    const uint32_t t = request.execObjId - 100;
+    ASSERT_TRUE(t < numThreads);
+    if (threadOf.at(t) == numThreads) {
+      threadOf.at(t) = request.threadIndex;
+    }
+    ASSERT_TRUE(request.threadIndex == threadOf.at(t));
+    const uint32_t i = next.at(t)++;
+    ASSERT_TRUE(request.status == ((i == 5) ? QS_ERROR : QS_SUCCESS));
+    ASSERT_TRUE(request.inputSizes == std::vector<uint64_t>{1 + i});
+    ASSERT_TRUE(request.inputs.size() == 1);
+    ASSERT_TRUE(request.inputs.at(0) ==
+                std::vector<uint8_t>(1 + i, t * 100 + i));
+  }
+
+  // Requests beyond the limit are only counted
+  properties.recordPayload = false;
+  properties.maxRequests = 2;
+  recorder = TrafficRecorder::Factory(properties);
+  std::vector<QBuffer> buffers(1);
+  const auto now = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < 5; i++) {
+    recorder->record(1, now, now, QS_SUCCESS, buffers, {0});
+  }
+  recorder->getTrace(trace);
+  ASSERT_TRUE(trace.requests.size() == 2);
+  ASSERT_TRUE(trace.requests.at(0).inputs.empty());
+  ASSERT_TRUE(recorder->getNumDropped() == 3);
+}
+
+void QAicOpenRtTrafficReplayUnitTest::AsyncRecordTest() {
+  qaic::openrt::TrafficRecorderProperties properties;
+  properties.recordPayload = true;
+  qaic::openrt::shTrafficRecorder recorder =
+      TrafficRecorder::Factory(properties);
+
+  // Requests submitted by two threads complete on a third one, the way
+  // ExecObj::runAsync calls its callback from a runtime thread
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<TrafficRequest> pending;
+  bool stop = false;
+  std::thread completion([&]() {
+    std::unique_lock<std::mutex> lk(m);
+    while (true) {
+      cv.wait(lk, [&]() { return stop || !pending.empty(); });
+      if (pending.empty()) {
+        return;
+      }
+      TrafficRequest request = std::move(pending.front());
+      pending.pop_front();
+      lk.unlock();
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      recorder->endRequest(std::move(request), QS_SUCCESS);
+      lk.lock();
+    }
+  });
+
+  constexpr uint32_t numThreads = 2;
+  constexpr uint32_t numRequests = 10;
+  std::vector<std::thread> submitters;
+  for (uint32_t t = 0; t < numThreads; t++) {
+    submitters.emplace_back([&, t]() {
+      std::vector<uint8_t> in0(8);
+      std::vector<QBuffer> buffers(1);
+      buffers.at(0).buf = in0.data();
+      buffers.at(0).size = in0.size();
+      for (uint32_t i = 0; i < numRequests; i++) {
+        std::fill(in0.begin(), in0.end(), static_cast<uint8_t>(t * 100 + i));
+        TrafficRequest request = recorder->beginRequest(10 + t, buffers, {0});
+        // The application reuses the buffers before the completion
+        std::fill(in0.begin(), in0.end(), 0xff);
+        std::lock_guard<std::mutex> lk(m);
+        pending.push_back(std::move(request));
+        cv.notify_one();
+      }
+    });
+  }
+  for (auto &t : submitters) {
+    t.join();
+  }
+  {
+    std::lock_guard<std::mutex> lk(m);
+    stop = true;
+    cv.notify_one();
+  }
+  completion.join();
+
+  // Requests belong to the threads that submitted them, with the inputs
+  // they submitted
+  TrafficTrace trace;
+  recorder->getTrace(trace);
+  ASSERT_TRUE(trace.numThreads == numThreads);
+  ASSERT_TRUE(trace.requests.size() == numThreads * numRequests);
+  std::vector<uint32_t> threadOf(numThreads, numThreads);
+  std::vector<uint32_t> next(numThreads, 0);
+  for (const TrafficRequest &request : trace.requests) {
+    const uint32_t t = request.execObjId - 10;
+    ASSERT_TRUE(t < numThreads);
+    if (threadOf.at(t) == numThreads) {
+      threadOf.at(t) = request.threadIndex;
+    }
+    ASSERT_TRUE(request.threadIndex == threadOf.at(t));
+    const uint32_t i = next.at(t)++;
+    ASSERT_TRUE(request.inputs.size() == 1);
+    ASSERT_TRUE(request.inputs.at(0) ==
+                std::vector<uint8_t>(8, t * 100 + i));
+    ASSERT_TRUE(request.duration >= std::chrono::microseconds(200));
+  }
+  ASSERT_TRUE(threadOf.at(0) != threadOf.at(1));
+
+  // Past the limit, requests are counted at completion and their inputs
+  // are not copied
+  properties.maxRequests = 1;
+  recorder = TrafficRecorder::Factory(properties);
+  std::vector<uint8_t> in0(8, 1);
+  std::vector<QBuffer> buffers(1);
+  buffers.at(0).buf = in0.data();
+  buffers.at(0).size = in0.size();
+  TrafficRequest first = recorder->beginRequest(1, buffers, {0});
+  TrafficRequest second = recorder->beginRequest(1, buffers, {0});
+  recorder->endRequest(std::move(first), QS_SUCCESS);
+  TrafficRequest third = recorder->beginRequest(1, buffers, {0});
+  ASSERT_TRUE(third.inputs.empty());
+  recorder->endRequest(std::move(second), QS_ERROR);
+  recorder->endRequest(std::move(third), QS_ERROR);
+  recorder->getTrace(trace);
+  ASSERT_TRUE(trace.requests.size() == 1);
+  ASSERT_TRUE(trace.requests.at(0).status == QS_SUCCESS);
+  ASSERT_TRUE(recorder->getNumDropped() == 2);
+}
+
+void QAicOpenRtTrafficReplayUnitTest::SaveLoadTest() {
+  for (bool hasPayload : {false, true}) {
+    qaic::openrt::TrafficRecorderProperties properties;
+    properties.recordPayload = hasPayload;
+    qaic::openrt::shTrafficRecorder recorder =
+        TrafficRecorder::Factory(properties);
+
+    std::vector<uint8_t> in0(64, 0x11);
+    std::vector<uint8_t> in1(16, 0x22);
+    std::vector<QBuffer> buffers(3);
+    buffers.at(0).buf = in0.data();
+    buffers.at(2).buf = in1.data();
+    buffers.at(2).size = in1.size();
+    // Device allocated inputs have no payload
+    buffers.at(1).size = 128;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < 8; i++) {
+      buffers.at(0).size = 8 * (i + 1);
+      recorder->record(i % 2, start + std::chrono::milliseconds(i),
+                       start + std::chrono::milliseconds(i + 3),
+                       (i == 3) ? QS_BUSY : QS_SUCCESS, buffers, {0, 1, 2});
+    }
+
+    const std::string path = dir_ + "/trace.bin";
+    ASSERT_TRUE(recorder->save(path) == QS_SUCCESS);
+    TrafficTrace expected;
+    recorder->getTrace(expected);
+    TrafficTrace trace;
+    ASSERT_TRUE(TrafficRecorder::load(path, trace) == QS_SUCCESS);
+
+    ASSERT_TRUE(trace.numThreads == expected.numThreads);
+    ASSERT_TRUE(trace.hasPayload == hasPayload);
+    ASSERT_TRUE(trace.requests.size() == 8);
+    for (size_t r = 0; r < trace.requests.size(); r++) {
+      const TrafficRequest &a = trace.requests.at(r);
+      const TrafficRequest &b = expected.requests.at(r);
+      ASSERT_TRUE(a.start == b.start);
+      ASSERT_TRUE(a.duration == std::chrono::milliseconds(3));
+      ASSERT_TRUE(a.threadIndex == b.threadIndex);
+      ASSERT_TRUE(a.execObjId == b.execObjId);
+      ASSERT_TRUE(a.status == b.status);
+      ASSERT_TRUE(a.inputSizes ==
+                  (std::vector<uint64_t>{8ULL * (r + 1), 128, 16}));
+      if (hasPayload) {
+        ASSERT_TRUE(a.inputs.size() == 3);
+        ASSERT_TRUE(a.inputs.at(0) == std::vector<uint8_t>(8 * (r + 1), 0x11));
+        ASSERT_TRUE(a.inputs.at(1).empty());
+        ASSERT_TRUE(a.inputs.at(2) == in1);
+      } else {
+        ASSERT_TRUE(a.inputs.empty());
+      }
+    }
+    // Without payloads a request takes a few tens of bytes
+    if (!hasPayload) {
+      ASSERT_TRUE(std::filesystem::file_size(path) < 8 * 64);
+    }
+  }
+  TrafficTrace trace;
+  ASSERT_TRUE(TrafficRecorder::load(dir_ + "/none.bin", trace) == QS_ERROR);
+}
+
+void QAicOpenRtTrafficReplayUnitTest::ReplayTest() {
+  const TrafficTrace trace = simulatedTrace(true);
+  const BufferMappings mappings = simulatedMappings();
+  ASSERT_TRUE(TrafficReplay::getExecObjIds(trace) ==
+              (std::vector<QAicExecObjID>{7, 8}));
+
+  // The simulated backends note what each request looked like
+  std::mutex m;
+  std::vector<std::vector<Call>> calls(2);
+  std::set<std::thread::id> threads;
+  std::vector<qaic::openrt::TrafficExecFunction> backends;
+  for (uint32_t b = 0; b < 2; b++) {
+    backends.emplace_back(
+        [&, b](const std::vector<QBuffer> &buffers) -> QStatus {
+          Call call;
+          call.time = std::chrono::steady_clock::now();
+          for (const auto &buffer : buffers) {
+            call.sizes.push_back(buffer.size);
+          }
+          call.firstByte = buffers.at(0).buf[0];
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+          std::lock_guard<std::mutex> lk(m);
+          threads.insert(std::this_thread::get_id());
+          calls.at(b).push_back(call);
+          // The last request now fails
+          return (call.firstByte == 10) ? QS_ERROR : QS_SUCCESS;
+        });
+  }
+  qaic::openrt::TrafficReplayProperties properties;
+  qaic::openrt::shTrafficReplay replay =
+      TrafficReplay::Factory(trace, properties, mappings, backends);
+  ASSERT_TRUE(replay != nullptr);
+  ASSERT_TRUE(replay->getNumThreads() == 2);
+
+  const auto start = std::chrono::steady_clock::now();
+  qaic::openrt::TrafficReplayReport report;
+  ASSERT_TRUE(replay->run(report) == QS_SUCCESS);
+
+  ASSERT_TRUE(report.numRequests == 10);
+  ASSERT_TRUE(report.numCompleted == 9);
+  ASSERT_TRUE(report.numFailed == 1);
+  ASSERT_TRUE(report.numStatusChanged == 1);
+  ASSERT_TRUE(threads.size() == 2);
+  ASSERT_NEAR(report.recordedDurationSec, 0.182, 1e-9);
+  ASSERT_NEAR(report.recordedServiceTime.p50Us, 2000, 1e-6);
+  ASSERT_TRUE(report.serviceTime.p50Us >= 2000);
+  ASSERT_TRUE(report.latency.p50Us >= report.serviceTime.p50Us);
+  ASSERT_TRUE(report.durationSec >= 0.182);
+  ASSERT_TRUE(report.durationSec < 1);
+
+  for (uint32_t b = 0; b < 2; b++) {
+    ASSERT_TRUE(calls.at(b).size() == 5);
+    for (uint32_t k = 0; k < 5; k++) {
+      const uint32_t i = 2 * k + b;
+      const Call &call = calls.at(b).at(k);
+      // Sent at the recorded time relative to the first request
+      const auto offset = call.time - start;
+      ASSERT_TRUE(offset >= std::chrono::milliseconds(20 * i));
+      ASSERT_TRUE(offset < std::chrono::milliseconds(20 * i + 15));
+      // The partial input takes the recorded size and payload, the full
+      // input and the output keep the buffer size
+      const size_t size = std::min<size_t>(8 * (i + 1), 64);
+      ASSERT_TRUE(call.sizes == (std::vector<size_t>{size, 16, 32}));
+      ASSERT_TRUE(call.firstByte == i + 1);
+    }
+  }
+}
+
+void QAicOpenRtTrafficReplayUnitTest::ReplayTimeScaleTest() {
+  TrafficTrace trace = simulatedTrace(false);
+  // Recorded sizes beyond the buffer are limited to it
+  trace.requests.at(9).inputSizes = {1000, 4};
+  std::vector<std::vector<size_t>> sizes;
+  std::mutex m;
+  auto backend = [&](const std::vector<QBuffer> &buffers) -> QStatus {
+    std::lock_guard<std::mutex> lk(m);
+    sizes.push_back({buffers.at(0).size, buffers.at(1).size});
+    return QS_SUCCESS;
+  };
+
+  // Twice as fast as recorded
+  qaic::openrt::TrafficReplayProperties properties;
+  properties.timeScale = 0.5;
+  qaic::openrt::shTrafficReplay replay = TrafficReplay::Factory(
+      trace, properties, simulatedMappings(), {backend, backend});
+  qaic::openrt::TrafficReplayReport report;
+  ASSERT_TRUE(replay->run(report) == QS_SUCCESS);
+  ASSERT_TRUE(report.numCompleted == 10);
+  ASSERT_TRUE(report.numStatusChanged == 0);
+  ASSERT_TRUE(report.durationSec >= 0.09);
+  ASSERT_TRUE(report.durationSec < 0.15);
+  ASSERT_TRUE(sizes.back() == (std::vector<size_t>{64, 16}));
+
+  // Unpaced, the threads send back to back
+  properties.timeScale = 0;
+  replay = TrafficReplay::Factory(trace, properties, simulatedMappings(),
+                                  {backend, backend});
+  ASSERT_TRUE(replay->run(report) == QS_SUCCESS);
+  ASSERT_TRUE(report.numCompleted == 10);
+  ASSERT_TRUE(report.durationSec < 0.05);
+}
+
+void QAicOpenRtTrafficReplayUnitTest::ReadTest() {
+  std::ostringstream os;
+  TrafficRecorder::write(os, simulatedTrace(true));
+  const std::string valid = os.str();
+  TrafficTrace trace;
+  {
+    std::istringstream is(valid);
+    ASSERT_TRUE(TrafficRecorder::read(is, trace) == QS_SUCCESS);
+    ASSERT_TRUE(trace.requests.size() == 10);
+  }
+
+  // Every truncation is detected
+  for (size_t length = 0; length < valid.size(); length++) {
+    std::istringstream is(valid.substr(0, length));
+    ASSERT_TRUE(TrafficRecorder::read(is, trace) == QS_INVAL);
+    ASSERT_TRUE(trace.requests.empty());
+  }
+
+  auto corrupt = [&valid](size_t offset, const void *value, size_t size) {
+    std::string data = valid;
+    data.replace(offset, size, static_cast<const char *>(value), size);
+    return data;
+  };
+  // Header: magic 8, version 4, flags 4, threads 4, requests 8. Request:
+  // start 8, duration 8, thread 4, ExecObj 4, status 4, inputs 4, sizes 8
+  // each.
+  constexpr size_t header = 28;
+  const uint32_t badVersion = 2;
+  const uint32_t badFlags = 6;
+  const uint64_t manyRequests = 11;
+  const int64_t negative = -1;
+  const uint32_t badThread = 2;
+  const int32_t badStatus = 1000;
+  const uint32_t manyInputs = 100000;
+  const uint64_t hugeSize = 1ULL << 40;
+  const uint8_t badPresent = 2;
+  struct Corruption {
+    std::string data;
+    QStatus expected;
+  };
+  const std::vector<Corruption> corruptions = {
+      {"QAICXXX" + valid.substr(7), QS_INVAL},
+      {corrupt(8, &badVersion, 4), QS_UNSUPPORTED},
+      {corrupt(12, &badFlags, 4), QS_INVAL},
+      {corrupt(20, &manyRequests, 8), QS_INVAL},
+      {corrupt(header, &negative, 8), QS_INVAL},
+      {corrupt(header + 8, &negative, 8), QS_INVAL},
+      {corrupt(header + 16, &badThread, 4), QS_INVAL},
+      {corrupt(header + 24, &badStatus, 4), QS_INVAL},
+      {corrupt(header + 28, &manyInputs, 4), QS_INVAL},
+      {corrupt(header + 32, &hugeSize, 8), QS_INVAL},
+      {corrupt(header + 48, &badPresent, 1), QS_INVAL},
+      {valid + "x", QS_INVAL},
+  };
+  for (const auto &c : corruptions) {
+    std::istringstream is(c.data);
+    ASSERT_TRUE(TrafficRecorder::read(is, trace) == c.expected);
+    ASSERT_TRUE(trace.requests.empty());
+  }
+
+  // Requests out of order
+  TrafficTrace unsorted = simulatedTrace(false);
+  std::swap(unsorted.requests.at(0), unsorted.requests.at(1));
+  std::ostringstream unsortedOs;
+  TrafficRecorder::write(unsortedOs, unsorted);
+  std::istringstream is(unsortedOs.str());
+  ASSERT_TRUE(TrafficRecorder::read(is, trace) == QS_INVAL);
+}
+
+void QAicOpenRtTrafficReplayUnitTest::InvalidReplayTest() {
+  const TrafficTrace trace = simulatedTrace(false);
+  const BufferMappings mappings = simulatedMappings();
+  qaic::openrt::TrafficExecFunction backend =
+      [](const std::vector<QBuffer> &) -> QStatus { return QS_SUCCESS; };
+  qaic::openrt::TrafficReplayProperties properties;
+
+  ASSERT_THROW(
+      TrafficReplay::Factory(TrafficTrace(), properties, mappings, {}),
+      qaic::openrt::CoreExceptionInit);
+  ASSERT_THROW(TrafficReplay::Factory(trace, properties, mappings, {backend}),
+               qaic::openrt::CoreExceptionInit);
+  ASSERT_THROW(
+      TrafficReplay::Factory(trace, properties, mappings, {backend, nullptr}),
+      qaic::openrt::CoreExceptionInit);
+  BufferMappings badMappings = mappings;
+  badMappings.at(0).index = 3;
+  ASSERT_THROW(TrafficReplay::Factory(trace, properties, badMappings,
+                                      {backend, backend}),
+               qaic::openrt::CoreExceptionInit);
+  for (double timeScale : {-1.0, std::nan(""),
+                           std::numeric_limits<double>::infinity()}) {
+    properties.timeScale = timeScale;
+    ASSERT_THROW(TrafficReplay::Factory(trace, properties, mappings,
+                                        {backend, backend}),
+                 qaic::openrt::CoreExceptionInit);
+  }
+
+  qaic::openrt::TrafficRecorderProperties recorderProperties;
+  recorderProperties.maxRequests = 0;
+  ASSERT_THROW(TrafficRecorder::Factory(recorderProperties),
+               qaic::openrt::CoreExceptionInit);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtTrafficReplayUnitTest, RecordTest) { RecordTest(); }
+
+TEST_F(QAicOpenRtTrafficReplayUnitTest, AsyncRecordTest) {
+  AsyncRecordTest();
+}
+
+TEST_F(QAicOpenRtTrafficReplayUnitTest, SaveLoadTest) { SaveLoadTest(); }
+
+TEST_F(QAicOpenRtTrafficReplayUnitTest, ReplayTest) { ReplayTest(); }
+
+TEST_F(QAicOpenRtTrafficReplayUnitTest, ReplayTimeScaleTest) {
+  ReplayTimeScaleTest();
+}
+
+TEST_F(QAicOpenRtTrafficReplayUnitTest, AdversarialReadTest) { ReadTest(); }
+
+TEST_F(QAicOpenRtTrafficReplayUnitTest, AdversarialInvalidReplayTest) {
+  InvalidReplayTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -0,0 +1,137 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicOpenRtUnitTestBase.hpp"
+#include "QAicOpenRtApi.hpp"
+#include "QVCQueueSizing.h"
+
+#include <cstdint>
+
+namespace QAicOpenRtUnitTest {
+
+using qaic::QVCQueueSizing;
+
+class QAicOpenRtVCQueueSizingUnitTest : public QAicOpenRtUnitTestBase {
+public:
+  QAicOpenRtVCQueueSizingUnitTest(){};
+  ~QAicOpenRtVCQueueSizingUnitTest() = default;
+
+  QAicOpenRtVCQueueSizingUnitTest(const QAicOpenRtVCQueueSizingUnitTest &) =
+      delete; // Disable Copy Constructor
+  QAicOpenRtVCQueueSizingUnitTest &
+  operator=(const QAicOpenRtVCQueueSizingUnitTest &) =
+      delete; // Disable Assignment Operator
+
+protected:
+  void SmallStencilTest();
+  void TargetInFlightTest();
+  void HugeStencilTest();
+  void TuningTest();
+  void InvalidTargetTest();
+};
+
+void QAicOpenRtVCQueueSizingUnitTest::SmallStencilTest() {
+  // Small programs keep at least the default queue, which holds more than
+  // the target number of inferences
+  for (uint32_t stencil = 1; stencil <= 16; stencil++) {
+    ASSERT_EQ(QVCQueueSizing::sizePow2(stencil, 32),
+              qaic::DefaultVCQueueSizePow2);
+  }
+  ASSERT_EQ(QVCQueueSizing::sizePow2(0, 32), qaic::DefaultVCQueueSizePow2);
+  // 40 elements times 32 inferences need 1280 elements
+  ASSERT_EQ(QVCQueueSizing::sizePow2(40, 32), 11u);
+}
+
+void QAicOpenRtVCQueueSizingUnitTest::TargetInFlightTest() {
+  // The smallest power of 2 holding the target, within the bounds
+  for (uint32_t stencil : {3u, 17u, 64u, 100u, 333u, 1000u}) {
+    for (uint32_t inFlight : {1u, 2u, 8u, 32u, 100u}) {
+      const uint64_t needed = uint64_t(stencil) * inFlight;
+      const uint32_t pow2 = QVCQueueSizing::sizePow2(stencil, inFlight);
+      ASSERT_GE(pow2, qaic::DefaultVCQueueSizePow2);
+      ASSERT_LE(pow2, qaic::MaxVCQueueSizePow2);
+      if (pow2 < qaic::MaxVCQueueSizePow2) {
+        ASSERT_GE(uint64_t(1) << pow2, needed);
+      }
+      if (pow2 > qaic::DefaultVCQueueSizePow2) {
+        ASSERT_LT(uint64_t(1) << (pow2 - 1), needed);
+      }
+    }
+  }
+}
+
+void QAicOpenRtVCQueueSizingUnitTest::HugeStencilTest() {
+  // A stencil larger than the default queue still fits one inference
+  ASSERT_EQ(QVCQueueSizing::sizePow2(2000, 1), 11u);
+  ASSERT_GE(1u << QVCQueueSizing::sizePow2(20000, 32), 20000u);
+  // Beyond the largest queue the size stays bounded
+  ASSERT_EQ(QVCQueueSizing::sizePow2(100000, 32), qaic::MaxVCQueueSizePow2);
+  ASSERT_EQ(QVCQueueSizing::sizePow2(UINT32_MAX, UINT32_MAX),
+            qaic::MaxVCQueueSizePow2);
+}
+
+void QAicOpenRtVCQueueSizingUnitTest::TuningTest() {
+  QVCQueueSizing sizing(8);
+  ASSERT_EQ(sizing.getInferencesInFlight(), 8u);
+  ASSERT_EQ(sizing.getSizePow2(100), 10u);
+
+  // A queue that was rarely full is kept
+  sizing.observe(0, 0);
+  sizing.observe(10000, 0);
+  sizing.observe(10000, 100);
+  ASSERT_EQ(sizing.getInferencesInFlight(), 8u);
+
+  // A queue often full doubles the target of the next activation
+  sizing.observe(10000, 101);
+  ASSERT_EQ(sizing.getInferencesInFlight(), 16u);
+  ASSERT_EQ(sizing.getSizePow2(100), 11u);
+
+  for (int i = 0; i < 20; i++) {
+    sizing.observe(100, 100);
+  }
+  ASSERT_EQ(sizing.getInferencesInFlight(),
+            qaic::MaxVCQueueInferencesInFlight);
+  ASSERT_EQ(sizing.getSizePow2(100), qaic::MaxVCQueueSizePow2);
+}
+
+void QAicOpenRtVCQueueSizingUnitTest::InvalidTargetTest() {
+  // 0 selects the default, oversized targets are capped
+  ASSERT_EQ(QVCQueueSizing(0).getInferencesInFlight(),
+            QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT);
+  ASSERT_EQ(QVCQueueSizing().getInferencesInFlight(),
+            QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT);
+  ASSERT_EQ(QVCQueueSizing(UINT32_MAX).getInferencesInFlight(),
+            qaic::MaxVCQueueInferencesInFlight);
+  ASSERT_EQ(QVCQueueSizing::sizePow2(100, 0),
+            QVCQueueSizing::sizePow2(100, 1));
+
+  // Program sched properties start with the default target, the program
+  // properties keep the layout of earlier releases
+  QAicProgramSchedProperties properties;
+  qaic::openrt::Program::initSchedProperties(properties);
+  ASSERT_EQ(properties.NumInferencesInFlight,
+            QAIC_PROGRAM_PROPERTIES_INFERENCES_IN_FLIGHT_DEFAULT);
+  ASSERT_EQ(sizeof(QAicProgramProperties), 24u);
+}
+
+//--------------------------------------------------------------------------
+// Test Program
+//--------------------------------------------------------------------------
+
+TEST_F(QAicOpenRtVCQueueSizingUnitTest, SmallStencilTest) {
+  SmallStencilTest();
+}
+
+TEST_F(QAicOpenRtVCQueueSizingUnitTest, TargetInFlightTest) {
+  TargetInFlightTest();
+}
+
+TEST_F(QAicOpenRtVCQueueSizingUnitTest, HugeStencilTest) { HugeStencilTest(); }
+
+TEST_F(QAicOpenRtVCQueueSizingUnitTest, TuningTest) { TuningTest(); }
+
+TEST_F(QAicOpenRtVCQueueSizingUnitTest, AdversarialInvalidTargetTest) {
+  InvalidTargetTest();
+}
+
+} // namespace QAicOpenRtUnitTest
@@ -4,17 +4,17 @@
 #include "QRuntimePlatformApi.h"
 #include "QAicOpenRtVersion.hpp"
 #include "QAicOpenRtUtil.hpp"
-#include "metadataflatbufDecode.hpp"
-#include "metadataflatbufEncode.hpp"
+#include "QAicPartitionPlanner.h"
 #include "QLogger.h"
 #include "QAicRuntimeTypes.h"
 #include "QUtil.h"
 #include "QOsal.h"
 #include "QLog.h"
-#include "QAicQpc.h"
 #include "nlohmann/json.hpp"
-#include "elfio/elfio.hpp"
 
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
 #include <getopt.h>
 #include <iostream>
 #include <unistd.h>
@@ -28,14 +28,21 @@ constexpr char gKeyNumSem[] = "numSem";
 constexpr char gKeyNumVc[] = "numVc";
 constexpr char gKeyL2Region[] = "l2Region";
 constexpr char gKeyNumNetworks[] = "numNetworks";
-constexpr size_t offset = 0;
 
 class QAicDevicePartition {
 public:
   QAicDevicePartition(const std::string &partConfigFilePath);
-  QAicDevicePartition(const std::vector<std::string> &programQpcList);
+  QAicDevicePartition(const std::vector<std::string> &programQpcList,
+                      const std::vector<uint32_t> &programInstances);
   [[nodiscard]] QStatus init(int32_t qaicDeviceId); // -1 - All devices
 
+  // Places each program in its own derived device instead of reserving the
+  // largest program on every device. With dryRun the plan is only printed,
+  // cardCapacityPath plans against the cards it lists instead of the
+  // devices present.
+  void setPlan(PlanObjective objective, bool dryRun,
+               const std::string &cardCapacityPath);
+
 private:
   uint8_t addVals_;
   qaic::QRuntimeInterface *rt_;
@@ -44,25 +51,39 @@ private:
   nlohmann::json partConfigJson_;
   std::string partConfigFilePath_;
   std::vector<std::string> programQpcList_;
+  std::vector<uint32_t> programInstances_;
   std::vector<std::pair<QID, QResourceReservationID>> resIdList_;
+  bool usePlan_ = false;
+  bool dryRun_ = false;
+  PlanObjective planObjective_ = PlanObjective::Pack;
+  std::string cardCapacityPath_;
 
   [[nodiscard]] QStatus populateDevList();
   [[nodiscard]] QStatus createReservationsFromConfig();
   [[nodiscard]] QStatus createReservationsFromQpcList();
+  [[nodiscard]] QStatus readProgramDemands(std::vector<ProgramDemand> &demands);
+  [[nodiscard]] QStatus readCardCapacities(std::vector<CardCapacity> &cards);
+  [[nodiscard]] QStatus createReservationsFromPlan();
   [[nodiscard]] QStatus createResourceReservedDevices();
   [[nodiscard]] QStatus initFromQpcList(int32_t qaicDeviceId);
   [[nodiscard]] QStatus initFromPartConfig(int32_t qaicDeviceId);
-  [[nodiscard]] QStatus readBinaryFile(const std::string &path,
-                                       std::unique_ptr<uint8_t[]> &qpcBuf,
-                                       size_t &qpcSize);
 };
 
 QAicDevicePartition::QAicDevicePartition(const std::string &partConfigFilePath)
     : partConfigFilePath_(partConfigFilePath) {}
 
 QAicDevicePartition::QAicDevicePartition(
-    const std::vector<std::string> &programQpcList)
-    : programQpcList_(programQpcList) {}
+    const std::vector<std::string> &programQpcList,
+    const std::vector<uint32_t> &programInstances)
+    : programQpcList_(programQpcList), programInstances_(programInstances) {}
+
+void QAicDevicePartition::setPlan(PlanObjective objective, bool dryRun,
+                                  const std::string &cardCapacityPath) {
+  usePlan_ = true;
+  dryRun_ = dryRun;
+  planObjective_ = objective;
+  cardCapacityPath_ = cardCapacityPath;
+}
 
 QStatus QAicDevicePartition::populateDevList() {
   qaic::openrt::Util util;
@@ -71,105 +92,52 @@ QStatus QAicDevicePartition::populateDevList() {
   return status;
 }
 
-QStatus QAicDevicePartition::readBinaryFile(const std::string &path,
-                                            std::unique_ptr<uint8_t[]> &qpcBuf,
-                                            size_t &qpcSize) {
-  std::ifstream ifs(path, std::ifstream::binary | std::ifstream::ate);
-  if (!ifs) {
-    LogErrorG("Failed to open qpc binary file");
+QStatus
+QAicDevicePartition::readProgramDemands(std::vector<ProgramDemand> &demands) {
+  if (programQpcList_.empty()) {
     return QS_ERROR;
   }
 
-  qpcSize = static_cast<size_t>(ifs.tellg());
-  qpcBuf = std::make_unique<uint8_t[]>(qpcSize);
-  if (qpcBuf == nullptr) {
-    return QS_NOMEM;
+  demands.clear();
+  for (size_t i = 0; i < programQpcList_.size(); i++) {
+    ProgramDemand demand;
+    if (readProgramDemand(programQpcList_[i], demand) != QS_SUCCESS) {
+      return QS_ERROR;
+    }
+    if (i < programInstances_.size()) {
+      demand.instances = programInstances_[i];
+    }
+    demands.push_back(demand);
   }
-
-  ifs.seekg(0, std::ifstream::beg);
-  ifs.read(reinterpret_cast<char *>(qpcBuf.get()), qpcSize);
-  ifs.close();
   return QS_SUCCESS;
 }
 
 QStatus QAicDevicePartition::createReservationsFromQpcList() {
   QStatus status = QS_SUCCESS;
-  uint8_t *networkData;
-  size_t qpcSize;
 
   uint64_t reserveL2regionSize = 0;
   uint64_t reserveShddrSize = 0;
   uint32_t reserveNumMcid = 0;
   uint32_t reserveNumNsp = 0;
   uint32_t reserveNumSem = 0;
-  size_t networkDataSize = 0;
   uint32_t reserveNumVc = 0;
   uint16_t numNetworks = 0;
 
-  if (programQpcList_.empty()) {
+  std::vector<ProgramDemand> demands;
+  if (readProgramDemands(demands) != QS_SUCCESS) {
     return QS_ERROR;
   }
 
-  std::unique_ptr<uint8_t[]> qpcBuffer;
-  for (const auto &qpcPath : std::as_const(programQpcList_)) {
-    if (readBinaryFile(qpcPath, qpcBuffer, qpcSize)) {
-      return QS_ERROR;
-    }
-
-    if (copyQpcBuffer(qpcBuffer.get(), qpcBuffer.get(), qpcSize) == nullptr) {
-      return QS_ERROR;
-    }
-
-    if (!getQPCSegment(qpcBuffer.get(), "network.elf", &networkData,
-                       &networkDataSize, offset)) {
-      return QS_ERROR;
-    }
-
-    std::stringstream is(
-        std::string(reinterpret_cast<char *>(networkData), networkDataSize));
-
-    ELFIO::elfio elfReader;
-    if (!elfReader.load(is)) {
-      return QS_ERROR;
-    }
-
-    std::vector<uint8_t> flatbuf_bytes;
-    if (elfReader.sections[metadata::networkElfMetadataFBSection]) {
-      ELFIO::section *flatSec =
-          elfReader.sections[metadata::networkElfMetadataFBSection];
-      if (flatSec == nullptr) {
-        return QS_ERROR;
-      }
-      flatbuf_bytes = std::vector<uint8_t>(
-          flatSec->get_data(), flatSec->get_data() + flatSec->get_size());
-    } else {
-      ELFIO::section *metaSec = elfReader.sections["metadata"];
-      if (metaSec == nullptr) {
-        return QS_ERROR;
-      }
-      auto metadataOriginal = std::vector<uint8_t>(
-          metaSec->get_data(), metaSec->get_data() + metaSec->get_size());
-      flatbuf_bytes = metadata::FlatEncode::aicMetadataRawTranslateFlatbuff(
-          metadataOriginal);
-    }
-
-    std::string metadataError;
-    auto metadata = metadata::FlatDecode::readMetadataFlatNativeCPP(
-        flatbuf_bytes, metadataError);
-    if (!metadataError.empty()) {
-      return QS_ERROR;
-    }
-    reserveNumNsp = std::max<uint64_t>(reserveNumNsp, metadata->numNSPs);
+  for (const auto &demand : demands) {
+    reserveNumNsp = std::max<uint64_t>(reserveNumNsp, demand.numNsp);
     // For oversubsciption feature, MCID resources need to be addition
     // of all the programs passed.
-    reserveNumMcid += metadata->hostMulticastTable->multicastEntries.size();
-    reserveNumSem = std::max<uint64_t>(reserveNumSem, metadata->numSemaphores);
-    reserveShddrSize = std::max<uint64_t>(reserveShddrSize,
-                                          metadata->staticSharedDDRSize +
-                                              metadata->dynamicSharedDDRSize);
+    reserveNumMcid += demand.numMcid;
+    reserveNumSem = std::max<uint64_t>(reserveNumSem, demand.numSem);
+    reserveShddrSize = std::max<uint64_t>(reserveShddrSize, demand.shddrSize);
     reserveL2regionSize =
-        std::max<uint64_t>(reserveL2regionSize, metadata->l2CachedDDRSize);
-    reserveNumVc = std::max<uint64_t>(reserveNumVc, 1);
+        std::max<uint64_t>(reserveL2regionSize, demand.l2RegionSize);
+    reserveNumVc = std::max<uint64_t>(reserveNumVc, demand.numVc);
     numNetworks++;
   }
 
@@ -198,6 +166,87 @@ QStatus QAicDevicePartition::createReservationsFromQpcList() {
   return status;
 }
 
+QStatus
+QAicDevicePartition::readCardCapacities(std::vector<CardCapacity> &cards) {
+  if (!cardCapacityPath_.empty()) {
+    std::ifstream ifs(cardCapacityPath_);
+    if (!ifs) {
+      LogErrorG("Failed to open card capacity file");
+      return QS_ERROR;
+    }
+    nlohmann::json cardsJson = nlohmann::json::parse(ifs, nullptr, false);
+    if (cardsJson.is_discarded()) {
+      LogErrorG("Failed to parse card capacity file");
+      return QS_ERROR;
+    }
+    return qaicpart::readCardCapacities(cardsJson, cards);
+  }
+
+  cards.clear();
+  for (auto devId : devList_) {
+    QResourceInfo info;
+    if (rt_->getResourceInfo(devId, info) != QS_SUCCESS) {
+      LogErrorG("Failed to get resource info of device {}", devId);
+      continue;
+    }
+    cards.push_back(capacityFromResourceInfo(devId, info));
+  }
+  return cards.empty() ? QS_NODEV : QS_SUCCESS;
+}
+
+QStatus QAicDevicePartition::createReservationsFromPlan() {
+  std::vector<ProgramDemand> demands;
+  if (readProgramDemands(demands) != QS_SUCCESS) {
+    return QS_ERROR;
+  }
+  std::vector<CardCapacity> cards;
+  QStatus status = readCardCapacities(cards);
+  if (status != QS_SUCCESS) {
+    return status;
+  }
+
+  ReservationPlan plan;
+  QStatus planStatus =
+      planReservations(demands, cards, planObjective_, plan);
+  std::cout << plan.toJson().dump(2) << std::endl;
+  if (planStatus != QS_SUCCESS) {
+    LogErrorG("{} program instances do not fit on {} cards",
+              plan.unplaced.size(), cards.size());
+  }
+  // A partial plan is not applied, the operator would be left with some
+  // programs without a derived device
+  if (dryRun_ || planStatus != QS_SUCCESS) {
+    return planStatus;
+  }
+
+  for (const auto &res : plan.reservations) {
+    const ProgramDemand &demand = plan.programs[res.program];
+    QResourceReservationID resResId;
+
+    status = rt_->createResourceReservation(
+        res.devId, 1, demand.numNsp, demand.numMcid, demand.numSem,
+        demand.numVc, demand.shddrSize, demand.l2RegionSize, 0, resResId,
+        RESOURCE_GROUP_ID_DEFAULT);
+
+    if (status != QS_SUCCESS) {
+      LogErrorG("Failed to create reservation for {} on device {}",
+                demand.name, res.devId);
+      // All or nothing, release the reservations made so far
+      for (const auto &created : resIdList_) {
+        if (rt_->releaseResourceReservation(created.first, created.second) !=
+            QS_SUCCESS) {
+          LogErrorG("Failed to release reservation {} on device {}",
+                    created.second, created.first);
+        }
+      }
+      resIdList_.clear();
+      return status;
+    }
+    resIdList_.push_back(std::make_pair(res.devId, resResId));
+  }
+  return QS_SUCCESS;
+}
+
 QStatus QAicDevicePartition::createReservationsFromConfig() {
   QStatus status = QS_SUCCESS;
   uint16_t numNetworks = 0;
@@ -287,7 +336,14 @@ QAicDevicePartition::initFromPartConfig([[maybe_unused]] int32_t qaicDeviceId) {
 QStatus
 QAicDevicePartition::initFromQpcList([[maybe_unused]] int32_t qaicDeviceId) {
   QStatus status = QS_SUCCESS;
-  status = createReservationsFromQpcList();
+  if (usePlan_) {
+    status = createReservationsFromPlan();
+    if (dryRun_) {
+      return status;
+    }
+  } else {
+    status = createReservationsFromQpcList();
+  }
   if (status != QS_SUCCESS) {
     LogErrorG("Failed to create reservations from qpc binary");
     return status;
@@ -300,6 +356,12 @@ QAicDevicePartition::initFromQpcList([[maybe_unused]] int32_t qaicDeviceId) {
 }
 
 QStatus QAicDevicePartition::init(int32_t qaicDeviceId) {
+  // A dry run against given card capacities needs no device
+  if (usePlan_ && dryRun_ && !cardCapacityPath_.empty() &&
+      partConfigFilePath_.empty()) {
+    return createReservationsFromPlan();
+  }
+
   rt_ = qaic::QRuntimeManager::getRuntime();
   if (rt_ == nullptr) {
     return QS_ERROR;
@@ -334,6 +396,14 @@ static void usage() {
          "  -q, --program-qpc                  Path to the program QPC. this param can be repeated. The\n"
          "                                     reservation will correspond to the largest program requested.\n"
          "                                     'partition-config' takes precedence over this param.\n"
+         "  -i, --instances <n>                Number of derived devices for the preceding program QPC\n"
+         "                                     with --plan. Default: 1\n"
+         "  -P, --plan <pack|spread>           Reserve a derived device per program instead, placed across\n"
+         "                                     all devices. 'pack' uses as few devices as possible, 'spread'\n"
+         "                                     balances derived devices across devices.\n"
+         "  -n, --dry-run                      Print the plan without creating any reservation\n"
+         "  -c, --card-capacity <path>         Plan against the devices listed in a json file instead of\n"
+         "                                     the devices present\n"
          "  -h, --help                         help\n");
 }
 // clang-format on
@@ -341,19 +411,28 @@ static void usage() {
 int main(int argc, char **argv) {
   std::string partConfigFilePath("");
   std::vector<std::string> programQpcList;
+  std::vector<uint32_t> programInstances;
   std::shared_ptr<QAicDevicePartition> qAicDevicePart(nullptr);
+  std::string planObjective;
+  std::string cardCapacityPath;
+  bool dryRun = false;
+  bool instancesSet = false;
 
   int32_t deviceId = -1;
   struct option long_options[] = {
       {"partition-config", required_argument, 0, 'p'},
       {"aic-device-id", optional_argument, 0, 'd'},
       {"program-qpc", optional_argument, 0, 'q'},
+      {"instances", required_argument, 0, 'i'},
+      {"plan", required_argument, 0, 'P'},
+      {"dry-run", no_argument, 0, 'n'},
+      {"card-capacity", required_argument, 0, 'c'},
       {0, 0, 0, 0}};
 
   int option_index = 0;
   int opt;
 
-  while ((opt = getopt_long(argc, argv, "p:d:q:r:sah", long_options,
+  while ((opt = getopt_long(argc, argv, "p:d:q:i:P:nc:r:sah", long_options,
                             &option_index)) != -1) {
     switch (opt) {
     case 'p':
@@ -364,6 +443,36 @@ int main(int argc, char **argv) {
       break;
     case 'q':
       programQpcList.push_back(std::string(optarg));
+      programInstances.push_back(1);
+      break;
+    case 'i':
+      if (programInstances.empty()) {
+        std::cout << "--instances must follow --program-qpc" << std::endl;
+        usage();
+        return 1;
+      }
+      {
+        char *end = nullptr;
+        errno = 0;
+        const long instances = std::strtol(optarg, &end, 10);
+        if (end == optarg || *end != '\0' || errno != 0 || instances <= 0 ||
+            instances > UINT32_MAX) {
+          std::cout << "Invalid --instances " << optarg << std::endl;
+          usage();
+          return 1;
+        }
+        programInstances.back() = static_cast<uint32_t>(instances);
+        instancesSet = true;
+      }
+      break;
+    case 'P':
+      planObjective = std::string(optarg);
+      break;
+    case 'n':
+      dryRun = true;
+      break;
+    case 'c':
+      cardCapacityPath = std::string(optarg);
       break;
     case 'h':
     default:
@@ -372,13 +481,36 @@ int main(int argc, char **argv) {
     }
   }
 
+  // Options of the planner do nothing without it
+  if (planObjective.empty() &&
+      (instancesSet || dryRun || !cardCapacityPath.empty())) {
+    std::cout << "--instances, --dry-run and --card-capacity require --plan"
+              << std::endl;
+    usage();
+    return 1;
+  }
+  if (!planObjective.empty() && !partConfigFilePath.empty()) {
+    std::cout << "--plan does not apply to --partition-config" << std::endl;
+    usage();
+    return 1;
+  }
+
   if (partConfigFilePath.empty()) {
     if (programQpcList.empty()) {
       std::cout << "Invalid config" << std::endl;
       usage();
       return 0;
     }
-    qAicDevicePart = std::make_shared<QAicDevicePartition>(programQpcList);
+    qAicDevicePart = std::make_shared<QAicDevicePartition>(programQpcList,
+                                                           programInstances);
+    if (!planObjective.empty()) {
+      PlanObjective objective;
+      if (parsePlanObjective(planObjective, objective) != QS_SUCCESS) {
+        usage();
+        return 1;
+      }
+      qAicDevicePart->setPlan(objective, dryRun, cardCapacityPath);
+    }
   } else {
     qAicDevicePart = std::make_shared<QAicDevicePartition>(partConfigFilePath);
   }
@@ -391,6 +523,10 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (dryRun && !planObjective.empty()) {
+    return 0;
+  }
+
   // Just pause the process execution. The process will exit when it gets a
   // signal
   // This call will ensure that no cpu cycles are consumed by the process.
@@ -0,0 +1,324 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QAicPartitionPlanner.h"
+#include "metadataflatbufDecode.hpp"
+#include "metadataflatbufEncode.hpp"
+#include "QLogger.h"
+#include "QAicQpc.h"
+#include "elfio/elfio.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace qaicpart {
+
+namespace {
+
+constexpr char gKeyDeviceId[] = "deviceId";
+constexpr char gKeyNumNsp[] = "numNsp";
+constexpr char gKeyNumMcid[] = "numMcid";
+constexpr char gKeyNumSem[] = "numSem";
+constexpr char gKeyNumVc[] = "numVc";
+constexpr char gKeyDdrSize[] = "ddrSize";
+constexpr char gKeyL2Region[] = "l2Region";
+
+constexpr uint64_t bytesPerMB = 1024 * 1024;
+
+const char *objectiveName(PlanObjective objective) {
+  return (objective == PlanObjective::Spread) ? "spread" : "pack";
+}
+
+bool fits(const ProgramDemand &demand, const CardCapacity &card) {
+  return (demand.numNsp <= card.numNsp) && (demand.numMcid <= card.numMcid) &&
+         (demand.numSem <= card.numSem) && (demand.numVc <= card.numVc) &&
+         (demand.shddrSize + demand.l2RegionSize <= card.ddrSize);
+}
+
+void take(const ProgramDemand &demand, CardCapacity &card) {
+  card.numNsp -= demand.numNsp;
+  card.numMcid -= demand.numMcid;
+  card.numSem -= demand.numSem;
+  card.numVc -= demand.numVc;
+  card.ddrSize -= demand.shddrSize + demand.l2RegionSize;
+}
+
+// True if placing on card a is better than on card b. Both cards are the
+// capacity left after the placement.
+bool better(PlanObjective objective, const CardCapacity &a, size_t aUsed,
+            const CardCapacity &b, size_t bUsed) {
+  if (objective == PlanObjective::Pack) {
+    // Best fit: the card left with the least room, so that large programs
+    // still find a card with room later on
+    if (a.numNsp != b.numNsp) {
+      return a.numNsp < b.numNsp;
+    }
+    if (a.ddrSize != b.ddrSize) {
+      return a.ddrSize < b.ddrSize;
+    }
+    return aUsed > bUsed;
+  }
+  // Worst fit: the card left with the most room, then the one holding the
+  // fewest derived devices
+  if (a.numNsp != b.numNsp) {
+    return a.numNsp > b.numNsp;
+  }
+  if (aUsed != bUsed) {
+    return aUsed < bUsed;
+  }
+  return a.ddrSize > b.ddrSize;
+}
+
+QStatus readUint(const nlohmann::json &json, const char *key,
+                 uint64_t &value) {
+  auto it = json.find(key);
+  if ((it == json.end()) || !it->is_number_integer() ||
+      (it->get<int64_t>() < 0)) {
+    LogErrorG("Card capacity is missing {}", key);
+    return QS_INVAL;
+  }
+  value = it->get<uint64_t>();
+  return QS_SUCCESS;
+}
+
+} // namespace
+
+size_t ReservationPlan::getNumCardsUsed() const {
+  std::vector<QID> used;
+  for (const auto &res : reservations) {
+    if (std::find(used.begin(), used.end(), res.devId) == used.end()) {
+      used.push_back(res.devId);
+    }
+  }
+  return used.size();
+}
+
+nlohmann::json ReservationPlan::toJson() const {
+  auto entry = [this](const PlannedReservation &res) {
+    const ProgramDemand &demand = programs[res.program];
+    nlohmann::json json;
+    json["program"] = demand.name;
+    json["instance"] = res.instance;
+    json[gKeyNumNsp] = demand.numNsp;
+    json[gKeyNumMcid] = demand.numMcid;
+    json[gKeyNumSem] = demand.numSem;
+    json[gKeyNumVc] = demand.numVc;
+    json[gKeyDdrSize] = demand.shddrSize;
+    json[gKeyL2Region] = demand.l2RegionSize;
+    return json;
+  };
+
+  nlohmann::json json;
+  json["objective"] = objectiveName(objective);
+  json["cardsUsed"] = getNumCardsUsed();
+  json["reservations"] = nlohmann::json::array();
+  for (const auto &res : reservations) {
+    nlohmann::json resJson = entry(res);
+    resJson[gKeyDeviceId] = res.devId;
+    json["reservations"].push_back(resJson);
+  }
+  json["unplaced"] = nlohmann::json::array();
+  for (const auto &res : unplaced) {
+    json["unplaced"].push_back(entry(res));
+  }
+  return json;
+}
+
+ProgramDemand demandFromMetadata(const AicMetadataFlat::MetadataT &metadata,
+                                 const std::string &name) {
+  ProgramDemand demand;
+  demand.name = name;
+  demand.numNsp = metadata.numNSPs;
+  if (metadata.hostMulticastTable != nullptr) {
+    demand.numMcid = static_cast<uint32_t>(
+        metadata.hostMulticastTable->multicastEntries.size());
+  }
+  demand.numSem = metadata.numSemaphores;
+  demand.numVc = 1;
+  demand.shddrSize =
+      metadata.staticSharedDDRSize + metadata.dynamicSharedDDRSize;
+  demand.l2RegionSize = metadata.l2CachedDDRSize;
+  return demand;
+}
+
+QStatus readProgramDemand(const std::string &qpcPath, ProgramDemand &demand) {
+  std::ifstream ifs(qpcPath, std::ifstream::binary | std::ifstream::ate);
+  if (!ifs) {
+    LogErrorG("Failed to open qpc binary file {}", qpcPath);
+    return QS_ERROR;
+  }
+  size_t qpcSize = static_cast<size_t>(ifs.tellg());
+  auto qpcBuffer = std::make_unique<uint8_t[]>(qpcSize);
+  ifs.seekg(0, std::ifstream::beg);
+  ifs.read(reinterpret_cast<char *>(qpcBuffer.get()), qpcSize);
+  if (!ifs) {
+    LogErrorG("Failed to read qpc binary file {}", qpcPath);
+    return QS_ERROR;
+  }
+
+  if (copyQpcBuffer(qpcBuffer.get(), qpcBuffer.get(), qpcSize) == nullptr) {
+    return QS_ERROR;
+  }
+
+  uint8_t *networkData = nullptr;
+  size_t networkDataSize = 0;
+  std::vector<uint8_t> networkElf;
+  if (isQpcCompressed(qpcBuffer.get())) {
+    if (readQPCSegment(qpcBuffer.get(), "network.elf", networkElf, 0) != 0) {
+      return QS_ERROR;
+    }
+    networkData = networkElf.data();
+    networkDataSize = networkElf.size();
+  } else if (!getQPCSegment(qpcBuffer.get(), "network.elf", &networkData,
+                            &networkDataSize, 0)) {
+    return QS_ERROR;
+  }
+
+  std::stringstream is(
+      std::string(reinterpret_cast<char *>(networkData), networkDataSize));
+
+  ELFIO::elfio elfReader;
+  if (!elfReader.load(is)) {
+    return QS_ERROR;
+  }
+
+  std::vector<uint8_t> flatbuf_bytes;
+  ELFIO::section *flatSec =
+      elfReader.sections[metadata::networkElfMetadataFBSection];
+  if (flatSec != nullptr) {
+    flatbuf_bytes = std::vector<uint8_t>(
+        flatSec->get_data(), flatSec->get_data() + flatSec->get_size());
+  } else {
+    ELFIO::section *metaSec = elfReader.sections["metadata"];
+    if (metaSec == nullptr) {
+      return QS_ERROR;
+    }
+    auto metadataOriginal = std::vector<uint8_t>(
+        metaSec->get_data(), metaSec->get_data() + metaSec->get_size());
+    flatbuf_bytes =
+        metadata::FlatEncode::aicMetadataRawTranslateFlatbuff(metadataOriginal);
+  }
+
+  std::string metadataError;
+  auto metadata = metadata::FlatDecode::readMetadataFlatNativeCPP(
+      flatbuf_bytes, metadataError);
+  if (!metadataError.empty()) {
+    LogErrorG("Failed to decode metadata of {}: {}", qpcPath, metadataError);
+    return QS_ERROR;
+  }
+  demand = demandFromMetadata(*metadata, qpcPath);
+  return QS_SUCCESS;
+}
+
+CardCapacity capacityFromResourceInfo(QID devId, const QResourceInfo &info) {
+  CardCapacity card;
+  card.devId = devId;
+  card.numNsp = info.nspFree;
+  card.numMcid = info.mcidFree;
+  card.numSem = info.semFree;
+  card.numVc = info.vcFree;
+  card.ddrSize = info.dramFree * bytesPerMB;
+  return card;
+}
+
+QStatus readCardCapacities(const nlohmann::json &json,
+                           std::vector<CardCapacity> &cards) {
+  if (!json.is_array()) {
+    LogErrorG("Card capacities must be a json array");
+    return QS_INVAL;
+  }
+  cards.clear();
+  for (const auto &cardJson : json) {
+    uint64_t values[6];
+    const char *keys[] = {gKeyDeviceId, gKeyNumNsp, gKeyNumMcid,
+                          gKeyNumSem,   gKeyNumVc,  gKeyDdrSize};
+    for (size_t i = 0; i < 6; i++) {
+      QStatus status = readUint(cardJson, keys[i], values[i]);
+      if (status != QS_SUCCESS) {
+        return status;
+      }
+    }
+    CardCapacity card;
+    card.devId = static_cast<QID>(values[0]);
+    card.numNsp = static_cast<uint32_t>(values[1]);
+    card.numMcid = static_cast<uint32_t>(values[2]);
+    card.numSem = static_cast<uint32_t>(values[3]);
+    card.numVc = static_cast<uint32_t>(values[4]);
+    card.ddrSize = values[5];
+    cards.push_back(card);
+  }
+  return QS_SUCCESS;
+}
+
+QStatus parsePlanObjective(const std::string &name, PlanObjective &objective) {
+  if (name == objectiveName(PlanObjective::Pack)) {
+    objective = PlanObjective::Pack;
+  } else if (name == objectiveName(PlanObjective::Spread)) {
+    objective = PlanObjective::Spread;
+  } else {
+    LogErrorG("Invalid plan objective {}", name);
+    return QS_INVAL;
+  }
+  return QS_SUCCESS;
+}
+
+QStatus planReservations(std::vector<ProgramDemand> programs,
+                         std::vector<CardCapacity> cards,
+                         PlanObjective objective, ReservationPlan &plan) {
+  plan = ReservationPlan();
+  plan.objective = objective;
+  plan.programs = std::move(programs);
+  plan.cards = std::move(cards);
+
+  std::vector<PlannedReservation> instances;
+  for (size_t p = 0; p < plan.programs.size(); p++) {
+    for (uint32_t i = 0; i < plan.programs[p].instances; i++) {
+      instances.push_back({0, p, i});
+    }
+  }
+  // Largest first, NSPs are the scarcest resource of a card
+  std::stable_sort(instances.begin(), instances.end(),
+                   [&plan](const PlannedReservation &a,
+                           const PlannedReservation &b) {
+                     const ProgramDemand &da = plan.programs[a.program];
+                     const ProgramDemand &db = plan.programs[b.program];
+                     if (da.numNsp != db.numNsp) {
+                       return da.numNsp > db.numNsp;
+                     }
+                     return da.shddrSize + da.l2RegionSize >
+                            db.shddrSize + db.l2RegionSize;
+                   });
+
+  std::vector<CardCapacity> left = plan.cards;
+  std::vector<size_t> used(left.size(), 0);
+  for (auto &instance : instances) {
+    const ProgramDemand &demand = plan.programs[instance.program];
+    size_t best = left.size();
+    CardCapacity bestLeft;
+    for (size_t c = 0; c < left.size(); c++) {
+      if (!fits(demand, left[c])) {
+        continue;
+      }
+      CardCapacity after = left[c];
+      take(demand, after);
+      if ((best == left.size()) ||
+          better(objective, after, used[c], bestLeft, used[best])) {
+        best = c;
+        bestLeft = after;
+      }
+    }
+    if (best == left.size()) {
+      plan.unplaced.push_back(instance);
+      continue;
+    }
+    left[best] = bestLeft;
+    used[best]++;
+    instance.devId = left[best].devId;
+    plan.reservations.push_back(instance);
+  }
+
+  return plan.unplaced.empty() ? QS_SUCCESS : QS_NOSPC;
+}
+
+} // namespace qaicpart
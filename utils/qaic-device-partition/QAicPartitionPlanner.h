@@ -0,0 +1,100 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#ifndef QAIC_PARTITION_PLANNER_H
+#define QAIC_PARTITION_PLANNER_H
+
+#include "QAicRuntimeTypes.h"
+#include "nlohmann/json.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AicMetadataFlat {
+struct MetadataT;
+}
+
+namespace qaicpart {
+
+/// Resources one instance of a program needs in its own derived device
+struct ProgramDemand {
+  std::string name;
+  uint32_t numNsp = 0;
+  uint32_t numMcid = 0;
+  uint32_t numSem = 0;
+  uint32_t numVc = 1;
+  uint64_t shddrSize = 0;
+  uint64_t l2RegionSize = 0;
+  /// Number of derived devices to create for this program
+  uint32_t instances = 1;
+};
+
+/// Free resources of one card
+struct CardCapacity {
+  QID devId = 0;
+  uint32_t numNsp = 0;
+  uint32_t numMcid = 0;
+  uint32_t numSem = 0;
+  uint32_t numVc = 0;
+  /// Bytes of DDR available for shared DDR and L2 regions
+  uint64_t ddrSize = 0;
+};
+
+enum class PlanObjective {
+  /// Fill cards as tightly as possible, leaving whole cards unused
+  Pack,
+  /// Spread derived devices evenly for isolation between programs
+  Spread,
+};
+
+/// One derived device, reserved for one instance of a program
+struct PlannedReservation {
+  QID devId = 0;
+  size_t program = 0;
+  uint32_t instance = 0;
+};
+
+struct ReservationPlan {
+  PlanObjective objective = PlanObjective::Pack;
+  std::vector<ProgramDemand> programs;
+  std::vector<CardCapacity> cards;
+  std::vector<PlannedReservation> reservations;
+  /// Program instances no card had room for, same layout as reservations
+  std::vector<PlannedReservation> unplaced;
+
+  /// Number of cards holding at least one derived device
+  size_t getNumCardsUsed() const;
+  nlohmann::json toJson() const;
+};
+
+/// Derives the demand of a program from its decoded network metadata
+ProgramDemand demandFromMetadata(const AicMetadataFlat::MetadataT &metadata,
+                                 const std::string &name);
+
+/// Reads the network metadata of the QPC at \a qpcPath
+[[nodiscard]] QStatus readProgramDemand(const std::string &qpcPath,
+                                        ProgramDemand &demand);
+
+/// Converts a QResourceInfo of a device into its free capacity
+CardCapacity capacityFromResourceInfo(QID devId, const QResourceInfo &info);
+
+/// Reads card capacities from a json array, for planning offline
+[[nodiscard]] QStatus readCardCapacities(const nlohmann::json &json,
+                                         std::vector<CardCapacity> &cards);
+
+[[nodiscard]] QStatus parsePlanObjective(const std::string &name,
+                                         PlanObjective &objective);
+
+/// Places every instance of \a programs on \a cards. Instances are placed
+/// largest first, each on the card that fits it best for \a objective.
+/// Returns QS_NOSPC when some instances could not be placed, the plan then
+/// still holds every instance that could.
+[[nodiscard]] QStatus planReservations(std::vector<ProgramDemand> programs,
+                                       std::vector<CardCapacity> cards,
+                                       PlanObjective objective,
+                                       ReservationPlan &plan);
+
+} // namespace qaicpart
+
+#endif // QAIC_PARTITION_PLANNER_H
@@ -0,0 +1,68 @@
+// Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: BSD-3-Clause-Clear
+
+#include "QFlightRecorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+
+using qaic::QFlightDump;
+using qaic::QFlightRecorder;
+
+static void usage() {
+  printf("Usage: qaic-flight-decode [options] <dump>...\n"
+         "  -t, --tid <tid>    Only print the events of thread <tid>\n"
+         "  -h, --help         Print this help\n");
+}
+
+int main(int argc, char **argv) {
+  uint32_t tid = 0;
+  struct option long_options[] = {{"tid", required_argument, 0, 't'},
+                                  {"help", no_argument, 0, 'h'},
+                                  {0, 0, 0, 0}};
+
+  int option_index = 0;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "t:h", long_options,
+                            &option_index)) != -1) {
+    switch (opt) {
+    case 't':
+      tid = static_cast<uint32_t>(atoi(optarg));
+      break;
+    case 'h':
+      usage();
+      return 0;
+    default:
+      usage();
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    usage();
+    return 1;
+  }
+
+  int rc = 0;
+  for (int i = optind; i < argc; i++) {
+    QFlightDump dump;
+    if (QFlightRecorder::decode(argv[i], dump) != QS_SUCCESS) {
+      std::cerr << "Failed to decode " << argv[i] << std::endl;
+      rc = 1;
+      continue;
+    }
+    if (tid != 0) {
+      auto &threads = dump.threads;
+      threads.erase(std::remove_if(threads.begin(), threads.end(),
+                                   [tid](const auto &thread) {
+                                     return thread.tid != tid;
+                                   }),
+                    threads.end());
+    }
+    std::cout << argv[i] << std::endl;
+    QFlightRecorder::print(dump, std::cout);
+  }
+  return rc;
+}
@@ -11,6 +11,11 @@ const uint32_t numInferencesDefault = 1;
 const uint32_t startIterationDefault = 0;
 const uint32_t numSamplesDefault = 1;
 const std::string outputDirDefault = ".";
+const double offeredRateDefault = 100.0;
+const uint32_t numExecObjsDefault = 1;
+const double durationSecDefault = 10.0;
+const uint32_t prefetchSlotsDefault = 4;
+const uint32_t prefetchThreadsDefault = 2;
 
 //------------------------------------------------------------------
 // QAIC Runner Example Class Implementation
@@ -90,6 +95,48 @@ int QAicRunnerExample::checkUserParam() {
     return -1;
   }
 
+  if (openLoop_ && (writeOutputProperties_.enabled ||
+                    !outputFileList_.empty() || !aicStatsDir_.empty())) {
+    std::cerr << "Output validation, write-output and aic-stats are not "
+                 "supported with an arrival process"
+              << std::endl;
+    return -1;
+  }
+
+  const bool streamed = !inputDatasetPath_.empty() || !inputDir_.empty();
+  if (!inputDatasetPath_.empty() && !inputDir_.empty()) {
+    std::cerr << "Specify only one of input-dataset and input-dir" << std::endl;
+    return -1;
+  }
+  if (streamed && (!inputFileList_.empty() || !outputFileList_.empty() ||
+                   openLoop_)) {
+    std::cerr << "Input files, output validation and arrival processes are "
+                 "not supported with a streamed dataset"
+              << std::endl;
+    return -1;
+  }
+  if (isPackDataset() && inputDir_.empty()) {
+    std::cerr << "Missing input-dir to pack" << std::endl;
+    return -1;
+  }
+
+  if (replay_ && (openLoop_ || streamed || writeOutputProperties_.enabled ||
+                  !outputFileList_.empty() || !aicStatsDir_.empty() ||
+                  !recordTrafficPath_.empty())) {
+    std::cerr << "Arrival processes, streamed datasets, output validation, "
+                 "write-output, aic-stats and traffic recording are not "
+                 "supported with a traffic replay"
+              << std::endl;
+    return -1;
+  }
+
+  if (openLoop_ &&
+      (loadGenProperties_.arrival == qaic::openrt::LoadGenArrival::Trace) &&
+      loadGenProperties_.trace.empty()) {
+    std::cerr << "Missing trace-file for trace arrival" << std::endl;
+    return -1;
+  }
+
   if (verbosityLevel_ > 0) {
     std::cout << "Device: ID " << std::to_string(dev_) << std::endl;
     std::cout << "Test path: " << testBasePath_ << std::endl;
@@ -129,6 +176,24 @@ QStatus QAicRunnerExample::addBuffersToValidationList() {
   return QS_SUCCESS;
 }
 
+void QAicRunnerExample::printValidationReport(
+    const qaic::openrt::ValidationReport &report) {
+  if (report.sizeMismatch) {
+    std::cerr << fmt::format("Output {}: size differs from the reference\n",
+                             report.bufferName);
+    return;
+  }
+  std::string indexes;
+  for (const auto &index : report.firstMismatches) {
+    indexes += (indexes.empty() ? "" : " ") + std::to_string(index);
+  }
+  std::cerr << fmt::format("Output {}: {} of {} elements mismatch, max abs "
+                           "error {}, max ulp error {}, first at [{}]\n",
+                           report.bufferName, report.numMismatches,
+                           report.numElements, report.maxAbsError,
+                           report.maxUlpError, indexes);
+}
+
 QStatus QAicRunnerExample::validateOutput(const std::vector<QBuffer> &ioBuffers,
                                           size_t infIdx) {
   if (qpc_ == nullptr || validationBufferList_.empty()) {
@@ -147,6 +212,7 @@ QStatus QAicRunnerExample::validateOutput(const std::vector<QBuffer> &ioBuffers,
     return QS_ERROR;
   }
 
+  QStatus status = QS_SUCCESS;
   size_t valBufIndex = 0;
   size_t numSuccessfulValidations = 0;
   size_t numFailedValidations = 0;
@@ -170,18 +236,16 @@ QStatus QAicRunnerExample::validateOutput(const std::vector<QBuffer> &ioBuffers,
             validationBufferList_.size());
         return QS_ERROR;
       }
-      if (ioBuffers.at(buffIndex).size !=
-          validationBufferList_.at(valBufIndex).size) {
-        numFailedValidations++;
-        valBufIndex++;
-        continue;
-      }
-      if (std::equal(ioBuffers.at(buffIndex).buf,
-                     ioBuffers.at(buffIndex).buf + ioBuffers.at(buffIndex).size,
-                     validationBufferList_.at(valBufIndex).buf)) {
+      qaic::openrt::ValidationReport report;
+      status = outputValidator_->validate(bufMapping.bufferName,
+                                          ioBuffers.at(buffIndex),
+                                          validationBufferList_.at(valBufIndex),
+                                          report);
+      if (status == QS_SUCCESS) {
         numSuccessfulValidations++;
       } else {
         numFailedValidations++;
+        printValidationReport(report);
       }
       valBufIndex++;
     }
@@ -236,6 +300,111 @@ void QAicRunnerExample::setWriteOutputNumSamples(const uint32_t &num) {
   writeOutputProperties_.enabled = true;
 }
 
+bool QAicRunnerExample::setWriteOutputFormat(const char *format) {
+  const std::string name(format);
+  if (name == "files") {
+    writeOutputProperties_.packed = false;
+  } else if (name == "packed") {
+    writeOutputProperties_.packed = true;
+  } else {
+    return false;
+  }
+  writeOutputProperties_.enabled = true;
+  return true;
+}
+
+bool QAicRunnerExample::setInputFill(const char *pattern) {
+  const std::string name(pattern);
+  if (name == "random") {
+    inputFillProperties_.pattern = qaic::openrt::InputFillPattern::Random;
+  } else if (name == "bytes") {
+    inputFillProperties_.pattern =
+        qaic::openrt::InputFillPattern::RandomBytes;
+  } else if (name == "ramp") {
+    inputFillProperties_.pattern = qaic::openrt::InputFillPattern::Ramp;
+  } else if (name == "zero") {
+    inputFillProperties_.pattern = qaic::openrt::InputFillPattern::Zero;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void QAicRunnerExample::setInputSeed(uint64_t seed) {
+  inputFillProperties_.seed = seed;
+}
+
+void QAicRunnerExample::setValidationAbsTolerance(double tolerance) {
+  validationProperties_.absTolerance = tolerance;
+}
+
+void QAicRunnerExample::setValidationRelTolerance(double tolerance) {
+  validationProperties_.relTolerance = tolerance;
+}
+
+void QAicRunnerExample::setValidationUlpTolerance(uint32_t tolerance) {
+  validationProperties_.ulpTolerance = tolerance;
+}
+
+void QAicRunnerExample::setWriteOutputDirectIo() {
+  writeOutputProperties_.directIo = true;
+  writeOutputProperties_.enabled = true;
+}
+
+bool QAicRunnerExample::setAicStatsDir(const char *dir) {
+  struct stat info;
+  if (stat(dir, &info) != 0) {
+    if (mkdir(dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IWOTH) != 0) {
+      return false;
+    }
+  } else if (((info.st_mode & S_IFDIR) != S_IFDIR) ||
+             ((info.st_mode & S_IWUSR) != S_IWUSR)) {
+    return false;
+  }
+  aicStatsDir_ = std::string(dir);
+  return true;
+}
+
+void QAicRunnerExample::setAicStatsCyclesPerUs(double cyclesPerUs) {
+  aicStatsCyclesPerUs_ = cyclesPerUs;
+}
+
+QStatus QAicRunnerExample::exportAicStats(size_t infIdx) {
+  std::vector<QBuffer> ioBuffers;
+  QBuffer statsBuffer;
+  std::vector<qaic::openrt::AicOpStat> ops;
+
+  if (execObj_->getData(ioBuffers) != QS_SUCCESS) {
+    std::cerr << "Execobj getData failed" << std::endl;
+    return QS_ERROR;
+  }
+  if (qaic::openrt::AicStats::findStatsBuffer(
+          program_->getBufferMappings(), ioBuffers, statsBuffer) !=
+      QS_SUCCESS) {
+    std::cerr << "Program has no "
+              << qaic::openrt::AicStats::statsBufferName << " buffer"
+              << std::endl;
+    return QS_ERROR;
+  }
+  if (aicStats_->decode(statsBuffer, ops) != QS_SUCCESS) {
+    std::cerr << "Failed to decode AIC stats" << std::endl;
+    return QS_ERROR;
+  }
+
+  const std::string base =
+      aicStatsDir_ + "/aic-stats-inf-" + std::to_string(infIdx);
+  if ((aicStats_->writeChromeTrace(ops, base + ".json") != QS_SUCCESS) ||
+      (aicStats_->writeCsv(ops, base + ".csv") != QS_SUCCESS)) {
+    std::cerr << "Failed to write AIC stats to " << aicStatsDir_ << std::endl;
+    return QS_ERROR;
+  }
+  if (verbosityLevel_ >= 1) {
+    std::cout << "AIC stats for iteration " << infIdx << " written to "
+              << base << ".{json,csv}" << std::endl;
+  }
+  return QS_SUCCESS;
+}
+
 void QAicRunnerExample::getLastRunStats(uint64_t &infCompleted, double &infRate,
                                         uint64_t &runtimeUs,
                                         uint32_t &batchSize) {
@@ -247,6 +416,247 @@ void QAicRunnerExample::getLastRunStats(uint64_t &infCompleted, double &infRate,
       batchSize;
 }
 
+bool QAicRunnerExample::setArrival(const char *arrival) {
+  const std::string name(arrival);
+  if (name == "fixed") {
+    loadGenProperties_.arrival = qaic::openrt::LoadGenArrival::FixedRate;
+  } else if (name == "poisson") {
+    loadGenProperties_.arrival = qaic::openrt::LoadGenArrival::Poisson;
+  } else if (name == "trace") {
+    loadGenProperties_.arrival = qaic::openrt::LoadGenArrival::Trace;
+  } else {
+    return false;
+  }
+  openLoop_ = true;
+  return true;
+}
+
+void QAicRunnerExample::setOfferedRate(double rate) {
+  loadGenProperties_.rate = rate;
+  openLoop_ = true;
+}
+
+bool QAicRunnerExample::setTraceFile(const char *path) {
+  std::ifstream ifs(path);
+  if (!ifs.is_open() ||
+      (qaic::openrt::LoadGen::parseTrace(ifs, loadGenProperties_.trace) !=
+       QS_SUCCESS)) {
+    return false;
+  }
+  loadGenProperties_.arrival = qaic::openrt::LoadGenArrival::Trace;
+  openLoop_ = true;
+  return true;
+}
+
+void QAicRunnerExample::setNumExecObjs(uint32_t numExecObjs) {
+  numExecObjs_ = numExecObjs;
+}
+
+void QAicRunnerExample::setWarmupSec(double sec) {
+  loadGenProperties_.warmup = std::chrono::microseconds(
+      static_cast<int64_t>(sec * 1000000));
+}
+
+void QAicRunnerExample::setDurationSec(double sec) {
+  loadGenProperties_.duration = std::chrono::microseconds(
+      static_cast<int64_t>(sec * 1000000));
+}
+
+void QAicRunnerExample::getLastLoadReport(
+    qaic::openrt::LoadGenReport &report) {
+  report = loadReport_;
+}
+
+qaic::openrt::shInferenceVector QAicRunnerExample::createInferenceVector() {
+  if (!inputFileList_.empty()) {
+    qaic::openrt::shInferenceVector inferenceVector =
+        qaic::openrt::InferenceVector::Factory(qpc_, inputFileList_);
+    if (inferenceVector) {
+      inferenceVector->bindToDevice(dev_);
+    }
+    return inferenceVector;
+  }
+  qaic::openrt::shInferenceVector inferenceVector =
+      qaic::openrt::InferenceVector::Factory(
+          qpc_, qaic::openrt::InferenceVector::ZERO_FILL, dev_);
+  if (inferenceVector &&
+      inputFill_->fill(inferenceVector->getVector()) != QS_SUCCESS) {
+    return nullptr;
+  }
+  return inferenceVector;
+}
+
+QStatus QAicRunnerExample::initLoadGen() {
+  // Every ExecObj owns its buffers, outputs of concurrent requests must not
+  // overlap
+  std::vector<qaic::openrt::shInferenceVector> inferenceVectors{
+      inferenceVector_};
+  for (uint32_t i = 1; i < numExecObjs_; i++) {
+    qaic::openrt::shInferenceVector inferenceVector = createInferenceVector();
+    if (!inferenceVector) {
+      std::cerr << "Inference vector creation failed" << std::endl;
+      return QS_ERROR;
+    }
+    inferenceVectors.push_back(inferenceVector);
+  }
+  loadGen_ = qaic::openrt::LoadGen::Factory(context_, program_,
+                                            loadGenProperties_,
+                                            inferenceVectors);
+  return QS_SUCCESS;
+}
+
+QStatus QAicRunnerExample::runLoadGen() {
+  if (loadGen_->run(loadReport_) != QS_SUCCESS) {
+    std::cerr << "Load generation failed" << std::endl;
+    return QS_ERROR;
+  }
+  lastRunDurationUs_ =
+      static_cast<uint64_t>(loadReport_.windowSec * 1000000);
+  // Failed inferences are part of the report
+  return QS_SUCCESS;
+}
+
+void QAicRunnerExample::setInputDataset(const char *path) {
+  inputDatasetPath_ = path;
+}
+
+bool QAicRunnerExample::setInputDir(const char *dir) {
+  struct stat info;
+  if ((stat(dir, &info) != 0) || ((info.st_mode & S_IFDIR) != S_IFDIR)) {
+    return false;
+  }
+  inputDir_ = dir;
+  return true;
+}
+
+void QAicRunnerExample::setPrefetchSlots(uint32_t numSlots) {
+  streamerProperties_.numSlots = numSlots;
+}
+
+void QAicRunnerExample::setPrefetchThreads(uint32_t numThreads) {
+  streamerProperties_.numThreads = numThreads;
+}
+
+void QAicRunnerExample::setPackDatasetPath(const char *path) {
+  packDatasetPath_ = path;
+}
+
+uint32_t QAicRunnerExample::getNumProgramInputs() const {
+  const BufferMappings &bufferMappings = qpc_->getBufferMappings();
+  return static_cast<uint32_t>(
+      std::count_if(bufferMappings.begin(), bufferMappings.end(),
+                    [](const BufferMapping &m) {
+                      return m.ioType ==
+                             QAicBufferIoTypeEnum::BUFFER_IO_TYPE_INPUT;
+                    }));
+}
+
+QStatus QAicRunnerExample::packDataset() {
+  try {
+    qpc_ = qaic::openrt::Qpc::Factory(testBasePath_);
+    auto source =
+        qaic::openrt::FileSetDataset::Factory(inputDir_, getNumProgramInputs());
+    if (qaic::openrt::PackedDataset::write(packDatasetPath_,
+                                           source->getFileSets()) !=
+        QS_SUCCESS) {
+      std::cerr << "Failed to write dataset " << packDatasetPath_
+                << std::endl;
+      return QS_ERROR;
+    }
+    std::cout << "Packed " << source->getNumSamples() << " samples to "
+              << packDatasetPath_ << std::endl;
+  } catch (const qaic::openrt::CoreExceptionInit &e) {
+    std::cerr << "Exception Caught during packing: " << e.what() << std::endl;
+    return QS_ERROR;
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QAicRunnerExample::initDatasetStreamer() {
+  qaic::openrt::shDatasetSource source;
+  if (!inputDatasetPath_.empty()) {
+    source = qaic::openrt::PackedDataset::Factory(inputDatasetPath_);
+  } else {
+    source =
+        qaic::openrt::FileSetDataset::Factory(inputDir_, getNumProgramInputs());
+  }
+  streamerProperties_.device = dev_;
+  streamer_ = qaic::openrt::DatasetStreamer::Factory(
+      qpc_->getBufferMappings(), source, streamerProperties_);
+  if (verbosityLevel_ > 0) {
+    std::cout << "Streaming " << source->getNumSamples() << " samples"
+              << std::endl;
+  }
+  return QS_SUCCESS;
+}
+
+void QAicRunnerExample::setRecordTraffic(const char *path) {
+  recordTrafficPath_ = path;
+}
+
+void QAicRunnerExample::setRecordPayload() {
+  recorderProperties_.recordPayload = true;
+}
+
+bool QAicRunnerExample::setReplayTraffic(const char *path) {
+  if (qaic::openrt::TrafficRecorder::load(path, replayTrace_) !=
+          QS_SUCCESS ||
+      replayTrace_.requests.empty()) {
+    return false;
+  }
+  replay_ = true;
+  return true;
+}
+
+void QAicRunnerExample::setReplayTimeScale(double timeScale) {
+  replayProperties_.timeScale = timeScale;
+}
+
+void QAicRunnerExample::getLastReplayReport(
+    qaic::openrt::TrafficReplayReport &report) {
+  report = replayReport_;
+}
+
+QStatus QAicRunnerExample::initTrafficReplay() {
+  // Inputs without a recorded payload keep the content of the -i files or
+  // the generated inputs
+  trafficReplay_ = qaic::openrt::TrafficReplay::Factory(
+      context_, program_, replayTrace_, replayProperties_, inferenceVector_);
+  if (verbosityLevel_ > 0) {
+    std::cout << "Replaying " << replayTrace_.requests.size()
+              << " inferences on " << trafficReplay_->getNumThreads()
+              << " threads" << std::endl;
+  }
+  return QS_SUCCESS;
+}
+
+QStatus QAicRunnerExample::runTrafficReplay() {
+  if (trafficReplay_->run(replayReport_) != QS_SUCCESS) {
+    std::cerr << "Traffic replay failed" << std::endl;
+    return QS_ERROR;
+  }
+  lastRunDurationUs_ =
+      static_cast<uint64_t>(replayReport_.durationSec * 1000000);
+  // Failed inferences are part of the report
+  return QS_SUCCESS;
+}
+
+QStatus QAicRunnerExample::saveTraffic() {
+  if (!trafficRecorder_) {
+    return QS_SUCCESS;
+  }
+  if (trafficRecorder_->save(recordTrafficPath_) != QS_SUCCESS) {
+    std::cerr << "Failed to write traffic trace " << recordTrafficPath_
+              << std::endl;
+    return QS_ERROR;
+  }
+  if (trafficRecorder_->getNumDropped() > 0) {
+    std::cerr << "Traffic trace full, " << trafficRecorder_->getNumDropped()
+              << " inferences not recorded" << std::endl;
+  }
+  return QS_SUCCESS;
+}
+
 QStatus QAicRunnerExample::init() {
   try {
     QStatus status = QS_ERROR;
@@ -281,16 +691,6 @@ QStatus QAicRunnerExample::init() {
 
     context_->setLogLevel(qLogLevel_);
 
-    /* In case inputfile list is empty, inference vector will generate
-      buffers with random data as default */
-    inferenceVector_ =
-        qaic::openrt::InferenceVector::Factory(qpc_, inputFileList_);
-
-    if (!inferenceVector_) {
-      std::cerr << "Inference vector creation failed" << std::endl;
-      return QS_ERROR;
-    }
-
     qaic::openrt::Program::initProperties(programProperties_);
 
     program_ = qaic::openrt::Program::Factory(context_, dev_, "QAicRunner",
@@ -301,6 +701,42 @@ QStatus QAicRunnerExample::init() {
       return QS_ERROR;
     }
 
+    // In case inputfile list is empty, inputs are generated with values
+    // valid for the data type and quantization of every program input
+    inputFillProperties_.device = dev_;
+    inputFill_ =
+        qaic::openrt::InputFill::Factory(program_, inputFillProperties_);
+    inferenceVector_ = createInferenceVector();
+
+    if (!inferenceVector_) {
+      std::cerr << "Inference vector creation failed" << std::endl;
+      return QS_ERROR;
+    }
+
+    if (replay_) {
+      return initTrafficReplay();
+    }
+
+    if (!recordTrafficPath_.empty()) {
+      trafficRecorder_ =
+          qaic::openrt::TrafficRecorder::Factory(recorderProperties_);
+    }
+
+    if (openLoop_) {
+      status = initLoadGen();
+      if (status == QS_SUCCESS) {
+        loadGen_->setTrafficRecorder(trafficRecorder_);
+      }
+      return status;
+    }
+
+    if (!inputDatasetPath_.empty() || !inputDir_.empty()) {
+      status = initDatasetStreamer();
+      if (status != QS_SUCCESS) {
+        return status;
+      }
+    }
+
     execObj_ = qaic::openrt::ExecObj::Factory(context_, program_);
 
     if (!execObj_) {
@@ -315,12 +751,43 @@ QStatus QAicRunnerExample::init() {
       return QS_ERROR;
     }
 
+    execObj_->setTrafficRecorder(trafficRecorder_);
+
+    if (!aicStatsDir_.empty()) {
+      if (!program_->getProgramInfo().isAicStatsAvailable) {
+        std::cerr << "Program not compiled with AIC stats" << std::endl;
+        return QS_ERROR;
+      }
+      aicStats_ = qaic::openrt::AicStats::Factory(program_);
+      aicStats_->setCyclesPerUs(aicStatsCyclesPerUs_);
+    }
+
+    if (writeOutputProperties_.enabled) {
+      qaic::openrt::FileWriterProperties writerProperties;
+      // Outputs are copied and written by a background thread, so that
+      // the inference loop does not wait on the disk
+      writerProperties.async = true;
+      if (writeOutputProperties_.packed) {
+        writerProperties.format = qaic::openrt::FileWriterFormat::Packed;
+      }
+      writerProperties.directIo = writeOutputProperties_.directIo;
+      status = fileWriter_.setProperties(writerProperties);
+      if (status != QS_SUCCESS) {
+        std::cerr << "File writer configuration failed" << std::endl;
+        return QS_ERROR;
+      }
+    }
+
     if (!outputFileList_.empty()) {
       status = addBuffersToValidationList();
       if (status != QS_SUCCESS) {
         std::cerr << "Validation buffer creation failed" << std::endl;
         return QS_ERROR;
       }
+      // Outputs are compared in their data type, quantized outputs with the
+      // scale and offset of the program
+      outputValidator_ = qaic::openrt::OutputValidator::Factory(
+          program_, validationProperties_);
       validateOutputEnabled_ = true;
     }
 
@@ -336,8 +803,31 @@ QStatus QAicRunnerExample::run() {
   QStatus status = QS_ERROR;
   QTimePoint startTime, endTime;
   try {
+    if (replay_) {
+      return runTrafficReplay();
+    }
+    if (openLoop_) {
+      status = runLoadGen();
+      return (status == QS_SUCCESS) ? saveTraffic() : status;
+    }
     for (size_t inferenceIndex = 0; inferenceIndex < numInferences_;
          inferenceIndex++) {
+      // Released once the outputs of the inference have been consumed
+      qaic::openrt::DatasetSlot slot;
+      if (streamer_) {
+        status = streamer_->acquire(slot);
+        if (status != QS_SUCCESS) {
+          std::cerr << "Failed to load sample " << slot.sampleIndex
+                    << std::endl;
+          return QS_ERROR;
+        }
+        status = execObj_->setData(slot.inferenceVector);
+        if (status != QS_SUCCESS) {
+          std::cerr << "ExecObj set data failed" << std::endl;
+          return QS_ERROR;
+        }
+      }
+
       startTime = std::chrono::steady_clock::now();
       status = execObj_->run();
       endTime = std::chrono::steady_clock::now();
@@ -356,8 +846,13 @@ QStatus QAicRunnerExample::run() {
         if ((inferenceIndex >= writeOutputProperties_.startIteration) &&
             (inferenceIndex < (writeOutputProperties_.numSamplesToWrite +
                                writeOutputProperties_.startIteration))) {
-          fileWriter_.writeExecObjData(execObj_, qpc_->getBufferMappings(),
-                                       inferenceIndex);
+          status = fileWriter_.writeExecObjData(
+              execObj_, qpc_->getBufferMappings(), inferenceIndex);
+          if (status != QS_SUCCESS) {
+            std::cerr << "Failed to write outputs of iteration "
+                      << inferenceIndex + 1 << std::endl;
+            return QS_ERROR;
+          }
         }
       }
 
@@ -376,14 +871,50 @@ QStatus QAicRunnerExample::run() {
           return QS_ERROR;
         }
       }
+
+      // Stats of the last iteration are exported
+      if (aicStats_ && (inferenceIndex + 1 == numInferences_)) {
+        status = exportAicStats(inferenceIndex);
+        if (status != QS_SUCCESS) {
+          return QS_ERROR;
+        }
+      }
+
+      if (streamer_) {
+        streamer_->release(slot);
+      }
     }
   } catch (const qaic::openrt::CoreExceptionRuntime &e) {
     std::cerr << "Exception Caught during execution: " << e.what() << std::endl;
     return QS_ERROR;
   }
 
+  // Wait for the queued outputs to reach the files
+  if (writeOutputProperties_.enabled && (fileWriter_.close() != QS_SUCCESS)) {
+    std::cerr << "Failed to write outputs" << std::endl;
+    return QS_ERROR;
+  }
+
+  if (saveTraffic() != QS_SUCCESS) {
+    return QS_ERROR;
+  }
+
   if (verbosityLevel_ >= 1) {
     std::cout << "Inference run completed successfully!" << std::endl;
+    if (writeOutputProperties_.enabled) {
+      uint64_t bytesWritten = 0;
+      uint64_t stalls = 0;
+      fileWriter_.getStats(bytesWritten, stalls);
+      std::cout << "Output bytes written: " << bytesWritten
+                << ", writes waiting on the disk: " << stalls << std::endl;
+    }
+    if (streamer_) {
+      uint64_t loaded = 0;
+      uint64_t stalls = 0;
+      streamer_->getStats(loaded, stalls);
+      std::cout << "Samples loaded: " << loaded
+                << ", inferences waiting on input: " << stalls << std::endl;
+    }
     if (validateOutputEnabled_) {
       std::cout << "Output validation successful!" << std::endl;
     }
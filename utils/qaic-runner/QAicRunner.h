@@ -21,15 +21,23 @@ extern const uint32_t numInferencesDefault;
 extern const uint32_t startIterationDefault;
 extern const uint32_t numSamplesDefault;
 extern const std::string outputDirDefault;
+extern const double offeredRateDefault;
+extern const uint32_t numExecObjsDefault;
+extern const double durationSecDefault;
+extern const uint32_t prefetchSlotsDefault;
+extern const uint32_t prefetchThreadsDefault;
 
 struct QAicRunnerWriteOutputProperties {
   bool enabled;
   uint32_t startIteration;
   uint32_t numSamplesToWrite;
   std::string outputDir;
+  bool packed;
+  bool directIo;
   QAicRunnerWriteOutputProperties()
       : enabled(false), startIteration(startIterationDefault),
-        numSamplesToWrite(numSamplesDefault), outputDir(outputDirDefault) {}
+        numSamplesToWrite(numSamplesDefault), outputDir(outputDirDefault),
+        packed(false), directIo(false) {}
 };
 
 class QAicRunnerExample {
@@ -45,8 +53,38 @@ public:
   void setWriteOutputStartIteration(const uint32_t &num);
   bool setWriteOutputDir(const char *);
   void setWriteOutputNumSamples(const uint32_t &num);
+  bool setWriteOutputFormat(const char *format);
+  void setWriteOutputDirectIo();
+  void setValidationAbsTolerance(double tolerance);
+  void setValidationRelTolerance(double tolerance);
+  void setValidationUlpTolerance(uint32_t tolerance);
+  bool setInputFill(const char *pattern);
+  void setInputSeed(uint64_t seed);
+  bool setAicStatsDir(const char *);
+  void setAicStatsCyclesPerUs(double cyclesPerUs);
   void getLastRunStats(uint64_t &infCompleted, double &infRate,
                        uint64_t &runtimeUs, uint32_t &batchSize);
+  bool setArrival(const char *arrival);
+  void setOfferedRate(double rate);
+  bool setTraceFile(const char *path);
+  void setNumExecObjs(uint32_t numExecObjs);
+  void setWarmupSec(double sec);
+  void setDurationSec(double sec);
+  bool isOpenLoop() const { return openLoop_; }
+  void getLastLoadReport(qaic::openrt::LoadGenReport &report);
+  void setInputDataset(const char *path);
+  bool setInputDir(const char *dir);
+  void setPrefetchSlots(uint32_t numSlots);
+  void setPrefetchThreads(uint32_t numThreads);
+  void setPackDatasetPath(const char *path);
+  bool isPackDataset() const { return !packDatasetPath_.empty(); }
+  void setRecordTraffic(const char *path);
+  void setRecordPayload();
+  bool setReplayTraffic(const char *path);
+  void setReplayTimeScale(double timeScale);
+  bool isReplay() const { return replay_; }
+  void getLastReplayReport(qaic::openrt::TrafficReplayReport &report);
+  QStatus packDataset();
   QStatus init();
   QStatus run();
 
@@ -72,7 +110,46 @@ private:
   qaic::openrt::FileWriter fileWriter_;
   QStatus addBuffersToValidationList();
   QStatus validateOutput(const std::vector<QBuffer> &ioBuffers, size_t infIdx);
+  void printValidationReport(const qaic::openrt::ValidationReport &report);
+  qaic::openrt::ValidationProperties validationProperties_;
+  qaic::openrt::shOutputValidator outputValidator_;
+  // Inputs generated when no -i is given
+  qaic::openrt::InputFillProperties inputFillProperties_;
+  qaic::openrt::shInputFill inputFill_;
+  qaic::openrt::shInferenceVector createInferenceVector();
+  QStatus exportAicStats(size_t infIdx);
+  QStatus initLoadGen();
+  QStatus runLoadGen();
+  QStatus initDatasetStreamer();
+  QStatus initTrafficReplay();
+  QStatus runTrafficReplay();
+  QStatus saveTraffic();
+  uint32_t getNumProgramInputs() const;
+  std::string aicStatsDir_;
+  double aicStatsCyclesPerUs_ = 1.0;
+  qaic::openrt::shAicStats aicStats_;
   uint64_t lastRunDurationUs_ = 0;
+  // Open-loop mode, requests are sent at the times of an arrival process
+  bool openLoop_ = false;
+  uint32_t numExecObjs_ = numExecObjsDefault;
+  qaic::openrt::LoadGenProperties loadGenProperties_;
+  qaic::openrt::shLoadGen loadGen_;
+  qaic::openrt::LoadGenReport loadReport_;
+  // Inputs streamed from a dataset instead of the -i files
+  std::string inputDatasetPath_;
+  std::string inputDir_;
+  std::string packDatasetPath_;
+  qaic::openrt::DatasetStreamerProperties streamerProperties_;
+  qaic::openrt::shDatasetStreamer streamer_;
+  // Inferences recorded to, or replayed from, a traffic trace
+  std::string recordTrafficPath_;
+  qaic::openrt::TrafficRecorderProperties recorderProperties_;
+  qaic::openrt::shTrafficRecorder trafficRecorder_;
+  bool replay_ = false;
+  qaic::openrt::TrafficTrace replayTrace_;
+  qaic::openrt::TrafficReplayProperties replayProperties_;
+  qaic::openrt::shTrafficReplay trafficReplay_;
+  qaic::openrt::TrafficReplayReport replayReport_;
 }; // QAicRunnerExample
 
 } // namespace qaicrunner
@@ -14,20 +14,64 @@ static void usage() {
          "  -i, --input-file <path>               Input filename from which to load input data.\n"
          "                                        Specify multiple times for each input file.\n"
          "                                        If no -i is given, random input will be generated\n"
+         "  --input-fill <random|bytes|ramp|zero> Content of generated inputs, default random: values valid for\n"
+         "                                        the data type and quantization of every input\n"
+         "  --input-seed <num>                    Seed of generated random inputs, default 0\n"
          "  -o, --output-file <path>              Output filename from which to compare output for validation.\n"
          "                                        Specify multiple times for each output file.\n"
          "                                        If no -o is given, no validation of output will be done.\n"
+         "  --validate-abs-tol <num>              Output elements within an absolute error match, default 0\n"
+         "  --validate-rel-tol <num>              Output elements within an error relative to the reference match,\n"
+         "                                        default 0\n"
+         "  --validate-ulp-tol <num>              Output elements within a number of representable values, or\n"
+         "                                        quantization steps, match, default 0. Elements matching any\n"
+         "                                        tolerance pass, quantized outputs are dequantized first\n"
          "  -n, --num-iter <num>                  Number of iterations, default %d\n"
          "  --write-output-start-iter <num>       Write outputs start iteration, default %d\n"
          "  --write-output-num-samples <num>      Number of outputs to write, default %d\n"
          "  --write-output-dir <path>             Location to save output files, dir should exist and be writable, default '%s'\n"
+         "  --write-output-format <files|packed>  Write one file per output, or all outputs to a single indexed\n"
+         "                                        outputs.qout file, default files\n"
+         "  --write-output-direct-io              Write the packed file with O_DIRECT, bypassing the page cache\n"
+         "  --aic-stats-dir <path>                Decode AIC op stats of the last iteration and write a\n"
+         "                                        Chrome trace (.json) and CSV per-op breakdown to path.\n"
+         "                                        Program must be compiled with -aic-op-stats\n"
+         "  --aic-stats-cycles-per-us <num>       Device cycles per microsecond used for stats timing, default 1\n"
+         "  --arrival <fixed|poisson|trace>       Send inferences open-loop at the times of an arrival process\n"
+         "                                        instead of back to back. Latency is measured from the intended\n"
+         "                                        send time, -n is ignored\n"
+         "  --rate <num>                          Offered inferences per second of fixed and poisson, default %.0f\n"
+         "  --trace-file <path>                   Replay send times, one per line in microseconds\n"
+         "  --num-execobj <num>                   Number of inferences in flight in open-loop mode, default %d\n"
+         "  --warmup-sec <num>                    Seconds of load excluded from the report, default 0\n"
+         "  --duration-sec <num>                  Seconds of load measured after the warm-up, default %.0f.\n"
+         "                                        0 replays the whole trace file\n"
+         "  --input-dataset <path>                Stream inputs from a packed dataset file, cycling through\n"
+         "                                        its samples for -n iterations\n"
+         "  --input-dir <path>                    Stream inputs from the files of a directory, sorted by name\n"
+         "                                        and taken one per program input for each sample\n"
+         "  --prefetch-slots <num>                Samples loaded ahead of the device, default %d\n"
+         "  --prefetch-threads <num>              Threads loading samples, default %d\n"
+         "  --pack-dataset <path>                 Pack the samples of --input-dir into a dataset file and exit\n"
+         "  --record-traffic <path>               Record the timing, thread, ExecObj and input sizes of every\n"
+         "                                        inference to a trace file for --replay-traffic\n"
+         "  --record-payload                      Record the input content as well\n"
+         "  --replay-traffic <path>               Replay the inferences of a recorded trace file with the\n"
+         "                                        recorded timing, threads and input sizes, -n is ignored\n"
+         "  --replay-time-scale <num>             Factor applied to the recorded send times, default 1.\n"
+         "                                        0 sends each inference as soon as its thread is free\n"
          "  -v, --verbose                         Verbose log from program\n"
          "  -h, --help                            help\n",
          qidDefault, // --aic-device-id
          numInferencesDefault, // --num-iter
          startIterationDefault, // --write-output-start-iter
          numSamplesDefault, // --write-output-num-samples
-         outputDirDefault.c_str() // --write-output-out-dir
+         outputDirDefault.c_str(), // --write-output-out-dir
+         offeredRateDefault, // --rate
+         numExecObjsDefault, // --num-execobj
+         durationSecDefault, // --duration-sec
+         prefetchSlotsDefault, // --prefetch-slots
+         prefetchThreadsDefault // --prefetch-threads
          );
 }
 // clang-format on
@@ -54,6 +98,30 @@ int main(int argc, char **argv) {
       {"write-output-start-iter", required_argument, 0, 1},
       {"write-output-num-samples", required_argument, 0, 2},
       {"write-output-dir", required_argument, 0, 3},
+      {"aic-stats-dir", required_argument, 0, 4},
+      {"aic-stats-cycles-per-us", required_argument, 0, 5},
+      {"arrival", required_argument, 0, 6},
+      {"rate", required_argument, 0, 7},
+      {"trace-file", required_argument, 0, 8},
+      {"num-execobj", required_argument, 0, 9},
+      {"warmup-sec", required_argument, 0, 10},
+      {"duration-sec", required_argument, 0, 11},
+      {"input-dataset", required_argument, 0, 12},
+      {"input-dir", required_argument, 0, 13},
+      {"prefetch-slots", required_argument, 0, 14},
+      {"prefetch-threads", required_argument, 0, 15},
+      {"pack-dataset", required_argument, 0, 16},
+      {"write-output-format", required_argument, 0, 17},
+      {"write-output-direct-io", no_argument, 0, 18},
+      {"validate-abs-tol", required_argument, 0, 19},
+      {"validate-rel-tol", required_argument, 0, 20},
+      {"validate-ulp-tol", required_argument, 0, 21},
+      {"input-fill", required_argument, 0, 22},
+      {"input-seed", required_argument, 0, 23},
+      {"record-traffic", required_argument, 0, 24},
+      {"record-payload", no_argument, 0, 25},
+      {"replay-traffic", required_argument, 0, 26},
+      {"replay-time-scale", required_argument, 0, 27},
       {0, 0, 0, 0}};
 
   int option_index = 0;
@@ -85,6 +153,153 @@ int main(int argc, char **argv) {
         exit(1);
       }
       break;
+    case 4: // aic-stats-dir
+      if (!runner.setAicStatsDir(optarg)) {
+        std::cerr << "Invalid aic stats dir: " << optarg << std::endl;
+        usage();
+        exit(1);
+      }
+      break;
+    case 5: // aic-stats-cycles-per-us
+      if (std::atof(optarg) <= 0) {
+        std::cerr << "Set positive value for aic-stats-cycles-per-us"
+                  << std::endl;
+        exit(1);
+      }
+      runner.setAicStatsCyclesPerUs(std::atof(optarg));
+      break;
+    case 6: // arrival
+      if (!runner.setArrival(optarg)) {
+        std::cerr << "Invalid arrival: " << optarg << std::endl;
+        usage();
+        exit(1);
+      }
+      break;
+    case 7: // rate
+      if (std::atof(optarg) <= 0) {
+        std::cerr << "Set positive value for rate" << std::endl;
+        exit(1);
+      }
+      runner.setOfferedRate(std::atof(optarg));
+      break;
+    case 8: // trace-file
+      if (!runner.setTraceFile(optarg)) {
+        std::cerr << "Invalid trace file: " << optarg << std::endl;
+        exit(1);
+      }
+      break;
+    case 9: // num-execobj
+      if (std::atoi(optarg) <= 0) {
+        std::cerr << "Set positive value for num-execobj" << std::endl;
+        exit(1);
+      }
+      runner.setNumExecObjs(std::atoi(optarg));
+      break;
+    case 10: // warmup-sec
+      if (std::atof(optarg) < 0) {
+        std::cerr << "Set non-negative value for warmup-sec" << std::endl;
+        exit(1);
+      }
+      runner.setWarmupSec(std::atof(optarg));
+      break;
+    case 11: // duration-sec
+      if (std::atof(optarg) < 0) {
+        std::cerr << "Set non-negative value for duration-sec" << std::endl;
+        exit(1);
+      }
+      runner.setDurationSec(std::atof(optarg));
+      break;
+    case 12: // input-dataset
+      runner.setInputDataset(optarg);
+      break;
+    case 13: // input-dir
+      if (!runner.setInputDir(optarg)) {
+        std::cerr << "Invalid input dir: " << optarg << std::endl;
+        usage();
+        exit(1);
+      }
+      break;
+    case 14: // prefetch-slots
+      if (std::atoi(optarg) <= 0) {
+        std::cerr << "Set positive value for prefetch-slots" << std::endl;
+        exit(1);
+      }
+      runner.setPrefetchSlots(std::atoi(optarg));
+      break;
+    case 15: // prefetch-threads
+      if (std::atoi(optarg) <= 0) {
+        std::cerr << "Set positive value for prefetch-threads" << std::endl;
+        exit(1);
+      }
+      runner.setPrefetchThreads(std::atoi(optarg));
+      break;
+    case 16: // pack-dataset
+      runner.setPackDatasetPath(optarg);
+      break;
+    case 17: // write-output-format
+      if (!runner.setWriteOutputFormat(optarg)) {
+        std::cerr << "Invalid write-output-format: " << optarg << std::endl;
+        usage();
+        exit(1);
+      }
+      break;
+    case 18: // write-output-direct-io
+      runner.setWriteOutputDirectIo();
+      break;
+    case 19: // validate-abs-tol
+      if (std::atof(optarg) < 0) {
+        std::cerr << "Set non-negative value for validate-abs-tol"
+                  << std::endl;
+        exit(1);
+      }
+      runner.setValidationAbsTolerance(std::atof(optarg));
+      break;
+    case 20: // validate-rel-tol
+      if (std::atof(optarg) < 0) {
+        std::cerr << "Set non-negative value for validate-rel-tol"
+                  << std::endl;
+        exit(1);
+      }
+      runner.setValidationRelTolerance(std::atof(optarg));
+      break;
+    case 21: // validate-ulp-tol
+      if (std::atoi(optarg) < 0) {
+        std::cerr << "Set non-negative value for validate-ulp-tol"
+                  << std::endl;
+        exit(1);
+      }
+      runner.setValidationUlpTolerance(std::atoi(optarg));
+      break;
+    case 22: // input-fill
+      if (!runner.setInputFill(optarg)) {
+        std::cerr << "Invalid input-fill: " << optarg << std::endl;
+        usage();
+        exit(1);
+      }
+      break;
+    case 23: // input-seed
+      runner.setInputSeed(std::strtoull(optarg, nullptr, 0));
+      break;
+    case 24: // record-traffic
+      runner.setRecordTraffic(optarg);
+      break;
+    case 25: // record-payload
+      runner.setRecordPayload();
+      break;
+    case 26: // replay-traffic
+      if (!runner.setReplayTraffic(optarg)) {
+        std::cerr << "Invalid traffic trace: " << optarg << std::endl;
+        exit(1);
+      }
+      break;
+    case 27: // replay-time-scale
+      if (std::atof(optarg) < 0) {
+        std::cerr << "Set non-negative value for replay-time-scale"
+                  << std::endl;
+        exit(1);
+      }
+      runner.setReplayTimeScale(std::atof(optarg));
+      break;
     case 'd': // aic-device-id
       if (std::atoi(optarg) < 0) {
         std::cerr << "Set a valid aic-device-id" << std::endl;
@@ -131,6 +346,10 @@ int main(int argc, char **argv) {
     exit(1);
   }
 
+  if (runner.isPackDataset()) {
+    return (runner.packDataset() == QS_SUCCESS) ? 0 : 1;
+  }
+
   try {
     status = runner.init();
 
@@ -146,6 +365,45 @@ int main(int argc, char **argv) {
       return 1;
     }
 
+    auto printLatency = [](const char *name,
+                           const qaic::openrt::LoadGenLatency &l) {
+      std::cout << name << " us: mean " << l.meanUs << " p50 " << l.p50Us
+                << " p90 " << l.p90Us << " p99 " << l.p99Us << " p99.9 "
+                << l.p999Us << " max " << l.maxUs << std::endl;
+    };
+
+    if (runner.isReplay()) {
+      qaic::openrt::TrafficReplayReport report;
+      runner.getLastReplayReport(report);
+      std::cout << " ---- Replay Stats ----" << std::endl;
+      std::cout << std::fixed << std::setprecision(3) << "Requests "
+                << report.numRequests << " Completed " << report.numCompleted
+                << " Failed " << report.numFailed << " StatusChanged "
+                << report.numStatusChanged << std::endl;
+      std::cout << "Duration " << report.durationSec << "s Recorded "
+                << report.recordedDurationSec << "s" << std::endl;
+      printLatency("Latency", report.latency);
+      printLatency("ServiceTime", report.serviceTime);
+      printLatency("RecordedServiceTime", report.recordedServiceTime);
+      return (report.numFailed == 0) ? 0 : 1;
+    }
+
+    if (runner.isOpenLoop()) {
+      qaic::openrt::LoadGenReport report;
+      runner.getLastLoadReport(report);
+      std::cout << " ---- Load Stats ----" << std::endl;
+      std::cout << std::fixed << std::setprecision(3) << "Offered "
+                << report.numOffered << " Completed " << report.numCompleted
+                << " Failed " << report.numFailed << " Missed "
+                << report.numMissed << " Window " << report.windowSec << "s"
+                << std::endl;
+      std::cout << "Offered Inf/Sec " << report.offeredRate
+                << " Achieved Inf/Sec " << report.achievedRate << std::endl;
+      printLatency("Latency", report.latency);
+      printLatency("ServiceTime", report.serviceTime);
+      return (report.numFailed == 0) ? 0 : 1;
+    }
+
     uint64_t totalInferencesCompleted = 0;
     double infRate = 0;
     uint64_t runtimeUs = 0;